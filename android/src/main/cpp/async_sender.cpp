@@ -0,0 +1,77 @@
+#include "async_sender.h"
+#include "rtmp_wrapper.h"
+#include "bb_log.h"
+
+#define TAG "AsyncSender"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+
+AsyncVideoSender::AsyncVideoSender(size_t max_queued, SendFn send, ReleaseFn release)
+        : max_queued_(max_queued > 0 ? max_queued : 1), send_(send), release_(release) {}
+
+AsyncVideoSender::~AsyncVideoSender() {
+    stop();
+}
+
+void AsyncVideoSender::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_ || stopping_) return;
+    started_ = true;
+    thread_ = std::thread(&AsyncVideoSender::send_loop, this);
+}
+
+AsyncVideoSender::SubmitResult AsyncVideoSender::submit(const Job &job, int *evicted) {
+    std::deque<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || !started_) return SUBMIT_STOPPED;
+        if (queue_.size() >= max_queued_) {
+            if (!job.is_key) return SUBMIT_QUEUE_FULL;
+            // 关键帧可以独立解码：清空积压，保证其尽快发出
+            dropped.swap(queue_);
+        }
+        queue_.push_back(job);
+    }
+    cond_.notify_one();
+    if (evicted != nullptr) *evicted = (int) dropped.size();
+    if (!dropped.empty()) LOGD("队列满，清空 %zu 帧以插入关键帧", dropped.size());
+    release_all(dropped);
+    return SUBMIT_QUEUED;
+}
+
+void AsyncVideoSender::stop() {
+    std::deque<Job> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remaining.swap(queue_);
+    }
+    release_all(remaining);
+}
+
+void AsyncVideoSender::release_all(std::deque<Job> &jobs) {
+    for (const Job &job : jobs) {
+        release_(job.token, RTMP_ASYNC_DROPPED);
+    }
+    jobs.clear();
+}
+
+void AsyncVideoSender::send_loop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            job = queue_.front();
+            queue_.pop_front();
+        }
+        // 发送与释放都在锁外：发送可能阻塞在 socket 上，释放回调会进入 Java 归还编码器缓冲区
+        int result = send_(job);
+        release_(job.token, result);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef ASYNC_SENDER_H
+#define ASYNC_SENDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * 零拷贝视频发送队列。调用方（MediaCodec 输出线程）只入队编码器缓冲区的指针与释放令牌，
+ * 由独立发送线程直接从该缓冲区发送，完成后以令牌回调，调用方再归还缓冲区（releaseOutputBuffer）。
+ * 每个入队成功的令牌恰好释放一次；队列满时关键帧清空队列后入队，非关键帧被拒绝（与 Kotlin 发送队列策略一致）。
+ */
+class AsyncVideoSender {
+public:
+    struct Job {
+        const uint8_t *data;
+        int size;
+        long timestamp;
+        bool is_key;
+        long token;
+        int64_t enqueue_us;  // 进入发送接口的时刻，计入 enqueue_to_wire
+    };
+
+    enum SubmitResult {
+        SUBMIT_QUEUED,
+        SUBMIT_QUEUE_FULL,  // 非关键帧未入队，缓冲区仍归调用方
+        SUBMIT_STOPPED,
+    };
+
+    // 发送一帧，返回 0 成功，负数失败
+    typedef std::function<int(const Job &)> SendFn;
+    // 释放令牌；result 为发送结果，未发送即丢弃时为 RTMP_ASYNC_DROPPED
+    typedef std::function<void(long token, int result)> ReleaseFn;
+
+    AsyncVideoSender(size_t max_queued, SendFn send, ReleaseFn release);
+    ~AsyncVideoSender();
+
+    void start();
+
+    /**
+     * 入队一帧。关键帧遇到队列满时清空队列，被清空的缓冲区在当前线程以 RTMP_ASYNC_DROPPED 释放
+     * @param evicted 输出被清空的帧数
+     */
+    SubmitResult submit(const Job &job, int *evicted);
+
+    // 等待正在发送的帧完成后停止发送线程，队列中未发送的缓冲区以 RTMP_ASYNC_DROPPED 释放
+    void stop();
+
+    AsyncVideoSender(const AsyncVideoSender &) = delete;
+    AsyncVideoSender &operator=(const AsyncVideoSender &) = delete;
+
+private:
+    void send_loop();
+    void release_all(std::deque<Job> &jobs);
+
+    size_t max_queued_;
+    SendFn send_;
+    ReleaseFn release_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    bool started_ = false;
+    std::thread thread_;
+};
+
+#endif // ASYNC_SENDER_H
@@ -0,0 +1,75 @@
+#include "av_clock.h"
+#include <cstring>
+
+const int64_t AvClock::kMaxSlewUs;
+const int64_t AvClock::kResyncThresholdUs;
+
+AvClock::AvClock(int sample_rate) : sample_rate_(sample_rate > 0 ? sample_rate : 44100) {}
+
+int64_t AvClock::relative(int64_t capture_us) {
+    if (!started_) {
+        started_ = true;
+        origin_us_ = capture_us;
+    }
+    return capture_us - origin_us_;
+}
+
+/* 保证轨道内严格递增，返回调整后的毫秒值 */
+static int64_t monotonic_ms(int64_t us, int64_t &last_ms, uint64_t &clamped) {
+    int64_t ms = us > 0 ? us / 1000 : 0;
+    if (ms <= last_ms) {
+        ms = last_ms + 1;
+        clamped++;
+    }
+    last_ms = ms;
+    return ms;
+}
+
+int64_t AvClock::audio(int64_t capture_us, int samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t capture = relative(capture_us);
+    if (!audio_started_) {
+        audio_started_ = true;
+        audio_anchor_us_ = capture;
+        anchor_samples_ = 0;
+    }
+    int64_t sample_us = audio_anchor_us_ + (int64_t) (anchor_samples_ * 1000000 / (uint64_t) sample_rate_);
+    int64_t offset = capture - sample_us - drift_us_;
+    if (offset > kResyncThresholdUs || offset < -kResyncThresholdUs) {
+        // 音频中断或采集停顿：采样时间线平移到当前采集时间，保持原有漂移
+        audio_anchor_us_ = sample_us + offset;
+        anchor_samples_ = 0;
+        sample_us += offset;
+        audio_resyncs_++;
+    } else {
+        drift_us_ += offset / 16;
+    }
+    if (samples > 0) {
+        anchor_samples_ += (uint64_t) samples;
+        total_samples_ += (uint64_t) samples;
+    }
+    return monotonic_ms(sample_us, last_audio_ms_, audio_clamped_);
+}
+
+int64_t AvClock::video(int64_t capture_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t capture = relative(capture_us);
+    int64_t delta = drift_us_ - correction_us_;
+    if (delta > kMaxSlewUs) delta = kMaxSlewUs;
+    if (delta < -kMaxSlewUs) delta = -kMaxSlewUs;
+    correction_us_ += delta;
+    return monotonic_ms(capture - correction_us_, last_video_ms_, video_clamped_);
+}
+
+void AvClock::snapshot(rtmp_clock_stats *out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(out, 0, sizeof(*out));
+    out->drift_us = drift_us_;
+    out->correction_us = correction_us_;
+    out->audio_samples = total_samples_;
+    out->audio_resyncs = audio_resyncs_;
+    out->audio_clamped = audio_clamped_;
+    out->video_clamped = video_clamped_;
+    out->last_audio_ms = last_audio_ms_;
+    out->last_video_ms = last_video_ms_;
+}
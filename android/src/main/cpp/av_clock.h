@@ -0,0 +1,53 @@
+#ifndef AV_CLOCK_H
+#define AV_CLOCK_H
+
+#include "rtmp_wrapper.h"
+#include <cstdint>
+#include <mutex>
+
+/**
+ * 推流会话的音视频时钟：把编码器给出的采集时间（单调时钟，微秒）映射到同一条 RTMP 时间线（毫秒）。
+ *
+ * 音频时间戳由累计采样数推算（AAC 每帧 1024 个采样），不受调度抖动影响；采集时间只用来测量
+ * 两个时钟之间的漂移（采集时间 - 采样时间，指数平滑）。视频时间戳为采集时间减去校正量，
+ * 校正量每帧最多移动 kMaxSlewUs 逐步跟上漂移，视频因此对齐到音频的采样时间线而不会跳变。
+ * 音频中断（漂移突变超过 kResyncThresholdUs）时重新锚定采样时间线。
+ * 两条轨道各自保证输出严格递增。时间线零点为第一帧（任一轨道）的采集时间。
+ */
+class AvClock {
+public:
+    static const int64_t kMaxSlewUs = 500;
+    static const int64_t kResyncThresholdUs = 500000;
+
+    explicit AvClock(int sample_rate);
+
+    // 返回该音频帧的时间戳（毫秒），samples 为本帧采样数
+    int64_t audio(int64_t capture_us, int samples);
+
+    // 返回该视频帧的时间戳（毫秒）
+    int64_t video(int64_t capture_us);
+
+    void snapshot(rtmp_clock_stats *out) const;
+
+private:
+    int64_t relative(int64_t capture_us);
+
+    const int sample_rate_;
+    mutable std::mutex mutex_;
+    bool started_ = false;
+    int64_t origin_us_ = 0;
+
+    bool audio_started_ = false;
+    int64_t audio_anchor_us_ = 0;  // 当前采样时间线第 0 个采样对应的时间
+    uint64_t anchor_samples_ = 0;  // 自锚定以来的采样数
+    uint64_t total_samples_ = 0;
+    int64_t drift_us_ = 0;
+    int64_t correction_us_ = 0;
+    int64_t last_audio_ms_ = -1;
+    int64_t last_video_ms_ = -1;
+    uint64_t audio_resyncs_ = 0;
+    uint64_t audio_clamped_ = 0;
+    uint64_t video_clamped_ = 0;
+};
+
+#endif // AV_CLOCK_H
@@ -0,0 +1,458 @@
+#include "bb_log.h"
+#include "librtmp/log.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+
+namespace bb_log {
+
+const uint32_t kRingSize = 1 << 10;  // 2 的幂
+const int kSlotWords = 31;           // 每条记录 248 字节：3 个字的头 + 224 字节参数
+const int kHeaderWords = 3;
+const size_t kArgBytes = (kSlotWords - kHeaderWords) * sizeof(uint64_t);
+
+// 与 frame_trace 相同的 seqlock 写法：seq 为 0 表示正在写，否则为全局序号 + 1
+struct alignas(64) Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[kSlotWords];
+};
+
+static Slot g_ring[kRingSize];
+// 写入方与后台线程各自频繁访问的计数器放在不同缓存行
+alignas(64) static std::atomic<uint64_t> g_head(0);
+alignas(64) static std::atomic<uint64_t> g_tail(0);
+static std::atomic<uint64_t> g_dropped(0);
+static std::atomic<bool> g_async(false);
+static std::atomic<bool> g_running(false);
+static std::atomic<bb_log_sink> g_sink(nullptr);
+static std::thread *g_consumer = nullptr;  // 不随静态析构销毁，进程退出时无需 join
+static std::mutex g_control_mutex;
+
+enum Length { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_Z, LEN_J, LEN_T, LEN_LD };
+
+struct Spec {
+    char flags[8];
+    int width;        // -1 表示未指定
+    bool width_star;
+    int precision;    // -1 表示未指定
+    bool precision_star;
+    Length length;
+    char conv;        // 0 表示无法解析
+};
+
+/* 解析 '%' 之后的转换说明，返回转换字符之后的位置 */
+static const char *parse_spec(const char *p, Spec &spec) {
+    int nflags = 0;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        if (nflags < (int) sizeof(spec.flags) - 1) spec.flags[nflags++] = *p;
+        p++;
+    }
+    spec.flags[nflags] = '\0';
+    spec.width = -1;
+    spec.width_star = false;
+    if (*p == '*') {
+        spec.width_star = true;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        spec.width = 0;
+        while (*p >= '0' && *p <= '9') spec.width = spec.width * 10 + (*p++ - '0');
+    }
+    spec.precision = -1;
+    spec.precision_star = false;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.precision_star = true;
+            p++;
+        } else {
+            spec.precision = 0;
+            while (*p >= '0' && *p <= '9') spec.precision = spec.precision * 10 + (*p++ - '0');
+        }
+    }
+    spec.length = LEN_NONE;
+    switch (*p) {
+        case 'h':
+            spec.length = p[1] == 'h' ? LEN_HH : LEN_H;
+            p += spec.length == LEN_HH ? 2 : 1;
+            break;
+        case 'l':
+            spec.length = p[1] == 'l' ? LEN_LL : LEN_L;
+            p += spec.length == LEN_LL ? 2 : 1;
+            break;
+        case 'q': spec.length = LEN_LL; p++; break;
+        case 'z': spec.length = LEN_Z; p++; break;
+        case 'j': spec.length = LEN_J; p++; break;
+        case 't': spec.length = LEN_T; p++; break;
+        case 'L': spec.length = LEN_LD; p++; break;
+        default: break;
+    }
+    spec.conv = *p != '\0' && strchr("diouxXcsfFeEgGaAp%", *p) != nullptr ? *p : 0;
+    return spec.conv != 0 ? p + 1 : p;
+}
+
+/* 参数编码：整数/浮点/指针各 8 字节，字符串为 2 字节长度 + 内容；空间不足时截断并停止记录 */
+struct Writer {
+    uint8_t *data;
+    size_t len = 0;
+    bool truncated = false;
+
+    bool put(const void *value, size_t size) {
+        if (truncated || len + size > kArgBytes) {
+            truncated = true;
+            return false;
+        }
+        memcpy(data + len, value, size);
+        len += size;
+        return true;
+    }
+
+    bool put_u64(uint64_t value) { return put(&value, sizeof(value)); }
+
+    bool put_str(const char *s, int max_len) {
+        if (s == nullptr) s = "(null)";
+        size_t n = max_len >= 0 ? strnlen(s, (size_t) max_len) : strlen(s);
+        if (truncated || len + 2 > kArgBytes) {
+            truncated = true;
+            return false;
+        }
+        size_t room = kArgBytes - len - 2;
+        if (n > room) {
+            n = room;
+            truncated = true;
+        }
+        uint16_t n16 = (uint16_t) n;
+        memcpy(data + len, &n16, 2);
+        memcpy(data + len + 2, s, n);
+        len += 2 + n;
+        return !truncated;
+    }
+};
+
+static int64_t take_signed(Length length, va_list &args) {
+    switch (length) {
+        case LEN_HH: return (signed char) va_arg(args, int);
+        case LEN_H: return (short) va_arg(args, int);
+        case LEN_L: return va_arg(args, long);
+        case LEN_LL: return va_arg(args, long long);
+        case LEN_Z: return (int64_t) va_arg(args, ssize_t);
+        case LEN_J: return va_arg(args, intmax_t);
+        case LEN_T: return va_arg(args, ptrdiff_t);
+        default: return va_arg(args, int);
+    }
+}
+
+static uint64_t take_unsigned(Length length, va_list &args) {
+    switch (length) {
+        case LEN_HH: return (unsigned char) va_arg(args, unsigned int);
+        case LEN_H: return (unsigned short) va_arg(args, unsigned int);
+        case LEN_L: return va_arg(args, unsigned long);
+        case LEN_LL: return va_arg(args, unsigned long long);
+        case LEN_Z: return va_arg(args, size_t);
+        case LEN_J: return va_arg(args, uintmax_t);
+        case LEN_T: return (uint64_t) va_arg(args, ptrdiff_t);
+        default: return va_arg(args, unsigned int);
+    }
+}
+
+/* 调用线程：只按格式串取出参数，不做任何格式化 */
+static void capture(int prio, const char *tag, const char *fmt, va_list incoming) {
+    va_list args;
+    va_copy(args, incoming);
+    uint64_t buf[kSlotWords];
+    Writer w;
+    w.data = reinterpret_cast<uint8_t *>(buf + kHeaderWords);
+    for (const char *p = strchr(fmt, '%'); p != nullptr && !w.truncated; p = strchr(p, '%')) {
+        Spec spec;
+        p = parse_spec(p + 1, spec);
+        if (spec.conv == 0) break;
+        if (spec.conv == '%') continue;
+        if (spec.width_star) w.put_u64((uint64_t) (int64_t) va_arg(args, int));
+        int precision = spec.precision;
+        if (spec.precision_star) {
+            precision = va_arg(args, int);
+            w.put_u64((uint64_t) (int64_t) precision);
+        }
+        switch (spec.conv) {
+            case 'd': case 'i':
+                w.put_u64((uint64_t) take_signed(spec.length, args));
+                break;
+            case 'o': case 'u': case 'x': case 'X':
+                w.put_u64(take_unsigned(spec.length, args));
+                break;
+            case 'c':
+                w.put_u64((uint64_t) va_arg(args, int));
+                break;
+            case 's':
+                w.put_str(va_arg(args, const char *), precision);
+                break;
+            case 'p':
+                w.put_u64((uint64_t) (uintptr_t) va_arg(args, void *));
+                break;
+            default: {
+                double value = spec.length == LEN_LD ? (double) va_arg(args, long double) : va_arg(args, double);
+                w.put(&value, sizeof(value));
+                break;
+            }
+        }
+    }
+    va_end(args);
+    memset(w.data + w.len, 0, (sizeof(uint64_t) - w.len % sizeof(uint64_t)) % sizeof(uint64_t));
+    buf[0] = (uint64_t) (uint8_t) prio | ((uint64_t) w.truncated << 8) | ((uint64_t) w.len << 16);
+    buf[1] = (uint64_t) (uintptr_t) tag;
+    buf[2] = (uint64_t) (uintptr_t) fmt;
+
+    uint64_t index = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = g_ring[index & (kRingSize - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    size_t words = kHeaderWords + (w.len + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    for (size_t i = 0; i < words; ++i) slot.words[i].store(buf[i], std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+struct Reader {
+    const uint8_t *data;
+    size_t len;
+    size_t pos = 0;
+
+    bool get(void *value, size_t size) {
+        if (pos + size > len) return false;
+        memcpy(value, data + pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool get_i64(int64_t &value) { return get(&value, sizeof(value)); }
+};
+
+static void append(char *out, size_t cap, size_t &used, const char *src, size_t n) {
+    if (used + 1 >= cap) return;
+    if (n > cap - 1 - used) n = cap - 1 - used;
+    memcpy(out + used, src, n);
+    used += n;
+    out[used] = '\0';
+}
+
+/* 后台线程：按同一格式串解码参数，逐个转换说明调用 snprintf */
+static void format_record(const uint64_t *words, char *out, size_t cap) {
+    size_t used = 0;
+    out[0] = '\0';
+    bool truncated = ((words[0] >> 8) & 1) != 0;
+    Reader r;
+    r.data = reinterpret_cast<const uint8_t *>(words + kHeaderWords);
+    r.len = (size_t) (words[0] >> 16);
+    const char *fmt = reinterpret_cast<const char *>((uintptr_t) words[2]);
+
+    const char *p = fmt;
+    while (*p) {
+        const char *percent = strchr(p, '%');
+        if (percent == nullptr) {
+            append(out, cap, used, p, strlen(p));
+            break;
+        }
+        append(out, cap, used, p, (size_t) (percent - p));
+        Spec spec;
+        const char *next = parse_spec(percent + 1, spec);
+        if (spec.conv == 0) {
+            append(out, cap, used, percent, strlen(percent));
+            break;
+        }
+        p = next;
+        if (spec.conv == '%') {
+            append(out, cap, used, "%", 1);
+            continue;
+        }
+        int64_t width = spec.width, precision = spec.precision;
+        bool ok = true;
+        if (spec.width_star) ok = r.get_i64(width);
+        else if (width < 0) width = 0;
+        if (ok && spec.precision_star) ok = r.get_i64(precision);
+
+        char piece[512];
+        char conv_spec[32];
+        int n = -1;
+        int64_t i64 = 0;
+        double f64 = 0;
+        if (ok) {
+            switch (spec.conv) {
+                case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                    if (!r.get_i64(i64)) { ok = false; break; }
+                    snprintf(conv_spec, sizeof(conv_spec), "%%%s*.*ll%c", spec.flags, spec.conv);
+                    if (spec.conv == 'd' || spec.conv == 'i') {
+                        n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (int) precision, (long long) i64);
+                    } else {
+                        n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (int) precision,
+                                     (unsigned long long) i64);
+                    }
+                    break;
+                case 'c':
+                    if (!r.get_i64(i64)) { ok = false; break; }
+                    snprintf(conv_spec, sizeof(conv_spec), "%%%s*c", spec.flags);
+                    n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (int) i64);
+                    break;
+                case 's': {
+                    uint16_t slen;
+                    if (!r.get(&slen, 2) || r.pos + slen > r.len) { ok = false; break; }
+                    snprintf(conv_spec, sizeof(conv_spec), "%%%s*.*s", spec.flags);
+                    n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (int) slen,
+                                 reinterpret_cast<const char *>(r.data + r.pos));
+                    r.pos += slen;
+                    break;
+                }
+                case 'p':
+                    if (!r.get_i64(i64)) { ok = false; break; }
+                    snprintf(conv_spec, sizeof(conv_spec), "%%%s*p", spec.flags);
+                    n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (void *) (uintptr_t) i64);
+                    break;
+                default:
+                    if (!r.get(&f64, sizeof(f64))) { ok = false; break; }
+                    snprintf(conv_spec, sizeof(conv_spec), "%%%s*.*%c", spec.flags, spec.conv);
+                    n = snprintf(piece, sizeof(piece), conv_spec, (int) width, (int) precision, f64);
+                    break;
+            }
+        }
+        if (!ok) break;  // 记录时参数区已满
+        if (n > 0) append(out, cap, used, piece, (size_t) n < sizeof(piece) ? (size_t) n : sizeof(piece) - 1);
+    }
+    if (truncated) append(out, cap, used, "…", strlen("…"));
+}
+
+static void consumer_loop() {
+    uint64_t tail = g_tail.load(std::memory_order_relaxed);
+    uint64_t reported_dropped = g_dropped.load(std::memory_order_relaxed);
+    uint64_t words[kSlotWords];
+    char line[1024];
+    while (true) {
+        uint64_t dropped = g_dropped.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            __android_log_print(ANDROID_LOG_WARN, "BbLog", "异步日志环已满，丢弃 %llu 条日志",
+                                (unsigned long long) (dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+        uint64_t head = g_head.load(std::memory_order_acquire);
+        if (tail == head) {
+            g_tail.store(tail, std::memory_order_release);
+            if (!g_running.load(std::memory_order_acquire)) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        if (head - tail > kRingSize) {
+            g_dropped.fetch_add(head - kRingSize - tail, std::memory_order_relaxed);
+            tail = head - kRingSize;
+        }
+        Slot &slot = g_ring[tail & (kRingSize - 1)];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != tail + 1) {
+            if (seq > tail + 1) {
+                // 已被下一圈覆盖
+                g_dropped.fetch_add(1, std::memory_order_relaxed);
+                tail++;
+            } else {
+                std::this_thread::yield();  // 写入方尚未发布
+            }
+            continue;
+        }
+        words[0] = slot.words[0].load(std::memory_order_relaxed);
+        size_t count = kHeaderWords + ((size_t) (words[0] >> 16) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        if (count > (size_t) kSlotWords) count = kSlotWords;
+        for (size_t i = 1; i < count; ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            tail++;
+            continue;
+        }
+        tail++;
+        format_record(words, line, sizeof(line));
+        int prio = (int) (uint8_t) words[0];
+        const char *tag = reinterpret_cast<const char *>((uintptr_t) words[1]);
+        bb_log_sink sink = g_sink.load(std::memory_order_acquire);
+        if (sink != nullptr) {
+            sink(prio, tag, line);
+        } else {
+            __android_log_print(prio, tag, "%s", line);
+        }
+        g_tail.store(tail, std::memory_order_release);
+    }
+}
+
+}  // namespace bb_log
+
+void bb_log_vwrite(int prio, const char *tag, const char *fmt, va_list args) {
+    if (fmt == nullptr) return;
+    if (bb_log::g_async.load(std::memory_order_relaxed)) {
+        bb_log::capture(prio, tag, fmt, args);
+    } else {
+        __android_log_vprint(prio, tag, fmt, args);
+    }
+}
+
+void bb_log_write(int prio, const char *tag, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bb_log_vwrite(prio, tag, fmt, args);
+    va_end(args);
+}
+
+void bb_log_set_async(bool enabled) {
+    using namespace bb_log;
+    std::lock_guard<std::mutex> lock(g_control_mutex);
+    if (enabled == g_async.load(std::memory_order_relaxed)) return;
+    if (enabled) {
+        g_running.store(true, std::memory_order_release);
+        g_consumer = new std::thread(consumer_loop);
+        g_async.store(true, std::memory_order_release);
+    } else {
+        g_async.store(false, std::memory_order_release);
+        g_running.store(false, std::memory_order_release);
+        if (g_consumer != nullptr) {
+            g_consumer->join();
+            delete g_consumer;
+            g_consumer = nullptr;
+        }
+    }
+}
+
+bool bb_log_async_enabled() {
+    return bb_log::g_async.load(std::memory_order_relaxed);
+}
+
+void bb_log_flush() {
+    using namespace bb_log;
+    uint64_t target = g_head.load(std::memory_order_acquire);
+    for (int i = 0; i < 1000 && g_running.load(std::memory_order_acquire); ++i) {
+        if (g_tail.load(std::memory_order_acquire) >= target) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+uint64_t bb_log_dropped() {
+    return bb_log::g_dropped.load(std::memory_order_relaxed);
+}
+
+void bb_log_set_sink(bb_log_sink sink) {
+    bb_log::g_sink.store(sink, std::memory_order_release);
+}
+
+static void librtmp_log(int level, const char *fmt, va_list args) {
+    int prio;
+    switch (level) {
+        case RTMP_LOGCRIT:
+        case RTMP_LOGERROR: prio = ANDROID_LOG_ERROR; break;
+        case RTMP_LOGWARNING: prio = ANDROID_LOG_WARN; break;
+        case RTMP_LOGINFO: prio = ANDROID_LOG_INFO; break;
+        case RTMP_LOGDEBUG: prio = ANDROID_LOG_DEBUG; break;
+        default: prio = ANDROID_LOG_VERBOSE; break;
+    }
+    if (BB_LOG_ENABLED(prio)) bb_log_vwrite(prio, "librtmp", fmt, args);
+}
+
+void bb_log_install_librtmp() {
+    static std::once_flag once;
+    std::call_once(once, [] { RTMP_LogSetCallback(librtmp_log); });
+}
@@ -0,0 +1,50 @@
+#ifndef BB_RTMP_LOG_H
+#define BB_RTMP_LOG_H
+
+/*
+ * native 日志：编译期级别裁剪 + 可选的异步二进制日志环。
+ *
+ * 低于 BB_LOG_MIN_LEVEL 的 BB_LOG 调用在编译期消除，参数不求值；Release（NDEBUG）默认只保留 WARN 及以上。
+ * 开启异步模式后，调用线程只按格式串把参数以二进制拷入无锁环形缓冲区（字符串拷贝内容），
+ * 由后台线程格式化并写入 logcat，发送路径不再承担 vsnprintf 与 logd 写入的开销；环满时覆盖最旧的记录并计数。
+ * 格式串与 tag 必须是静态字符串（字面量），后台线程格式化时才读取。
+ */
+
+#include <android/log.h>
+#include <cstdarg>
+#include <cstdint>
+
+#ifndef BB_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define BB_LOG_MIN_LEVEL ANDROID_LOG_WARN
+#else
+#define BB_LOG_MIN_LEVEL ANDROID_LOG_VERBOSE
+#endif
+#endif
+
+#define BB_LOG_ENABLED(prio) ((prio) >= BB_LOG_MIN_LEVEL)
+
+#define BB_LOG(prio, tag, ...) \
+    do { \
+        if (BB_LOG_ENABLED(prio)) bb_log_write(prio, tag, __VA_ARGS__); \
+    } while (0)
+
+void bb_log_write(int prio, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void bb_log_vwrite(int prio, const char *tag, const char *fmt, va_list args);
+
+// 开启/关闭异步模式；关闭时先排空环形缓冲区再停止后台线程
+void bb_log_set_async(bool enabled);
+bool bb_log_async_enabled();
+// 阻塞直到调用前写入的记录全部输出（同步模式下立即返回）
+void bb_log_flush();
+// 因环满被覆盖的记录数
+uint64_t bb_log_dropped();
+
+// 异步模式下格式化后的输出目标；为 nullptr 时写入 logcat（主机构建为 stderr）
+typedef void (*bb_log_sink)(int prio, const char *tag, const char *line);
+void bb_log_set_sink(bb_log_sink sink);
+
+// 将 librtmp 的日志转入 BB_LOG（级别映射到 android 优先级），进程内只需调用一次
+void bb_log_install_librtmp();
+
+#endif // BB_RTMP_LOG_H
@@ -0,0 +1,56 @@
+#include "bitstream.h"
+
+void nal_to_rbsp(const uint8_t *nal, size_t size, std::vector<uint8_t> &rbsp) {
+    rbsp.clear();
+    rbsp.reserve(size);
+    int zeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (zeros >= 2 && nal[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = nal[i] == 0x00 ? zeros + 1 : 0;
+        rbsp.push_back(nal[i]);
+    }
+}
+
+void rbsp_to_nal(const uint8_t *rbsp, size_t size, std::vector<uint8_t> &nal) {
+    int zeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (zeros >= 2 && rbsp[i] <= 0x03) {
+            nal.push_back(0x03);
+            zeros = 0;
+        }
+        zeros = rbsp[i] == 0x00 ? zeros + 1 : 0;
+        nal.push_back(rbsp[i]);
+    }
+}
+
+void BitWriter::bits(int n, uint32_t value) {
+    for (int i = n - 1; i >= 0; --i) {
+        if (used_ == 0) data_.push_back(0);
+        if ((value >> i) & 0x01) data_.back() |= (uint8_t) (0x80 >> used_);
+        used_ = (used_ + 1) & 7;
+    }
+}
+
+void BitWriter::ue(uint32_t value) {
+    uint64_t code = (uint64_t) value + 1;
+    int length = 0;
+    while ((code >> length) > 1) ++length;
+    bits(length, 0);
+    bits(length + 1, (uint32_t) code);
+}
+
+void BitWriter::se(int32_t value) {
+    ue(value > 0 ? (uint32_t) value * 2 - 1 : (uint32_t) (-(int64_t) value) * 2);
+}
+
+void BitWriter::align(int bit_value) {
+    while (used_ != 0) bit(bit_value);
+}
+
+void BitWriter::trailing_bits() {
+    bit(1);
+    align(0);
+}
@@ -0,0 +1,89 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * H.264/HEVC 码流的按位读写（RBSP 层，不处理防竞争字节）
+ */
+
+/* 去掉防竞争字节（00 00 03 中的 03），得到 RBSP */
+void nal_to_rbsp(const uint8_t *nal, size_t size, std::vector<uint8_t> &rbsp);
+
+/* 插入防竞争字节，把 RBSP 追加为 NALU 负载 */
+void rbsp_to_nal(const uint8_t *rbsp, size_t size, std::vector<uint8_t> &nal);
+
+class BitReader {
+public:
+    BitReader(const uint8_t *data, size_t size) : data_(data), size_bits_(size * 8) {}
+
+    uint32_t bits(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; ++i) {
+            if (pos_ >= size_bits_) {
+                overrun_ = true;
+                return 0;
+            }
+            value = (value << 1) | ((data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 0x01);
+            ++pos_;
+        }
+        return value;
+    }
+
+    void skip(size_t n) {
+        pos_ += n;
+        if (pos_ > size_bits_) overrun_ = true;
+    }
+
+    // ue(v) 指数哥伦布码
+    uint32_t ue() {
+        int leading_zeros = 0;
+        while (bits(1) == 0) {
+            if (overrun_ || ++leading_zeros > 31) {
+                overrun_ = true;
+                return 0;
+            }
+        }
+        return ((1u << leading_zeros) - 1) + bits(leading_zeros);
+    }
+
+    // se(v) 有符号指数哥伦布码
+    int32_t se() {
+        uint32_t code = ue();
+        return (code & 1) ? (int32_t) ((code + 1) >> 1) : -(int32_t) (code >> 1);
+    }
+
+    size_t byte_offset() const { return pos_ >> 3; }
+    size_t bit_offset() const { return pos_; }
+    bool ok() const { return !overrun_; }
+
+private:
+    const uint8_t *data_;
+    size_t size_bits_;
+    size_t pos_ = 0;
+    bool overrun_ = false;
+};
+
+class BitWriter {
+public:
+    void bits(int n, uint32_t value);
+    void bit(int value) { bits(1, value ? 1 : 0); }
+    void ue(uint32_t value);
+    void se(int32_t value);
+
+    bool byte_aligned() const { return used_ == 0; }
+    // 以 bit 值填充到字节边界
+    void align(int bit_value);
+    // rbsp_trailing_bits：停止位 1 + 对齐 0
+    void trailing_bits();
+
+    const std::vector<uint8_t> &data() const { return data_; }
+
+private:
+    std::vector<uint8_t> data_;
+    int used_ = 0;  // 最后一个字节已写入的位数
+};
+
+#endif // BITSTREAM_H
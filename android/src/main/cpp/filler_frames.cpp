@@ -0,0 +1,247 @@
+#include "filler_frames.h"
+#include "bitstream.h"
+#include "flv_mux.h"
+#include "rtmp_wrapper.h"
+#include "bb_log.h"
+#include <cstring>
+
+#define TAG "FillerFrames"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+// CABAC 概率状态表（H.264 表 9-44 / 9-45）
+static const uint8_t kRangeTabLps[64][4] = {
+        {128, 176, 208, 240}, {128, 167, 197, 227}, {128, 158, 187, 216}, {123, 150, 178, 205},
+        {116, 142, 169, 195}, {111, 135, 160, 185}, {105, 128, 152, 175}, {100, 122, 144, 166},
+        {95, 116, 137, 158}, {90, 110, 130, 150}, {85, 104, 123, 142}, {81, 99, 117, 135},
+        {77, 94, 111, 128}, {73, 89, 105, 122}, {69, 85, 100, 116}, {66, 80, 95, 110},
+        {62, 76, 90, 104}, {59, 72, 86, 99}, {56, 69, 81, 94}, {53, 65, 77, 89},
+        {51, 62, 73, 85}, {48, 59, 69, 80}, {46, 56, 66, 76}, {43, 53, 63, 72},
+        {41, 50, 59, 69}, {39, 48, 56, 65}, {37, 45, 54, 62}, {35, 43, 51, 59},
+        {33, 41, 48, 56}, {32, 39, 46, 53}, {30, 37, 43, 50}, {29, 35, 41, 48},
+        {27, 33, 39, 45}, {26, 31, 37, 43}, {24, 30, 35, 41}, {23, 28, 33, 39},
+        {22, 27, 32, 37}, {21, 26, 30, 35}, {20, 24, 29, 33}, {19, 23, 27, 31},
+        {18, 22, 26, 30}, {17, 21, 25, 28}, {16, 20, 23, 27}, {15, 19, 22, 25},
+        {14, 18, 21, 24}, {14, 17, 20, 23}, {13, 16, 19, 22}, {12, 15, 18, 21},
+        {12, 14, 17, 20}, {11, 14, 16, 19}, {11, 13, 15, 18}, {10, 12, 15, 17},
+        {10, 12, 14, 16}, {9, 11, 13, 15}, {9, 11, 12, 14}, {8, 10, 12, 14},
+        {8, 9, 11, 13}, {7, 9, 11, 12}, {7, 9, 10, 12}, {7, 8, 10, 11},
+        {6, 8, 9, 11}, {6, 7, 9, 10}, {6, 7, 8, 9}, {2, 2, 2, 2},
+};
+
+static const uint8_t kTransIdxLps[64] = {
+        0, 0, 1, 2, 2, 4, 4, 5, 6, 7, 8, 9, 9, 11, 11, 12,
+        13, 13, 15, 15, 16, 16, 18, 18, 19, 19, 21, 21, 22, 22, 23, 24,
+        24, 25, 26, 26, 27, 27, 28, 29, 29, 30, 30, 30, 31, 32, 32, 33,
+        33, 33, 34, 34, 35, 35, 35, 36, 36, 36, 37, 37, 37, 38, 38, 63,
+};
+
+static inline int clip3(int lo, int hi, int v) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/*
+ * CABAC 算术编码器（H.264 9.3.4.2 ~ 9.3.4.5）。P_Skip 帧只编码 mb_skip_flag 与 end_of_slice_flag：
+ * 相邻宏块都是跳过宏块时 mb_skip_flag 的 ctxIdxInc 恒为 0，因此只需一个上下文（ctxIdx 11）。
+ */
+class CabacEncoder {
+public:
+    CabacEncoder(BitWriter &writer, int slice_qp, int m, int n) : writer_(writer) {
+        int pre = clip3(1, 126, ((m * clip3(0, 51, slice_qp)) >> 4) + n);
+        if (pre <= 63) {
+            state_ = 63 - pre;
+            mps_ = 0;
+        } else {
+            state_ = pre - 64;
+            mps_ = 1;
+        }
+    }
+
+    void encode_decision(int bin) {
+        uint32_t lps = kRangeTabLps[state_][(range_ >> 6) & 3];
+        range_ -= lps;
+        if (bin != mps_) {
+            low_ += range_;
+            range_ = lps;
+            if (state_ == 0) mps_ = 1 - mps_;
+            state_ = kTransIdxLps[state_];
+        } else if (state_ < 62) {
+            ++state_;
+        }
+        renorm();
+    }
+
+    void encode_terminate(int bin) {
+        range_ -= 2;
+        if (bin) {
+            low_ += range_;
+            // EncodeFlush：最后写出的一位即 rbsp_stop_one_bit
+            range_ = 2;
+            renorm();
+            put_bit((low_ >> 9) & 1);
+            writer_.bits(2, ((low_ >> 7) & 3) | 1);
+        } else {
+            renorm();
+        }
+    }
+
+private:
+    void renorm() {
+        while (range_ < 256) {
+            if (low_ < 256) {
+                put_bit(0);
+            } else if (low_ >= 512) {
+                low_ -= 512;
+                put_bit(1);
+            } else {
+                low_ -= 256;
+                ++outstanding_;
+            }
+            range_ <<= 1;
+            low_ <<= 1;
+        }
+    }
+
+    void put_bit(int bit) {
+        if (first_) {
+            first_ = false;
+        } else {
+            writer_.bit(bit);
+        }
+        for (; outstanding_ > 0; --outstanding_) writer_.bit(1 - bit);
+    }
+
+    BitWriter &writer_;
+    uint32_t low_ = 0;
+    uint32_t range_ = 510;
+    int outstanding_ = 0;
+    bool first_ = true;
+    int state_ = 0;
+    int mps_ = 0;
+};
+
+bool H264SkipFrameGenerator::reset(const std::vector<uint8_t> &sps, const std::vector<uint8_t> &pps,
+                                   const uint8_t *idr, int size) {
+    valid_ = false;
+    index_ = 0;
+    if (!h264_parse_sps(sps.data(), sps.size(), sps_) || !h264_parse_pps(pps.data(), pps.size(), pps_)) {
+        LOGE("无法解析 SPS/PPS，不能生成 P_Skip 帧");
+        return false;
+    }
+    if (!sps_.frame_mbs_only || sps_.separate_colour_plane || pps_.num_slice_groups > 1 ||
+        sps_.max_num_ref_frames == 0) {
+        LOGE("不支持的码流特性: frame_mbs_only=%d, separate_colour_plane=%d, slice_groups=%d, max_ref_frames=%d",
+             sps_.frame_mbs_only, sps_.separate_colour_plane, pps_.num_slice_groups, sps_.max_num_ref_frames);
+        return false;
+    }
+
+    int pos = 0;
+    int nal_start = 0;
+    int nal_size = 0;
+    while (idr != nullptr && annexb_next_nal(idr, size, pos, nal_start, nal_size)) {
+        if ((idr[nal_start] & 0x1F) != 5) continue;
+        H264SliceHeader header;
+        if (!h264_parse_slice_header(idr + nal_start, nal_size, sps_, header)) break;
+        nal_ref_idc_ = header.nal_ref_idc != 0 ? header.nal_ref_idc : 1;
+        idr_frame_num_ = header.frame_num;
+        idr_poc_lsb_ = header.pic_order_cnt_lsb;
+        valid_ = true;
+        LOGD("P_Skip 生成器: %dx%d MB, %s, poc_type=%d", sps_.pic_width_in_mbs, sps_.pic_height_in_map_units,
+             pps_.entropy_coding_mode ? "CABAC" : "CAVLC", sps_.pic_order_cnt_type);
+        return true;
+    }
+    LOGE("参考帧中没有 IDR slice");
+    return false;
+}
+
+/* P slice 头（H.264 7.3.3），单参考帧、不做加权（权重标志全 0）、关闭去块滤波 */
+void H264SkipFrameGenerator::write_slice_header(BitWriter &writer, int frame_num, int poc_lsb) const {
+    writer.ue(0);  // first_mb_in_slice
+    writer.ue(5);  // slice_type: P（图像内所有 slice 均为 P）
+    writer.ue((uint32_t) pps_.pps_id);
+    writer.bits(sps_.log2_max_frame_num, (uint32_t) frame_num);
+    if (sps_.pic_order_cnt_type == 0) {
+        writer.bits(sps_.log2_max_pic_order_cnt_lsb, (uint32_t) poc_lsb);
+        if (pps_.bottom_field_pic_order_in_frame_present) writer.se(0);  // delta_pic_order_cnt_bottom
+    } else if (sps_.pic_order_cnt_type == 1 && !sps_.delta_pic_order_always_zero) {
+        writer.se(0);  // delta_pic_order_cnt[0]
+        if (pps_.bottom_field_pic_order_in_frame_present) writer.se(0);
+    }
+    if (pps_.redundant_pic_cnt_present) writer.ue(0);
+    writer.bit(1);  // num_ref_idx_active_override_flag
+    writer.ue(0);  // num_ref_idx_l0_active_minus1
+    writer.bit(0);  // ref_pic_list_modification_flag_l0
+    if (pps_.weighted_pred) {
+        writer.ue(0);  // luma_log2_weight_denom
+        if (sps_.chroma_array_type() != 0) writer.ue(0);  // chroma_log2_weight_denom
+        writer.bit(0);  // luma_weight_l0_flag
+        if (sps_.chroma_array_type() != 0) writer.bit(0);  // chroma_weight_l0_flag
+    }
+    writer.bit(0);  // adaptive_ref_pic_marking_mode_flag：滑动窗口
+    if (pps_.entropy_coding_mode) writer.ue(0);  // cabac_init_idc
+    writer.se(0);  // slice_qp_delta
+    if (pps_.deblocking_filter_control_present) writer.ue(1);  // disable_deblocking_filter_idc
+}
+
+bool H264SkipFrameGenerator::next(std::vector<uint8_t> &frame) {
+    frame.clear();
+    if (!valid_) return false;
+    ++index_;
+    int frame_num = (int) ((idr_frame_num_ + index_) & ((1u << sps_.log2_max_frame_num) - 1));
+    int poc_lsb = (int) ((idr_poc_lsb_ + 2 * index_) & ((1u << sps_.log2_max_pic_order_cnt_lsb) - 1));
+
+    BitWriter writer;
+    write_slice_header(writer, frame_num, poc_lsb);
+    int mbs = sps_.pic_size_in_mbs();
+    if (!pps_.entropy_coding_mode) {
+        writer.ue((uint32_t) mbs);  // mb_skip_run 覆盖整幅图像
+        writer.trailing_bits();
+    } else {
+        writer.align(1);  // cabac_alignment_one_bit
+        // mb_skip_flag 在 P slice、cabac_init_idc = 0 时的初始化参数 (m, n) = (23, 33)
+        CabacEncoder cabac(writer, pps_.pic_init_qp, 23, 33);
+        for (int i = 0; i < mbs; ++i) {
+            cabac.encode_decision(1);  // mb_skip_flag
+            cabac.encode_terminate(i == mbs - 1 ? 1 : 0);  // end_of_slice_flag
+        }
+        writer.align(0);
+    }
+
+    const std::vector<uint8_t> &rbsp = writer.data();
+    frame.reserve(rbsp.size() + 8);
+    frame.push_back(0x00);
+    frame.push_back(0x00);
+    frame.push_back(0x00);
+    frame.push_back(0x01);
+    frame.push_back((uint8_t) ((nal_ref_idc_ << 5) | 1));  // 非 IDR slice
+    rbsp_to_nal(rbsp.data(), rbsp.size(), frame);
+    return true;
+}
+
+int build_silent_audio_frame(int codec, int channels, uint8_t *out, size_t capacity) {
+    // AAC-LC：单个 SCE/CPE，global_gain 固定、无 section 数据，解码为全零采样
+    static const uint8_t kAacMono[] = {0x00, 0xC8, 0x00, 0x80, 0x23, 0x80};
+    static const uint8_t kAacStereo[] = {0x21, 0x00, 0x49, 0x90, 0x02, 0x19, 0x00, 0x23, 0x80};
+    // Opus：TOC 为 CELT 全带 20ms 单帧（config 31），后跟静音帧
+    static const uint8_t kOpusMono[] = {0xF8, 0xFF, 0xFE};
+    static const uint8_t kOpusStereo[] = {0xFC, 0xFF, 0xFE};
+
+    const uint8_t *frame;
+    size_t size;
+    if (channels != 1 && channels != 2) return -1;
+    if (codec == RTMP_AUDIO_CODEC_OPUS) {
+        frame = channels == 1 ? kOpusMono : kOpusStereo;
+        size = channels == 1 ? sizeof(kOpusMono) : sizeof(kOpusStereo);
+    } else {
+        frame = channels == 1 ? kAacMono : kAacStereo;
+        size = channels == 1 ? sizeof(kAacMono) : sizeof(kAacStereo);
+    }
+    if (out == nullptr || capacity < size) return -1;
+    memcpy(out, frame, size);
+    return (int) size;
+}
+
+int64_t audio_frame_duration_us(int codec, int sample_rate) {
+    if (codec == RTMP_AUDIO_CODEC_OPUS) return 20000;
+    return sample_rate > 0 ? 1024LL * 1000000 / sample_rate : 23220;
+}
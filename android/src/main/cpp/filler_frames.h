@@ -0,0 +1,62 @@
+#ifndef FILLER_FRAMES_H
+#define FILLER_FRAMES_H
+
+#include "h264_params.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BitWriter;
+
+/*
+ * 后台心跳的填充帧：重复上一画面的 H.264 P_Skip 帧与静音音频帧，每帧只有几个字节。
+ */
+
+/**
+ * 由 SPS/PPS 与最近的 IDR 帧合成全部宏块为 P_Skip 的 P 帧。
+ * 相邻宏块均为跳过宏块时预测运动矢量为 0，且没有残差：参考帧被原样复制，播放端画面停在该 IDR 上。
+ * 合成帧都标记为参考帧，frame_num 与 POC 从 IDR 起逐帧递增，滑动窗口管理 DPB；
+ * 熵编码支持 CAVLC 与 CABAC，场编码（frame_mbs_only_flag = 0）与多 slice group 不支持。
+ */
+class H264SkipFrameGenerator {
+public:
+    /**
+     * @param idr 参考 IDR 帧（Annex-B，可带参数集），之后生成的帧从它开始编号
+     * @return 参数集无法解析、码流特性不支持或 idr 中没有 IDR slice 时返回 false
+     */
+    bool reset(const std::vector<uint8_t> &sps, const std::vector<uint8_t> &pps, const uint8_t *idr, int size);
+
+    /**
+     * 生成 IDR 之后的下一帧（Annex-B，单个 slice NALU）
+     * @param frame 输出，会先清空
+     */
+    bool next(std::vector<uint8_t> &frame);
+
+    bool valid() const { return valid_; }
+
+private:
+    void write_slice_header(BitWriter &writer, int frame_num, int poc_lsb) const;
+
+    H264Sps sps_;
+    H264Pps pps_;
+    int nal_ref_idc_ = 1;
+    int idr_frame_num_ = 0;
+    int idr_poc_lsb_ = 0;
+    uint32_t index_ = 0;  // 自 IDR 起已生成的帧数
+    bool valid_ = false;
+};
+
+/**
+ * 写入一帧静音音频的原始负载（不含 FLV 音频头）：AAC-LC 为单声道/双声道的静音 raw_data_block，
+ * Opus 为 20ms CELT 静音包
+ * @param codec 见 rtmp_audio_codec
+ * @return 负载字节数，声道数不支持或缓冲区不足返回 -1
+ */
+int build_silent_audio_frame(int codec, int channels, uint8_t *out, size_t capacity);
+
+/**
+ * 一帧音频的时长（微秒）：AAC 为 1024 个采样，Opus 静音包固定 20ms
+ */
+int64_t audio_frame_duration_us(int codec, int sample_rate);
+
+#endif // FILLER_FRAMES_H
@@ -0,0 +1,419 @@
+#include "flv_mux.h"
+#include "bitstream.h"
+#include "librtmp/amf.h"
+#include "bb_log.h"
+#include <cstring>
+
+#define TAG "FlvMux"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static void write_be32(uint8_t *dst, uint32_t val) {
+    dst[0] = (val >> 24) & 0xFF;
+    dst[1] = (val >> 16) & 0xFF;
+    dst[2] = (val >> 8) & 0xFF;
+    dst[3] = val & 0xFF;
+}
+
+bool annexb_next_nal(const uint8_t *data, int size, int &pos, int &nal_start, int &nal_size) {
+    int i = pos;
+    while (i + 4 <= size) {
+        // find start code
+        int start = -1;
+        int prefix = 0;
+        for (; i + 3 < size; ++i) {
+            if (data[i] == 0x00 && data[i+1] == 0x00) {
+                if (data[i+2] == 0x01) { start = i; prefix = 3; break; }
+                if (i + 4 < size && data[i+2] == 0x00 && data[i+3] == 0x01) { start = i; prefix = 4; break; }
+            }
+        }
+        if (start < 0) break;
+        nal_start = start + prefix;
+        // find next start code
+        int next = size;
+        for (int j = nal_start; j + 3 < size; ++j) {
+            if (data[j] == 0x00 && data[j+1] == 0x00) {
+                if (data[j+2] == 0x01 || (j + 4 < size && data[j+2] == 0x00 && data[j+3] == 0x01)) {
+                    next = j;
+                    break;
+                }
+            }
+        }
+        nal_size = next - nal_start;
+        i = next;
+        if (nal_size > 0) {
+            pos = i;
+            return true;
+        }
+    }
+    pos = size;
+    return false;
+}
+
+static inline int nal_type_of(int codec, uint8_t header) {
+    return codec == RTMP_VIDEO_CODEC_HEVC ? (header >> 1) & 0x3F : header & 0x1F;
+}
+
+void parse_parameter_sets(const uint8_t *data, int size, int codec, std::vector<uint8_t> &vps,
+                          std::vector<uint8_t> &sps, std::vector<uint8_t> &pps) {
+    const bool hevc = codec == RTMP_VIDEO_CODEC_HEVC;
+    const int vps_type = hevc ? 32 : -1;
+    const int sps_type = hevc ? 33 : 7;
+    const int pps_type = hevc ? 34 : 8;
+    int pos = 0;
+    int nal_start = 0;
+    int nal_size = 0;
+    while (annexb_next_nal(data, size, pos, nal_start, nal_size)) {
+        int nal_type = nal_type_of(codec, data[nal_start]);
+        if (nal_type == sps_type) {
+            sps.assign(data + nal_start, data + nal_start + nal_size);
+            LOGD("找到 SPS: size=%d", nal_size);
+        } else if (nal_type == pps_type) {
+            pps.assign(data + nal_start, data + nal_start + nal_size);
+            LOGD("找到 PPS: size=%d", nal_size);
+        } else if (nal_type == vps_type) {
+            vps.assign(data + nal_start, data + nal_start + nal_size);
+            LOGD("找到 VPS: size=%d", nal_size);
+        }
+    }
+}
+
+void parse_sps_pps(const uint8_t *data, int size, std::vector<uint8_t> &sps, std::vector<uint8_t> &pps) {
+    std::vector<uint8_t> unused_vps;
+    parse_parameter_sets(data, size, RTMP_VIDEO_CODEC_H264, unused_vps, sps, pps);
+}
+
+bool annexb_has_slice(const uint8_t *data, int size, int codec) {
+    int pos = 0;
+    int nal_start = 0;
+    int nal_size = 0;
+    while (annexb_next_nal(data, size, pos, nal_start, nal_size)) {
+        int nal_type = nal_type_of(codec, data[nal_start]);
+        if (codec == RTMP_VIDEO_CODEC_HEVC ? nal_type < 32 : (nal_type >= 1 && nal_type <= 5)) return true;
+    }
+    return false;
+}
+
+int annexb_to_video_body(const uint8_t *data, int size, bool is_key, int codec, std::vector<uint8_t> &body) {
+    const bool hevc = codec == RTMP_VIDEO_CODEC_HEVC;
+    body.clear();
+    body.reserve(size + 9);
+    if (hevc) {
+        body.push_back(0x80 | (is_key ? 0x10 : 0x20) | 0x03); // ex header + frame type + CodedFramesX
+        body.resize(5);
+        write_be32(body.data() + 1, FLV_FOURCC_HVC1);
+    } else {
+        body.push_back(is_key ? 0x17 : 0x27); // frame type + codec
+        body.push_back(0x01); // AVC NALU
+        body.push_back(0x00);
+        body.push_back(0x00);
+        body.push_back(0x00); // composition time
+    }
+
+    // convert annex-b to length-prefixed, skip parameter sets
+    int pos = 0;
+    int nal_start = 0;
+    int nal_size = 0;
+    int nalu_count = 0;
+    while (annexb_next_nal(data, size, pos, nal_start, nal_size)) {
+        int nal_type = nal_type_of(codec, data[nal_start]);
+        if (hevc ? (nal_type >= 32 && nal_type <= 34) : (nal_type == 7 || nal_type == 8)) {
+            LOGD("跳过参数集 NALU (type=%d)", nal_type);
+            continue;
+        }
+
+        body.resize(body.size() + 4);
+        write_be32(body.data() + body.size() - 4, static_cast<uint32_t>(nal_size));
+        body.insert(body.end(), data + nal_start, data + nal_start + nal_size);
+        nalu_count++;
+    }
+    return nalu_count;
+}
+
+int annexb_to_avc_body(const uint8_t *data, int size, bool is_key, std::vector<uint8_t> &body) {
+    return annexb_to_video_body(data, size, is_key, RTMP_VIDEO_CODEC_H264, body);
+}
+
+struct HevcSpsInfo {
+    uint8_t profile_tier_level[12];  // general_profile_space ~ general_level_idc
+    int max_sub_layers_minus1;
+    int temporal_id_nesting;
+    int chroma_format_idc;
+    int bit_depth_luma_minus8;
+    int bit_depth_chroma_minus8;
+};
+
+/* 解析 HEVC SPS 中 HEVCDecoderConfigurationRecord 需要的字段（H.265 7.3.2.2 / 7.3.3） */
+static bool parse_hevc_sps(const std::vector<uint8_t> &sps, HevcSpsInfo &info) {
+    if (sps.size() < 2 + 1 + 12) return false;
+    std::vector<uint8_t> rbsp;
+    nal_to_rbsp(sps.data() + 2, sps.size() - 2, rbsp);  // 跳过 2 字节 NAL 头
+    BitReader reader(rbsp.data(), rbsp.size());
+    reader.bits(4);  // sps_video_parameter_set_id
+    info.max_sub_layers_minus1 = (int) reader.bits(3);
+    info.temporal_id_nesting = (int) reader.bits(1);
+    if (rbsp.size() < 1 + 12) return false;
+    memcpy(info.profile_tier_level, rbsp.data() + 1, sizeof(info.profile_tier_level));
+    reader.skip(12 * 8);
+
+    bool sub_profile[8] = {false};
+    bool sub_level[8] = {false};
+    for (int i = 0; i < info.max_sub_layers_minus1; ++i) {
+        sub_profile[i] = reader.bits(1) != 0;
+        sub_level[i] = reader.bits(1) != 0;
+    }
+    if (info.max_sub_layers_minus1 > 0) {
+        reader.skip((size_t) (8 - info.max_sub_layers_minus1) * 2);  // reserved_zero_2bits
+    }
+    for (int i = 0; i < info.max_sub_layers_minus1; ++i) {
+        if (sub_profile[i]) reader.skip(88);
+        if (sub_level[i]) reader.skip(8);
+    }
+
+    reader.ue();  // sps_seq_parameter_set_id
+    info.chroma_format_idc = (int) reader.ue();
+    if (info.chroma_format_idc == 3) reader.bits(1);  // separate_colour_plane_flag
+    reader.ue();  // pic_width_in_luma_samples
+    reader.ue();  // pic_height_in_luma_samples
+    if (reader.bits(1)) {  // conformance_window_flag
+        reader.ue();
+        reader.ue();
+        reader.ue();
+        reader.ue();
+    }
+    info.bit_depth_luma_minus8 = (int) reader.ue();
+    info.bit_depth_chroma_minus8 = (int) reader.ue();
+    return reader.ok() && info.chroma_format_idc <= 3 && info.bit_depth_luma_minus8 <= 7 &&
+           info.bit_depth_chroma_minus8 <= 7;
+}
+
+static void append_be16(std::vector<uint8_t> &body, size_t value) {
+    body.push_back((value >> 8) & 0xFF);
+    body.push_back(value & 0xFF);
+}
+
+static void append_hevc_nal_array(std::vector<uint8_t> &body, int nal_type, const std::vector<uint8_t> &nal) {
+    body.push_back(0x80 | nal_type);  // array_completeness=1
+    append_be16(body, 1);             // numNalus
+    append_be16(body, nal.size());
+    body.insert(body.end(), nal.begin(), nal.end());
+}
+
+int build_video_sequence_header(int codec, const std::vector<uint8_t> &vps, const std::vector<uint8_t> &sps,
+                                const std::vector<uint8_t> &pps, std::vector<uint8_t> &body) {
+    body.clear();
+    if (codec != RTMP_VIDEO_CODEC_HEVC) {
+        if (sps.size() < 4 || pps.empty()) return -1;
+        body.reserve(5 + 11 + sps.size() + pps.size());
+        body.push_back(0x17); // keyframe + AVC
+        body.push_back(0x00); // AVC sequence header
+        body.push_back(0x00); body.push_back(0x00); body.push_back(0x00); // composition time
+
+        // AVCDecoderConfigurationRecord
+        body.push_back(0x01); // version
+        body.push_back(sps[1]); // profile
+        body.push_back(sps[2]); // compat
+        body.push_back(sps[3]); // level
+        body.push_back(0xFF); // 4 bytes length
+        body.push_back(0xE1); // 1 sps
+        append_be16(body, sps.size());
+        body.insert(body.end(), sps.begin(), sps.end());
+        body.push_back(0x01); // 1 pps
+        append_be16(body, pps.size());
+        body.insert(body.end(), pps.begin(), pps.end());
+        return (int) body.size();
+    }
+
+    HevcSpsInfo info;
+    if (vps.empty() || pps.empty() || !parse_hevc_sps(sps, info)) {
+        LOGE("无法构建 HEVC 序列头: VPS size=%zu, SPS size=%zu, PPS size=%zu", vps.size(), sps.size(), pps.size());
+        return -1;
+    }
+    body.reserve(5 + 23 + 3 * 5 + vps.size() + sps.size() + pps.size());
+    body.push_back(0x80 | 0x10 | 0x00); // ex header + keyframe + SequenceStart
+    body.resize(5);
+    write_be32(body.data() + 1, FLV_FOURCC_HVC1);
+
+    // HEVCDecoderConfigurationRecord（ISO/IEC 14496-15 8.3.3.1）
+    body.push_back(0x01); // configurationVersion
+    body.insert(body.end(), info.profile_tier_level, info.profile_tier_level + sizeof(info.profile_tier_level));
+    body.push_back(0xF0); body.push_back(0x00); // min_spatial_segmentation_idc = 0
+    body.push_back(0xFC); // parallelismType = 0
+    body.push_back(0xFC | info.chroma_format_idc);
+    body.push_back(0xF8 | info.bit_depth_luma_minus8);
+    body.push_back(0xF8 | info.bit_depth_chroma_minus8);
+    append_be16(body, 0); // avgFrameRate 未指定
+    // constantFrameRate=0, numTemporalLayers, temporalIdNested, lengthSizeMinusOne=3
+    body.push_back(((info.max_sub_layers_minus1 + 1) << 3) | (info.temporal_id_nesting << 2) | 0x03);
+    body.push_back(3); // numOfArrays
+    append_hevc_nal_array(body, 32, vps);
+    append_hevc_nal_array(body, 33, sps);
+    append_hevc_nal_array(body, 34, pps);
+    return (int) body.size();
+}
+
+static int aac_sample_rate_index(int sample_rate) {
+    switch (sample_rate) {
+        case 96000: return 0;
+        case 88200: return 1;
+        case 64000: return 2;
+        case 48000: return 3;
+        case 44100: return 4;
+        case 32000: return 5;
+        case 24000: return 6;
+        case 22050: return 7;
+        case 16000: return 8;
+        case 12000: return 9;
+        case 11025: return 10;
+        case 8000:  return 11;
+        case 7350:  return 12;
+        default:    return 4; // default 44.1k
+    }
+}
+
+static uint8_t aac_audio_tag_header(int sample_rate, int channels) {
+    int sample_index = aac_sample_rate_index(sample_rate);
+    // SoundFormat(4)=10(AAC), SoundRate(2), SoundSize(1)=1(16bit), SoundType(1)=mono/stereo
+    uint8_t audio_header = (10 << 4) | (sample_index >= 6 ? 0x2 : 0x3) << 2; // rate encoded below
+    audio_header |= 0x2; // 16 bit
+    audio_header |= (channels == 1 ? 0x0 : 0x1);
+    return audio_header;
+}
+
+static int opus_ex_header(int packet_type, uint8_t *header) {
+    header[0] = (9 << 4) | packet_type; // SoundFormat=9(ExHeader) + AudioPacketType
+    write_be32(header + 1, FLV_FOURCC_OPUS);
+    return 5;
+}
+
+int build_audio_frame_header(int codec, int sample_rate, int channels, uint8_t *header) {
+    if (codec == RTMP_AUDIO_CODEC_OPUS) {
+        return opus_ex_header(1, header); // CodedFrames
+    }
+    header[0] = aac_audio_tag_header(sample_rate, channels);
+    header[1] = 0x01; // AAC raw
+    return 2;
+}
+
+int build_audio_sequence_header(int codec, int sample_rate, int channels, uint8_t *body, size_t capacity) {
+    if (codec == RTMP_AUDIO_CODEC_OPUS) {
+        const size_t size = 5 + 19;
+        if (capacity < size) return -1;
+        int idx = opus_ex_header(0, body); // SequenceStart
+        // OpusHead：多字节字段为小端序
+        memcpy(body + idx, "OpusHead", 8);
+        idx += 8;
+        body[idx++] = 0x01; // version
+        body[idx++] = (uint8_t) (channels > 1 ? 2 : 1);
+        const uint16_t pre_skip = 312; // libopus 在 48kHz 下的编码延迟（6.5ms）
+        body[idx++] = pre_skip & 0xFF;
+        body[idx++] = pre_skip >> 8;
+        for (int i = 0; i < 4; ++i) body[idx++] = ((uint32_t) sample_rate >> (8 * i)) & 0xFF; // input sample rate
+        body[idx++] = 0x00; body[idx++] = 0x00; // output gain
+        body[idx++] = 0x00; // channel mapping family 0
+        return idx;
+    }
+
+    if (capacity < 4) return -1;
+    int sample_index = aac_sample_rate_index(sample_rate);
+    int profile = 2; // AAC LC
+    body[0] = aac_audio_tag_header(sample_rate, channels);
+    body[1] = 0x00; // AAC sequence header
+    body[2] = (profile << 3) | ((sample_index & 0x0E) >> 1);
+    body[3] = ((sample_index & 0x01) << 7) | (channels << 3);
+    return 4;
+}
+
+int build_on_metadata_body(char *body, size_t capacity, int width, int height, int video_bitrate, int fps,
+                           int audio_sample_rate, int audio_channels, int video_codec, int audio_codec,
+                           int audio_bitrate) {
+    char *p = body;
+    char *pend = body + capacity;
+
+    // AMF0 encode: "@setDataFrame"
+    AVal method;
+    method.av_val = (char *)"@setDataFrame";
+    method.av_len = strlen(method.av_val);
+    p = AMF_EncodeString(p, pend, &method);
+    if (p == nullptr) {
+        LOGE("编码 @setDataFrame 失败");
+        return -1;
+    }
+
+    // AMF0 encode: "onMetaData"
+    AVal on_metadata;
+    on_metadata.av_val = (char *)"onMetaData";
+    on_metadata.av_len = strlen(on_metadata.av_val);
+    p = AMF_EncodeString(p, pend, &on_metadata);
+    if (p == nullptr) {
+        LOGE("编码 onMetaData 失败");
+        return -1;
+    }
+
+    // 手动编码 ECMA Array，避免使用 AMF_AddProp 导致的内存问题
+    if (p + 5 >= pend) return -1;
+    *p++ = AMF_ECMA_ARRAY; // ECMA Array 类型
+    
+    // 写入属性数量（12 个）
+    uint32_t count = 12;
+    *p++ = (count >> 24) & 0xFF;
+    *p++ = (count >> 16) & 0xFF;
+    *p++ = (count >> 8) & 0xFF;
+    *p++ = count & 0xFF;
+
+    // 辅助函数：手动编码 AMF 数字属性
+    auto encode_number = [&](const char *name, double value) -> bool {
+        int name_len = strlen(name);
+        if (p + 2 + name_len + 9 >= pend) return -1;
+        
+        // 写入名称长度和名称
+        *p++ = (name_len >> 8) & 0xFF;
+        *p++ = name_len & 0xFF;
+        memcpy(p, name, name_len);
+        p += name_len;
+        
+        // 写入 AMF NUMBER 类型和值
+        p = AMF_EncodeNumber(p, pend, value);
+        return p != nullptr;
+    };
+    
+    // 辅助函数：手动编码 AMF 布尔属性
+    auto encode_boolean = [&](const char *name, bool value) -> bool {
+        int name_len = strlen(name);
+        if (p + 2 + name_len + 2 >= pend) return -1;
+        
+        // 写入名称长度和名称
+        *p++ = (name_len >> 8) & 0xFF;
+        *p++ = name_len & 0xFF;
+        memcpy(p, name, name_len);
+        p += name_len;
+        
+        // 写入 AMF BOOLEAN 类型和值
+        p = AMF_EncodeBoolean(p, pend, value);
+        return p != nullptr;
+    };
+
+    // 编码所有属性
+    if (!encode_number("width", (double)width)) { LOGE("编码 width 失败"); return -1; }
+    if (!encode_number("height", (double)height)) { LOGE("编码 height 失败"); return -1; }
+    double video_codec_id = video_codec == RTMP_VIDEO_CODEC_HEVC ? (double) FLV_FOURCC_HVC1 : 7.0;
+    if (!encode_number("videocodecid", video_codec_id)) { LOGE("编码 videocodecid 失败"); return -1; }
+    if (!encode_number("videodatarate", (double)video_bitrate / 1000.0)) { LOGE("编码 videodatarate 失败"); return -1; }
+    if (!encode_number("framerate", (double)fps)) { LOGE("编码 framerate 失败"); return -1; }
+    double audio_codec_id = audio_codec == RTMP_AUDIO_CODEC_OPUS ? (double) FLV_FOURCC_OPUS : 10.0;
+    if (!encode_number("audiocodecid", audio_codec_id)) { LOGE("编码 audiocodecid 失败"); return -1; }
+    if (!encode_number("audiodatarate", (double) audio_bitrate / 1000.0)) { LOGE("编码 audiodatarate 失败"); return -1; }
+    if (!encode_number("audiosamplerate", (double)audio_sample_rate)) { LOGE("编码 audiosamplerate 失败"); return -1; }
+    if (!encode_number("audiosamplesize", 16.0)) { LOGE("编码 audiosamplesize 失败"); return -1; }
+    if (!encode_boolean("stereo", audio_channels > 1)) { LOGE("编码 stereo 失败"); return -1; }
+    if (!encode_number("duration", 0.0)) { LOGE("编码 duration 失败"); return -1; }
+    if (!encode_number("filesize", 0.0)) { LOGE("编码 filesize 失败"); return -1; }
+
+    // 写入 ECMA Array 结束标记（3 字节：0x00 0x00 0x09）
+    if (p + 3 >= pend) { LOGE("缓冲区不足"); return -1; }
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x09; // AMF_OBJECT_END
+
+    return (int) (p - body);
+}
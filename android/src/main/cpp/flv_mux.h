@@ -0,0 +1,95 @@
+#ifndef FLV_MUX_H
+#define FLV_MUX_H
+
+#include "rtmp_wrapper.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * FLV tag body 构建（不涉及网络与连接状态，便于在主机上单独测试和压测）
+ */
+
+// Enhanced RTMP 中 HEVC 的 FourCC（'hvc1'），onMetaData 的 videocodecid 也使用该值
+#define FLV_FOURCC_HVC1 0x68766331u
+// Enhanced RTMP 中 Opus 的 FourCC（'Opus'），onMetaData 的 audiocodecid 也使用该值
+#define FLV_FOURCC_OPUS 0x4F707573u
+
+// 音频 tag 头的最大长度（Enhanced RTMP 扩展头 1 字节 + FourCC）
+#define FLV_AUDIO_HEADER_MAX 5
+
+/**
+ * 从 pos 起查找下一个非空 NALU；找到时 pos 移到其后的起始码（或末尾），没有更多起始码返回 false
+ * @param nal_start 输出 NALU（不含起始码）的起始偏移
+ * @param nal_size 输出 NALU 字节数
+ */
+bool annexb_next_nal(const uint8_t *data, int size, int &pos, int &nal_start, int &nal_size);
+
+/**
+ * 从 Annex-B 数据中提取 SPS/PPS（找到时覆盖输出参数）
+ */
+void parse_sps_pps(const uint8_t *data, int size, std::vector<uint8_t> &sps, std::vector<uint8_t> &pps);
+
+/**
+ * 按编码从 Annex-B 数据中提取参数集（找到时覆盖输出参数）：
+ * H.264 为 SPS(7)/PPS(8)，HEVC 为 VPS(32)/SPS(33)/PPS(34)；H.264 不输出 vps
+ */
+void parse_parameter_sets(const uint8_t *data, int size, int codec, std::vector<uint8_t> &vps,
+                          std::vector<uint8_t> &sps, std::vector<uint8_t> &pps);
+
+/**
+ * Annex-B 数据中是否含有图像 slice（H.264 NAL 类型 1~5，HEVC VCL 类型 0~31），只含参数集/SEI 时返回 false
+ */
+bool annexb_has_slice(const uint8_t *data, int size, int codec);
+
+/**
+ * Annex-B 帧转换为 FLV AVC NALU tag body（5 字节视频头 + 4 字节长度前缀的 NALU），跳过 SPS/PPS
+ * @param body 输出，会先清空
+ * @return 写入的 NALU 个数
+ */
+int annexb_to_avc_body(const uint8_t *data, int size, bool is_key, std::vector<uint8_t> &body);
+
+/**
+ * 按编码转换 Annex-B 帧，跳过参数集。HEVC 使用 Enhanced RTMP 扩展头：
+ * IsExHeader | FrameType | PacketType=CodedFramesX（无 composition time）+ FourCC，同样是 5 字节
+ * @param body 输出，会先清空
+ * @return 写入的 NALU 个数
+ */
+int annexb_to_video_body(const uint8_t *data, int size, bool is_key, int codec, std::vector<uint8_t> &body);
+
+/**
+ * 构建视频序列头 tag body：H.264 为 AVCDecoderConfigurationRecord，
+ * HEVC 为 Enhanced RTMP SequenceStart + HEVCDecoderConfigurationRecord（profile/level/色度/位深取自 SPS）
+ * @param body 输出，会先清空
+ * @return body 字节数，参数集缺失或 SPS 无法解析返回 -1
+ */
+int build_video_sequence_header(int codec, const std::vector<uint8_t> &vps, const std::vector<uint8_t> &sps,
+                                const std::vector<uint8_t> &pps, std::vector<uint8_t> &body);
+
+/**
+ * 写入音频帧的 tag 头：AAC 为 SoundFormat/Rate/Size/Type + AACPacketType=raw（2 字节），
+ * Opus 为 Enhanced RTMP 扩展头 SoundFormat=ExHeader | PacketType=CodedFrames + FourCC（5 字节）
+ * @param header 输出，至少 FLV_AUDIO_HEADER_MAX 字节
+ * @return 头部字节数
+ */
+int build_audio_frame_header(int codec, int sample_rate, int channels, uint8_t *header);
+
+/**
+ * 构建音频序列头 tag body：AAC 为 AudioSpecificConfig（AAC-LC，采样率取自索引表），
+ * Opus 为 SequenceStart + OpusHead（RFC 7845 5.1，映射族 0，最多 2 声道）
+ * @return body 字节数，缓冲区不足返回 -1
+ */
+int build_audio_sequence_header(int codec, int sample_rate, int channels, uint8_t *body, size_t capacity);
+
+/**
+ * 编码 @setDataFrame + onMetaData 的 AMF0 数据
+ * @param video_codec 见 rtmp_video_codec，决定 videocodecid（H.264 为 7，HEVC 为 FourCC 'hvc1'）
+ * @param audio_codec 见 rtmp_audio_codec，决定 audiocodecid（AAC 为 10，Opus 为 FourCC 'Opus'）
+ * @param audio_bitrate 音频码率（bps），写入 audiodatarate
+ * @return body 字节数，缓冲区不足返回 -1
+ */
+int build_on_metadata_body(char *body, size_t capacity, int width, int height, int video_bitrate, int fps,
+                           int audio_sample_rate, int audio_channels, int video_codec = RTMP_VIDEO_CODEC_H264,
+                           int audio_codec = RTMP_AUDIO_CODEC_AAC, int audio_bitrate = 64000);
+
+#endif // FLV_MUX_H
@@ -0,0 +1,445 @@
+#include "flv_recorder.h"
+#include "bb_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define TAG "FlvRecorder"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+// FLV 文件头（9 字节）+ PreviousTagSize0（4 字节）；flags 在关闭时按实际音视频回填
+static const uint8_t kFlvHeader[13] = {'F', 'L', 'V', 0x01, 0x05, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00};
+static const long kFlvHeaderFlagsOffset = 4;
+
+static const size_t kFlushBytes = 256 * 1024;            // 攒够该大小再写，保证大块顺序写
+static const int kFlushIntervalMs = 200;                 // 数据不足时最长等待时间
+static const size_t kMaxQueuedBytes = 32 * 1024 * 1024;  // 队列上限，超过后丢弃录制数据
+static const size_t kDefaultBlockSize = 4096;
+static const size_t kMaxBlockSize = 1024 * 1024;
+
+FlvTag::FlvTag(RTMPPacket *src) {
+    packet = *src;
+    src->m_body = nullptr;
+}
+
+FlvTag::~FlvTag() {
+    RTMPPacket_Free(&packet);
+}
+
+bool FlvTag::is_video_keyframe() const {
+    return packet.m_packetType == RTMP_PACKET_TYPE_VIDEO && packet.m_nBodySize > 0 &&
+           ((body()[0] >> 4) & 0x07) == 1;  // Enhanced RTMP 扩展头的最高位为 IsExHeader
+}
+
+bool FlvTag::is_sequence_header() const {
+    // AVC sequence header: 0x17 0x00；HEVC（Enhanced RTMP）: 0x90 'hvc1'；AAC sequence header: 0xAx 0x00；Opus: 0x90 'Opus'
+    if (packet.m_nBodySize < 2) return false;
+    if (packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) {
+        if (body()[0] & 0x80) return is_video_keyframe() && (body()[0] & 0x0F) == 0x00;
+        return is_video_keyframe() && body()[1] == 0x00;
+    }
+    if (packet.m_packetType == RTMP_PACKET_TYPE_AUDIO) {
+        if ((body()[0] >> 4) == 9) return (body()[0] & 0x0F) == 0x00;  // Enhanced RTMP SequenceStart
+        return (body()[0] >> 4) == 10 && body()[1] == 0x00;
+    }
+    return false;
+}
+
+static void write_be24(uint8_t *dst, uint32_t val) {
+    dst[0] = (val >> 16) & 0xFF;
+    dst[1] = (val >> 8) & 0xFF;
+    dst[2] = val & 0xFF;
+}
+
+static void write_be32(uint8_t *dst, uint32_t val) {
+    dst[0] = (val >> 24) & 0xFF;
+    dst[1] = (val >> 16) & 0xFF;
+    dst[2] = (val >> 8) & 0xFF;
+    dst[3] = val & 0xFF;
+}
+
+static void write_be_double(uint8_t *dst, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 7; i >= 0; --i) {
+        dst[i] = bits & 0xFF;
+        bits >>= 8;
+    }
+}
+
+// 在 onMetaData 中查找数字属性的值偏移（name 长度 + name + AMF_NUMBER 标记之后）
+static long find_amf_number(const uint8_t *body, uint32_t size, const char *name) {
+    size_t name_len = strlen(name);
+    for (uint32_t i = 0; i + 2 + name_len + 9 <= size; ++i) {
+        if (body[i] == ((name_len >> 8) & 0xFF) && body[i + 1] == (name_len & 0xFF) &&
+            memcmp(body + i + 2, name, name_len) == 0 && body[i + 2 + name_len] == AMF_NUMBER) {
+            return (long) (i + 2 + name_len + 1);
+        }
+    }
+    return -1;
+}
+
+FlvRecorder::FlvRecorder(const std::string &path, long max_segment_bytes, int max_segment_duration_ms)
+        : path_(path),
+          max_segment_bytes_(max_segment_bytes),
+          max_segment_duration_ms_(max_segment_duration_ms) {
+}
+
+FlvRecorder::~FlvRecorder() {
+    stop();
+}
+
+bool FlvRecorder::start() {
+    if (started_) return true;
+    if (!open_segment()) return false;
+    started_ = true;
+    io_thread_ = std::thread(&FlvRecorder::io_loop, this);
+    LOGD("开始录制: %s (max_bytes=%ld, max_duration_ms=%d)",
+         segment_path(segment_index_).c_str(), max_segment_bytes_, max_segment_duration_ms_);
+    return true;
+}
+
+void FlvRecorder::submit(const FlvTagRef &tag) {
+    if (!tag) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        bool is_header = tag->type() == RTMP_PACKET_TYPE_INFO || tag->is_sequence_header();
+        if (!is_header) {
+            bool is_video = tag->type() == RTMP_PACKET_TYPE_VIDEO;
+            // 磁盘跟不上时丢弃录制数据，绝不阻塞发送线程；视频丢帧后需等待下一个关键帧
+            if (queued_bytes_ + tag->size() > kMaxQueuedBytes ||
+                (is_video && drop_video_until_keyframe_ && !tag->is_video_keyframe())) {
+                if (is_video) drop_video_until_keyframe_ = true;
+                dropped_tags_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (is_video && tag->is_video_keyframe()) drop_video_until_keyframe_ = false;
+        }
+        queue_.push_back(tag);
+        queued_bytes_ += tag->size();
+        if (queued_bytes_ < kFlushBytes) return;
+    }
+    cond_.notify_one();
+}
+
+void FlvRecorder::stop() {
+    if (!started_) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+    started_ = false;
+    LOGD("停止录制: segments=%d, written=%ld, dropped=%ld",
+         segment_index_ + 1, written_bytes(), dropped_tags());
+}
+
+void FlvRecorder::io_loop() {
+    std::deque<FlvTagRef> batch;
+    while (true) {
+        bool exiting;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, std::chrono::milliseconds(kFlushIntervalMs), [this] {
+                return stopping_ || queued_bytes_ >= kFlushBytes;
+            });
+            batch.swap(queue_);
+            queued_bytes_ = 0;
+            exiting = stopping_;
+        }
+        for (const FlvTagRef &tag : batch) {
+            write_tag(tag);
+        }
+        batch.clear();
+        flush_pending();
+        if (exiting) break;
+    }
+    finalize_segment();
+}
+
+std::string FlvRecorder::segment_path(int index) const {
+    if (max_segment_bytes_ <= 0 && max_segment_duration_ms_ <= 0) {
+        return path_;
+    }
+    std::string stem = path_;
+    if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".flv") == 0) {
+        stem.resize(stem.size() - 4);
+    }
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%04d.flv", index);
+    return stem + suffix;
+}
+
+bool FlvRecorder::open_segment() {
+    std::string file = segment_path(segment_index_);
+    fd_ = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOGE("打开录制文件失败: %s, errno=%d", file.c_str(), errno);
+        set_failed();
+        return false;
+    }
+    if (write(fd_, kFlvHeader, sizeof(kFlvHeader)) != (ssize_t) sizeof(kFlvHeader)) {
+        LOGE("写入 FLV 文件头失败: %s, errno=%d", file.c_str(), errno);
+        close(fd_);
+        fd_ = -1;
+        set_failed();
+        return false;
+    }
+    struct stat st;
+    block_size_ = fstat(fd_, &st) == 0 && st.st_blksize >= 512 && (size_t) st.st_blksize <= kMaxBlockSize
+                  ? (size_t) st.st_blksize : kDefaultBlockSize;
+    segment_bytes_ = sizeof(kFlvHeader);
+    file_offset_ = sizeof(kFlvHeader);
+    segment_has_media_ = false;
+    segment_has_audio_ = false;
+    segment_has_video_ = false;
+    segment_base_ts_ = 0;
+    segment_last_ts_ = 0;
+    duration_offset_ = -1;
+    filesize_offset_ = -1;
+    written_bytes_.fetch_add(sizeof(kFlvHeader), std::memory_order_relaxed);
+    return true;
+}
+
+void FlvRecorder::finalize_segment() {
+    if (fd_ < 0) return;
+    flush_pending(true);
+
+    uint8_t flags = (segment_has_audio_ ? 0x04 : 0x00) | (segment_has_video_ ? 0x01 : 0x00);
+    if (flags == 0) flags = 0x05;
+    bool ok = backfill(&flags, 1, kFlvHeaderFlagsOffset);
+
+    uint8_t number[8];
+    if (ok && duration_offset_ > 0) {
+        write_be_double(number, segment_last_ts_ / 1000.0);
+        ok = backfill(number, sizeof(number), duration_offset_);
+    }
+    if (ok && filesize_offset_ > 0) {
+        write_be_double(number, (double) segment_bytes_);
+        ok = backfill(number, sizeof(number), filesize_offset_);
+    }
+    if (!ok) {
+        LOGE("回填文件头失败: %s, errno=%d", segment_path(segment_index_).c_str(), errno);
+        set_failed();
+    }
+    fdatasync(fd_);
+    close(fd_);
+    fd_ = -1;
+    LOGD("录制文件已完成: %s, size=%ld, duration=%ums", segment_path(segment_index_).c_str(),
+         segment_bytes_, segment_last_ts_);
+}
+
+bool FlvRecorder::backfill(const void *data, size_t len, long offset) {
+    ssize_t n;
+    do {
+        n = pwrite(fd_, data, len, offset);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t) len;
+}
+
+void FlvRecorder::set_failed() {
+    failed_ = true;
+    error_.store(true, std::memory_order_relaxed);
+}
+
+bool FlvRecorder::should_rotate(uint32_t timestamp) const {
+    if (!segment_has_media_) return false;
+    if (max_segment_bytes_ > 0 && segment_bytes_ >= max_segment_bytes_) return true;
+    if (max_segment_duration_ms_ > 0 &&
+        timestamp - segment_base_ts_ >= (uint32_t) max_segment_duration_ms_) {
+        return true;
+    }
+    return false;
+}
+
+uint32_t FlvRecorder::rebase(uint32_t timestamp) const {
+    // 每个文件的时间戳从 0 开始；首个媒体 tag 之前的 header 一律写 0
+    if (!segment_has_media_ || timestamp < segment_base_ts_) return 0;
+    return timestamp - segment_base_ts_;
+}
+
+void FlvRecorder::write_tag(const FlvTagRef &tag) {
+    if (failed_) return;
+
+    if (tag->type() == RTMP_PACKET_TYPE_INFO) {
+        metadata_ = tag;
+        append(tag, segment_last_ts_);
+        return;
+    }
+    if (tag->is_sequence_header()) {
+        if (tag->type() == RTMP_PACKET_TYPE_VIDEO) {
+            video_config_ = tag;
+        } else {
+            audio_config_ = tag;
+        }
+        append(tag, rebase(tag->timestamp()));
+        return;
+    }
+
+    bool is_video = tag->type() == RTMP_PACKET_TYPE_VIDEO;
+    if (is_video) {
+        if (waiting_keyframe_ && !tag->is_video_keyframe()) return;
+        waiting_keyframe_ = false;
+    } else if (video_config_ && waiting_keyframe_) {
+        // 有视频时从首个关键帧开始录，避免文件开头只有声音
+        return;
+    }
+
+    // 有视频时只在关键帧处切分，保证每个文件都能独立解码
+    bool rotate_point = is_video ? tag->is_video_keyframe() : !video_config_;
+    if (rotate_point && should_rotate(tag->timestamp())) {
+        finalize_segment();
+        segment_index_++;
+        if (!open_segment()) return;
+        if (metadata_) append(metadata_, 0);
+        if (video_config_) append(video_config_, 0);
+        if (audio_config_) append(audio_config_, 0);
+    }
+
+    if (!segment_has_media_) {
+        segment_has_media_ = true;
+        segment_base_ts_ = tag->timestamp();
+    }
+    append(tag, rebase(tag->timestamp()));
+}
+
+void FlvRecorder::append(const FlvTagRef &tag, uint32_t ts) {
+    if (fd_ < 0) return;
+    if (pending_count_ == kMaxBatchTags) {
+        if (!flush_pending()) return;
+        // 块边界之后的零头仍占满批次（大量小 tag）：整批写出
+        if (pending_count_ == kMaxBatchTags && !flush_pending(true)) return;
+    }
+
+    if (ts > segment_last_ts_) segment_last_ts_ = ts;
+    if (tag->type() == RTMP_PACKET_TYPE_VIDEO) segment_has_video_ = true;
+    if (tag->type() == RTMP_PACKET_TYPE_AUDIO) segment_has_audio_ = true;
+
+    // 记录本文件首个 onMetaData 中 duration/filesize 的位置，关闭时回填
+    if (tag->type() == RTMP_PACKET_TYPE_INFO && duration_offset_ < 0) {
+        long duration = find_amf_number(tag->body(), tag->size(), "duration");
+        long filesize = find_amf_number(tag->body(), tag->size(), "filesize");
+        if (duration >= 0) duration_offset_ = segment_bytes_ + 11 + duration;
+        if (filesize >= 0) filesize_offset_ = segment_bytes_ + 11 + filesize;
+    }
+
+    PendingTag &pending = pending_[pending_count_++];
+    pending.tag = tag;
+    pending.written = 0;
+    pending.header[0] = tag->type();
+    write_be24(pending.header + 1, tag->size());
+    write_be24(pending.header + 4, ts & 0xFFFFFF);
+    pending.header[7] = (ts >> 24) & 0xFF;
+    write_be24(pending.header + 8, 0);
+    write_be32(pending.trailer, 11 + tag->size());
+    segment_bytes_ += 11 + tag->size() + 4;
+}
+
+bool FlvRecorder::flush_pending(bool final) {
+    if (pending_count_ == 0) return true;
+    if (fd_ < 0) {
+        for (int i = 0; i < pending_count_; ++i) pending_[i].tag.reset();
+        pending_count_ = 0;
+        return false;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < pending_count_; ++i) {
+        total += sizeof(pending_[i].header) + pending_[i].tag->size() + sizeof(pending_[i].trailer) - pending_[i].written;
+    }
+    // 只写到块边界；不足一块时留到下一批，除非批次已满
+    size_t len = total;
+    if (!final) {
+        size_t aligned_end = (size_t) (file_offset_ + total) / block_size_ * block_size_;
+        if (aligned_end > (size_t) file_offset_) {
+            len = aligned_end - (size_t) file_offset_;
+        } else if (pending_count_ < kMaxBatchTags) {
+            return true;
+        }
+    }
+
+    // header / body / trailer 直接指向发送路径的缓冲区，一次 writev 批量写出
+    struct iovec iov[kMaxBatchTags * 3];
+    int iov_count = 0;
+    size_t budget = len;
+    for (int i = 0; i < pending_count_ && budget > 0; ++i) {
+        PendingTag &pending = pending_[i];
+        struct iovec parts[3] = {
+                {pending.header, sizeof(pending.header)},
+                {pending.tag->packet.m_body, pending.tag->size()},
+                {pending.trailer, sizeof(pending.trailer)},
+        };
+        size_t skip = pending.written;
+        for (struct iovec &part : parts) {
+            if (budget == 0) break;
+            if (skip >= part.iov_len) {
+                skip -= part.iov_len;
+                continue;
+            }
+            size_t n = std::min(part.iov_len - skip, budget);
+            iov[iov_count].iov_base = static_cast<uint8_t *>(part.iov_base) + skip;
+            iov[iov_count++].iov_len = n;
+            budget -= n;
+            skip = 0;
+        }
+    }
+
+    struct iovec *cur = iov;
+    int remaining = iov_count;
+    bool ok = true;
+    while (remaining > 0) {
+        ssize_t n = writev(fd_, cur, remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOGE("写入录制文件失败: errno=%d", errno);
+            ok = false;
+            break;
+        }
+        while (remaining > 0 && (size_t) n >= cur->iov_len) {
+            n -= cur->iov_len;
+            ++cur;
+            --remaining;
+        }
+        if (remaining > 0) {
+            cur->iov_base = static_cast<uint8_t *>(cur->iov_base) + n;
+            cur->iov_len -= n;
+        }
+    }
+
+    if (!ok) {
+        for (int i = 0; i < pending_count_; ++i) pending_[i].tag.reset();
+        pending_count_ = 0;
+        set_failed();
+        return false;
+    }
+    // 释放已完整写出的 tag，未写完的（块边界之后的零头）移到队首
+    size_t consumed = len;
+    int kept = 0;
+    for (int i = 0; i < pending_count_; ++i) {
+        PendingTag &pending = pending_[i];
+        size_t left = sizeof(pending.header) + pending.tag->size() + sizeof(pending.trailer) - pending.written;
+        size_t n = std::min(left, consumed);
+        consumed -= n;
+        pending.written += n;
+        if (n == left) {
+            pending.tag.reset();
+        } else {
+            if (kept != i) pending_[kept] = std::move(pending);
+            ++kept;
+        }
+    }
+    pending_count_ = kept;
+    file_offset_ += (long) len;
+    written_bytes_.fetch_add((long) len, std::memory_order_relaxed);
+    return true;
+}
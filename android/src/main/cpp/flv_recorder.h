@@ -0,0 +1,135 @@
+#ifndef FLV_RECORDER_H
+#define FLV_RECORDER_H
+
+#include "librtmp/rtmp.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * 发送路径构建的 FLV tag。接管 RTMPPacket 的 body，发送与录制共享同一块缓冲区，
+ * 最后一个持有者释放时才调用 RTMPPacket_Free。
+ */
+struct FlvTag {
+    RTMPPacket packet;
+
+    // 接管 src->m_body，之后对 src 调用 RTMPPacket_Free 为空操作
+    explicit FlvTag(RTMPPacket *src);
+    ~FlvTag();
+
+    uint8_t type() const { return packet.m_packetType; }
+    uint32_t size() const { return packet.m_nBodySize; }
+    uint32_t timestamp() const { return packet.m_nTimeStamp; }
+    const uint8_t *body() const { return reinterpret_cast<const uint8_t *>(packet.m_body); }
+
+    bool is_video_keyframe() const;
+    bool is_sequence_header() const;
+
+    FlvTag(const FlvTag &) = delete;
+    FlvTag &operator=(const FlvTag &) = delete;
+};
+
+typedef std::shared_ptr<FlvTag> FlvTagRef;
+
+/**
+ * 本地 FLV 录制（合规留档）。发送线程只负责把 tag 引用入队，
+ * 由独立 I/O 线程批量 writev 写盘，磁盘慢时丢弃录制数据而不阻塞网络发送。
+ * 每次批量写都截止到文件系统块（st_blksize）边界，不足一块的尾部留到下一批，文件偏移与写入长度均按块对齐，
+ * 页缓存不必为半块写入先读后写；只有关闭文件时写出最后的零头。不使用 O_DIRECT：那需要把 tag 拷贝进对齐的
+ * 缓冲区，失去与发送路径共享 body 的意义。
+ * 支持按大小/时长切分文件，关闭时回填 FLV header 标志位与 onMetaData 的 duration/filesize。
+ */
+class FlvRecorder {
+public:
+    /**
+     * @param path 录制文件路径；开启切分时实际文件名为 <path 去掉 .flv>_<序号>.flv
+     * @param max_segment_bytes 单个文件最大字节数，<= 0 不按大小切分
+     * @param max_segment_duration_ms 单个文件最大时长（毫秒，按媒体时间戳），<= 0 不按时长切分
+     */
+    FlvRecorder(const std::string &path, long max_segment_bytes, int max_segment_duration_ms);
+    ~FlvRecorder();
+
+    // 打开首个文件并启动 I/O 线程
+    bool start();
+
+    // 入队一个 tag（发送线程调用，不做任何磁盘 I/O）
+    void submit(const FlvTagRef &tag);
+
+    // 写完队列中剩余数据、回填文件头后关闭
+    void stop();
+
+    long written_bytes() const { return written_bytes_.load(std::memory_order_relaxed); }
+    long dropped_tags() const { return dropped_tags_.load(std::memory_order_relaxed); }
+    // 写盘或关闭时回填文件头失败（之后的录制数据被丢弃，已完成的文件头可能不正确）
+    bool failed() const { return error_.load(std::memory_order_relaxed); }
+    int segment_count() const { return segment_index_ + 1; }
+
+private:
+    static const int kMaxBatchTags = 128;  // 单次 writev 最多 3 * 128 个 iovec
+
+    struct PendingTag {
+        FlvTagRef tag;
+        uint8_t header[11];
+        uint8_t trailer[4];
+        size_t written = 0;  // 已写出的字节数（header + body + trailer 按顺序计）
+    };
+
+    void io_loop();
+    void write_tag(const FlvTagRef &tag);
+    bool open_segment();
+    void finalize_segment();
+    bool backfill(const void *data, size_t len, long offset);
+    void set_failed();
+    void append(const FlvTagRef &tag, uint32_t ts);
+    uint32_t rebase(uint32_t timestamp) const;
+    // final 为 false 时只写到块边界，剩余部分留在 pending_ 中
+    bool flush_pending(bool final = false);
+    bool should_rotate(uint32_t timestamp) const;
+    std::string segment_path(int index) const;
+
+    std::string path_;
+    long max_segment_bytes_;
+    int max_segment_duration_ms_;
+
+    // 生产者/消费者队列
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<FlvTagRef> queue_;
+    size_t queued_bytes_ = 0;
+    bool stopping_ = false;
+    bool drop_video_until_keyframe_ = false;
+    std::thread io_thread_;
+    bool started_ = false;
+
+    // 以下仅在 I/O 线程访问
+    int fd_ = -1;
+    int segment_index_ = 0;
+    long segment_bytes_ = 0;
+    long file_offset_ = 0;        // 已写入当前文件的字节数
+    size_t block_size_ = 4096;
+    bool segment_has_media_ = false;
+    bool segment_has_audio_ = false;
+    bool segment_has_video_ = false;
+    uint32_t segment_base_ts_ = 0;
+    uint32_t segment_last_ts_ = 0;
+    long duration_offset_ = -1;
+    long filesize_offset_ = -1;
+    bool waiting_keyframe_ = true;
+    bool failed_ = false;
+    FlvTagRef metadata_;
+    FlvTagRef video_config_;
+    FlvTagRef audio_config_;
+    PendingTag pending_[kMaxBatchTags];
+    int pending_count_ = 0;
+
+    std::atomic<long> written_bytes_{0};
+    std::atomic<long> dropped_tags_{0};
+    std::atomic<bool> error_{false};
+};
+
+#endif // FLV_RECORDER_H
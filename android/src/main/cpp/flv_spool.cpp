@@ -0,0 +1,241 @@
+#include "flv_spool.h"
+#include "bb_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TAG "FlvSpool"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static const long kPageSize = 4096;
+static const size_t kWriteBufferBytes = 256 * 1024;  // 攒满整块再写，保证大块顺序写
+static const size_t kReadBufferBytes = 256 * 1024;   // 排空时按块顺序预读
+static const long kMinCapacity = 1024 * 1024;
+
+static long page_round_up(long value) {
+    return (value + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+static uint8_t *alloc_aligned(size_t size) {
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, kPageSize, size) != 0) return nullptr;
+    return static_cast<uint8_t *>(ptr);
+}
+
+FlvSpool::FlvSpool(const std::string &path, long capacity_bytes)
+        : path_(path),
+          capacity_(page_round_up(std::max(capacity_bytes, kMinCapacity))) {
+}
+
+FlvSpool::~FlvSpool() {
+    if (fd_ >= 0) {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+    free(wbuf_);
+    free(rbuf_);
+}
+
+bool FlvSpool::open() {
+    wbuf_ = alloc_aligned(kWriteBufferBytes);
+    rbuf_ = alloc_aligned(kReadBufferBytes);
+    if (wbuf_ == nullptr || rbuf_ == nullptr) {
+        LOGE("分配缓存 I/O 缓冲区失败");
+        return false;
+    }
+    rbuf_cap_ = kReadBufferBytes;
+
+    int flags = O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    fd_ = ::open(path_.c_str(), flags | O_DIRECT, 0644);
+    direct_io_ = fd_ >= 0;
+    if (fd_ < 0 && errno != EINVAL) {
+        LOGE("打开缓存文件失败: %s, errno=%d", path_.c_str(), errno);
+        return false;
+    }
+#endif
+    if (fd_ < 0) {
+        // 文件系统不支持 O_DIRECT（如 tmpfs），回退到页缓存，I/O 仍保持页对齐
+        fd_ = ::open(path_.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+        LOGE("打开缓存文件失败: %s, errno=%d", path_.c_str(), errno);
+        return false;
+    }
+    if (ftruncate(fd_, capacity_) != 0) {
+        LOGE("预分配缓存文件失败: size=%ld, errno=%d", capacity_, errno);
+        close(fd_);
+        fd_ = -1;
+        unlink(path_.c_str());
+        return false;
+    }
+    posix_fadvise(fd_, 0, capacity_, POSIX_FADV_SEQUENTIAL);
+    LOGD("打开缓存文件: %s, capacity=%ld, direct_io=%d", path_.c_str(), capacity_, direct_io_);
+    return true;
+}
+
+/* 淘汰与 [begin, end) 重叠的最旧记录；环形顺序保证重叠的记录总在队首 */
+void FlvSpool::evict_range(long begin, long end) {
+    while (!index_.empty()) {
+        const Record &front = index_.front();
+        long front_end = front.offset + (long) kRecordHeaderSize + (long) front.size;
+        if (front.offset >= end || front_end <= begin) break;
+        backlog_bytes_ -= front.size;
+        evicted_records_++;
+        index_.pop_front();
+    }
+}
+
+/* 写出缓冲区（末尾不足一页的部分补齐整页写出，并保留在内存中继续追加） */
+bool FlvSpool::flush() {
+    if (wbuf_len_ == 0) return true;
+    size_t len = (size_t) page_round_up((long) wbuf_len_);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(fd_, wbuf_ + done, len - done, wbuf_off_ + (long) done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            LOGE("写缓存文件失败: offset=%ld, errno=%d", wbuf_off_ + (long) done, errno);
+            return false;
+        }
+        done += (size_t) n;
+    }
+    if (rbuf_len_ > 0 && rbuf_off_ < wbuf_off_ + (long) len && wbuf_off_ < rbuf_off_ + (long) rbuf_len_) {
+        rbuf_len_ = 0;
+    }
+    size_t full = wbuf_len_ & ~((size_t) kPageSize - 1);
+    if (full > 0) {
+        size_t tail = wbuf_len_ - full;
+        memmove(wbuf_, wbuf_ + full, tail);
+        wbuf_off_ += (long) full;
+        wbuf_len_ = tail;
+    }
+    return true;
+}
+
+bool FlvSpool::append(uint8_t type, bool keyframe, int64_t timestamp, const uint8_t *data, uint32_t size) {
+    long rec_len = (long) kRecordHeaderSize + (long) size;
+    if (fd_ < 0 || data == nullptr || size == 0 || rec_len > capacity_ / 2) return false;
+
+    long head = wbuf_off_ + (long) wbuf_len_;
+    if (head + rec_len > capacity_) {
+        // 回绕：文件尾剩余空间放不下整条记录，上一圈残留在尾部的记录最旧，先淘汰
+        if (!flush()) {
+            clear();
+            return false;
+        }
+        evict_range(head, capacity_);
+        wbuf_off_ = 0;
+        wbuf_len_ = 0;
+        head = 0;
+    }
+    // 按整页淘汰：flush 会补齐整页写出
+    evict_range(head, page_round_up(head + rec_len));
+
+    uint8_t header[kRecordHeaderSize];
+    memset(header, 0, sizeof(header));
+    header[0] = type;
+    header[1] = keyframe ? 1 : 0;
+    memcpy(header + 4, &size, sizeof(size));
+    memcpy(header + 8, &timestamp, sizeof(timestamp));
+
+    const uint8_t *parts[2] = {header, data};
+    size_t lens[2] = {sizeof(header), size};
+    for (int i = 0; i < 2; ++i) {
+        size_t copied = 0;
+        while (copied < lens[i]) {
+            size_t n = std::min(lens[i] - copied, kWriteBufferBytes - wbuf_len_);
+            memcpy(wbuf_ + wbuf_len_, parts[i] + copied, n);
+            wbuf_len_ += n;
+            copied += n;
+            if (wbuf_len_ == kWriteBufferBytes && !flush()) {
+                clear();
+                return false;
+            }
+        }
+    }
+
+    Record record;
+    record.type = type;
+    record.keyframe = keyframe;
+    record.timestamp = timestamp;
+    record.size = size;
+    record.offset = head;
+    index_.push_back(record);
+    backlog_bytes_ += size;
+    return true;
+}
+
+bool FlvSpool::read_disk(long offset, uint8_t *dst, size_t len) {
+    if (rbuf_len_ == 0 || offset < rbuf_off_ || offset + (long) len > rbuf_off_ + (long) rbuf_len_) {
+        long start = offset & ~(kPageSize - 1);
+        size_t need = (size_t) page_round_up(offset + (long) len - start);
+        size_t want = std::min(std::max(need, kReadBufferBytes), (size_t) (capacity_ - start));
+        if (want > rbuf_cap_) {
+            uint8_t *bigger = alloc_aligned(want);
+            if (bigger == nullptr) return false;
+            free(rbuf_);
+            rbuf_ = bigger;
+            rbuf_cap_ = want;
+        }
+        size_t done = 0;
+        while (done < want) {
+            ssize_t n = pread(fd_, rbuf_ + done, want - done, start + (long) done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += (size_t) n;
+        }
+        rbuf_off_ = start;
+        rbuf_len_ = done;
+        if (done < need) {
+            LOGE("读缓存文件失败: offset=%ld, len=%zu, errno=%d", offset, len, errno);
+            rbuf_len_ = 0;
+            return false;
+        }
+    }
+    memcpy(dst, rbuf_ + (offset - rbuf_off_), len);
+    return true;
+}
+
+bool FlvSpool::read_front(Record &record, std::vector<uint8_t> &payload) {
+    if (index_.empty()) return false;
+    record = index_.front();
+    payload.resize(record.size);
+
+    // 记录可能一部分已落盘、一部分仍在写缓冲中
+    long offset = record.offset + (long) kRecordHeaderSize;
+    long end = offset + (long) record.size;
+    long wbuf_end = wbuf_off_ + (long) wbuf_len_;
+    uint8_t *dst = payload.data();
+    while (offset < end) {
+        long chunk_end;
+        if (offset >= wbuf_off_ && offset < wbuf_end) {
+            chunk_end = std::min(end, wbuf_end);
+            memcpy(dst, wbuf_ + (offset - wbuf_off_), (size_t) (chunk_end - offset));
+        } else {
+            chunk_end = offset < wbuf_off_ ? std::min(end, wbuf_off_) : end;
+            if (!read_disk(offset, dst, (size_t) (chunk_end - offset))) return false;
+        }
+        dst += chunk_end - offset;
+        offset = chunk_end;
+    }
+    return true;
+}
+
+void FlvSpool::pop_front() {
+    if (index_.empty()) return;
+    backlog_bytes_ -= index_.front().size;
+    index_.pop_front();
+}
+
+void FlvSpool::clear() {
+    index_.clear();
+    backlog_bytes_ = 0;
+    wbuf_off_ = 0;
+    wbuf_len_ = 0;
+    rbuf_len_ = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef FLV_SPOOL_H
+#define FLV_SPOOL_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * 断网期间的磁盘缓存（store-and-forward）。固定容量的环形文件，按顺序追加音视频帧，
+ * 写满后淘汰最旧的帧。所有读写均为页对齐的大块顺序 I/O（优先 O_DIRECT，不支持时回退）。
+ * 非线程安全，由调用方加锁。
+ */
+class FlvSpool {
+public:
+    struct Record {
+        uint8_t type = 0;        // RTMP_PACKET_TYPE_AUDIO / RTMP_PACKET_TYPE_VIDEO
+        bool keyframe = false;
+        int64_t timestamp = 0;
+        uint32_t size = 0;       // 负载字节数（不含记录头）
+        long offset = 0;         // 记录头在文件中的偏移
+    };
+
+    /**
+     * @param path 缓存文件路径
+     * @param capacity_bytes 环形文件容量，按页向上取整
+     */
+    FlvSpool(const std::string &path, long capacity_bytes);
+    ~FlvSpool();
+
+    bool open();
+
+    // 追加一帧；空间不足时淘汰最旧的帧，单帧超过容量一半时拒绝
+    bool append(uint8_t type, bool keyframe, int64_t timestamp, const uint8_t *data, uint32_t size);
+
+    // 读取最旧一帧（不出队）
+    bool read_front(Record &record, std::vector<uint8_t> &payload);
+    void pop_front();
+    void clear();
+
+    bool empty() const { return index_.empty(); }
+    const Record &front() const { return index_.front(); }
+    long backlog_bytes() const { return backlog_bytes_; }
+    long backlog_records() const { return (long) index_.size(); }
+    long evicted_records() const { return evicted_records_; }
+    const std::string &path() const { return path_; }
+
+private:
+    static const size_t kRecordHeaderSize = 16;
+
+    bool flush();
+    void evict_range(long begin, long end);
+    bool read_disk(long offset, uint8_t *dst, size_t len);
+
+    std::string path_;
+    long capacity_;
+    int fd_ = -1;
+    bool direct_io_ = false;
+
+    std::deque<Record> index_;
+    long backlog_bytes_ = 0;
+    long evicted_records_ = 0;
+
+    // 写缓冲：覆盖文件 [wbuf_off_, wbuf_off_ + wbuf_len_)，wbuf_off_ 始终页对齐
+    uint8_t *wbuf_ = nullptr;
+    long wbuf_off_ = 0;
+    size_t wbuf_len_ = 0;
+
+    // 读缓冲：页对齐的预读窗口
+    uint8_t *rbuf_ = nullptr;
+    size_t rbuf_cap_ = 0;
+    long rbuf_off_ = 0;
+    size_t rbuf_len_ = 0;
+};
+
+#endif // FLV_SPOOL_H
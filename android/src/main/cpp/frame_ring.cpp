@@ -0,0 +1,208 @@
+#include "frame_ring.h"
+#include "bb_log.h"
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define TAG "FrameRing"
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static inline void store_max(std::atomic<uint64_t> &target, uint64_t value) {
+    if (value > target.load(std::memory_order_relaxed)) target.store(value, std::memory_order_relaxed);
+}
+
+static inline void add_relaxed(std::atomic<uint64_t> &target, uint64_t delta) {
+    target.store(target.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+FrameRing::FrameRing(size_t capacity, int max_frames) : max_frames_(max_frames) {
+    capacity_ = (capacity + 15) & ~(size_t) 15;
+    if (capacity_ == 0) return;
+    void *mem = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        LOGE("分配帧环失败: capacity=%zu", capacity_);
+        return;
+    }
+    // 预先触碰所有页，推流中写入时不再触发缺页
+    memset(mem, 0, capacity_);
+    data_ = static_cast<uint8_t *>(mem);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ < 0) LOGE("创建 eventfd 失败");
+}
+
+FrameRing::~FrameRing() {
+    if (data_ != nullptr) munmap(data_, capacity_);
+    if (event_fd_ >= 0) close(event_fd_);
+}
+
+long FrameRing::reserve(uint32_t size, bool is_key) {
+    if (!valid()) return -1;
+    uint64_t need = record_size(size);
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t pos = tail % capacity_;
+    bool wrap = pos + need > capacity_;
+    uint64_t total = wrap ? capacity_ - pos + need : need;
+
+    uint64_t published = published_frames_.load(std::memory_order_relaxed);
+    uint64_t consumed = consumed_frames_.load(std::memory_order_acquire);
+    uint64_t queued = published - std::max(consumed, discarded_upto_frames_);
+    bool over_count = max_frames_ > 0 && queued >= (uint64_t) max_frames_;
+    if (need > capacity_ || (over_count && !is_key) || tail + total - head > capacity_) {
+        add_relaxed(dropped_frames_, 1);
+        return -1;
+    }
+
+    pending_total_ = total;
+    pending_pos_ = pos;
+    pending_size_ = size;
+    pending_key_ = is_key;
+    pending_wrap_ = wrap;
+    // 关键帧可以独立解码：排队帧数已满时清空积压，保证其尽快发出（与原 Kotlin 队列策略一致）
+    pending_flushed_ = over_count ? (int) queued : 0;
+    return (long) ((wrap ? 0 : pos) + kHeaderSize);
+}
+
+int FrameRing::commit(int64_t timestamp) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t record = pending_wrap_ ? 0 : pending_pos_;
+    if (pending_wrap_) {
+        uint32_t marker = kWrapMarker;
+        memcpy(data_ + pending_pos_, &marker, sizeof(marker));
+    }
+    RecordHeader header;
+    header.size = pending_size_;
+    header.flags = pending_key_ ? 1 : 0;
+    header.timestamp = timestamp;
+    memcpy(data_ + record, &header, sizeof(header));
+
+    uint64_t published = published_frames_.load(std::memory_order_relaxed);
+    if (pending_flushed_ > 0) {
+        std::lock_guard<std::mutex> lock(discard_mutex_);
+        discard_until_ = tail;
+        discard_frames_ = published;
+        discarded_upto_frames_ = published;
+        discard_pending_.store(true, std::memory_order_release);
+    }
+    published_frames_.store(published + 1, std::memory_order_release);
+    // 与消费者的 consumer_waiting_ 构成 Dekker 式配对：双方都用 seq_cst，不会出现双方都看不到对方的情况
+    tail_.store(tail + pending_total_, std::memory_order_seq_cst);
+
+    store_max(max_used_bytes_, tail + pending_total_ - head_.load(std::memory_order_relaxed));
+    store_max(max_queued_frames_, published + 1 - std::max(consumed_frames_.load(std::memory_order_relaxed),
+                                                           discarded_upto_frames_));
+    if (consumer_waiting_.load(std::memory_order_seq_cst) && consumer_waiting_.exchange(false)) {
+        signal();
+    }
+    return pending_flushed_;
+}
+
+void FrameRing::flush() {
+    uint64_t published = published_frames_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(discard_mutex_);
+    discard_until_ = tail_.load(std::memory_order_relaxed);
+    discard_frames_ = published;
+    discarded_upto_frames_ = published;
+    discard_pending_.store(true, std::memory_order_release);
+}
+
+void FrameRing::apply_discard() {
+    if (!discard_pending_.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(discard_mutex_);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (discard_until_ > head) {
+        uint64_t consumed = consumed_frames_.load(std::memory_order_relaxed);
+        add_relaxed(flushed_frames_, discard_frames_ - consumed);
+        consumed_frames_.store(discard_frames_, std::memory_order_release);
+        head_.store(discard_until_, std::memory_order_release);
+    }
+    discard_pending_.store(false, std::memory_order_relaxed);
+}
+
+bool FrameRing::readable() const {
+    return discard_pending_.load(std::memory_order_acquire) ||
+           head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_seq_cst);
+}
+
+bool FrameRing::wait(int timeout_ms) {
+    if (!valid()) return false;
+    if (readable()) return true;
+    consumer_waiting_.store(true, std::memory_order_seq_cst);
+    if (readable()) {
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+    struct pollfd pfd;
+    pfd.fd = event_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout_ms) > 0) {
+        uint64_t value;
+        ssize_t n = read(event_fd_, &value, sizeof(value));
+        (void) n;
+    }
+    consumer_waiting_.store(false, std::memory_order_relaxed);
+    return readable();
+}
+
+bool FrameRing::peek(Frame *frame) {
+    if (!valid()) return false;
+    apply_discard();
+    while (true) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        uint64_t pos = head % capacity_;
+        RecordHeader header;
+        memcpy(&header, data_ + pos, sizeof(header));
+        if (header.size == kWrapMarker) {
+            head_.store(head + capacity_ - pos, std::memory_order_release);
+            continue;
+        }
+        frame->data = data_ + pos + kHeaderSize;
+        frame->size = header.size;
+        frame->is_key = (header.flags & 1) != 0;
+        frame->timestamp = header.timestamp;
+        return true;
+    }
+}
+
+void FrameRing::pop() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint32_t size;
+    memcpy(&size, data_ + head % capacity_, sizeof(size));
+    consumed_frames_.store(consumed_frames_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    head_.store(head + record_size(size), std::memory_order_release);
+}
+
+void FrameRing::signal() {
+    add_relaxed(wakeups_, 1);
+    uint64_t one = 1;
+    ssize_t n = write(event_fd_, &one, sizeof(one));
+    (void) n;
+}
+
+void FrameRing::wakeup() {
+    if (event_fd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t n = write(event_fd_, &one, sizeof(one));
+    (void) n;
+}
+
+void FrameRing::snapshot(rtmp_ring_stats *out) const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    uint64_t consumed = consumed_frames_.load(std::memory_order_acquire);
+    uint64_t published = published_frames_.load(std::memory_order_acquire);
+    out->capacity_bytes = (long) capacity_;
+    out->used_bytes = (long) (tail - head);
+    out->max_used_bytes = (long) max_used_bytes_.load(std::memory_order_relaxed);
+    out->queued_frames = (long) (published > consumed ? published - consumed : 0);
+    out->max_queued_frames = (long) max_queued_frames_.load(std::memory_order_relaxed);
+    out->pushed_frames = (long) published;
+    out->dropped_frames = (long) dropped_frames_.load(std::memory_order_relaxed);
+    out->flushed_frames = (long) flushed_frames_.load(std::memory_order_relaxed);
+    out->wakeups = (long) wakeups_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include "rtmp_wrapper.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * 编码回调线程与发送线程之间的单生产者/单消费者帧环。
+ *
+ * 数据区为预分配的一块连续内存，以 DirectByteBuffer 共享给 Kotlin：生产者先 reserve 得到偏移，
+ * 把帧数据直接写入该位置再 commit；消费者在原地读取并发送，不再为每帧分配 ByteArray。
+ * 每条记录为 16 字节头（size/flags/timestamp）+ 数据，按 16 字节对齐；尾部放不下时写入回绕标记后从头开始。
+ * head/tail 为单调递增的字节计数，仅各自的一方写入。消费者空闲时阻塞在 eventfd 上，
+ * 生产者只在消费者声明等待时才写 eventfd，发送繁忙时没有额外的系统调用。
+ */
+class FrameRing {
+public:
+    struct Frame {
+        const uint8_t *data;
+        uint32_t size;
+        bool is_key;
+        int64_t timestamp;
+    };
+
+    /**
+     * @param capacity 数据区字节数（向上取整到 16 字节）
+     * @param max_frames 最多排队的帧数，达到后非关键帧被拒绝，关键帧清空积压后入队
+     */
+    FrameRing(size_t capacity, int max_frames);
+    ~FrameRing();
+
+    bool valid() const { return data_ != nullptr && event_fd_ >= 0; }
+    uint8_t *data() const { return data_; }
+    size_t capacity() const { return capacity_; }
+
+    // ---- 生产者 ----
+
+    // 预留 size 字节，返回数据写入偏移，环满返回 -1；每次成功的 reserve 之后必须 commit。
+    // 关键帧清空的积压在消费者跳过之前仍占用字节空间，字节不足时关键帧同样被拒绝
+    long reserve(uint32_t size, bool is_key);
+    // 发布最近一次预留的帧，返回为其清空的积压帧数
+    int commit(int64_t timestamp);
+    // 丢弃当前已发布的全部帧（由消费者在下次读取时跳过）
+    void flush();
+
+    // ---- 消费者 ----
+
+    // 等待直到有帧可读或超时/被唤醒，有帧返回 true
+    bool wait(int timeout_ms);
+    // 读取队首帧（不出队），为空返回 false
+    bool peek(Frame *frame);
+    // 队首帧出队，之后其数据区可被生产者复用
+    void pop();
+    // 唤醒阻塞在 wait 上的消费者（停止发送线程时使用）
+    void wakeup();
+
+    void snapshot(rtmp_ring_stats *out) const;
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+private:
+    static const uint32_t kHeaderSize = 16;
+    static const uint32_t kWrapMarker = 0xFFFFFFFFu;
+
+    struct RecordHeader {
+        uint32_t size;
+        uint32_t flags;
+        int64_t timestamp;
+    };
+
+    static uint64_t record_size(uint32_t size) { return (kHeaderSize + size + 15) & ~(uint64_t) 15; }
+    bool readable() const;
+    void apply_discard();
+    void signal();
+
+    uint8_t *data_ = nullptr;
+    size_t capacity_ = 0;
+    int max_frames_;
+    int event_fd_ = -1;
+
+    // 生产者写、消费者读
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> published_frames_{0};
+    // 消费者写、生产者读
+    alignas(64) std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> consumed_frames_{0};
+    std::atomic<bool> consumer_waiting_{false};
+
+    // flush：生产者登记丢弃点，消费者读取时跳过；很少发生，用锁保证字节与帧数两个值一致
+    std::mutex discard_mutex_;
+    std::atomic<bool> discard_pending_{false};
+    uint64_t discard_until_ = 0;
+    uint64_t discard_frames_ = 0;
+    uint64_t discarded_upto_frames_ = 0;  // 仅生产者：已登记丢弃的帧计数，排队帧数从此处起算
+
+    // 仅生产者：最近一次 reserve 的结果
+    uint64_t pending_total_ = 0;
+    uint64_t pending_pos_ = 0;
+    uint32_t pending_size_ = 0;
+    bool pending_key_ = false;
+    bool pending_wrap_ = false;
+    int pending_flushed_ = 0;
+
+    // 统计（relaxed）
+    std::atomic<uint64_t> max_used_bytes_{0};
+    std::atomic<uint64_t> max_queued_frames_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> flushed_frames_{0};
+    std::atomic<uint64_t> wakeups_{0};
+};
+
+#endif // FRAME_RING_H
@@ -0,0 +1,181 @@
+#include "frame_trace.h"
+
+#ifdef BB_RTMP_TRACE
+
+#include "bb_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sys/ioctl.h>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <linux/sockios.h>
+#endif
+
+#define TAG "FrameTrace"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+namespace frame_trace {
+
+std::atomic<bool> g_enabled(false);
+std::atomic<uint64_t> g_head(0);
+Slot g_ring[kRingSize];
+
+// 开启追踪时记录一组 (ticks, 纳秒) 作为换算基准（x86 TSC 频率需要标定）
+static uint64_t g_calib_ticks = 0;
+static int64_t g_calib_ns = 0;
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double ticks_per_us() {
+#if defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq / 1e6;
+#elif defined(__x86_64__) || defined(__i386__)
+    if (g_calib_ns == 0 || steady_ns() - g_calib_ns < 10000000) {
+        g_calib_ticks = ticks();
+        g_calib_ns = steady_ns();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return (double) (ticks() - g_calib_ticks) * 1000.0 / (double) (steady_ns() - g_calib_ns);
+#else
+    return 1000.0;
+#endif
+}
+
+void record_socket_queue(int fd, FrameTraceTrack track, uint32_t frame_ts) {
+    int queued = -1;
+#if defined(SIOCOUTQ)
+    if (fd < 0 || ioctl(fd, SIOCOUTQ, &queued) != 0) return;
+#else
+    return;
+#endif
+    record(FRAME_TRACE_SOCKET_QUEUE, track, frame_ts, queued);
+}
+
+struct Entry {
+    uint64_t ticks;
+    uint32_t frame_ts;
+    int32_t value;
+    uint32_t tid;
+    uint8_t event;
+    uint8_t track;
+};
+
+static const char *track_name(uint8_t track) {
+    switch (track) {
+        case FRAME_TRACE_VIDEO: return "video";
+        case FRAME_TRACE_AUDIO: return "audio";
+        default: return "data";
+    }
+}
+
+static const char *event_name(uint8_t event) {
+    switch (event) {
+        case FRAME_TRACE_JNI_ENTRY: return "jni_entry";
+        case FRAME_TRACE_LOCK_ACQUIRED: return "lock_acquired";
+        case FRAME_TRACE_NAL_PARSED: return "nal_parsed";
+        case FRAME_TRACE_PACKET_BUILT: return "packet_built";
+        case FRAME_TRACE_FIRST_CHUNK: return "first_chunk";
+        case FRAME_TRACE_LAST_CHUNK: return "last_chunk";
+        case FRAME_TRACE_SOCKET_QUEUE: return "socket_queue";
+        default: return "unknown";
+    }
+}
+
+}  // namespace frame_trace
+
+bool frame_trace_set_enabled(bool enabled) {
+    using namespace frame_trace;
+    if (enabled && !g_enabled.load(std::memory_order_relaxed)) {
+        g_calib_ticks = ticks();
+        g_calib_ns = steady_ns();
+    }
+    g_enabled.store(enabled, std::memory_order_relaxed);
+    LOGD("逐帧追踪%s", enabled ? "已开启" : "已关闭");
+    return true;
+}
+
+int frame_trace_dump_chrome_json(const char *path) {
+    using namespace frame_trace;
+    if (path == nullptr) return -1;
+
+    // 快照：跳过正在写入或已被覆盖的槽位
+    std::vector<Entry> entries;
+    uint64_t head = g_head.load(std::memory_order_acquire);
+    uint64_t begin = head > kRingSize ? head - kRingSize : 0;
+    entries.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) {
+        Slot &slot = g_ring[i & (kRingSize - 1)];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != i + 1) continue;
+        Entry entry;
+        entry.ticks = slot.ticks.load(std::memory_order_relaxed);
+        uint64_t frame_value = slot.frame_value.load(std::memory_order_relaxed);
+        uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+        entry.frame_ts = (uint32_t) (frame_value >> 32);
+        entry.value = (int32_t) (uint32_t) frame_value;
+        entry.tid = (uint32_t) meta;
+        entry.event = (uint8_t) (meta >> 32);
+        entry.track = (uint8_t) (meta >> 40);
+        entries.push_back(entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.ticks < b.ticks;
+    });
+
+    FILE *fp = fopen(path, "w");
+    if (fp == nullptr) {
+        LOGE("无法写入追踪文件: %s", path);
+        return -1;
+    }
+    double scale = ticks_per_us();
+    uint64_t base = entries.empty() ? 0 : entries.front().ticks;
+    int pid = (int) getpid();
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry &e = entries[i];
+        double ts_us = (double) (e.ticks - base) / scale;
+        const char *sep = i + 1 < entries.size() ? ",\n" : "\n";
+        if (e.event == FRAME_TRACE_FIRST_CHUNK || e.event == FRAME_TRACE_LAST_CHUNK) {
+            // 首/末 chunk 组成一段 "send" 区间
+            fprintf(fp, "{\"name\":\"send %s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,"
+                        "\"args\":{\"frame_ts\":%u,\"value\":%d}}%s",
+                    track_name(e.track), track_name(e.track), e.event == FRAME_TRACE_FIRST_CHUNK ? "B" : "E",
+                    ts_us, pid, e.tid, e.frame_ts, e.value, sep);
+        } else if (e.event == FRAME_TRACE_SOCKET_QUEUE) {
+            fprintf(fp, "{\"name\":\"socket_queue\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,"
+                        "\"args\":{\"bytes\":%d}}%s",
+                    ts_us, pid, e.tid, e.value, sep);
+        } else {
+            fprintf(fp, "{\"name\":\"%s %s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,"
+                        "\"args\":{\"frame_ts\":%u,\"value\":%d}}%s",
+                    track_name(e.track), event_name(e.event), track_name(e.track), ts_us, pid, e.tid,
+                    e.frame_ts, e.value, sep);
+        }
+    }
+    fprintf(fp, "]}\n");
+    bool ok = fclose(fp) == 0;
+    LOGD("导出 %zu 个追踪事件到 %s", entries.size(), path);
+    return ok ? (int) entries.size() : -1;
+}
+
+#else
+
+bool frame_trace_set_enabled(bool) {
+    return false;
+}
+
+int frame_trace_dump_chrome_json(const char *) {
+    return -1;
+}
+
+#endif // BB_RTMP_TRACE
@@ -0,0 +1,121 @@
+#ifndef BB_RTMP_FRAME_TRACE_H
+#define BB_RTMP_FRAME_TRACE_H
+
+/*
+ * 逐帧发送流水线追踪：固定大小的无锁环形缓冲区，记录每帧经过的各个阶段
+ * （JNI 入口、拿到锁、NAL 解析完成、packet 构建完成、首/末 chunk 写出、socket 发送队列深度），
+ * 每个事件带帧时间戳与线程 id，可导出为 Chrome trace-event JSON（chrome://tracing 或 Perfetto 打开）。
+ *
+ * 以 BB_RTMP_TRACE 编译时，开启后每个事件只有一次原子自增和几次 relaxed 存储，关闭时只有一次 relaxed 读取；
+ * 未定义 BB_RTMP_TRACE 时 FRAME_TRACE* 宏展开为空。
+ */
+
+#include <cstdint>
+
+enum FrameTraceEvent : uint8_t {
+    FRAME_TRACE_JNI_ENTRY = 1,     // value = 帧大小
+    FRAME_TRACE_LOCK_ACQUIRED,
+    FRAME_TRACE_NAL_PARSED,        // value = NALU 个数
+    FRAME_TRACE_PACKET_BUILT,      // value = packet body 大小
+    FRAME_TRACE_FIRST_CHUNK,       // 开始写第一个 chunk（进入 RTMP_SendPacket）
+    FRAME_TRACE_LAST_CHUNK,        // 最后一个 chunk 已写入 socket（RTMP_SendPacket 返回），value = 是否成功
+    FRAME_TRACE_SOCKET_QUEUE,      // value = 内核发送队列中尚未确认的字节数（SIOCOUTQ）
+};
+
+enum FrameTraceTrack : uint8_t {
+    FRAME_TRACE_VIDEO = 0,
+    FRAME_TRACE_AUDIO = 1,
+    FRAME_TRACE_DATA = 2,          // onMetaData 等脚本数据
+};
+
+#ifdef BB_RTMP_TRACE
+
+#include <atomic>
+#include <ctime>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace frame_trace {
+
+const uint32_t kRingSize = 1 << 14;  // 2 的幂
+
+// 每个槽位按 seqlock 方式写入：seq 为 0 表示正在写，否则为全局序号 + 1
+struct Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> frame_value;  // 高 32 位帧时间戳，低 32 位 value
+    std::atomic<uint64_t> meta;         // 低 32 位线程 id，之后依次为事件类型、轨道
+};
+
+extern std::atomic<bool> g_enabled;
+extern std::atomic<uint64_t> g_head;
+extern Slot g_ring[kRingSize];
+
+// 原始时钟计数：arm64 读虚拟计数器，x86 读 TSC，导出时换算为微秒
+inline uint64_t ticks() {
+#if defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+inline uint32_t thread_id() {
+    static thread_local uint32_t tid = 0;
+    if (tid == 0) tid = (uint32_t) syscall(SYS_gettid);
+    return tid;
+}
+
+inline bool enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+inline void record(FrameTraceEvent event, FrameTraceTrack track, uint32_t frame_ts, int64_t value) {
+    uint64_t index = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = g_ring[index & (kRingSize - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.ticks.store(ticks(), std::memory_order_relaxed);
+    slot.frame_value.store(((uint64_t) frame_ts << 32) | (uint32_t) value, std::memory_order_relaxed);
+    slot.meta.store(thread_id() | ((uint64_t) event << 32) | ((uint64_t) track << 40), std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+// 读取 socket 发送队列深度（一次 ioctl，仅在开启追踪时调用）
+void record_socket_queue(int fd, FrameTraceTrack track, uint32_t frame_ts);
+
+}  // namespace frame_trace
+
+#define FRAME_TRACE(event, track, frame_ts, value) \
+    do { \
+        if (frame_trace::enabled()) frame_trace::record(event, track, (uint32_t) (frame_ts), (int64_t) (value)); \
+    } while (0)
+
+#define FRAME_TRACE_SOCKET_QUEUE(fd, track, frame_ts) \
+    do { \
+        if (frame_trace::enabled()) frame_trace::record_socket_queue(fd, track, (uint32_t) (frame_ts)); \
+    } while (0)
+
+#else
+
+#define FRAME_TRACE(event, track, frame_ts, value) do { } while (0)
+#define FRAME_TRACE_SOCKET_QUEUE(fd, track, frame_ts) do { } while (0)
+
+#endif // BB_RTMP_TRACE
+
+// 运行时开关；未以 BB_RTMP_TRACE 编译时返回 false
+bool frame_trace_set_enabled(bool enabled);
+
+// 导出环形缓冲区中的事件为 Chrome trace-event JSON，返回事件数；失败或未编译追踪时返回 -1
+int frame_trace_dump_chrome_json(const char *path);
+
+#endif // BB_RTMP_FRAME_TRACE_H
@@ -0,0 +1,175 @@
+#include "h264_params.h"
+#include "bitstream.h"
+#include <vector>
+
+static void skip_scaling_list(BitReader &reader, int size) {
+    int last_scale = 8;
+    int next_scale = 8;
+    for (int j = 0; j < size; ++j) {
+        if (next_scale != 0) {
+            next_scale = (last_scale + reader.se() + 256) % 256;
+        }
+        last_scale = next_scale == 0 ? last_scale : next_scale;
+    }
+}
+
+static bool is_high_profile(int profile_idc) {
+    switch (profile_idc) {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* 跳过 VUI 中 timing_info 之前的字段（H.264 E.1.1），读出 num_units_in_tick/time_scale */
+static void parse_vui_timing(BitReader &reader, H264Sps &sps) {
+    if (reader.bits(1)) {  // aspect_ratio_info_present_flag
+        if (reader.bits(8) == 255) reader.skip(32);  // Extended_SAR：sar_width + sar_height
+    }
+    if (reader.bits(1)) reader.bits(1);  // overscan_info_present_flag / overscan_appropriate_flag
+    if (reader.bits(1)) {  // video_signal_type_present_flag
+        reader.bits(4);  // video_format + video_full_range_flag
+        if (reader.bits(1)) reader.skip(24);  // colour_primaries / transfer / matrix
+    }
+    if (reader.bits(1)) {  // chroma_loc_info_present_flag
+        reader.ue();
+        reader.ue();
+    }
+    if (!reader.bits(1)) return;  // timing_info_present_flag
+    uint32_t num_units_in_tick = reader.bits(32);
+    uint32_t time_scale = reader.bits(32);
+    if (!reader.ok()) return;
+    sps.num_units_in_tick = num_units_in_tick;
+    sps.time_scale = time_scale;
+}
+
+bool h264_parse_sps(const uint8_t *nal, size_t size, H264Sps &sps) {
+    if (nal == nullptr || size < 4 || (nal[0] & 0x1F) != 7) return false;
+    std::vector<uint8_t> rbsp;
+    nal_to_rbsp(nal + 1, size - 1, rbsp);
+    BitReader reader(rbsp.data(), rbsp.size());
+
+    sps = H264Sps();
+    sps.profile_idc = (int) reader.bits(8);
+    sps.constraint_flags = (int) reader.bits(8);
+    sps.level_idc = (int) reader.bits(8);
+    sps.sps_id = (int) reader.ue();
+    if (is_high_profile(sps.profile_idc)) {
+        sps.chroma_format_idc = (int) reader.ue();
+        if (sps.chroma_format_idc == 3) sps.separate_colour_plane = reader.bits(1) != 0;
+        reader.ue();  // bit_depth_luma_minus8
+        reader.ue();  // bit_depth_chroma_minus8
+        reader.bits(1);  // qpprime_y_zero_transform_bypass_flag
+        if (reader.bits(1)) {  // seq_scaling_matrix_present_flag
+            int lists = sps.chroma_format_idc != 3 ? 8 : 12;
+            for (int i = 0; i < lists; ++i) {
+                if (reader.bits(1)) skip_scaling_list(reader, i < 6 ? 16 : 64);
+            }
+        }
+    }
+    sps.log2_max_frame_num = (int) reader.ue() + 4;
+    sps.pic_order_cnt_type = (int) reader.ue();
+    if (sps.pic_order_cnt_type == 0) {
+        sps.log2_max_pic_order_cnt_lsb = (int) reader.ue() + 4;
+    } else if (sps.pic_order_cnt_type == 1) {
+        sps.delta_pic_order_always_zero = reader.bits(1) != 0;
+        reader.se();  // offset_for_non_ref_pic
+        reader.se();  // offset_for_top_to_bottom_field
+        uint32_t cycle = reader.ue();
+        if (cycle > 255) return false;
+        for (uint32_t i = 0; i < cycle; ++i) reader.se();
+    }
+    sps.max_num_ref_frames = (int) reader.ue();
+    reader.bits(1);  // gaps_in_frame_num_value_allowed_flag
+    sps.pic_width_in_mbs = (int) reader.ue() + 1;
+    sps.pic_height_in_map_units = (int) reader.ue() + 1;
+    sps.frame_mbs_only = reader.bits(1) != 0;
+    if (!sps.frame_mbs_only) sps.mb_adaptive_frame_field = reader.bits(1) != 0;
+    reader.bits(1);  // direct_8x8_inference_flag
+    if (reader.bits(1)) {  // frame_cropping_flag
+        sps.crop_left = (int) reader.ue();
+        sps.crop_right = (int) reader.ue();
+        sps.crop_top = (int) reader.ue();
+        sps.crop_bottom = (int) reader.ue();
+    }
+    if (!reader.ok() || sps.log2_max_frame_num > 16 || sps.log2_max_pic_order_cnt_lsb > 16 ||
+        sps.width() <= 0 || sps.height() <= 0) {
+        return false;
+    }
+    // VUI 只取帧率；部分编码器输出的 VUI 被截断，解析失败不影响前面的字段
+    if (reader.bits(1)) parse_vui_timing(reader, sps);
+    return true;
+}
+
+int H264Sps::width() const {
+    int crop_unit_x = chroma_array_type() == 1 || chroma_array_type() == 2 ? 2 : 1;
+    return pic_width_in_mbs * 16 - crop_unit_x * (crop_left + crop_right);
+}
+
+int H264Sps::height() const {
+    int crop_unit_y = (chroma_array_type() == 1 ? 2 : 1) * (frame_mbs_only ? 1 : 2);
+    return pic_height_in_map_units * 16 * (frame_mbs_only ? 1 : 2) - crop_unit_y * (crop_top + crop_bottom);
+}
+
+int H264Sps::frame_rate() const {
+    if (num_units_in_tick == 0 || time_scale == 0) return 0;
+    // 一帧为两个 tick（E.2.1 中 fixed_frame_rate 的帧场换算）
+    return (int) (((uint64_t) time_scale + num_units_in_tick) / (2 * (uint64_t) num_units_in_tick));
+}
+
+bool h264_parse_pps(const uint8_t *nal, size_t size, H264Pps &pps) {
+    if (nal == nullptr || size < 2 || (nal[0] & 0x1F) != 8) return false;
+    std::vector<uint8_t> rbsp;
+    nal_to_rbsp(nal + 1, size - 1, rbsp);
+    BitReader reader(rbsp.data(), rbsp.size());
+
+    pps = H264Pps();
+    pps.pps_id = (int) reader.ue();
+    pps.sps_id = (int) reader.ue();
+    pps.entropy_coding_mode = reader.bits(1) != 0;
+    pps.bottom_field_pic_order_in_frame_present = reader.bits(1) != 0;
+    pps.num_slice_groups = (int) reader.ue() + 1;
+    if (pps.num_slice_groups > 1) {
+        // slice group 映射只在 Baseline/Extended 中出现，这里不展开，调用方按不支持处理
+        return reader.ok();
+    }
+    pps.num_ref_idx_l0_default_active = (int) reader.ue() + 1;
+    reader.ue();  // num_ref_idx_l1_default_active_minus1
+    pps.weighted_pred = reader.bits(1) != 0;
+    reader.bits(2);  // weighted_bipred_idc
+    pps.pic_init_qp = 26 + reader.se();
+    reader.se();  // pic_init_qs_minus26
+    reader.se();  // chroma_qp_index_offset
+    pps.deblocking_filter_control_present = reader.bits(1) != 0;
+    reader.bits(1);  // constrained_intra_pred_flag
+    pps.redundant_pic_cnt_present = reader.bits(1) != 0;
+    return reader.ok();
+}
+
+bool h264_parse_slice_header(const uint8_t *nal, size_t size, const H264Sps &sps, H264SliceHeader &header) {
+    if (nal == nullptr || size < 2) return false;
+    // slice 头很短，只去掉前部的防竞争字节
+    std::vector<uint8_t> rbsp;
+    nal_to_rbsp(nal + 1, size - 1 < 64 ? size - 1 : 64, rbsp);
+    BitReader reader(rbsp.data(), rbsp.size());
+
+    header = H264SliceHeader();
+    header.nal_ref_idc = (nal[0] >> 5) & 0x03;
+    header.nal_unit_type = nal[0] & 0x1F;
+    if (header.nal_unit_type != 1 && header.nal_unit_type != 5) return false;
+    header.first_mb_in_slice = (int) reader.ue();
+    header.slice_type = (int) reader.ue();
+    header.pps_id = (int) reader.ue();
+    if (sps.separate_colour_plane) reader.bits(2);  // colour_plane_id
+    header.frame_num = (int) reader.bits(sps.log2_max_frame_num);
+    if (!sps.frame_mbs_only && reader.bits(1)) {  // field_pic_flag
+        reader.bits(1);  // bottom_field_flag
+    }
+    if (header.nal_unit_type == 5) header.idr_pic_id = (int) reader.ue();
+    if (sps.pic_order_cnt_type == 0) {
+        header.pic_order_cnt_lsb = (int) reader.bits(sps.log2_max_pic_order_cnt_lsb);
+    }
+    return reader.ok();
+}
@@ -0,0 +1,80 @@
+#ifndef H264_PARAMS_H
+#define H264_PARAMS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * H.264 参数集与 slice 头解析（H.264 7.3.2.1 / 7.3.2.2 / 7.3.3），只保留本库用到的字段。
+ * 输入为不含起始码、含 1 字节 NAL 头的 NALU。
+ */
+
+struct H264Sps {
+    int profile_idc = 0;
+    int constraint_flags = 0;
+    int level_idc = 0;
+    int sps_id = 0;
+    int chroma_format_idc = 1;
+    bool separate_colour_plane = false;
+    int log2_max_frame_num = 4;
+    int pic_order_cnt_type = 0;
+    int log2_max_pic_order_cnt_lsb = 4;  // 仅 pic_order_cnt_type == 0
+    bool delta_pic_order_always_zero = false;  // 仅 pic_order_cnt_type == 1
+    int max_num_ref_frames = 0;
+    int pic_width_in_mbs = 0;
+    int pic_height_in_map_units = 0;
+    bool frame_mbs_only = true;
+    bool mb_adaptive_frame_field = false;
+    int crop_left = 0;  // frame_crop_*_offset，单位见 7.4.2.1.1 CropUnitX/CropUnitY
+    int crop_right = 0;
+    int crop_top = 0;
+    int crop_bottom = 0;
+    // VUI timing_info（E.1.1），没有 VUI 或解析失败时为 0
+    uint32_t num_units_in_tick = 0;
+    uint32_t time_scale = 0;
+
+    // ChromaArrayType（H.264 7.4.2.1.1）
+    int chroma_array_type() const { return separate_colour_plane ? 0 : chroma_format_idc; }
+    int pic_size_in_mbs() const { return pic_width_in_mbs * pic_height_in_map_units * (frame_mbs_only ? 1 : 2); }
+
+    // 裁剪后的显示宽高（像素）
+    int width() const;
+    int height() const;
+
+    // VUI 声明的帧率（四舍五入），未声明返回 0
+    int frame_rate() const;
+};
+
+struct H264Pps {
+    int pps_id = 0;
+    int sps_id = 0;
+    bool entropy_coding_mode = false;  // true 为 CABAC
+    bool bottom_field_pic_order_in_frame_present = false;
+    int num_slice_groups = 1;
+    int num_ref_idx_l0_default_active = 1;
+    bool weighted_pred = false;
+    int pic_init_qp = 26;
+    bool deblocking_filter_control_present = false;
+    bool redundant_pic_cnt_present = false;
+};
+
+// slice 头中 frame_num 及之前、以及图像顺序计数相关的字段
+struct H264SliceHeader {
+    int nal_ref_idc = 0;
+    int nal_unit_type = 0;
+    int first_mb_in_slice = 0;
+    int slice_type = 0;
+    int pps_id = 0;
+    int frame_num = 0;
+    int idr_pic_id = 0;  // 仅 IDR
+    int pic_order_cnt_lsb = 0;  // 仅 pic_order_cnt_type == 0
+};
+
+bool h264_parse_sps(const uint8_t *nal, size_t size, H264Sps &sps);
+
+bool h264_parse_pps(const uint8_t *nal, size_t size, H264Pps &pps);
+
+/* 按给定 SPS/PPS 解析 slice 头（不校验 pps_id 是否匹配，调用方只持有一组参数集） */
+bool h264_parse_slice_header(const uint8_t *nal, size_t size, const H264Sps &sps, H264SliceHeader &header);
+
+#endif // H264_PARAMS_H
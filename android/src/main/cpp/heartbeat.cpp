@@ -0,0 +1,64 @@
+#include "heartbeat.h"
+#include <chrono>
+
+HeartbeatTimer::HeartbeatTimer(int64_t video_interval_us, int64_t audio_interval_us, TickFn on_video, TickFn on_audio)
+        : video_interval_us_(video_interval_us), audio_interval_us_(audio_interval_us),
+          on_video_(on_video), on_audio_(on_audio) {}
+
+HeartbeatTimer::~HeartbeatTimer() {
+    stop();
+}
+
+void HeartbeatTimer::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_ || stopping_) return;
+    started_ = true;
+    thread_ = std::thread(&HeartbeatTimer::run, this);
+}
+
+void HeartbeatTimer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+/* 下一次触发时刻：按间隔推进，已错过的节拍直接跳过 */
+static int64_t advance(int64_t due_us, int64_t interval_us, int64_t now_us) {
+    due_us += interval_us;
+    if (due_us <= now_us) due_us += ((now_us - due_us) / interval_us + 1) * interval_us;
+    return due_us;
+}
+
+void HeartbeatTimer::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point begin = Clock::now();
+    const bool video = video_interval_us_ > 0 && on_video_;
+    const bool audio = audio_interval_us_ > 0 && on_audio_;
+    int64_t next_video_us = 0;
+    int64_t next_audio_us = 0;
+    while (true) {
+        int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin).count();
+        if (video && now_us >= next_video_us) {
+            on_video_(now_us);
+            next_video_us = advance(next_video_us, video_interval_us_, now_us);
+        }
+        if (audio && now_us >= next_audio_us) {
+            on_audio_(now_us);
+            next_audio_us = advance(next_audio_us, audio_interval_us_, now_us);
+        }
+
+        int64_t due_us = INT64_MAX;
+        if (video) due_us = next_video_us;
+        if (audio && next_audio_us < due_us) due_us = next_audio_us;
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (due_us == INT64_MAX) {
+            cond_.wait(lock, [this] { return stopping_; });
+        } else {
+            cond_.wait_until(lock, begin + std::chrono::microseconds(due_us), [this] { return stopping_; });
+        }
+        if (stopping_) return;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * 后台心跳定时器：独立线程按固定间隔分别触发视频与音频回调（间隔互不影响，均按单调时钟对齐，
+ * 不随回调耗时漂移；落后超过一个间隔时跳过错过的节拍，不补发）。
+ */
+class HeartbeatTimer {
+public:
+    // elapsed_us 为自 start 起经过的时间
+    typedef std::function<void(int64_t elapsed_us)> TickFn;
+
+    /**
+     * @param video_interval_us 视频回调间隔，<= 0 不触发
+     * @param audio_interval_us 音频回调间隔，<= 0 不触发
+     */
+    HeartbeatTimer(int64_t video_interval_us, int64_t audio_interval_us, TickFn on_video, TickFn on_audio);
+    ~HeartbeatTimer();
+
+    void start();
+
+    // 等待正在执行的回调返回后停止
+    void stop();
+
+    HeartbeatTimer(const HeartbeatTimer &) = delete;
+    HeartbeatTimer &operator=(const HeartbeatTimer &) = delete;
+
+private:
+    void run();
+
+    int64_t video_interval_us_;
+    int64_t audio_interval_us_;
+    TickFn on_video_;
+    TickFn on_audio_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stopping_ = false;
+    bool started_ = false;
+    std::thread thread_;
+};
+
+#endif // HEARTBEAT_H
@@ -0,0 +1,112 @@
+#include "partial_writer.h"
+#include "bb_log.h"
+#include "rtmp_chunk.h"
+#include "send_stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+
+#define TAG "PartialWriter"
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // Apple 平台以 SO_NOSIGPIPE 代替
+#endif
+
+PartialWriteResult PartialWriter::flush(int64_t deadline_us, int *syscalls) {
+    if (pending_bytes() == 0) return PARTIAL_WRITE_DONE;
+    iov_.resize(1);
+    iov_[0].iov_base = pending_.data() + offset_;
+    iov_[0].iov_len = pending_bytes();
+    iov_index_ = 0;
+    PartialWriteResult result = send_iov(deadline_us, syscalls);
+    if (result == PARTIAL_WRITE_PENDING) {
+        offset_ = pending_.size() - iov_[0].iov_len;
+    } else if (result == PARTIAL_WRITE_DONE) {
+        pending_.clear();  // 保留容量，下一次停滞时复用
+        offset_ = 0;
+    }
+    return result;
+}
+
+PartialWriteResult PartialWriter::write(const RTMPPacket *packet, int chunk_size, int64_t deadline_us, int *syscalls) {
+    const uint8_t *body = reinterpret_cast<const uint8_t *>(packet->m_body);
+    const uint8_t *body_end = body + packet->m_nBodySize;
+    size_t chunks = packet->m_nBodySize == 0 ? 1 : (packet->m_nBodySize + chunk_size - 1) / (size_t) chunk_size;
+    // 预留全部 chunk 头的空间，iovec 指向 headers_ 的指针在序列化过程中保持有效
+    headers_.clear();
+    headers_.reserve(chunks * RTMP_CHUNK_HEADER_MAX);
+    iov_.clear();
+    rtmp_write_chunks(packet, chunk_size, [&](const uint8_t *data, size_t len) {
+        struct iovec v;
+        if (data >= body && data < body_end) {
+            v.iov_base = const_cast<uint8_t *>(data);
+        } else {
+            size_t at = headers_.size();
+            headers_.insert(headers_.end(), data, data + len);
+            v.iov_base = headers_.data() + at;
+        }
+        v.iov_len = len;
+        iov_.push_back(v);
+    });
+    iov_index_ = 0;
+    PartialWriteResult result = send_iov(deadline_us, syscalls);
+    if (result == PARTIAL_WRITE_PENDING) {
+        // packet 随后释放：剩余部分拷贝进续写缓冲区
+        pending_.clear();
+        offset_ = 0;
+        for (size_t i = iov_index_; i < iov_.size(); ++i) {
+            const uint8_t *base = static_cast<const uint8_t *>(iov_[i].iov_base);
+            pending_.insert(pending_.end(), base, base + iov_[i].iov_len);
+        }
+    }
+    return result;
+}
+
+PartialWriteResult PartialWriter::send_iov(int64_t deadline_us, int *syscalls) {
+    while (iov_index_ < iov_.size()) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov_[iov_index_];
+        msg.msg_iovlen = std::min(iov_.size() - iov_index_, (size_t) IOV_MAX);
+        ssize_t n = sendmsg(fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        (*syscalls)++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (wait_writable(deadline_us)) continue;
+                return PARTIAL_WRITE_PENDING;
+            }
+            LOGE("sendmsg 失败: %s", strerror(errno));
+            return PARTIAL_WRITE_FAILED;
+        }
+        size_t left = (size_t) n;
+        while (left > 0) {
+            struct iovec &v = iov_[iov_index_];
+            if (left >= v.iov_len) {
+                left -= v.iov_len;
+                iov_index_++;
+            } else {
+                v.iov_base = static_cast<uint8_t *>(v.iov_base) + left;
+                v.iov_len -= left;
+                left = 0;
+            }
+        }
+    }
+    return PARTIAL_WRITE_DONE;
+}
+
+bool PartialWriter::wait_writable(int64_t deadline_us) {
+    int64_t remaining_us = deadline_us - send_stats_now_us();
+    if (remaining_us <= 0) return false;
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, (int) ((remaining_us + 999) / 1000));
+    // EINTR 或可写（含 POLLERR/POLLHUP，由下一次 sendmsg 报告错误）时重试
+    return ready != 0;
+}
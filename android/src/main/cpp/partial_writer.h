@@ -0,0 +1,67 @@
+#ifndef PARTIAL_WRITER_H
+#define PARTIAL_WRITER_H
+
+#include "librtmp/rtmp.h"
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include <vector>
+
+/*
+ * 限时非阻塞发送（rtmp_set_send_deadline 开启）。
+ *
+ * librtmp 的 WriteN 在阻塞 socket 上逐 chunk send，上行停滞时发送线程在 wrapper 锁内最多阻塞 SO_SNDTIMEO
+ * （10 秒），超时后 RTMP_Close，会话随之丢失。本模块改为：
+ *   - 消息按 chunk 序列化为 iovec（chunk 头 + 指向 packet body 的负载片段），以 sendmsg(MSG_DONTWAIT) 写出，
+ *     发送缓冲区满时 poll 等待可写，最多等到调用方给出的期限；
+ *   - 期限到达时把尚未写出的部分拷贝进续写缓冲区并记录偏移（只在停滞时拷贝，缓冲区跨消息复用），
+ *     下一次发送先从断点续写，写完之前新消息不会进入 socket，对端看到的字节流与阻塞发送完全一致；
+ *   - 续写在期限内仍未完成时由调用方拒绝新消息，上层据此丢帧或排队，连接保持可用。
+ * socket 本身不设置 O_NONBLOCK：librtmp 自己的写（关闭时的 FCUnpublish 等）遇到 EAGAIN 会直接 RTMP_Close，
+ * 调用方须先 flush 写完续写部分再让 librtmp 写。
+ */
+
+enum PartialWriteResult {
+    PARTIAL_WRITE_DONE = 0,     // 整条消息已写入 socket
+    PARTIAL_WRITE_PENDING = 1,  // 期限到达，剩余部分留在续写缓冲区
+    PARTIAL_WRITE_FAILED = -1,  // socket 错误，连接已不可用
+};
+
+class PartialWriter {
+public:
+    explicit PartialWriter(int fd) : fd_(fd) {}
+
+    // 上一条消息尚未写出的字节数
+    size_t pending_bytes() const { return pending_.size() - offset_; }
+
+    /**
+     * 续写上一条消息的剩余部分，直到写完或到达 deadline_us（send_stats_now_us 时钟，已过期时仍尝试一次）
+     * @param syscalls 累加 sendmsg 次数
+     */
+    PartialWriteResult flush(int64_t deadline_us, int *syscalls);
+
+    /**
+     * 按 chunk_size 写出一条消息（调用方须先 flush 完成）。返回 PENDING 时消息视为已发送，剩余部分由之后的
+     * flush 续写，packet 可以立即释放
+     * @param syscalls 累加 sendmsg 次数
+     */
+    PartialWriteResult write(const RTMPPacket *packet, int chunk_size, int64_t deadline_us, int *syscalls);
+
+    PartialWriter(const PartialWriter &) = delete;
+    PartialWriter &operator=(const PartialWriter &) = delete;
+
+private:
+    // 写出 iov_[0..] 直到写完、期限到达（返回 PENDING，iov_ 指向剩余部分）或出错
+    PartialWriteResult send_iov(int64_t deadline_us, int *syscalls);
+    // 等待 socket 可写；期限已到返回 false
+    bool wait_writable(int64_t deadline_us);
+
+    int fd_;
+    std::vector<uint8_t> pending_;     // 续写缓冲区
+    size_t offset_ = 0;                // pending_ 中已写出的字节数
+    std::vector<uint8_t> headers_;     // 当前消息的 chunk 头（依次存放）
+    std::vector<struct iovec> iov_;
+    size_t iov_index_ = 0;             // send_iov 写到的 iovec
+};
+
+#endif // PARTIAL_WRITER_H
@@ -0,0 +1,1224 @@
+#include "publish_engine.h"
+#include "bb_log.h"
+#include "flv_mux.h"
+#include "send_stats.h"
+#include "librtmp/rtmp.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TAG "PublishEngine"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+namespace {
+
+const int kHandshakeSize = 1536;
+const size_t kMaxUrlLength = 1024;      // 命令消息缓冲区按此上限估算
+const size_t kMaxSpareMessages = 16;
+const int kMaxIov = 256;
+const int kMaxEvents = 256;
+
+// 命令事务号：按发送顺序固定编号
+const double kTxnConnect = 1;
+const double kTxnReleaseStream = 2;
+const double kTxnFCPublish = 3;
+const double kTxnCreateStream = 4;
+const double kTxnPublish = 5;
+const double kTxnFCUnpublish = 6;
+const double kTxnDeleteStream = 7;
+
+AVal make_aval(const char *s, size_t len) {
+    AVal v;
+    v.av_val = const_cast<char *>(s);
+    v.av_len = (int) len;
+    return v;
+}
+
+AVal make_aval(const char *s) {
+    return make_aval(s, strlen(s));
+}
+
+bool aval_equals(const AVal &v, const char *s) {
+    size_t len = strlen(s);
+    return v.av_len == (int) len && v.av_val != nullptr && memcmp(v.av_val, s, len) == 0;
+}
+
+void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+rtmp_engine_config normalize_config(const rtmp_engine_config *in) {
+    rtmp_engine_config c;
+    memset(&c, 0, sizeof(c));
+    if (in != nullptr) c = *in;
+    if (c.threads <= 0) c.threads = 1;
+    c.threads = std::min(c.threads, 64);
+    if (c.chunk_size <= 0) c.chunk_size = 4096;
+    c.chunk_size = std::max(128, std::min(c.chunk_size, 0xffffff));
+    if (c.max_queue_bytes <= 0) c.max_queue_bytes = 1024 * 1024;
+    if (c.connect_timeout_ms <= 0) c.connect_timeout_ms = 10000;
+    if (c.ping_interval_ms == 0) c.ping_interval_ms = 5000;
+    if (c.ping_timeout_ms <= 0) c.ping_timeout_ms = 15000;
+    if (c.reconnect_min_ms <= 0) c.reconnect_min_ms = 500;
+    if (c.reconnect_max_ms <= 0) c.reconnect_max_ms = 30000;
+    c.reconnect_max_ms = std::max(c.reconnect_max_ms, c.reconnect_min_ms);
+    return c;
+}
+
+}  // namespace
+
+// 命令消息的 AMF0 编码（URL 长度在 open 时限制，缓冲区足以容纳，不逐项检查溢出）
+struct CommandWriter {
+    char buf[4 * kMaxUrlLength];
+    char *p = buf;
+
+    char *end() { return buf + sizeof(buf); }
+    size_t size() const { return (size_t) (p - buf); }
+
+    void string(const std::string &s) {
+        AVal v = make_aval(s.data(), s.size());
+        p = AMF_EncodeString(p, end(), &v);
+    }
+    void number(double d) { p = AMF_EncodeNumber(p, end(), d); }
+    void null() { *p++ = AMF_NULL; }
+    void begin_object() { *p++ = AMF_OBJECT; }
+    void named_string(const char *name, const std::string &value) {
+        AVal n = make_aval(name);
+        AVal v = make_aval(value.data(), value.size());
+        p = AMF_EncodeNamedString(p, end(), &n, &v);
+    }
+    void end_object() {
+        *p++ = 0;
+        *p++ = 0;
+        *p++ = AMF_OBJECT_END;
+    }
+};
+
+// 一个 epoll 线程：会话、定时器与唤醒队列。标注“引擎线程”的方法只能在该线程上调用
+class EngineLoop {
+public:
+    ~EngineLoop() {
+        stop();
+    }
+
+    bool start() {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        evfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd_ < 0 || evfd_ < 0) {
+            LOGE("创建 epoll/eventfd 失败: %s", strerror(errno));
+            return false;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev) != 0) {
+            LOGE("注册 eventfd 失败: %s", strerror(errno));
+            return false;
+        }
+        rng_ = (uint64_t) send_stats_now_us() ^ ((uint64_t) (uintptr_t) this << 16) ^ 0x9e3779b97f4a7c15ULL;
+        recv_buffer_.resize(64 * 1024);
+        thread_ = std::thread(&EngineLoop::run, this);
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            signal_locked();
+        }
+        if (thread_.joinable()) thread_.join();
+        if (epfd_ >= 0) close(epfd_);
+        if (evfd_ >= 0) close(evfd_);
+        epfd_ = -1;
+        evfd_ = -1;
+    }
+
+    // 任意线程：在引擎线程上执行 task
+    void post(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        signal_locked();
+    }
+
+    // 任意线程（持有会话的 mutex_）：会话收件队列有新消息
+    void schedule(std::shared_ptr<EngineSession> session) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(session));
+        signal_locked();
+    }
+
+    int session_count() const { return session_count_.load(std::memory_order_relaxed); }
+
+    // 任意线程：等待全部会话关闭
+    bool wait_empty(int64_t timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return empty_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                  [this] { return session_count_.load() == 0; });
+    }
+
+    // 任意线程：关闭全部会话（引擎销毁时）
+    void close_all(int64_t deadline_us) {
+        post([this, deadline_us] {
+            std::vector<std::shared_ptr<EngineSession>> sessions;
+            for (auto &entry : sessions_) sessions.push_back(entry.second);
+            for (auto &session : sessions) session->begin_close(deadline_us);
+        });
+    }
+
+    int64_t cpu_us() const {
+        if (!has_cpu_clock_.load(std::memory_order_acquire)) return 0;
+        struct timespec ts;
+        if (clock_gettime(cpu_clock_, &ts) != 0) return 0;
+        return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    // 引擎线程
+    void add(const std::shared_ptr<EngineSession> &session) {
+        sessions_[session.get()] = session;
+    }
+
+    // 引擎线程：会话延迟到本轮事件处理完再释放（同一批事件中可能还有它的条目）
+    void remove(EngineSession *session) {
+        auto it = sessions_.find(session);
+        if (it == sessions_.end()) return;
+        graveyard_.push_back(it->second);
+        sessions_.erase(it);
+        std::lock_guard<std::mutex> lock(mutex_);
+        session_count_.fetch_sub(1);
+        if (session_count_.load() == 0) empty_cv_.notify_all();
+    }
+
+    // 任意线程：open 时预先计数，负载均衡据此选择线程
+    void reserve() { session_count_.fetch_add(1); }
+
+    bool watch(EngineSession *session, int fd) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.ptr = session;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            LOGE("epoll_ctl ADD 失败: %s", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void set_write_interest(EngineSession *session, int fd, bool writable) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = writable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.ptr = session;
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    void unwatch(int fd) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    void set_timer(EngineSession *session, int64_t due_us) {
+        clear_timer(session);
+        session->timer_ = timers_.insert(std::make_pair(due_us, session));
+        session->timer_set_ = true;
+    }
+
+    void clear_timer(EngineSession *session) {
+        if (!session->timer_set_) return;
+        timers_.erase(session->timer_);
+        session->timer_set_ = false;
+    }
+
+    uint32_t random() {
+        // xorshift64*：只用于握手随机字节与重连抖动
+        rng_ ^= rng_ >> 12;
+        rng_ ^= rng_ << 25;
+        rng_ ^= rng_ >> 27;
+        return (uint32_t) ((rng_ * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    std::vector<uint8_t> &recv_buffer() { return recv_buffer_; }
+    std::deque<EngineMessage> &batch() { return batch_; }
+    std::vector<EngineMessage> &done() { return done_; }
+
+    std::atomic<uint64_t> wakeups{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<int> publishing{0};
+
+private:
+    void signal_locked() {
+        if (signaled_) return;
+        signaled_ = true;
+        uint64_t one = 1;
+        ssize_t ignored = write(evfd_, &one, sizeof(one));
+        (void) ignored;
+    }
+
+    void run() {
+        if (pthread_getcpuclockid(pthread_self(), &cpu_clock_) == 0) {
+            has_cpu_clock_.store(true, std::memory_order_release);
+        }
+        struct epoll_event events[kMaxEvents];
+        std::vector<std::function<void()>> tasks;
+        std::vector<std::shared_ptr<EngineSession>> ready;
+        bool stopping = false;
+        while (!stopping) {
+            int timeout_ms = -1;
+            if (!timers_.empty()) {
+                int64_t wait_us = timers_.begin()->first - send_stats_now_us();
+                timeout_ms = wait_us <= 0 ? 0 : (int) std::min<int64_t>((wait_us + 999) / 1000, INT_MAX);
+            }
+            int n = epoll_wait(epfd_, events, kMaxEvents, timeout_ms);
+            if (n < 0 && errno != EINTR) {
+                LOGE("epoll_wait 失败: %s", strerror(errno));
+                break;
+            }
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+            int64_t now_us = send_stats_now_us();
+            for (int i = 0; i < n; ++i) {
+                EngineSession *session = static_cast<EngineSession *>(events[i].data.ptr);
+                if (session != nullptr) {
+                    session->on_events(events[i].events, now_us);
+                    continue;
+                }
+                uint64_t value;
+                ssize_t ignored = read(evfd_, &value, sizeof(value));
+                (void) ignored;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    signaled_ = false;
+                    tasks.swap(tasks_);
+                    ready.swap(ready_);
+                    stopping = stopping_;
+                }
+                for (auto &task : tasks) task();
+                tasks.clear();
+                for (auto &s : ready) s->drain_inbox(now_us);
+                ready.clear();
+            }
+            now_us = send_stats_now_us();
+            while (!timers_.empty() && timers_.begin()->first <= now_us) {
+                EngineSession *session = timers_.begin()->second;
+                timers_.erase(timers_.begin());
+                session->timer_set_ = false;
+                session->on_timer(now_us);
+            }
+            graveyard_.clear();
+        }
+        // 停止时仍未关闭的会话直接断开
+        std::vector<std::shared_ptr<EngineSession>> remaining;
+        for (auto &entry : sessions_) remaining.push_back(entry.second);
+        for (auto &session : remaining) session->finish_close();
+        graveyard_.clear();
+        has_cpu_clock_.store(false, std::memory_order_release);
+    }
+
+    int epfd_ = -1;
+    int evfd_ = -1;
+    std::thread thread_;
+    clockid_t cpu_clock_;
+    std::atomic<bool> has_cpu_clock_{false};
+
+    std::mutex mutex_;
+    std::condition_variable empty_cv_;
+    std::vector<std::function<void()>> tasks_;
+    std::vector<std::shared_ptr<EngineSession>> ready_;
+    bool stopping_ = false;
+    bool signaled_ = false;   // eventfd 已写入、尚未被引擎线程读取
+    std::atomic<int> session_count_{0};
+
+    // 以下只由引擎线程访问
+    std::map<EngineSession *, std::shared_ptr<EngineSession>> sessions_;
+    std::vector<std::shared_ptr<EngineSession>> graveyard_;
+    std::multimap<int64_t, EngineSession *> timers_;
+    std::vector<uint8_t> recv_buffer_;
+    std::deque<EngineMessage> batch_;
+    std::vector<EngineMessage> done_;
+    uint64_t rng_ = 0;
+};
+
+EngineSession::EngineSession(EngineLoop *loop, const rtmp_engine_config &config, const struct sockaddr_in &addr,
+                             const std::string &app, const std::string &stream, const std::string &tc_url)
+    : loop_(loop), config_(config), addr_(addr), app_(app), stream_(stream), tc_url_(tc_url),
+      reader_([this](const RtmpMessage &message) { on_message(message); }) {}
+
+EngineMessage EngineSession::take_message_locked() {
+    if (spare_.empty()) return EngineMessage();
+    EngineMessage message = std::move(spare_.back());
+    spare_.pop_back();
+    return message;
+}
+
+int EngineSession::push_locked(EngineMessage &message) {
+    int64_t size = (int64_t) message.body.size();
+    if (queued_bytes_.load(std::memory_order_relaxed) + size > config_.max_queue_bytes) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        // 丢掉视频帧切断了参考链
+        if (message.type == RTMP_PACKET_TYPE_VIDEO) waiting_keyframe_ = true;
+        if (spare_.size() < kMaxSpareMessages) spare_.push_back(std::move(message));
+        return RTMP_ENGINE_DROPPED;
+    }
+    queued_bytes_.fetch_add(size, std::memory_order_relaxed);
+    inbox_.push_back(std::move(message));
+    if (publishing_ && !scheduled_) {
+        scheduled_ = true;
+        loop_->schedule(shared_from_this());
+    }
+    return 0;
+}
+
+bool EngineSession::push_pending_locked() {
+    if (!publishing_) return true;  // publish 成功时由引擎线程统一发送
+    struct Pending {
+        bool *flag;
+        const std::vector<uint8_t> *body;
+        uint8_t type;
+        uint8_t channel;
+    } pending[] = {
+        {&metadata_pending_, &metadata_, RTMP_PACKET_TYPE_INFO, 0x03},
+        {&video_config_pending_, &video_config_, RTMP_PACKET_TYPE_VIDEO, 0x04},
+        {&audio_config_pending_, &audio_config_, RTMP_PACKET_TYPE_AUDIO, 0x04},
+    };
+    for (auto &p : pending) {
+        if (!*p.flag || p.body->empty()) continue;
+        EngineMessage message = take_message_locked();
+        message.body.assign(p.body->begin(), p.body->end());
+        message.type = p.type;
+        message.channel = p.channel;
+        message.timestamp = 0;
+        message.media = true;
+        message.frame = false;
+        if (push_locked(message) != 0) return false;
+        *p.flag = false;
+    }
+    return true;
+}
+
+void EngineSession::set_metadata(int width, int height, int video_bitrate, int fps, int sample_rate, int channels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    width_ = width;
+    height_ = height;
+    video_bitrate_ = video_bitrate;
+    fps_ = fps;
+    if (sample_rate > 0 && channels > 0 && (sample_rate != sample_rate_ || channels != channels_)) {
+        sample_rate_ = sample_rate;
+        channels_ = channels;
+        audio_config_.clear();
+    }
+    build_configs_locked();
+    push_pending_locked();
+}
+
+void EngineSession::build_configs_locked() {
+    if (width_ > 0 && height_ > 0) {
+        char body[1024];
+        int size = build_on_metadata_body(body, sizeof(body), width_, height_, video_bitrate_, fps_,
+                                          sample_rate_, channels_);
+        if (size > 0 && (metadata_.size() != (size_t) size || memcmp(metadata_.data(), body, size) != 0)) {
+            metadata_.assign(body, body + size);
+            metadata_pending_ = true;
+        }
+    }
+    if (audio_config_.empty()) {
+        uint8_t body[32];
+        int size = build_audio_sequence_header(RTMP_AUDIO_CODEC_AAC, sample_rate_, channels_, body, sizeof(body));
+        if (size > 0) {
+            audio_config_.assign(body, body + size);
+            audio_config_pending_ = true;
+        }
+    }
+}
+
+int EngineSession::send_video(const uint8_t *data, int size, uint32_t timestamp, bool key) {
+    if (data == nullptr || size <= 0) return -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!accepting_) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        return RTMP_ENGINE_DROPPED;
+    }
+    // 参数集只在关键帧（或尚无序列头时）中查找，普通帧不多扫描一遍
+    if (key || video_config_.empty()) {
+        parse_parameter_sets(data, size, RTMP_VIDEO_CODEC_H264, next_vps_, next_sps_, next_pps_);
+        if (!next_sps_.empty() && !next_pps_.empty() && (next_sps_ != sps_ || next_pps_ != pps_)) {
+            sps_ = next_sps_;
+            pps_ = next_pps_;
+            if (build_video_sequence_header(RTMP_VIDEO_CODEC_H264, vps_, sps_, pps_, video_config_) < 0) {
+                video_config_.clear();
+            } else {
+                video_config_pending_ = true;
+            }
+        }
+    }
+    EngineMessage message = take_message_locked();
+    if (annexb_to_video_body(data, size, key, RTMP_VIDEO_CODEC_H264, message.body) == 0) {
+        // 只含参数集 / SEI
+        if (spare_.size() < kMaxSpareMessages) spare_.push_back(std::move(message));
+        return 0;
+    }
+    if (video_config_.empty() || (waiting_keyframe_ && !key) || !push_pending_locked()) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        if (spare_.size() < kMaxSpareMessages) spare_.push_back(std::move(message));
+        return RTMP_ENGINE_DROPPED;
+    }
+    message.type = RTMP_PACKET_TYPE_VIDEO;
+    message.channel = 0x04;
+    message.timestamp = timestamp;
+    message.media = true;
+    message.frame = true;
+    int result = push_locked(message);
+    if (result == 0 && key) waiting_keyframe_ = false;
+    return result;
+}
+
+int EngineSession::send_audio(const uint8_t *data, int size, uint32_t timestamp) {
+    if (data == nullptr || size <= 0) return -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!accepting_) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        return RTMP_ENGINE_DROPPED;
+    }
+    build_configs_locked();
+    if (!push_pending_locked()) {
+        dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        return RTMP_ENGINE_DROPPED;
+    }
+    int offset = 0;
+    if (size > 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) offset = 7;  // 跳过 ADTS 头
+    uint8_t header[FLV_AUDIO_HEADER_MAX];
+    int header_size = build_audio_frame_header(RTMP_AUDIO_CODEC_AAC, sample_rate_, channels_, header);
+    EngineMessage message = take_message_locked();
+    message.body.assign(header, header + header_size);
+    message.body.insert(message.body.end(), data + offset, data + size);
+    message.type = RTMP_PACKET_TYPE_AUDIO;
+    message.channel = 0x04;
+    message.timestamp = timestamp;
+    message.media = true;
+    message.frame = true;
+    return push_locked(message);
+}
+
+void EngineSession::snapshot(rtmp_engine_session_stats *out) const {
+    out->state = state_.load(std::memory_order_acquire);
+    out->reconnects = reconnects_.load(std::memory_order_relaxed);
+    out->bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    out->video_frames = video_frames_.load(std::memory_order_relaxed);
+    out->audio_frames = audio_frames_.load(std::memory_order_relaxed);
+    out->dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+    out->queued_bytes = queued_bytes_.load(std::memory_order_relaxed);
+    out->rtt_us = rtt_us_.load(std::memory_order_relaxed);
+    out->connect_us = connect_us_.load(std::memory_order_relaxed);
+}
+
+void EngineSession::set_state(int state) {
+    int old = state_.exchange(state, std::memory_order_acq_rel);
+    if (old == RTMP_ENGINE_PUBLISHING && state != RTMP_ENGINE_PUBLISHING) loop_->publishing.fetch_sub(1);
+    if (old != RTMP_ENGINE_PUBLISHING && state == RTMP_ENGINE_PUBLISHING) loop_->publishing.fetch_add(1);
+}
+
+int64_t EngineSession::tick_us() const {
+    // 不发送 ping 时仍按超时的三分之一检查发送停滞
+    int64_t ms = config_.ping_interval_ms > 0 ? config_.ping_interval_ms : config_.ping_timeout_ms / 3;
+    return std::max<int64_t>(ms, 1) * 1000;
+}
+
+void EngineSession::start_connect(int64_t now_us) {
+    connect_start_us_ = now_us;
+    phase_ = PHASE_TCP;
+    set_state(RTMP_ENGINE_CONNECTING);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        fail(strerror(errno), now_us);
+        return;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if (connect(fd, (const struct sockaddr *) &addr_, sizeof(addr_)) != 0 && errno != EINPROGRESS) {
+        int err = errno;
+        close(fd);
+        fail(strerror(err), now_us);
+        return;
+    }
+    if (!loop_->watch(this, fd)) {
+        close(fd);
+        fail("注册 socket 失败", now_us);
+        return;
+    }
+    fd_ = fd;
+    want_write_ = true;
+    loop_->set_timer(this, now_us + (int64_t) config_.connect_timeout_ms * 1000);
+}
+
+void EngineSession::on_events(uint32_t events, int64_t now_us) {
+    if (fd_ < 0) return;
+    if (phase_ == PHASE_TCP) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) on_connected(now_us);
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        on_readable(now_us);
+        if (fd_ < 0) return;
+    }
+    if ((events & EPOLLOUT) && !wire_.empty()) flush(now_us);
+}
+
+void EngineSession::on_connected(int64_t now_us) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+    if (err != 0) {
+        fail(strerror(err), now_us);
+        return;
+    }
+    phase_ = PHASE_HANDSHAKE;
+    set_state(RTMP_ENGINE_HANDSHAKING);
+    last_recv_us_ = now_us;
+    // C0 + C1：版本 3，4 字节时间、4 字节 0 与随机数据（简单握手，不做 digest）
+    uint8_t c0c1[1 + kHandshakeSize];
+    c0c1[0] = 3;
+    write_be32(c0c1 + 1, (uint32_t) (now_us / 1000));
+    memset(c0c1 + 5, 0, 4);
+    for (int i = 9; i < 1 + kHandshakeSize; i += 4) write_be32(c0c1 + i, loop_->random());
+    queue_raw(c0c1, sizeof(c0c1));
+    flush(now_us);
+}
+
+void EngineSession::on_readable(int64_t now_us) {
+    std::vector<uint8_t> &buffer = loop_->recv_buffer();
+    for (;;) {
+        ssize_t n = recv(fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (n == 0) {
+            fail("服务端关闭了连接", now_us);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            fail(strerror(errno), now_us);
+            return;
+        }
+        received_ += (uint64_t) n;
+        last_recv_us_ = now_us;
+        parsing_ = true;
+        if (phase_ == PHASE_HANDSHAKE) {
+            on_handshake(buffer.data(), (size_t) n);
+        } else if (!reader_.feed(buffer.data(), (size_t) n)) {
+            error_ = "chunk 流解析失败";
+        }
+        parsing_ = false;
+        if (error_ != nullptr) {
+            const char *reason = error_;
+            error_ = nullptr;
+            fail(reason, now_us);
+            return;
+        }
+        if (phase_ >= PHASE_CONNECT && window_ack_size_ > 0 && received_ - acked_ >= window_ack_size_ / 2) {
+            uint8_t body[4];
+            write_be32(body, (uint32_t) received_);
+            queue_control(RTMP_PACKET_TYPE_BYTES_READ_REPORT, body, sizeof(body));
+            acked_ = received_;
+        }
+        if ((size_t) n < buffer.size()) break;
+    }
+    if (!wire_.empty()) flush(now_us);
+}
+
+void EngineSession::on_handshake(const uint8_t *data, size_t size) {
+    const size_t total = 1 + 2 * kHandshakeSize;
+    size_t take = std::min(size, total - handshake_.size());
+    handshake_.insert(handshake_.end(), data, data + take);
+    if (handshake_.size() < total) return;
+    if (handshake_[0] != 3) {
+        error_ = "服务端握手版本不是 3";
+        return;
+    }
+    // C2 回显 S1；S2 不做校验（与 librtmp 的简单握手相同）
+    queue_raw(handshake_.data() + 1, kHandshakeSize);
+    handshake_.clear();
+    uint8_t body[4];
+    write_be32(body, (uint32_t) config_.chunk_size);
+    queue_control(RTMP_PACKET_TYPE_CHUNK_SIZE, body, sizeof(body));
+    out_chunk_size_ = (uint32_t) config_.chunk_size;
+
+    CommandWriter w;
+    w.string("connect");
+    w.number(kTxnConnect);
+    w.begin_object();
+    w.named_string("app", app_);
+    w.named_string("type", "nonprivate");
+    w.named_string("flashVer", "FMLE/3.0 (compatible; FMSc/1.0)");
+    w.named_string("tcUrl", tc_url_);
+    w.end_object();
+    queue_command(0x03, 0, w);
+    phase_ = PHASE_CONNECT;
+    if (take < size && !reader_.feed(data + take, size - take)) error_ = "chunk 流解析失败";
+}
+
+void EngineSession::on_message(const RtmpMessage &message) {
+    const uint8_t *body = message.body;
+    switch (message.type) {
+        case RTMP_PACKET_TYPE_CHUNK_SIZE:
+            if (message.size >= 4) {
+                uint32_t size = read_be32(body) & 0x7fffffff;
+                if (size == 0) {
+                    error_ = "服务端 chunk size 为 0";
+                } else {
+                    reader_.set_chunk_size(size);
+                }
+            }
+            break;
+        case RTMP_PACKET_TYPE_CONTROL:
+            if (message.size >= 6 && body[0] == 0 && body[1] == 6) {
+                // ping 请求：原样回显时间戳
+                uint8_t reply[6] = {0, 7, body[2], body[3], body[4], body[5]};
+                queue_control(RTMP_PACKET_TYPE_CONTROL, reply, sizeof(reply));
+            } else if (message.size >= 2 && body[0] == 0 && body[1] == 7 && ping_sent_us_ > 0) {
+                rtt_us_.store(send_stats_now_us() - ping_sent_us_, std::memory_order_relaxed);
+                ping_sent_us_ = 0;
+            }
+            break;
+        case RTMP_PACKET_TYPE_SERVER_BW:
+            if (message.size >= 4) window_ack_size_ = read_be32(body);
+            break;
+        case RTMP_PACKET_TYPE_INVOKE:
+            on_command(body, message.size);
+            break;
+        case RTMP_PACKET_TYPE_FLEX_MESSAGE:
+            // AMF3 命令：首字节为 0 之后是 AMF0 编码
+            if (message.size > 1) on_command(body + 1, message.size - 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void EngineSession::on_command(const uint8_t *body, uint32_t size) {
+    AMFObject obj;
+    if (AMF_Decode(&obj, reinterpret_cast<const char *>(body), (int) size, FALSE) < 0) {
+        error_ = "命令消息解码失败";
+        return;
+    }
+    AVal method = {nullptr, 0};
+    AMFProp_GetString(AMF_GetProp(&obj, nullptr, 0), &method);
+    double txn = AMFProp_GetNumber(AMF_GetProp(&obj, nullptr, 1));
+    if (aval_equals(method, "_result")) {
+        if (txn == kTxnConnect && phase_ == PHASE_CONNECT) {
+            CommandWriter release;
+            release.string("releaseStream");
+            release.number(kTxnReleaseStream);
+            release.null();
+            release.string(stream_);
+            queue_command(0x03, 0, release);
+            CommandWriter fc_publish;
+            fc_publish.string("FCPublish");
+            fc_publish.number(kTxnFCPublish);
+            fc_publish.null();
+            fc_publish.string(stream_);
+            queue_command(0x03, 0, fc_publish);
+            CommandWriter create;
+            create.string("createStream");
+            create.number(kTxnCreateStream);
+            create.null();
+            queue_command(0x03, 0, create);
+            phase_ = PHASE_CREATE_STREAM;
+        } else if (txn == kTxnCreateStream && phase_ == PHASE_CREATE_STREAM) {
+            stream_id_ = (uint32_t) AMFProp_GetNumber(AMF_GetProp(&obj, nullptr, 3));
+            CommandWriter publish;
+            publish.string("publish");
+            publish.number(kTxnPublish);
+            publish.null();
+            publish.string(stream_);
+            publish.string("live");
+            queue_command(0x04, stream_id_, publish);
+            phase_ = PHASE_PUBLISH;
+        }
+    } else if (aval_equals(method, "_error")) {
+        // releaseStream / FCPublish 被拒绝很常见，不影响推流
+        if (txn == kTxnConnect || txn == kTxnCreateStream || txn == kTxnPublish) {
+            LOGE("服务端拒绝命令（事务 %d）: %s/%s", (int) txn, app_.c_str(), stream_.c_str());
+            error_ = "服务端拒绝了命令";
+        }
+    } else if (aval_equals(method, "onStatus")) {
+        AMFObject info;
+        AVal code = {nullptr, 0};
+        AVal level = {nullptr, 0};
+        AVal code_name = make_aval("code");
+        AVal level_name = make_aval("level");
+        AMFProp_GetObject(AMF_GetProp(&obj, nullptr, 3), &info);
+        AMFProp_GetString(AMF_GetProp(&info, &code_name, -1), &code);
+        AMFProp_GetString(AMF_GetProp(&info, &level_name, -1), &level);
+        if (aval_equals(code, "NetStream.Publish.Start") && phase_ == PHASE_PUBLISH) {
+            on_publish_start(send_stats_now_us());
+        } else if (aval_equals(level, "error")) {
+            LOGE("onStatus 错误: %.*s", code.av_len, code.av_val != nullptr ? code.av_val : "");
+            error_ = "服务端返回错误状态";
+        }
+    } else if (aval_equals(method, "close")) {
+        error_ = "服务端关闭了会话";
+    }
+    AMF_Reset(&obj);
+}
+
+void EngineSession::on_publish_start(int64_t now_us) {
+    phase_ = PHASE_LIVE;
+    connect_us_.store(now_us - connect_start_us_, std::memory_order_relaxed);
+    if (ever_published_) reconnects_.fetch_add(1, std::memory_order_relaxed);
+    ever_published_ = true;
+    failures_ = 0;
+    ping_sent_us_ = 0;
+    set_state(RTMP_ENGINE_PUBLISHING);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        publishing_ = true;
+        // 连接期间排队的帧之前依次发送 onMetaData、视频与音频序列头（不受队列上限约束）
+        struct Config {
+            const std::vector<uint8_t> *body;
+            uint8_t type;
+            uint8_t channel;
+        } configs[] = {
+            {&audio_config_, RTMP_PACKET_TYPE_AUDIO, 0x04},
+            {&video_config_, RTMP_PACKET_TYPE_VIDEO, 0x04},
+            {&metadata_, RTMP_PACKET_TYPE_INFO, 0x03},
+        };
+        for (auto &c : configs) {
+            if (c.body->empty()) continue;
+            EngineMessage message = take_message_locked();
+            message.body.assign(c.body->begin(), c.body->end());
+            message.type = c.type;
+            message.channel = c.channel;
+            message.timestamp = 0;
+            message.media = true;
+            message.frame = false;
+            queued_bytes_.fetch_add((int64_t) message.body.size(), std::memory_order_relaxed);
+            inbox_.push_front(std::move(message));
+        }
+        metadata_pending_ = false;
+        video_config_pending_ = false;
+        audio_config_pending_ = false;
+    }
+    LOGD("开始推流: %s/%s，连接耗时 %lld us%s", app_.c_str(), stream_.c_str(),
+         (long long) (now_us - connect_start_us_), reconnects_.load() > 0 ? "（重连）" : "");
+    drain_inbox(now_us);
+    if (fd_ >= 0) loop_->set_timer(this, now_us + tick_us());
+}
+
+void EngineSession::drain_inbox(int64_t now_us) {
+    std::deque<EngineMessage> &batch = loop_->batch();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scheduled_ = false;
+        if (phase_ != PHASE_LIVE || fd_ < 0) return;
+        batch.swap(inbox_);
+    }
+    if (batch.empty()) return;
+    if (wire_.empty()) last_progress_us_ = now_us;
+    for (auto &message : batch) {
+        prepare(message);
+        wire_.push_back(std::move(message));
+    }
+    batch.clear();
+    flush(now_us);
+}
+
+void EngineSession::prepare(EngineMessage &message) {
+    message.iov_index = 0;
+    message.iov.clear();
+    message.headers.clear();
+    if (message.type == 0) {
+        struct iovec v;
+        v.iov_base = message.body.data();
+        v.iov_len = message.body.size();
+        message.iov.push_back(v);
+        return;
+    }
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_packetType = message.type;
+    packet.m_nChannel = message.channel;
+    packet.m_nTimeStamp = message.timestamp;
+    packet.m_nInfoField2 = (int32_t) (message.media ? stream_id_ : message.stream_id);
+    packet.m_nBodySize = (uint32_t) message.body.size();
+    packet.m_body = reinterpret_cast<char *>(message.body.data());
+    const uint8_t *body = message.body.data();
+    const uint8_t *body_end = body + message.body.size();
+    size_t chunks = message.body.empty() ? 1 : (message.body.size() + out_chunk_size_ - 1) / out_chunk_size_;
+    // 预留全部 chunk 头的空间，iovec 指向 headers 的指针在序列化过程中保持有效
+    message.headers.reserve(chunks * RTMP_CHUNK_HEADER_MAX);
+    rtmp_write_chunks(&packet, (int) out_chunk_size_, [&](const uint8_t *data, size_t len) {
+        struct iovec v;
+        if (data >= body && data < body_end) {
+            v.iov_base = const_cast<uint8_t *>(data);
+        } else {
+            size_t at = message.headers.size();
+            message.headers.insert(message.headers.end(), data, data + len);
+            v.iov_base = message.headers.data() + at;
+        }
+        v.iov_len = len;
+        message.iov.push_back(v);
+    });
+}
+
+void EngineSession::queue_raw(const uint8_t *data, size_t size) {
+    EngineMessage message;
+    message.body.assign(data, data + size);
+    message.type = 0;
+    prepare(message);
+    wire_.push_back(std::move(message));
+}
+
+void EngineSession::queue_control(uint8_t type, const uint8_t *body, uint32_t size) {
+    EngineMessage message;
+    message.body.assign(body, body + size);
+    message.type = type;
+    message.channel = 0x02;
+    message.stream_id = 0;
+    prepare(message);
+    if (wire_.empty()) last_progress_us_ = send_stats_now_us();
+    wire_.push_back(std::move(message));
+}
+
+void EngineSession::queue_command(int channel, uint32_t stream_id, const CommandWriter &command) {
+    EngineMessage message;
+    message.body.assign(command.buf, command.buf + command.size());
+    message.type = RTMP_PACKET_TYPE_INVOKE;
+    message.channel = (uint8_t) channel;
+    message.stream_id = stream_id;
+    prepare(message);
+    if (wire_.empty()) last_progress_us_ = send_stats_now_us();
+    wire_.push_back(std::move(message));
+}
+
+void EngineSession::flush(int64_t now_us) {
+    if (fd_ < 0 || parsing_) return;  // 解析回调中入队的消息由 on_readable 随后写出
+    std::vector<EngineMessage> &done = loop_->done();
+    struct iovec iov[kMaxIov];
+    while (!wire_.empty()) {
+        // 多条消息合并为一次 sendmsg
+        int count = 0;
+        for (auto it = wire_.begin(); it != wire_.end() && count < kMaxIov; ++it) {
+            for (size_t i = it->iov_index; i < it->iov.size() && count < kMaxIov; ++i) iov[count++] = it->iov[i];
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        loop_->writes.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            int err = errno;
+            recycle(done);
+            fail(strerror(err), now_us);
+            return;
+        }
+        bytes_sent_.fetch_add((uint64_t) n, std::memory_order_relaxed);
+        loop_->bytes_sent.fetch_add((uint64_t) n, std::memory_order_relaxed);
+        last_progress_us_ = now_us;
+        size_t left = (size_t) n;
+        while (left > 0) {
+            EngineMessage &m = wire_.front();
+            struct iovec &v = m.iov[m.iov_index];
+            if (left >= v.iov_len) {
+                left -= v.iov_len;
+                m.iov_index++;
+            } else {
+                v.iov_base = static_cast<uint8_t *>(v.iov_base) + left;
+                v.iov_len -= left;
+                left = 0;
+            }
+            if (m.iov_index == m.iov.size()) {
+                if (m.media) queued_bytes_.fetch_sub((int64_t) m.body.size(), std::memory_order_relaxed);
+                if (m.frame) {
+                    (m.type == RTMP_PACKET_TYPE_VIDEO ? video_frames_ : audio_frames_).fetch_add(1, std::memory_order_relaxed);
+                }
+                done.push_back(std::move(m));
+                wire_.pop_front();
+            }
+        }
+    }
+    recycle(done);
+    bool want_write = !wire_.empty();
+    if (want_write != want_write_) {
+        loop_->set_write_interest(this, fd_, want_write);
+        want_write_ = want_write;
+    }
+    if (closing_ && wire_.empty()) finish_close();
+}
+
+void EngineSession::recycle(std::vector<EngineMessage> &done) {
+    if (done.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &message : done) {
+        if (spare_.size() >= kMaxSpareMessages) break;
+        spare_.push_back(std::move(message));
+    }
+    done.clear();
+}
+
+void EngineSession::close_socket() {
+    loop_->clear_timer(this);
+    if (fd_ >= 0) {
+        loop_->unwatch(fd_);
+        close(fd_);
+        fd_ = -1;
+    }
+    want_write_ = false;
+    reader_.reset();
+    handshake_.clear();
+    phase_ = PHASE_TCP;
+    out_chunk_size_ = 128;
+    stream_id_ = 0;
+    received_ = 0;
+    acked_ = 0;
+    window_ack_size_ = 2500000;
+    ping_sent_us_ = 0;
+}
+
+void EngineSession::discard_queues() {
+    uint64_t dropped = 0;
+    std::vector<EngineMessage> &done = loop_->done();
+    for (auto &message : wire_) {
+        if (message.media) queued_bytes_.fetch_sub((int64_t) message.body.size(), std::memory_order_relaxed);
+        if (message.frame) dropped++;
+        done.push_back(std::move(message));
+    }
+    wire_.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        publishing_ = false;
+        waiting_keyframe_ = true;
+        for (auto &message : inbox_) {
+            queued_bytes_.fetch_sub((int64_t) message.body.size(), std::memory_order_relaxed);
+            if (message.frame) dropped++;
+        }
+        inbox_.clear();
+    }
+    recycle(done);
+    dropped_frames_.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+void EngineSession::fail(const char *reason, int64_t now_us) {
+    LOGE("会话断线 %s/%s: %s", app_.c_str(), stream_.c_str(), reason);
+    close_socket();
+    discard_queues();
+    if (closing_) {
+        finish_close();
+        return;
+    }
+    failures_++;
+    if (config_.max_reconnects < 0 || (config_.max_reconnects > 0 && failures_ > config_.max_reconnects)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            accepting_ = false;
+        }
+        set_state(RTMP_ENGINE_FAILED);
+        LOGE("会话 %s/%s 连续失败 %d 次，不再重连", app_.c_str(), stream_.c_str(), failures_);
+        return;
+    }
+    // 指数退避，±20% 随机抖动避免大量会话同时重连
+    int64_t delay_ms = config_.reconnect_min_ms;
+    for (int i = 1; i < failures_ && delay_ms < config_.reconnect_max_ms; ++i) delay_ms *= 2;
+    delay_ms = std::min<int64_t>(delay_ms, config_.reconnect_max_ms);
+    delay_ms = delay_ms * (80 + (int64_t) (loop_->random() % 41)) / 100;
+    set_state(RTMP_ENGINE_RECONNECT_WAIT);
+    loop_->set_timer(this, now_us + delay_ms * 1000);
+}
+
+void EngineSession::on_timer(int64_t now_us) {
+    if (closing_) {
+        LOGE("关闭超时，丢弃未写出的 %zu 条消息", wire_.size());
+        finish_close();
+        return;
+    }
+    switch (state_.load(std::memory_order_relaxed)) {
+        case RTMP_ENGINE_CONNECTING:
+        case RTMP_ENGINE_HANDSHAKING:
+            fail("连接超时", now_us);
+            return;
+        case RTMP_ENGINE_RECONNECT_WAIT:
+            LOGD("重连 %s/%s（第 %d 次）", app_.c_str(), stream_.c_str(), failures_);
+            start_connect(now_us);
+            return;
+        case RTMP_ENGINE_PUBLISHING: {
+            int64_t timeout_us = (int64_t) config_.ping_timeout_ms * 1000;
+            if (config_.ping_interval_ms > 0 && now_us - last_recv_us_ > timeout_us) {
+                fail("长时间未收到服务端数据", now_us);
+                return;
+            }
+            if (!wire_.empty() && now_us - last_progress_us_ > timeout_us) {
+                fail("发送停滞", now_us);
+                return;
+            }
+            if (config_.ping_interval_ms > 0 && ping_sent_us_ == 0) {
+                uint8_t body[6] = {0, 6};
+                write_be32(body + 2, (uint32_t) (now_us / 1000));
+                queue_control(RTMP_PACKET_TYPE_CONTROL, body, sizeof(body));
+                ping_sent_us_ = now_us;
+                flush(now_us);
+                if (fd_ < 0) return;
+            }
+            loop_->set_timer(this, now_us + tick_us());
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+void EngineSession::begin_close(int64_t deadline_us) {
+    if (closing_ || state_.load() == RTMP_ENGINE_CLOSED) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accepting_ = false;
+    }
+    int64_t now_us = send_stats_now_us();
+    if (phase_ == PHASE_LIVE) drain_inbox(now_us);
+    closing_ = true;
+    if (phase_ != PHASE_LIVE || fd_ < 0) {
+        finish_close();
+        return;
+    }
+    CommandWriter unpublish;
+    unpublish.string("FCUnpublish");
+    unpublish.number(kTxnFCUnpublish);
+    unpublish.null();
+    unpublish.string(stream_);
+    queue_command(0x03, 0, unpublish);
+    CommandWriter remove;
+    remove.string("deleteStream");
+    remove.number(kTxnDeleteStream);
+    remove.null();
+    remove.number(stream_id_);
+    queue_command(0x03, 0, remove);
+    loop_->set_timer(this, deadline_us);
+    flush(now_us);
+}
+
+void EngineSession::finish_close() {
+    if (state_.load() == RTMP_ENGINE_CLOSED) return;
+    closing_ = true;
+    close_socket();
+    discard_queues();
+    // 先从线程的会话计数中移除再置为 CLOSED，rtmp_engine_close 返回后引擎统计已不含该会话
+    loop_->remove(this);
+    set_state(RTMP_ENGINE_CLOSED);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        accepting_ = false;
+        closed_cv_.notify_all();
+    }
+}
+
+PublishEngine::PublishEngine(const rtmp_engine_config *config) : config_(normalize_config(config)) {}
+
+PublishEngine::~PublishEngine() {
+    int64_t deadline_us = send_stats_now_us() + 1000000;
+    for (auto &loop : loops_) loop->close_all(deadline_us);
+    for (auto &loop : loops_) loop->wait_empty(1500);
+    for (auto &loop : loops_) loop->stop();
+}
+
+bool PublishEngine::start() {
+    for (int i = 0; i < config_.threads; ++i) {
+        std::unique_ptr<EngineLoop> loop(new EngineLoop());
+        if (!loop->start()) return false;
+        loops_.push_back(std::move(loop));
+    }
+    LOGD("推流引擎启动: %d 个 epoll 线程, chunk size %d", config_.threads, config_.chunk_size);
+    return true;
+}
+
+std::shared_ptr<EngineSession> PublishEngine::open(const char *url) {
+    if (url == nullptr || strlen(url) > kMaxUrlLength || loops_.empty()) {
+        LOGE("无效的推流地址");
+        return nullptr;
+    }
+    int protocol = 0;
+    unsigned int port = 0;
+    AVal host = {nullptr, 0}, playpath = {nullptr, 0}, app = {nullptr, 0};
+    if (!RTMP_ParseURL(url, &protocol, &host, &port, &playpath, &app)) {
+        LOGE("无法解析推流地址: %s", url);
+        return nullptr;
+    }
+    std::string stream(playpath.av_val != nullptr ? playpath.av_val : "", playpath.av_len);
+    free(playpath.av_val);
+    if (protocol != RTMP_PROTOCOL_RTMP || stream.empty() || host.av_len == 0) {
+        LOGE("推流引擎只支持带流名的 rtmp:// 地址: %s", url);
+        return nullptr;
+    }
+    std::string host_name(host.av_val, host.av_len);
+    std::string app_name(app.av_val != nullptr ? app.av_val : "", app.av_len);
+    if (port == 0) port = 1935;
+
+    // 只解析一次，重连复用（与 wrapper 相同只支持 IPv4）
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(host_name.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        LOGE("无法解析主机名: %s", host_name.c_str());
+        return nullptr;
+    }
+    struct sockaddr_in addr;
+    memcpy(&addr, result->ai_addr, sizeof(addr));
+    freeaddrinfo(result);
+    addr.sin_port = htons((uint16_t) port);
+
+    std::string tc_url = "rtmp://" + host_name + ":" + std::to_string(port) + "/" + app_name;
+    EngineLoop *loop = loops_[0].get();
+    for (auto &l : loops_) {
+        if (l->session_count() < loop->session_count()) loop = l.get();
+    }
+    loop->reserve();
+    std::shared_ptr<EngineSession> session =
+        std::make_shared<EngineSession>(loop, config_, addr, app_name, stream, tc_url);
+    loop->post([loop, session] {
+        loop->add(session);
+        session->start_connect(send_stats_now_us());
+    });
+    return session;
+}
+
+void PublishEngine::close(const std::shared_ptr<EngineSession> &session, int timeout_ms) {
+    int64_t deadline_us = send_stats_now_us() + (int64_t) std::max(timeout_ms, 0) * 1000;
+    session->loop_->post([session, deadline_us] { session->begin_close(deadline_us); });
+    std::unique_lock<std::mutex> lock(session->mutex_);
+    session->closed_cv_.wait_for(lock, std::chrono::milliseconds(std::max(timeout_ms, 0) + 1000),
+                                 [&] { return session->state() == RTMP_ENGINE_CLOSED; });
+}
+
+void PublishEngine::snapshot(rtmp_engine_stats *out) const {
+    memset(out, 0, sizeof(*out));
+    out->threads = (int) loops_.size();
+    for (auto &loop : loops_) {
+        out->sessions += loop->session_count();
+        out->publishing += loop->publishing.load(std::memory_order_relaxed);
+        out->wakeups += loop->wakeups.load(std::memory_order_relaxed);
+        out->writes += loop->writes.load(std::memory_order_relaxed);
+        out->bytes_sent += loop->bytes_sent.load(std::memory_order_relaxed);
+        out->cpu_us += loop->cpu_us();
+    }
+}
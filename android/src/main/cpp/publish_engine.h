@@ -0,0 +1,190 @@
+#ifndef PUBLISH_ENGINE_H
+#define PUBLISH_ENGINE_H
+
+#include "rtmp_chunk.h"
+#include "rtmp_wrapper.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+/*
+ * 事件驱动推流引擎（Linux epoll）。
+ *
+ * wrapper 的每个连接都需要调用方的发送线程（Kotlin 层每路音视频各一个），阻塞 socket 上的 librtmp 写与握手
+ * 各占一个线程；服务端转推、多路录制等场景一个进程要推几百路流时，线程数与上下文切换成为主要开销。本引擎
+ * 把 N 个会话分配到固定的少量 epoll 线程上：
+ *   - 连接、RTMP 握手与 connect/createStream/publish 命令都是非阻塞状态机，由 socket 可读/可写事件推进；
+ *   - 调用方线程只把 Annex-B/AAC 封装为 FLV tag body 放入会话的收件队列，必要时写 eventfd 唤醒所属线程；
+ *     引擎线程把收件队列整体换出，按 chunk 序列化为 iovec（chunk 头 + 指向 body 的负载片段），
+ *     多条消息合并为一次 sendmsg，写不完时注册 EPOLLOUT 等待；
+ *   - 每个会话一个定时器（连接超时、ping 与发送停滞检测、重连退避），所有定时器按到期时间排序，
+ *     epoll_wait 的超时取最早的到期时间；
+ *   - 接收方向以 RtmpChunkReader 增量解析：应答 ping 请求、按窗口大小发送 Acknowledgement、跟随 Set Chunk Size。
+ * 断线后清空队列、等待下一个关键帧，按指数退避加随机抖动重连，publish 成功后先重发 onMetaData 与音视频序列头。
+ */
+
+class EngineLoop;
+struct CommandWriter;
+
+// 一条待发送的 RTMP 消息；对象连同各缓冲区的容量在会话内循环复用
+struct EngineMessage {
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> headers;     // chunk 头（原始字节消息为全部内容）
+    std::vector<struct iovec> iov;    // 线上顺序的片段，写出后 iov_index 之前的部分已完成
+    size_t iov_index = 0;
+    uint8_t type = 0;                 // 0 表示原始字节（握手）
+    uint8_t channel = 0;
+    uint32_t stream_id = 0;
+    uint32_t timestamp = 0;
+    bool media = false;               // 计入 queued_bytes（音视频帧、onMetaData 与序列头）
+    bool frame = false;               // 计入 video_frames/audio_frames
+};
+
+class EngineSession : public std::enable_shared_from_this<EngineSession> {
+public:
+    EngineSession(EngineLoop *loop, const rtmp_engine_config &config, const struct sockaddr_in &addr,
+                  const std::string &app, const std::string &stream, const std::string &tc_url);
+
+    void set_metadata(int width, int height, int video_bitrate, int fps, int sample_rate, int channels);
+    // 返回 0、RTMP_ENGINE_DROPPED 或 -1
+    int send_video(const uint8_t *data, int size, uint32_t timestamp, bool key);
+    int send_audio(const uint8_t *data, int size, uint32_t timestamp);
+    void snapshot(rtmp_engine_session_stats *out) const;
+    int state() const { return state_.load(std::memory_order_acquire); }
+
+    EngineSession(const EngineSession &) = delete;
+    EngineSession &operator=(const EngineSession &) = delete;
+
+private:
+    friend class EngineLoop;
+    friend class PublishEngine;
+
+    // 以下由调用方线程在 mutex_ 内调用（引擎线程在 publish 成功时同样在 mutex_ 内取用缓存的序列头）
+    EngineMessage take_message_locked();
+    // 按队列上限入队，返回 0 或 RTMP_ENGINE_DROPPED
+    int push_locked(EngineMessage &message);
+    // 推流中时把变化了的 onMetaData / 序列头排在下一帧之前；入队失败返回 false
+    bool push_pending_locked();
+    void build_configs_locked();
+
+    // 以下只在引擎线程上调用
+    void set_state(int state);
+    int64_t tick_us() const;
+    void start_connect(int64_t now_us);
+    void on_events(uint32_t events, int64_t now_us);
+    void on_timer(int64_t now_us);
+    void on_connected(int64_t now_us);
+    void on_readable(int64_t now_us);
+    void on_handshake(const uint8_t *data, size_t size);
+    void on_message(const RtmpMessage &message);
+    void on_command(const uint8_t *body, uint32_t size);
+    void on_publish_start(int64_t now_us);
+    void begin_close(int64_t deadline_us);
+    void drain_inbox(int64_t now_us);
+    void flush(int64_t now_us);
+    void fail(const char *reason, int64_t now_us);
+    void finish_close();
+    void close_socket();
+    void discard_queues();
+    void queue_raw(const uint8_t *data, size_t size);
+    void queue_control(uint8_t type, const uint8_t *body, uint32_t size);
+    void queue_command(int channel, uint32_t stream_id, const CommandWriter &command);
+    void prepare(EngineMessage &message);
+    void recycle(std::vector<EngineMessage> &done);
+
+    EngineLoop *loop_;
+    const rtmp_engine_config config_;
+    const struct sockaddr_in addr_;
+    const std::string app_;
+    const std::string stream_;
+    const std::string tc_url_;
+
+    // 调用方线程与引擎线程共用
+    mutable std::mutex mutex_;
+    std::condition_variable closed_cv_;      // 进入 CLOSED 时通知
+    std::deque<EngineMessage> inbox_;         // 尚未交给引擎线程的消息
+    std::vector<EngineMessage> spare_;
+    bool scheduled_ = false;                  // 已在所属线程的待处理列表中
+    bool accepting_ = true;                   // 关闭或重连次数用尽后不再接受新帧
+    bool publishing_ = false;
+    bool waiting_keyframe_ = true;
+    std::vector<uint8_t> vps_, sps_, pps_;
+    std::vector<uint8_t> next_vps_, next_sps_, next_pps_;
+    std::vector<uint8_t> video_config_;       // 最近一次的 AVC 序列头，publish 成功后首先发送
+    std::vector<uint8_t> audio_config_;
+    std::vector<uint8_t> metadata_;
+    bool metadata_pending_ = false;           // 缓存内容变化后尚未入队
+    bool video_config_pending_ = false;
+    bool audio_config_pending_ = false;
+    int width_ = 0, height_ = 0, video_bitrate_ = 0, fps_ = 0;
+    int sample_rate_ = 44100, channels_ = 1;
+
+    std::atomic<int> state_{RTMP_ENGINE_CONNECTING};
+    std::atomic<int> reconnects_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> video_frames_{0};
+    std::atomic<uint64_t> audio_frames_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<int64_t> queued_bytes_{0};
+    std::atomic<int64_t> rtt_us_{-1};
+    std::atomic<int64_t> connect_us_{0};
+
+    // 以下只由引擎线程访问
+    enum Phase { PHASE_TCP, PHASE_HANDSHAKE, PHASE_CONNECT, PHASE_CREATE_STREAM, PHASE_PUBLISH, PHASE_LIVE };
+    int fd_ = -1;
+    Phase phase_ = PHASE_TCP;
+    bool want_write_ = false;                 // 已注册 EPOLLOUT
+    bool closing_ = false;
+    bool ever_published_ = false;
+    bool parsing_ = false;                    // 正在 reader_.feed 中：回调只入队，不写 socket、不断线
+    const char *error_ = nullptr;             // 解析回调中发现的致命错误，feed 返回后处理
+    std::deque<EngineMessage> wire_;          // 已序列化、等待写入 socket
+    std::vector<uint8_t> handshake_;          // 收到的 S0+S1+S2
+    RtmpChunkReader reader_;
+    uint32_t out_chunk_size_ = 128;
+    uint32_t stream_id_ = 0;
+    uint64_t received_ = 0;
+    uint64_t acked_ = 0;
+    uint32_t window_ack_size_ = 2500000;
+    int failures_ = 0;                        // 连续失败次数，publish 成功后清零
+    int64_t connect_start_us_ = 0;
+    int64_t last_recv_us_ = 0;
+    int64_t last_progress_us_ = 0;            // 最近一次写出数据（或发送队列由空变为非空）的时刻
+    int64_t ping_sent_us_ = 0;                // 未收到应答的 ping 发出时刻，0 表示没有
+    bool timer_set_ = false;
+    std::multimap<int64_t, EngineSession *>::iterator timer_;
+};
+
+class PublishEngine {
+public:
+    explicit PublishEngine(const rtmp_engine_config *config);
+    ~PublishEngine();  // 关闭全部会话（最多等待 1 秒）并停止 epoll 线程
+
+    // 创建 epoll 线程，失败返回 false
+    bool start();
+
+    // 解析地址并把会话交给负载最小的线程，失败返回空
+    std::shared_ptr<EngineSession> open(const char *url);
+
+    // 关闭会话并等待其进入 CLOSED（最多 timeout_ms 加 1 秒余量）
+    void close(const std::shared_ptr<EngineSession> &session, int timeout_ms);
+
+    void snapshot(rtmp_engine_stats *out) const;
+
+    PublishEngine(const PublishEngine &) = delete;
+    PublishEngine &operator=(const PublishEngine &) = delete;
+
+private:
+    rtmp_engine_config config_;
+    std::vector<std::unique_ptr<EngineLoop>> loops_;
+};
+
+#endif // PUBLISH_ENGINE_H
@@ -0,0 +1,186 @@
+#include "rtmp_chunk.h"
+#include <algorithm>
+
+static int basic_header_size(int channel) {
+    if (channel > 319) return 3;
+    if (channel > 63) return 2;
+    return 1;
+}
+
+size_t rtmp_chunked_size(const RTMPPacket *packet, int chunk_size) {
+    uint32_t body_size = packet->m_nBodySize;
+    size_t chunks = body_size > 0 ? (body_size + chunk_size - 1) / (uint32_t) chunk_size : 1;
+    size_t continuation = (size_t) basic_header_size(packet->m_nChannel) +
+                          (packet->m_nTimeStamp >= 0xffffff ? 4 : 0);
+    // 首个 chunk 比后续 chunk 多 11 字节消息头
+    return body_size + chunks * continuation + 11;
+}
+
+int rtmp_chunk_header(const RTMPPacket *packet, int index, uint8_t *out) {
+    int channel = packet->m_nChannel;
+    int basic = basic_header_size(channel);
+    uint32_t t = packet->m_nTimeStamp;
+    uint8_t *p = out;
+    uint8_t fmt = index == 0 ? 0x00 : 0xc0;
+    if (basic == 1) {
+        *p++ = (uint8_t) (fmt | channel);
+    } else {
+        *p++ = (uint8_t) (fmt | (basic == 3 ? 1 : 0));
+        int id = channel - 64;
+        *p++ = (uint8_t) (id & 0xff);
+        if (basic == 3) *p++ = (uint8_t) (id >> 8);
+    }
+    if (index == 0) {
+        uint32_t t24 = t > 0xffffff ? 0xffffff : t;
+        *p++ = (uint8_t) (t24 >> 16);
+        *p++ = (uint8_t) (t24 >> 8);
+        *p++ = (uint8_t) t24;
+        uint32_t size = packet->m_nBodySize;
+        *p++ = (uint8_t) (size >> 16);
+        *p++ = (uint8_t) (size >> 8);
+        *p++ = (uint8_t) size;
+        *p++ = packet->m_packetType;
+        // 消息流 id 为小端序
+        uint32_t stream_id = (uint32_t) packet->m_nInfoField2;
+        *p++ = (uint8_t) stream_id;
+        *p++ = (uint8_t) (stream_id >> 8);
+        *p++ = (uint8_t) (stream_id >> 16);
+        *p++ = (uint8_t) (stream_id >> 24);
+    }
+    if (t >= 0xffffff) {
+        *p++ = (uint8_t) (t >> 24);
+        *p++ = (uint8_t) (t >> 16);
+        *p++ = (uint8_t) (t >> 8);
+        *p++ = (uint8_t) t;
+    }
+    return (int) (p - out);
+}
+
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+}
+
+bool RtmpChunkReader::feed(const uint8_t *data, size_t size) {
+    if (!pending_.empty()) {
+        // 上次剩下的不完整 chunk：只补足到一个 chunk 的最大长度，解析出这个 chunk 后其余字节原地解析
+        size_t had = pending_.size();
+        size_t max_chunk = RTMP_CHUNK_HEADER_MAX + (size_t) chunk_size_;
+        size_t take = std::min(size, max_chunk > had ? max_chunk - had : 0);
+        pending_.insert(pending_.end(), data, data + take);
+        long n = parse_chunk(pending_.data(), pending_.size());
+        if (n < 0) return false;
+        // 补足到最大长度仍不完整只能是协议错误
+        if (n == 0) return take == size;
+        // pending_ 只含不完整的 chunk，解析出的 chunk 必然用到了本次喂入的字节
+        size_t used = (size_t) n - had;
+        pending_.clear();
+        data += used;
+        size -= used;
+    }
+    size_t consumed = 0;
+    while (consumed < size) {
+        long n = parse_chunk(data + consumed, size - consumed);
+        if (n < 0) return false;
+        if (n == 0) break;
+        consumed += (size_t) n;
+    }
+    pending_.assign(data + consumed, data + size);
+    return true;
+}
+
+void RtmpChunkReader::reset() {
+    channels_.clear();
+    pending_.clear();
+    chunk_size_ = 128;
+}
+
+void RtmpChunkReader::prime(int channel, uint8_t type, uint32_t stream_id, uint32_t length, uint32_t timestamp) {
+    Channel &ch = channels_[channel];
+    ch.started = true;
+    ch.extended = false;
+    ch.type = type;
+    ch.stream_id = stream_id;
+    ch.timestamp = timestamp;
+    ch.ts_field = 0;
+    ch.length = length;
+    ch.body.clear();
+}
+
+long RtmpChunkReader::parse_chunk(const uint8_t *data, size_t size) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    int fmt = p[0] >> 6;
+    int channel = p[0] & 0x3f;
+    p++;
+    if (channel == 0) {
+        if (end - p < 1) return 0;
+        channel = 64 + p[0];
+        p++;
+    } else if (channel == 1) {
+        if (end - p < 2) return 0;
+        channel = 64 + p[0] + ((int) p[1] << 8);
+        p += 2;
+    }
+    static const int kHeaderSizes[4] = {11, 7, 3, 0};
+    if (end - p < kHeaderSizes[fmt]) return 0;
+
+    auto it = channels_.find(channel);
+    if (fmt != 0 && (it == channels_.end() || !it->second.started)) return -1;
+    Channel &ch = it != channels_.end() ? it->second : channels_[channel];
+    bool new_message = ch.body.empty();
+    uint32_t ts_field = ch.ts_field;
+    bool extended = ch.extended;
+    uint32_t length = ch.length;
+    uint8_t type = ch.type;
+    uint32_t stream_id = ch.stream_id;
+    if (fmt <= 2) {
+        ts_field = read_be24(p);
+        extended = ts_field == 0xffffff;
+    }
+    if (fmt <= 1) {
+        length = read_be24(p + 3);
+        type = p[6];
+    }
+    if (fmt == 0) {
+        stream_id = (uint32_t) p[7] | ((uint32_t) p[8] << 8) | ((uint32_t) p[9] << 16) | ((uint32_t) p[10] << 24);
+    }
+    p += kHeaderSizes[fmt];
+    if (extended) {
+        if (end - p < 4) return 0;
+        // fmt3 延续块的扩展时间戳与消息首块相同，只在开始新消息时取用
+        if (fmt <= 2 || new_message) ts_field = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+        p += 4;
+    }
+    if (length > kMaxMessageSize) return -1;
+    // 消息中途只允许 fmt3 延续块
+    if (!new_message && fmt != 3) return -1;
+    uint32_t remaining = new_message ? length : length - (uint32_t) ch.body.size();
+    uint32_t n = remaining < chunk_size_ ? remaining : chunk_size_;
+    if ((size_t) (end - p) < n) return 0;
+
+    // 整个 chunk 已到齐才更新通道状态，数据不足时下次从 chunk 起点重新解析
+    if (new_message) {
+        ch.started = true;
+        ch.extended = extended;
+        ch.ts_field = ts_field;
+        ch.length = length;
+        ch.type = type;
+        ch.stream_id = stream_id;
+        ch.timestamp = fmt == 0 ? ts_field : ch.timestamp + ts_field;
+    }
+    if (new_message && n == length) {
+        // 单 chunk 消息直接交出输入缓冲区中的负载，不拷贝
+        RtmpMessage message = {ch.type, channel, ch.stream_id, ch.timestamp, p, length};
+        handler_(message);
+        return (long) (p + n - data);
+    }
+    if (new_message) ch.body.reserve(length);
+    ch.body.insert(ch.body.end(), p, p + n);
+    p += n;
+    if (ch.body.size() == ch.length) {
+        RtmpMessage message = {ch.type, channel, ch.stream_id, ch.timestamp, ch.body.data(), ch.length};
+        handler_(message);
+        ch.body.clear();
+    }
+    return (long) (p - data);
+}
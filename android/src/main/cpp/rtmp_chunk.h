@@ -0,0 +1,114 @@
+#ifndef RTMP_CHUNK_H
+#define RTMP_CHUNK_H
+
+#include "librtmp/rtmp.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+/*
+ * RTMP chunk 序列化（不涉及 socket）：与 RTMP_SendPacket 对 RTMP_PACKET_SIZE_LARGE 消息的输出逐字节一致——
+ * 首个 chunk 为 fmt0 头，后续为 fmt3 头；时间戳 >= 0xffffff 时每个 chunk 都带 4 字节扩展时间戳；
+ * chunk stream id 超过 63/319 时使用 2/3 字节基本头。
+ * 不修改 packet->m_body（RTMP_SendPacket 会把后续 chunk 头写进已发送的 body 末尾），也不更新 librtmp 的
+ * 通道压缩状态：只用于整条消息都以 fmt0 发送的通道。
+ */
+
+// 单个 chunk 头的最大长度：3 字节基本头 + 11 字节消息头 + 4 字节扩展时间戳
+#define RTMP_CHUNK_HEADER_MAX 18
+
+/**
+ * 消息按 chunk_size 分块后的线上字节数（含所有 chunk 头）
+ */
+size_t rtmp_chunked_size(const RTMPPacket *packet, int chunk_size);
+
+/**
+ * 写出第 index 个 chunk 的头（index 为 0 时为 fmt0，否则为 fmt3）
+ * @return 头的字节数
+ */
+int rtmp_chunk_header(const RTMPPacket *packet, int index, uint8_t *out);
+
+/**
+ * 按线上顺序依次把 chunk 头与负载片段交给 sink(const uint8_t *data, size_t len)，调用方决定写到哪里
+ * （连续缓冲区、多个注册缓冲区等），负载片段直接指向 packet->m_body
+ */
+template <typename Sink>
+void rtmp_write_chunks(const RTMPPacket *packet, int chunk_size, Sink &&sink) {
+    uint8_t header[RTMP_CHUNK_HEADER_MAX];
+    const uint8_t *body = reinterpret_cast<const uint8_t *>(packet->m_body);
+    uint32_t remaining = packet->m_nBodySize;
+    int index = 0;
+    do {
+        sink(header, (size_t) rtmp_chunk_header(packet, index++, header));
+        uint32_t n = remaining < (uint32_t) chunk_size ? remaining : (uint32_t) chunk_size;
+        if (n > 0) sink(body, (size_t) n);
+        body += n;
+        remaining -= n;
+    } while (remaining > 0);
+}
+
+// 接收方向重组出的一条完整消息，body 只在回调期间有效
+struct RtmpMessage {
+    uint8_t type;
+    int channel;
+    uint32_t stream_id;
+    uint32_t timestamp;     // 绝对时间戳（fmt1~3 已累加 delta）
+    const uint8_t *body;
+    uint32_t size;
+};
+
+/*
+ * 增量 chunk 解析（接收方向，不涉及 socket）：按任意边界喂入字节流，每重组出一条消息回调一次。
+ * 整条消息在一个 chunk 内时回调直接指向喂入的数据，多 chunk 消息拷贝进通道缓冲区重组；跨越两次 feed 的 chunk
+ * 只把这一个 chunk 拼接进内部缓冲区，其后的字节仍原地解析。
+ * 支持 fmt0~3 头压缩、扩展时间戳与 2/3 字节基本头；Set Chunk Size 由调用方在回调中 set_chunk_size
+ * （对之后的 chunk 生效，与 RTMP_ReadPacket 相同），回调中不能 reset。fmt3 开始新消息时沿用上一个头的时间戳字段作为 delta。
+ */
+class RtmpChunkReader {
+public:
+    typedef std::function<void(const RtmpMessage &message)> Handler;
+
+    // 单条消息的上限，超过视为协议错误
+    static const uint32_t kMaxMessageSize = 16 * 1024 * 1024;
+
+    explicit RtmpChunkReader(Handler handler) : handler_(handler) {}
+
+    /**
+     * 喂入收到的字节，不完整的 chunk 留在内部缓冲区等待后续数据
+     * @return 成功返回 true；协议错误（未知通道以 fmt1~3 开始、消息过大）返回 false，之后须 reset
+     */
+    bool feed(const uint8_t *data, size_t size);
+
+    void set_chunk_size(uint32_t chunk_size) { chunk_size_ = chunk_size; }
+    uint32_t chunk_size() const { return chunk_size_; }
+
+    // 丢弃全部通道状态与未解析的字节（重连时调用），chunk size 恢复为 128
+    void reset();
+
+    // 从其他解析器（如 librtmp）接手字节流时沿用其通道状态：之后该通道可以直接以 fmt1~3 头开始新消息
+    void prime(int channel, uint8_t type, uint32_t stream_id, uint32_t length, uint32_t timestamp);
+
+private:
+    struct Channel {
+        bool started = false;      // 收到过 fmt0 头
+        bool extended = false;     // 最近一个头使用了扩展时间戳（fmt3 chunk 随之携带）
+        uint8_t type = 0;
+        uint32_t stream_id = 0;
+        uint32_t timestamp = 0;
+        uint32_t ts_field = 0;     // 最近一个头的时间戳字段（fmt0 为绝对值，fmt1/2 为 delta）
+        uint32_t length = 0;
+        std::vector<uint8_t> body; // 正在重组的消息，size() 为已收到的字节数
+    };
+
+    // 解析 data[0..size) 开头的一个 chunk；数据不足返回 0，协议错误返回 -1，否则返回消耗的字节数
+    long parse_chunk(const uint8_t *data, size_t size);
+
+    Handler handler_;
+    uint32_t chunk_size_ = 128;
+    std::map<int, Channel> channels_;
+    std::vector<uint8_t> pending_;  // 上一次 feed 剩下的不完整 chunk（不超过一个 chunk 的最大长度）
+};
+
+#endif // RTMP_CHUNK_H
@@ -1,13 +1,138 @@
 #include <jni.h>
 #include <string>
-#include <android/log.h>
+#include <map>
+#include <mutex>
+#include "bb_log.h"
 #include "rtmp_wrapper.h"
+#include "frame_trace.h"
 #include <android/api-level.h>
 #include <android/hardware_buffer_jni.h>
+#include <pthread.h>
 
 #define TAG "RtmpJNI"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static JavaVM *g_vm = nullptr;
+
+// 关键帧请求监听器（全局引用），按连接句柄索引；回调时按句柄查找，避免 close 后访问已释放的引用
+static std::map<long, jobject> g_keyframe_listeners;
+static std::mutex g_listener_mutex;
+static jmethodID g_on_keyframe_request = nullptr;
+
+// 零拷贝发送的缓冲区释放监听器（全局引用），同样按连接句柄索引
+static std::map<long, jobject> g_release_listeners;
+static jmethodID g_on_buffer_released = nullptr;
+
+// 释放回调每帧触发一次、关键帧请求回调也可能频繁触发：native 线程首次回调时 attach，线程退出时才 detach
+static pthread_key_t g_detach_key;
+static pthread_once_t g_detach_key_once = PTHREAD_ONCE_INIT;
+
+static void release_listener(JNIEnv *env, std::map<long, jobject> &listeners, long handle) {
+    std::lock_guard<std::mutex> lock(g_listener_mutex);
+    auto it = listeners.find(handle);
+    if (it != listeners.end()) {
+        env->DeleteGlobalRef(it->second);
+        listeners.erase(it);
+    }
+}
+
+static void release_keyframe_listener(JNIEnv *env, long handle) {
+    release_listener(env, g_keyframe_listeners, handle);
+}
+
+/*
+ * 从监听器接口（而非注册对象的具体类）解析回调方法，所有句柄的监听器共用同一个 jmethodID。
+ * 在 Java 线程中调用，FindClass 使用应用的类加载器
+ */
+static jmethodID find_listener_method(JNIEnv *env, const char *interface_name, const char *name, const char *sig) {
+    jclass listenerClass = env->FindClass(interface_name);
+    if (listenerClass == nullptr) {
+        env->ExceptionClear();
+        LOGE("未找到监听器接口: %s", interface_name);
+        return nullptr;
+    }
+    jmethodID method = env->GetMethodID(listenerClass, name, sig);
+    env->DeleteLocalRef(listenerClass);
+    if (method == nullptr) {
+        env->ExceptionClear();
+        LOGE("未找到 %s.%s%s 方法", interface_name, name, sig);
+    }
+    return method;
+}
+
+static void detach_thread(void *) {
+    if (g_vm != nullptr) g_vm->DetachCurrentThread();
+}
+
+static void create_detach_key() {
+    pthread_key_create(&g_detach_key, detach_thread);
+}
+
+static JNIEnv *attach_until_thread_exit() {
+    JNIEnv *env = nullptr;
+    if (g_vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) return env;
+    if (g_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) return nullptr;
+    pthread_once(&g_detach_key_once, create_detach_key);
+    pthread_setspecific(g_detach_key, env);
+    return env;
+}
+
+static void on_buffer_released(rtmp_handle_t handle, long token, int result, void *user_data) {
+    (void) user_data;
+    if (g_vm == nullptr) return;
+    JNIEnv *env = attach_until_thread_exit();
+    if (env == nullptr) {
+        LOGE("缓冲区释放回调：AttachCurrentThread 失败");
+        return;
+    }
+
+    jobject listener = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_listener_mutex);
+        auto it = g_release_listeners.find(handle);
+        if (it != g_release_listeners.end()) {
+            listener = env->NewLocalRef(it->second);
+        }
+    }
+    if (listener != nullptr) {
+        env->CallVoidMethod(listener, g_on_buffer_released, (jlong) token, (jint) result);
+        if (env->ExceptionCheck()) {
+            LOGE("缓冲区释放回调抛出异常");
+            env->ExceptionClear();
+        }
+        env->DeleteLocalRef(listener);
+    }
+}
+
+static void on_keyframe_request(rtmp_handle_t handle, int reason, void *user_data) {
+    (void) user_data;
+    if (g_vm == nullptr) return;
+
+    // 回调来自发送线程（每条连接都可能多次触发），与释放回调一样保持 attach 到线程退出
+    JNIEnv *env = attach_until_thread_exit();
+    if (env == nullptr) {
+        LOGE("关键帧请求回调：AttachCurrentThread 失败");
+        return;
+    }
+
+    jobject listener = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_listener_mutex);
+        auto it = g_keyframe_listeners.find(handle);
+        if (it != g_keyframe_listeners.end()) {
+            listener = env->NewLocalRef(it->second);
+        }
+    }
+    if (listener != nullptr) {
+        env->CallVoidMethod(listener, g_on_keyframe_request, (jint) reason);
+        if (env->ExceptionCheck()) {
+            LOGE("关键帧请求回调抛出异常");
+            env->ExceptionClear();
+        }
+        env->DeleteLocalRef(listener);
+    }
+}
 
 extern "C" {
 
@@ -35,6 +160,7 @@ JNIEXPORT jint JNICALL
 Java_com_bb_rtmp_RtmpNative_sendVideo(JNIEnv *env, jclass clazz, jlong handle,
                                        jbyteArray data, jint size, jlong timestamp,
                                        jboolean isKeyFrame) {
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_VIDEO, timestamp, size);
     if (data == nullptr || size <= 0) {
         LOGE("无效的视频数据");
         return -1;
@@ -56,6 +182,7 @@ JNIEXPORT jint JNICALL
 Java_com_bb_rtmp_RtmpNative_sendVideoBuffer(JNIEnv *env, jclass clazz, jlong handle,
                                              jlong buffer, jint offset, jint size,
                                              jlong timestamp, jboolean isKeyFrame) {
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_VIDEO, timestamp, size);
     if (buffer == 0 || size <= 0) {
         LOGE("无效的视频缓冲区");
         return -1;
@@ -67,9 +194,70 @@ Java_com_bb_rtmp_RtmpNative_sendVideoBuffer(JNIEnv *env, jclass clazz, jlong han
     return result;
 }
 
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_sendVideoAsync(JNIEnv *env, jclass clazz, jlong handle,
+                                            jobject buffer, jint offset, jint size,
+                                            jlong timestamp, jboolean isKeyFrame, jlong token) {
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_VIDEO, timestamp, size);
+    if (buffer == nullptr || size <= 0 || offset < 0) {
+        LOGE("无效的视频缓冲区");
+        return -1;
+    }
+    // MediaCodec 的输出缓冲区为直接缓冲区，地址在 releaseOutputBuffer 之前一直有效
+    unsigned char *base = (unsigned char *) env->GetDirectBufferAddress(buffer);
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (base == nullptr || (jlong) offset + size > capacity) {
+        LOGE("不是直接缓冲区或范围越界: offset=%d, size=%d, capacity=%lld", offset, size, (long long) capacity);
+        return -1;
+    }
+    return rtmp_send_video_async(handle, base + offset, size, timestamp, isKeyFrame, token);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setBufferReleaseListener(JNIEnv *env, jclass clazz, jlong handle,
+                                                      jobject listener, jint maxQueued) {
+    if (g_vm == nullptr) {
+        env->GetJavaVM(&g_vm);
+    }
+
+    if (listener == nullptr) {
+        // 先停止发送线程（未发送的缓冲区仍通过旧监听器归还），再删除引用
+        int result = rtmp_set_buffer_release_callback(handle, nullptr, nullptr, maxQueued);
+        release_listener(env, g_release_listeners, handle);
+        return result;
+    }
+
+    if (g_on_buffer_released == nullptr) {
+        g_on_buffer_released = find_listener_method(env, "com/bb/rtmp/RtmpNative$BufferReleaseListener",
+                                                    "onBufferReleased", "(JI)V");
+        if (g_on_buffer_released == nullptr) return -1;
+    }
+
+    // 旧发送线程停止时仍要用旧监听器归还缓冲区：先注册到 native（停止旧线程），再替换引用
+    jobject ref = env->NewGlobalRef(listener);
+    jobject previous = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_listener_mutex);
+        auto it = g_release_listeners.find(handle);
+        if (it != g_release_listeners.end()) previous = it->second;
+        if (previous == nullptr) g_release_listeners[handle] = ref;
+    }
+    int result = rtmp_set_buffer_release_callback(handle, on_buffer_released, nullptr, maxQueued);
+    if (previous != nullptr) {
+        std::lock_guard<std::mutex> lock(g_listener_mutex);
+        g_release_listeners[handle] = ref;
+        env->DeleteGlobalRef(previous);
+    }
+    if (result != 0) {
+        release_listener(env, g_release_listeners, handle);
+    }
+    return result;
+}
+
 JNIEXPORT jint JNICALL
 Java_com_bb_rtmp_RtmpNative_sendAudio(JNIEnv *env, jclass clazz, jlong handle,
                                        jbyteArray data, jint size, jlong timestamp) {
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_AUDIO, timestamp, size);
     if (data == nullptr || size <= 0) {
         LOGE("无效的音频数据");
         return -1;
@@ -91,6 +279,7 @@ JNIEXPORT jint JNICALL
 Java_com_bb_rtmp_RtmpNative_sendAudioBuffer(JNIEnv *env, jclass clazz, jlong handle,
                                              jlong buffer, jint offset, jint size,
                                              jlong timestamp) {
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_AUDIO, timestamp, size);
     if (buffer == 0 || size <= 0) {
         LOGE("无效的音频缓冲区");
         return -1;
@@ -110,6 +299,16 @@ Java_com_bb_rtmp_RtmpNative_setMetadata(JNIEnv *env, jclass clazz, jlong handle,
     return result;
 }
 
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setVideoCodec(JNIEnv *env, jclass clazz, jlong handle, jint codec) {
+    return rtmp_set_video_codec(handle, codec);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setAudioCodec(JNIEnv *env, jclass clazz, jlong handle, jint codec, jint bitrate) {
+    return rtmp_set_audio_codec(handle, codec, bitrate);
+}
+
 JNIEXPORT jlongArray JNICALL
 Java_com_bb_rtmp_RtmpNative_getStats(JNIEnv *env, jclass clazz, jlong handle) {
     rtmp_stats stats;
@@ -128,9 +327,687 @@ Java_com_bb_rtmp_RtmpNative_getStats(JNIEnv *env, jclass clazz, jlong handle) {
     return result;
 }
 
+static const int kStatsV2Header = 13;
+static const int kStatsV2HistogramFields = 7 + RTMP_HISTOGRAM_BUCKETS;
+static const int kStatsV2ZeroCopyFields = 4;
+static const int kStatsV2DeadlineFields = 3;
+
+static void put_histogram(jlong *out, const rtmp_histogram &histogram) {
+    out[0] = (jlong) histogram.count;
+    out[1] = (jlong) histogram.sum_us;
+    out[2] = (jlong) histogram.max_us;
+    out[3] = (jlong) rtmp_histogram_percentile(&histogram, 50);
+    out[4] = (jlong) rtmp_histogram_percentile(&histogram, 90);
+    out[5] = (jlong) rtmp_histogram_percentile(&histogram, 99);
+    out[6] = (jlong) rtmp_histogram_percentile(&histogram, 99.9);
+    for (int i = 0; i < RTMP_HISTOGRAM_BUCKETS; ++i) {
+        out[7 + i] = (jlong) histogram.buckets[i];
+    }
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getStatsV2(JNIEnv *env, jclass clazz, jlong handle) {
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    if (rtmp_get_stats_v2(handle, &stats) != 0) {
+        return nullptr;
+    }
+
+    // 布局见 RtmpNative.STATS_V2_*：头部计数器之后依次为四个直方图、零拷贝计数，最后是限时发送计数
+    const int length = kStatsV2Header + 4 * kStatsV2HistogramFields + kStatsV2ZeroCopyFields + kStatsV2DeadlineFields;
+    jlong values[length];
+    values[0] = stats.version;
+    values[1] = (jlong) stats.video.bytes;
+    values[2] = (jlong) stats.video.messages;
+    values[3] = (jlong) stats.audio.bytes;
+    values[4] = (jlong) stats.audio.messages;
+    values[5] = (jlong) stats.data.bytes;
+    values[6] = (jlong) stats.data.messages;
+    values[7] = (jlong) stats.chunks;
+    values[8] = (jlong) stats.send_syscalls;
+    values[9] = (jlong) stats.send_failures;
+    values[10] = (jlong) stats.dropped_video_frames;
+    values[11] = stats.queue_depth_bytes;
+    values[12] = stats.max_queue_depth_bytes;
+    put_histogram(values + kStatsV2Header, stats.enqueue_to_wire_us);
+    put_histogram(values + kStatsV2Header + kStatsV2HistogramFields, stats.send_duration_us);
+    put_histogram(values + kStatsV2Header + 2 * kStatsV2HistogramFields, stats.video_frame_gap_us);
+    put_histogram(values + kStatsV2Header + 3 * kStatsV2HistogramFields, stats.zerocopy_completion_us);
+    jlong *zerocopy = values + kStatsV2Header + 4 * kStatsV2HistogramFields;
+    zerocopy[0] = (jlong) stats.zerocopy_messages;
+    zerocopy[1] = (jlong) stats.zerocopy_bytes;
+    zerocopy[2] = (jlong) stats.copy_avoided_bytes;
+    zerocopy[3] = (jlong) stats.zerocopy_copied_bytes;
+    jlong *deadline = zerocopy + kStatsV2ZeroCopyFields;
+    deadline[0] = (jlong) stats.would_block_frames;
+    deadline[1] = (jlong) stats.partial_messages;
+    deadline[2] = (jlong) stats.resumed_bytes;
+
+    jlongArray result = env->NewLongArray(length);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    env->SetLongArrayRegion(result, 0, length, values);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_tlsConfigure(JNIEnv *env, jclass clazz, jstring caFile, jint flags) {
+    const char *caFileStr = caFile != nullptr ? env->GetStringUTFChars(caFile, nullptr) : nullptr;
+    if (caFile != nullptr && caFileStr == nullptr) {
+        return -1;
+    }
+    int result = rtmp_tls_configure(caFileStr, flags);
+    if (caFileStr != nullptr) {
+        env->ReleaseStringUTFChars(caFile, caFileStr);
+    }
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getTlsInfo(JNIEnv *env, jclass clazz, jlong handle) {
+    rtmp_tls_info info;
+    if (rtmp_get_tls_info(handle, &info) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[5] = {info.mode, info.ktls_send, info.ktls_recv, (jlong) info.relay_bytes_out,
+                       (jlong) info.relay_bytes_in};
+    env->SetLongArrayRegion(result, 0, 5, values);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setFastOpen(JNIEnv *env, jclass clazz, jboolean enable) {
+    return rtmp_set_fast_open(enable ? 1 : 0);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getConnectTiming(JNIEnv *env, jclass clazz, jlong handle) {
+    rtmp_connect_timing timing;
+    if (rtmp_get_connect_timing(handle, &timing) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(9);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[9] = {timing.fast_open, timing.dns_us, timing.tcp_connect_us, timing.tls_us, timing.rtmp_connect_us,
+                       timing.connect_stream_us, timing.total_us, timing.rtt_us, timing.saved_rtt_us};
+    env->SetLongArrayRegion(result, 0, 9, values);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setTransport(JNIEnv *env, jclass clazz, jlong handle, jint transport) {
+    return rtmp_set_transport(handle, transport);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setZeroCopy(JNIEnv *env, jclass clazz, jlong handle, jint thresholdBytes, jint chunkSize) {
+    return rtmp_set_zerocopy(handle, thresholdBytes, chunkSize);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setSendDeadline(JNIEnv *env, jclass clazz, jlong handle, jint deadlineMs) {
+    return rtmp_set_send_deadline(handle, deadlineMs);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_flush(JNIEnv *env, jclass clazz, jlong handle, jint timeoutMs) {
+    return rtmp_flush(handle, timeoutMs);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setRtmptBatch(JNIEnv *env, jclass clazz, jlong handle, jint windowMs) {
+    return rtmp_set_rtmpt_batch(handle, windowMs);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getRtmptStats(JNIEnv *env, jclass clazz, jlong handle) {
+    rtmp_rtmpt_stats stats;
+    if (rtmp_get_rtmpt_stats(handle, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(9);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[9] = {(jlong) stats.posts, (jlong) stats.idle_polls, (jlong) stats.messages, (jlong) stats.bytes,
+                       (jlong) stats.responses, (jlong) stats.received_bytes, stats.inflight, stats.max_inflight,
+                       stats.max_post_bytes};
+    env->SetLongArrayRegion(result, 0, 9, values);
+
+    return result;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_playOpen(JNIEnv *env, jclass clazz, jstring url, jint bufferMs) {
+    if (url == nullptr) {
+        LOGE("拉流地址为空");
+        return 0;
+    }
+    const char *urlStr = env->GetStringUTFChars(url, nullptr);
+    if (urlStr == nullptr) {
+        LOGE("获取拉流地址失败");
+        return 0;
+    }
+    rtmp_play_t player = rtmp_play_open(urlStr, bufferMs);
+    env->ReleaseStringUTFChars(url, urlStr);
+    return player;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_playRead(JNIEnv *env, jclass clazz, jlong player, jobject buffer,
+                                     jint offset, jint size, jint timeoutMs) {
+    if (buffer == nullptr || size <= 0 || offset < 0) {
+        LOGE("无效的拉流缓冲区");
+        return -1;
+    }
+    // 直接写进直接缓冲区，不经过 Java 数组中转
+    unsigned char *base = (unsigned char *) env->GetDirectBufferAddress(buffer);
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (base == nullptr || (jlong) offset + size > capacity) {
+        LOGE("不是直接缓冲区或范围越界: offset=%d, size=%d, capacity=%lld", offset, size, (long long) capacity);
+        return -1;
+    }
+    return rtmp_play_read(player, base + offset, size, timeoutMs);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getPlayStats(JNIEnv *env, jclass clazz, jlong player) {
+    rtmp_play_stats stats;
+    if (rtmp_get_play_stats(player, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(8);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[8] = {(jlong) stats.messages, (jlong) stats.tags, (jlong) stats.flv_bytes, (jlong) stats.bytes_in,
+                       (jlong) stats.recv_calls, (jlong) stats.zero_copy_messages, (jlong) stats.copied_bytes,
+                       (jlong) stats.direct_bytes};
+    env->SetLongArrayRegion(result, 0, 8, values);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_playClose(JNIEnv *env, jclass clazz, jlong player) {
+    rtmp_play_close(player);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getUringStats(JNIEnv *env, jclass clazz) {
+    rtmp_uring_stats stats;
+    if (rtmp_get_uring_stats(&stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(9);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[9] = {stats.available, stats.connections, (jlong) stats.enter_calls, (jlong) stats.sqes,
+                       (jlong) stats.batched_enters, (jlong) stats.messages, (jlong) stats.bytes,
+                       (jlong) stats.resubmits, (jlong) stats.timeouts};
+    env->SetLongArrayRegion(result, 0, 9, values);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setAsyncLogging(JNIEnv *env, jclass clazz, jboolean enable) {
+    return rtmp_log_set_async(enable ? 1 : 0);
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_flushLog(JNIEnv *env, jclass clazz) {
+    rtmp_log_flush();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_traceEnable(JNIEnv *env, jclass clazz, jboolean enable) {
+    return rtmp_trace_enable(enable ? 1 : 0);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_traceDump(JNIEnv *env, jclass clazz, jstring path) {
+    if (path == nullptr) {
+        LOGE("追踪文件路径为空");
+        return -1;
+    }
+    const char *pathStr = env->GetStringUTFChars(path, nullptr);
+    if (pathStr == nullptr) {
+        return -1;
+    }
+    int result = rtmp_trace_dump(pathStr);
+    env->ReleaseStringUTFChars(path, pathStr);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_setKeyFrameRequestListener(JNIEnv *env, jclass clazz, jlong handle,
+                                                        jobject listener, jint minIntervalMs) {
+    if (g_vm == nullptr) {
+        env->GetJavaVM(&g_vm);
+    }
+
+    if (listener == nullptr) {
+        int result = rtmp_set_keyframe_request_callback(handle, nullptr, nullptr, minIntervalMs);
+        release_keyframe_listener(env, handle);
+        return result;
+    }
+
+    if (g_on_keyframe_request == nullptr) {
+        g_on_keyframe_request = find_listener_method(env, "com/bb/rtmp/RtmpNative$KeyFrameRequestListener",
+                                                     "onKeyFrameRequest", "(I)V");
+        if (g_on_keyframe_request == nullptr) return -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_listener_mutex);
+        auto it = g_keyframe_listeners.find(handle);
+        if (it != g_keyframe_listeners.end()) {
+            env->DeleteGlobalRef(it->second);
+        }
+        g_keyframe_listeners[handle] = env->NewGlobalRef(listener);
+    }
+
+    int result = rtmp_set_keyframe_request_callback(handle, on_keyframe_request, nullptr, minIntervalMs);
+    if (result != 0) {
+        release_keyframe_listener(env, handle);
+    }
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_notifyVideoDropped(JNIEnv *env, jclass clazz, jlong handle) {
+    return rtmp_notify_video_dropped(handle);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_heartbeatStart(JNIEnv *env, jclass clazz, jlong handle, jbyteArray keyframe,
+                                            jint size, jlong timestamp, jint fps, jint keyframeIntervalMs) {
+    if (keyframe == nullptr || size <= 0) {
+        LOGE("无效的心跳关键帧");
+        return -1;
+    }
+
+    jbyte *dataPtr = env->GetByteArrayElements(keyframe, nullptr);
+    if (dataPtr == nullptr) {
+        LOGE("获取心跳关键帧指针失败");
+        return -1;
+    }
+
+    int result = rtmp_heartbeat_start(handle, (unsigned char *) dataPtr, size, timestamp, fps, keyframeIntervalMs);
+    env->ReleaseByteArrayElements(keyframe, dataPtr, JNI_ABORT);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_heartbeatStop(JNIEnv *env, jclass clazz, jlong handle) {
+    return rtmp_heartbeat_stop(handle);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_startRecording(JNIEnv *env, jclass clazz, jlong handle, jstring path,
+                                            jlong maxSegmentBytes, jint maxSegmentDurationMs) {
+    const char *pathStr = env->GetStringUTFChars(path, nullptr);
+    if (pathStr == nullptr) {
+        LOGE("获取录制路径字符串失败");
+        return -1;
+    }
+
+    int result = rtmp_start_recording(handle, pathStr, (long) maxSegmentBytes, maxSegmentDurationMs);
+    env->ReleaseStringUTFChars(path, pathStr);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_stopRecording(JNIEnv *env, jclass clazz, jlong handle) {
+    return rtmp_stop_recording(handle);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolOpen(JNIEnv *env, jclass clazz, jstring path, jlong capacityBytes) {
+    const char *pathStr = env->GetStringUTFChars(path, nullptr);
+    if (pathStr == nullptr) {
+        LOGE("获取缓存路径字符串失败");
+        return 0;
+    }
+
+    rtmp_spool_t spool = rtmp_spool_open(pathStr, (long) capacityBytes);
+    env->ReleaseStringUTFChars(path, pathStr);
+    return spool;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolBegin(JNIEnv *env, jclass clazz, jlong spool) {
+    return rtmp_spool_begin(spool);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolVideo(JNIEnv *env, jclass clazz, jlong spool,
+                                        jbyteArray data, jint size, jlong timestamp,
+                                        jboolean isKeyFrame) {
+    if (data == nullptr || size <= 0) {
+        LOGE("无效的视频数据");
+        return -1;
+    }
+
+    jbyte *dataPtr = env->GetByteArrayElements(data, nullptr);
+    if (dataPtr == nullptr) {
+        LOGE("获取视频数据指针失败");
+        return -1;
+    }
+
+    int result = rtmp_spool_video(spool, (unsigned char *) dataPtr, size, timestamp, isKeyFrame);
+    env->ReleaseByteArrayElements(data, dataPtr, JNI_ABORT);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolAudio(JNIEnv *env, jclass clazz, jlong spool,
+                                        jbyteArray data, jint size, jlong timestamp) {
+    if (data == nullptr || size <= 0) {
+        LOGE("无效的音频数据");
+        return -1;
+    }
+
+    jbyte *dataPtr = env->GetByteArrayElements(data, nullptr);
+    if (dataPtr == nullptr) {
+        LOGE("获取音频数据指针失败");
+        return -1;
+    }
+
+    int result = rtmp_spool_audio(spool, (unsigned char *) dataPtr, size, timestamp);
+    env->ReleaseByteArrayElements(data, dataPtr, JNI_ABORT);
+
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolDrain(JNIEnv *env, jclass clazz, jlong spool, jlong handle,
+                                        jint mode, jint speedPercent) {
+    return rtmp_spool_drain(spool, handle, mode, speedPercent);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_getSpoolStats(JNIEnv *env, jclass clazz, jlong spool) {
+    rtmp_spool_stats stats;
+    if (rtmp_spool_get_stats(spool, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[5] = {stats.backlog_bytes, stats.backlog_frames, stats.evicted_frames,
+                       stats.drain_rate_bps, stats.drained_bytes};
+    env->SetLongArrayRegion(result, 0, 5, values);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_spoolClose(JNIEnv *env, jclass clazz, jlong spool) {
+    rtmp_spool_close(spool);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_ringCreate(JNIEnv *env, jclass clazz, jint media, jlong capacityBytes, jint maxFrames) {
+    return rtmp_ring_create(media, (long) capacityBytes, maxFrames);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_bb_rtmp_RtmpNative_ringBuffer(JNIEnv *env, jclass clazz, jlong ring) {
+    long capacity = 0;
+    uint8_t *data = rtmp_ring_data(ring, &capacity);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    return env->NewDirectByteBuffer(data, capacity);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_ringReserve(JNIEnv *env, jclass clazz, jlong ring, jint size, jboolean isKeyFrame) {
+    return rtmp_ring_reserve(ring, size, isKeyFrame);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_ringCommit(JNIEnv *env, jclass clazz, jlong ring, jlong timestamp) {
+    return rtmp_ring_commit(ring, (long) timestamp);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_ringFlush(JNIEnv *env, jclass clazz, jlong ring) {
+    return rtmp_ring_flush(ring);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_ringSend(JNIEnv *env, jclass clazz, jlong ring, jlong handle, jlong spool,
+                                      jint timeoutMs) {
+    return rtmp_ring_send(ring, handle, spool, timeoutMs);
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_ringWakeup(JNIEnv *env, jclass clazz, jlong ring) {
+    rtmp_ring_wakeup(ring);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_ringGetStats(JNIEnv *env, jclass clazz, jlong ring) {
+    rtmp_ring_stats stats;
+    if (rtmp_ring_get_stats(ring, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(9);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[9] = {stats.capacity_bytes, stats.used_bytes, stats.max_used_bytes,
+                       stats.queued_frames, stats.max_queued_frames, stats.pushed_frames,
+                       stats.dropped_frames, stats.flushed_frames, stats.wakeups};
+    env->SetLongArrayRegion(result, 0, 9, values);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_ringDestroy(JNIEnv *env, jclass clazz, jlong ring) {
+    rtmp_ring_destroy(ring);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_clockCreate(JNIEnv *env, jclass clazz, jint sampleRate) {
+    return rtmp_clock_create(sampleRate);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_clockAudio(JNIEnv *env, jclass clazz, jlong clock, jlong captureUs, jint samples) {
+    return rtmp_clock_audio(clock, captureUs, samples);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_clockVideo(JNIEnv *env, jclass clazz, jlong clock, jlong captureUs) {
+    return rtmp_clock_video(clock, captureUs);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_clockGetStats(JNIEnv *env, jclass clazz, jlong clock) {
+    rtmp_clock_stats stats;
+    if (rtmp_clock_get_stats(clock, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(8);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[8] = {stats.drift_us, stats.correction_us, (jlong) stats.audio_samples,
+                       (jlong) stats.audio_resyncs, (jlong) stats.audio_clamped, (jlong) stats.video_clamped,
+                       stats.last_audio_ms, stats.last_video_ms};
+    env->SetLongArrayRegion(result, 0, 8, values);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_clockDestroy(JNIEnv *env, jclass clazz, jlong clock) {
+    rtmp_clock_destroy(clock);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_engineCreate(JNIEnv *env, jclass clazz, jint threads, jint chunkSize,
+                                         jint maxQueueBytes, jint connectTimeoutMs, jint pingIntervalMs,
+                                         jint pingTimeoutMs, jint reconnectMinMs, jint reconnectMaxMs,
+                                         jint maxReconnects) {
+    rtmp_engine_config config;
+    config.threads = threads;
+    config.chunk_size = chunkSize;
+    config.max_queue_bytes = maxQueueBytes;
+    config.connect_timeout_ms = connectTimeoutMs;
+    config.ping_interval_ms = pingIntervalMs;
+    config.ping_timeout_ms = pingTimeoutMs;
+    config.reconnect_min_ms = reconnectMinMs;
+    config.reconnect_max_ms = reconnectMaxMs;
+    config.max_reconnects = maxReconnects;
+    return rtmp_engine_create(&config);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_bb_rtmp_RtmpNative_engineOpen(JNIEnv *env, jclass clazz, jlong engine, jstring url) {
+    if (url == nullptr) {
+        LOGE("推流地址为空");
+        return 0;
+    }
+    const char *urlStr = env->GetStringUTFChars(url, nullptr);
+    if (urlStr == nullptr) {
+        LOGE("获取推流地址失败");
+        return 0;
+    }
+    rtmp_session_t session = rtmp_engine_open(engine, urlStr);
+    env->ReleaseStringUTFChars(url, urlStr);
+    return session;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_engineSetMetadata(JNIEnv *env, jclass clazz, jlong session, jint width,
+                                              jint height, jint videoBitrate, jint fps,
+                                              jint audioSampleRate, jint audioChannels) {
+    return rtmp_engine_set_metadata(session, width, height, videoBitrate, fps, audioSampleRate, audioChannels);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_engineSendVideo(JNIEnv *env, jclass clazz, jlong session, jbyteArray data,
+                                            jint size, jlong timestamp, jboolean isKeyFrame) {
+    if (data == nullptr || size <= 0 || size > env->GetArrayLength(data)) {
+        LOGE("无效的视频数据");
+        return -1;
+    }
+    jbyte *dataPtr = env->GetByteArrayElements(data, nullptr);
+    if (dataPtr == nullptr) {
+        LOGE("获取视频数据指针失败");
+        return -1;
+    }
+    int result = rtmp_engine_send_video(session, (const unsigned char *) dataPtr, size, timestamp, isKeyFrame);
+    env->ReleaseByteArrayElements(data, dataPtr, JNI_ABORT);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bb_rtmp_RtmpNative_engineSendAudio(JNIEnv *env, jclass clazz, jlong session, jbyteArray data,
+                                            jint size, jlong timestamp) {
+    if (data == nullptr || size <= 0 || size > env->GetArrayLength(data)) {
+        LOGE("无效的音频数据");
+        return -1;
+    }
+    jbyte *dataPtr = env->GetByteArrayElements(data, nullptr);
+    if (dataPtr == nullptr) {
+        LOGE("获取音频数据指针失败");
+        return -1;
+    }
+    int result = rtmp_engine_send_audio(session, (const unsigned char *) dataPtr, size, timestamp);
+    env->ReleaseByteArrayElements(data, dataPtr, JNI_ABORT);
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_engineGetSessionStats(JNIEnv *env, jclass clazz, jlong session) {
+    rtmp_engine_session_stats stats;
+    if (rtmp_engine_get_session_stats(session, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(9);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[9] = {stats.state, stats.reconnects, (jlong) stats.bytes_sent, (jlong) stats.video_frames,
+                       (jlong) stats.audio_frames, (jlong) stats.dropped_frames, stats.queued_bytes,
+                       stats.rtt_us, stats.connect_us};
+    env->SetLongArrayRegion(result, 0, 9, values);
+
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_bb_rtmp_RtmpNative_engineGetStats(JNIEnv *env, jclass clazz, jlong engine) {
+    rtmp_engine_stats stats;
+    if (rtmp_engine_get_stats(engine, &stats) != 0) {
+        return nullptr;
+    }
+
+    jlongArray result = env->NewLongArray(7);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    jlong values[7] = {stats.threads, stats.sessions, stats.publishing, (jlong) stats.wakeups,
+                       (jlong) stats.writes, (jlong) stats.bytes_sent, stats.cpu_us};
+    env->SetLongArrayRegion(result, 0, 7, values);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_engineClose(JNIEnv *env, jclass clazz, jlong session, jint timeoutMs) {
+    rtmp_engine_close(session, timeoutMs);
+}
+
+JNIEXPORT void JNICALL
+Java_com_bb_rtmp_RtmpNative_engineDestroy(JNIEnv *env, jclass clazz, jlong engine) {
+    rtmp_engine_destroy(engine);
+}
+
 JNIEXPORT void JNICALL
 Java_com_bb_rtmp_RtmpNative_close(JNIEnv *env, jclass clazz, jlong handle) {
     rtmp_close(handle);
+    release_keyframe_listener(env, handle);
+    release_listener(env, g_release_listeners, handle);
     LOGD("RTMP 连接已关闭，handle: %ld", handle);
 }
 
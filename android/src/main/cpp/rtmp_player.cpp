@@ -0,0 +1,244 @@
+#include "rtmp_player.h"
+#include "bb_log.h"
+#include "librtmp/amf.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#define TAG "RtmpPlayer"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static const uint8_t kFlvHeader[13] = {'F', 'L', 'V', 0x01, 0x05, 0, 0, 0, 9, 0, 0, 0, 0};
+static const uint8_t kAggregateType = 22;
+static const AVal av_onStatus = {(char *) "onStatus", 8};
+static const AVal av_code = {(char *) "code", 4};
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+static bool aval_is(const AVal &v, const char *s) {
+    size_t len = strlen(s);
+    return v.av_len == (int) len && memcmp(v.av_val, s, len) == 0;
+}
+
+std::unique_ptr<RtmpPlayer> RtmpPlayer::attach(RTMP *r) {
+    std::unique_ptr<RtmpPlayer> player(new RtmpPlayer(r));
+    if (!player->receiver_.adopt(r)) return nullptr;
+    player->bytes_base_ = (uint32_t) r->m_nBytesIn;
+    player->acked_ = (uint32_t) r->m_nBytesInSent;
+    if (r->m_nServerBW > 0) player->window_ack_size_ = (uint32_t) r->m_nServerBW;
+    LOGD("接管拉流读路径: chunk_size=%u, 已缓冲 %llu 字节", player->receiver_.chunk_size(),
+         (unsigned long long) player->receiver_.stats().bytes_in);
+    return player;
+}
+
+RtmpPlayer::RtmpPlayer(RTMP *r) : r_(r), receiver_(RTMP_Socket(r)), spill_(kFlvHeader, kFlvHeader + sizeof(kFlvHeader)) {
+    memset(&stats_, 0, sizeof(stats_));
+    flv_bytes_ = sizeof(kFlvHeader);
+}
+
+void RtmpPlayer::put(const uint8_t *data, size_t size) {
+    size_t n = std::min(size, out_size_ - out_len_);
+    memcpy(out_ + out_len_, data, n);
+    out_len_ += n;
+    if (n < size) spill_.insert(spill_.end(), data + n, data + size);
+}
+
+void RtmpPlayer::emit_tag(uint8_t type, uint32_t timestamp, const uint8_t *body, uint32_t size) {
+    uint8_t header[11] = {type,
+                          (uint8_t) (size >> 16), (uint8_t) (size >> 8), (uint8_t) size,
+                          (uint8_t) (timestamp >> 16), (uint8_t) (timestamp >> 8), (uint8_t) timestamp,
+                          (uint8_t) (timestamp >> 24),
+                          0, 0, 0};
+    uint8_t previous[4];
+    write_be32(previous, size + 11);
+    put(header, sizeof(header));
+    put(body, size);
+    put(previous, sizeof(previous));
+    tags_++;
+    flv_bytes_ += size + 15;
+}
+
+void RtmpPlayer::emit_aggregate(const RtmpMessage &message) {
+    // 子 tag 的时间戳以第一个 tag 为基准平移到消息时间戳（与 librtmp 的 Read_1_Packet 相同）
+    const uint8_t *p = message.body;
+    const uint8_t *end = message.body + message.size;
+    bool first = true;
+    uint32_t delta = 0;
+    while (end - p >= 11) {
+        uint32_t size = read_be24(p + 1);
+        uint32_t timestamp = read_be24(p + 4) | ((uint32_t) p[7] << 24);
+        if ((size_t) (end - p) < 11 + (size_t) size) break;
+        if (first) {
+            delta = message.timestamp - timestamp;
+            first = false;
+        }
+        emit_tag((uint8_t) (p[0] & 0x1f), timestamp + delta, p + 11, size);
+        p += 11 + size;
+        if (end - p < 4) break;
+        p += 4;
+    }
+}
+
+void RtmpPlayer::send_control(uint8_t type, const uint8_t *body, uint32_t size) {
+    // RTMP_SendPacket 把 chunk 头写在 m_body 之前
+    char buf[RTMP_MAX_HEADER_SIZE + 16];
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x02;
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;  // librtmp 按通道上一个头压缩
+    packet.m_packetType = type;
+    packet.m_body = buf + RTMP_MAX_HEADER_SIZE;
+    packet.m_nBodySize = size;
+    memcpy(packet.m_body, body, size);
+    if (!RTMP_SendPacket(r_, &packet, FALSE)) LOGE("发送控制消息失败: type=%d", type);
+}
+
+void RtmpPlayer::on_status(const RtmpMessage &message) {
+    AMFObject obj;
+    if (AMF_Decode(&obj, reinterpret_cast<const char *>(message.body), (int) message.size, FALSE) < 0) return;
+    AVal method = {nullptr, 0};
+    AMFProp_GetString(AMF_GetProp(&obj, nullptr, 0), &method);
+    if (AVMATCH(&method, &av_onStatus)) {
+        AMFObject info;
+        AVal code = {nullptr, 0};
+        AMFProp_GetObject(AMF_GetProp(&obj, nullptr, 3), &info);
+        AMFProp_GetString(AMF_GetProp(&info, &av_code, -1), &code);
+        if (aval_is(code, "NetStream.Play.Stop") || aval_is(code, "NetStream.Play.Complete") ||
+            aval_is(code, "NetStream.Play.UnpublishNotify")) {
+            LOGD("拉流结束: %.*s", code.av_len, code.av_val);
+            status_ = 1;
+        } else if (aval_is(code, "NetStream.Failed") || aval_is(code, "NetStream.Play.Failed") ||
+                   aval_is(code, "NetStream.Play.StreamNotFound") ||
+                   aval_is(code, "NetConnection.Connect.InvalidApp")) {
+            LOGE("拉流失败: %.*s", code.av_len, code.av_val);
+            status_ = -1;
+        } else if (code.av_len > 0) {
+            LOGD("onStatus: %.*s", code.av_len, code.av_val);
+        }
+    }
+    AMF_Reset(&obj);
+}
+
+void RtmpPlayer::on_control(const RtmpMessage &message) {
+    const uint8_t *body = message.body;
+    switch (message.type) {
+        case RTMP_PACKET_TYPE_CHUNK_SIZE:
+            if (message.size >= 4) {
+                uint32_t size = read_be32(body) & 0x7fffffff;
+                if (size > 0) receiver_.set_chunk_size(size);
+            }
+            break;
+        case RTMP_PACKET_TYPE_SERVER_BW:
+            if (message.size >= 4 && read_be32(body) > 0) window_ack_size_ = read_be32(body);
+            break;
+        case RTMP_PACKET_TYPE_CONTROL:
+            if (message.size >= 6 && body[0] == 0 && body[1] == 6) {
+                // ping 请求：原样回显时间戳
+                uint8_t reply[6] = {0, 7, body[2], body[3], body[4], body[5]};
+                send_control(RTMP_PACKET_TYPE_CONTROL, reply, sizeof(reply));
+            }
+            break;
+        case RTMP_PACKET_TYPE_INVOKE:
+            on_status(message);
+            break;
+        default:
+            break;
+    }
+}
+
+void RtmpPlayer::publish_stats() {
+    const RtmpReceiverStats &r = receiver_.stats();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.messages = r.messages;
+    stats_.tags = tags_;
+    stats_.flv_bytes = flv_bytes_;
+    stats_.bytes_in = r.bytes_in;
+    stats_.recv_calls = r.recv_calls;
+    stats_.zero_copy_messages = r.zero_copy_messages;
+    stats_.copied_bytes = r.copied_bytes;
+    stats_.direct_bytes = r.direct_bytes;
+}
+
+void RtmpPlayer::snapshot(rtmp_play_stats *out) const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    *out = stats_;
+}
+
+int RtmpPlayer::read(uint8_t *buf, int size, int timeout_ms) {
+    if (buf == nullptr || size <= 0) return -1;
+    out_ = buf;
+    out_size_ = (size_t) size;
+    out_len_ = 0;
+    if (spill_pos_ < spill_.size()) {
+        size_t n = std::min(spill_.size() - spill_pos_, out_size_);
+        memcpy(buf, spill_.data() + spill_pos_, n);
+        spill_pos_ += n;
+        out_len_ = n;
+        if (spill_pos_ == spill_.size()) {
+            spill_.clear();
+            spill_pos_ = 0;
+        }
+    }
+    int64_t deadline_ms = now_ms() + std::max(timeout_ms, 0);
+    // 已有输出后只取缓冲区中已完整的消息，不再读 socket
+    while (status_ == 0 && out_len_ < out_size_) {
+        RtmpMessage message;
+        int result = out_len_ > 0 ? receiver_.read_buffered(&message)
+                                  : receiver_.read(&message, (int) std::max<int64_t>(deadline_ms - now_ms(), 0));
+        if (result == 0) break;
+        if (result < 0) {
+            if (receiver_.error() != nullptr) {
+                LOGE("拉流读取失败: %s", receiver_.error());
+                status_ = -1;
+            } else {
+                LOGD("服务端关闭了连接");
+                status_ = 1;
+            }
+            break;
+        }
+        uint64_t received = bytes_base_ + receiver_.stats().bytes_in;
+        if (window_ack_size_ > 0 && received - acked_ >= window_ack_size_ / 2) {
+            uint8_t ack[4];
+            write_be32(ack, (uint32_t) received);
+            send_control(RTMP_PACKET_TYPE_BYTES_READ_REPORT, ack, sizeof(ack));
+            acked_ = received;
+        }
+        switch (message.type) {
+            case RTMP_PACKET_TYPE_AUDIO:
+            case RTMP_PACKET_TYPE_VIDEO:
+            case RTMP_PACKET_TYPE_INFO:
+                if (message.size > 0) emit_tag(message.type, message.timestamp, message.body, message.size);
+                break;
+            case kAggregateType:
+                emit_aggregate(message);
+                break;
+            default:
+                on_control(message);
+                break;
+        }
+    }
+    publish_stats();
+    if (out_len_ > 0) return (int) out_len_;
+    if (status_ > 0) return 0;
+    if (status_ < 0) return -1;
+    return RTMP_READ_TIMEOUT;
+}
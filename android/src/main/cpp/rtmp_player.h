@@ -0,0 +1,73 @@
+#ifndef RTMP_PLAYER_H
+#define RTMP_PLAYER_H
+
+#include "rtmp_receiver.h"
+#include "rtmp_wrapper.h"
+#include "librtmp/rtmp.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * 拉流读取（rtmp_play_read）：代替 RTMP_Read。librtmp 的 RTMP_Read 每次调用读一个 packet（RTMP_ReadPacket 逐段
+ * ReadN 拷贝），再在 Read_1_Packet 中拼成 FLV tag 写进内部缓冲区后拷给调用方。本模块在 RTMP_ConnectStream 之后以
+ * RtmpReceiver 接手读路径，消息体（多数直接指向接收环形缓冲区，大消息直接读入消息缓冲区）只拷贝一次，写进调用方
+ * 缓冲区；放不下的 tag 余下部分暂存到下一次读取。
+ * 服务端的 Set Chunk Size、Window Acknowledgement Size 与 ping 在读取时处理，确认与 ping 响应经 librtmp 的写路径
+ * 发出；onStatus 的 Play.Stop/Complete/UnpublishNotify 表示流结束，Play.Failed/StreamNotFound 等表示失败。
+ */
+class RtmpPlayer {
+public:
+    /**
+     * 接手已进入播放状态的连接（RTMP_ConnectStream 成功之后，调用期间不能有其他线程使用 r）
+     * @return RTMPT 与 RTMPE 连接返回空
+     */
+    static std::unique_ptr<RtmpPlayer> attach(RTMP *r);
+
+    /**
+     * 读取 FLV 字节流（非线程安全）
+     * @return 写入 buf 的字节数；流已结束返回 0；timeout_ms 内没有数据返回 RTMP_READ_TIMEOUT；出错返回 -1
+     */
+    int read(uint8_t *buf, int size, int timeout_ms);
+
+    // 可与 read 并发调用
+    void snapshot(rtmp_play_stats *out) const;
+
+    RtmpPlayer(const RtmpPlayer &) = delete;
+    RtmpPlayer &operator=(const RtmpPlayer &) = delete;
+
+private:
+    explicit RtmpPlayer(RTMP *r);
+
+    // 先填满调用方缓冲区，其余写进 spill_
+    void put(const uint8_t *data, size_t size);
+    void emit_tag(uint8_t type, uint32_t timestamp, const uint8_t *body, uint32_t size);
+    // 聚合消息：逐个 tag 改写时间戳后输出
+    void emit_aggregate(const RtmpMessage &message);
+    void on_control(const RtmpMessage &message);
+    void on_status(const RtmpMessage &message);
+    void send_control(uint8_t type, const uint8_t *body, uint32_t size);
+    void publish_stats();
+
+    RTMP *r_;
+    RtmpReceiver receiver_;
+    std::vector<uint8_t> spill_;   // 调用方缓冲区放不下的字节（首次为 FLV 文件头）
+    size_t spill_pos_ = 0;
+    int status_ = 0;               // 0 播放中，1 流已结束，-1 出错
+    uint64_t bytes_base_ = 0;      // 接手前 librtmp 已读取的字节数（确认中的字节数从连接建立算起）
+    uint32_t window_ack_size_ = 2500000;
+    uint64_t acked_ = 0;
+    uint64_t tags_ = 0;
+    uint64_t flv_bytes_ = 0;
+
+    // 当前 read 调用的输出位置
+    uint8_t *out_ = nullptr;
+    size_t out_size_ = 0;
+    size_t out_len_ = 0;
+
+    mutable std::mutex stats_mutex_;
+    rtmp_play_stats stats_;
+};
+
+#endif // RTMP_PLAYER_H
@@ -0,0 +1,304 @@
+#include "rtmp_receiver.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+static const size_t kRingMask = RtmpReceiver::kRingSize - 1;
+
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+}
+
+RtmpReceiver::RtmpReceiver(int fd) : fd_(fd), ring_(new uint8_t[kRingSize]) {
+}
+
+RtmpReceiver::Channel &RtmpReceiver::channel(int id) {
+    if ((size_t) id >= channels_.size()) channels_.resize((size_t) id + 1);
+    std::unique_ptr<Channel> &ch = channels_[(size_t) id];
+    if (!ch) ch.reset(new Channel());
+    return *ch;
+}
+
+bool RtmpReceiver::adopt(RTMP *r) {
+    if ((r->Link.protocol & (RTMP_FEATURE_HTTP | RTMP_FEATURE_ENC)) || r->m_sb.sb_ssl != nullptr) return false;
+    // sb_buf 只有 16 KB，必然放得下
+    size_t n = r->m_sb.sb_size > 0 ? (size_t) r->m_sb.sb_size : 0;
+    if (n > kRingSize - (head_ - tail_)) return false;
+    for (size_t i = 0; i < n; ++i) ring_[(head_ + i) & kRingMask] = (uint8_t) r->m_sb.sb_start[i];
+    head_ += n;
+    stats_.bytes_in += n;
+    r->m_sb.sb_size = 0;
+    r->m_sb.sb_start = r->m_sb.sb_buf;
+
+    chunk_size_ = (uint32_t) r->m_inChunkSize;
+    for (int i = 0; i < r->m_channelsAllocatedIn; ++i) {
+        const RTMPPacket *p = r->m_vecChannelsIn[i];
+        if (p == nullptr) continue;
+        Channel &ch = channel(i);
+        ch.started = true;
+        ch.type = p->m_packetType;
+        ch.stream_id = (uint32_t) p->m_nInfoField2;
+        ch.length = p->m_nBodySize;
+        // librtmp 保存的是最近一个头的时间戳字段（扩展时间戳记为 0xffffff，fmt3 新消息随之重新读取扩展字段）
+        ch.ts_field = p->m_nTimeStamp;
+        ch.extended = p->m_nTimeStamp == 0xffffff;
+        ch.timestamp = (uint32_t) r->m_channelTimestamp[i];
+        ch.received = 0;
+        if (p->m_body != nullptr && p->m_nBytesRead > 0 && p->m_nBytesRead < p->m_nBodySize) {
+            // 收了一半的消息：fmt0 开头的时间戳是绝对值，其余为 delta（完成时 librtmp 才累加）
+            if (!ch.extended) ch.timestamp = p->m_hasAbsTimestamp ? p->m_nTimeStamp : ch.timestamp + p->m_nTimeStamp;
+            ch.body.reset(new uint8_t[p->m_nBodySize]);
+            ch.capacity = p->m_nBodySize;
+            memcpy(ch.body.get(), p->m_body, p->m_nBytesRead);
+            ch.received = p->m_nBytesRead;
+        }
+    }
+    return true;
+}
+
+void RtmpReceiver::copy_from_ring(uint64_t pos, uint8_t *out, size_t size) const {
+    size_t offset = (size_t) (pos & kRingMask);
+    size_t first = std::min(size, kRingSize - offset);
+    memcpy(out, ring_.get() + offset, first);
+    if (size > first) memcpy(out + first, ring_.get(), size - first);
+}
+
+void RtmpReceiver::deliver(int id, Channel &ch, RtmpMessage *message) {
+    message->type = ch.type;
+    message->channel = id;
+    message->stream_id = ch.stream_id;
+    message->timestamp = ch.timestamp;
+    message->body = ch.body.get();
+    message->size = ch.length;
+    ch.received = 0;
+    stats_.messages++;
+}
+
+int RtmpReceiver::fail(const char *reason) {
+    error_ = reason;
+    closed_ = true;
+    return -1;
+}
+
+int RtmpReceiver::read(RtmpMessage *message, int timeout_ms) {
+    if (closed_) return -1;
+    tail_ += held_;
+    held_ = 0;
+    int64_t deadline_ms = timeout_ms > 0 ? now_ms() + timeout_ms : 0;
+    for (;;) {
+        int result = parse(message);
+        if (result != 0) return result;
+        result = fill(deadline_ms);
+        if (result <= 0) return result;
+    }
+}
+
+int RtmpReceiver::read_buffered(RtmpMessage *message) {
+    if (closed_) return -1;
+    tail_ += held_;
+    held_ = 0;
+    return parse(message);
+}
+
+int RtmpReceiver::parse(RtmpMessage *message) {
+    if (direct_channel_ >= 0) {
+        if (direct_left_ > 0) return 0;
+        int id = direct_channel_;
+        direct_channel_ = -1;
+        Channel &ch = *channels_[(size_t) id];
+        if (ch.received == ch.length) {
+            deliver(id, ch, message);
+            return 1;
+        }
+    }
+    for (;;) {
+        size_t avail = (size_t) (head_ - tail_);
+        if (avail == 0) return 0;
+        // 头在缓冲区内连续时原地解析，跨越回绕点时拷贝出来
+        uint8_t copy[RTMP_CHUNK_HEADER_MAX];
+        size_t peek = std::min(avail, (size_t) RTMP_CHUNK_HEADER_MAX);
+        size_t offset = (size_t) (tail_ & kRingMask);
+        const uint8_t *h = ring_.get() + offset;
+        if (kRingSize - offset < peek) {
+            copy_from_ring(tail_, copy, peek);
+            h = copy;
+        }
+        const uint8_t *p = h;
+        const uint8_t *end = h + peek;
+        int fmt = p[0] >> 6;
+        int id = p[0] & 0x3f;
+        p++;
+        if (id == 0) {
+            if (end - p < 1) return 0;
+            id = 64 + p[0];
+            p++;
+        } else if (id == 1) {
+            if (end - p < 2) return 0;
+            id = 64 + p[0] + ((int) p[1] << 8);
+            p += 2;
+        }
+        static const int kHeaderSizes[4] = {11, 7, 3, 0};
+        if (end - p < kHeaderSizes[fmt]) return 0;
+        bool known = (size_t) id < channels_.size() && channels_[(size_t) id] && channels_[(size_t) id]->started;
+        if (fmt != 0 && !known) return fail("chunk 流以未知通道的压缩头开始");
+        Channel &ch = channel(id);
+        bool new_message = ch.received == 0;
+        uint32_t ts_field = ch.ts_field;
+        bool extended = ch.extended;
+        uint32_t length = ch.length;
+        uint8_t type = ch.type;
+        uint32_t stream_id = ch.stream_id;
+        if (fmt <= 2) {
+            ts_field = read_be24(p);
+            extended = ts_field == 0xffffff;
+        }
+        if (fmt <= 1) {
+            length = read_be24(p + 3);
+            type = p[6];
+        }
+        if (fmt == 0) {
+            stream_id = (uint32_t) p[7] | ((uint32_t) p[8] << 8) | ((uint32_t) p[9] << 16) | ((uint32_t) p[10] << 24);
+        }
+        p += kHeaderSizes[fmt];
+        if (extended) {
+            if (end - p < 4) return 0;
+            if (fmt <= 2 || new_message) {
+                ts_field = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+            }
+            p += 4;
+        }
+        if (length > RtmpChunkReader::kMaxMessageSize) return fail("消息超过大小上限");
+        if (!new_message && fmt != 3) return fail("消息中途出现非 fmt3 的 chunk 头");
+        size_t header = (size_t) (p - h);
+        uint32_t remaining = new_message ? length : length - ch.received;
+        uint32_t n = std::min(remaining, chunk_size_);
+        size_t have = avail - header;
+        bool complete = have >= n;
+        // 数据不足且不值得直接读时不改动任何状态，等更多数据后从 chunk 起点重新解析
+        if (!complete && n - have < kDirectReadMin && avail < kRingSize) return 0;
+
+        if (new_message) {
+            ch.started = true;
+            ch.extended = extended;
+            ch.ts_field = ts_field;
+            ch.length = length;
+            ch.type = type;
+            ch.stream_id = stream_id;
+            ch.timestamp = fmt == 0 ? ts_field : ch.timestamp + ts_field;
+        }
+        uint64_t payload = tail_ + header;
+        if (complete && new_message && n == length && (payload & kRingMask) + n <= kRingSize) {
+            // 单 chunk 消息：消息体直接指向缓冲区，下一次 read 时才释放
+            tail_ = payload;
+            held_ = n;
+            message->type = type;
+            message->channel = id;
+            message->stream_id = stream_id;
+            message->timestamp = ch.timestamp;
+            message->body = ring_.get() + (payload & kRingMask);
+            message->size = length;
+            stats_.messages++;
+            stats_.zero_copy_messages++;
+            return 1;
+        }
+        if (new_message && ch.capacity < length) {
+            ch.body.reset(new uint8_t[length]);
+            ch.capacity = length;
+        }
+        size_t take = std::min((size_t) n, have);
+        copy_from_ring(payload, ch.body.get() + ch.received, take);
+        ch.received += (uint32_t) take;
+        stats_.copied_bytes += take;
+        tail_ = payload + take;
+        if (!complete) {
+            // 剩余负载直接读入消息缓冲区
+            direct_channel_ = id;
+            direct_ptr_ = ch.body.get() + ch.received;
+            direct_left_ = n - take;
+            return 0;
+        }
+        if (ch.received == ch.length) {
+            deliver(id, ch, message);
+            return 1;
+        }
+    }
+}
+
+int RtmpReceiver::fill(int64_t deadline_ms) {
+    struct iovec iov[3];
+    int count = 0;
+    if (direct_left_ > 0) {
+        iov[count].iov_base = direct_ptr_;
+        iov[count].iov_len = direct_left_;
+        count++;
+    }
+    size_t space = kRingSize - (size_t) (head_ - tail_);
+    if (space > 0) {
+        size_t offset = (size_t) (head_ & kRingMask);
+        size_t first = std::min(space, kRingSize - offset);
+        iov[count].iov_base = ring_.get() + offset;
+        iov[count].iov_len = first;
+        count++;
+        if (space > first) {
+            iov[count].iov_base = ring_.get();
+            iov[count].iov_len = space - first;
+            count++;
+        }
+    }
+    size_t wanted = 0;
+    for (int i = 0; i < count; ++i) wanted += iov[i].iov_len;
+    // 上次已把 socket 读空时先等可读，省掉一次必然 EAGAIN 的 recvmsg
+    bool wait_first = drained_ && deadline_ms > 0;
+    for (;;) {
+        if (wait_first) {
+            wait_first = false;
+            int wait_ms = (int) (deadline_ms - now_ms());
+            if (wait_ms <= 0) return 0;
+            struct pollfd pfd;
+            pfd.fd = fd_;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int ready = poll(&pfd, 1, wait_ms);
+            if (ready < 0 && errno != EINTR) return fail(strerror(errno));
+            if (ready == 0) return 0;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t) count;
+        ssize_t n = recvmsg(fd_, &msg, MSG_DONTWAIT);
+        stats_.recv_calls++;
+        if (n > 0) {
+            size_t got = (size_t) n;
+            drained_ = got < wanted;
+            stats_.bytes_in += got;
+            size_t direct = std::min(got, direct_left_);
+            if (direct > 0) {
+                direct_ptr_ += direct;
+                direct_left_ -= direct;
+                channels_[(size_t) direct_channel_]->received += (uint32_t) direct;
+                stats_.direct_bytes += direct;
+            }
+            head_ += got - direct;
+            return 1;
+        }
+        if (n == 0) {
+            closed_ = true;
+            return -1;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return fail(strerror(errno));
+        drained_ = true;
+        if (deadline_ms <= 0) return 0;
+        wait_first = true;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef RTMP_RECEIVER_H
+#define RTMP_RECEIVER_H
+
+#include "rtmp_chunk.h"
+#include "librtmp/rtmp.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * 基于环形缓冲区的 RTMP 接收（代替 RTMP_ReadPacket 的读路径）。
+ *
+ * RTMP_ReadPacket 经 ReadN 分段读取：基本头 1~3 字节、消息头、扩展时间戳与每个 chunk 的负载各一次 ReadN，
+ * 每次都从 16 KB 的 sb_buf memcpy 出来，sb_buf 读空后才 recv 下一批；多 chunk 消息再逐 chunk 拷贝进 packet 的 body。
+ * 本模块：
+ *   - socket 数据以 recvmsg 读入环形缓冲区的空闲区间（回绕时两段 iovec，一次系统调用），chunk 头直接在缓冲区内
+ *     解析，只有跨越回绕点的头才拷贝到栈上（最多 18 字节）；
+ *   - 单 chunk 消息且负载在缓冲区内连续时，消息体直接指向缓冲区，不拷贝；其余消息逐 chunk 拷贝进通道的消息
+ *     缓冲区（每个字节一次拷贝）；
+ *   - 当前 chunk 的负载还差 kDirectReadMin 字节以上（或缓冲区已满）时，剩余负载直接 recvmsg 进消息缓冲区，同一次
+ *     调用的后两段 iovec 指向环形缓冲区的空闲区间，紧随其后的 chunk 头照常进入缓冲区。
+ * 头解析与 RtmpChunkReader 相同：fmt0~3 头压缩、扩展时间戳、2/3 字节基本头；只读不写，Set Chunk Size、确认与
+ * ping 响应由调用方处理。非线程安全，同一时刻只能有一个线程调用。
+ */
+
+// 接收统计（单调递增）
+struct RtmpReceiverStats {
+    uint64_t messages = 0;
+    uint64_t bytes_in = 0;            // socket 读到的字节数（含 adopt 接手的）
+    uint64_t recv_calls = 0;          // recvmsg 调用次数
+    uint64_t zero_copy_messages = 0;  // 消息体直接指向环形缓冲区的消息数
+    uint64_t copied_bytes = 0;        // 从环形缓冲区拷贝进消息缓冲区的负载字节数
+    uint64_t direct_bytes = 0;        // 直接读入消息缓冲区的负载字节数
+};
+
+class RtmpReceiver {
+public:
+    static const size_t kRingSize = 64 * 1024;  // 2 的幂
+    static const uint32_t kDirectReadMin = 4096;
+
+    explicit RtmpReceiver(int fd);
+
+    /**
+     * 从 librtmp 接手读路径（RTMP_Serve 或 RTMP_ConnectStream 之后，调用期间不能有其他线程使用 r）：sb_buf 中
+     * 已读入的字节移入环形缓冲区，沿用各通道的头压缩状态、未收完的消息与接收 chunk size。之后不能再以 librtmp 读取
+     * 该连接，写路径不受影响
+     * @return RTMPT（HTTP 隧道）与 RTMPE 连接返回 false
+     */
+    bool adopt(RTMP *r);
+
+    /**
+     * 读取下一条完整消息，message->body 在下一次调用 read 之前有效
+     * @param timeout_ms 没有完整消息时最多等待的毫秒数，0 不等待
+     * @return 1 读到消息，0 超时，-1 对端关闭或出错（见 error()），之后不能再读
+     */
+    int read(RtmpMessage *message, int timeout_ms);
+
+    /**
+     * 只解析已在缓冲区中的数据，不读 socket
+     * @return 1 读到消息，0 缓冲区中没有完整消息，-1 出错
+     */
+    int read_buffered(RtmpMessage *message);
+
+    // 对之后的 chunk 生效（与 RTMP_ReadPacket 相同），可在两次 read 之间调用
+    void set_chunk_size(uint32_t chunk_size) { chunk_size_ = chunk_size; }
+    uint32_t chunk_size() const { return chunk_size_; }
+
+    const RtmpReceiverStats &stats() const { return stats_; }
+    // 对端正常关闭时为 nullptr
+    const char *error() const { return error_; }
+    bool closed() const { return closed_; }
+
+    RtmpReceiver(const RtmpReceiver &) = delete;
+    RtmpReceiver &operator=(const RtmpReceiver &) = delete;
+
+private:
+    struct Channel {
+        bool started = false;
+        bool extended = false;
+        uint8_t type = 0;
+        uint32_t stream_id = 0;
+        uint32_t timestamp = 0;
+        uint32_t ts_field = 0;
+        uint32_t length = 0;
+        uint32_t received = 0;              // 正在重组的消息已收到的字节数，0 表示没有进行中的消息
+        std::unique_ptr<uint8_t[]> body;    // 按最大消息增长，不随消息缩小
+        uint32_t capacity = 0;
+    };
+
+    Channel &channel(int id);
+    // 解析缓冲区中的 chunk：1 为得到完整消息，0 为需要更多数据，-1 为协议错误
+    int parse(RtmpMessage *message);
+    // 从 socket 读取一次（必要时等待到 deadline_ms）：1 为读到数据，0 为超时，-1 为关闭或出错
+    int fill(int64_t deadline_ms);
+    void copy_from_ring(uint64_t pos, uint8_t *out, size_t size) const;
+    void deliver(int id, Channel &ch, RtmpMessage *message);
+    int fail(const char *reason);
+
+    const int fd_;
+    std::unique_ptr<uint8_t[]> ring_;
+    uint64_t head_ = 0;   // 写入位置（单调递增，取模 kRingSize 为下标）
+    uint64_t tail_ = 0;   // 解析位置
+    size_t held_ = 0;     // 上一条零拷贝消息占用的字节，下一次 read 时释放
+    bool drained_ = false;  // 上一次 recvmsg 没有填满缓冲区：socket 很可能已读空，需要等待时先 poll
+    uint32_t chunk_size_ = 128;
+    std::vector<std::unique_ptr<Channel>> channels_;
+
+    // 直接读入消息缓冲区的 chunk 负载
+    int direct_channel_ = -1;
+    uint8_t *direct_ptr_ = nullptr;
+    size_t direct_left_ = 0;
+
+    RtmpReceiverStats stats_;
+    const char *error_ = nullptr;
+    bool closed_ = false;
+};
+
+#endif // RTMP_RECEIVER_H
@@ -1,47 +1,264 @@
 #include "rtmp_wrapper.h"
-#include <android/log.h>
+#include "async_sender.h"
+#include "av_clock.h"
+#include "filler_frames.h"
+#include "flv_recorder.h"
+#include "flv_spool.h"
+#include "flv_mux.h"
+#include "frame_ring.h"
+#include "frame_trace.h"
+#include "h264_params.h"
+#include "heartbeat.h"
+#include "partial_writer.h"
+#include "publish_engine.h"
+#include "rtmp_player.h"
+#include "rtmp_receiver.h"
+#include "rtmpt_transport.h"
+#include "send_stats.h"
+#include "tcp_fast_open.h"
+#include "tls_session.h"
+#include "uring_transport.h"
+#include "zerocopy_sender.h"
+#include "bb_log.h"
 #include "librtmp/rtmp.h"
-#include "librtmp/amf.h"
 #include <vector>
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <cstring>
+#include <cstdio>
 #include <cstdlib>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
 #include <arpa/inet.h>
+#include <netdb.h>
 #include <sys/socket.h>
 
 #define TAG "RtmpWrapper"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
 
 struct Connection {
     RTMP *rtmp = nullptr;
     bool connected = false;
-    std::vector<uint8_t> sps;
+    int video_codec = RTMP_VIDEO_CODEC_H264;
+    std::vector<uint8_t> vps;  // 仅 HEVC
+    std::vector<uint8_t> sps;  // 当前序列头使用的参数集
     std::vector<uint8_t> pps;
+    // 最近收到的参数集：内容与当前序列头不同时，推迟到第一个使用它的关键帧再切换
+    std::vector<uint8_t> next_vps;
+    std::vector<uint8_t> next_sps;
+    std::vector<uint8_t> next_pps;
     bool sent_video_config = false;
     bool sent_audio_config = false;
     bool sent_metadata = false;
     long bytes_sent = 0;
+    int audio_codec = RTMP_AUDIO_CODEC_AAC;
+    int audio_bitrate = 64000;
     int sample_rate = 44100;
     int channels = 1;
     int width = 0;
     int height = 0;
     int video_bitrate = 0;
     int fps = 30;
+    // 从 H.264 SPS 解析的宽高与 VUI 帧率，非 0 时优先于 rtmp_set_metadata 传入的值
+    int sps_width = 0;
+    int sps_height = 0;
+    int sps_fps = 0;
     char *url_copy = nullptr;
+    uint32_t video_frame_count = 0;  // 仅用于按帧数抽样打日志
+
+    // 关键帧请求：参考链断开（新连接或丢帧）后丢弃非关键帧直至下一个 IDR
+    bool waiting_keyframe = true;
+    int keyframe_reason = RTMP_KEYFRAME_REASON_NEW_STREAM;
+    rtmp_keyframe_request_cb keyframe_cb = nullptr;
+    void *keyframe_cb_user_data = nullptr;
+    int keyframe_min_interval_ms = 1000;
+    int64_t last_keyframe_request_ms = 0;
+
+    // 本地 FLV 录制：与发送共享 packet 缓冲区；保留最近的 onMetaData/序列头，开始录制或切分文件时补写
+    FlvRecorder *recorder = nullptr;
+    FlvTagRef last_metadata;
+    FlvTagRef last_video_config;
+    FlvTagRef last_audio_config;
+
+    // RTMPS：TLS 会话须在 RTMP_Close 之后释放（用户态中继据 librtmp 一端关闭发出 close_notify）
+    TlsSession *tls = nullptr;
+
+    // io_uring 发送后端（rtmp_set_transport 选择）：须在 RTMP_Close 之前写完并释放
+    std::shared_ptr<UringWriter> uring;
+
+    // 大视频消息的 MSG_ZEROCOPY 发送（rtmp_set_zerocopy 开启）：须在 RTMP_Close 之前等待完成通知并释放
+    std::shared_ptr<ZeroCopySender> zerocopy;
+
+    // 限时非阻塞发送（rtmp_set_send_deadline 开启）：上一条消息未写完的部分须先于任何其他写入续写完
+    std::shared_ptr<PartialWriter> partial;
+    int64_t send_timeout_us = 0;
+    bool send_blocked = false;  // 本次发送调用中有消息因续写未完成而被拒绝
+
+    // 批量 RTMPT（rtmp_set_rtmpt_batch 开启）：接管期间全部消息经它发送，须在 RTMP_Close 之前交还隧道
+    std::shared_ptr<RtmptTransport> rtmpt;
+
+    // 服务端在 publish 之后下发的消息（ping、Set Chunk Size、onStatus）：librtmp 不再读取，由发送路径定期非阻塞读取
+    std::shared_ptr<RtmpReceiver> receiver;
+    int64_t last_server_poll_ms = 0;
+    // 接收确认（Acknowledgement）：确认中的字节数从连接建立算起，接手前 librtmp 已读取的部分计入 bytes_in_base
+    uint64_t bytes_in_base = 0;
+    uint64_t bytes_in_acked = 0;
+    uint32_t window_ack_size = 2500000;
+    // 发送失败（如续写未完成）的 ping 应答：下一次读取时先重发，只保留最近一次 ping
+    bool ping_reply_pending = false;
+    uint8_t ping_reply[6] = {};
+
+    // 连接建立各阶段耗时与 TCP Fast Open 结果
+    rtmp_connect_timing connect_timing{};
+
+    // 发送统计：独立于 g_mutex 登记在 g_stats 中，快照不阻塞发送线程
+    std::shared_ptr<SendStats> stats;
+    int64_t enqueue_us = 0;  // 当前帧进入发送接口的时刻（等锁之前）
+
+    // 后台心跳据此判断是否需要补发静音帧
+    int64_t last_audio_input_us = 0;  // 最近一次调用方输入音频的时刻
+    long last_audio_timestamp = -1;
+};
+
+// 在锁外触发的关键帧请求（避免回调中再次调用 wrapper 时死锁）
+struct KeyFrameRequest {
+    rtmp_keyframe_request_cb cb = nullptr;
+    void *user_data = nullptr;
+    int reason = 0;
 };
 
 static std::map<long, Connection> g_connections;
 static long g_next_handle = 1;
 static std::mutex g_mutex;
 
+// RTMPS 配置：rtmp_init 时复制一份
+static TlsConfig g_tls_config;
+static std::mutex g_tls_mutex;
+
+// TCP Fast Open（rtmp_set_fast_open）：rtmp_init 时读取
+static std::atomic<bool> g_fast_open{false};
+
+static std::map<long, std::shared_ptr<SendStats>> g_stats;
+static std::mutex g_stats_mutex;
+
+// 零拷贝发送线程：独立于 g_mutex 登记，发送线程内部调用 rtmp_send_video 的实现，close 时须在 g_mutex 之外停止
+static std::map<long, std::shared_ptr<AsyncVideoSender>> g_async_senders;
+static std::mutex g_async_mutex;
+
+// 后台心跳：定时器线程内部调用发送实现（需要 g_mutex），与零拷贝发送线程一样须在 g_mutex 之外停止
+struct Heartbeat {
+    std::vector<uint8_t> keyframe;
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+    H264SkipFrameGenerator skip;  // 以下字段仅定时器线程访问
+    long base_timestamp = 0;
+    int64_t keyframe_interval_us = 0;
+    int64_t last_keyframe_us = -1;
+    std::vector<uint8_t> frame;
+    std::unique_ptr<HeartbeatTimer> timer;
+};
+
+static std::map<long, std::shared_ptr<Heartbeat>> g_heartbeats;
+static std::mutex g_heartbeat_mutex;
+
+// 断网缓存：独立于连接，跨重连存活；排空时持有 shared_ptr，关闭不会释放正在使用的缓存
+struct Spool {
+    std::mutex mutex;
+    FlvSpool file;
+    bool active = false;
+    long drain_rate_bps = 0;
+    long drained_bytes = 0;
+
+    Spool(const std::string &path, long capacity_bytes) : file(path, capacity_bytes) {}
+};
+
+static std::map<long, std::shared_ptr<Spool>> g_spools;
+static long g_next_spool = 1;
+static std::mutex g_spool_mutex;
+
+// 帧环：由 g_rings 持有；数据区、统计与唤醒经注册表查找，每帧调用见 resolve_ring
+struct Ring {
+    long id;
+    int media;
+    FrameRing frames;
+
+    Ring(long id, int media, size_t capacity, int max_frames) : id(id), media(media), frames(capacity, max_frames) {}
+};
+
+static std::map<long, std::shared_ptr<Ring>> g_rings;
+static long g_next_ring = 1;
+static std::mutex g_ring_mutex;
+
+// 每帧调用的 reserve/commit/flush/send 不经过全局锁：句柄低位为槽位号，槽位保存帧环指针（由 g_rings 持有），
+// 高位为序号，槽位复用后旧句柄不再匹配。rtmp_ring_destroy 要求生产者与消费者已停止，销毁时不会有并发的每帧调用
+static const long kRingSlots = 256;
+static std::atomic<Ring *> g_ring_slots[kRingSlots];
+
+static std::map<long, std::shared_ptr<AvClock>> g_clocks;
+static long g_next_clock = 1;
+static std::mutex g_clock_mutex;
+
+// 推流引擎：会话句柄全局编号，记录所属引擎以便销毁引擎时一并移除
+struct EngineSessionEntry {
+    long engine;
+    std::shared_ptr<PublishEngine> owner;
+    std::shared_ptr<EngineSession> session;
+};
+
+static std::map<long, std::shared_ptr<PublishEngine>> g_engines;
+static std::map<long, EngineSessionEntry> g_engine_sessions;
+static long g_next_engine = 1;
+static long g_next_engine_session = 1;
+static std::mutex g_engine_mutex;
+
+// 拉流连接：read_mutex 保证 rtmp_play_close 等待正在进行的 rtmp_play_read
+struct PlayConnection {
+    RTMP *rtmp = nullptr;
+    char *url_copy = nullptr;
+    TlsSession *tls = nullptr;
+    std::unique_ptr<RtmpPlayer> player;
+    std::mutex read_mutex;
+};
+static std::map<long, std::shared_ptr<PlayConnection>> g_players;
+static long g_next_player = 1;
+static std::mutex g_player_mutex;
+
 static void free_connection(Connection &conn) {
+    if (conn.recorder) {
+        conn.recorder->stop();
+        delete conn.recorder;
+        conn.recorder = nullptr;
+    }
+    conn.uring.reset();
+    conn.zerocopy.reset();
+    if (conn.partial) {
+        // 半条消息留在连接上时 librtmp 随后写出的 FCUnpublish/deleteStream 会破坏 chunk 流：续写不完就只关闭写端
+        int syscalls = 0;
+        if (conn.partial->flush(send_stats_now_us() + 1000000, &syscalls) != PARTIAL_WRITE_DONE) {
+            LOGE("关闭前续写未完成，丢弃剩余 %zu 字节", conn.partial->pending_bytes());
+            shutdown(RTMP_Socket(conn.rtmp), SHUT_WR);
+        }
+        conn.partial.reset();
+    }
+    if (conn.rtmpt) {
+        conn.rtmpt->detach(conn.rtmp, 1000000);
+        conn.rtmpt.reset();
+    }
+    conn.receiver.reset();
     if (conn.rtmp) {
         RTMP_Close(conn.rtmp);
         RTMP_Free(conn.rtmp);
         conn.rtmp = nullptr;
     }
+    if (conn.tls) {
+        delete conn.tls;
+        conn.tls = nullptr;
+    }
     if (conn.url_copy) {
         free(conn.url_copy);
         conn.url_copy = nullptr;
@@ -49,9 +266,213 @@ static void free_connection(Connection &conn) {
     conn.connected = false;
 }
 
+static int64_t monotonic_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void cut_reference_chain(Connection &conn, int reason) {
+    if (!conn.waiting_keyframe) {
+        conn.waiting_keyframe = true;
+        conn.keyframe_reason = reason;
+    }
+}
+
+/* 等待关键帧期间按最小间隔限流，拥塞时不会触发 IDR 风暴 */
+static void poll_keyframe_request(Connection &conn, KeyFrameRequest &req) {
+    if (!conn.waiting_keyframe || conn.keyframe_cb == nullptr) return;
+    int64_t now = monotonic_ms();
+    if (conn.last_keyframe_request_ms != 0 &&
+        now - conn.last_keyframe_request_ms < conn.keyframe_min_interval_ms) {
+        return;
+    }
+    conn.last_keyframe_request_ms = now;
+    req.cb = conn.keyframe_cb;
+    req.user_data = conn.keyframe_cb_user_data;
+    req.reason = conn.keyframe_reason;
+}
+
+static void fire_keyframe_request(rtmp_handle_t handle, const KeyFrameRequest &req) {
+    if (req.cb == nullptr) return;
+    LOGD("请求关键帧: handle=%ld, reason=%d", handle, req.reason);
+    req.cb(handle, req.reason, req.user_data);
+}
+
+static FrameTraceTrack trace_track(const RTMPPacket *packet) {
+    if (packet->m_packetType == RTMP_PACKET_TYPE_VIDEO) return FRAME_TRACE_VIDEO;
+    if (packet->m_packetType == RTMP_PACKET_TYPE_AUDIO) return FRAME_TRACE_AUDIO;
+    return FRAME_TRACE_DATA;
+}
+
+static SendStatsMedia stats_media(const RTMPPacket *packet) {
+    if (packet->m_packetType == RTMP_PACKET_TYPE_VIDEO) return SEND_STATS_VIDEO;
+    if (packet->m_packetType == RTMP_PACKET_TYPE_AUDIO) return SEND_STATS_AUDIO;
+    return SEND_STATS_DATA;
+}
+
+// 实际的 TCP socket：用户态 TLS 模式下 librtmp 写入的是 socketpair，内核发送队列要看中继后的连接
+static int wire_socket(const Connection &conn) {
+    return conn.tls != nullptr ? conn.tls->socket() : RTMP_Socket(conn.rtmp);
+}
+
+/*
+ * io_uring 后端：音视频消息序列化进注册缓冲区后立即返回（消息已交给引擎线程，packet 可以释放），
+ * 统计与末 chunk 追踪在写完时由引擎线程记录。其余消息与超出缓冲区的消息返回 false，由调用方先 drain 再经
+ * librtmp 发送：onMetaData 所在的通道依赖 librtmp 的 chunk 头压缩状态，且不能与队列中的消息交错
+ */
+static bool send_packet_uring(Connection &conn, RTMPPacket *packet, bool &ok) {
+    if (packet->m_packetType != RTMP_PACKET_TYPE_VIDEO && packet->m_packetType != RTMP_PACKET_TYPE_AUDIO) {
+        return false;
+    }
+    FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, trace_track(packet), packet->m_nTimeStamp, packet->m_nBodySize);
+    UringSubmitResult result = conn.uring->submit(packet, conn.rtmp->m_outChunkSize, stats_media(packet),
+                                                  conn.enqueue_us);
+    if (result == URING_TOO_LARGE) return false;
+    ok = result == URING_QUEUED;
+    if (ok) {
+        conn.bytes_sent += packet->m_nBodySize;
+        if (conn.stats) conn.stats->sample_queue_depth(wire_socket(conn));
+    } else {
+        // 写端已失败，引擎不再写入该连接的统计
+        if (conn.stats) {
+            int64_t now_us = send_stats_now_us();
+            conn.stats->on_packet_sent(stats_media(packet), packet->m_nBodySize, conn.rtmp->m_outChunkSize, false,
+                                       conn.enqueue_us, now_us, now_us, 0);
+        }
+        LOGE("io_uring 发送失败: type=%d, size=%d", packet->m_packetType, packet->m_nBodySize);
+    }
+    return true;
+}
+
+/*
+ * MSG_ZEROCOPY：chunk 头与指向 body 的负载片段以一次（消息超出发送缓冲区时为几次）sendmsg 写出，内核引用 body
+ * 所在的页直至对端确认；release_packet 随后把 body 交给 ZeroCopySender 保持到完成通知
+ */
+static bool send_packet_zerocopy(Connection &conn, RTMPPacket *packet) {
+    FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, trace_track(packet), packet->m_nTimeStamp, packet->m_nBodySize);
+    int syscalls = 0;
+    int64_t start_us = send_stats_now_us();
+    bool ok = conn.zerocopy->send(packet, conn.rtmp->m_outChunkSize, &syscalls);
+    int64_t end_us = send_stats_now_us();
+    FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, trace_track(packet), packet->m_nTimeStamp, ok ? 1 : 0);
+    FRAME_TRACE_SOCKET_QUEUE(wire_socket(conn), trace_track(packet), packet->m_nTimeStamp);
+    if (conn.stats) {
+        conn.stats->on_packet_sent(stats_media(packet), packet->m_nBodySize, conn.rtmp->m_outChunkSize, ok,
+                                   conn.enqueue_us, start_us, end_us, syscalls);
+        conn.stats->sample_queue_depth(wire_socket(conn));
+    }
+    if (ok) {
+        conn.bytes_sent += packet->m_nBodySize;
+        return true;
+    }
+    LOGE("MSG_ZEROCOPY 发送失败: type=%d, size=%d", packet->m_packetType, packet->m_nBodySize);
+    return false;
+}
+
+// 续写上一条消息的剩余部分；期限内写不完时标记 send_blocked，本消息不写入任何字节
+static PartialWriteResult flush_partial(Connection &conn, int64_t deadline_us, int *syscalls) {
+    size_t pending = conn.partial->pending_bytes();
+    PartialWriteResult result = conn.partial->flush(deadline_us, syscalls);
+    if (conn.stats && pending > 0) conn.stats->on_resumed(pending - conn.partial->pending_bytes());
+    if (result == PARTIAL_WRITE_PENDING) {
+        conn.send_blocked = true;
+        if (conn.stats) conn.stats->on_would_block();
+    }
+    return result;
+}
+
+/*
+ * 限时非阻塞发送（音视频消息）：期限为帧进入发送接口的时刻 + send_timeout_us。续写完上一条消息后写出本消息，
+ * 写到期限时剩余部分留待下一次发送续写，本消息视为已发送
+ */
+static bool send_packet_partial(Connection &conn, RTMPPacket *packet) {
+    int64_t start_us = send_stats_now_us();
+    int64_t deadline_us = (conn.enqueue_us > 0 ? conn.enqueue_us : start_us) + conn.send_timeout_us;
+    int syscalls = 0;
+    PartialWriteResult result = flush_partial(conn, deadline_us, &syscalls);
+    if (result == PARTIAL_WRITE_PENDING) return false;
+    if (result == PARTIAL_WRITE_DONE) {
+        FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, trace_track(packet), packet->m_nTimeStamp, packet->m_nBodySize);
+        result = conn.partial->write(packet, conn.rtmp->m_outChunkSize, deadline_us, &syscalls);
+        FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, trace_track(packet), packet->m_nTimeStamp, result == PARTIAL_WRITE_DONE);
+        FRAME_TRACE_SOCKET_QUEUE(wire_socket(conn), trace_track(packet), packet->m_nTimeStamp);
+    }
+    int64_t end_us = send_stats_now_us();
+    bool ok = result != PARTIAL_WRITE_FAILED;
+    if (conn.stats) {
+        if (result == PARTIAL_WRITE_PENDING) conn.stats->on_partial_message();
+        conn.stats->on_packet_sent(stats_media(packet), packet->m_nBodySize, conn.rtmp->m_outChunkSize, ok,
+                                   conn.enqueue_us, start_us, end_us, syscalls);
+        conn.stats->sample_queue_depth(wire_socket(conn));
+    }
+    if (ok) {
+        conn.bytes_sent += packet->m_nBodySize;
+        return true;
+    }
+    LOGE("限时发送失败: type=%d, size=%d", packet->m_packetType, packet->m_nBodySize);
+    return false;
+}
+
+/*
+ * 批量 RTMPT：消息序列化进隧道的待发缓冲区后即返回，由发送线程合并写出；写失败在之后的发送调用中返回。
+ * 所有类型的消息都经隧道发送（接管期间 librtmp 不能写该连接），统计记录入队耗时
+ */
+static bool send_packet_rtmpt(Connection &conn, RTMPPacket *packet) {
+    FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, trace_track(packet), packet->m_nTimeStamp, packet->m_nBodySize);
+    int64_t start_us = send_stats_now_us();
+    bool ok = conn.rtmpt->submit(packet, conn.rtmp->m_outChunkSize);
+    int64_t end_us = send_stats_now_us();
+    FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, trace_track(packet), packet->m_nTimeStamp, ok ? 1 : 0);
+    if (conn.stats) {
+        conn.stats->on_packet_sent(stats_media(packet), packet->m_nBodySize, conn.rtmp->m_outChunkSize, ok,
+                                   conn.enqueue_us, start_us, end_us, 0);
+    }
+    if (ok) {
+        conn.bytes_sent += packet->m_nBodySize;
+        return true;
+    }
+    LOGE("RTMPT 隧道发送失败: type=%d, size=%d", packet->m_packetType, packet->m_nBodySize);
+    return false;
+}
+
+static bool use_zerocopy(const Connection &conn, uint8_t type, uint32_t body_size) {
+    return conn.zerocopy && type == RTMP_PACKET_TYPE_VIDEO && body_size >= conn.zerocopy->threshold();
+}
+
 static bool send_packet(Connection &conn, RTMPPacket *packet) {
     if (!conn.connected || conn.rtmp == nullptr) return false;
+    if (conn.rtmpt) return send_packet_rtmpt(conn, packet);
+    if (conn.uring) {
+        bool ok = false;
+        if (send_packet_uring(conn, packet, ok)) return ok;
+        if (!conn.uring->drain()) {
+            LOGE("io_uring 队列写失败，丢弃消息: type=%d, size=%d", packet->m_packetType, packet->m_nBodySize);
+            return false;
+        }
+    }
+    if (use_zerocopy(conn, packet->m_packetType, packet->m_nBodySize)) return send_packet_zerocopy(conn, packet);
+    if (conn.partial) {
+        // onMetaData 所在的通道依赖 librtmp 的 chunk 头压缩状态：续写完后仍经 librtmp 发送
+        if (packet->m_packetType == RTMP_PACKET_TYPE_VIDEO || packet->m_packetType == RTMP_PACKET_TYPE_AUDIO) {
+            return send_packet_partial(conn, packet);
+        }
+        int syscalls = 0;
+        int64_t now_us = send_stats_now_us();
+        int64_t deadline_us = (conn.enqueue_us > 0 ? conn.enqueue_us : now_us) + conn.send_timeout_us;
+        if (flush_partial(conn, deadline_us, &syscalls) != PARTIAL_WRITE_DONE) return false;
+    }
+    // librtmp 为预编译库，无法在 chunk 循环内打点：以 RTMP_SendPacket 的进入/返回作为首/末 chunk 写出时刻
+    FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, trace_track(packet), packet->m_nTimeStamp, packet->m_nBodySize);
+    int64_t start_us = send_stats_now_us();
     int ret = RTMP_SendPacket(conn.rtmp, packet, 0);
+    int64_t end_us = send_stats_now_us();
+    FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, trace_track(packet), packet->m_nTimeStamp, ret);
+    FRAME_TRACE_SOCKET_QUEUE(wire_socket(conn), trace_track(packet), packet->m_nTimeStamp);
+    if (conn.stats) {
+        conn.stats->on_packet_sent(stats_media(packet), packet->m_nBodySize, conn.rtmp->m_outChunkSize, ret != 0,
+                                   conn.enqueue_us, start_us, end_us);
+        conn.stats->sample_queue_depth(wire_socket(conn));
+    }
     if (ret) {
         conn.bytes_sent += packet->m_nBodySize;
         return true;
@@ -60,106 +481,60 @@ static bool send_packet(Connection &conn, RTMPPacket *packet) {
     return false;
 }
 
+/**
+ * 发送完成后释放 packet。录制中或为 header（onMetaData/序列头）时将 body 转交给 FlvTag，
+ * 录制线程直接写出同一块缓冲区，不再拷贝；以 MSG_ZEROCOPY 发出的 body 由 ZeroCopySender 持有到完成通知
+ */
+static void release_packet(Connection &conn, RTMPPacket *packet, FlvTagRef *header_slot = nullptr) {
+    bool pinned = conn.zerocopy && conn.zerocopy->awaiting_body();
+    if (conn.recorder != nullptr || header_slot != nullptr || pinned) {
+        FlvTagRef tag = std::make_shared<FlvTag>(packet);
+        if (header_slot != nullptr) *header_slot = tag;
+        if (conn.recorder != nullptr) conn.recorder->submit(tag);
+        if (pinned) conn.zerocopy->pin(tag);
+    }
+    RTMPPacket_Free(packet);
+}
+
+// 会以零拷贝发送的视频帧从连接的缓冲池取 body（完成通知后归还），其余消息照常分配
+static void alloc_video_packet(Connection &conn, RTMPPacket *packet, uint32_t body_size) {
+    if (!conn.uring && use_zerocopy(conn, RTMP_PACKET_TYPE_VIDEO, body_size) &&
+        conn.zerocopy->alloc_body(packet, body_size)) {
+        return;
+    }
+    RTMPPacket_Alloc(packet, body_size);
+}
+
+static int metadata_width(const Connection &conn) {
+    return conn.sps_width > 0 ? conn.sps_width : conn.width;
+}
+
+static int metadata_height(const Connection &conn) {
+    return conn.sps_height > 0 ? conn.sps_height : conn.height;
+}
+
 static bool send_on_metadata(Connection &conn) {
-    if (conn.sent_metadata || conn.width == 0 || conn.height == 0) {
+    int width = metadata_width(conn);
+    int height = metadata_height(conn);
+    if (conn.sent_metadata || width == 0 || height == 0) {
         LOGD("跳过发送 onMetaData: sent_metadata=%d, width=%d, height=%d", 
-             conn.sent_metadata, conn.width, conn.height);
+             conn.sent_metadata, width, height);
         return false;
     }
     
     LOGD("准备发送 onMetaData: %dx%d (宽x高), 方向=%s", 
-         conn.width, conn.height,
-         conn.width < conn.height ? "竖屏" : (conn.width > conn.height ? "横屏" : "正方形"));
+         width, height,
+         width < height ? "竖屏" : (width > height ? "横屏" : "正方形"));
 
+    int fps = conn.sps_fps > 0 ? conn.sps_fps : conn.fps;
     char body[1024];
-    char *p = body;
-    char *pend = body + sizeof(body);
-
-    // AMF0 encode: "@setDataFrame"
-    AVal method;
-    method.av_val = (char *)"@setDataFrame";
-    method.av_len = strlen(method.av_val);
-    p = AMF_EncodeString(p, pend, &method);
-    if (p == nullptr) {
-        LOGE("编码 @setDataFrame 失败");
-        return false;
-    }
-
-    // AMF0 encode: "onMetaData"
-    AVal on_metadata;
-    on_metadata.av_val = (char *)"onMetaData";
-    on_metadata.av_len = strlen(on_metadata.av_val);
-    p = AMF_EncodeString(p, pend, &on_metadata);
-    if (p == nullptr) {
-        LOGE("编码 onMetaData 失败");
+    int body_size = build_on_metadata_body(body, sizeof(body), width, height, conn.video_bitrate,
+                                           fps, conn.sample_rate, conn.channels, conn.video_codec,
+                                           conn.audio_codec, conn.audio_bitrate);
+    if (body_size < 0) {
         return false;
     }
 
-    // 手动编码 ECMA Array，避免使用 AMF_AddProp 导致的内存问题
-    if (p + 5 >= pend) return false;
-    *p++ = AMF_ECMA_ARRAY; // ECMA Array 类型
-    
-    // 写入属性数量（12 个）
-    uint32_t count = 12;
-    *p++ = (count >> 24) & 0xFF;
-    *p++ = (count >> 16) & 0xFF;
-    *p++ = (count >> 8) & 0xFF;
-    *p++ = count & 0xFF;
-
-    // 辅助函数：手动编码 AMF 数字属性
-    auto encode_number = [&](const char *name, double value) -> bool {
-        int name_len = strlen(name);
-        if (p + 2 + name_len + 9 >= pend) return false;
-        
-        // 写入名称长度和名称
-        *p++ = (name_len >> 8) & 0xFF;
-        *p++ = name_len & 0xFF;
-        memcpy(p, name, name_len);
-        p += name_len;
-        
-        // 写入 AMF NUMBER 类型和值
-        p = AMF_EncodeNumber(p, pend, value);
-        return p != nullptr;
-    };
-    
-    // 辅助函数：手动编码 AMF 布尔属性
-    auto encode_boolean = [&](const char *name, bool value) -> bool {
-        int name_len = strlen(name);
-        if (p + 2 + name_len + 2 >= pend) return false;
-        
-        // 写入名称长度和名称
-        *p++ = (name_len >> 8) & 0xFF;
-        *p++ = name_len & 0xFF;
-        memcpy(p, name, name_len);
-        p += name_len;
-        
-        // 写入 AMF BOOLEAN 类型和值
-        p = AMF_EncodeBoolean(p, pend, value);
-        return p != nullptr;
-    };
-
-    // 编码所有属性
-    if (!encode_number("width", (double)conn.width)) { LOGE("编码 width 失败"); return false; }
-    if (!encode_number("height", (double)conn.height)) { LOGE("编码 height 失败"); return false; }
-    if (!encode_number("videocodecid", 7.0)) { LOGE("编码 videocodecid 失败"); return false; }
-    if (!encode_number("videodatarate", (double)conn.video_bitrate / 1000.0)) { LOGE("编码 videodatarate 失败"); return false; }
-    if (!encode_number("framerate", (double)conn.fps)) { LOGE("编码 framerate 失败"); return false; }
-    if (!encode_number("audiocodecid", 10.0)) { LOGE("编码 audiocodecid 失败"); return false; }
-    if (!encode_number("audiodatarate", 64.0)) { LOGE("编码 audiodatarate 失败"); return false; }
-    if (!encode_number("audiosamplerate", (double)conn.sample_rate)) { LOGE("编码 audiosamplerate 失败"); return false; }
-    if (!encode_number("audiosamplesize", 16.0)) { LOGE("编码 audiosamplesize 失败"); return false; }
-    if (!encode_boolean("stereo", conn.channels > 1)) { LOGE("编码 stereo 失败"); return false; }
-    if (!encode_number("duration", 0.0)) { LOGE("编码 duration 失败"); return false; }
-    if (!encode_number("filesize", 0.0)) { LOGE("编码 filesize 失败"); return false; }
-
-    // 写入 ECMA Array 结束标记（3 字节：0x00 0x00 0x09）
-    if (p + 3 >= pend) { LOGE("缓冲区不足"); return false; }
-    *p++ = 0x00;
-    *p++ = 0x00;
-    *p++ = 0x09; // AMF_OBJECT_END
-
-    int body_size = p - body;
-
     RTMPPacket packet;
     RTMPPacket_Alloc(&packet, body_size);
     RTMPPacket_Reset(&packet);
@@ -172,113 +547,44 @@ static bool send_on_metadata(Connection &conn) {
     packet.m_hasAbsTimestamp = 1;
 
     bool ok = send_packet(conn, &packet);
-    RTMPPacket_Free(&packet);
+    release_packet(conn, &packet, &conn.last_metadata);
     if (ok) {
         conn.sent_metadata = true;
         LOGD("发送 onMetaData 成功: %dx%d, bitrate=%d, fps=%d", 
-             conn.width, conn.height, conn.video_bitrate, conn.fps);
+             width, height, conn.video_bitrate, fps);
     }
     return ok;
 }
 
-static void write_be32(uint8_t *dst, uint32_t val) {
-    dst[0] = (val >> 24) & 0xFF;
-    dst[1] = (val >> 16) & 0xFF;
-    dst[2] = (val >> 8) & 0xFF;
-    dst[3] = val & 0xFF;
-}
-
-static void parse_sps_pps(const uint8_t *data, int size, std::vector<uint8_t> &sps, std::vector<uint8_t> &pps) {
-    int i = 0;
-    while (i + 4 < size) {
-        // find start code
-        int start = -1;
-        int prefix = 0;
-        for (; i + 3 < size; ++i) {
-            if (data[i] == 0x00 && data[i+1] == 0x00) {
-                if (data[i+2] == 0x01) { prefix = 3; start = i; break; }
-                if (i + 4 < size && data[i+2] == 0x00 && data[i+3] == 0x01) { prefix = 4; start = i; break; }
-            }
-        }
-        if (start < 0) break;
-        int nal_start = start + prefix;
-        int j = nal_start;
-        // find next start code
-        int next = size;
-        for (; j + 3 < size; ++j) {
-            if (data[j] == 0x00 && data[j+1] == 0x00) {
-                if (data[j+2] == 0x01 || (j + 4 < size && data[j+2] == 0x00 && data[j+3] == 0x01)) {
-                    next = j;
-                    break;
-                }
-            }
-        }
-        int nal_size = next - nal_start;
-        if (nal_size <= 0) { i = next; continue; }
-        uint8_t nal_type = data[nal_start] & 0x1F;
-        if (nal_type == 7) {
-            sps.assign(data + nal_start, data + nal_start + nal_size);
-            LOGD("找到 SPS: size=%d", nal_size);
-        } else if (nal_type == 8) {
-            pps.assign(data + nal_start, data + nal_start + nal_size);
-            LOGD("找到 PPS: size=%d", nal_size);
-        }
-        i = next;
-    }
-}
-
-static bool send_avc_sequence_header(Connection &conn, uint32_t timestamp_ms) {
-    if (conn.sps.empty() || conn.pps.empty()) {
-        LOGE("无法发送 AVC sequence header: SPS size=%zu, PPS size=%zu", conn.sps.size(), conn.pps.size());
+static bool send_video_sequence_header(Connection &conn, uint32_t timestamp_ms) {
+    const char *codec_name = conn.video_codec == RTMP_VIDEO_CODEC_HEVC ? "HEVC" : "AVC";
+    std::vector<uint8_t> body;
+    if (build_video_sequence_header(conn.video_codec, conn.vps, conn.sps, conn.pps, body) < 0) {
+        LOGE("无法发送 %s sequence header: VPS size=%zu, SPS size=%zu, PPS size=%zu", codec_name,
+             conn.vps.size(), conn.sps.size(), conn.pps.size());
         return false;
     }
 
-    LOGD("准备发送 AVC sequence header: SPS size=%zu, PPS size=%zu", conn.sps.size(), conn.pps.size());
+    LOGD("准备发送 %s sequence header: SPS size=%zu, PPS size=%zu", codec_name, conn.sps.size(), conn.pps.size());
 
-    const size_t body_size = 5 + 1 + 2 + conn.sps.size() + 1 + 2 + conn.pps.size();
     RTMPPacket packet;
-    RTMPPacket_Alloc(&packet, body_size + 5);
+    RTMPPacket_Alloc(&packet, body.size());
     RTMPPacket_Reset(&packet);
-
-    uint8_t *body = reinterpret_cast<uint8_t *>(packet.m_body);
-    size_t idx = 0;
-    body[idx++] = 0x17; // keyframe + AVC
-    body[idx++] = 0x00; // AVC sequence header
-    body[idx++] = 0x00; body[idx++] = 0x00; body[idx++] = 0x00; // composition time
-
-    // AVCDecoderConfigurationRecord
-    body[idx++] = 0x01; // version
-    body[idx++] = conn.sps[1]; // profile
-    body[idx++] = conn.sps[2]; // compat
-    body[idx++] = conn.sps[3]; // level
-    body[idx++] = 0xFF; // 4 bytes length
-
-    body[idx++] = 0xE1; // 1 sps
-    body[idx++] = (conn.sps.size() >> 8) & 0xFF;
-    body[idx++] = conn.sps.size() & 0xFF;
-    memcpy(body + idx, conn.sps.data(), conn.sps.size());
-    idx += conn.sps.size();
-
-    body[idx++] = 0x01; // 1 pps
-    body[idx++] = (conn.pps.size() >> 8) & 0xFF;
-    body[idx++] = conn.pps.size() & 0xFF;
-    memcpy(body + idx, conn.pps.data(), conn.pps.size());
-    idx += conn.pps.size();
-
+    memcpy(packet.m_body, body.data(), body.size());
     packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
-    packet.m_nBodySize = idx;
+    packet.m_nBodySize = body.size();
     packet.m_nTimeStamp = timestamp_ms;
     packet.m_nChannel = 0x04;
     packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
     packet.m_hasAbsTimestamp = 1;
 
     bool ok = send_packet(conn, &packet);
-    RTMPPacket_Free(&packet);
+    release_packet(conn, &packet, &conn.last_video_config);
     if (ok) {
         conn.sent_video_config = true;
-        LOGD("AVC sequence header 发送成功，sent_video_config 已设置为 true");
+        LOGD("%s sequence header 发送成功，sent_video_config 已设置为 true", codec_name);
     } else {
-        LOGE("AVC sequence header 发送失败");
+        LOGE("%s sequence header 发送失败", codec_name);
     }
     return ok;
 }
@@ -287,83 +593,34 @@ static bool send_video_frame(Connection &conn, const uint8_t *data, int size, ui
     // 只有发送了 video config 后才能发送视频帧
     if (!conn.sent_video_config) {
         LOGD("跳过视频帧（未发送 video config）");
+        cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
         return true; // 返回 true 避免报错
     }
-    
-    // 调试：打印前几个字节，用于验证数据格式
-    static int debug_frame_count = 0;
-    if (debug_frame_count++ % 30 == 0) {
-        char hex_buf[64] = {0};
-        int hex_len = size < 16 ? size : 16;
-        for (int i = 0; i < hex_len; i++) {
-            sprintf(hex_buf + i * 3, "%02x ", data[i]);
-        }
-        LOGD("视频帧数据 (前%d字节): %s, size=%d, isKey=%d", hex_len, hex_buf, size, is_key);
+
+    // 参考链已断开：非关键帧解码必然花屏，直接丢弃直至下一个关键帧
+    if (conn.waiting_keyframe && !is_key) {
+        if (conn.stats) conn.stats->on_video_dropped();
+        return true;
     }
     
     // Build body
     std::vector<uint8_t> body;
-    body.reserve(size + 9);
-    body.push_back(is_key ? 0x17 : 0x27); // frame type + codec
-    body.push_back(0x01); // AVC NALU
-    body.push_back(0x00);
-    body.push_back(0x00);
-    body.push_back(0x00); // composition time
-
-    // convert annex-b to length-prefixed, skip sps/pps
-    int i = 0;
-    int nalu_count = 0;
-    while (i + 4 <= size) {
-        int start = -1;
-        int prefix = 0;
-        for (; i + 3 < size; ++i) {
-            if (data[i] == 0x00 && data[i+1] == 0x00) {
-                if (data[i+2] == 0x01) { start = i; prefix = 3; break; }
-                if (i + 4 < size && data[i+2] == 0x00 && data[i+3] == 0x01) { start = i; prefix = 4; break; }
-            }
-        }
-        if (start < 0) break;
-        int nal_start = start + prefix;
-        int j = nal_start;
-        int next = size;
-        for (; j + 3 < size; ++j) {
-            if (data[j] == 0x00 && data[j+1] == 0x00) {
-                if (data[j+2] == 0x01 || (j + 4 < size && data[j+2] == 0x00 && data[j+3] == 0x01)) {
-                    next = j;
-                    break;
-                }
-            }
-        }
-        int nal_size = next - nal_start;
-        if (nal_size <= 0) { i = next; continue; }
-        uint8_t nal_type = data[nal_start] & 0x1F;
-        if (nal_type == 7 || nal_type == 8) { 
-            LOGD("跳过 SPS/PPS NALU (type=%d)", nal_type);
-            i = next; 
-            continue; 
-        } // skip sps/pps
-
-        body.resize(body.size() + 4);
-        write_be32(body.data() + body.size() - 4, static_cast<uint32_t>(nal_size));
-        body.insert(body.end(), data + nal_start, data + nal_start + nal_size);
-        nalu_count++;
-        i = next;
-    }
+    int nalu_count = annexb_to_video_body(data, size, is_key, conn.video_codec, body);
+    FRAME_TRACE(FRAME_TRACE_NAL_PARSED, FRAME_TRACE_VIDEO, timestamp_ms, nalu_count);
 
     if (body.size() <= 5) {
-        LOGD("视频帧无有效 NALU（可能只有 SPS/PPS）");
+        LOGD("视频帧无有效 NALU（可能只有参数集）");
         return true; // 返回 true 避免报错
     }
     
     // 记录日志（每隔 30 帧记录一次，避免日志过多）
-    static int frame_count = 0;
-    if (frame_count++ % 30 == 0) {
+    if (conn.video_frame_count++ % 30 == 0) {
         LOGD("发送视频帧: timestamp=%u, isKey=%d, nalu_count=%d, body_size=%zu", 
              timestamp_ms, is_key, nalu_count, body.size());
     }
 
     RTMPPacket packet;
-    RTMPPacket_Alloc(&packet, body.size());
+    alloc_video_packet(conn, &packet, body.size());
     RTMPPacket_Reset(&packet);
     memcpy(packet.m_body, body.data(), body.size());
     packet.m_nBodySize = body.size();
@@ -372,59 +629,30 @@ static bool send_video_frame(Connection &conn, const uint8_t *data, int size, ui
     packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
     packet.m_nTimeStamp = timestamp_ms;
     packet.m_hasAbsTimestamp = 1;
+    FRAME_TRACE(FRAME_TRACE_PACKET_BUILT, FRAME_TRACE_VIDEO, timestamp_ms, packet.m_nBodySize);
 
     bool ok = send_packet(conn, &packet);
-    RTMPPacket_Free(&packet);
+    release_packet(conn, &packet);
     if (!ok) {
-        LOGE("RTMP_SendPacket 失败");
+        // 续写未完成而未发送（RTMP_SEND_WOULD_BLOCK）与发送失败一样切断参考链
+        if (!conn.send_blocked) LOGE("RTMP_SendPacket 失败");
+        cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
+    } else if (is_key) {
+        conn.waiting_keyframe = false;
     }
     return ok;
 }
 
-static int aac_sample_rate_index(int sample_rate) {
-    switch (sample_rate) {
-        case 96000: return 0;
-        case 88200: return 1;
-        case 64000: return 2;
-        case 48000: return 3;
-        case 44100: return 4;
-        case 32000: return 5;
-        case 24000: return 6;
-        case 22050: return 7;
-        case 16000: return 8;
-        case 12000: return 9;
-        case 11025: return 10;
-        case 8000:  return 11;
-        case 7350:  return 12;
-        default:    return 4; // default 44.1k
-    }
-}
-
-static bool send_aac_sequence_header(Connection &conn) {
-    uint8_t audio_header = 0;
-    int sample_index = aac_sample_rate_index(conn.sample_rate);
-    // SoundFormat(4)=10(AAC), SoundRate(2), SoundSize(1)=1(16bit), SoundType(1)=mono/stereo
-    audio_header = (10 << 4) | (sample_index >= 6 ? 0x2 : 0x3) << 2; // rate encoded below
-    audio_header |= 0x2; // 16 bit
-    audio_header |= (conn.channels == 1 ? 0x0 : 0x1);
-
-    uint8_t asc[2];
-    int profile = 2; // AAC LC
-    asc[0] = (profile << 3) | ((sample_index & 0x0E) >> 1);
-    asc[1] = ((sample_index & 0x01) << 7) | (conn.channels << 3);
-
-    uint8_t body[4 + 2];
-    size_t idx = 0;
-    body[idx++] = audio_header;
-    body[idx++] = 0x00; // AAC sequence header
-    body[idx++] = asc[0];
-    body[idx++] = asc[1];
+static bool send_audio_sequence_header(Connection &conn) {
+    uint8_t body[32];
+    int size = build_audio_sequence_header(conn.audio_codec, conn.sample_rate, conn.channels, body, sizeof(body));
+    if (size < 0) return false;
 
     RTMPPacket packet;
-    RTMPPacket_Alloc(&packet, idx);
+    RTMPPacket_Alloc(&packet, size);
     RTMPPacket_Reset(&packet);
-    memcpy(packet.m_body, body, idx);
-    packet.m_nBodySize = idx;
+    memcpy(packet.m_body, body, size);
+    packet.m_nBodySize = size;
     packet.m_packetType = RTMP_PACKET_TYPE_AUDIO;
     packet.m_nChannel = 0x04;
     packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
@@ -432,68 +660,141 @@ static bool send_aac_sequence_header(Connection &conn) {
     packet.m_hasAbsTimestamp = 1;
 
     bool ok = send_packet(conn, &packet);
-    RTMPPacket_Free(&packet);
+    release_packet(conn, &packet, &conn.last_audio_config);
     if (ok) {
         conn.sent_audio_config = true;
     } else {
-        LOGE("发送 AAC sequence header 失败");
+        LOGE("发送 %s sequence header 失败", conn.audio_codec == RTMP_AUDIO_CODEC_OPUS ? "Opus" : "AAC");
     }
     return ok;
 }
 
-static bool send_aac_frame(Connection &conn, const uint8_t *data, int size, uint32_t timestamp_ms) {
+static bool send_audio_frame(Connection &conn, const uint8_t *data, int size, uint32_t timestamp_ms) {
     if (size <= 0) return false;
 
     // skip ADTS header if present
     int offset = 0;
-    if (size > 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) {
+    if (conn.audio_codec == RTMP_AUDIO_CODEC_AAC && size > 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) {
         offset = 7;
     }
 
-    uint8_t audio_header = 0;
-    int sample_index = aac_sample_rate_index(conn.sample_rate);
-    audio_header = (10 << 4) | (sample_index >= 6 ? 0x2 : 0x3) << 2;
-    audio_header |= 0x2;
-    audio_header |= (conn.channels == 1 ? 0x0 : 0x1);
+    uint8_t header[FLV_AUDIO_HEADER_MAX];
+    int header_size = build_audio_frame_header(conn.audio_codec, conn.sample_rate, conn.channels, header);
 
     RTMPPacket packet;
-    RTMPPacket_Alloc(&packet, size - offset + 2);
+    RTMPPacket_Alloc(&packet, size - offset + header_size);
     RTMPPacket_Reset(&packet);
     uint8_t *body = reinterpret_cast<uint8_t *>(packet.m_body);
-    size_t idx = 0;
-    body[idx++] = audio_header;
-    body[idx++] = 0x01; // AAC raw
-    memcpy(body + idx, data + offset, size - offset);
-    idx += size - offset;
+    memcpy(body, header, header_size);
+    memcpy(body + header_size, data + offset, size - offset);
 
-    packet.m_nBodySize = idx;
+    packet.m_nBodySize = size - offset + header_size;
     packet.m_packetType = RTMP_PACKET_TYPE_AUDIO;
     packet.m_nChannel = 0x04;
     packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
     packet.m_nTimeStamp = timestamp_ms;
     packet.m_hasAbsTimestamp = 1;
+    FRAME_TRACE(FRAME_TRACE_PACKET_BUILT, FRAME_TRACE_AUDIO, timestamp_ms, packet.m_nBodySize);
 
     bool ok = send_packet(conn, &packet);
-    RTMPPacket_Free(&packet);
-    if (!ok) {
-        LOGE("发送 AAC 帧失败: timestamp=%u, size=%d", timestamp_ms, size);
+    release_packet(conn, &packet);
+    if (!ok && !conn.send_blocked) {
+        LOGE("发送音频帧失败: timestamp=%u, size=%d", timestamp_ms, size);
     }
     return ok;
 }
 
-rtmp_handle_t rtmp_init(const char *url) {
-    if (url == nullptr || strlen(url) == 0) {
-        LOGE("RTMP URL 为空");
-        return 0;
+// 解析直连或 SOCKS 代理的地址（与 RTMP_Connect 相同，仅 IPv4）
+static bool resolve_service(RTMP *rtmp, struct sockaddr_in *service) {
+    const AVal &host = rtmp->Link.socksport ? rtmp->Link.sockshost : rtmp->Link.hostname;
+    int port = rtmp->Link.socksport ? rtmp->Link.socksport : rtmp->Link.port;
+    if (host.av_len == 0) return false;
+    std::string host_name(host.av_val, host.av_len);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(host_name.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        LOGE("无法解析主机名: %s", host_name.c_str());
+        return false;
     }
+    memcpy(service, result->ai_addr, sizeof(*service));
+    freeaddrinfo(result);
+    service->sin_port = htons((uint16_t) port);
+    return true;
+}
 
-    LOGD("开始初始化 RTMP，URL: %s", url);
+/*
+ * 按 RTMP_Connect 的步骤建立连接并分段计时：
+ *   - fast_open 时以 TCP_FASTOPEN_CONNECT 建立 TCP 连接（经 SOCKS 代理时不使用），有 cookie 时第一次发送
+ *     （C0+C1，RTMPS 为 TLS ClientHello）随 SYN 发出，syn_data 输出是否如此；
+ *   - RTMPS：librtmp 以 NO_CRYPTO 编译，RTMP_Connect1 遇到 RTMP_FEATURE_SSL 会直接失败。去掉该标志，
+ *     TCP 连接之后由 TlsSession 完成 TLS 握手，再由 RTMP_Connect1 继续（RTMPTS 的 HTTP 隧道同样走在 TLS 之上）
+ */
+static bool connect_rtmp(RTMP *rtmp, bool fast_open, TlsSession **tls, rtmp_connect_timing *timing, bool *syn_data) {
+    *syn_data = false;
+    bool ssl = (rtmp->Link.protocol & RTMP_FEATURE_SSL) != 0;
+    TlsConfig config;
+    if (ssl) {
+        if (!tls_available()) {
+            LOGE("未以 BB_RTMP_TLS 编译，不支持 RTMPS");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(g_tls_mutex);
+        config = g_tls_config;
+        rtmp->Link.protocol &= ~RTMP_FEATURE_SSL;
+    }
 
-    std::lock_guard<std::mutex> lock(g_mutex);
+    int64_t start_us = send_stats_now_us();
+    struct sockaddr_in service;
+    if (!resolve_service(rtmp, &service)) return false;
+    int64_t now_us = send_stats_now_us();
+    timing->dns_us = now_us - start_us;
+    start_us = now_us;
+
+    int result = FAST_OPEN_UNSUPPORTED;
+    if (fast_open && !rtmp->Link.socksport) {
+        int fd = -1;
+        result = fast_open_connect(&service, rtmp->Link.timeout, &fd);
+        if (result == FAST_OPEN_FAILED) return false;
+        if (result != FAST_OPEN_UNSUPPORTED) {
+            rtmp->m_sb.sb_socket = fd;
+            *syn_data = result == FAST_OPEN_DEFERRED;
+            // 握手完成后按 TCP_INFO 确认 SYN 数据是否被接受
+            timing->fast_open = *syn_data ? RTMP_FAST_OPEN_REFUSED : RTMP_FAST_OPEN_NO_COOKIE;
+        }
+    }
+    if (result == FAST_OPEN_UNSUPPORTED && !RTMP_Connect0(rtmp, (struct sockaddr *) &service)) return false;
+    rtmp->m_bSendCounter = TRUE;
+    now_us = send_stats_now_us();
+    timing->tcp_connect_us = now_us - start_us;
+    start_us = now_us;
+
+    if (ssl) {
+        std::string server_name(rtmp->Link.hostname.av_val, rtmp->Link.hostname.av_len);
+        *tls = TlsSession::connect(&rtmp->m_sb.sb_socket, server_name, config);
+        if (*tls == nullptr) {
+            LOGE("TLS 握手失败: %s", server_name.c_str());
+            return false;
+        }
+        LOGD("RTMPS 已建立: %s %s, mode=%s", (*tls)->version(), (*tls)->cipher(),
+             (*tls)->mode() == TLS_MODE_KERNEL ? "kernel" : "userspace");
+        now_us = send_stats_now_us();
+        timing->tls_us = now_us - start_us;
+        start_us = now_us;
+    }
+    bool ok = RTMP_Connect1(rtmp, nullptr) != 0;
+    timing->rtmp_connect_us = send_stats_now_us() - start_us;
+    return ok;
+}
+
+// 分配 RTMP 并解析推流地址；url_copy 输出 librtmp 引用的地址副本（随连接释放）；publish 为 false 时以 play 模式连接
+static RTMP *setup_rtmp(const char *url, char **url_copy, bool publish) {
     RTMP *rtmp = RTMP_Alloc();
     if (!rtmp) {
         LOGE("RTMP_Alloc 失败");
-        return 0;
+        return nullptr;
     }
     RTMP_Init(rtmp);
     
@@ -501,13 +802,14 @@ rtmp_handle_t rtmp_init(const char *url) {
     RTMP_SetBufferMS(rtmp, 10000); // 10 秒缓冲区
     rtmp->Link.timeout = 10; // 10 秒连接超时
     
-    char *url_copy = strdup(url);
+    *url_copy = strdup(url);
     LOGD("调用 RTMP_SetupURL");
-    if (!RTMP_SetupURL(rtmp, url_copy)) {
+    if (!RTMP_SetupURL(rtmp, *url_copy)) {
         LOGE("RTMP_SetupURL 失败，URL 可能格式错误: %s", url);
-        free(url_copy);
+        free(*url_copy);
+        *url_copy = nullptr;
         RTMP_Free(rtmp);
-        return 0;
+        return nullptr;
     }
     
     // 打印解析后的连接信息（用于调试）
@@ -518,19 +820,55 @@ rtmp_handle_t rtmp_init(const char *url) {
     LOGD("  tcUrl: %.*s", rtmp->Link.tcUrl.av_len, rtmp->Link.tcUrl.av_val);
     LOGD("  port: %d", rtmp->Link.port);
     
-    LOGD("RTMP_SetupURL 成功，调用 RTMP_EnableWrite");
-    RTMP_EnableWrite(rtmp);
+    if (publish) {
+        LOGD("RTMP_SetupURL 成功，调用 RTMP_EnableWrite");
+        RTMP_EnableWrite(rtmp);
+    }
     
     // 设置连接超时（5秒）
     rtmp->Link.timeout = 5;
-    
-    LOGD("尝试连接 RTMP 服务器...");
-    if (!RTMP_Connect(rtmp, nullptr)) {
-        LOGE("RTMP_Connect 失败，无法连接到服务器: %s", url);
-        LOGE("  可能原因: 1) 服务器地址或端口错误 2) 网络不通 3) 服务器未启动");
+    return rtmp;
+}
+
+rtmp_handle_t rtmp_init(const char *url) {
+    if (url == nullptr || strlen(url) == 0) {
+        LOGE("RTMP URL 为空");
+        return 0;
+    }
+
+    LOGD("开始初始化 RTMP，URL: %s", url);
+    bb_log_install_librtmp();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    bool fast_open = g_fast_open.load();
+    rtmp_connect_timing timing;
+    memset(&timing, 0, sizeof(timing));
+    int64_t start_us = send_stats_now_us();
+    RTMP *rtmp = nullptr;
+    char *url_copy = nullptr;
+    TlsSession *tls = nullptr;
+    for (;;) {
+        rtmp = setup_rtmp(url, &url_copy, true);
+        if (!rtmp) return 0;
+
+        LOGD("尝试连接 RTMP 服务器...");
+        bool syn_data = false;
+        if (connect_rtmp(rtmp, fast_open, &tls, &timing, &syn_data)) break;
         RTMP_Close(rtmp);
         RTMP_Free(rtmp);
-        return 0;
+        free(url_copy);
+        delete tls;
+        tls = nullptr;
+        if (!syn_data) {
+            LOGE("RTMP_Connect 失败，无法连接到服务器: %s", url);
+            LOGE("  可能原因: 1) 服务器地址或端口错误 2) 网络不通 3) 服务器未启动");
+            return 0;
+        }
+        // 携带数据的 SYN 可能被中间设备丢弃（RTMP_Close 已释放 librtmp 解析的地址，重新解析）
+        LOGE("TCP Fast Open 连接失败，关闭 TFO 重新连接: %s", url);
+        fast_open = false;
+        memset(&timing, 0, sizeof(timing));
+        timing.fast_open = RTMP_FAST_OPEN_FALLBACK;
     }
     
     LOGD("RTMP_Connect 成功，尝试连接流...");
@@ -543,26 +881,171 @@ rtmp_handle_t rtmp_init(const char *url) {
     setsockopt(rtmp->m_sb.sb_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(tv));
     setsockopt(rtmp->m_sb.sb_socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
 
+    int64_t stream_start_us = send_stats_now_us();
     if (!RTMP_ConnectStream(rtmp, 0)) {
         LOGE("RTMP_ConnectStream 失败，无法连接到流: %s", url);
         RTMP_Close(rtmp);
         RTMP_Free(rtmp);
+        free(url_copy);
+        delete tls;
         return 0;
     }
+    int64_t now_us = send_stats_now_us();
+    timing.connect_stream_us = now_us - stream_start_us;
+    timing.total_us = now_us - start_us;
 
     long handle = g_next_handle++;
     Connection conn;
     conn.rtmp = rtmp;
     conn.connected = true;
     conn.url_copy = url_copy;
+    conn.tls = tls;
+    conn.stats = std::make_shared<SendStats>();
+
+    TcpConnectInfo info;
+    if (tcp_connect_info(wire_socket(conn), &info)) {
+        timing.rtt_us = info.rtt_us;
+        if (timing.fast_open == RTMP_FAST_OPEN_REFUSED && info.syn_data_acked) {
+            timing.fast_open = RTMP_FAST_OPEN_USED;
+            timing.saved_rtt_us = info.rtt_us;
+        }
+    }
+    conn.connect_timing = timing;
+    conn.receiver = std::make_shared<RtmpReceiver>(RTMP_Socket(rtmp));
+    if (!conn.receiver->adopt(rtmp)) conn.receiver.reset();  // RTMPT 的应答由 librtmp（或批量隧道）处理
+    conn.bytes_in_base = (uint32_t) rtmp->m_nBytesIn;
+    conn.bytes_in_acked = (uint32_t) rtmp->m_nBytesInSent;
+    if (rtmp->m_nServerBW > 0) conn.window_ack_size = (uint32_t) rtmp->m_nServerBW;
+    if (fast_open || timing.fast_open != RTMP_FAST_OPEN_OFF) {
+        LOGD("TCP Fast Open: state=%d, tcp_connect=%lldus, rtmp_connect=%lldus, rtt=%lldus", timing.fast_open,
+             (long long) timing.tcp_connect_us, (long long) timing.rtmp_connect_us, (long long) timing.rtt_us);
+    }
     g_connections[handle] = conn;
+    {
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        g_stats[handle] = conn.stats;
+    }
 
     LOGD("RTMP 初始化成功 handle=%ld (AMF0 支持已启用)", handle);
     return handle;
 }
 
-int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame) {
-    std::lock_guard<std::mutex> lock(g_mutex);
+/*
+ * 切换到最近收到的参数集：下一次发送时重发序列头；H.264 从 SPS 取宽高与帧率，
+ * 变化时一并重发 onMetaData，不依赖调用方先调用 rtmp_set_metadata
+ */
+static void apply_parameter_sets(Connection &conn) {
+    conn.vps = conn.next_vps;
+    conn.sps = conn.next_sps;
+    conn.pps = conn.next_pps;
+    conn.sent_video_config = false;
+    LOGD("参数集变化: vps_size=%zu, sps_size=%zu, pps_size=%zu", conn.vps.size(), conn.sps.size(), conn.pps.size());
+    if (conn.video_codec != RTMP_VIDEO_CODEC_H264) return;
+
+    H264Sps info;
+    int width = 0, height = 0, fps = 0;
+    if (h264_parse_sps(conn.sps.data(), conn.sps.size(), info)) {
+        width = info.width();
+        height = info.height();
+        fps = info.frame_rate();
+        LOGD("解析 SPS: %dx%d, profile=%d, level=%d, fps=%d", width, height, info.profile_idc, info.level_idc, fps);
+    } else {
+        LOGE("无法解析 SPS，onMetaData 使用 rtmp_set_metadata 设置的宽高");
+    }
+    if (width != conn.sps_width || height != conn.sps_height || fps != conn.sps_fps) {
+        conn.sps_width = width;
+        conn.sps_height = height;
+        conn.sps_fps = fps;
+        conn.sent_metadata = false;
+    }
+}
+
+static const int64_t kServerPollIntervalMs = 100;
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+// 在控制通道（chunk stream 2）上发送协议控制消息，返回是否发送成功
+static bool send_control_message(Connection &conn, uint8_t type, const uint8_t *data, uint32_t size) {
+    RTMPPacket packet;
+    RTMPPacket_Reset(&packet);
+    if (!RTMPPacket_Alloc(&packet, size)) return false;
+    packet.m_packetType = type;
+    packet.m_nChannel = 0x02;
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_nBodySize = size;
+    memcpy(packet.m_body, data, size);
+    bool ok = send_packet(conn, &packet);
+    RTMPPacket_Free(&packet);
+    return ok;
+}
+
+// 收到的字节数达到窗口一半时发送 Acknowledgement；发送失败时不推进已确认字节数，下一次读取时重试
+static void send_ack_if_due(Connection &conn) {
+    uint64_t received = conn.bytes_in_base + conn.receiver->stats().bytes_in;
+    if (conn.window_ack_size == 0 || received - conn.bytes_in_acked < conn.window_ack_size / 2) return;
+    const uint8_t ack[4] = {(uint8_t) (received >> 24), (uint8_t) (received >> 16), (uint8_t) (received >> 8),
+                            (uint8_t) received};
+    if (send_control_message(conn, RTMP_PACKET_TYPE_BYTES_READ_REPORT, ack, sizeof(ack))) {
+        conn.bytes_in_acked = received;
+    }
+}
+
+// 应答 ping；发送失败时留待下一次读取重发
+static void send_ping_reply(Connection &conn) {
+    conn.ping_reply_pending = !send_control_message(conn, RTMP_PACKET_TYPE_CONTROL, conn.ping_reply,
+                                                    sizeof(conn.ping_reply));
+}
+
+/*
+ * 非阻塞读取服务端下发的消息（g_mutex 内、发送之前调用，每 kServerPollIntervalMs 最多一次）：跟随 Set Chunk Size
+ * 与 Window Acknowledgement Size，收到的字节数达到窗口一半时发送 Acknowledgement（与 librtmp 相同），
+ * 应答 ping（服务端据此判断推流端存活），记录 onStatus 等命令；服务端关闭连接时标记断开，本次及之后的发送直接失败。
+ * 限时发送有续写未完成时控制消息会发送失败：上次未发出的 Acknowledgement 与 ping 应答在读取前先重发
+ */
+static void poll_server_messages(Connection &conn) {
+    if (!conn.receiver) return;
+    int64_t now_ms = monotonic_ms();
+    if (now_ms - conn.last_server_poll_ms < kServerPollIntervalMs) return;
+    conn.last_server_poll_ms = now_ms;
+    if (conn.ping_reply_pending) send_ping_reply(conn);
+    send_ack_if_due(conn);
+    RtmpMessage message;
+    int result;
+    while ((result = conn.receiver->read(&message, 0)) == 1) {
+        send_ack_if_due(conn);
+        const uint8_t *body = message.body;
+        if (message.type == RTMP_PACKET_TYPE_CHUNK_SIZE && message.size >= 4) {
+            uint32_t size = read_be32(body) & 0x7fffffff;
+            if (size > 0) conn.receiver->set_chunk_size(size);
+        } else if (message.type == RTMP_PACKET_TYPE_SERVER_BW && message.size >= 4) {
+            if (read_be32(body) > 0) conn.window_ack_size = read_be32(body);
+        } else if (message.type == RTMP_PACKET_TYPE_CONTROL && message.size >= 6 && body[0] == 0 && body[1] == 6) {
+            conn.ping_reply[0] = 0;
+            conn.ping_reply[1] = 7;
+            memcpy(conn.ping_reply + 2, body + 2, 4);
+            send_ping_reply(conn);
+        } else if (message.type == RTMP_PACKET_TYPE_INVOKE && message.size >= 3 && body[0] == AMF_STRING) {
+            AVal name;
+            AMF_DecodeString(reinterpret_cast<const char *>(body) + 1, &name);
+            if ((uint32_t) name.av_len + 3 <= message.size) LOGD("服务端命令: %.*s", name.av_len, name.av_val);
+        }
+    }
+    if (result < 0) {
+        if (conn.receiver->error() != nullptr) {
+            // 解析失败不影响发送，只是不再读取
+            LOGE("读取服务端消息失败，停止读取: %s", conn.receiver->error());
+        } else {
+            LOGE("服务端关闭了连接");
+            conn.connected = false;
+        }
+        conn.receiver.reset();
+    }
+}
+
+static int send_video_locked(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame,
+                             KeyFrameRequest &keyframe_req) {
     auto it = g_connections.find(handle);
     if (it == g_connections.end() || !it->second.connected) {
         LOGE("无效的句柄: %ld", handle);
@@ -573,69 +1056,107 @@ int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long ti
         LOGE("无效的视频数据: size=%d", size);
         return -1;
     }
+    poll_server_messages(conn);
+    if (!conn.connected) return -1;
+    conn.send_blocked = false;
 
-    // 解析 SPS/PPS
-    size_t old_sps_size = conn.sps.size();
-    size_t old_pps_size = conn.pps.size();
-    parse_sps_pps(data, size, conn.sps, conn.pps);
-    
-    // 如果找到了新的 SPS/PPS，记录日志
-    if (conn.sps.size() != old_sps_size || conn.pps.size() != old_pps_size) {
-        LOGD("找到 SPS/PPS: sps_size=%zu, pps_size=%zu", conn.sps.size(), conn.pps.size());
+    // 解析参数集（H.264 SPS/PPS，HEVC VPS/SPS/PPS），按内容与当前序列头比较
+    parse_parameter_sets(data, size, conn.video_codec, conn.next_vps, conn.next_sps, conn.next_pps);
+    bool next_complete = !conn.next_sps.empty() && !conn.next_pps.empty() &&
+                         (conn.video_codec != RTMP_VIDEO_CODEC_HEVC || !conn.next_vps.empty());
+    bool changed = conn.next_sps != conn.sps || conn.next_pps != conn.pps || conn.next_vps != conn.vps;
+    /* 分辨率切换等产生的新参数集推迟到第一个使用它的关键帧：之前的非关键帧仍属于旧序列，照常发送；
+       序列头、onMetaData 与该关键帧在同一次加锁内连续发出，播放端无缝切换 */
+    if (next_complete && changed &&
+        (!conn.sent_video_config || (isKeyFrame && annexb_has_slice(data, size, conn.video_codec)))) {
+        apply_parameter_sets(conn);
     }
-    
-    // 发送 AVC sequence header（包含 SPS/PPS）
-    if (!conn.sent_video_config && !conn.sps.empty() && !conn.pps.empty()) {
-        LOGD("发送 AVC sequence header");
+
+    // 发送视频序列头（包含参数集）
+    bool have_parameter_sets = !conn.sps.empty() && !conn.pps.empty() &&
+                               (conn.video_codec != RTMP_VIDEO_CODEC_HEVC || !conn.vps.empty());
+    if (!conn.sent_video_config && have_parameter_sets) {
         /* 高到低切换时使用传入的 timestamp，与关键帧时间对齐，拉流端才能正确恢复 */
-        bool config_ok = send_avc_sequence_header(conn, (uint32_t) timestamp);
-        if (config_ok) {
-            LOGD("AVC sequence header 发送成功");
-        } else {
-            LOGE("AVC sequence header 发送失败");
-            return -1;
+        if (!send_video_sequence_header(conn, (uint32_t) timestamp)) {
+            return conn.send_blocked ? RTMP_SEND_WOULD_BLOCK : -1;
         }
     }
 
     // 发送 onMetaData（如果还没有发送且已有视频配置信息）
-    if (!conn.sent_metadata && conn.width > 0 && conn.height > 0 && conn.sent_video_config) {
-        LOGD("发送 onMetaData: %dx%d (宽x高)", conn.width, conn.height);
+    if (!conn.sent_metadata && metadata_width(conn) > 0 && metadata_height(conn) > 0 && conn.sent_video_config) {
         send_on_metadata(conn);
     }
 
     // 发送视频帧
     bool ok = send_video_frame(conn, data, size, (uint32_t) timestamp, isKeyFrame != 0);
-    if (!ok) {
+    if (!ok && !conn.send_blocked) {
         LOGE("发送视频帧失败: timestamp=%u, isKey=%d, size=%d", (uint32_t)timestamp, isKeyFrame, size);
     }
+    poll_keyframe_request(conn, keyframe_req);
+    if (conn.send_blocked) return RTMP_SEND_WOULD_BLOCK;
     return ok ? 0 : -1;
 }
 
-int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long timestamp) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    auto it = g_connections.find(handle);
-    if (it == g_connections.end() || !it->second.connected) {
-        LOGE("无效的句柄: %ld", handle);
-        return -1;
-    }
-    Connection &conn = it->second;
-    if (data == nullptr || size <= 0) {
-        LOGE("无效的音频数据");
-        return -1;
+static int send_video_entry(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame,
+                            int64_t entry_us) {
+    KeyFrameRequest keyframe_req;
+    int result;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        FRAME_TRACE(FRAME_TRACE_LOCK_ACQUIRED, FRAME_TRACE_VIDEO, timestamp, size);
+        auto it = g_connections.find(handle);
+        if (it != g_connections.end() && it->second.stats) {
+            it->second.enqueue_us = entry_us;
+            it->second.stats->on_video_entry(entry_us);
+        }
+        result = send_video_locked(handle, data, size, timestamp, isKeyFrame, keyframe_req);
     }
+    fire_keyframe_request(handle, keyframe_req);
+    return result;
+}
 
-    if (!conn.sent_audio_config) {
-        send_aac_sequence_header(conn);
-    }
+int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame) {
+    return send_video_entry(handle, data, size, timestamp, isKeyFrame, send_stats_now_us());
+}
+
+static int send_audio_locked(Connection &conn, unsigned char *data, int size, long timestamp, int64_t entry_us) {
+    poll_server_messages(conn);
+    if (!conn.connected) return -1;
+    conn.enqueue_us = entry_us;
+    conn.last_audio_timestamp = timestamp;
+    conn.send_blocked = false;
+
+    if (!conn.sent_audio_config) {
+        send_audio_sequence_header(conn);
+    }
     
     // 如果没有发送元数据（例如在视频开启前就开始推音频），在这里尝试发送
-    if (!conn.sent_metadata && conn.width > 0 && conn.height > 0) {
+    if (!conn.sent_metadata && metadata_width(conn) > 0 && metadata_height(conn) > 0) {
         send_on_metadata(conn);
     }
-    bool ok = send_aac_frame(conn, data, size, (uint32_t) timestamp);
+    bool ok = send_audio_frame(conn, data, size, (uint32_t) timestamp);
+    if (conn.send_blocked) return RTMP_SEND_WOULD_BLOCK;
     return ok ? 0 : -1;
 }
 
+int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long timestamp) {
+    int64_t entry_us = send_stats_now_us();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    FRAME_TRACE(FRAME_TRACE_LOCK_ACQUIRED, FRAME_TRACE_AUDIO, timestamp, size);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (data == nullptr || size <= 0) {
+        LOGE("无效的音频数据");
+        return -1;
+    }
+    conn.last_audio_input_us = entry_us;
+    return send_audio_locked(conn, data, size, timestamp, entry_us);
+}
+
 int rtmp_set_metadata(rtmp_handle_t handle, int width, int height, int video_bitrate, int fps, int audio_sample_rate, int audio_channels) {
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_connections.find(handle);
@@ -645,25 +1166,802 @@ int rtmp_set_metadata(rtmp_handle_t handle, int width, int height, int video_bit
     }
     Connection &conn = it->second;
     int old_w = conn.width, old_h = conn.height;
+    bool changed = old_w != width || old_h != height || conn.video_bitrate != video_bitrate || conn.fps != fps ||
+                   conn.sample_rate != audio_sample_rate || conn.channels != audio_channels;
     conn.width = width;
     conn.height = height;
     conn.video_bitrate = video_bitrate;
     conn.fps = fps;
     conn.sample_rate = audio_sample_rate;
     conn.channels = audio_channels;
-    /* 分辨率变化时需再次发送 AVC 序列头 + onMetaData，否则服务端仍显示旧分辨率且无视频 */
-    if (old_w != width || old_h != height) {
+    /* 视频序列头随参数集内容变化自动重发；H.264 的宽高以 SPS 为准，这里只在尚未解析到 SPS 时（或 HEVC）重发 onMetaData */
+    if ((old_w != width || old_h != height) && conn.sps_width == 0) {
         conn.sent_metadata = false;
-        conn.sent_video_config = false;  /* 下一帧带 SPS/PPS 时会重发 AVC sequence header */
     }
-    LOGD("设置元数据: %dx%d (宽x高), bitrate=%d, fps=%d, audio=%dHz/%dch", 
-         width, height, video_bitrate, fps, audio_sample_rate, audio_channels);
-    LOGD("元数据方向: %s (宽%s高)", 
-         width < height ? "竖屏" : (width > height ? "横屏" : "正方形"),
-         width < height ? "<" : (width > height ? ">" : "=="));
+    if (changed) {
+        LOGD("设置元数据: %dx%d (%s), bitrate=%d, fps=%d, audio=%dHz/%dch", width, height,
+             width < height ? "竖屏" : (width > height ? "横屏" : "正方形"),
+             video_bitrate, fps, audio_sample_rate, audio_channels);
+    }
+    return 0;
+}
+
+int rtmp_set_video_codec(rtmp_handle_t handle, int codec) {
+    if (codec != RTMP_VIDEO_CODEC_H264 && codec != RTMP_VIDEO_CODEC_HEVC) {
+        LOGE("不支持的视频编码: %d", codec);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (conn.video_codec == codec) return 0;
+    /* 旧编码的参数集不能用于新编码：清空后等待新编码器输出参数集，重发序列头与 onMetaData（videocodecid 变化） */
+    conn.video_codec = codec;
+    conn.vps.clear();
+    conn.sps.clear();
+    conn.pps.clear();
+    conn.next_vps.clear();
+    conn.next_sps.clear();
+    conn.next_pps.clear();
+    conn.sps_width = 0;
+    conn.sps_height = 0;
+    conn.sps_fps = 0;
+    conn.sent_video_config = false;
+    conn.sent_metadata = false;
+    cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
+    LOGD("设置视频编码: %s", codec == RTMP_VIDEO_CODEC_HEVC ? "HEVC" : "H.264");
+    return 0;
+}
+
+int rtmp_set_audio_codec(rtmp_handle_t handle, int codec, int bitrate) {
+    if (codec != RTMP_AUDIO_CODEC_AAC && codec != RTMP_AUDIO_CODEC_OPUS) {
+        LOGE("不支持的音频编码: %d", codec);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (bitrate <= 0) bitrate = codec == RTMP_AUDIO_CODEC_OPUS ? 32000 : 64000;
+    if (conn.audio_codec == codec && conn.audio_bitrate == bitrate) return 0;
+    if (conn.audio_codec != codec) conn.sent_audio_config = false;
+    conn.audio_codec = codec;
+    conn.audio_bitrate = bitrate;
+    conn.sent_metadata = false;  // audiocodecid/audiodatarate 变化
+    LOGD("设置音频编码: %s, bitrate=%d", codec == RTMP_AUDIO_CODEC_OPUS ? "Opus" : "AAC", bitrate);
     return 0;
 }
 
+int rtmp_set_buffer_release_callback(rtmp_handle_t handle, rtmp_buffer_release_cb cb, void *user_data, int max_queued) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) {
+            LOGE("无效的句柄: %ld", handle);
+            return -1;
+        }
+    }
+    std::shared_ptr<AsyncVideoSender> sender;
+    if (cb != nullptr) {
+        sender = std::make_shared<AsyncVideoSender>(
+                max_queued > 0 ? (size_t) max_queued : 3,
+                [handle](const AsyncVideoSender::Job &job) {
+                    return send_video_entry(handle, const_cast<unsigned char *>(job.data), job.size, job.timestamp,
+                                            job.is_key, job.enqueue_us);
+                },
+                [handle, cb, user_data](long token, int result) { cb(handle, token, result, user_data); });
+        sender->start();
+    }
+    std::shared_ptr<AsyncVideoSender> old;
+    {
+        std::lock_guard<std::mutex> lock(g_async_mutex);
+        auto it = g_async_senders.find(handle);
+        if (it != g_async_senders.end()) {
+            old = it->second;
+            g_async_senders.erase(it);
+        }
+        if (sender) g_async_senders[handle] = sender;
+    }
+    if (old) old->stop();
+    return 0;
+}
+
+// 统计在 g_mutex 下更新，与发送路径保持单写者
+static void count_dropped_video(rtmp_handle_t handle, int frames) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.stats) return;
+    for (int i = 0; i < frames; ++i) it->second.stats->on_video_dropped();
+}
+
+int rtmp_send_video_async(rtmp_handle_t handle, const unsigned char *data, int size, long timestamp, int isKeyFrame,
+                          long token) {
+    int64_t entry_us = send_stats_now_us();
+    if (data == nullptr || size <= 0) {
+        LOGE("无效的视频数据: size=%d", size);
+        return -1;
+    }
+    std::shared_ptr<AsyncVideoSender> sender;
+    {
+        std::lock_guard<std::mutex> lock(g_async_mutex);
+        auto it = g_async_senders.find(handle);
+        if (it != g_async_senders.end()) sender = it->second;
+    }
+    if (!sender) {
+        LOGE("未注册缓冲区释放回调: handle=%ld", handle);
+        return -1;
+    }
+
+    AsyncVideoSender::Job job = {data, size, timestamp, isKeyFrame != 0, token, entry_us};
+    int evicted = 0;
+    switch (sender->submit(job, &evicted)) {
+        case AsyncVideoSender::SUBMIT_QUEUED:
+            if (evicted > 0) count_dropped_video(handle, evicted);
+            return 0;
+        case AsyncVideoSender::SUBMIT_QUEUE_FULL:
+            // 丢弃非关键帧切断了参考链：native 丢弃后续非关键帧并请求关键帧
+            count_dropped_video(handle, 1);
+            rtmp_notify_video_dropped(handle);
+            return RTMP_ASYNC_QUEUE_FULL;
+        default:
+            return -1;
+    }
+}
+
+int rtmp_set_keyframe_request_callback(rtmp_handle_t handle, rtmp_keyframe_request_cb cb, void *user_data, int min_interval_ms) {
+    KeyFrameRequest keyframe_req;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) {
+            LOGE("无效的句柄: %ld", handle);
+            return -1;
+        }
+        Connection &conn = it->second;
+        conn.keyframe_cb = cb;
+        conn.keyframe_cb_user_data = user_data;
+        conn.keyframe_min_interval_ms = min_interval_ms > 0 ? min_interval_ms : 1000;
+        /* 新连接（重连/新推流目标）尚未发过关键帧，立即请求，不必等编码器自然 IDR */
+        poll_keyframe_request(conn, keyframe_req);
+    }
+    fire_keyframe_request(handle, keyframe_req);
+    return 0;
+}
+
+int rtmp_notify_video_dropped(rtmp_handle_t handle) {
+    KeyFrameRequest keyframe_req;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) {
+            LOGE("无效的句柄: %ld", handle);
+            return -1;
+        }
+        Connection &conn = it->second;
+        cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
+        poll_keyframe_request(conn, keyframe_req);
+    }
+    fire_keyframe_request(handle, keyframe_req);
+    return 0;
+}
+
+/* 心跳视频节拍：到期时重发关键帧并以其为参考重新编号，其余节拍发送 P_Skip 帧 */
+static void heartbeat_video_tick(rtmp_handle_t handle, Heartbeat &hb, int64_t elapsed_us) {
+    long timestamp = hb.base_timestamp + (long) (elapsed_us / 1000);
+    bool key = hb.last_keyframe_us < 0 ||
+               (hb.keyframe_interval_us > 0 && elapsed_us - hb.last_keyframe_us >= hb.keyframe_interval_us);
+    if (key) {
+        hb.last_keyframe_us = elapsed_us;
+        hb.skip.reset(hb.sps, hb.pps, hb.keyframe.data(), (int) hb.keyframe.size());
+        if (send_video_entry(handle, hb.keyframe.data(), (int) hb.keyframe.size(), timestamp, 1, send_stats_now_us()) ==
+            RTMP_SEND_WOULD_BLOCK) {
+            hb.last_keyframe_us = -1;  // 未发出：下一个节拍重发关键帧
+        }
+    } else if (hb.skip.next(hb.frame)) {
+        send_video_entry(handle, hb.frame.data(), (int) hb.frame.size(), timestamp, 0, send_stats_now_us());
+    }
+}
+
+/* 心跳音频节拍：只在已有音轨且调用方超过 3 帧时长没有输入时补发静音帧 */
+static void heartbeat_audio_tick(rtmp_handle_t handle, Heartbeat &hb, int64_t elapsed_us) {
+    long timestamp = hb.base_timestamp + (long) (elapsed_us / 1000);
+    int64_t entry_us = send_stats_now_us();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) return;
+    Connection &conn = it->second;
+    int64_t frame_us = audio_frame_duration_us(conn.audio_codec, conn.sample_rate);
+    if (!conn.sent_audio_config || timestamp <= conn.last_audio_timestamp ||
+        entry_us - conn.last_audio_input_us < 3 * frame_us) {
+        return;
+    }
+    uint8_t silence[16];
+    int size = build_silent_audio_frame(conn.audio_codec, conn.channels, silence, sizeof(silence));
+    if (size > 0) send_audio_locked(conn, silence, size, timestamp, entry_us);
+}
+
+static std::shared_ptr<Heartbeat> take_heartbeat(rtmp_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_heartbeat_mutex);
+    auto it = g_heartbeats.find(handle);
+    if (it == g_heartbeats.end()) return nullptr;
+    std::shared_ptr<Heartbeat> hb = it->second;
+    g_heartbeats.erase(it);
+    return hb;
+}
+
+int rtmp_heartbeat_start(rtmp_handle_t handle, const unsigned char *keyframe, int size, long timestamp, int fps,
+                         int keyframe_interval_ms) {
+    if (keyframe == nullptr || size <= 0) {
+        LOGE("无效的心跳关键帧: size=%d", size);
+        return -1;
+    }
+    std::shared_ptr<Heartbeat> hb = std::make_shared<Heartbeat>();
+    hb->keyframe.assign(keyframe, keyframe + size);
+    hb->base_timestamp = timestamp;
+    hb->keyframe_interval_us = keyframe_interval_ms > 0 ? (int64_t) keyframe_interval_ms * 1000 : 0;
+    int64_t audio_interval_us;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) {
+            LOGE("无效的句柄: %ld", handle);
+            return -1;
+        }
+        Connection &conn = it->second;
+        if (conn.video_codec != RTMP_VIDEO_CODEC_H264) {
+            LOGE("心跳 P_Skip 帧仅支持 H.264");
+            return -1;
+        }
+        hb->sps = conn.sps;
+        hb->pps = conn.pps;
+        // 关键帧自带的参数集优先（与缓存的参数集一致时结果相同）
+        std::vector<uint8_t> unused_vps;
+        parse_parameter_sets(keyframe, size, conn.video_codec, unused_vps, hb->sps, hb->pps);
+        audio_interval_us = audio_frame_duration_us(conn.audio_codec, conn.sample_rate);
+    }
+    if (!hb->skip.reset(hb->sps, hb->pps, keyframe, size)) {
+        return -1;
+    }
+
+    Heartbeat *raw = hb.get();
+    if (fps <= 0) fps = 5;
+    hb->timer.reset(new HeartbeatTimer(
+            1000000 / fps, audio_interval_us,
+            [handle, raw](int64_t elapsed_us) { heartbeat_video_tick(handle, *raw, elapsed_us); },
+            [handle, raw](int64_t elapsed_us) { heartbeat_audio_tick(handle, *raw, elapsed_us); }));
+    std::shared_ptr<Heartbeat> old;
+    {
+        std::lock_guard<std::mutex> lock(g_heartbeat_mutex);
+        auto it = g_heartbeats.find(handle);
+        if (it != g_heartbeats.end()) old = it->second;
+        g_heartbeats[handle] = hb;
+    }
+    if (old) old->timer->stop();
+    hb->timer->start();
+    LOGD("开始后台心跳: handle=%ld, fps=%d, keyframe_interval=%dms", handle, fps, keyframe_interval_ms);
+    return 0;
+}
+
+int rtmp_heartbeat_stop(rtmp_handle_t handle) {
+    std::shared_ptr<Heartbeat> hb = take_heartbeat(handle);
+    if (!hb) return -1;
+    hb->timer->stop();
+    LOGD("停止后台心跳: handle=%ld", handle);
+    // 编码器的后续非关键帧参考的是心跳之前的画面，合成帧之后无法解码
+    return rtmp_notify_video_dropped(handle);
+}
+
+int rtmp_start_recording(rtmp_handle_t handle, const char *path, long max_segment_bytes, int max_segment_duration_ms) {
+    if (path == nullptr || strlen(path) == 0) {
+        LOGE("录制路径为空");
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (conn.recorder != nullptr) {
+        LOGE("已在录制中: handle=%ld", handle);
+        return -1;
+    }
+    FlvRecorder *recorder = new FlvRecorder(path, max_segment_bytes, max_segment_duration_ms);
+    if (!recorder->start()) {
+        delete recorder;
+        return -1;
+    }
+    // 推流中途开始录制：先补写已发送过的 onMetaData 与序列头，视频从下一个关键帧开始
+    recorder->submit(conn.last_metadata);
+    recorder->submit(conn.last_video_config);
+    recorder->submit(conn.last_audio_config);
+    conn.recorder = recorder;
+    return 0;
+}
+
+int rtmp_stop_recording(rtmp_handle_t handle) {
+    FlvRecorder *recorder = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end()) {
+            LOGE("无效的句柄: %ld", handle);
+            return -1;
+        }
+        recorder = it->second.recorder;
+        it->second.recorder = nullptr;
+    }
+    if (recorder == nullptr) return -1;
+    // 在锁外等待 I/O 线程写完并回填文件头，不阻塞发送
+    recorder->stop();
+    bool failed = recorder->failed();
+    delete recorder;
+    if (failed) {
+        LOGE("录制写盘失败，录制文件可能不完整");
+        return -1;
+    }
+    return 0;
+}
+
+static std::shared_ptr<Spool> find_spool(rtmp_spool_t spool) {
+    std::lock_guard<std::mutex> lock(g_spool_mutex);
+    auto it = g_spools.find(spool);
+    if (it == g_spools.end()) {
+        LOGE("无效的缓存句柄: %ld", spool);
+        return nullptr;
+    }
+    return it->second;
+}
+
+rtmp_spool_t rtmp_spool_open(const char *path, long capacity_bytes) {
+    if (path == nullptr || strlen(path) == 0) {
+        LOGE("缓存路径为空");
+        return 0;
+    }
+    std::shared_ptr<Spool> spool = std::make_shared<Spool>(path, capacity_bytes);
+    if (!spool->file.open()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_spool_mutex);
+    long id = g_next_spool++;
+    g_spools[id] = spool;
+    return id;
+}
+
+int rtmp_spool_begin(rtmp_spool_t spool) {
+    std::shared_ptr<Spool> s = find_spool(spool);
+    if (!s) return -1;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (!s->active) {
+        s->active = true;
+        LOGD("连接断开，开始缓存: spool=%ld", spool);
+    }
+    return 0;
+}
+
+static int spool_append(rtmp_spool_t spool, uint8_t type, bool keyframe, unsigned char *data, int size, long timestamp) {
+    if (data == nullptr || size <= 0) return -1;
+    std::shared_ptr<Spool> s = find_spool(spool);
+    if (!s) return -1;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (!s->active) return 1;
+    return s->file.append(type, keyframe, timestamp, data, (uint32_t) size) ? 0 : -1;
+}
+
+int rtmp_spool_video(rtmp_spool_t spool, unsigned char *data, int size, long timestamp, int isKeyFrame) {
+    return spool_append(spool, RTMP_PACKET_TYPE_VIDEO, isKeyFrame != 0, data, size, timestamp);
+}
+
+int rtmp_spool_audio(rtmp_spool_t spool, unsigned char *data, int size, long timestamp) {
+    return spool_append(spool, RTMP_PACKET_TYPE_AUDIO, false, data, size, timestamp);
+}
+
+int rtmp_spool_drain(rtmp_spool_t spool, rtmp_handle_t handle, int mode, int speed_percent) {
+    std::shared_ptr<Spool> s = find_spool(spool);
+    if (!s) return -1;
+
+    if (mode == RTMP_SPOOL_MODE_DISCARD) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        LOGD("丢弃积压数据: frames=%ld, bytes=%ld", s->file.backlog_records(), s->file.backlog_bytes());
+        s->file.clear();
+        s->active = false;
+        return 0;
+    }
+
+    int64_t start_ms = monotonic_ms();
+    int64_t first_ts = 0;
+    bool has_first = false;
+    long drained = 0;
+    FlvSpool::Record record;
+    std::vector<uint8_t> payload;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->file.empty()) {
+                // 在缓存锁内转为未激活，之后写入的帧返回 1 由调用方直接发送，保证顺序
+                s->active = false;
+                LOGD("积压数据补发完成: bytes=%ld, rate=%ld B/s", drained, s->drain_rate_bps);
+                return 0;
+            }
+            if (!s->file.read_front(record, payload)) {
+                LOGE("读取积压数据失败，丢弃剩余缓存");
+                s->file.clear();
+                s->active = false;
+                return -1;
+            }
+            // 记录在发送成功后才出队，发送失败时留在缓存中等下次补发
+        }
+
+        // 按媒体时间戳以 speed_percent 倍速节流，避免补发挤占直播带宽
+        if (!has_first) {
+            first_ts = record.timestamp;
+            has_first = true;
+        }
+        if (speed_percent > 0) {
+            int64_t due_ms = start_ms + (record.timestamp - first_ts) * 100 / speed_percent;
+            int64_t wait_ms = due_ms - monotonic_ms();
+            if (wait_ms > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+            }
+        }
+
+        // 限时发送下续写未完成时重试同一条记录（积压数据不能丢），累计等待超过 10 秒视为失败
+        int64_t blocked_ms = monotonic_ms();
+        int result;
+        do {
+            result = record.type == RTMP_PACKET_TYPE_VIDEO
+                     ? rtmp_send_video(handle, payload.data(), (int) payload.size(), (long) record.timestamp, record.keyframe)
+                     : rtmp_send_audio(handle, payload.data(), (int) payload.size(), (long) record.timestamp);
+        } while (result == RTMP_SEND_WOULD_BLOCK && monotonic_ms() - blocked_ms < 10000);
+        if (result != 0) {
+            LOGE("补发积压数据失败: type=%d, timestamp=%lld", record.type, (long long) record.timestamp);
+            return -1;
+        }
+
+        drained += (long) payload.size();
+        int64_t elapsed_ms = monotonic_ms() - start_ms;
+        std::lock_guard<std::mutex> lock(s->mutex);
+        // 发送期间新写入的帧可能已把这条记录淘汰，队首不再是它时无需出队
+        if (!s->file.empty() && s->file.front().offset == record.offset &&
+            s->file.front().timestamp == record.timestamp) {
+            s->file.pop_front();
+        }
+        s->drained_bytes += (long) payload.size();
+        s->drain_rate_bps = elapsed_ms > 0 ? (long) (drained * 1000 / elapsed_ms) : 0;
+    }
+}
+
+int rtmp_spool_get_stats(rtmp_spool_t spool, rtmp_spool_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<Spool> s = find_spool(spool);
+    if (!s) return -1;
+    std::lock_guard<std::mutex> lock(s->mutex);
+    stats->backlog_bytes = s->file.backlog_bytes();
+    stats->backlog_frames = s->file.backlog_records();
+    stats->evicted_frames = s->file.evicted_records();
+    stats->drain_rate_bps = s->drain_rate_bps;
+    stats->drained_bytes = s->drained_bytes;
+    return 0;
+}
+
+void rtmp_spool_close(rtmp_spool_t spool) {
+    std::lock_guard<std::mutex> lock(g_spool_mutex);
+    if (g_spools.erase(spool) > 0) {
+        LOGD("关闭断网缓存: spool=%ld", spool);
+    }
+}
+
+static std::shared_ptr<Ring> find_ring(rtmp_ring_t ring) {
+    std::lock_guard<std::mutex> lock(g_ring_mutex);
+    auto it = g_rings.find(ring);
+    if (it == g_rings.end()) {
+        LOGE("无效的帧环句柄: %ld", ring);
+        return nullptr;
+    }
+    return it->second;
+}
+
+// 每帧调用的快速路径：只读一次槽位，不加锁、不复制 shared_ptr
+static Ring *resolve_ring(rtmp_ring_t ring) {
+    Ring *r = ring > 0 ? g_ring_slots[ring % kRingSlots].load(std::memory_order_acquire) : nullptr;
+    if (r == nullptr || r->id != ring) {
+        LOGE("无效的帧环句柄: %ld", ring);
+        return nullptr;
+    }
+    return r;
+}
+
+rtmp_ring_t rtmp_ring_create(int media, long capacity_bytes, int max_frames) {
+    if ((media != RTMP_RING_VIDEO && media != RTMP_RING_AUDIO) || capacity_bytes <= 0) {
+        LOGE("无效的帧环参数: media=%d, capacity=%ld", media, capacity_bytes);
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_ring_mutex);
+    long slot = 0;
+    while (slot < kRingSlots && g_ring_slots[slot].load(std::memory_order_relaxed) != nullptr) ++slot;
+    if (slot == kRingSlots) {
+        LOGE("帧环数量超过上限: %ld", kRingSlots);
+        return 0;
+    }
+    long id = g_next_ring++ * kRingSlots + slot;
+    std::shared_ptr<Ring> ring = std::make_shared<Ring>(id, media, (size_t) capacity_bytes, max_frames);
+    if (!ring->frames.valid()) {
+        return 0;
+    }
+    g_rings[id] = ring;
+    g_ring_slots[slot].store(ring.get(), std::memory_order_release);
+    return id;
+}
+
+uint8_t *rtmp_ring_data(rtmp_ring_t ring, long *capacity) {
+    std::shared_ptr<Ring> r = find_ring(ring);
+    if (!r) return nullptr;
+    if (capacity != nullptr) *capacity = (long) r->frames.capacity();
+    return r->frames.data();
+}
+
+long rtmp_ring_reserve(rtmp_ring_t ring, int size, int isKeyFrame) {
+    if (size <= 0) return -1;
+    Ring *r = resolve_ring(ring);
+    if (!r) return -1;
+    return r->frames.reserve((uint32_t) size, isKeyFrame != 0);
+}
+
+int rtmp_ring_commit(rtmp_ring_t ring, long timestamp) {
+    Ring *r = resolve_ring(ring);
+    if (!r) return -1;
+    return r->frames.commit(timestamp);
+}
+
+int rtmp_ring_flush(rtmp_ring_t ring) {
+    Ring *r = resolve_ring(ring);
+    if (!r) return -1;
+    r->frames.flush();
+    return 0;
+}
+
+int rtmp_ring_send(rtmp_ring_t ring, rtmp_handle_t handle, rtmp_spool_t spool, int timeout_ms) {
+    Ring *r = resolve_ring(ring);
+    if (!r) return -1;
+    FrameRing::Frame frame;
+    if (!r->frames.wait(timeout_ms) || !r->frames.peek(&frame)) return 0;
+
+    bool video = r->media == RTMP_RING_VIDEO;
+    unsigned char *data = const_cast<unsigned char *>(frame.data);
+    int flags = RTMP_RING_CONSUMED | (frame.is_key ? RTMP_RING_KEYFRAME : 0);
+    int result = 0;
+    // 断网期间写入磁盘缓存（缓存未处于缓存状态时返回非 0，改为直接发送）
+    int spooled = spool == 0 ? -1
+                  : video ? rtmp_spool_video(spool, data, (int) frame.size, (long) frame.timestamp, frame.is_key)
+                          : rtmp_spool_audio(spool, data, (int) frame.size, (long) frame.timestamp);
+    if (spooled == 0) {
+        flags |= RTMP_RING_SPOOLED;
+    } else if (handle != 0) {
+        result = video ? rtmp_send_video(handle, data, (int) frame.size, (long) frame.timestamp, frame.is_key)
+                       : rtmp_send_audio(handle, data, (int) frame.size, (long) frame.timestamp);
+    }
+    r->frames.pop();
+    return result != 0 ? result : flags;
+}
+
+void rtmp_ring_wakeup(rtmp_ring_t ring) {
+    std::shared_ptr<Ring> r = find_ring(ring);
+    if (r) r->frames.wakeup();
+}
+
+int rtmp_ring_get_stats(rtmp_ring_t ring, rtmp_ring_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<Ring> r = find_ring(ring);
+    if (!r) return -1;
+    r->frames.snapshot(stats);
+    return 0;
+}
+
+void rtmp_ring_destroy(rtmp_ring_t ring) {
+    std::lock_guard<std::mutex> lock(g_ring_mutex);
+    auto it = g_rings.find(ring);
+    if (it != g_rings.end()) {
+        g_ring_slots[ring % kRingSlots].store(nullptr, std::memory_order_release);
+        g_rings.erase(it);
+        LOGD("销毁帧环: ring=%ld", ring);
+    }
+}
+
+static std::shared_ptr<AvClock> find_clock(rtmp_clock_t clock) {
+    std::lock_guard<std::mutex> lock(g_clock_mutex);
+    auto it = g_clocks.find(clock);
+    if (it == g_clocks.end()) {
+        LOGE("无效的时钟句柄: %ld", clock);
+        return nullptr;
+    }
+    return it->second;
+}
+
+rtmp_clock_t rtmp_clock_create(int sample_rate) {
+    if (sample_rate <= 0) {
+        LOGE("无效的采样率: %d", sample_rate);
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_clock_mutex);
+    long id = g_next_clock++;
+    g_clocks[id] = std::make_shared<AvClock>(sample_rate);
+    return id;
+}
+
+long rtmp_clock_audio(rtmp_clock_t clock, long capture_us, int samples) {
+    std::shared_ptr<AvClock> c = find_clock(clock);
+    if (!c) return -1;
+    return (long) c->audio(capture_us, samples);
+}
+
+long rtmp_clock_video(rtmp_clock_t clock, long capture_us) {
+    std::shared_ptr<AvClock> c = find_clock(clock);
+    if (!c) return -1;
+    return (long) c->video(capture_us);
+}
+
+int rtmp_clock_get_stats(rtmp_clock_t clock, rtmp_clock_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<AvClock> c = find_clock(clock);
+    if (!c) return -1;
+    c->snapshot(stats);
+    return 0;
+}
+
+void rtmp_clock_destroy(rtmp_clock_t clock) {
+    std::lock_guard<std::mutex> lock(g_clock_mutex);
+    if (g_clocks.erase(clock) > 0) {
+        LOGD("销毁音视频时钟: clock=%ld", clock);
+    }
+}
+
+rtmp_engine_t rtmp_engine_create(const rtmp_engine_config *config) {
+    std::shared_ptr<PublishEngine> engine = std::make_shared<PublishEngine>(config);
+    if (!engine->start()) {
+        LOGE("创建推流引擎失败");
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    long id = g_next_engine++;
+    g_engines[id] = engine;
+    return id;
+}
+
+rtmp_session_t rtmp_engine_open(rtmp_engine_t engine, const char *url) {
+    std::shared_ptr<PublishEngine> e;
+    {
+        std::lock_guard<std::mutex> lock(g_engine_mutex);
+        auto it = g_engines.find(engine);
+        if (it == g_engines.end()) {
+            LOGE("无效的引擎句柄: %ld", engine);
+            return 0;
+        }
+        e = it->second;
+    }
+    // 解析主机名可能阻塞，不持有全局锁
+    std::shared_ptr<EngineSession> session = e->open(url);
+    if (!session) return 0;
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    if (g_engines.count(engine) == 0) {
+        LOGE("打开会话期间引擎已销毁: %ld", engine);
+        return 0;
+    }
+    long id = g_next_engine_session++;
+    g_engine_sessions[id] = EngineSessionEntry{engine, e, session};
+    return id;
+}
+
+static std::shared_ptr<EngineSession> find_engine_session(rtmp_session_t session) {
+    std::lock_guard<std::mutex> lock(g_engine_mutex);
+    auto it = g_engine_sessions.find(session);
+    if (it == g_engine_sessions.end()) {
+        LOGE("无效的推流会话句柄: %ld", session);
+        return nullptr;
+    }
+    return it->second.session;
+}
+
+int rtmp_engine_set_metadata(rtmp_session_t session, int width, int height, int video_bitrate, int fps,
+                             int audio_sample_rate, int audio_channels) {
+    std::shared_ptr<EngineSession> s = find_engine_session(session);
+    if (!s) return -1;
+    s->set_metadata(width, height, video_bitrate, fps, audio_sample_rate, audio_channels);
+    return 0;
+}
+
+int rtmp_engine_send_video(rtmp_session_t session, const unsigned char *data, int size, long timestamp, int is_key_frame) {
+    std::shared_ptr<EngineSession> s = find_engine_session(session);
+    if (!s) return -1;
+    return s->send_video(data, size, (uint32_t) timestamp, is_key_frame != 0);
+}
+
+int rtmp_engine_send_audio(rtmp_session_t session, const unsigned char *data, int size, long timestamp) {
+    std::shared_ptr<EngineSession> s = find_engine_session(session);
+    if (!s) return -1;
+    return s->send_audio(data, size, (uint32_t) timestamp);
+}
+
+int rtmp_engine_get_session_stats(rtmp_session_t session, rtmp_engine_session_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<EngineSession> s = find_engine_session(session);
+    if (!s) return -1;
+    s->snapshot(stats);
+    return 0;
+}
+
+int rtmp_engine_get_stats(rtmp_engine_t engine, rtmp_engine_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<PublishEngine> e;
+    {
+        std::lock_guard<std::mutex> lock(g_engine_mutex);
+        auto it = g_engines.find(engine);
+        if (it == g_engines.end()) {
+            LOGE("无效的引擎句柄: %ld", engine);
+            return -1;
+        }
+        e = it->second;
+    }
+    e->snapshot(stats);
+    return 0;
+}
+
+void rtmp_engine_close(rtmp_session_t session, int timeout_ms) {
+    EngineSessionEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(g_engine_mutex);
+        auto it = g_engine_sessions.find(session);
+        if (it == g_engine_sessions.end()) return;
+        entry = it->second;
+        g_engine_sessions.erase(it);
+    }
+    entry.owner->close(entry.session, timeout_ms);
+    LOGD("关闭推流会话: session=%ld", session);
+}
+
+void rtmp_engine_destroy(rtmp_engine_t engine) {
+    std::shared_ptr<PublishEngine> e;
+    {
+        std::lock_guard<std::mutex> lock(g_engine_mutex);
+        auto it = g_engines.find(engine);
+        if (it == g_engines.end()) return;
+        e = it->second;
+        g_engines.erase(it);
+        for (auto s = g_engine_sessions.begin(); s != g_engine_sessions.end();) {
+            if (s->second.engine == engine) {
+                s = g_engine_sessions.erase(s);
+            } else {
+                ++s;
+            }
+        }
+    }
+    // 其他线程仍持有引用时由最后一个引用者析构（关闭全部会话、停止线程）
+    e.reset();
+    LOGD("销毁推流引擎: engine=%ld", engine);
+}
+
 int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats) {
     std::lock_guard<std::mutex> lock(g_mutex);
     if (stats == nullptr) {
@@ -681,7 +1979,434 @@ int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats) {
     return 0;
 }
 
+int rtmp_get_stats_v2(rtmp_handle_t handle, rtmp_stats_v2 *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<SendStats> send_stats;
+    {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        auto it = g_stats.find(handle);
+        if (it != g_stats.end()) send_stats = it->second;
+    }
+    if (!send_stats) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    if (send_stats->snapshot(stats) != 0) {
+        LOGE("统计信息结构大小无效: %u", stats->struct_size);
+        return -1;
+    }
+    return 0;
+}
+
+int rtmp_tls_configure(const char *ca_file, int flags) {
+    if (!tls_available()) {
+        LOGE("未以 BB_RTMP_TLS 编译，不支持 RTMPS");
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_tls_mutex);
+    g_tls_config.ca_file = ca_file != nullptr ? ca_file : "";
+    g_tls_config.verify = (flags & RTMP_TLS_NO_VERIFY) == 0;
+    g_tls_config.allow_ktls = (flags & RTMP_TLS_NO_KTLS) == 0;
+    g_tls_config.full_offload = (flags & RTMP_TLS_FULL_OFFLOAD) != 0;
+    return 0;
+}
+
+int rtmp_get_tls_info(rtmp_handle_t handle, rtmp_tls_info *info) {
+    if (info == nullptr) {
+        LOGE("TLS 信息指针为空");
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end()) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    memset(info, 0, sizeof(*info));
+    const TlsSession *tls = it->second.tls;
+    if (tls == nullptr) return 0;
+    info->mode = tls->mode();
+    info->ktls_send = tls->ktls_send() ? 1 : 0;
+    info->ktls_recv = tls->ktls_recv() ? 1 : 0;
+    snprintf(info->version, sizeof(info->version), "%s", tls->version());
+    snprintf(info->cipher, sizeof(info->cipher), "%s", tls->cipher());
+    info->relay_bytes_out = tls->relay_bytes_out();
+    info->relay_bytes_in = tls->relay_bytes_in();
+    return 0;
+}
+
+int rtmp_set_fast_open(int enable) {
+    if (enable && !fast_open_supported()) {
+        LOGE("系统不支持 TCP_FASTOPEN_CONNECT");
+        return -1;
+    }
+    g_fast_open = enable != 0;
+    return 0;
+}
+
+int rtmp_get_connect_timing(rtmp_handle_t handle, rtmp_connect_timing *timing) {
+    if (timing == nullptr) {
+        LOGE("连接耗时指针为空");
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end()) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    *timing = it->second.connect_timing;
+    return 0;
+}
+
+int rtmp_set_transport(rtmp_handle_t handle, int transport) {
+    if (transport != RTMP_TRANSPORT_SOCKET && transport != RTMP_TRANSPORT_URING) {
+        LOGE("无效的发送后端: %d", transport);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (transport == RTMP_TRANSPORT_SOCKET) {
+        // 释放前等待队列写完，之后的消息经 librtmp 发送
+        conn.uring.reset();
+        return 0;
+    }
+    if (conn.uring) return 0;
+    if (conn.partial) {
+        LOGE("限时发送已开启，不能切换为 io_uring 发送后端");
+        return -1;
+    }
+    if (conn.rtmp->Link.protocol & RTMP_FEATURE_HTTP) {
+        LOGE("RTMPT 连接不支持 io_uring 发送后端");
+        return -1;
+    }
+    conn.uring = uring_writer_create(RTMP_Socket(conn.rtmp), conn.stats);
+    if (!conn.uring) {
+        LOGE("io_uring 不可用（未以 BB_RTMP_URING 编译或内核不支持），保持 socket 发送");
+        return -1;
+    }
+    LOGD("发送后端切换为 io_uring: handle=%ld", handle);
+    return 0;
+}
+
+int rtmp_get_uring_stats(rtmp_uring_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    uring_engine_stats(stats);
+    return 0;
+}
+
+// 向服务端发送 Set Chunk Size（控制消息，chunk stream 2）并更新 librtmp 的输出 chunk size
+static bool send_chunk_size(Connection &conn, int chunk_size) {
+    if (conn.uring && !conn.uring->drain()) return false;
+    RTMPPacket packet;
+    RTMPPacket_Alloc(&packet, 4);
+    RTMPPacket_Reset(&packet);
+    AMF_EncodeInt32(packet.m_body, packet.m_body + 4, (unsigned int) chunk_size);
+    packet.m_nBodySize = 4;
+    packet.m_packetType = RTMP_PACKET_TYPE_CHUNK_SIZE;
+    packet.m_nChannel = 0x02;
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_nTimeStamp = 0;
+    int ret = RTMP_SendPacket(conn.rtmp, &packet, 0);
+    RTMPPacket_Free(&packet);
+    if (!ret) return false;
+    conn.rtmp->m_outChunkSize = chunk_size;
+    LOGD("输出 chunk size 设置为 %d", chunk_size);
+    return true;
+}
+
+int rtmp_set_zerocopy(rtmp_handle_t handle, int threshold_bytes, int chunk_size) {
+    if (chunk_size > 0 && (chunk_size < RTMP_DEFAULT_CHUNKSIZE || chunk_size > 0xffffff)) {
+        LOGE("无效的 chunk size: %d", chunk_size);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    // 先等待在途消息完成，再按新阈值重建
+    conn.zerocopy.reset();
+    if (threshold_bytes <= 0) return 0;
+    if (conn.partial) {
+        LOGE("限时发送已开启，不能同时开启 MSG_ZEROCOPY");
+        return -1;
+    }
+    if (conn.tls != nullptr || (conn.rtmp->Link.protocol & RTMP_FEATURE_HTTP)) {
+        LOGE("RTMPS/RTMPT 连接不支持 MSG_ZEROCOPY");
+        return -1;
+    }
+    std::shared_ptr<ZeroCopySender> sender = zerocopy_sender_create(RTMP_Socket(conn.rtmp),
+                                                                    (uint32_t) threshold_bytes, conn.stats);
+    if (!sender) {
+        LOGE("MSG_ZEROCOPY 不可用（需 Linux 4.14+ 的 TCP 连接），保持拷贝发送");
+        return -1;
+    }
+    if (chunk_size > 0 && chunk_size != conn.rtmp->m_outChunkSize && !send_chunk_size(conn, chunk_size)) {
+        LOGE("发送 Set Chunk Size 失败");
+        return -1;
+    }
+    conn.zerocopy = sender;
+    LOGD("开启 MSG_ZEROCOPY: handle=%ld, threshold=%d, chunk_size=%d", handle, threshold_bytes,
+         conn.rtmp->m_outChunkSize);
+    return 0;
+}
+
+int rtmp_set_send_deadline(rtmp_handle_t handle, int deadline_ms) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (deadline_ms <= 0) {
+        if (!conn.partial) return 0;
+        // 之后的消息经 librtmp 阻塞发送：先把半条消息写完
+        int syscalls = 0;
+        if (conn.partial->flush(send_stats_now_us() + 10000000, &syscalls) != PARTIAL_WRITE_DONE) {
+            LOGE("续写未完成，保持限时发送: pending=%zu", conn.partial->pending_bytes());
+            return -1;
+        }
+        conn.partial.reset();
+        LOGD("关闭限时发送: handle=%ld", handle);
+        return 0;
+    }
+    if (conn.rtmp->Link.protocol & RTMP_FEATURE_HTTP) {
+        LOGE("RTMPT 连接不支持限时发送");
+        return -1;
+    }
+    if (conn.uring || conn.zerocopy) {
+        LOGE("限时发送与 io_uring 发送后端、MSG_ZEROCOPY 互斥");
+        return -1;
+    }
+    // 用户态 TLS 下写入的是 socketpair，由中继线程写出到网络；socketpair 写满即反映上行停滞
+    if (!conn.partial) conn.partial = std::make_shared<PartialWriter>(RTMP_Socket(conn.rtmp));
+    conn.send_timeout_us = (int64_t) deadline_ms * 1000;
+    LOGD("开启限时发送: handle=%ld, deadline=%dms", handle, deadline_ms);
+    return 0;
+}
+
+int rtmp_flush(rtmp_handle_t handle, int timeout_ms) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (conn.rtmpt) return conn.rtmpt->flush((int64_t) std::max(timeout_ms, 0) * 1000);
+    if (!conn.partial) return 0;
+    int syscalls = 0;
+    size_t pending = conn.partial->pending_bytes();
+    PartialWriteResult result = conn.partial->flush(send_stats_now_us() + (int64_t) std::max(timeout_ms, 0) * 1000,
+                                                    &syscalls);
+    if (conn.stats && pending > 0) conn.stats->on_resumed(pending - conn.partial->pending_bytes());
+    if (result == PARTIAL_WRITE_PENDING) return RTMP_SEND_WOULD_BLOCK;
+    return result == PARTIAL_WRITE_DONE ? 0 : -1;
+}
+
+int rtmp_set_rtmpt_batch(rtmp_handle_t handle, int window_ms) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.connected) {
+        LOGE("无效的句柄: %ld", handle);
+        return -1;
+    }
+    Connection &conn = it->second;
+    if (conn.rtmpt) {
+        // 窗口不同时先交还再以新窗口接管：待发数据写完、在途应答到齐后序号与头压缩状态才一致
+        bool clean = conn.rtmpt->detach(conn.rtmp, 10000000);
+        conn.rtmpt.reset();
+        if (!clean) {
+            // 服务端未确认全部请求，librtmp 的序号与隧道不再一致：之后的发送直接失败，由调用方重连
+            LOGE("交还 RTMPT 隧道未完成，连接不再可用");
+            conn.connected = false;
+            return -1;
+        }
+        LOGD("关闭批量 RTMPT: handle=%ld", handle);
+    }
+    if (window_ms < 0) return 0;
+    if (!(conn.rtmp->Link.protocol & RTMP_FEATURE_HTTP)) {
+        LOGE("批量 RTMPT 只支持 rtmpt:// 连接");
+        return -1;
+    }
+    if (conn.uring || conn.zerocopy || conn.partial) {
+        LOGE("批量 RTMPT 与 io_uring 发送后端、MSG_ZEROCOPY、限时发送互斥");
+        return -1;
+    }
+    conn.rtmpt = RtmptTransport::attach(conn.rtmp, (int64_t) window_ms * 1000);
+    if (!conn.rtmpt) {
+        LOGE("无法接管 RTMPT 隧道（RTMPE 加密或隧道未建立）");
+        return -1;
+    }
+    LOGD("开启批量 RTMPT: handle=%ld, window=%dms", handle, window_ms);
+    return 0;
+}
+
+int rtmp_get_rtmpt_stats(rtmp_handle_t handle, rtmp_rtmpt_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_connections.find(handle);
+    if (it == g_connections.end() || !it->second.rtmpt) return -1;
+    it->second.rtmpt->snapshot(stats);
+    return 0;
+}
+
+// player 随 PlayConnection 一起释放：rtmp_get_play_stats 可能仍持有该连接
+static void free_play_connection(PlayConnection &play) {
+    if (play.rtmp) {
+        RTMP_Close(play.rtmp);
+        RTMP_Free(play.rtmp);
+        play.rtmp = nullptr;
+    }
+    delete play.tls;
+    play.tls = nullptr;
+    free(play.url_copy);
+    play.url_copy = nullptr;
+}
+
+rtmp_play_t rtmp_play_open(const char *url, int buffer_ms) {
+    if (url == nullptr || strlen(url) == 0) {
+        LOGE("RTMP URL 为空");
+        return 0;
+    }
+    bb_log_install_librtmp();
+    std::shared_ptr<PlayConnection> play = std::make_shared<PlayConnection>();
+    play->rtmp = setup_rtmp(url, &play->url_copy, false);
+    if (!play->rtmp) return 0;
+    RTMP_SetBufferMS(play->rtmp, buffer_ms > 0 ? buffer_ms : 10000);
+    if (play->rtmp->Link.protocol & RTMP_FEATURE_HTTP) {
+        LOGE("拉流不支持 RTMPT: %s", url);
+        free_play_connection(*play);
+        return 0;
+    }
+    rtmp_connect_timing timing;
+    memset(&timing, 0, sizeof(timing));
+    bool syn_data = false;
+    if (!connect_rtmp(play->rtmp, false, &play->tls, &timing, &syn_data)) {
+        LOGE("RTMP_Connect 失败，无法连接到服务器: %s", url);
+        free_play_connection(*play);
+        return 0;
+    }
+    play->rtmp->Link.timeout = 10;
+    struct timeval tv;
+    tv.tv_sec = 10;
+    tv.tv_usec = 0;
+    setsockopt(RTMP_Socket(play->rtmp), SOL_SOCKET, SO_RCVTIMEO, (char *) &tv, sizeof(tv));
+    setsockopt(RTMP_Socket(play->rtmp), SOL_SOCKET, SO_SNDTIMEO, (char *) &tv, sizeof(tv));
+    // createStream、play 直至 NetStream.Play.Start 由 librtmp 完成，之前到达的媒体消息被 librtmp 丢弃
+    if (!RTMP_ConnectStream(play->rtmp, 0)) {
+        LOGE("RTMP_ConnectStream 失败，无法开始拉流: %s", url);
+        free_play_connection(*play);
+        return 0;
+    }
+    play->player = RtmpPlayer::attach(play->rtmp);
+    if (!play->player) {
+        LOGE("无法接管拉流读路径: %s", url);
+        free_play_connection(*play);
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(g_player_mutex);
+    long handle = g_next_player++;
+    g_players[handle] = play;
+    LOGD("开始拉流 player=%ld: %s", handle, url);
+    return handle;
+}
+
+static std::shared_ptr<PlayConnection> find_player(rtmp_play_t player) {
+    std::lock_guard<std::mutex> lock(g_player_mutex);
+    auto it = g_players.find(player);
+    return it != g_players.end() ? it->second : nullptr;
+}
+
+int rtmp_play_read(rtmp_play_t player, unsigned char *buf, int size, int timeout_ms) {
+    std::shared_ptr<PlayConnection> play = find_player(player);
+    if (!play || buf == nullptr || size <= 0) {
+        LOGE("无效的拉流句柄或缓冲区: %ld", player);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(play->read_mutex);
+    if (!play->rtmp) return -1;  // 已关闭
+    return play->player->read(buf, size, timeout_ms);
+}
+
+int rtmp_get_play_stats(rtmp_play_t player, rtmp_play_stats *stats) {
+    if (stats == nullptr) {
+        LOGE("统计信息指针为空");
+        return -1;
+    }
+    std::shared_ptr<PlayConnection> play = find_player(player);
+    if (!play) return -1;
+    play->player->snapshot(stats);
+    return 0;
+}
+
+void rtmp_play_close(rtmp_play_t player) {
+    std::shared_ptr<PlayConnection> play;
+    {
+        std::lock_guard<std::mutex> lock(g_player_mutex);
+        auto it = g_players.find(player);
+        if (it == g_players.end()) return;
+        play = it->second;
+        g_players.erase(it);
+    }
+    std::lock_guard<std::mutex> lock(play->read_mutex);
+    free_play_connection(*play);
+    LOGD("关闭拉流 player=%ld", player);
+}
+
+int rtmp_log_set_async(int enable) {
+    bb_log_set_async(enable != 0);
+    return 0;
+}
+
+void rtmp_log_flush(void) {
+    bb_log_flush();
+}
+
+int rtmp_trace_enable(int enable) {
+    return frame_trace_set_enabled(enable != 0) ? 0 : -1;
+}
+
+int rtmp_trace_dump(const char *path) {
+    return frame_trace_dump_chrome_json(path);
+}
+
 void rtmp_close(rtmp_handle_t handle) {
+    // 先停止零拷贝发送线程与心跳定时器（都需要 g_mutex），归还所有未发送的缓冲区
+    std::shared_ptr<AsyncVideoSender> sender;
+    {
+        std::lock_guard<std::mutex> lock(g_async_mutex);
+        auto it = g_async_senders.find(handle);
+        if (it != g_async_senders.end()) {
+            sender = it->second;
+            g_async_senders.erase(it);
+        }
+    }
+    if (sender) sender->stop();
+    std::shared_ptr<Heartbeat> heartbeat = take_heartbeat(handle);
+    if (heartbeat) heartbeat->timer->stop();
+    {
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        g_stats.erase(handle);
+    }
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_connections.find(handle);
     if (it != g_connections.end()) {
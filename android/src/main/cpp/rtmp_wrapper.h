@@ -1,6 +1,8 @@
 #ifndef RTMP_WRAPPER_H
 #define RTMP_WRAPPER_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,15 +17,468 @@ typedef struct {
     long packet_loss_percent;     // 丢包率（百分比）
 } rtmp_stats;
 
+// 扩展统计信息版本号；新增字段只追加在结构体末尾，旧调用方按 struct_size 取其认识的部分
+#define RTMP_STATS_VERSION 4
+
+// 直方图桶数：0~3 微秒各占一个桶，之后每个 2 的幂区间再等分 4 个子桶（相对误差 ≤ 25%），覆盖到约 33 秒
+#define RTMP_HISTOGRAM_BUCKETS 96
+
+// 对数分桶延迟直方图（单位：微秒），由 rtmp_histogram_percentile 计算分位数
+typedef struct {
+    uint64_t count;                             // 样本数
+    uint64_t sum_us;                            // 样本总和
+    uint64_t max_us;                            // 最大值
+    uint64_t buckets[RTMP_HISTOGRAM_BUCKETS];   // 各桶样本数
+} rtmp_histogram;
+
+// 按媒体类型的发送计数
+typedef struct {
+    uint64_t bytes;               // 已发送的消息 body 字节数
+    uint64_t messages;            // 已发送的 RTMP 消息数
+} rtmp_media_counters;
+
+// 扩展统计信息（每个连接一份，发送路径以 relaxed 原子量更新，读取不阻塞发送线程）
+typedef struct {
+    uint32_t version;             // 输出：实现的版本号（RTMP_STATS_VERSION）
+    uint32_t struct_size;         // 输入：调用方结构体大小；输出：实际填充的字节数
+    rtmp_media_counters video;
+    rtmp_media_counters audio;
+    rtmp_media_counters data;     // onMetaData 等脚本数据
+    uint64_t chunks;              // 按当前 chunk size 切分出的 chunk 数
+    uint64_t send_syscalls;       // 估算的 send() 调用数（librtmp 每个 chunk 写一次 socket；io_uring 后端为携带该消息的 io_uring_enter 次数）
+    uint64_t send_failures;       // RTMP_SendPacket 失败次数
+    uint64_t dropped_video_frames;// 丢弃的视频帧数（等待关键帧期间、零拷贝发送队列满）
+    int64_t queue_depth_bytes;    // 最近一次发送后内核发送队列中的字节数，无法获取时为 -1
+    int64_t max_queue_depth_bytes;// 内核发送队列峰值
+    rtmp_histogram enqueue_to_wire_us;  // 调用发送接口到最后一个 chunk 写入 socket 的耗时（含等锁）
+    rtmp_histogram send_duration_us;    // 单次 RTMP_SendPacket 耗时
+    rtmp_histogram video_frame_gap_us;  // 相邻两次视频帧调用之间的间隔
+    // 版本 3：MSG_ZEROCOPY 发送（rtmp_set_zerocopy）
+    uint64_t zerocopy_messages;   // 以 MSG_ZEROCOPY 发送的消息数
+    uint64_t zerocopy_bytes;      // 以 MSG_ZEROCOPY 写出的线上字节数（含 chunk 头）
+    uint64_t copy_avoided_bytes;  // 完成通知确认未经内核拷贝的字节数
+    uint64_t zerocopy_copied_bytes;     // 内核回退为拷贝的字节数（回环、网卡不支持 scatter-gather 等）
+    rtmp_histogram zerocopy_completion_us; // 最后一次 sendmsg 返回到收到完成通知的耗时（body 被内核固定的时长）
+    // 版本 4：限时非阻塞发送（rtmp_set_send_deadline）
+    uint64_t would_block_frames;  // 上一条消息未能在期限内续写完、本消息未发送（RTMP_SEND_WOULD_BLOCK）的次数
+    uint64_t partial_messages;    // 写到期限时剩余部分留待续写的消息数
+    uint64_t resumed_bytes;       // 之后续写出的字节数
+} rtmp_stats_v2;
+
+// 关键帧请求原因
+typedef enum {
+    RTMP_KEYFRAME_REASON_NEW_STREAM = 1,    // 新连接/重连/新推流目标，尚未发送过关键帧
+    RTMP_KEYFRAME_REASON_FRAME_DROPPED = 2  // 丢帧切断了参考链，需等待下一个 IDR
+} rtmp_keyframe_reason;
+
+// 视频编码。H.264 沿用 FLV CodecID 7；HEVC 使用 Enhanced RTMP 的 FourCC 视频 tag（'hvc1'）
+typedef enum {
+    RTMP_VIDEO_CODEC_H264 = 7,
+    RTMP_VIDEO_CODEC_HEVC = 12
+} rtmp_video_codec;
+
+// 音频编码。AAC 沿用 FLV SoundFormat 10；Opus 使用 Enhanced RTMP 的 FourCC 音频 tag（'Opus'）
+typedef enum {
+    RTMP_AUDIO_CODEC_AAC = 10,
+    RTMP_AUDIO_CODEC_OPUS = 13
+} rtmp_audio_codec;
+
+// 零拷贝异步发送的返回值 / 释放回调的 result（0 表示已发送）
+typedef enum {
+    RTMP_ASYNC_QUEUE_FULL = -2,  // 队列满，非关键帧未入队，缓冲区仍归调用方
+    RTMP_ASYNC_DROPPED = -3      // 已入队但未发送即被丢弃（关键帧清空积压或连接关闭）
+} rtmp_async_result;
+
+// 限时非阻塞发送（rtmp_set_send_deadline）下发送接口的返回值
+typedef enum {
+    RTMP_SEND_WOULD_BLOCK = -4   // 上一条消息未能在期限内写完，本帧未发送；连接保持可用，可稍后重试或丢弃
+} rtmp_send_result;
+
+// rtmp_play_read 的返回值
+typedef enum {
+    RTMP_READ_TIMEOUT = -5       // 期限内没有收到完整的 tag，连接保持可用
+} rtmp_read_result;
+
+// 拉流句柄（与 rtmp_handle_t 独立）
+typedef long rtmp_play_t;
+
+// 断网缓存句柄（与连接句柄独立，可跨重连复用）
+typedef long rtmp_spool_t;
+
+// 重连后对积压数据的处理方式
+typedef enum {
+    RTMP_SPOOL_MODE_DRAIN = 0,   // 以快于实时的速度补发积压数据后恢复直播
+    RTMP_SPOOL_MODE_DISCARD = 1  // 丢弃积压数据，直接恢复直播
+} rtmp_spool_mode;
+
+// 断网缓存统计信息
+typedef struct {
+    long backlog_bytes;           // 待补发字节数
+    long backlog_frames;          // 待补发帧数
+    long evicted_frames;          // 缓存写满被淘汰的帧数
+    long drain_rate_bps;          // 最近一次补发速率（字节/秒）
+    long drained_bytes;           // 累计补发字节数
+} rtmp_spool_stats;
+
+// 帧环句柄：编码回调线程与发送线程之间的单生产者/单消费者队列
+typedef long rtmp_ring_t;
+
+// 帧环承载的媒体类型，决定消费时调用的发送/缓存接口
+typedef enum {
+    RTMP_RING_VIDEO = 0,
+    RTMP_RING_AUDIO = 1
+} rtmp_ring_media;
+
+// rtmp_ring_send 的返回值标志（非负时按位组合）
+typedef enum {
+    RTMP_RING_CONSUMED = 1,   // 消费了一帧（未置位表示超时或被唤醒时队列为空）
+    RTMP_RING_KEYFRAME = 2,   // 该帧为关键帧
+    RTMP_RING_SPOOLED = 4     // 该帧写入了断网缓存而不是发送
+} rtmp_ring_send_flags;
+
+// 帧环占用统计
+typedef struct {
+    long capacity_bytes;          // 数据区大小
+    long used_bytes;              // 当前占用字节数（含记录头与对齐）
+    long max_used_bytes;          // 占用峰值
+    long queued_frames;           // 当前排队帧数
+    long max_queued_frames;       // 排队帧数峰值
+    long pushed_frames;           // 累计写入帧数
+    long dropped_frames;          // 环满被拒绝的帧数
+    long flushed_frames;          // 关键帧插队或清空时丢弃的积压帧数
+    long wakeups;                 // 生产者唤醒消费者的次数（eventfd 写入次数）
+} rtmp_ring_stats;
+
+// 音视频时钟句柄（与连接句柄独立，跨重连保持同一条时间线）
+typedef long rtmp_clock_t;
+
+// 音视频时钟统计
+typedef struct {
+    int64_t drift_us;             // 采集时钟相对音频采样时钟的漂移（平滑值，正值表示采集时钟走得快）
+    int64_t correction_us;        // 当前施加在视频时间戳上的校正量（逐帧追赶 drift_us）
+    uint64_t audio_samples;       // 累计音频采样数
+    uint64_t audio_resyncs;       // 音频中断后重新锚定采样时间线的次数
+    uint64_t audio_clamped;       // 为保证递增而被推后的音频时间戳数
+    uint64_t video_clamped;       // 为保证递增而被推后的视频时间戳数
+    int64_t last_audio_ms;        // 最近输出的音频时间戳，尚无输出为 -1
+    int64_t last_video_ms;        // 最近输出的视频时间戳，尚无输出为 -1
+} rtmp_clock_stats;
+
+// RTMPS 传输方式
+typedef enum {
+    RTMP_TLS_MODE_NONE = 0,       // 明文 RTMP
+    RTMP_TLS_MODE_KERNEL = 1,     // 内核 TLS（kTLS）：收发均由内核加解密，发送路径无额外拷贝
+    RTMP_TLS_MODE_USERSPACE = 2   // 用户态 TLS：经中继线程转发（发送方向装入内核时仍由内核加密）
+} rtmp_tls_mode;
+
+// rtmp_tls_configure 的标志（按位组合）
+typedef enum {
+    RTMP_TLS_NO_VERIFY = 1,       // 不校验服务端证书（仅用于测试）
+    RTMP_TLS_NO_KTLS = 2,         // 不使用内核 TLS
+    RTMP_TLS_FULL_OFFLOAD = 4     // 限制为 TLS 1.2，使收发两个方向都可装入内核
+} rtmp_tls_flags;
+
+// RTMPS 连接信息
+typedef struct {
+    int mode;                     // rtmp_tls_mode
+    int ktls_send;                // 发送方向是否由内核加密
+    int ktls_recv;                // 接收方向是否由内核解密
+    char version[16];             // 协商的协议版本，如 "TLSv1.3"
+    char cipher[64];              // 协商的密码套件
+    uint64_t relay_bytes_out;     // 用户态中继发出的明文字节数
+    uint64_t relay_bytes_in;      // 用户态中继收到的明文字节数
+} rtmp_tls_info;
+
+// 连接建立时 TCP Fast Open 的结果
+typedef enum {
+    RTMP_FAST_OPEN_OFF = 0,       // 未使用（未开启、SOCKS 代理或内核不支持）
+    RTMP_FAST_OPEN_USED = 1,      // C0+C1 随 SYN 发出并被服务端确认，节省一个往返
+    RTMP_FAST_OPEN_NO_COOKIE = 2, // 没有缓存的 cookie：照常三次握手，并请求 cookie 供下次连接使用
+    RTMP_FAST_OPEN_REFUSED = 3,   // SYN 携带的数据未被确认（cookie 失效或服务端未开启），由内核在握手后重传
+    RTMP_FAST_OPEN_FALLBACK = 4   // 携带数据的 SYN 之后连接失败，已关闭 TFO 重新连接
+} rtmp_fast_open_state;
+
+// 连接建立各阶段耗时（rtmp_init 内测量）
+typedef struct {
+    int fast_open;                // rtmp_fast_open_state
+    int64_t dns_us;               // 解析主机名
+    int64_t tcp_connect_us;       // TCP 三次握手（TFO 推迟连接时为 0，SYN 往返计入 rtmp_connect_us）
+    int64_t tls_us;               // RTMPS 的 TLS 握手，明文连接为 0
+    int64_t rtmp_connect_us;      // RTMP 握手与 connect 命令（RTMP_Connect1）
+    int64_t connect_stream_us;    // createStream 与 publish（RTMP_ConnectStream）
+    int64_t total_us;             // 从解析主机名到可以推流（含 TFO 失败后的重连）
+    int64_t rtt_us;               // 连接建立后内核的平滑 RTT
+    int64_t saved_rtt_us;         // TFO 节省的往返时间（按 rtt_us 估计，未使用 TFO 时为 0）
+} rtmp_connect_timing;
+
+// 发送后端
+typedef enum {
+    RTMP_TRANSPORT_SOCKET = 0,    // librtmp 逐 chunk send()（默认）
+    RTMP_TRANSPORT_URING = 1      // io_uring：注册缓冲区 + 链接的 WRITE_FIXED，多连接批量提交
+} rtmp_transport;
+
+// io_uring 发送引擎统计（进程内所有连接累计）
+typedef struct {
+    int available;                // 引擎已初始化（首次以 rtmp_set_transport 选择 io_uring 时探测内核支持）
+    int connections;              // 当前使用 io_uring 的连接数
+    uint64_t enter_calls;         // io_uring_enter 调用次数
+    uint64_t sqes;                // 提交的写 SQE 数
+    uint64_t batched_enters;      // 一次提交中包含多个连接的 io_uring_enter 次数
+    uint64_t messages;            // 写完的消息数
+    uint64_t bytes;               // 写出的线上字节数（含 chunk 头）
+    uint64_t resubmits;           // 短写或链中断后从断点重新提交的次数
+    uint64_t timeouts;            // 写超时被取消的链数
+} rtmp_uring_stats;
+
+// 批量 RTMPT 统计（rtmp_get_rtmpt_stats）
+typedef struct {
+    uint64_t posts;               // POST /send 请求数
+    uint64_t idle_polls;          // POST /idle 轮询数
+    uint64_t messages;            // 合并进 POST 的 RTMP 消息数（含 Acknowledgement、Ping Response）
+    uint64_t bytes;               // POST /send 的负载字节数（chunk 流）
+    uint64_t responses;           // 收到的应答数
+    uint64_t received_bytes;      // 应答中服务端下发的 RTMP 字节数
+    int inflight;                 // 当前已发出、尚未收到应答的请求数
+    int max_inflight;             // 在途请求数峰值
+    int64_t max_post_bytes;       // 单个 POST /send 的最大负载
+} rtmp_rtmpt_stats;
+
+// 拉流统计（rtmp_get_play_stats）
+typedef struct {
+    uint64_t messages;            // 收到的完整 RTMP 消息数（含控制与命令消息）
+    uint64_t tags;                // 输出的 FLV tag 数（聚合消息按拆出的 tag 计）
+    uint64_t flv_bytes;           // 输出的 FLV 字节数（含文件头）
+    uint64_t bytes_in;            // socket 读到的字节数
+    uint64_t recv_calls;          // recvmsg 调用次数
+    uint64_t zero_copy_messages;  // 消息体直接取自接收环形缓冲区（未拷贝）的消息数
+    uint64_t copied_bytes;        // 从接收环形缓冲区拷贝进消息缓冲区的负载字节数
+    uint64_t direct_bytes;        // 绕过环形缓冲区、直接读入消息缓冲区的负载字节数
+} rtmp_play_stats;
+
+// 事件驱动推流引擎句柄与其中的推流会话句柄（与 rtmp_handle_t 独立）
+typedef long rtmp_engine_t;
+typedef long rtmp_session_t;
+
+// 推流引擎配置，各字段为 0 时取括号中的默认值
+typedef struct {
+    int threads;                  // epoll 线程数（1）
+    int chunk_size;               // 输出 chunk size（4096）
+    int max_queue_bytes;          // 每个会话排队待发的 body 字节上限，超过时丢帧并等待下一个关键帧（1 MB）
+    int connect_timeout_ms;       // TCP 连接到 publish 成功的超时（10000）
+    int ping_interval_ms;         // 向服务端发送 ping 请求的间隔（5000），< 0 不发送 ping
+    int ping_timeout_ms;          // 超过该时长没有收到任何数据或发送停滞即判定断线（15000）
+    int reconnect_min_ms;         // 首次重连前的等待（500），之后每次翻倍并加随机抖动
+    int reconnect_max_ms;         // 重连等待上限（30000）
+    int max_reconnects;           // 连续重连失败次数上限（无限制），< 0 不重连
+} rtmp_engine_config;
+
+// 推流会话状态
+typedef enum {
+    RTMP_ENGINE_CONNECTING = 0,   // TCP 连接中
+    RTMP_ENGINE_HANDSHAKING = 1,  // RTMP 握手与 connect/createStream/publish 命令
+    RTMP_ENGINE_PUBLISHING = 2,   // 推流中
+    RTMP_ENGINE_RECONNECT_WAIT = 3, // 断线后等待重连
+    RTMP_ENGINE_FAILED = 4,       // 重连次数用尽
+    RTMP_ENGINE_CLOSED = 5        // 已关闭
+} rtmp_engine_state;
+
+// 引擎发送接口的返回值（0 表示已入队）
+typedef enum {
+    RTMP_ENGINE_DROPPED = -5      // 本帧被丢弃：队列超过上限、等待关键帧、缺少序列头或会话已失败
+} rtmp_engine_result;
+
+// 推流会话统计
+typedef struct {
+    int state;                    // rtmp_engine_state
+    int reconnects;               // 断线后重新进入推流状态的次数
+    uint64_t bytes_sent;          // 写入 socket 的线上字节数（含握手与 chunk 头）
+    uint64_t video_frames;        // 写出的视频帧数
+    uint64_t audio_frames;        // 写出的音频帧数
+    uint64_t dropped_frames;      // 丢弃的音视频帧数（含断线时清空的队列）
+    int64_t queued_bytes;         // 当前排队待发的 body 字节数
+    int64_t rtt_us;               // 最近一次 ping 往返时间，尚无测量为 -1
+    int64_t connect_us;           // 最近一次从发起 TCP 连接到 publish 成功的耗时
+} rtmp_engine_session_stats;
+
+// 推流引擎统计
+typedef struct {
+    int threads;                  // epoll 线程数
+    int sessions;                 // 未关闭的会话数
+    int publishing;               // 处于推流状态的会话数
+    uint64_t wakeups;             // epoll_wait 返回次数
+    uint64_t writes;              // sendmsg 调用次数
+    uint64_t bytes_sent;          // 所有会话写出的字节数
+    int64_t cpu_us;               // epoll 线程累计占用的 CPU 时间
+} rtmp_engine_stats;
+
+/**
+ * 关键帧请求回调（在调用 rtmp_send_video 等接口的线程上触发，不持有内部锁）
+ * @param handle 连接句柄
+ * @param reason 请求原因，见 rtmp_keyframe_reason
+ * @param user_data 注册时传入的用户数据
+ */
+typedef void (*rtmp_keyframe_request_cb)(rtmp_handle_t handle, int reason, void *user_data);
+
+/**
+ * 零拷贝发送的缓冲区释放回调（在 native 发送线程上触发，清空积压或关闭连接时也可能在调用方线程上触发；
+ * 不持有内部锁）。回调返回后 native 不再访问该缓冲区
+ * @param handle 连接句柄
+ * @param token rtmp_send_video_async 传入的释放令牌
+ * @param result 0 已发送，RTMP_ASYNC_DROPPED 未发送即丢弃，其他负数为发送失败
+ * @param user_data 注册时传入的用户数据
+ */
+typedef void (*rtmp_buffer_release_cb)(rtmp_handle_t handle, long token, int result, void *user_data);
+
 /**
  * 初始化 RTMP 连接
- * @param url RTMP 推流地址
+ * @param url RTMP 推流地址（rtmps:// 需以 BB_RTMP_TLS 编译，见 rtmp_tls_configure）
  * @return 连接句柄，失败返回 0
  */
 rtmp_handle_t rtmp_init(const char *url);
 
 /**
- * 设置元数据信息（用于 AMF0 onMetaData）
+ * 配置 RTMPS（rtmps:// 与 rtmpts:// 地址）的证书校验与内核 TLS 选项（全局，对之后 rtmp_init 建立的连接生效）。
+ * TCP 连接建立后在用户态完成 TLS 握手，内核支持时通过 setsockopt(SOL_TLS) 装入会话密钥，
+ * 之后的 RTMP chunk 以明文 send 写入、由内核加密；否则回退到用户态 TLS
+ * @param ca_file CA 证书文件（PEM），为 NULL 或空字符串时使用系统默认路径
+ * @param flags rtmp_tls_flags 按位组合
+ * @return 成功返回 0，未以 BB_RTMP_TLS 编译时返回负数
+ */
+int rtmp_tls_configure(const char *ca_file, int flags);
+
+/**
+ * 获取连接的 RTMPS 传输信息
+ * @param handle 连接句柄
+ * @param info 输出连接信息；明文连接的 mode 为 RTMP_TLS_MODE_NONE
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_tls_info(rtmp_handle_t handle, rtmp_tls_info *info);
+
+/**
+ * 开启或关闭 TCP Fast Open（全局，对之后 rtmp_init 建立的连接生效，默认关闭）。开启后以 TCP_FASTOPEN_CONNECT
+ * 建立连接：内核缓存了服务端的 cookie 时 C0+C1 随 SYN 发出，握手少等一个往返；没有 cookie 或服务端拒绝时照常握手，
+ * 携带数据的 SYN 之后连接失败则关闭 TFO 重连一次。需要内核 net.ipv4.tcp_fastopen 开启客户端（默认开启），
+ * 经 SOCKS 代理的连接不使用 TFO
+ * @param enable 非 0 开启
+ * @return 成功返回 0；非 Linux 或系统头文件不支持 TCP_FASTOPEN_CONNECT 时开启返回负数
+ */
+int rtmp_set_fast_open(int enable);
+
+/**
+ * 获取连接建立各阶段的耗时与 TCP Fast Open 结果
+ * @param handle 连接句柄
+ * @param timing 输出耗时
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_connect_timing(rtmp_handle_t handle, rtmp_connect_timing *timing);
+
+/**
+ * 选择连接的发送后端。io_uring 后端下音视频消息按 chunk 序列化进注册缓冲区后立即返回，由引擎线程写出
+ * （写失败在之后的发送调用中返回）；onMetaData 等其他消息先等待队列写完再经 librtmp 发送。
+ * 不支持 RTMPT（HTTP 隧道）连接
+ * @param handle 连接句柄
+ * @param transport rtmp_transport
+ * @return 成功返回 0；未以 BB_RTMP_URING 编译或内核不支持时返回负数，连接保持 socket 后端
+ */
+int rtmp_set_transport(rtmp_handle_t handle, int transport);
+
+/**
+ * 获取 io_uring 发送引擎的累计统计
+ * @param stats 输出统计信息
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_uring_stats(rtmp_uring_stats *stats);
+
+/**
+ * 开启或关闭大视频消息的 MSG_ZEROCOPY 发送（Linux 4.14+，仅明文 TCP 连接）。body 不小于阈值的视频消息以
+ * sendmsg(MSG_ZEROCOPY) 直接引用 packet 缓冲区，收到内核完成通知前缓冲区保持固定，之后归还连接的缓冲池复用；
+ * 统计见 rtmp_stats_v2 的 zerocopy_* 字段。io_uring 后端（rtmp_set_transport）下音视频消息仍由引擎写出。
+ * 零拷贝按页固定内存，默认 chunk size 128 会把负载切成大量小片段，建议同时调大输出 chunk size
+ * @param handle 连接句柄
+ * @param threshold_bytes body 字节数阈值，<= 0 关闭（等待在途消息完成后返回）
+ * @param chunk_size 新的输出 chunk size（128 ~ 0xFFFFFF，向服务端发送 Set Chunk Size），<= 0 保持不变
+ * @return 成功返回 0；RTMPS/RTMPT 连接、非 Linux 或内核不支持时返回负数，连接保持原发送方式
+ */
+int rtmp_set_zerocopy(rtmp_handle_t handle, int threshold_bytes, int chunk_size);
+
+/**
+ * 开启或关闭限时非阻塞发送。开启后音视频消息以非阻塞写发出，上行停滞时发送接口最多等待到
+ * 帧进入发送接口后 deadline_ms：写到期限的消息剩余部分保存在连接上，下一次发送从断点续写；续写在期限内
+ * 仍未完成时返回 RTMP_SEND_WOULD_BLOCK 且不写入本帧，调用方丢帧或稍后重试，连接保持可用。
+ * 统计见 rtmp_stats_v2 的 would_block_frames 等字段。与 io_uring 后端、MSG_ZEROCOPY 互斥，不支持 RTMPT
+ * @param handle 连接句柄
+ * @param deadline_ms 每帧的发送期限（毫秒），<= 0 关闭（先以最多 10 秒写完未完成的消息）
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_send_deadline(rtmp_handle_t handle, int deadline_ms);
+
+/**
+ * 续写限时发送中未写完的消息
+ * @param handle 连接句柄
+ * @param timeout_ms 最多等待的毫秒数，0 只尝试一次
+ * @return 已写完（或没有未完成的消息）返回 0，超时返回 RTMP_SEND_WOULD_BLOCK，连接错误返回 -1
+ */
+int rtmp_flush(rtmp_handle_t handle, int timeout_ms);
+
+/**
+ * 开启或关闭 RTMPT（HTTP 隧道）连接的批量发送。librtmp 为每条消息发一个 POST /send 且不读应答；开启后由
+ * native 接管隧道：合并窗口内的全部消息（音视频与控制消息）合并为一个 POST，不等应答即流水线发出后续请求，
+ * 后台线程读取应答并处理服务端下发的控制消息（Set Chunk Size、ping、Acknowledgement）。
+ * 统计见 rtmp_get_rtmpt_stats；rtmp_flush 立即发出已合并的消息。与 io_uring 后端、MSG_ZEROCOPY、限时发送互斥
+ * @param handle 连接句柄（rtmpt:// 或 rtmpte://）
+ * @param window_ms 合并窗口（毫秒），0 不等待（只合并上一个 POST 写出期间积累的消息），< 0 关闭（写完待发数据
+ *                  并等待在途应答，之后恢复 librtmp 逐条发送）
+ * @return 成功返回 0；非 RTMPT 连接返回负数
+ */
+int rtmp_set_rtmpt_batch(rtmp_handle_t handle, int window_ms);
+
+/**
+ * 获取批量 RTMPT 发送的统计
+ * @param handle 连接句柄
+ * @param stats 输出统计信息
+ * @return 成功返回 0；未开启批量发送或失败返回负数
+ */
+int rtmp_get_rtmpt_stats(rtmp_handle_t handle, rtmp_rtmpt_stats *stats);
+
+/**
+ * 以 play 模式连接并开始拉流。连接、握手与 play 命令由 librtmp 完成（RTMP_ConnectStream 收到
+ * NetStream.Play.Start 为止），之后由 native 接管读路径：chunk 头在接收环形缓冲区内原地解析，单 chunk 消息不拷贝，
+ * 大消息的负载直接读入消息缓冲区；服务端的 Set Chunk Size、窗口大小与 ping 在读取时处理
+ * @param url 拉流地址（rtmp:// 或 rtmps://，不支持 RTMPT）
+ * @param buffer_ms 请求服务端缓冲的时长（SetBufferLength），<= 0 取 10000
+ * @return 成功返回拉流句柄（> 0），失败返回 0
+ */
+rtmp_play_t rtmp_play_open(const char *url, int buffer_ms);
+
+/**
+ * 读取 FLV 字节流，格式与 RTMP_Read 相同：首次读取以 FLV 文件头开始（音视频标志固定为 0x05），之后为 tag，
+ * 聚合消息拆成其中的 tag 并改写为绝对时间戳。buf 放不下的 tag 余下部分留到下一次读取；已收到的多个 tag 一次读出
+ * @param player 拉流句柄
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @param timeout_ms 没有可读数据时最多等待的毫秒数，0 不等待
+ * @return 写入的字节数；流已结束（NetStream.Play.Stop/Complete/UnpublishNotify 或服务端关闭连接）返回 0；
+ *         期限内没有数据返回 RTMP_READ_TIMEOUT；失败返回 -1
+ */
+int rtmp_play_read(rtmp_play_t player, unsigned char *buf, int size, int timeout_ms);
+
+/**
+ * 获取拉流统计
+ * @param player 拉流句柄
+ * @param stats 输出统计信息
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_play_stats(rtmp_play_t player, rtmp_play_stats *stats);
+
+/**
+ * 关闭拉流连接（等待正在进行的 rtmp_play_read 返回）
+ * @param player 拉流句柄
+ */
+void rtmp_play_close(rtmp_play_t player);
+
+/**
+ * 设置元数据信息（用于 AMF0 onMetaData）。H.264 的宽高与帧率（SPS 含 VUI timing 时）以码流中的 SPS 为准，
+ * 这里的值只在解析到 SPS 之前或 HEVC 时使用
  * @param handle 连接句柄
  * @param width 视频宽度
  * @param height 视频高度
@@ -36,26 +491,339 @@ rtmp_handle_t rtmp_init(const char *url);
 int rtmp_set_metadata(rtmp_handle_t handle, int width, int height, int video_bitrate, int fps, int audio_sample_rate, int audio_channels);
 
 /**
- * 发送视频数据
+ * 设置视频编码（默认 H.264）。需在发送第一帧视频之前调用；推流中切换会在下一帧带参数集时重发序列头与 onMetaData
+ * @param handle 连接句柄
+ * @param codec 见 rtmp_video_codec
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_video_codec(rtmp_handle_t handle, int codec);
+
+/**
+ * 设置音频编码（默认 AAC，服务端不支持 Enhanced RTMP 时应保持默认）。需在发送第一帧音频之前调用，
+ * 推流中切换会重发音频序列头与 onMetaData
+ * @param handle 连接句柄
+ * @param codec 见 rtmp_audio_codec；Opus 要求 rtmp_set_metadata 的采样率为 48000
+ * @param bitrate 音频码率（bps），写入 onMetaData 的 audiodatarate；<= 0 使用默认值（AAC 64k，Opus 32k）
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_audio_codec(rtmp_handle_t handle, int codec, int bitrate);
+
+/**
+ * 发送视频数据。参数集按内容检测变化：新的 SPS/PPS 在第一个使用它的关键帧处生效，
+ * 序列头与 onMetaData 紧接在该关键帧之前发出，此前的非关键帧仍按旧参数集发送
  * @param handle 连接句柄
- * @param data 视频数据（H.264 NAL 单元）
+ * @param data 视频数据（Annex-B 格式的 H.264/HEVC NAL 单元）
  * @param size 数据大小
  * @param timestamp 时间戳（微秒）
  * @param isKeyFrame 是否为关键帧
- * @return 成功返回 0，失败返回负数
+ * @return 成功返回 0；限时发送下上一条消息未能在期限内写完时返回 RTMP_SEND_WOULD_BLOCK（本帧未发送，
+ *         native 丢弃后续非关键帧直至下一个关键帧）；其余失败返回负数
  */
 int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame);
 
 /**
  * 发送音频数据
  * @param handle 连接句柄
- * @param data 音频数据（AAC）
+ * @param data 音频数据（AAC 原始帧或带 ADTS 头；Opus 为单个 Opus 包）
  * @param size 数据大小
  * @param timestamp 时间戳（微秒）
- * @return 成功返回 0，失败返回负数
+ * @return 成功返回 0；限时发送下未发送时返回 RTMP_SEND_WOULD_BLOCK；其余失败返回负数
  */
 int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long timestamp);
 
+/**
+ * 注册零拷贝发送的释放回调并启动该连接的 native 发送线程。重复注册会先停止旧线程（未发送的缓冲区以旧回调释放）
+ * @param handle 连接句柄
+ * @param cb 释放回调，传 NULL 停止发送线程
+ * @param user_data 回调用户数据
+ * @param max_queued 最多排队的帧数，<= 0 使用默认值 3（编码器输出缓冲区有限，排队过多会阻塞编码）
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_buffer_release_callback(rtmp_handle_t handle, rtmp_buffer_release_cb cb, void *user_data, int max_queued);
+
+/**
+ * 异步发送视频数据，直接读取调用方缓冲区（如 MediaCodec 输出缓冲区），不拷贝。
+ * 入队成功后缓冲区归 native 所有，直至释放回调以 token 归还；需先调用 rtmp_set_buffer_release_callback
+ * @param handle 连接句柄
+ * @param data 视频数据（Annex-B 格式的 H.264/HEVC NAL 单元），释放回调前必须保持有效
+ * @param size 数据大小
+ * @param timestamp 时间戳（微秒）
+ * @param isKeyFrame 是否为关键帧
+ * @param token 释放令牌，原样传回释放回调
+ * @return 入队成功返回 0（释放回调恰好触发一次）；失败返回负数，不触发回调，缓冲区仍归调用方。
+ *         RTMP_ASYNC_QUEUE_FULL 表示丢弃了非关键帧，参考链已断开并会请求关键帧
+ */
+int rtmp_send_video_async(rtmp_handle_t handle, const unsigned char *data, int size, long timestamp, int isKeyFrame,
+                          long token);
+
+/**
+ * 注册关键帧请求回调。注册时若连接尚未发送过关键帧（新连接/重连），会立即请求一次
+ * @param handle 连接句柄
+ * @param cb 回调，传 NULL 取消注册
+ * @param user_data 回调用户数据
+ * @param min_interval_ms 两次请求的最小间隔（毫秒），<= 0 使用默认值 1000，防止拥塞时 IDR 风暴
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_keyframe_request_callback(rtmp_handle_t handle, rtmp_keyframe_request_cb cb, void *user_data, int min_interval_ms);
+
+/**
+ * 通知上层丢弃了视频帧（如发送队列满）。丢帧后参考链断开，
+ * 后续非关键帧将被丢弃直至下一个关键帧，并通过回调请求关键帧
+ * @param handle 连接句柄
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_notify_video_dropped(rtmp_handle_t handle);
+
+/**
+ * 开始后台心跳（替代每秒重发完整关键帧）：native 定时器先发送一次 keyframe，之后按 fps 发送由已缓存的
+ * SPS/PPS 合成的 P_Skip 帧（全部宏块跳过，重复 keyframe 的画面，每帧仅几个字节），每隔 keyframe_interval_ms
+ * 重发一次 keyframe 便于新观众起播。音频超过 3 帧时长没有输入时按帧时长补发静音帧（AAC/Opus），
+ * 真实音频恢复后自动停止补发。仅支持 H.264，重复调用会先停止旧的心跳
+ * @param handle 连接句柄
+ * @param keyframe 最近的 IDR 帧（Annex-B），函数返回后不再访问
+ * @param size 数据大小
+ * @param timestamp 心跳首帧的时间戳（毫秒），之后按单调时钟递增
+ * @param fps 心跳帧率，<= 0 使用默认值 5
+ * @param keyframe_interval_ms 重发 keyframe 的间隔（毫秒），<= 0 不重发
+ * @return 成功返回 0；HEVC、参数集缺失或码流特性不支持时返回负数（调用方可回退为重发关键帧）
+ */
+int rtmp_heartbeat_start(rtmp_handle_t handle, const unsigned char *keyframe, int size, long timestamp, int fps,
+                         int keyframe_interval_ms);
+
+/**
+ * 停止后台心跳。合成帧之后编码器的非关键帧无法解码，停止后会丢弃非关键帧直至下一个关键帧，并通过回调请求关键帧
+ * @param handle 连接句柄
+ * @return 成功返回 0，未在心跳中返回负数
+ */
+int rtmp_heartbeat_stop(rtmp_handle_t handle);
+
+/**
+ * 开始本地 FLV 录制。写入与推流完全相同的 FLV tag（含序列头与 onMetaData），
+ * 与发送路径共享缓冲区，由独立 I/O 线程批量写盘，磁盘慢时丢弃录制数据而不阻塞推流
+ * @param handle 连接句柄
+ * @param path 录制文件路径；开启切分时文件名为 <path 去掉 .flv>_<序号>.flv
+ * @param max_segment_bytes 单个文件最大字节数，<= 0 不按大小切分
+ * @param max_segment_duration_ms 单个文件最大时长（毫秒），<= 0 不按时长切分
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_start_recording(rtmp_handle_t handle, const char *path, long max_segment_bytes, int max_segment_duration_ms);
+
+/**
+ * 停止本地 FLV 录制，写完剩余数据并回填文件头（duration/filesize）
+ * @param handle 连接句柄
+ * @return 成功返回 0，未在录制或录制期间写盘（含回填文件头）失败返回负数
+ */
+int rtmp_stop_recording(rtmp_handle_t handle);
+
+/**
+ * 创建断网缓存（环形文件，写满后淘汰最旧的帧）
+ * @param path 缓存文件路径，关闭时删除
+ * @param capacity_bytes 缓存容量（字节）
+ * @return 缓存句柄，失败返回 0
+ */
+rtmp_spool_t rtmp_spool_open(const char *path, long capacity_bytes);
+
+/**
+ * 连接断开时调用：之后写入的帧进入缓存，直至 rtmp_spool_drain 排空
+ * @param spool 缓存句柄
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_spool_begin(rtmp_spool_t spool);
+
+/**
+ * 写入视频帧到缓存（参数同 rtmp_send_video）
+ * @return 已缓存返回 0；缓存未激活返回 1，调用方应直接发送；失败返回负数
+ */
+int rtmp_spool_video(rtmp_spool_t spool, unsigned char *data, int size, long timestamp, int isKeyFrame);
+
+/**
+ * 写入音频帧到缓存（参数同 rtmp_send_audio）
+ * @return 已缓存返回 0；缓存未激活返回 1，调用方应直接发送；失败返回负数
+ */
+int rtmp_spool_audio(rtmp_spool_t spool, unsigned char *data, int size, long timestamp);
+
+/**
+ * 重连成功后排空缓存（阻塞调用）。排空期间新写入的帧继续追加到缓存尾部，
+ * 全部发完后缓存转为未激活状态，之后的帧由调用方直接发送
+ * @param spool 缓存句柄
+ * @param handle 新的连接句柄
+ * @param mode 处理方式，见 rtmp_spool_mode
+ * @param speed_percent 补发速度（相对实时的百分比，如 200 为 2 倍速），<= 0 不限速
+ * @return 成功返回 0，发送失败返回负数（剩余数据保留在缓存中）
+ */
+int rtmp_spool_drain(rtmp_spool_t spool, rtmp_handle_t handle, int mode, int speed_percent);
+
+/**
+ * 获取断网缓存统计信息
+ * @param spool 缓存句柄
+ * @param stats 统计信息结构指针
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_spool_get_stats(rtmp_spool_t spool, rtmp_spool_stats *stats);
+
+/**
+ * 关闭断网缓存并删除缓存文件
+ * @param spool 缓存句柄
+ */
+void rtmp_spool_close(rtmp_spool_t spool);
+
+/**
+ * 创建帧环（预分配数据区，由 rtmp_ring_data 共享给上层直接写入）
+ * @param media 见 rtmp_ring_media
+ * @param capacity_bytes 数据区大小，需大于最大帧
+ * @param max_frames 最多排队的帧数，达到后非关键帧被拒绝、关键帧清空积压后入队；<= 0 只受容量限制
+ * @return 帧环句柄，失败（含同时存在的帧环超过 256 个）返回 0
+ */
+rtmp_ring_t rtmp_ring_create(int media, long capacity_bytes, int max_frames);
+
+/**
+ * 获取帧环数据区（生命周期与帧环相同）
+ * @param capacity 输出数据区大小
+ * @return 数据区地址，失败返回 NULL
+ */
+uint8_t *rtmp_ring_data(rtmp_ring_t ring, long *capacity);
+
+/**
+ * 生产者：预留一帧的空间，之后把帧数据写入数据区的返回偏移处并调用 rtmp_ring_commit
+ * @param size 帧大小
+ * @param isKeyFrame 是否为关键帧
+ * @return 数据区偏移，环满返回负数（该帧应丢弃）
+ */
+long rtmp_ring_reserve(rtmp_ring_t ring, int size, int isKeyFrame);
+
+/**
+ * 生产者：发布最近一次预留的帧，必要时唤醒消费者
+ * @param timestamp 时间戳（与 rtmp_send_video 相同，消费时原样传入）
+ * @return 为关键帧清空的积压帧数，失败返回负数
+ */
+int rtmp_ring_commit(rtmp_ring_t ring, long timestamp);
+
+/**
+ * 生产者：丢弃已发布但尚未发送的帧（如重连后不再发送旧数据），需与 reserve/commit 在同一把锁内调用
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_ring_flush(rtmp_ring_t ring);
+
+/**
+ * 消费者：等待并原地发送一帧。断网缓存处于缓存状态时写入缓存，否则发送到 handle（为 0 时丢弃）
+ * @param handle 连接句柄
+ * @param spool 断网缓存句柄，0 表示未启用
+ * @param timeout_ms 队列为空时的最长等待时间（毫秒）
+ * @return 非负为 rtmp_ring_send_flags 组合；发送失败返回负数（该帧已出队）
+ */
+int rtmp_ring_send(rtmp_ring_t ring, rtmp_handle_t handle, rtmp_spool_t spool, int timeout_ms);
+
+/**
+ * 唤醒阻塞在 rtmp_ring_send 中的消费者（停止发送线程时调用）
+ */
+void rtmp_ring_wakeup(rtmp_ring_t ring);
+
+/**
+ * 获取帧环占用统计
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_ring_get_stats(rtmp_ring_t ring, rtmp_ring_stats *stats);
+
+/**
+ * 销毁帧环。调用前需停止消费者线程，且生产者不再调用 reserve/commit/flush、不再写入数据区
+ * （这些每帧调用不加全局锁，不持有帧环的引用）
+ */
+void rtmp_ring_destroy(rtmp_ring_t ring);
+
+/**
+ * 创建音视频时钟：音频时间戳由累计采样数推算，视频采集时间逐步校正到同一条时间线，
+ * 两条轨道的输出各自严格递增。音频与视频可在不同线程调用
+ * @param sample_rate 音频采样率
+ * @return 时钟句柄，失败返回 0
+ */
+rtmp_clock_t rtmp_clock_create(int sample_rate);
+
+/**
+ * 计算音频帧时间戳
+ * @param capture_us 采集时间（单调时钟微秒，如 MediaCodec 的 presentationTimeUs），只用于测量漂移与检测中断
+ * @param samples 本帧采样数（AAC 为 1024，Opus 20ms 为 960）
+ * @return 时间戳（毫秒，可直接传给 rtmp_send_audio / rtmp_ring_commit），失败返回负数
+ */
+long rtmp_clock_audio(rtmp_clock_t clock, long capture_us, int samples);
+
+/**
+ * 计算视频帧时间戳
+ * @param capture_us 采集时间（与音频相同的单调时钟，微秒）
+ * @return 时间戳（毫秒），失败返回负数
+ */
+long rtmp_clock_video(rtmp_clock_t clock, long capture_us);
+
+/**
+ * 获取时钟统计（漂移、校正量与单调性修正次数）
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_clock_get_stats(rtmp_clock_t clock, rtmp_clock_stats *stats);
+
+/**
+ * 销毁时钟
+ */
+void rtmp_clock_destroy(rtmp_clock_t clock);
+
+/**
+ * 创建事件驱动推流引擎：少量 epoll 线程以非阻塞 socket 驱动大量推流会话（握手、命令、发送队列、
+ * ping 与重连定时器都在引擎线程上完成），调用方线程只负责封装 FLV tag 并入队。只支持明文 RTMP、H.264 + AAC
+ * @param config 配置，为 NULL 时全部取默认值
+ * @return 引擎句柄，失败返回 0
+ */
+rtmp_engine_t rtmp_engine_create(const rtmp_engine_config *config);
+
+/**
+ * 在引擎中打开一个推流会话，立即返回，连接与 publish 在引擎线程上进行（主机名在调用线程解析一次，
+ * 重连复用解析结果）。推流成功前送入的帧在队列上限内排队，publish 成功后依次发出
+ * @param engine 引擎句柄
+ * @param url rtmp:// 推流地址
+ * @return 会话句柄，地址无效或解析失败返回 0
+ */
+rtmp_session_t rtmp_engine_open(rtmp_engine_t engine, const char *url);
+
+/**
+ * 设置会话的 onMetaData 信息与 AAC 参数；推流中调用时立即发送新的 onMetaData
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_engine_set_metadata(rtmp_session_t session, int width, int height, int video_bitrate, int fps,
+                             int audio_sample_rate, int audio_channels);
+
+/**
+ * 送入一帧 H.264 Annex-B 视频（关键帧须携带 SPS/PPS 或之前已送入过）。数据在调用期间被复制
+ * @return 已入队返回 0，丢帧返回 RTMP_ENGINE_DROPPED，参数或句柄无效返回 -1
+ */
+int rtmp_engine_send_video(rtmp_session_t session, const unsigned char *data, int size, long timestamp, int is_key_frame);
+
+/**
+ * 送入一帧 AAC 音频（可带 ADTS 头）。数据在调用期间被复制
+ * @return 已入队返回 0，丢帧返回 RTMP_ENGINE_DROPPED，参数或句柄无效返回 -1
+ */
+int rtmp_engine_send_audio(rtmp_session_t session, const unsigned char *data, int size, long timestamp);
+
+/**
+ * 获取推流会话统计
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_engine_get_session_stats(rtmp_session_t session, rtmp_engine_session_stats *stats);
+
+/**
+ * 获取引擎统计
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_engine_get_stats(rtmp_engine_t engine, rtmp_engine_stats *stats);
+
+/**
+ * 关闭推流会话：推流中时先写完已入队的帧并发送 FCUnpublish/deleteStream，最多等待 timeout_ms
+ * @param session 会话句柄
+ * @param timeout_ms 等待排队数据写完的毫秒数
+ */
+void rtmp_engine_close(rtmp_session_t session, int timeout_ms);
+
+/**
+ * 销毁引擎：关闭其中全部会话（每个最多等待 1 秒，并行进行）并停止 epoll 线程
+ */
+void rtmp_engine_destroy(rtmp_engine_t engine);
+
 /**
  * 获取网络统计信息
  * @param handle 连接句柄
@@ -64,6 +832,50 @@ int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long ti
  */
 int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats);
 
+/**
+ * 获取扩展统计信息快照：不获取发送锁，计数器逐个以 relaxed 方式读取，
+ * 同一快照内的各字段之间可能相差正在发送的一两条消息
+ * @param handle 连接句柄
+ * @param stats 输出统计信息；调用前需将 struct_size 设为 sizeof(rtmp_stats_v2)
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_stats_v2(rtmp_handle_t handle, rtmp_stats_v2 *stats);
+
+/**
+ * 按直方图估算分位数
+ * @param histogram 直方图
+ * @param percentile 分位（0~100，如 99 表示 p99）
+ * @return 所在桶的上界（微秒，不超过 max_us），无样本时返回 0
+ */
+uint64_t rtmp_histogram_percentile(const rtmp_histogram *histogram, double percentile);
+
+/**
+ * 开启或关闭异步日志（全局）。开启后 native 与 librtmp 日志只在调用线程拷贝参数，
+ * 由后台线程格式化后写入 logcat；关闭时先输出缓冲区中剩余的日志
+ * @param enable 非 0 开启，0 关闭
+ * @return 成功返回 0
+ */
+int rtmp_log_set_async(int enable);
+
+/**
+ * 等待异步日志缓冲区中已写入的日志全部输出（最多约 1 秒），同步模式下立即返回
+ */
+void rtmp_log_flush(void);
+
+/**
+ * 开启或关闭逐帧发送流水线追踪（全局，对所有连接生效）
+ * @param enable 非 0 开启，0 关闭
+ * @return 成功返回 0，未以 BB_RTMP_TRACE 编译时返回负数
+ */
+int rtmp_trace_enable(int enable);
+
+/**
+ * 将追踪环形缓冲区中的事件导出为 Chrome trace-event JSON（chrome://tracing 或 Perfetto 打开）
+ * @param path 输出文件路径
+ * @return 成功返回导出的事件数，失败返回负数
+ */
+int rtmp_trace_dump(const char *path);
+
 /**
  * 关闭 RTMP 连接
  * @param handle 连接句柄
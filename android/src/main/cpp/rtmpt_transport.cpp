@@ -0,0 +1,473 @@
+#include "rtmpt_transport.h"
+#include "bb_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define TAG "RtmptTransport"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // Apple 平台以 SO_NOSIGPIPE 代替
+#endif
+
+static const size_t kMaxPendingBytes = 4 * 1024 * 1024;  // 待发数据上限，超过时 submit 阻塞
+static const size_t kFlushBytes = 256 * 1024;            // 待发数据达到该值时不再等待合并窗口
+static const int kMaxInflight = 8;                       // 流水线中未收到应答的请求数上限
+static const int64_t kIdleIntervalUs = 500000;           // 空闲时 /idle 轮询的间隔
+static const size_t kReceiveBuffer = 64 * 1024;
+static const size_t kMaxHeaderBytes = 8 * 1024;
+static const uint8_t kIdleBody[1] = {0};                 // 与 librtmp 相同：/idle 携带 1 字节负载
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+// 在 HTTP 头（不含结尾空行之后的内容）中查找 Content-Length
+static bool parse_content_length(const char *header, size_t len, uint32_t *out) {
+    const char *p = header;
+    const char *end = header + len;
+    while (p < end) {
+        const char *line_end = static_cast<const char *>(memchr(p, '\n', (size_t) (end - p)));
+        if (line_end == nullptr) line_end = end;
+        if (line_end - p > 15 && strncasecmp(p, "content-length:", 15) == 0) {
+            unsigned long value = 0;
+            const char *q = p + 15;
+            while (q < line_end && *q == ' ') q++;
+            if (q == line_end || *q < '0' || *q > '9') return false;
+            while (q < line_end && *q >= '0' && *q <= '9') {
+                value = value * 10 + (unsigned long) (*q - '0');
+                if (value > RtmpChunkReader::kMaxMessageSize) return false;
+                q++;
+            }
+            *out = (uint32_t) value;
+            return true;
+        }
+        p = line_end + 1;
+    }
+    return false;
+}
+
+std::shared_ptr<RtmptTransport> RtmptTransport::attach(RTMP *r, int64_t window_us) {
+    if (!(r->Link.protocol & RTMP_FEATURE_HTTP) || r->m_clientID.av_val == nullptr) return nullptr;
+    // RTMPE 的 RC4 与 librtmp 内置 TLS 都在 librtmp 的写路径上，直接写 socket 会绕过
+    if ((r->Link.protocol & RTMP_FEATURE_ENC) || r->m_sb.sb_ssl != nullptr) return nullptr;
+    std::shared_ptr<RtmptTransport> t(new RtmptTransport(RTMP_Socket(r), window_us));
+    t->host_.assign(r->Link.hostname.av_val, (size_t) r->Link.hostname.av_len);
+    t->host_ += ":" + std::to_string(r->Link.port);
+    t->client_id_.assign(r->m_clientID.av_val, (size_t) r->m_clientID.av_len);
+    t->seq_ = r->m_msgCounter;
+    t->inflight_ = r->m_unackd;
+    t->out_chunk_size_ = r->m_outChunkSize;
+
+    // librtmp 已读入缓冲区的应答字节与当前应答剩余的负载长度（轮询字节已被 HTTP_read 取走）
+    if (r->m_sb.sb_size > 0) {
+        size_t n = std::min((size_t) r->m_sb.sb_size, t->rx_.size());
+        memcpy(t->rx_.data(), r->m_sb.sb_start, n);
+        t->rx_len_ = n;
+    }
+    if (r->m_resplen > 0) {
+        t->in_body_ = true;
+        t->body_left_ = (uint32_t) r->m_resplen;
+    }
+    t->reader_.set_chunk_size((uint32_t) r->m_inChunkSize);
+    for (int i = 0; i < r->m_channelsAllocatedIn; ++i) {
+        const RTMPPacket *p = r->m_vecChannelsIn[i];
+        if (p != nullptr) {
+            t->reader_.prime(i, p->m_packetType, (uint32_t) p->m_nInfoField2, p->m_nBodySize,
+                             (uint32_t) r->m_channelTimestamp[i]);
+        }
+    }
+    t->bytes_in_ = (uint32_t) r->m_nBytesIn;
+    t->bytes_acked_ = (uint32_t) r->m_nBytesInSent;
+    if (r->m_nServerBW > 0) t->window_ack_size_ = (uint32_t) r->m_nServerBW;
+    r->m_resplen = 0;
+    r->m_sb.sb_size = 0;
+    r->m_sb.sb_start = r->m_sb.sb_buf;
+
+    t->last_request_us_ = now_us();
+    t->sender_ = std::thread(&RtmptTransport::send_loop, t.get());
+    t->receiver_ = std::thread(&RtmptTransport::receive_loop, t.get());
+    LOGD("接管 RTMPT 隧道: client=%s, seq=%d, inflight=%d, window=%lldus", t->client_id_.c_str(), t->seq_,
+         t->inflight_, (long long) window_us);
+    return t;
+}
+
+RtmptTransport::RtmptTransport(int fd, int64_t window_us)
+        : fd_(fd), window_us_(window_us), rx_(kReceiveBuffer),
+          reader_([this](const RtmpMessage &message) { on_message(message); }) {
+}
+
+RtmptTransport::~RtmptTransport() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    send_cv_.notify_all();
+    if (sender_.joinable()) sender_.join();
+    stop_receive_ = true;
+    if (receiver_.joinable()) receiver_.join();
+}
+
+void RtmptTransport::append_locked(const RTMPPacket *packet, int chunk_size) {
+    rtmp_write_chunks(packet, chunk_size, [&](const uint8_t *data, size_t len) {
+        pending_.insert(pending_.end(), data, data + len);
+    });
+    if (pending_messages_++ == 0) first_pending_us_ = now_us();
+    size_t channel = (size_t) packet->m_nChannel;
+    if (channel >= channels_used_.size()) channels_used_.resize(channel + 1, false);
+    channels_used_[channel] = true;
+    messages_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RtmptTransport::fail_locked(const char *reason) {
+    if (!failed_.exchange(true)) LOGE("RTMPT 隧道失败: %s", reason);
+    send_cv_.notify_all();
+    done_cv_.notify_all();
+}
+
+bool RtmptTransport::submit(const RTMPPacket *packet, int chunk_size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!failed_ && pending_.size() >= kMaxPendingBytes) {
+        send_cv_.notify_one();
+        done_cv_.wait(lock);
+    }
+    if (failed_) return false;
+    size_t before = pending_.size();
+    append_locked(packet, chunk_size);
+    // 只在发送线程可能在等待时唤醒：第一条待发消息（窗口从此计时）与待发字节越过上限的那一次；
+    // 发送线程写 POST 期间到达的消息由它写完后自行取走，逐条唤醒只会多出 futex 调用
+    if (pending_messages_ == 1 || (before < kFlushBytes && pending_.size() >= kFlushBytes)) send_cv_.notify_one();
+    return true;
+}
+
+void RtmptTransport::submit_control(uint8_t type, const uint8_t *body, uint32_t size) {
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_packetType = type;
+    packet.m_nChannel = 0x02;
+    packet.m_body = reinterpret_cast<char *>(const_cast<uint8_t *>(body));
+    packet.m_nBodySize = size;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_ || stopping_) return;
+    append_locked(&packet, out_chunk_size_);
+    send_cv_.notify_one();
+}
+
+int RtmptTransport::flush(int64_t timeout_us) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_requested_ = true;
+    send_cv_.notify_one();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(std::max<int64_t>(timeout_us, 0));
+    while (!failed_ && (!pending_.empty() || posting_active_)) {
+        if (done_cv_.wait_until(lock, deadline) == std::cv_status::timeout) break;
+    }
+    if (failed_) return -1;
+    return pending_.empty() && !posting_active_ ? 0 : RTMP_SEND_WOULD_BLOCK;
+}
+
+bool RtmptTransport::detach(RTMP *r, int64_t timeout_us) {
+    bool clean;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+        send_cv_.notify_one();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(std::max<int64_t>(timeout_us, 0));
+        while (!failed_ && (!pending_.empty() || posting_active_ || inflight_ > 0)) {
+            if (done_cv_.wait_until(lock, deadline) == std::cv_status::timeout) break;
+        }
+        clean = !failed_ && pending_.empty() && !posting_active_ && inflight_ == 0;
+        if (!clean) {
+            LOGE("交还 RTMPT 隧道时仍有 %zu 字节待发、%d 个请求未应答", pending_.size(), inflight_);
+        }
+        stopping_ = true;
+    }
+    send_cv_.notify_all();
+    if (sender_.joinable()) sender_.join();
+    stop_receive_ = true;
+    if (receiver_.joinable()) receiver_.join();
+
+    // 之后 librtmp 只写不读（FCUnpublish、/close），未读的应答字节直接丢弃
+    r->m_msgCounter = seq_;
+    r->m_unackd = inflight_;
+    r->m_resplen = 0;
+    r->m_sb.sb_size = 0;
+    r->m_sb.sb_start = r->m_sb.sb_buf;
+    r->m_nBytesIn = (int) bytes_in_;
+    r->m_nBytesInSent = (int) bytes_acked_;
+    // 服务端看到的这些通道的最近一个头来自本模块：librtmp 不能再据旧记录压缩头
+    for (size_t channel = 0; channel < channels_used_.size(); ++channel) {
+        if (!channels_used_[channel] || (int) channel >= r->m_channelsAllocatedOut) continue;
+        free(r->m_vecChannelsOut[channel]);
+        r->m_vecChannelsOut[channel] = nullptr;
+    }
+    return clean;
+}
+
+void RtmptTransport::snapshot(rtmp_rtmpt_stats *out) const {
+    out->posts = posts_.load(std::memory_order_relaxed);
+    out->idle_polls = idle_polls_.load(std::memory_order_relaxed);
+    out->messages = messages_.load(std::memory_order_relaxed);
+    out->bytes = bytes_.load(std::memory_order_relaxed);
+    out->responses = responses_.load(std::memory_order_relaxed);
+    out->received_bytes = received_bytes_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out->inflight = inflight_;
+    }
+    out->max_inflight = max_inflight_.load(std::memory_order_relaxed);
+    out->max_post_bytes = max_post_bytes_.load(std::memory_order_relaxed);
+}
+
+void RtmptTransport::send_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!failed_) {
+        int64_t now = now_us();
+        const char *command = "send";
+        if (pending_.empty()) {
+            flush_requested_ = false;
+            if (stopping_) break;
+            if (inflight_ > 0 || now - last_request_us_ < kIdleIntervalUs) {
+                int64_t wake = inflight_ > 0 ? now + kIdleIntervalUs : last_request_us_ + kIdleIntervalUs;
+                send_cv_.wait_for(lock, std::chrono::microseconds(wake - now));
+                continue;
+            }
+            // 空闲：轮询取回服务端下发的数据（ping、onStatus 等），同时保持隧道会话
+            command = "idle";
+        } else {
+            bool urgent = stopping_ || flush_requested_ || pending_.size() >= kFlushBytes;
+            int64_t deadline = first_pending_us_ + window_us_;
+            if (!urgent && now < deadline) {
+                send_cv_.wait_for(lock, std::chrono::microseconds(deadline - now));
+                continue;
+            }
+            if (inflight_ >= kMaxInflight) {
+                if (stopping_) break;
+                send_cv_.wait(lock);
+                continue;
+            }
+            posting_.swap(pending_);
+            pending_messages_ = 0;
+        }
+        int seq = seq_++;
+        inflight_++;
+        if (inflight_ > max_inflight_.load(std::memory_order_relaxed)) {
+            max_inflight_.store(inflight_, std::memory_order_relaxed);
+        }
+        last_request_us_ = now;
+        posting_active_ = true;
+        lock.unlock();
+        bool idle = command[0] == 'i';
+        size_t size = idle ? sizeof(kIdleBody) : posting_.size();
+        bool ok = post(command, seq, idle ? kIdleBody : posting_.data(), size);
+        posting_.clear();  // 保留容量，下一次与 pending_ 交换后复用
+        lock.lock();
+        posting_active_ = false;
+        if (!ok) {
+            fail_locked("POST 写失败");
+            break;
+        }
+        if (idle) {
+            idle_polls_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            posts_.fetch_add(1, std::memory_order_relaxed);
+            bytes_.fetch_add(size, std::memory_order_relaxed);
+            if ((int64_t) size > max_post_bytes_.load(std::memory_order_relaxed)) {
+                max_post_bytes_.store((int64_t) size, std::memory_order_relaxed);
+            }
+        }
+        done_cv_.notify_all();
+    }
+    posting_active_ = false;
+    done_cv_.notify_all();
+}
+
+bool RtmptTransport::post(const char *command, int seq, const uint8_t *data, size_t size) {
+    // 与 librtmp 的 HTTP_Post 相同的请求头
+    char header[512];
+    int n = snprintf(header, sizeof(header),
+                     "POST /%s%s/%d HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "Accept: */*\r\n"
+                     "User-Agent: Shockwave Flash\r\n"
+                     "Connection: Keep-Alive\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Content-type: application/x-fcs\r\n"
+                     "Content-length: %zu\r\n\r\n",
+                     command, client_id_.c_str(), seq, host_.c_str(), size);
+    if (n <= 0 || (size_t) n >= sizeof(header)) return false;
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = (size_t) n;
+    iov[1].iov_base = const_cast<uint8_t *>(data);
+    iov[1].iov_len = size;
+    size_t index = 0;
+    while (index < 2) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[index];
+        msg.msg_iovlen = 2 - index;
+        ssize_t written = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            LOGE("POST /%s 写失败: %s", command, strerror(errno));
+            return false;
+        }
+        size_t left = (size_t) written;
+        while (index < 2 && left >= iov[index].iov_len) {
+            left -= iov[index].iov_len;
+            index++;
+        }
+        if (index < 2) {
+            iov[index].iov_base = static_cast<uint8_t *>(iov[index].iov_base) + left;
+            iov[index].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+void RtmptTransport::receive_loop() {
+    const char *error = parse_responses() ? nullptr : "无效的 HTTP 应答";
+    while (error == nullptr && !stop_receive_) {
+        struct pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, 100);
+        if (ready < 0 && errno != EINTR) {
+            error = "poll 失败";
+            break;
+        }
+        if (ready <= 0) continue;
+        ssize_t n = recv(fd_, rx_.data() + rx_len_, rx_.size() - rx_len_, MSG_DONTWAIT);
+        if (n == 0) {
+            error = "服务端关闭了连接";
+        } else if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) error = "接收失败";
+        } else {
+            rx_len_ += (size_t) n;
+            if (!parse_responses()) error = "无效的 HTTP 应答";
+        }
+    }
+    if (error != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fail_locked(error);
+    }
+}
+
+bool RtmptTransport::parse_responses() {
+    size_t pos = 0;
+    while (pos < rx_len_) {
+        const uint8_t *start = rx_.data() + pos;
+        size_t avail = rx_len_ - pos;
+        if (!in_body_) {
+            static const uint8_t kEnd[4] = {'\r', '\n', '\r', '\n'};
+            const uint8_t *end = std::search(start, start + avail, kEnd, kEnd + 4);
+            if (end == start + avail) {
+                if (avail >= kMaxHeaderBytes) return false;
+                break;
+            }
+            size_t header_len = (size_t) (end - start) + 4;
+            if (avail < 12 || memcmp(start, "HTTP/1.1 200", 12) != 0) {
+                LOGE("RTMPT 应答不是 200: %.*s", (int) std::min<size_t>(header_len, 32), (const char *) start);
+                return false;
+            }
+            uint32_t length = 0;
+            if (!parse_content_length((const char *) start, header_len, &length)) return false;
+            pos += header_len;
+            in_body_ = true;
+            polling_byte_ = true;
+            body_left_ = length;
+        } else {
+            if (polling_byte_ && body_left_ > 0) {
+                start++;
+                avail--;
+                pos++;
+                body_left_--;
+                polling_byte_ = false;
+            }
+            size_t n = std::min(avail, (size_t) body_left_);
+            if (n > 0) {
+                if (!reader_.feed(start, n)) {
+                    LOGE("服务端下发的 RTMP 数据解析失败");
+                    return false;
+                }
+                pos += n;
+                body_left_ -= (uint32_t) n;
+                bytes_in_ += n;
+                received_bytes_.fetch_add(n, std::memory_order_relaxed);
+                if (bytes_in_ - bytes_acked_ >= window_ack_size_ / 2) {
+                    uint8_t ack[4];
+                    write_be32(ack, (uint32_t) bytes_in_);
+                    submit_control(RTMP_PACKET_TYPE_BYTES_READ_REPORT, ack, 4);
+                    bytes_acked_ = bytes_in_;
+                }
+            }
+        }
+        if (in_body_ && body_left_ == 0) {
+            in_body_ = false;
+            polling_byte_ = false;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (inflight_ > 0) inflight_--;
+            responses_.fetch_add(1, std::memory_order_relaxed);
+            send_cv_.notify_one();
+            done_cv_.notify_all();
+        }
+    }
+    if (pos > 0) {
+        memmove(rx_.data(), rx_.data() + pos, rx_len_ - pos);
+        rx_len_ -= pos;
+    }
+    return true;
+}
+
+void RtmptTransport::on_message(const RtmpMessage &message) {
+    switch (message.type) {
+        case RTMP_PACKET_TYPE_CHUNK_SIZE:
+            if (message.size >= 4) reader_.set_chunk_size(read_be32(message.body) & 0x7fffffff);
+            break;
+        case RTMP_PACKET_TYPE_SERVER_BW:
+            if (message.size >= 4 && read_be32(message.body) > 0) window_ack_size_ = read_be32(message.body);
+            break;
+        case RTMP_PACKET_TYPE_CONTROL:
+            // Ping Request（事件 6）原样回 Ping Response（事件 7）
+            if (message.size >= 6 && message.body[0] == 0 && message.body[1] == 6) {
+                uint8_t pong[6] = {0, 7, message.body[2], message.body[3], message.body[4], message.body[5]};
+                submit_control(RTMP_PACKET_TYPE_CONTROL, pong, sizeof(pong));
+            }
+            break;
+        case RTMP_PACKET_TYPE_INVOKE: {
+            AVal name = {nullptr, 0};
+            if (message.size >= 3 && message.body[0] == AMF_STRING) {
+                AMF_DecodeString(reinterpret_cast<const char *>(message.body) + 1, &name);
+            }
+            if ((uint32_t) name.av_len + 3 <= message.size) {
+                LOGD("服务端命令: %.*s", name.av_len, name.av_val != nullptr ? name.av_val : "");
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef RTMPT_TRANSPORT_H
+#define RTMPT_TRANSPORT_H
+
+#include "rtmp_chunk.h"
+#include "rtmp_wrapper.h"
+#include "librtmp/rtmp.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * 批量 RTMPT（HTTP 隧道）发送（rtmp_set_rtmpt_batch 开启）。
+ *
+ * librtmp 的 RTMPT 发送路径：RTMP_SendPacket 对每条多 chunk 消息 malloc 一块 tbuf 拼接全部 chunk，WriteN 为每条
+ * 消息发一个 POST /send（两次 send：HTTP 头与负载），应答从不读取（只在 ReadN 中顺带解析，推流时堆积在接收缓冲区），
+ * 读取时又以 /idle 轮询。本模块在 publish 之后从 librtmp 接管隧道：
+ *   - 消息按 chunk 序列化进连接的待发缓冲区（两块缓冲区交替使用，容量复用，不再逐条分配）；
+ *   - 发送线程在第一条待发消息到达后等待合并窗口（或待发字节达到上限），把窗口内的全部消息合并为一个
+ *     POST /send，HTTP 头与负载一次 sendmsg 写出；
+ *   - 不等待应答即发出后续请求（流水线，在途请求数有上限），接收线程解析应答并释放在途计数，应答中服务端下发的
+ *     RTMP 数据以 RtmpChunkReader 解析：跟随 Set Chunk Size、应答 ping、按窗口发送 Acknowledgement；
+ *   - 同一条 keep-alive 连接承载全部请求，空闲（无在途请求）超过轮询间隔才发 /idle 取回服务端数据。
+ * 关闭或停用时写完待发数据、等待在途应答，再把请求序号等隧道状态交还 librtmp（RTMP_Close 随后发出
+ * FCUnpublish 与 /close）。接管期间 librtmp 不再读写该连接。
+ */
+class RtmptTransport {
+public:
+    /**
+     * 从 librtmp 接管 RTMPT 连接（须已 publish，调用期间不能有其他线程使用 r）
+     * @param window_us 合并窗口，0 表示不等待，只合并写上一个 POST 期间积累的消息
+     * @return 非 RTMPT 连接（或 RTMPE 加密的隧道）返回空
+     */
+    static std::shared_ptr<RtmptTransport> attach(RTMP *r, int64_t window_us);
+
+    ~RtmptTransport();
+
+    /**
+     * 序列化一条消息并加入待发缓冲区。待发数据超过上限时阻塞到发送线程写出（与阻塞发送的语义相同）
+     * @return 隧道已失败返回 false
+     */
+    bool submit(const RTMPPacket *packet, int chunk_size);
+
+    /**
+     * 立即发出待发数据并等待写入 socket，最多 timeout_us
+     * @return 0、RTMP_SEND_WOULD_BLOCK（超时）或 -1（隧道已失败）
+     */
+    int flush(int64_t timeout_us);
+
+    /**
+     * 写完待发数据、等待在途应答（最多 timeout_us）后停止线程，把隧道状态写回 r，并清除 librtmp 中被本模块
+     * 发送过的通道的头压缩记录（之后 librtmp 发往这些通道的消息以完整头开始）
+     * @return 全部写完且应答到齐返回 true
+     */
+    bool detach(RTMP *r, int64_t timeout_us);
+
+    void snapshot(rtmp_rtmpt_stats *out) const;
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+
+    RtmptTransport(const RtmptTransport &) = delete;
+    RtmptTransport &operator=(const RtmptTransport &) = delete;
+
+private:
+    RtmptTransport(int fd, int64_t window_us);
+
+    // 以下在 mutex_ 内调用
+    void append_locked(const RTMPPacket *packet, int chunk_size);
+    void fail_locked(const char *reason);
+
+    void send_loop();
+    void receive_loop();
+    // 写出一个 POST（HTTP 头 + 负载），只在发送线程上调用
+    bool post(const char *command, int seq, const uint8_t *data, size_t size);
+    // 解析 rx_ 中的应答，返回 false 表示协议错误
+    bool parse_responses();
+    void on_message(const RtmpMessage &message);
+    void submit_control(uint8_t type, const uint8_t *body, uint32_t size);
+
+    const int fd_;
+    const int64_t window_us_;
+    std::string host_;                 // Host 头
+    std::string client_id_;            // open 应答给出的会话 id（含前导 '/'）
+    int out_chunk_size_ = RTMP_DEFAULT_CHUNKSIZE;  // 控制消息的分块大小
+
+    mutable std::mutex mutex_;
+    std::condition_variable send_cv_;  // 唤醒发送线程：新消息、应答释放在途名额、flush、停止
+    std::condition_variable done_cv_;  // 通知等待方：POST 写完、应答到达、失败
+    std::vector<uint8_t> pending_;     // 待发的 chunk 流
+    std::vector<uint8_t> posting_;     // 发送线程正在写出的缓冲区（与 pending_ 交换）
+    uint32_t pending_messages_ = 0;
+    int64_t first_pending_us_ = 0;
+    bool posting_active_ = false;
+    bool flush_requested_ = false;
+    bool stopping_ = false;
+    int seq_ = 0;                      // 下一个请求的序号（librtmp 的 m_msgCounter）
+    int inflight_ = 0;                 // 已发出、尚未收到应答的请求数
+    int64_t last_request_us_ = 0;
+    std::vector<bool> channels_used_;  // 本模块发送过消息的 chunk stream
+    std::atomic<bool> failed_{false};
+
+    // 以下只在接收线程上访问（接管前与停止后由调用方线程访问）
+    std::atomic<bool> stop_receive_{false};
+    std::vector<uint8_t> rx_;          // 接收缓冲区（固定大小）
+    size_t rx_len_ = 0;                // rx_ 中已收到未解析的应答字节数
+    bool in_body_ = false;             // 正在读应答负载
+    bool polling_byte_ = false;        // 负载首字节（轮询间隔提示）尚未读取
+    uint32_t body_left_ = 0;
+    RtmpChunkReader reader_;
+    uint64_t bytes_in_ = 0;            // 收到的 RTMP 字节数（librtmp 的 m_nBytesIn）
+    uint64_t bytes_acked_ = 0;
+    uint32_t window_ack_size_ = 2500000;
+
+    std::atomic<uint64_t> posts_{0};
+    std::atomic<uint64_t> idle_polls_{0};
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> responses_{0};
+    std::atomic<uint64_t> received_bytes_{0};
+    std::atomic<int> max_inflight_{0};
+    std::atomic<int64_t> max_post_bytes_{0};
+
+    std::thread sender_;
+    std::thread receiver_;
+};
+
+#endif // RTMPT_TRANSPORT_H
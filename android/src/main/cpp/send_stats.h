@@ -0,0 +1,96 @@
+#ifndef BB_RTMP_SEND_STATS_H
+#define BB_RTMP_SEND_STATS_H
+
+/*
+ * 每个连接的发送统计：只由持有 wrapper 锁的发送线程写入（单写者，更新为 relaxed load + store），
+ * 读取方通过 shared_ptr 持有对象，无需获取 wrapper 锁即可随时快照。
+ * io_uring 后端下 on_packet_sent 改由引擎线程在消息写完时调用；发送线程只在队列写完（drain）之后才经 librtmp
+ * 发送，两者不会同时写入同一组计数器。
+ * MSG_ZEROCOPY 的完成计数（on_zerocopy_completed）由读取错误队列的线程在 ZeroCopySender 的锁内写入。
+ */
+
+#include "rtmp_wrapper.h"
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+    static const int kBuckets = RTMP_HISTOGRAM_BUCKETS;
+    static const int kSubBucketBits = 2;
+
+    LatencyHistogram();
+
+    // 值（微秒）所在的桶：0~3 直接映射，之后每个 2 的幂区间分 4 个子桶
+    static int bucket_index(uint64_t value_us);
+    // 桶覆盖的最大值（含）
+    static uint64_t bucket_upper(int index);
+
+    void record(int64_t value_us);
+    void snapshot(rtmp_histogram *out) const;
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+enum SendStatsMedia {
+    SEND_STATS_VIDEO = 0,
+    SEND_STATS_AUDIO = 1,
+    SEND_STATS_DATA = 2,
+};
+
+struct SendStats {
+    std::atomic<uint64_t> bytes[3];
+    std::atomic<uint64_t> messages[3];
+    std::atomic<uint64_t> chunks{0};
+    std::atomic<uint64_t> send_syscalls{0};
+    std::atomic<uint64_t> send_failures{0};
+    std::atomic<uint64_t> dropped_video_frames{0};
+    std::atomic<int64_t> queue_depth{-1};
+    std::atomic<int64_t> max_queue_depth{0};
+    std::atomic<int64_t> last_video_entry_us{0};
+
+    LatencyHistogram enqueue_to_wire;
+    LatencyHistogram send_duration;
+    LatencyHistogram video_frame_gap;
+
+    std::atomic<uint64_t> zerocopy_messages{0};
+    std::atomic<uint64_t> zerocopy_bytes{0};
+    std::atomic<uint64_t> copy_avoided_bytes{0};
+    std::atomic<uint64_t> zerocopy_copied_bytes{0};
+    LatencyHistogram zerocopy_completion;
+
+    std::atomic<uint64_t> would_block_frames{0};
+    std::atomic<uint64_t> partial_messages{0};
+    std::atomic<uint64_t> resumed_bytes{0};
+
+    SendStats();
+
+    // 一次 RTMP_SendPacket 完成后调用；syscalls 为负时按 chunk 数计（librtmp 每个 chunk 一次 send）
+    void on_packet_sent(SendStatsMedia media, uint32_t body_size, int chunk_size, bool ok,
+                        int64_t enqueue_us, int64_t start_us, int64_t end_us, int syscalls = -1);
+    // 一条消息以 MSG_ZEROCOPY 写出（wire_bytes 为零拷贝 sendmsg 写出的字节数）
+    void on_zerocopy_sent(uint64_t wire_bytes);
+    // 该消息的完成通知全部到达；copied 为内核回退为拷贝，latency_us 为缓冲区被固定的时长
+    void on_zerocopy_completed(uint64_t wire_bytes, bool copied, int64_t latency_us);
+    // 限时非阻塞发送：续写未完成而拒绝一条消息 / 消息写到期限留下剩余部分 / 续写出 bytes 字节
+    void on_would_block();
+    void on_partial_message();
+    void on_resumed(uint64_t bytes);
+    // 视频帧进入发送接口时调用，记录帧间隔
+    void on_video_entry(int64_t now_us);
+    // 等待关键帧期间丢弃一个视频帧
+    void on_video_dropped();
+    // 采样内核发送队列深度（Linux/Android 为 SIOCOUTQ，Apple 平台为 SO_NWRITE）
+    void sample_queue_depth(int fd);
+
+    // 按调用方的 struct_size 填充，返回 0；struct_size 小于 v2 首个版本的头部时返回 -1
+    int snapshot(rtmp_stats_v2 *out) const;
+};
+
+// 单调时钟（微秒）
+int64_t send_stats_now_us();
+
+#endif // BB_RTMP_SEND_STATS_H
@@ -0,0 +1,114 @@
+#include "tcp_fast_open.h"
+#include "bb_log.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TAG "TcpFastOpen"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+#if defined(__linux__) && defined(TCP_FASTOPEN_CONNECT)
+
+bool fast_open_supported() {
+    return true;
+}
+
+// 与 RTMP_Connect0 相同：阻塞模式、接收超时与 TCP_NODELAY
+static void finish_socket(int fd, int flags, int timeout_s) {
+    fcntl(fd, F_SETFL, flags);
+    struct timeval tv;
+    tv.tv_sec = timeout_s;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+int fast_open_connect(const struct sockaddr_in *service, int timeout_s, int *fd) {
+    *fd = -1;
+    int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0) {
+        LOGE("创建 socket 失败: %s", strerror(errno));
+        return FAST_OPEN_FAILED;
+    }
+    int on = 1;
+    if (setsockopt(s, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) != 0) {
+        LOGD("内核不支持 TCP_FASTOPEN_CONNECT: %s", strerror(errno));
+        close(s);
+        return FAST_OPEN_UNSUPPORTED;
+    }
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) flags = 0;
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+
+    // 有 cookie 时 connect 不发 SYN 直接返回 0（推迟到第一次 send）；否则照常发起三次握手
+    if (connect(s, (const struct sockaddr *) service, sizeof(*service)) == 0) {
+        finish_socket(s, flags, timeout_s);
+        struct timeval tv;
+        tv.tv_sec = timeout_s;
+        tv.tv_usec = 0;
+        setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        *fd = s;
+        return FAST_OPEN_DEFERRED;
+    }
+    if (errno != EINPROGRESS && errno != EAGAIN) {
+        LOGE("connect 失败: %s", strerror(errno));
+        close(s);
+        return FAST_OPEN_FAILED;
+    }
+    struct pollfd pfd;
+    pfd.fd = s;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeout_s * 1000);
+    } while (ready < 0 && errno == EINTR);
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ready <= 0) {
+        LOGE("connect 超时（%d 秒）", timeout_s);
+        close(s);
+        return FAST_OPEN_FAILED;
+    }
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+        LOGE("connect 失败: %s", strerror(err));
+        close(s);
+        return FAST_OPEN_FAILED;
+    }
+    finish_socket(s, flags, timeout_s);
+    *fd = s;
+    return FAST_OPEN_CONNECTED;
+}
+
+bool tcp_connect_info(int fd, TcpConnectInfo *info) {
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+    memset(&ti, 0, sizeof(ti));
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) != 0) return false;
+    info->syn_data_acked = (ti.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+    info->rtt_us = ti.tcpi_rtt;
+    return true;
+}
+
+#else
+
+bool fast_open_supported() {
+    return false;
+}
+
+int fast_open_connect(const struct sockaddr_in *, int, int *fd) {
+    *fd = -1;
+    return FAST_OPEN_UNSUPPORTED;
+}
+
+bool tcp_connect_info(int, TcpConnectInfo *) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TCP_FAST_OPEN_H
+#define TCP_FAST_OPEN_H
+
+#include <cstdint>
+#include <netinet/in.h>
+
+/*
+ * TCP Fast Open 客户端（Linux 4.11+ 的 TCP_FASTOPEN_CONNECT）。
+ *
+ * RTMP_Connect0 先以 connect + select 完成三次握手，HandShake 再写出 C0+C1（1537 字节），高 RTT 的移动网络上
+ * 握手开始前就多等一个往返。开启 TCP_FASTOPEN_CONNECT 后：
+ *   - 内核缓存了该服务端的 cookie 时 connect 立即返回且不发 SYN，librtmp 第一次 send（C0+C1）的数据随 SYN
+ *     发出，服务端接受 cookie 时握手数据与 SYN-ACK 同一个往返到达；
+ *   - 没有 cookie 时照常三次握手，并在 SYN 中请求 cookie 供下一次连接使用；
+ *   - 服务端拒绝（cookie 失效、未开启 TFO、中间设备剥离 SYN 数据）时内核在握手完成后重传这部分数据，对 librtmp
+ *     透明。SYN 数据被丢弃导致连接失败的情况由调用方关闭 TFO 重连。
+ * 是否真正节省了往返由握手后 TCP_INFO 的 TCPI_OPT_SYN_DATA 判断。
+ */
+
+enum FastOpenConnect {
+    FAST_OPEN_UNSUPPORTED = -2,  // 非 Linux 或内核不支持 TCP_FASTOPEN_CONNECT，调用方改用普通 connect
+    FAST_OPEN_FAILED = -1,       // 连接失败或超时
+    FAST_OPEN_CONNECTED = 0,     // 已完成三次握手（没有 cookie，SYN 中已请求）
+    FAST_OPEN_DEFERRED = 1,      // 有缓存的 cookie：连接推迟到第一次发送，数据随 SYN 发出
+};
+
+// 是否以支持 TCP_FASTOPEN_CONNECT 的系统头文件编译（内核支持在连接时探测）
+bool fast_open_supported();
+
+/**
+ * 以 TCP_FASTOPEN_CONNECT 建立连接（非阻塞 connect + poll，与 RTMP_Connect0 相同的超时语义）。
+ * 推迟连接的 socket 同时设置 SO_SNDTIMEO，第一次 send 等待 SYN-ACK 的时间不超过 timeout_s
+ * @param fd 输出阻塞模式的 socket（已设置 SO_RCVTIMEO 与 TCP_NODELAY），失败时为 -1
+ * @return FastOpenConnect
+ */
+int fast_open_connect(const struct sockaddr_in *service, int timeout_s, int *fd);
+
+struct TcpConnectInfo {
+    bool syn_data_acked = false;  // SYN 携带的数据被服务端确认
+    int64_t rtt_us = 0;           // 平滑 RTT
+};
+
+// 读取已连接 socket 的 TCP_INFO，失败返回 false
+bool tcp_connect_info(int fd, TcpConnectInfo *info);
+
+#endif // TCP_FAST_OPEN_H
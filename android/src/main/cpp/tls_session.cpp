@@ -0,0 +1,315 @@
+#include "tls_session.h"
+
+#ifdef BB_RTMP_TLS
+
+#include "bb_log.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#define TAG "TlsSession"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+// 中继单次转发的上限，与 TLS 记录的最大明文长度一致
+static const size_t kRelayChunk = 16384;
+
+static void log_ssl_errors(const char *what) {
+    unsigned long err = ERR_get_error();
+    if (err == 0) {
+        LOGE("%s 失败: errno=%d (%s)", what, errno, strerror(errno));
+        return;
+    }
+    for (; err != 0; err = ERR_get_error()) {
+        char buf[256];
+        ERR_error_string_n(err, buf, sizeof(buf));
+        LOGE("%s 失败: %s", what, buf);
+    }
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool is_ip_address(const std::string &host) {
+    unsigned char buf[16];
+    return inet_pton(AF_INET, host.c_str(), buf) == 1 || inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+
+TlsSession *TlsSession::connect(int *fd, const std::string &hostname, const TlsConfig &config) {
+    TlsSession *session = new TlsSession();
+    session->ctx_ = SSL_CTX_new(TLS_client_method());
+    if (session->ctx_ == nullptr) {
+        log_ssl_errors("SSL_CTX_new");
+        delete session;
+        return nullptr;
+    }
+    SSL_CTX_set_min_proto_version(session->ctx_, TLS1_2_VERSION);
+    if (config.full_offload) SSL_CTX_set_max_proto_version(session->ctx_, TLS1_2_VERSION);
+    if (config.allow_ktls) SSL_CTX_set_options(session->ctx_, SSL_OP_ENABLE_KTLS);
+    // 中继线程以非阻塞方式读写，SSL_write 可能只写出部分数据
+    SSL_CTX_set_mode(session->ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (config.verify) {
+        SSL_CTX_set_verify(session->ctx_, SSL_VERIFY_PEER, nullptr);
+        int loaded = config.ca_file.empty()
+                     ? SSL_CTX_set_default_verify_paths(session->ctx_)
+                     : SSL_CTX_load_verify_locations(session->ctx_, config.ca_file.c_str(), nullptr);
+        if (loaded != 1) {
+            log_ssl_errors("加载 CA 证书");
+            delete session;
+            return nullptr;
+        }
+    }
+
+    // 持有 socket 的副本：内核模式下 RTMP_Close 关闭原 fd 后仍可经此发出 close_notify
+    session->fd_ = dup(*fd);
+    session->ssl_ = SSL_new(session->ctx_);
+    if (session->fd_ < 0 || session->ssl_ == nullptr || SSL_set_fd(session->ssl_, session->fd_) != 1) {
+        log_ssl_errors("创建 TLS 会话");
+        delete session;
+        return nullptr;
+    }
+    if (!is_ip_address(hostname)) SSL_set_tlsext_host_name(session->ssl_, hostname.c_str());
+    if (config.verify) {
+        X509_VERIFY_PARAM *param = SSL_get0_param(session->ssl_);
+        int ok = is_ip_address(hostname) ? X509_VERIFY_PARAM_set1_ip_asc(param, hostname.c_str())
+                                         : X509_VERIFY_PARAM_set1_host(param, hostname.c_str(), 0);
+        if (ok != 1) {
+            log_ssl_errors("设置证书校验主机名");
+            delete session;
+            return nullptr;
+        }
+    }
+
+    if (SSL_connect(session->ssl_) != 1) {
+        long verify = SSL_get_verify_result(session->ssl_);
+        if (verify != X509_V_OK) LOGE("证书校验失败: %s", X509_verify_cert_error_string(verify));
+        log_ssl_errors("TLS 握手");
+        delete session;
+        return nullptr;
+    }
+    session->ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(session->ssl_)) != 0;
+    session->ktls_recv_ = BIO_get_ktls_recv(SSL_get_rbio(session->ssl_)) != 0;
+
+    // 握手后 OpenSSL 已缓冲的记录只能由 SSL_read 取出，此时不能让 librtmp 直接读 socket
+    if (session->ktls_send_ && session->ktls_recv_ && SSL_version(session->ssl_) == TLS1_2_VERSION &&
+        !SSL_has_pending(session->ssl_)) {
+        session->mode_ = TLS_MODE_KERNEL;
+    } else {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            LOGE("socketpair 失败: %s", strerror(errno));
+            delete session;
+            return nullptr;
+        }
+        if (!set_nonblocking(pair[1]) || !set_nonblocking(session->fd_)) {
+            LOGE("设置非阻塞失败: %s", strerror(errno));
+            close(pair[0]);
+            close(pair[1]);
+            delete session;
+            return nullptr;
+        }
+        session->app_fd_ = pair[1];
+        session->mode_ = TLS_MODE_USERSPACE;
+        session->peer_fd_ = pair[0];
+        close(*fd);
+        *fd = pair[0];
+        session->relay_thread_ = std::thread(&TlsSession::relay, session);
+    }
+    LOGD("TLS 握手完成: %s %s, ktls_send=%d, ktls_recv=%d, mode=%s", session->version(), session->cipher(),
+         session->ktls_send_, session->ktls_recv_, session->mode_ == TLS_MODE_KERNEL ? "kernel" : "userspace");
+    return session;
+}
+
+TlsSession::~TlsSession() {
+    if (relay_thread_.joinable()) {
+        // 正常情况下 librtmp 一端已关闭，中继线程读到 EOF 后自行退出；这里再唤醒一次以防对端无响应
+        shutdown(app_fd_, SHUT_RDWR);
+        relay_thread_.join();
+    } else if (mode_ == TLS_MODE_KERNEL) {
+        SSL_shutdown(ssl_);
+    }
+    if (ssl_ != nullptr) SSL_free(ssl_);
+    if (ctx_ != nullptr) SSL_CTX_free(ctx_);
+    if (app_fd_ >= 0) close(app_fd_);
+    if (fd_ >= 0) close(fd_);
+}
+
+const char *TlsSession::version() const {
+    return ssl_ != nullptr ? SSL_get_version(ssl_) : "";
+}
+
+const char *TlsSession::cipher() const {
+    const char *name = ssl_ != nullptr ? SSL_get_cipher_name(ssl_) : nullptr;
+    return name != nullptr ? name : "";
+}
+
+/*
+ * socketpair <-> TLS 双向转发，单线程非阻塞（同一 SSL 对象不能并发读写）。
+ * 任一方向的待写缓冲区未清空前不再读取该方向，背压经 socket 缓冲区传回发送端。
+ */
+void TlsSession::relay() {
+    std::vector<char> up(kRelayChunk);    // librtmp -> 服务端
+    std::vector<char> down(kRelayChunk);  // 服务端 -> librtmp
+    size_t up_off = 0, up_len = 0;
+    size_t down_off = 0, down_len = 0;
+    bool app_eof = false;
+    bool tls_eof = false;
+    bool tls_want_write = false;
+
+    while (true) {
+        bool progress = false;
+        tls_want_write = false;
+
+        if (up_off == up_len && !app_eof) {
+            ssize_t n = recv(app_fd_, up.data(), up.size(), 0);
+            if (n > 0) {
+                up_off = 0;
+                up_len = (size_t) n;
+                progress = true;
+            } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                app_eof = true;
+            }
+        }
+        while (up_off < up_len) {
+            int n = SSL_write(ssl_, up.data() + up_off, (int) (up_len - up_off));
+            if (n > 0) {
+                up_off += n;
+                relay_out_.fetch_add(n, std::memory_order_relaxed);
+                progress = true;
+                continue;
+            }
+            int err = SSL_get_error(ssl_, n);
+            if (err == SSL_ERROR_WANT_WRITE) {
+                tls_want_write = true;
+            } else if (err != SSL_ERROR_WANT_READ) {
+                log_ssl_errors("SSL_write");
+                tls_eof = app_eof = true;
+                up_off = up_len;
+            }
+            break;
+        }
+
+        if (down_off == down_len && !tls_eof) {
+            int n = SSL_read(ssl_, down.data(), (int) down.size());
+            if (n > 0) {
+                down_off = 0;
+                down_len = (size_t) n;
+                relay_in_.fetch_add(n, std::memory_order_relaxed);
+                progress = true;
+            } else {
+                int err = SSL_get_error(ssl_, n);
+                if (err == SSL_ERROR_WANT_WRITE) {
+                    tls_want_write = true;
+                } else if (err != SSL_ERROR_WANT_READ) {
+                    if (err != SSL_ERROR_ZERO_RETURN) log_ssl_errors("SSL_read");
+                    tls_eof = true;
+                }
+            }
+        }
+        while (down_off < down_len) {
+            ssize_t n = send(app_fd_, down.data() + down_off, down_len - down_off, MSG_NOSIGNAL);
+            if (n > 0) {
+                down_off += n;
+                progress = true;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+            // librtmp 一端已关闭，丢弃服务端后续数据
+            down_off = down_len;
+            app_eof = true;
+        }
+
+        if (app_eof && up_off == up_len) {
+            SSL_shutdown(ssl_);
+            break;
+        }
+        if (tls_eof && down_off == down_len) {
+            // 通知 librtmp 连接已关闭（recv 返回 0）
+            shutdown(app_fd_, SHUT_WR);
+            if (app_eof) break;
+        }
+        if (progress) continue;
+        if (down_off == down_len && !tls_eof && SSL_has_pending(ssl_)) continue;
+
+        struct pollfd fds[2];
+        fds[0].fd = app_fd_;
+        fds[0].events = (short) (((up_off == up_len && !app_eof) ? POLLIN : 0) | (down_off < down_len ? POLLOUT : 0));
+        fds[1].fd = fd_;
+        fds[1].events = (short) ((!tls_eof ? POLLIN : 0) | (tls_want_write ? POLLOUT : 0));
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            LOGE("poll 失败: %s", strerror(errno));
+            break;
+        }
+        if (fds[0].revents & (POLLERR | POLLNVAL)) break;
+        // 服务端已关闭且 librtmp 一端只剩 HUP：无事可做
+        if (tls_eof && (fds[0].revents & POLLHUP)) break;
+    }
+    // 唤醒仍阻塞在 recv 的 librtmp
+    shutdown(app_fd_, SHUT_RDWR);
+}
+
+long TlsSession::send_file(int file_fd, off_t offset, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ossl_ssize_t n;
+        if (mode_ == TLS_MODE_KERNEL) {
+            n = SSL_sendfile(ssl_, file_fd, offset + (off_t) sent, size - sent, 0);
+        } else {
+            // 写入 librtmp 一端，由中继线程加密
+            off_t pos = offset + (off_t) sent;
+            n = sendfile(peer_fd_, file_fd, &pos, size - sent);
+        }
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            if (mode_ == TLS_MODE_KERNEL) log_ssl_errors("SSL_sendfile");
+            else if (n < 0) LOGE("sendfile 失败: %s", strerror(errno));
+            return sent > 0 ? (long) sent : -1;
+        }
+        sent += (size_t) n;
+    }
+    return (long) sent;
+}
+
+bool tls_available() {
+    return true;
+}
+
+#else // BB_RTMP_TLS
+
+TlsSession *TlsSession::connect(int *, const std::string &, const TlsConfig &) {
+    return nullptr;
+}
+
+TlsSession::~TlsSession() {}
+
+const char *TlsSession::version() const {
+    return "";
+}
+
+const char *TlsSession::cipher() const {
+    return "";
+}
+
+long TlsSession::send_file(int, off_t, size_t) {
+    return -1;
+}
+
+void TlsSession::relay() {}
+
+bool tls_available() {
+    return false;
+}
+
+#endif // BB_RTMP_TLS
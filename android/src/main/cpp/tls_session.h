@@ -0,0 +1,94 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+/*
+ * RTMPS 传输（以 BB_RTMP_TLS 编译，依赖 OpenSSL）。librtmp 以 NO_CRYPTO 预编译，只会对 sb_socket 做明文
+ * send/recv，因此在 RTMP_Connect0 建立 TCP 连接之后、RTMP 握手之前由本模块完成 TLS 握手：
+ *   - 内核 TLS：握手后 OpenSSL 通过 setsockopt(SOL_TLS) 把两个方向的会话密钥装入内核，librtmp 的明文
+ *     send/recv 直接由内核加解密，发送路径没有额外拷贝；sendfile 也可直接发送文件内容。
+ *   - 用户态 TLS：内核不支持（或只装入了发送方向）时，librtmp 改用 socketpair 的一端，由中继线程在
+ *     socketpair 与 TLS 连接之间转发（SSL_read/SSL_write）。若发送方向已装入内核，SSL_write 仍由内核加密。
+ * 两个方向都装入内核要求 TLS 1.2（OpenSSL 3.2 之前不支持 TLS 1.3 的接收方向卸载；TLS 1.3 连接建立后
+ * 服务端发送的 NewSessionTicket 也会使内核接收方向返回 EIO），可用 TlsConfig::full_offload 限制版本。
+ */
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+enum TlsMode {
+    TLS_MODE_NONE = 0,       // 明文 RTMP
+    TLS_MODE_KERNEL = 1,     // 收发均由内核 TLS 处理，librtmp 直接读写 TCP socket
+    TLS_MODE_USERSPACE = 2,  // 经中继线程的用户态 TLS
+};
+
+struct TlsConfig {
+    std::string ca_file;        // 为空时使用系统默认 CA 路径
+    bool verify = true;         // 校验证书链与主机名
+    bool allow_ktls = true;     // 关闭后强制用户态 TLS（用于对比测试）
+    bool full_offload = false;  // 限制为 TLS 1.2，使收发两个方向都可装入内核
+};
+
+class TlsSession {
+public:
+    /**
+     * 在已连接的阻塞 socket 上完成 TLS 握手（超时沿用 socket 的 SO_RCVTIMEO/SO_SNDTIMEO）
+     * @param fd 输入 TCP socket；用户态模式下输出替换为 socketpair 的一端，原 socket 归本对象所有
+     * @param hostname 用于 SNI 与证书校验（IP 地址按 IP SAN 校验）
+     * @return 失败返回 nullptr，fd 保持不变
+     */
+    static TlsSession *connect(int *fd, const std::string &hostname, const TlsConfig &config);
+
+    // 调用方须先关闭 librtmp 使用的 fd（RTMP_Close）：用户态模式下中继线程据此发出 close_notify 后退出
+    ~TlsSession();
+
+    TlsMode mode() const { return mode_; }
+    bool ktls_send() const { return ktls_send_; }
+    bool ktls_recv() const { return ktls_recv_; }
+    const char *version() const;
+    const char *cipher() const;
+    // TCP socket（统计内核发送队列深度用）
+    int socket() const { return fd_; }
+
+    // 用户态中继转发的明文字节数（内核模式恒为 0）
+    uint64_t relay_bytes_out() const { return relay_out_.load(std::memory_order_relaxed); }
+    uint64_t relay_bytes_in() const { return relay_in_.load(std::memory_order_relaxed); }
+
+    /**
+     * 把文件内容（如录制的 FLV）原样写入 TLS 连接：内核模式为 SSL_sendfile，文件页直接由内核加密发送；
+     * 用户态模式 sendfile 到 librtmp 一端，由中继线程加密。写入的字节与 librtmp 的 chunk 共用同一连接，
+     * 调用方须保证期间没有其他写入者
+     * @return 写入的字节数，失败返回 -1
+     */
+    long send_file(int file_fd, off_t offset, size_t size);
+
+    TlsSession(const TlsSession &) = delete;
+    TlsSession &operator=(const TlsSession &) = delete;
+
+private:
+    TlsSession() = default;
+    void relay();
+
+    ssl_ctx_st *ctx_ = nullptr;
+    ssl_st *ssl_ = nullptr;
+    int fd_ = -1;        // TCP socket
+    int app_fd_ = -1;    // 用户态模式下中继线程使用的 socketpair 一端
+    int peer_fd_ = -1;   // 用户态模式下交给 librtmp 的另一端（归 librtmp 所有）
+    TlsMode mode_ = TLS_MODE_NONE;
+    bool ktls_send_ = false;
+    bool ktls_recv_ = false;
+    std::thread relay_thread_;
+    std::atomic<uint64_t> relay_out_{0};
+    std::atomic<uint64_t> relay_in_{0};
+};
+
+// 是否以 BB_RTMP_TLS 编译
+bool tls_available();
+
+#endif // TLS_SESSION_H
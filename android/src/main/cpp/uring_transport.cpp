@@ -0,0 +1,646 @@
+#include "uring_transport.h"
+
+#ifdef BB_RTMP_URING
+
+#include "bb_log.h"
+#include "frame_trace.h"
+#include "rtmp_chunk.h"
+#include <linux/io_uring.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+#define TAG "UringTransport"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+static const unsigned kRingEntries = 256;
+static const uint32_t kSlotSize = 64 * 1024;
+static const int kSlotCount = 128;                 // 注册缓冲区共 8 MB
+static const int kMaxWriterSlots = 16;             // 单个连接最多占用 1 MB，相当于 socket 发送缓冲区
+static const size_t kMaxChainSqes = 32;
+static const int64_t kWriteTimeoutUs = 10000000;   // 与 rtmp_init 设置的 SO_SNDTIMEO 一致
+static const uint64_t kWakeUserData = ~0ull;
+static const uint64_t kCancelUserData = ~0ull - 1;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg,
+                              size_t arg_size) {
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+struct UringMessage {
+    std::vector<int> slots;
+    std::vector<uint32_t> lens;  // 每个缓冲区中的有效字节
+    int segment = 0;             // 下一个待写的段
+    uint32_t offset = 0;         // 该段已写出的字节
+    SendStatsMedia media = SEND_STATS_DATA;
+    uint32_t body_size = 0;
+    uint32_t timestamp = 0;
+    int chunk_size = 0;
+    size_t wire_bytes = 0;
+    int64_t enqueue_us = 0;
+    int64_t first_submit_us = 0;
+    int syscalls = 0;            // 携带本消息 SQE 的 io_uring_enter 次数
+};
+
+class UringEngine {
+public:
+    // 首次调用时初始化，失败返回 nullptr 且不再重试；引擎线程常驻进程，不随静态析构销毁
+    static UringEngine *instance();
+    static UringEngine *peek() { return initialized_.load(std::memory_order_acquire); }
+
+    std::shared_ptr<UringWriter> attach(int fd, std::shared_ptr<SendStats> stats);
+    void detach(UringWriter *writer);
+    UringSubmitResult submit(UringWriter *writer, const RTMPPacket *packet, int chunk_size, SendStatsMedia media,
+                             int64_t enqueue_us);
+    bool drain(UringWriter *writer);
+    bool failed(const UringWriter *writer);
+    void stats(rtmp_uring_stats *out);
+
+private:
+    UringEngine() = default;
+    ~UringEngine();
+    bool init();
+    void loop();
+    io_uring_sqe *get_sqe();
+    void arm_wakeup();
+    bool prepare_chain(UringWriter *writer, int64_t now);
+    void cancel_chain(UringWriter *writer);
+    void complete_chain(UringWriter *writer);
+    void finish_message(UringWriter *writer, UringMessage *message, bool ok);
+    uint8_t *slot_data(int slot) const { return pool_ + (size_t) slot * kSlotSize; }
+
+    static std::atomic<UringEngine *> initialized_;
+
+    int ring_fd_ = -1;
+    int wake_fd_ = -1;
+    void *sq_ring_ = nullptr;
+    void *cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned sqe_tail_ = 0;  // 本地 SQ 尾，提交前发布
+    uint64_t wake_value_ = 0;
+    uint8_t *pool_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;  // 链完成、缓冲区归还、写端失败
+    std::map<uint32_t, UringWriter *> writers_;
+    std::vector<UringWriter *> ready_;  // 有待提交消息且没有在途链的写端
+    std::vector<int> free_slots_;
+    uint32_t next_id_ = 1;
+    bool wake_pending_ = false;
+    rtmp_uring_stats stats_;
+};
+
+std::atomic<UringEngine *> UringEngine::initialized_(nullptr);
+
+UringEngine *UringEngine::instance() {
+    static UringEngine *engine = [] {
+        UringEngine *e = new UringEngine();
+        if (!e->init()) {
+            delete e;
+            return (UringEngine *) nullptr;
+        }
+        initialized_.store(e, std::memory_order_release);
+        new std::thread(&UringEngine::loop, e);
+        return e;
+    }();
+    return engine;
+}
+
+UringEngine::~UringEngine() {
+    if (pool_ != nullptr) munmap(pool_, (size_t) kSlotSize * kSlotCount);
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    if (wake_fd_ >= 0) close(wake_fd_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+bool UringEngine::init() {
+    memset(&stats_, 0, sizeof(stats_));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = sys_io_uring_setup(kRingEntries, &params);
+    if (ring_fd_ < 0) {
+        LOGE("io_uring_setup 失败: %s", strerror(errno));
+        return false;
+    }
+    // 等待超时依赖 IORING_ENTER_EXT_ARG（5.11），同一版本起 CQ 溢出也不会丢弃完成事件
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 || (params.features & IORING_FEAT_NODROP) == 0) {
+        LOGE("内核 io_uring 版本过低: features=0x%x", params.features);
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        LOGE("映射 SQ 失败: %s", strerror(errno));
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            LOGE("映射 CQ 失败: %s", strerror(errno));
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        LOGE("映射 SQE 失败: %s", strerror(errno));
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    uint8_t *sq = static_cast<uint8_t *>(sq_ring_);
+    uint8_t *cq = static_cast<uint8_t *>(cq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    sqe_tail_ = *sq_tail_;
+
+    // 注册缓冲池：WRITE_FIXED 直接引用已固定的页，每次提交不再逐页 pin/unpin
+    void *pool = mmap(nullptr, (size_t) kSlotSize * kSlotCount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if (pool == MAP_FAILED) {
+        LOGE("分配缓冲池失败: %s", strerror(errno));
+        return false;
+    }
+    pool_ = static_cast<uint8_t *>(pool);
+    std::vector<struct iovec> iovecs(kSlotCount);
+    for (int i = 0; i < kSlotCount; ++i) {
+        iovecs[i].iov_base = slot_data(i);
+        iovecs[i].iov_len = kSlotSize;
+    }
+    if (sys_io_uring_register(ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(), kSlotCount) < 0) {
+        LOGE("注册缓冲区失败: %s", strerror(errno));
+        return false;
+    }
+    free_slots_.reserve(kSlotCount);
+    for (int i = kSlotCount - 1; i >= 0; --i) free_slots_.push_back(i);
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOGE("eventfd 失败: %s", strerror(errno));
+        return false;
+    }
+    stats_.available = 1;
+    LOGD("io_uring 发送引擎已初始化: sq=%u, cq=%u, 缓冲池 %d x %u", params.sq_entries, params.cq_entries, kSlotCount,
+         kSlotSize);
+    return true;
+}
+
+io_uring_sqe *UringEngine::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) return nullptr;
+    unsigned index = sqe_tail_ & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    sqe_tail_++;
+    return sqe;
+}
+
+// 唤醒：eventfd 上常驻一个 READ，发送线程写入 eventfd 即可让阻塞在 io_uring_enter 中的引擎线程返回
+void UringEngine::arm_wakeup() {
+    io_uring_sqe *sqe = get_sqe();
+    if (sqe == nullptr) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wake_fd_;
+    sqe->addr = (uint64_t) (uintptr_t) &wake_value_;
+    sqe->len = sizeof(wake_value_);
+    sqe->user_data = kWakeUserData;
+}
+
+std::shared_ptr<UringWriter> UringEngine::attach(int fd, std::shared_ptr<SendStats> stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t id = next_id_++;
+    std::shared_ptr<UringWriter> writer(new UringWriter(this, id, fd, std::move(stats)));
+    writers_[id] = writer.get();
+    stats_.connections = (int) writers_.size();
+    return writer;
+}
+
+void UringEngine::detach(UringWriter *writer) {
+    drain(writer);
+    std::lock_guard<std::mutex> lock(mutex_);
+    writers_.erase(writer->id_);
+    ready_.erase(std::remove(ready_.begin(), ready_.end(), writer), ready_.end());
+    stats_.connections = (int) writers_.size();
+}
+
+UringSubmitResult UringEngine::submit(UringWriter *writer, const RTMPPacket *packet, int chunk_size,
+                                      SendStatsMedia media, int64_t enqueue_us) {
+    size_t wire_bytes = rtmp_chunked_size(packet, chunk_size);
+    int needed = (int) ((wire_bytes + kSlotSize - 1) / kSlotSize);
+    if (needed > kMaxWriterSlots) return URING_TOO_LARGE;
+
+    std::unique_ptr<UringMessage> message(new UringMessage());
+    {
+        // 本连接的在途额度或共享缓冲池用尽时等待引擎写出（写超时保证有限时间内归还或失败）
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] {
+            return writer->failed_ ||
+                   (writer->queued_slots_ + needed <= kMaxWriterSlots && (int) free_slots_.size() >= needed);
+        });
+        if (writer->failed_) return URING_FAILED;
+        for (int i = 0; i < needed; ++i) {
+            message->slots.push_back(free_slots_.back());
+            free_slots_.pop_back();
+        }
+        writer->queued_slots_ += needed;
+    }
+
+    // 序列化在锁外进行：缓冲区已归本消息所有，引擎线程在入队之前不会访问
+    size_t segment = 0;
+    uint32_t used = 0;
+    rtmp_write_chunks(packet, chunk_size, [&](const uint8_t *data, size_t len) {
+        while (len > 0) {
+            uint32_t n = (uint32_t) std::min<size_t>(len, kSlotSize - used);
+            memcpy(slot_data(message->slots[segment]) + used, data, n);
+            used += n;
+            data += n;
+            len -= n;
+            if (used == kSlotSize) {
+                message->lens.push_back(used);
+                segment++;
+                used = 0;
+            }
+        }
+    });
+    if (used > 0) message->lens.push_back(used);
+    message->media = media;
+    message->body_size = packet->m_nBodySize;
+    message->timestamp = packet->m_nTimeStamp;
+    message->chunk_size = chunk_size;
+    message->wire_bytes = wire_bytes;
+    message->enqueue_us = enqueue_us;
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writer->failed_) {
+            for (int slot : message->slots) free_slots_.push_back(slot);
+            writer->queued_slots_ -= needed;
+            cv_.notify_all();
+            return URING_FAILED;
+        }
+        writer->queue_.push_back(message.release());
+        // 有在途链时由完成事件接着提交
+        if (!writer->pending_ && writer->inflight_ == 0) {
+            writer->pending_ = true;
+            ready_.push_back(writer);
+            wake = !wake_pending_;
+            wake_pending_ = true;
+        }
+    }
+    if (wake) {
+        uint64_t one = 1;
+        ssize_t n = write(wake_fd_, &one, sizeof(one));
+        (void) n;
+    }
+    return URING_QUEUED;
+}
+
+bool UringEngine::drain(UringWriter *writer) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return (writer->queue_.empty() || writer->failed_) && writer->inflight_ == 0; });
+    return !writer->failed_;
+}
+
+bool UringEngine::failed(const UringWriter *writer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writer->failed_;
+}
+
+void UringEngine::stats(rtmp_uring_stats *out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *out = stats_;
+}
+
+/* 把写端队列中尚未写出的段组成一条链接的 WRITE_FIXED 序列（最多 kMaxChainSqes 个），SQ 空间不足时返回 false */
+bool UringEngine::prepare_chain(UringWriter *writer, int64_t now) {
+    size_t count = 0;
+    for (UringMessage *message : writer->queue_) {
+        count += message->lens.size() - message->segment;
+        if (count >= kMaxChainSqes) break;
+    }
+    count = std::min(count, kMaxChainSqes);
+    if (sq_entries_ - (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)) < count + 1) return false;
+
+    writer->chain_.clear();
+    for (UringMessage *message : writer->queue_) {
+        if (writer->chain_.size() == count) break;
+        if (message->first_submit_us == 0) message->first_submit_us = now;
+        message->syscalls++;
+        for (int segment = message->segment; segment < (int) message->lens.size(); ++segment) {
+            if (writer->chain_.size() == count) break;
+            uint32_t offset = segment == message->segment ? message->offset : 0;
+            UringWriter::ChainEntry entry;
+            entry.message = message;
+            entry.segment = segment;
+            entry.offset = offset;
+            entry.len = message->lens[segment] - offset;
+            entry.result = 0;
+            entry.done = false;
+
+            io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->fd = writer->fd_;
+            sqe->addr = (uint64_t) (uintptr_t) (slot_data(message->slots[segment]) + offset);
+            sqe->len = entry.len;
+            sqe->buf_index = (uint16_t) message->slots[segment];
+            sqe->user_data = ((uint64_t) writer->id_ << 32) | writer->chain_.size();
+            // 同一连接的段按顺序执行：前一个短写或失败时后续 SQE 以 -ECANCELED 结束，从断点重新提交
+            if (writer->chain_.size() + 1 < count) sqe->flags = IOSQE_IO_LINK;
+            writer->chain_.push_back(entry);
+        }
+    }
+    writer->inflight_ = (int) count;
+    writer->deadline_us_ = now + kWriteTimeoutUs;
+    writer->cancel_sent_ = false;
+    stats_.sqes += count;
+    return true;
+}
+
+void UringEngine::cancel_chain(UringWriter *writer) {
+    writer->cancel_sent_ = true;
+    stats_.timeouts++;
+    for (size_t i = 0; i < writer->chain_.size(); ++i) {
+        if (writer->chain_[i].done) continue;
+        io_uring_sqe *sqe = get_sqe();
+        if (sqe == nullptr) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = ((uint64_t) writer->id_ << 32) | i;
+        sqe->user_data = kCancelUserData;
+    }
+    LOGE("io_uring 写超时，取消: fd=%d", writer->fd_);
+}
+
+void UringEngine::finish_message(UringWriter *writer, UringMessage *message, bool ok) {
+    int64_t now = send_stats_now_us();
+    if (writer->stats_) {
+        int64_t start = message->first_submit_us != 0 ? message->first_submit_us : now;
+        writer->stats_->on_packet_sent(message->media, message->body_size, message->chunk_size, ok,
+                                       message->enqueue_us, start, now, message->syscalls);
+    }
+    FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, (FrameTraceTrack) message->media, message->timestamp, ok ? 1 : 0);
+    if (ok) {
+        stats_.messages++;
+        stats_.bytes += message->wire_bytes;
+    }
+    for (int slot : message->slots) free_slots_.push_back(slot);
+    writer->queued_slots_ -= (int) message->slots.size();
+    delete message;
+}
+
+/* 整条链的 CQE 到齐：按顺序累计写出的字节，写完的消息出队；短写或被链中断时保留断点，之后重新提交 */
+void UringEngine::complete_chain(UringWriter *writer) {
+    int error = 0;
+    bool incomplete = false;
+    for (const UringWriter::ChainEntry &entry : writer->chain_) {
+        UringMessage *message = entry.message;
+        if (entry.result == (int32_t) entry.len) {
+            message->segment = entry.segment + 1;
+            message->offset = 0;
+            if (message->segment == (int) message->lens.size()) {
+                writer->queue_.pop_front();
+                finish_message(writer, message, true);
+            }
+            continue;
+        }
+        incomplete = true;
+        if (entry.result > 0) {
+            message->offset = entry.offset + (uint32_t) entry.result;
+        } else if (entry.result != -ECANCELED && entry.result != -EINTR) {
+            // -EAGAIN 为 SO_SNDTIMEO 超时，与 librtmp 的 WriteN 一样按失败处理
+            error = -entry.result;
+        }
+        break;
+    }
+    writer->chain_.clear();
+    if (error == 0 && writer->cancel_sent_ && incomplete) error = ETIMEDOUT;
+    if (error != 0) {
+        LOGE("io_uring 写失败: fd=%d, %s", writer->fd_, strerror(error));
+        writer->failed_ = true;
+        while (!writer->queue_.empty()) {
+            UringMessage *message = writer->queue_.front();
+            writer->queue_.pop_front();
+            finish_message(writer, message, false);
+        }
+    } else if (!writer->queue_.empty()) {
+        if (incomplete) stats_.resubmits++;
+        if (!writer->pending_) {
+            writer->pending_ = true;
+            ready_.push_back(writer);
+        }
+    }
+    cv_.notify_all();
+}
+
+void UringEngine::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    arm_wakeup();
+    while (true) {
+        int64_t now = send_stats_now_us();
+        // 所有就绪连接的链在同一次 io_uring_enter 中提交
+        int batched = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < ready_.size(); ++i) {
+            UringWriter *writer = ready_[i];
+            if (writer->failed_ || writer->inflight_ > 0 || writer->queue_.empty()) {
+                writer->pending_ = false;
+                continue;
+            }
+            if (!prepare_chain(writer, now)) {
+                ready_[kept++] = writer;  // SQ 已满，下一轮提交
+                continue;
+            }
+            writer->pending_ = false;
+            batched++;
+        }
+        ready_.resize(kept);
+
+        int64_t next_deadline = 0;
+        for (auto &item : writers_) {
+            UringWriter *writer = item.second;
+            if (writer->inflight_ == 0 || writer->cancel_sent_) continue;
+            if (now >= writer->deadline_us_) cancel_chain(writer);
+            else if (next_deadline == 0 || writer->deadline_us_ < next_deadline) next_deadline = writer->deadline_us_;
+        }
+
+        unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (next_deadline != 0 || kept > 0) {
+            int64_t wait_us = kept > 0 ? 1000 : std::max<int64_t>(next_deadline - now, 1000);
+            ts.tv_sec = wait_us / 1000000;
+            ts.tv_nsec = (wait_us % 1000000) * 1000;
+            arg.ts = (uint64_t) (uintptr_t) &ts;
+        }
+        stats_.enter_calls++;
+        if (batched > 1) stats_.batched_enters++;
+        lock.unlock();
+        int ret = sys_io_uring_enter(ring_fd_, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                                     sizeof(arg));
+        int err = ret < 0 ? errno : 0;
+        lock.lock();
+        if (ret < 0 && err != ETIME && err != EINTR && err != EBUSY && err != EAGAIN) {
+            LOGE("io_uring_enter 失败: %s", strerror(err));
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            lock.lock();
+        }
+
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        bool rearm = false;
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+            uint64_t user_data = cqe.user_data;
+            int32_t res = cqe.res;
+            if (user_data == kWakeUserData) {
+                wake_pending_ = false;
+                rearm = true;
+                continue;
+            }
+            if (user_data == kCancelUserData) continue;
+            auto it = writers_.find((uint32_t) (user_data >> 32));
+            if (it == writers_.end()) continue;
+            UringWriter *writer = it->second;
+            size_t pos = (size_t) (user_data & 0xffffffffu);
+            if (pos >= writer->chain_.size() || writer->chain_[pos].done) continue;
+            writer->chain_[pos].result = res;
+            writer->chain_[pos].done = true;
+            if (--writer->inflight_ == 0) complete_chain(writer);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        if (rearm) arm_wakeup();
+    }
+}
+
+UringWriter::UringWriter(UringEngine *engine, uint32_t id, int fd, std::shared_ptr<SendStats> stats)
+        : engine_(engine), id_(id), fd_(fd), stats_(std::move(stats)) {}
+
+UringWriter::~UringWriter() {
+    engine_->detach(this);
+}
+
+UringSubmitResult UringWriter::submit(const RTMPPacket *packet, int chunk_size, SendStatsMedia media,
+                                      int64_t enqueue_us) {
+    return engine_->submit(this, packet, chunk_size, media, enqueue_us);
+}
+
+bool UringWriter::drain() {
+    return engine_->drain(this);
+}
+
+bool UringWriter::failed() const {
+    return engine_->failed(this);
+}
+
+std::shared_ptr<UringWriter> uring_writer_create(int fd, std::shared_ptr<SendStats> stats) {
+    UringEngine *engine = UringEngine::instance();
+    if (engine == nullptr || fd < 0) return nullptr;
+    return engine->attach(fd, std::move(stats));
+}
+
+bool uring_engine_available() {
+    return UringEngine::instance() != nullptr;
+}
+
+void uring_engine_stats(rtmp_uring_stats *out) {
+    UringEngine *engine = UringEngine::peek();
+    if (engine == nullptr) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    engine->stats(out);
+}
+
+#else // BB_RTMP_URING
+
+#include <cstring>
+
+class UringEngine {};
+
+UringWriter::UringWriter(UringEngine *engine, uint32_t id, int fd, std::shared_ptr<SendStats> stats)
+        : engine_(engine), id_(id), fd_(fd), stats_(std::move(stats)) {}
+
+UringWriter::~UringWriter() = default;
+
+UringSubmitResult UringWriter::submit(const RTMPPacket *, int, SendStatsMedia, int64_t) {
+    return URING_FAILED;
+}
+
+bool UringWriter::drain() {
+    return false;
+}
+
+bool UringWriter::failed() const {
+    return true;
+}
+
+std::shared_ptr<UringWriter> uring_writer_create(int, std::shared_ptr<SendStats>) {
+    return nullptr;
+}
+
+bool uring_engine_available() {
+    return false;
+}
+
+void uring_engine_stats(rtmp_uring_stats *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+#endif // BB_RTMP_URING
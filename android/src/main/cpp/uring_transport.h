@@ -0,0 +1,100 @@
+#ifndef URING_TRANSPORT_H
+#define URING_TRANSPORT_H
+
+#include "rtmp_wrapper.h"
+#include "send_stats.h"
+#include "librtmp/rtmp.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/*
+ * io_uring 发送后端（以 BB_RTMP_URING 编译，Linux 5.11+，直接使用系统调用，不依赖 liburing）。
+ *
+ * librtmp 对每个 chunk 调用一次 send()（默认 chunk size 128，64 KB 的视频帧约 500 次系统调用），且发送线程
+ * 在 wrapper 锁内阻塞到最后一个 chunk 写完。本模块改为：
+ *   - 发送线程把整条消息按 chunk 序列化进注册缓冲区（IORING_REGISTER_BUFFERS，进程内共享的缓冲池），
+ *     挂到连接的写队列后立即返回，不再在锁内等待 socket；
+ *   - 进程内唯一的引擎线程把每个连接排队的消息作为一条 IOSQE_IO_LINK 链接的 IORING_OP_WRITE_FIXED 序列
+ *     提交（链接保证同一 socket 上的顺序，前一个短写时后续 SQE 以 -ECANCELED 结束），多个连接的链在同一次
+ *     io_uring_enter 中批量提交；
+ *   - 写端状态由完成事件驱动：整条链的 CQE 到齐后按顺序累计写出的字节，写完的消息归还缓冲区并记入发送统计，
+ *     短写或链中断时从断点重新提交；超过写超时的链以 IORING_OP_ASYNC_CANCEL 取消并把连接置为失败。
+ * 内核不支持（或被 seccomp 禁止、注册缓冲区失败）时 uring_engine_available() 返回 false，调用方保持 librtmp 的
+ * socket 发送路径。
+ */
+
+struct UringMessage;
+class UringEngine;
+
+enum UringSubmitResult {
+    URING_QUEUED = 0,     // 已入队，由引擎线程写出
+    URING_TOO_LARGE = 1,  // 消息超过单条消息可用的缓冲区，调用方应先 drain 再交给 librtmp
+    URING_FAILED = -1,    // 连接此前写失败或超时
+};
+
+/*
+ * 连接的写端：submit/drain 由持有 wrapper 锁的发送线程调用，其余状态只在引擎锁内访问
+ */
+class UringWriter {
+public:
+    ~UringWriter();  // 等待队列写完（最多一个写超时）后从引擎摘除
+
+    /**
+     * 按 chunk_size 序列化消息并入队。缓冲池或本连接的在途额度用尽时阻塞等待引擎写出（相当于 socket 发送缓冲区满）
+     * @param stats 写完（或失败）时由引擎线程记入，可为空
+     * @param enqueue_us 帧进入发送接口的时刻（0 表示不记录）
+     */
+    UringSubmitResult submit(const RTMPPacket *packet, int chunk_size, SendStatsMedia media, int64_t enqueue_us);
+
+    // 等待已入队的消息全部写出；写失败或超时返回 false
+    bool drain();
+    bool failed() const;
+    int fd() const { return fd_; }
+
+    UringWriter(const UringWriter &) = delete;
+    UringWriter &operator=(const UringWriter &) = delete;
+
+private:
+    friend class UringEngine;
+    UringWriter(UringEngine *engine, uint32_t id, int fd, std::shared_ptr<SendStats> stats);
+
+    // 以下字段由引擎锁保护
+    struct ChainEntry {
+        UringMessage *message;
+        int segment;
+        uint32_t offset;  // 段内起始偏移
+        uint32_t len;
+        int32_t result;
+        bool done;
+    };
+
+    UringEngine *engine_;
+    uint32_t id_;
+    int fd_;
+    std::shared_ptr<SendStats> stats_;
+    std::deque<UringMessage *> queue_;  // 队首的若干条消息可能正在写
+    int queued_slots_ = 0;
+    std::vector<ChainEntry> chain_;     // 在途的链接 SQE（按提交顺序）
+    int inflight_ = 0;                  // 尚未收到 CQE 的 SQE 数
+    int64_t deadline_us_ = 0;           // 在途链的写超时时刻
+    bool cancel_sent_ = false;
+    bool failed_ = false;
+    bool pending_ = false;              // 已登记在引擎的待提交列表中
+};
+
+/**
+ * 为已连接的 socket 创建 io_uring 写端（首次调用时初始化进程内的引擎）
+ * @param stats 连接的发送统计，写完时由引擎线程记入（发送线程只在 drain 之后才改用 librtmp 发送，两者不重叠）
+ * @return 不可用时返回空
+ */
+std::shared_ptr<UringWriter> uring_writer_create(int fd, std::shared_ptr<SendStats> stats);
+
+// 是否以 BB_RTMP_URING 编译且内核支持（首次调用时探测）
+bool uring_engine_available();
+
+// 引擎累计统计（未初始化时 available 为 0，其余为 0）
+void uring_engine_stats(rtmp_uring_stats *out);
+
+#endif // URING_TRANSPORT_H
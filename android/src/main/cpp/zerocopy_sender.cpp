@@ -0,0 +1,412 @@
+#include "zerocopy_sender.h"
+
+#if defined(__linux__)
+
+#include "bb_log.h"
+#include "rtmp_chunk.h"
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <linux/errqueue.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+#define TAG "ZeroCopySender"
+#define LOGD(...) BB_LOG(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
+#define LOGE(...) BB_LOG(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+// 旧版 NDK / libc 头文件可能缺少以下定义（值取自内核 uapi）
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+static const size_t kMaxPending = 32;              // 在途消息上限，约等于几百 KB~数 MB 的固定内存
+static const size_t kMaxFreeBodies = 8;            // 缓冲池保留的空闲 body 数
+static const size_t kMaxSpareHeaders = 8;
+static const size_t kBodyGranularity = 64 * 1024;  // 新分配的 body 按 64 KB 向上取整，便于相近大小的帧复用
+static const int64_t kWriteTimeoutUs = 10000000;   // 与 rtmp_init 设置的 SO_SNDTIMEO 一致
+static const int64_t kCloseWaitUs = 1000000;
+static const size_t kMaxIov = IOV_MAX;
+
+static int64_t now_us() {
+    return send_stats_now_us();
+}
+
+/*
+ * 回收线程：进程内唯一，epoll 监听所有零拷贝 socket 的 EPOLLERR（错误队列非空时触发），读出完成通知后
+ * 立即归还缓冲区并唤醒等待的发送线程。按 id 查找发送端，摘除后不会再访问其 socket
+ */
+class ZeroCopyReaper {
+public:
+    // 首次调用时启动线程，失败返回 nullptr（发送端退化为由发送线程自行读取完成通知）；线程常驻进程
+    static ZeroCopyReaper *instance() {
+        static ZeroCopyReaper *reaper = [] () -> ZeroCopyReaper * {
+            int fd = epoll_create1(EPOLL_CLOEXEC);
+            if (fd < 0) {
+                LOGE("epoll_create1 失败: %s", strerror(errno));
+                return nullptr;
+            }
+            ZeroCopyReaper *created = new ZeroCopyReaper(fd);
+            std::thread(&ZeroCopyReaper::loop, created).detach();
+            return created;
+        }();
+        return reaper;
+    }
+
+    bool attach(ZeroCopySender *sender) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t id = next_id_++;
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLERR;  // 不关心读写就绪，EPOLLERR/EPOLLHUP 总会上报
+        event.data.u32 = id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sender->fd_, &event) != 0) {
+            LOGE("epoll_ctl(ADD) 失败: %s", strerror(errno));
+            return false;
+        }
+        senders_[id] = sender;
+        sender->reaper_id_ = id;
+        std::lock_guard<std::mutex> sender_lock(sender->mutex_);
+        sender->watched_ = true;
+        return true;
+    }
+
+    void detach(ZeroCopySender *sender) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (senders_.erase(sender->reaper_id_) > 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, sender->fd_, nullptr);
+        }
+    }
+
+private:
+    explicit ZeroCopyReaper(int epoll_fd) : epoll_fd_(epoll_fd) {}
+
+    static bool socket_error(int fd) {
+        struct pollfd pfd = {fd, 0, 0};
+        return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP)) != 0;
+    }
+
+    void loop() {
+        struct epoll_event events[64];
+        while (true) {
+            int n = epoll_wait(epoll_fd_, events, 64, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                LOGE("epoll_wait 失败: %s", strerror(errno));
+                return;
+            }
+            for (int i = 0; i < n; ++i) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = senders_.find(events[i].data.u32);
+                if (it == senders_.end()) continue;
+                ZeroCopySender *sender = it->second;
+                std::lock_guard<std::mutex> sender_lock(sender->mutex_);
+                int handled = sender->reap_locked();
+                // 连接已断开（EPOLLHUP）或出现了 socket 错误（错误队列已空仍有 POLLERR）：水平触发会一直上报，
+                // 停止监听，之后由发送线程自行读取剩余的完成通知
+                if ((events[i].events & EPOLLHUP) || (handled == 0 && socket_error(sender->fd_))) {
+                    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, sender->fd_, nullptr);
+                    senders_.erase(it);
+                    sender->watched_ = false;
+                }
+            }
+        }
+    }
+
+    int epoll_fd_;
+    std::mutex mutex_;  // 先于发送端的 mutex_ 获取
+    std::map<uint32_t, ZeroCopySender *> senders_;
+    uint32_t next_id_ = 1;
+};
+
+ZeroCopySender::ZeroCopySender(int fd, uint32_t threshold, std::shared_ptr<SendStats> stats)
+        : fd_(fd), threshold_(threshold), stats_(std::move(stats)) {}
+
+ZeroCopySender::~ZeroCopySender() {
+    ZeroCopyReaper *reaper = ZeroCopyReaper::instance();
+    if (reaper != nullptr) reaper->detach(this);
+    std::unique_lock<std::mutex> lock(mutex_);
+    watched_ = false;
+    if (!wait_pending_locked(lock, 1, kCloseWaitUs)) {
+        // 内核仍引用这些页（释放后页不会被回收，但可能被后续分配复用），连接即将关闭，未发出的数据已无意义
+        LOGE("关闭时仍有 %zu 条零拷贝消息未收到完成通知", pending_.size());
+    }
+    pending_.clear();
+    for (auto &entry : free_bodies_) free(entry.second);
+    free_bodies_.clear();
+    int zero = 0;
+    setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &zero, sizeof(zero));
+}
+
+bool ZeroCopySender::alloc_body(RTMPPacket *packet, uint32_t body_size) {
+    size_t needed = (size_t) body_size + RTMP_MAX_HEADER_SIZE;
+    char *base = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = free_bodies_.lower_bound(needed);
+        // 不用远大于需求的缓冲区承载小帧，避免池中的大块被长期占用
+        if (it != free_bodies_.end() && it->first <= needed * 2) {
+            base = it->second;
+            free_bodies_.erase(it);
+        }
+    }
+    if (base == nullptr) {
+        size_t capacity = (needed + kBodyGranularity - 1) / kBodyGranularity * kBodyGranularity;
+        base = static_cast<char *>(malloc(capacity));
+        if (base == nullptr) return false;
+    }
+    packet->m_body = base + RTMP_MAX_HEADER_SIZE;
+    packet->m_nBytesRead = 0;
+    return true;
+}
+
+bool ZeroCopySender::wait_pending_locked(std::unique_lock<std::mutex> &lock, size_t max_pending,
+                                         int64_t timeout_us) {
+    int64_t deadline = now_us() + timeout_us;
+    while (pending_.size() >= max_pending) {
+        reap_locked();
+        if (pending_.size() < max_pending) break;
+        if (now_us() >= deadline) return false;
+        // 回收线程在监听时由 notify 唤醒；否则 10 ms 后自行再读一次错误队列
+        cv_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+bool ZeroCopySender::send(const RTMPPacket *packet, int chunk_size, int *syscalls) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    awaiting_body_ = false;
+    *syscalls = 0;
+    if (!watched_) reap_locked();
+    // 在途消息达到上限且等不到完成通知时本条改为拷贝发送，不因固定内存耗尽而失败
+    bool zerocopy = wait_pending_locked(lock, kMaxPending, kWriteTimeoutUs);
+
+    // 先把本条消息登记为在途（sending），sendmsg 期间不持有 mutex_：回收线程随时可能读到本条的完成通知，
+    // 须能按序号找到它。deque 的 push_back/pop_front 不使其余元素的引用失效，且未 pin 的消息不会被出队
+    pending_.emplace_back();
+    Pending &pending = pending_.back();
+    pending.first_id = next_id_;
+    pending.sending = true;
+    if (!spare_headers_.empty()) {
+        pending.headers.swap(spare_headers_.back());
+        spare_headers_.pop_back();
+    }
+    uint32_t body_size = packet->m_nBodySize;
+    size_t chunks = body_size > 0 ? (body_size + chunk_size - 1) / (uint32_t) chunk_size : 1;
+    pending.headers.resize(chunks * RTMP_CHUNK_HEADER_MAX);
+    std::vector<struct iovec> iov;
+    iov.reserve(chunks * 2);
+    size_t header_used = 0;
+    const uint8_t *body = reinterpret_cast<const uint8_t *>(packet->m_body);
+    rtmp_write_chunks(packet, chunk_size, [&](const uint8_t *data, size_t len) {
+        struct iovec entry;
+        if (data >= body && data < body + body_size) {
+            entry.iov_base = const_cast<uint8_t *>(data);
+        } else {
+            // chunk 头写在 rtmp_write_chunks 的栈上，复制到随消息保留到完成通知的数组中
+            memcpy(&pending.headers[header_used], data, len);
+            entry.iov_base = &pending.headers[header_used];
+            header_used += len;
+        }
+        entry.iov_len = len;
+        iov.push_back(entry);
+    });
+
+    bool ok = true;
+    size_t index = 0;
+    while (index < iov.size()) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[index];
+        msg.msg_iovlen = iov.size() - index < kMaxIov ? iov.size() - index : kMaxIov;
+        // 预占本次 sendmsg 的完成通知序号；失败的 sendmsg 不消耗内核序号，随后撤回
+        bool use_zerocopy = zerocopy;
+        if (use_zerocopy) ++pending.ids;
+        lock.unlock();
+        ssize_t n = sendmsg(fd_, &msg, MSG_NOSIGNAL | (use_zerocopy ? MSG_ZEROCOPY : 0));
+        int saved_errno = errno;
+        lock.lock();
+        if (n < 0) {
+            if (use_zerocopy) --pending.ids;
+            if (saved_errno == EINTR) continue;
+            if (saved_errno == ENOBUFS && use_zerocopy) {
+                // 超出 optmem_max 或 RLIMIT_MEMLOCK，内核不再为本 socket 固定页：剩余部分拷贝发送
+                LOGD("MSG_ZEROCOPY 返回 ENOBUFS，本条消息剩余部分改为拷贝发送");
+                zerocopy = false;
+                continue;
+            }
+            LOGE("sendmsg 失败: %s", strerror(saved_errno));
+            ok = false;
+            break;
+        }
+        ++*syscalls;
+        if (use_zerocopy) {
+            // 每次成功的零拷贝 sendmsg（含部分写）占用一个完成通知序号
+            pending.wire_bytes += (uint64_t) n;
+            pending.sent_us = now_us();
+        }
+        size_t written = (size_t) n;
+        while (written > 0) {
+            if (written >= iov[index].iov_len) {
+                written -= iov[index].iov_len;
+                ++index;
+            } else {
+                iov[index].iov_base = static_cast<uint8_t *>(iov[index].iov_base) + written;
+                iov[index].iov_len -= written;
+                written = 0;
+            }
+        }
+    }
+
+    pending.sending = false;
+    if (pending.ids == 0) {
+        // 本条没有零拷贝写出的部分：在途消息中它仍是最后一条（发送端只有一个线程），直接撤下
+        if (spare_headers_.size() < kMaxSpareHeaders) spare_headers_.push_back(std::move(pending.headers));
+        pending_.pop_back();
+        return ok;
+    }
+    next_id_ += pending.ids;
+    if (stats_) {
+        stats_->on_zerocopy_sent(pending.wire_bytes);
+        // 完成通知早于 sendmsg 循环结束到达时，统计推迟到这里补记
+        if (pending.completed == pending.ids) {
+            stats_->on_zerocopy_completed(pending.wire_bytes, pending.copied, now_us() - pending.sent_us);
+        }
+    }
+    awaiting_body_ = true;
+    return ok;
+}
+
+void ZeroCopySender::pin(const FlvTagRef &tag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!awaiting_body_ || pending_.empty()) return;
+    awaiting_body_ = false;
+    pending_.back().tag = tag;
+    pending_.back().attached = true;
+    // 完成通知可能早于 pin 到达
+    release_completed_locked();
+}
+
+int ZeroCopySender::reap_locked() {
+    int handled = 0;
+    while (true) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int64_t now = now_us();
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool recverr = (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVERR) ||
+                           (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recverr) continue;
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) continue;
+            // 一条通知覆盖连续的序号区间 [ee_info, ee_data]
+            complete_locked(err.ee_info, err.ee_data, (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0, now);
+            ++handled;
+        }
+    }
+    if (handled > 0) {
+        release_completed_locked();
+        cv_.notify_all();
+    }
+    return handled;
+}
+
+void ZeroCopySender::complete_locked(uint32_t lo, uint32_t hi, bool copied, int64_t now_us) {
+    uint32_t span = hi - lo + 1;  // 序号按 32 位回绕
+    for (Pending &pending : pending_) {
+        if (pending.completed == pending.ids) continue;
+        uint32_t covered = 0;
+        for (uint32_t k = 0; k < pending.ids; ++k) {
+            if ((uint32_t) (pending.first_id + k - lo) < span) ++covered;
+        }
+        if (covered == 0) continue;
+        pending.completed += covered;
+        if (copied) pending.copied = true;
+        if (pending.completed == pending.ids && !pending.sending && stats_) {
+            stats_->on_zerocopy_completed(pending.wire_bytes, pending.copied, now_us - pending.sent_us);
+        }
+    }
+}
+
+void ZeroCopySender::release_completed_locked() {
+    while (!pending_.empty() && pending_.front().attached && pending_.front().completed == pending_.front().ids) {
+        Pending &pending = pending_.front();
+        // 没有其他持有者（录制）时把 body 收回缓冲池；容量按分配器的实际可用大小计
+        if (pending.tag && pending.tag.use_count() == 1 && free_bodies_.size() < kMaxFreeBodies &&
+            pending.tag->packet.m_body != nullptr) {
+            char *base = pending.tag->packet.m_body - RTMP_MAX_HEADER_SIZE;
+            pending.tag->packet.m_body = nullptr;
+            free_bodies_.emplace(malloc_usable_size(base), base);
+        }
+        if (spare_headers_.size() < kMaxSpareHeaders) spare_headers_.push_back(std::move(pending.headers));
+        pending_.pop_front();
+    }
+}
+
+std::shared_ptr<ZeroCopySender> zerocopy_sender_create(int fd, uint32_t threshold, std::shared_ptr<SendStats> stats) {
+    int type = 0;
+    socklen_t len = sizeof(type);
+    if (fd < 0 || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0 || type != SOCK_STREAM) return nullptr;
+    // 内核只对 TCP（及 UDP/RDS）接受 SO_ZEROCOPY，socketpair 等返回 EOPNOTSUPP
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) {
+        LOGE("SO_ZEROCOPY 不可用: %s", strerror(errno));
+        return nullptr;
+    }
+    std::shared_ptr<ZeroCopySender> sender(new ZeroCopySender(fd, threshold, std::move(stats)));
+    ZeroCopyReaper *reaper = ZeroCopyReaper::instance();
+    if (reaper == nullptr || !reaper->attach(sender.get())) {
+        LOGD("零拷贝完成通知改由发送线程读取");
+    }
+    LOGD("开启 MSG_ZEROCOPY: fd=%d, threshold=%u", fd, threshold);
+    return sender;
+}
+
+#else  // !__linux__
+
+ZeroCopySender::ZeroCopySender(int fd, uint32_t threshold, std::shared_ptr<SendStats> stats)
+        : fd_(fd), threshold_(threshold), stats_(std::move(stats)) {}
+
+ZeroCopySender::~ZeroCopySender() {}
+
+bool ZeroCopySender::alloc_body(RTMPPacket *packet, uint32_t body_size) {
+    return RTMPPacket_Alloc(packet, body_size) != 0;
+}
+
+bool ZeroCopySender::send(const RTMPPacket *, int, int *syscalls) {
+    *syscalls = 0;
+    return false;
+}
+
+void ZeroCopySender::pin(const FlvTagRef &) {}
+
+std::shared_ptr<ZeroCopySender> zerocopy_sender_create(int, uint32_t, std::shared_ptr<SendStats>) {
+    return nullptr;
+}
+
+#endif  // __linux__
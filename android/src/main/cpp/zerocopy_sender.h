@@ -0,0 +1,108 @@
+#ifndef ZEROCOPY_SENDER_H
+#define ZEROCOPY_SENDER_H
+
+#include "flv_recorder.h"
+#include "send_stats.h"
+#include "librtmp/rtmp.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * 大消息的 MSG_ZEROCOPY 发送（Linux 4.14+，TCP）。
+ *
+ * librtmp 的 send() 会把 50~300 KB 的关键帧整块拷贝进内核发送缓冲区。超过阈值的视频消息改由本模块以
+ * sendmsg(MSG_ZEROCOPY) 发出：iovec 依次为 chunk 头与指向 packet body 的负载片段，内核直接引用用户页，
+ * 直到对端确认后才经 socket 错误队列（MSG_ERRQUEUE）发出完成通知。期间 body 与 chunk 头都不能被改写或复用：
+ *   - 发送后 wrapper 把 body 转交为 FlvTag（与录制共享），由本模块持有引用直至完成通知覆盖该消息的全部
+ *     sendmsg 序号；
+ *   - 完成后若没有其他持有者（未在录制），body 归还连接的缓冲池，供下一个大帧 alloc_body 复用，避免大块
+ *     malloc/free 与缺页；
+ *   - 完成通知由进程内唯一的回收线程（epoll 等待 EPOLLERR）读取，完成延迟即缓冲区被固定的时长。
+ * 内核回退为拷贝（回环、不支持 scatter-gather 的网卡）时通知带 SO_EE_CODE_ZEROCOPY_COPIED，计入
+ * zerocopy_copied_bytes 而非 copy_avoided_bytes。
+ * 零拷贝以页为单位固定内存，chunk size 为默认的 128 时每个 chunk 头都会打断负载片段，调用方应同时调大
+ * 输出 chunk size（见 rtmp_set_zerocopy）。
+ */
+
+class ZeroCopySender {
+public:
+    ~ZeroCopySender();  // 须在关闭 socket 之前销毁：摘除回收线程并等待在途完成通知（最多 1 秒）
+
+    uint32_t threshold() const { return threshold_; }
+
+    /**
+     * 从缓冲池为 body_size 字节的消息分配 body（布局与 RTMPPacket_Alloc 相同，可由 RTMPPacket_Free 释放）
+     * @return 池中没有合适的缓冲区时新分配，分配失败返回 false
+     */
+    bool alloc_body(RTMPPacket *packet, uint32_t body_size);
+
+    /**
+     * 以 MSG_ZEROCOPY 发送整条消息（调用方持有 wrapper 锁，与 librtmp 的发送不交错）。
+     * sendmsg 阻塞期间不持有 mutex_，回收线程仍可读取本连接及其他连接的完成通知。
+     * 在途消息过多时先等待完成通知（相当于发送缓冲区满）；内核拒绝固定更多页（ENOBUFS）时该次 sendmsg 改为拷贝发送
+     * @param syscalls 输出本消息的 sendmsg 次数
+     * @return 整条消息写出返回 true
+     */
+    bool send(const RTMPPacket *packet, int chunk_size, int *syscalls);
+
+    // 最近一次 send 至少有一次零拷贝 sendmsg 成功，body 须交给 pin 保持到完成通知
+    bool awaiting_body() const { return awaiting_body_; }
+    void pin(const FlvTagRef &tag);
+
+    ZeroCopySender(const ZeroCopySender &) = delete;
+    ZeroCopySender &operator=(const ZeroCopySender &) = delete;
+
+private:
+    friend class ZeroCopyReaper;
+    friend std::shared_ptr<ZeroCopySender> zerocopy_sender_create(int, uint32_t, std::shared_ptr<SendStats>);
+    ZeroCopySender(int fd, uint32_t threshold, std::shared_ptr<SendStats> stats);
+
+    // 在途消息：占用 [first_id, first_id + ids) 的零拷贝序号
+    struct Pending {
+        uint32_t first_id = 0;
+        uint32_t ids = 0;
+        uint32_t completed = 0;        // 已收到完成通知的序号数
+        bool copied = false;           // 任一 sendmsg 被内核回退为拷贝
+        bool attached = false;         // body 已由 pin 接管；完成且已接管的消息才出队
+        bool sending = false;          // send 仍在写出本条，ids 可能继续增加，完成统计推迟到写完
+        uint64_t wire_bytes = 0;       // 以零拷贝写出的字节数（含 chunk 头）
+        int64_t sent_us = 0;           // 最后一次 sendmsg 返回的时刻
+        FlvTagRef tag;
+        std::vector<uint8_t> headers;  // chunk 头同样被内核引用
+    };
+
+    // 读取错误队列中的全部完成通知，返回处理的通知数；调用方持有 mutex_
+    int reap_locked();
+    void complete_locked(uint32_t lo, uint32_t hi, bool copied, int64_t now_us);
+    void release_completed_locked();
+    bool wait_pending_locked(std::unique_lock<std::mutex> &lock, size_t max_pending, int64_t timeout_us);
+
+    int fd_;
+    uint32_t threshold_;
+    std::shared_ptr<SendStats> stats_;
+    uint32_t reaper_id_ = 0;
+    bool awaiting_body_ = false;
+
+    std::mutex mutex_;                 // 发送线程与回收线程共用
+    std::condition_variable cv_;       // 有消息完成时通知
+    uint32_t next_id_ = 0;             // 下一次零拷贝 sendmsg 的序号（与内核的 sk_zckey 同步递增）
+    std::deque<Pending> pending_;
+    std::vector<std::vector<uint8_t>> spare_headers_;
+    std::multimap<size_t, char *> free_bodies_;  // 可用容量 -> 空闲 body 的分配起点
+    bool watched_ = false;             // 回收线程正在监听该 socket；否则由发送线程在每次 send 前自行读取
+};
+
+/**
+ * 为已连接的 TCP socket 开启 SO_ZEROCOPY 并创建发送端（首次调用时启动回收线程）
+ * @param threshold body 不小于该字节数的视频消息走零拷贝
+ * @param stats 连接的发送统计，完成通知相关计数在 mutex_ 内更新
+ * @return 非 Linux、内核不支持或 socket 不是 TCP（如用户态 TLS 的 socketpair）时返回空
+ */
+std::shared_ptr<ZeroCopySender> zerocopy_sender_create(int fd, uint32_t threshold, std::shared_ptr<SendStats> stats);
+
+#endif // ZEROCOPY_SENDER_H
@@ -5,6 +5,110 @@ public class RtmpNative {
         System.loadLibrary("bb_rtmp");
     }
 
+    /** 关键帧请求原因：新连接/重连/新推流目标，尚未发送过关键帧 */
+    public static final int KEYFRAME_REASON_NEW_STREAM = 1;
+    /** 关键帧请求原因：丢帧切断了参考链 */
+    public static final int KEYFRAME_REASON_FRAME_DROPPED = 2;
+
+    /** 断网缓存：重连后快于实时补发积压数据 */
+    public static final int SPOOL_MODE_DRAIN = 0;
+    /** 断网缓存：重连后丢弃积压数据，直接恢复直播 */
+    public static final int SPOOL_MODE_DISCARD = 1;
+
+    /** 视频编码：H.264（默认） */
+    public static final int VIDEO_CODEC_H264 = 7;
+    /** 视频编码：HEVC，以 Enhanced RTMP FourCC 'hvc1' 发送 */
+    public static final int VIDEO_CODEC_HEVC = 12;
+
+    /** 音频编码：AAC（默认） */
+    public static final int AUDIO_CODEC_AAC = 10;
+    /** 音频编码：Opus，以 Enhanced RTMP FourCC 'Opus' 发送，需服务端支持 */
+    public static final int AUDIO_CODEC_OPUS = 13;
+
+    /** 零拷贝发送：队列满，非关键帧未入队，缓冲区仍归调用方 */
+    public static final int ASYNC_QUEUE_FULL = -2;
+    /** 零拷贝发送释放结果：已入队但未发送即被丢弃（关键帧清空积压或连接关闭） */
+    public static final int ASYNC_DROPPED = -3;
+    /** 限时发送（setSendDeadline）：上一帧未能在期限内写完，本帧未发送，连接保持可用 */
+    public static final int SEND_WOULD_BLOCK = -4;
+    /** playRead 返回值：等待期限内没有收到数据，连接保持可用 */
+    public static final int PLAY_READ_TIMEOUT = -5;
+
+    /** 帧环媒体类型：视频 */
+    public static final int RING_VIDEO = 0;
+    /** 帧环媒体类型：音频 */
+    public static final int RING_AUDIO = 1;
+
+    /** ringSend 返回标志：消费了一帧 */
+    public static final int RING_CONSUMED = 1;
+    /** ringSend 返回标志：该帧为关键帧 */
+    public static final int RING_KEYFRAME = 2;
+    /** ringSend 返回标志：该帧写入了断网缓存 */
+    public static final int RING_SPOOLED = 4;
+
+    /** RTMPS 传输方式：明文 RTMP */
+    public static final int TLS_MODE_NONE = 0;
+    /** RTMPS 传输方式：内核 TLS，收发均由内核加解密 */
+    public static final int TLS_MODE_KERNEL = 1;
+    /** RTMPS 传输方式：用户态 TLS（中继线程转发） */
+    public static final int TLS_MODE_USERSPACE = 2;
+
+    /** tlsConfigure 标志：不校验服务端证书（仅用于测试） */
+    public static final int TLS_NO_VERIFY = 1;
+    /** tlsConfigure 标志：不使用内核 TLS */
+    public static final int TLS_NO_KTLS = 2;
+    /** tlsConfigure 标志：限制为 TLS 1.2，使收发两个方向都可装入内核 */
+    public static final int TLS_FULL_OFFLOAD = 4;
+
+    /** TCP Fast Open 结果：未使用（未开启、SOCKS 代理或内核不支持） */
+    public static final int FAST_OPEN_OFF = 0;
+    /** TCP Fast Open 结果：C0+C1 随 SYN 发出并被服务端确认 */
+    public static final int FAST_OPEN_USED = 1;
+    /** TCP Fast Open 结果：没有缓存的 cookie，照常握手并请求 cookie */
+    public static final int FAST_OPEN_NO_COOKIE = 2;
+    /** TCP Fast Open 结果：SYN 携带的数据未被确认，由内核在握手后重传 */
+    public static final int FAST_OPEN_REFUSED = 3;
+    /** TCP Fast Open 结果：携带数据的 SYN 之后连接失败，已关闭 TFO 重新连接 */
+    public static final int FAST_OPEN_FALLBACK = 4;
+
+    /** 发送后端：librtmp 逐 chunk send（默认） */
+    public static final int TRANSPORT_SOCKET = 0;
+    /** 发送后端：io_uring（注册缓冲区 + 链接的写请求，多连接批量提交） */
+    public static final int TRANSPORT_URING = 1;
+
+    /** 推流引擎会话状态：TCP 连接中 */
+    public static final int ENGINE_CONNECTING = 0;
+    /** 推流引擎会话状态：RTMP 握手与 connect/createStream/publish 命令 */
+    public static final int ENGINE_HANDSHAKING = 1;
+    /** 推流引擎会话状态：推流中 */
+    public static final int ENGINE_PUBLISHING = 2;
+    /** 推流引擎会话状态：断线后等待重连 */
+    public static final int ENGINE_RECONNECT_WAIT = 3;
+    /** 推流引擎会话状态：重连次数用尽 */
+    public static final int ENGINE_FAILED = 4;
+    /** 推流引擎会话状态：已关闭 */
+    public static final int ENGINE_CLOSED = 5;
+    /** engineSendVideo/engineSendAudio 返回值：本帧被丢弃（队列超限、等待关键帧或会话已失败） */
+    public static final int ENGINE_DROPPED = -5;
+
+    /**
+     * 关键帧请求监听器（在发送线程上回调，实现应尽快返回）
+     */
+    public interface KeyFrameRequestListener {
+        void onKeyFrameRequest(int reason);
+    }
+
+    /**
+     * 零拷贝发送的缓冲区释放监听器（在 native 发送线程上回调，实现应尽快返回）。回调后 native 不再访问该缓冲区
+     */
+    public interface BufferReleaseListener {
+        /**
+         * @param token sendVideoAsync 传入的释放令牌
+         * @param result 0 已发送，ASYNC_DROPPED 未发送即丢弃，其他负数为发送失败
+         */
+        void onBufferReleased(long token, int result);
+    }
+
     /**
      * 初始化 RTMP 连接
      * @param url RTMP 推流地址
@@ -25,10 +129,27 @@ public class RtmpNative {
      */
     public static native int setMetadata(long handle, int width, int height, int videoBitrate, int fps, int audioSampleRate, int audioChannels);
 
+    /**
+     * 设置视频编码（需在发送第一帧视频之前调用）
+     * @param handle 连接句柄
+     * @param codec VIDEO_CODEC_H264 或 VIDEO_CODEC_HEVC
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int setVideoCodec(long handle, int codec);
+
+    /**
+     * 设置音频编码（需在发送第一帧音频之前调用）
+     * @param handle 连接句柄
+     * @param codec AUDIO_CODEC_AAC 或 AUDIO_CODEC_OPUS
+     * @param bitrate 音频码率（bps），<= 0 使用默认值
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int setAudioCodec(long handle, int codec, int bitrate);
+
     /**
      * 发送视频数据
      * @param handle 连接句柄
-     * @param data 视频数据（H.264 NAL 单元）
+     * @param data 视频数据（Annex-B 格式的 H.264/HEVC NAL 单元）
      * @param size 数据大小
      * @param timestamp 时间戳（微秒）
      * @param isKeyFrame 是否为关键帧
@@ -51,7 +172,7 @@ public class RtmpNative {
     /**
      * 发送音频数据
      * @param handle 连接句柄
-     * @param data 音频数据（AAC）
+     * @param data 音频数据（AAC 帧或单个 Opus 包）
      * @param size 数据大小
      * @param timestamp 时间戳（微秒）
      * @return 成功返回 0，失败返回负数
@@ -69,6 +190,313 @@ public class RtmpNative {
      */
     public static native int sendAudioBuffer(long handle, long buffer, int offset, int size, long timestamp);
 
+    /**
+     * 异步发送视频数据，native 发送线程直接读取 buffer（如 MediaCodec 输出缓冲区），不拷贝。
+     * 返回 0 时缓冲区归 native 所有，直至 BufferReleaseListener 以 token 回调；需先调用 setBufferReleaseListener
+     * @param handle 连接句柄
+     * @param buffer 直接 ByteBuffer（Annex-B 格式的 H.264/HEVC NAL 单元）
+     * @param offset 数据偏移
+     * @param size 数据大小
+     * @param timestamp 时间戳（微秒）
+     * @param isKeyFrame 是否为关键帧
+     * @param token 释放令牌
+     * @return 入队成功返回 0；失败返回负数（不会回调，缓冲区仍归调用方），ASYNC_QUEUE_FULL 表示丢弃了非关键帧
+     */
+    public static native int sendVideoAsync(long handle, java.nio.ByteBuffer buffer, int offset, int size, long timestamp, boolean isKeyFrame, long token);
+
+    /**
+     * 注册零拷贝发送的缓冲区释放监听器并启动 native 发送线程
+     * @param handle 连接句柄
+     * @param listener 监听器，传 null 停止发送线程（未发送的缓冲区以 ASYNC_DROPPED 回调）
+     * @param maxQueued 最多排队的帧数，<= 0 使用默认值 3
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int setBufferReleaseListener(long handle, BufferReleaseListener listener, int maxQueued);
+
+    /**
+     * 注册关键帧请求监听器。注册时若连接尚未发送过关键帧（新连接/重连），会立即回调一次
+     * @param handle 连接句柄
+     * @param listener 监听器，传 null 取消注册
+     * @param minIntervalMs 两次请求的最小间隔（毫秒），<= 0 使用默认值 1000
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int setKeyFrameRequestListener(long handle, KeyFrameRequestListener listener, int minIntervalMs);
+
+    /**
+     * 通知 native 层上层丢弃了视频帧（参考链断开，native 将丢弃非关键帧直至下一个关键帧）
+     * @param handle 连接句柄
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int notifyVideoDropped(long handle);
+
+    /**
+     * 开始后台心跳：native 定时器发送一次关键帧后按 fps 发送合成的 P_Skip 帧（每帧仅几个字节），
+     * 定期重发关键帧，音频断流时补发静音帧。仅支持 H.264
+     * @param handle 连接句柄
+     * @param keyframe 最近的 IDR 帧（Annex-B）
+     * @param size 数据大小
+     * @param timestamp 心跳首帧的时间戳（毫秒）
+     * @param fps 心跳帧率，<= 0 使用默认值 5
+     * @param keyframeIntervalMs 重发关键帧的间隔（毫秒），<= 0 不重发
+     * @return 成功返回 0；不支持时返回负数，调用方可回退为重发关键帧
+     */
+    public static native int heartbeatStart(long handle, byte[] keyframe, int size, long timestamp, int fps,
+                                            int keyframeIntervalMs);
+
+    /**
+     * 停止后台心跳，之后丢弃非关键帧直至下一个关键帧，并请求关键帧
+     * @param handle 连接句柄
+     * @return 成功返回 0，未在心跳中返回负数
+     */
+    public static native int heartbeatStop(long handle);
+
+    /**
+     * 开始本地 FLV 录制，写入与推流相同的数据（与发送共享缓冲区，磁盘慢时丢弃录制数据，不影响推流）
+     * @param handle 连接句柄
+     * @param path 录制文件路径；开启切分时文件名为 <path 去掉 .flv>_<序号>.flv
+     * @param maxSegmentBytes 单个文件最大字节数，<= 0 不按大小切分
+     * @param maxSegmentDurationMs 单个文件最大时长（毫秒），<= 0 不按时长切分
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int startRecording(long handle, String path, long maxSegmentBytes, int maxSegmentDurationMs);
+
+    /**
+     * 停止本地 FLV 录制（写完剩余数据并回填文件头）
+     * @param handle 连接句柄
+     * @return 成功返回 0，未在录制或写盘（含回填文件头）失败返回负数
+     */
+    public static native int stopRecording(long handle);
+
+    /**
+     * 创建断网缓存（环形文件，写满后淘汰最旧的帧），可跨重连复用
+     * @param path 缓存文件路径，关闭时删除
+     * @param capacityBytes 缓存容量（字节）
+     * @return 缓存句柄，失败返回 0
+     */
+    public static native long spoolOpen(String path, long capacityBytes);
+
+    /**
+     * 连接断开时调用，之后写入的帧进入缓存
+     * @param spool 缓存句柄
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int spoolBegin(long spool);
+
+    /**
+     * 写入视频帧到缓存
+     * @return 已缓存返回 0；缓存未激活返回 1，应直接发送；失败返回负数
+     */
+    public static native int spoolVideo(long spool, byte[] data, int size, long timestamp, boolean isKeyFrame);
+
+    /**
+     * 写入音频帧到缓存
+     * @return 已缓存返回 0；缓存未激活返回 1，应直接发送；失败返回负数
+     */
+    public static native int spoolAudio(long spool, byte[] data, int size, long timestamp);
+
+    /**
+     * 重连成功后排空缓存（阻塞），完成后缓存转为未激活
+     * @param spool 缓存句柄
+     * @param handle 新的连接句柄
+     * @param mode SPOOL_MODE_DRAIN 或 SPOOL_MODE_DISCARD
+     * @param speedPercent 补发速度（相对实时的百分比），<= 0 不限速
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int spoolDrain(long spool, long handle, int mode, int speedPercent);
+
+    /**
+     * 获取断网缓存统计信息
+     * @param spool 缓存句柄
+     * @return 统计信息数组 [积压字节数, 积压帧数, 淘汰帧数, 补发速率(B/s), 累计补发字节数]
+     */
+    public static native long[] getSpoolStats(long spool);
+
+    /**
+     * 关闭断网缓存并删除缓存文件
+     * @param spool 缓存句柄
+     */
+    public static native void spoolClose(long spool);
+
+    /**
+     * 创建帧环（编码回调线程写入、发送线程原地发送的单生产者/单消费者队列）
+     * @param media RING_VIDEO 或 RING_AUDIO
+     * @param capacityBytes 数据区大小，需大于最大帧
+     * @param maxFrames 最多排队的帧数，达到后非关键帧被拒绝、关键帧清空积压后入队
+     * @return 帧环句柄，失败返回 0
+     */
+    public static native long ringCreate(int media, long capacityBytes, int maxFrames);
+
+    /**
+     * 获取帧环数据区（直接 ByteBuffer，与 native 共享同一块内存）
+     * @param ring 帧环句柄
+     * @return 数据区，失败返回 null
+     */
+    public static native java.nio.ByteBuffer ringBuffer(long ring);
+
+    /**
+     * 生产者：预留一帧的空间，之后把帧数据写入数据区的返回偏移处并调用 ringCommit
+     * @param ring 帧环句柄
+     * @param size 帧大小
+     * @param isKeyFrame 是否为关键帧
+     * @return 数据区偏移，环满返回负数（该帧应丢弃）
+     */
+    public static native long ringReserve(long ring, int size, boolean isKeyFrame);
+
+    /**
+     * 生产者：发布最近一次预留的帧
+     * @param ring 帧环句柄
+     * @param timestamp 时间戳
+     * @return 为关键帧清空的积压帧数，失败返回负数
+     */
+    public static native int ringCommit(long ring, long timestamp);
+
+    /**
+     * 生产者：丢弃已发布但尚未发送的帧
+     * @param ring 帧环句柄
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int ringFlush(long ring);
+
+    /**
+     * 消费者：等待并原地发送一帧（断网缓存处于缓存状态时写入缓存）
+     * @param ring 帧环句柄
+     * @param handle 连接句柄，为 0 时丢弃
+     * @param spool 断网缓存句柄，0 表示未启用
+     * @param timeoutMs 队列为空时的最长等待时间（毫秒）
+     * @return 非负为 RING_* 标志组合，发送失败返回负数
+     */
+    public static native int ringSend(long ring, long handle, long spool, int timeoutMs);
+
+    /**
+     * 唤醒阻塞在 ringSend 中的发送线程
+     * @param ring 帧环句柄
+     */
+    public static native void ringWakeup(long ring);
+
+    /**
+     * 获取帧环占用统计
+     * @param ring 帧环句柄
+     * @return 统计信息数组 [容量, 占用字节数, 占用峰值, 排队帧数, 排队帧数峰值, 累计写入帧数, 环满丢弃帧数, 插队清空帧数, 唤醒次数]
+     */
+    public static native long[] ringGetStats(long ring);
+
+    /**
+     * 销毁帧环（需先停止发送线程）
+     * @param ring 帧环句柄
+     */
+    public static native void ringDestroy(long ring);
+
+    /**
+     * 创建音视频时钟（音频时间戳由累计采样数推算，视频逐步校正到同一条时间线，两条轨道各自严格递增）
+     * @param sampleRate 音频采样率
+     * @return 时钟句柄，失败返回 0
+     */
+    public static native long clockCreate(int sampleRate);
+
+    /**
+     * 计算音频帧时间戳
+     * @param clock 时钟句柄
+     * @param captureUs 采集时间（MediaCodec presentationTimeUs，System.nanoTime 时基）
+     * @param samples 本帧采样数（AAC 为 1024，Opus 20ms 为 960）
+     * @return 时间戳（毫秒），失败返回负数
+     */
+    public static native long clockAudio(long clock, long captureUs, int samples);
+
+    /**
+     * 计算视频帧时间戳
+     * @param clock 时钟句柄
+     * @param captureUs 采集时间（与音频相同的时基，微秒）
+     * @return 时间戳（毫秒），失败返回负数
+     */
+    public static native long clockVideo(long clock, long captureUs);
+
+    /**
+     * 获取时钟统计
+     * @param clock 时钟句柄
+     * @return 统计信息数组 [漂移(us), 视频校正量(us), 累计采样数, 音频重新锚定次数, 音频递增修正次数, 视频递增修正次数, 最近音频时间戳(ms), 最近视频时间戳(ms)]
+     */
+    public static native long[] clockGetStats(long clock);
+
+    /**
+     * 销毁时钟
+     * @param clock 时钟句柄
+     */
+    public static native void clockDestroy(long clock);
+
+    /**
+     * 创建事件驱动推流引擎：少量 epoll 线程驱动大量推流会话（只支持明文 RTMP、H.264 + AAC），参数为 0 时取默认值
+     * @param threads epoll 线程数（1）
+     * @param chunkSize 输出 chunk size（4096）
+     * @param maxQueueBytes 每个会话排队待发的字节上限（1 MB），超过时丢帧并等待下一个关键帧
+     * @param connectTimeoutMs TCP 连接到 publish 成功的超时（10000）
+     * @param pingIntervalMs ping 请求间隔（5000），负数不发送
+     * @param pingTimeoutMs 收不到数据或发送停滞判定断线的时长（15000）
+     * @param reconnectMinMs 首次重连等待（500），之后指数退避并加随机抖动
+     * @param reconnectMaxMs 重连等待上限（30000）
+     * @param maxReconnects 连续重连失败次数上限（无限制），负数不重连
+     * @return 引擎句柄，失败返回 0
+     */
+    public static native long engineCreate(int threads, int chunkSize, int maxQueueBytes, int connectTimeoutMs,
+                                           int pingIntervalMs, int pingTimeoutMs, int reconnectMinMs,
+                                           int reconnectMaxMs, int maxReconnects);
+
+    /**
+     * 在引擎中打开推流会话，立即返回，连接与 publish 在引擎线程上进行
+     * @param engine 引擎句柄
+     * @param url rtmp:// 推流地址
+     * @return 会话句柄，地址无效或解析失败返回 0
+     */
+    public static native long engineOpen(long engine, String url);
+
+    /**
+     * 设置会话的 onMetaData 信息与 AAC 参数
+     * @param session 会话句柄
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int engineSetMetadata(long session, int width, int height, int videoBitrate, int fps,
+                                               int audioSampleRate, int audioChannels);
+
+    /**
+     * 送入一帧 H.264 Annex-B 视频（数据被复制，调用返回后即可复用数组）
+     * @param session 会话句柄
+     * @return 已入队返回 0，丢帧返回 ENGINE_DROPPED，失败返回 -1
+     */
+    public static native int engineSendVideo(long session, byte[] data, int size, long timestamp, boolean isKeyFrame);
+
+    /**
+     * 送入一帧 AAC 音频（数据被复制）
+     * @param session 会话句柄
+     * @return 已入队返回 0，丢帧返回 ENGINE_DROPPED，失败返回 -1
+     */
+    public static native int engineSendAudio(long session, byte[] data, int size, long timestamp);
+
+    /**
+     * 获取推流会话统计
+     * @param session 会话句柄
+     * @return 统计信息数组 [状态 ENGINE_*, 重连次数, 发送字节数, 视频帧数, 音频帧数, 丢帧数, 排队字节数, ping 往返(us，无测量为 -1), 最近一次连接耗时(us)]
+     */
+    public static native long[] engineGetSessionStats(long session);
+
+    /**
+     * 获取推流引擎统计
+     * @param engine 引擎句柄
+     * @return 统计信息数组 [epoll 线程数, 会话数, 推流中会话数, epoll 唤醒次数, sendmsg 次数, 发送字节数, 线程 CPU 时间(us)]
+     */
+    public static native long[] engineGetStats(long engine);
+
+    /**
+     * 关闭推流会话：先写完已入队的帧并发送 FCUnpublish/deleteStream
+     * @param session 会话句柄
+     * @param timeoutMs 等待排队数据写完的毫秒数
+     */
+    public static native void engineClose(long session, int timeoutMs);
+
+    /**
+     * 销毁推流引擎及其中全部会话
+     * @param engine 引擎句柄
+     */
+    public static native void engineDestroy(long engine);
+
     /**
      * 获取网络统计信息
      * @param handle 连接句柄
@@ -76,6 +504,192 @@ public class RtmpNative {
      */
     public static native long[] getStats(long handle);
 
+    /** 扩展统计数组布局：头部计数器下标 */
+    public static final int STATS_V2_VERSION = 0;
+    public static final int STATS_V2_VIDEO_BYTES = 1;
+    public static final int STATS_V2_VIDEO_MESSAGES = 2;
+    public static final int STATS_V2_AUDIO_BYTES = 3;
+    public static final int STATS_V2_AUDIO_MESSAGES = 4;
+    public static final int STATS_V2_DATA_BYTES = 5;
+    public static final int STATS_V2_DATA_MESSAGES = 6;
+    public static final int STATS_V2_CHUNKS = 7;
+    public static final int STATS_V2_SEND_SYSCALLS = 8;
+    public static final int STATS_V2_SEND_FAILURES = 9;
+    public static final int STATS_V2_DROPPED_VIDEO_FRAMES = 10;
+    public static final int STATS_V2_QUEUE_DEPTH = 11;
+    public static final int STATS_V2_MAX_QUEUE_DEPTH = 12;
+    /** 直方图数量与起始下标：依次为 入队到写出、单次发送耗时、视频帧间隔、零拷贝完成延迟 */
+    public static final int STATS_V2_HISTOGRAM_COUNT = 4;
+    public static final int STATS_V2_HISTOGRAM_OFFSET = 13;
+    /** 直方图桶数（与 native RTMP_HISTOGRAM_BUCKETS 一致） */
+    public static final int STATS_V2_HISTOGRAM_BUCKETS = 96;
+    /** 每个直方图的字段：[样本数, 总和, 最大值, p50, p90, p99, p99.9, 桶...]，单位微秒 */
+    public static final int STATS_V2_HISTOGRAM_FIELDS = 7 + STATS_V2_HISTOGRAM_BUCKETS;
+    /** 直方图之后的零拷贝计数：[零拷贝消息数, 零拷贝写出字节数, 确认免拷贝字节数, 内核回退拷贝字节数] */
+    public static final int STATS_V2_ZEROCOPY_OFFSET =
+            STATS_V2_HISTOGRAM_OFFSET + STATS_V2_HISTOGRAM_COUNT * STATS_V2_HISTOGRAM_FIELDS;
+    public static final int STATS_V2_ZEROCOPY_FIELDS = 4;
+    /** 零拷贝计数之后的限时发送计数：[未发送即返回 SEND_WOULD_BLOCK 的帧数, 写到期限留待续写的消息数, 续写字节数] */
+    public static final int STATS_V2_DEADLINE_OFFSET = STATS_V2_ZEROCOPY_OFFSET + STATS_V2_ZEROCOPY_FIELDS;
+    public static final int STATS_V2_DEADLINE_FIELDS = 3;
+
+    /**
+     * 获取扩展统计信息（一次调用返回全部计数器与延迟直方图，不阻塞发送线程）
+     * @param handle 连接句柄
+     * @return 按 STATS_V2_* 布局的数组，失败返回 null
+     */
+    public static native long[] getStatsV2(long handle);
+
+    /**
+     * 配置 RTMPS（rtmps:// 地址）的证书校验与内核 TLS 选项，对之后 init 建立的连接生效（需以 BB_RTMP_TLS 编译 native 库）
+     * @param caFile CA 证书文件（PEM），为 null 时使用系统默认路径
+     * @param flags TLS_NO_VERIFY / TLS_NO_KTLS / TLS_FULL_OFFLOAD 按位组合
+     * @return 成功返回 0，未编译 RTMPS 支持返回负数
+     */
+    public static native int tlsConfigure(String caFile, int flags);
+
+    /**
+     * 获取连接的 RTMPS 传输信息
+     * @param handle 连接句柄
+     * @return [传输方式 TLS_MODE_*, 发送方向内核加密(0/1), 接收方向内核解密(0/1), 中继发出字节数, 中继收到字节数]，失败返回 null
+     */
+    public static native long[] getTlsInfo(long handle);
+
+    /**
+     * 开启或关闭 TCP Fast Open，对之后 init 建立的连接生效（默认关闭）：有缓存的 cookie 时 C0+C1 随 SYN 发出，
+     * 服务端拒绝时照常握手
+     * @param enable 是否开启
+     * @return 成功返回 0，内核头文件不支持 TCP_FASTOPEN_CONNECT 时开启返回负数
+     */
+    public static native int setFastOpen(boolean enable);
+
+    /**
+     * 获取连接建立各阶段的耗时（微秒）
+     * @param handle 连接句柄
+     * @return [TFO 结果 FAST_OPEN_*, 解析主机名, TCP 握手, TLS 握手, RTMP 握手与 connect, createStream 与 publish,
+     *         总耗时, 平滑 RTT, TFO 节省的往返]，失败返回 null
+     */
+    public static native long[] getConnectTiming(long handle);
+
+    /**
+     * 选择连接的发送后端（io_uring 需以 BB_RTMP_URING 编译 native 库；普通应用进程的 seccomp 策略禁止 io_uring）
+     * @param handle 连接句柄
+     * @param transport TRANSPORT_SOCKET / TRANSPORT_URING
+     * @return 成功返回 0，不可用时返回负数（连接保持 socket 后端）
+     */
+    public static native int setTransport(long handle, int transport);
+
+    /**
+     * 获取 io_uring 发送引擎的累计统计（进程内所有连接）
+     * @return [引擎已初始化(0/1), 连接数, io_uring_enter 次数, 写 SQE 数, 多连接批量提交次数, 写完消息数, 写出字节数,
+     *         断点重新提交次数, 超时取消次数]，失败返回 null
+     */
+    public static native long[] getUringStats();
+
+    /**
+     * 开启或关闭大视频帧的 MSG_ZEROCOPY 发送（Linux 4.14+，仅明文 RTMP 的 TCP 连接）
+     * @param handle 连接句柄
+     * @param thresholdBytes body 不小于该字节数的视频帧走零拷贝，<= 0 关闭
+     * @param chunkSize 同时设置的输出 chunk size（128 ~ 0xFFFFFF），<= 0 保持不变；零拷贝需要大 chunk 才有收益
+     * @return 成功返回 0，不可用时返回负数（连接保持拷贝发送）
+     */
+    public static native int setZeroCopy(long handle, int thresholdBytes, int chunkSize);
+
+    /**
+     * 开启或关闭限时非阻塞发送：上行停滞时发送接口最多阻塞到帧进入后 deadlineMs，写到期限的消息之后从断点续写，
+     * 续写未完成时 sendVideo/sendAudio 返回 SEND_WOULD_BLOCK（与 io_uring 后端、MSG_ZEROCOPY 互斥，不支持 RTMPT）
+     * @param handle 连接句柄
+     * @param deadlineMs 每帧的发送期限（毫秒），<= 0 关闭
+     * @return 成功返回 0，失败返回负数
+     */
+    public static native int setSendDeadline(long handle, int deadlineMs);
+
+    /**
+     * 续写限时发送中未写完的消息
+     * @param handle 连接句柄
+     * @param timeoutMs 最多等待的毫秒数，0 只尝试一次
+     * @return 已写完返回 0，超时返回 SEND_WOULD_BLOCK，连接错误返回 -1
+     */
+    public static native int flush(long handle, int timeoutMs);
+
+    /**
+     * 开启或关闭 RTMPT（HTTP 隧道）连接的批量发送：合并窗口内的全部消息合并为一个 POST，流水线发出请求并在后台读取应答
+     * （librtmp 原生 RTMPT 每条消息一个 POST 且从不读应答）。flush 立即发出已合并的消息；与 io_uring 后端、MSG_ZEROCOPY、
+     * 限时发送互斥
+     * @param handle 连接句柄（rtmpt://）
+     * @param windowMs 合并窗口（毫秒），0 不等待（只合并上一个 POST 写出期间积累的消息），< 0 关闭
+     * @return 成功返回 0，非 RTMPT 连接返回负数
+     */
+    public static native int setRtmptBatch(long handle, int windowMs);
+
+    /**
+     * 获取批量 RTMPT 发送的统计
+     * @param handle 连接句柄
+     * @return [POST /send 数, /idle 轮询数, 合并的消息数, POST 负载字节数, 收到的应答数, 应答中服务端下发的字节数,
+     *         当前在途请求数, 在途请求数峰值, 单个 POST 最大负载]，未开启批量发送时返回 null
+     */
+    public static native long[] getRtmptStats(long handle);
+
+    /**
+     * 打开 rtmp:// 拉流连接，返回时已收到 NetStream.Play.Start（不支持 RTMPT）
+     * @param url 拉流地址
+     * @param bufferMs 通知服务端的缓冲时长（毫秒），0 取 10000
+     * @return 拉流句柄，失败返回 0
+     */
+    public static native long playOpen(String url, int bufferMs);
+
+    /**
+     * 读取 FLV 字节流（首次读取以 FLV 文件头开始）。接收路径在环形缓冲区中原地解析 chunk 头，
+     * 消息体只拷贝一次，写进 buffer
+     * @param player 拉流句柄
+     * @param buffer 直接 ByteBuffer
+     * @param offset 写入起始位置
+     * @param size 最多写入的字节数
+     * @param timeoutMs 没有数据时最多等待的毫秒数
+     * @return 写入的字节数；流已结束返回 0；超时返回 PLAY_READ_TIMEOUT；出错返回 -1
+     */
+    public static native int playRead(long player, java.nio.ByteBuffer buffer, int offset, int size, int timeoutMs);
+
+    /**
+     * 获取拉流统计
+     * @param player 拉流句柄
+     * @return [消息数, 输出 tag 数, 输出 FLV 字节数, socket 读取字节数, recvmsg 次数, 零拷贝消息数,
+     *         从接收缓冲区拷贝的负载字节数, 直接读入消息缓冲区的负载字节数]
+     */
+    public static native long[] getPlayStats(long player);
+
+    /**
+     * 关闭拉流连接（等待正在进行的 playRead 返回）
+     * @param player 拉流句柄
+     */
+    public static native void playClose(long player);
+
+    /**
+     * 开启或关闭 native 异步日志（后台线程格式化，发送线程只拷贝参数）
+     * @param enable 是否开启
+     * @return 成功返回 0
+     */
+    public static native int setAsyncLogging(boolean enable);
+
+    /**
+     * 等待异步日志全部输出
+     */
+    public static native void flushLog();
+
+    /**
+     * 开启或关闭逐帧发送流水线追踪（需以 BB_RTMP_TRACE 编译 native 库）
+     * @param enable 是否开启
+     * @return 成功返回 0，未编译追踪支持返回负数
+     */
+    public static native int traceEnable(boolean enable);
+
+    /**
+     * 将追踪数据导出为 Chrome trace-event JSON（chrome://tracing 或 Perfetto 打开）
+     * @param path 输出文件路径
+     * @return 成功返回导出的事件数，失败返回负数
+     */
+    public static native int traceDump(String path);
+
     /**
      * 关闭 RTMP 连接
      * @param handle 连接句柄
@@ -3,19 +3,45 @@ package com.bb.rtmp
 import android.media.AudioFormat
 import android.media.AudioRecord
 import android.media.MediaCodec
+import android.media.MediaCodecList
 import android.media.MediaFormat
 import android.media.MediaRecorder
 import android.util.Log
 import java.nio.ByteBuffer
 import java.util.concurrent.atomic.AtomicBoolean
 
-class AudioEncoder {
+/**
+ * 推流音频编码，nativeId 与 native 层 rtmp_audio_codec 一致
+ */
+enum class AudioCodec(val mimeType: String, val nativeId: Int, val sampleRate: Int, val bitrate: Int) {
+    AAC(MediaFormat.MIMETYPE_AUDIO_AAC, RtmpNative.AUDIO_CODEC_AAC, 44100, 64000),
+    // Opus 固定 48kHz；32kbps 单声道语音已足够清晰，拥塞上行时比 64kbps AAC 省一半带宽
+    OPUS(MediaFormat.MIMETYPE_AUDIO_OPUS, RtmpNative.AUDIO_CODEC_OPUS, 48000, 32000);
+
+    companion object {
+        /**
+         * 解析上层传入的编码名（"aac" / "opus"）。Opus 需服务端支持 Enhanced RTMP，
+         * 设备没有 Opus 编码器（Android 10 以下）时回退到 AAC
+         */
+        fun resolve(name: String?): AudioCodec {
+            if (!name.equals("opus", ignoreCase = true)) return AAC
+            val hasEncoder = android.os.Build.VERSION.SDK_INT >= 29 &&
+                MediaCodecList(MediaCodecList.REGULAR_CODECS).codecInfos.any { info ->
+                    info.isEncoder && info.supportedTypes.any { it.equals(OPUS.mimeType, ignoreCase = true) }
+                }
+            if (!hasEncoder) Log.w("AudioEncoder", "设备不支持 Opus 编码，回退到 AAC")
+            return if (hasEncoder) OPUS else AAC
+        }
+    }
+}
+
+class AudioEncoder(val codec: AudioCodec = AudioCodec.AAC) {
     private val TAG = "AudioEncoder"
     private var mediaCodec: MediaCodec? = null
     private var audioRecord: AudioRecord? = null
-    private val sampleRate = 44100
+    private val sampleRate = codec.sampleRate
     private val channelCount = 1 // 单声道
-    private val bitrate = 64000 // 64kbps
+    private val bitrate = codec.bitrate
     private val isEncoding = AtomicBoolean(false)
     private var encoderCallback: EncoderCallback? = null
     private var recordThread: Thread? = null
@@ -35,12 +61,14 @@ class AudioEncoder {
      */
     fun initialize(): Boolean {
         try {
-            // 创建 AAC 编码器
-            val format = MediaFormat.createAudioFormat(MediaFormat.MIMETYPE_AUDIO_AAC, sampleRate, channelCount)
+            // 创建 AAC / Opus 编码器
+            val format = MediaFormat.createAudioFormat(codec.mimeType, sampleRate, channelCount)
             format.setInteger(MediaFormat.KEY_BIT_RATE, bitrate)
-            format.setInteger(MediaFormat.KEY_AAC_PROFILE, android.media.MediaCodecInfo.CodecProfileLevel.AACObjectLC)
+            if (codec == AudioCodec.AAC) {
+                format.setInteger(MediaFormat.KEY_AAC_PROFILE, android.media.MediaCodecInfo.CodecProfileLevel.AACObjectLC)
+            }
 
-            val encoder = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_AUDIO_AAC)
+            val encoder = MediaCodec.createEncoderByType(codec.mimeType)
             encoder.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE)
             encoder.start()
 
@@ -71,7 +99,7 @@ class AudioEncoder {
 
             this.audioRecord = audioRecord
             
-            Log.d(TAG, "音频编码器初始化成功: sampleRate=$sampleRate, bitrate=$bitrate")
+            Log.d(TAG, "音频编码器初始化成功: codec=$codec, sampleRate=$sampleRate, bitrate=$bitrate")
             return true
         } catch (e: Exception) {
             Log.e(TAG, "初始化音频编码器失败", e)
@@ -254,5 +282,10 @@ class AudioEncoder {
      * 获取声道数
      */
     fun getChannelCount(): Int = channelCount
+
+    /**
+     * 获取码率
+     */
+    fun getBitrate(): Int = bitrate
 }
 
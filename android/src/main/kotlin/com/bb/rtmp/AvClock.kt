@@ -0,0 +1,71 @@
+package com.bb.rtmp
+
+/**
+ * native 音视频时钟的 Kotlin 封装。
+ *
+ * 输入编码器输出的 presentationTimeUs（System.nanoTime 时基），返回同一条 RTMP 时间线上的毫秒时间戳：
+ * 音频按累计采样数推算，视频逐步校正到音频采样时钟，两条轨道各自严格递增。跨重连保持同一时钟。
+ */
+class AvClock(sampleRate: Int) {
+    @Volatile
+    private var clock: Long = RtmpNative.clockCreate(sampleRate)
+
+    val isValid: Boolean get() = clock != 0L
+
+    /**
+     * 音频帧时间戳（毫秒），时钟已释放返回 -1
+     * @param samples 本帧采样数
+     */
+    fun audio(ptsUs: Long, samples: Int): Long {
+        val c = clock
+        return if (c != 0L) RtmpNative.clockAudio(c, ptsUs, samples) else -1
+    }
+
+    /**
+     * 视频帧时间戳（毫秒），时钟已释放返回 -1
+     */
+    fun video(ptsUs: Long): Long {
+        val c = clock
+        return if (c != 0L) RtmpNative.clockVideo(c, ptsUs) else -1
+    }
+
+    /**
+     * 漂移与单调性修正统计，字段顺序见 RtmpNative.clockGetStats
+     */
+    fun stats(): AvClockStats? {
+        val c = clock
+        if (c == 0L) return null
+        val values = RtmpNative.clockGetStats(c) ?: return null
+        if (values.size < 8) return null
+        return AvClockStats(
+            driftUs = values[0],
+            correctionUs = values[1],
+            audioSamples = values[2],
+            audioResyncs = values[3],
+            audioClamped = values[4],
+            videoClamped = values[5],
+            lastAudioMs = values[6],
+            lastVideoMs = values[7]
+        )
+    }
+
+    fun release() {
+        val c = clock
+        clock = 0
+        if (c != 0L) RtmpNative.clockDestroy(c)
+    }
+}
+
+/**
+ * 音视频时钟统计
+ */
+data class AvClockStats(
+    val driftUs: Long,
+    val correctionUs: Long,
+    val audioSamples: Long,
+    val audioResyncs: Long,
+    val audioClamped: Long,
+    val videoClamped: Long,
+    val lastAudioMs: Long,
+    val lastVideoMs: Long
+)
@@ -37,6 +37,10 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
 
     private var cameraController: CameraController? = null
     private var videoEncoder: VideoEncoder? = null
+    // 推流视频编码（initialize 时确定，重建编码器时沿用）
+    private var videoCodec: VideoCodec = VideoCodec.H264
+    // 推流音频编码（默认 AAC；Opus 需服务端支持 Enhanced RTMP）
+    private var audioCodec: AudioCodec = AudioCodec.AAC
     private var audioEncoder: AudioEncoder? = null
     private var rtmpStreamer: RtmpStreamer? = null
     private var bitrateController: BitrateController? = null
@@ -292,7 +296,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                     if (glRenderer == null && fboInputSurfaceTexture != null && cameraController != null && glFboCanvasWidth > 0 && glFboCanvasHeight > 0) {
                         android.util.Log.i("BbRtmpPlugin", "Surface 重建后恢复编码器与 GlRenderer 并重启渲染循环")
                         val bitrate = bitrateController?.getCurrentBitrate() ?: videoEncoder?.getCurrentBitrate() ?: 2000000
-                        val newEncoder = VideoEncoder()
+                        val newEncoder = VideoEncoder(videoCodec)
                         val newSurface = newEncoder.initialize(glFboCanvasWidth, glFboCanvasHeight, bitrate, 30)
                         if (newSurface != null) {
                             val oldEncoder = videoEncoder
@@ -413,6 +417,8 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             val enableAudio = call.argument<Boolean>("enableAudio") ?: true
             val isPortrait = call.argument<Boolean>("isPortrait") ?: false
             val initialCameraFacing = call.argument<String>("initialCameraFacing") ?: "front"
+            videoCodec = VideoCodec.resolve(call.argument<String>("videoCodec"))
+            audioCodec = AudioCodec.resolve(call.argument<String>("audioCodec"))
             
             val ctx = context ?: return
             val registry = textureRegistry ?: return
@@ -467,7 +473,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             
 
             // 5. 初始化编码器
-            videoEncoder = VideoEncoder()
+            videoEncoder = VideoEncoder(videoCodec)
             val encoderSurface = videoEncoder!!.initialize(fboCanvasWidth, fboCanvasHeight, bitrate, fps)
             if (encoderSurface == null) {
                 result.error("ENCODER_INIT_FAILED", "视频编码器初始化失败", null)
@@ -476,7 +482,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             }
 
             if (enableAudio) {
-                audioEncoder = AudioEncoder()
+                audioEncoder = AudioEncoder(audioCodec)
                 audioEncoder!!.initialize()
             }
 
@@ -495,7 +501,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                     resultReplied = true
                     return
                 }
-                rtmpStreamer!!.setMetadata(fboCanvasWidth, fboCanvasHeight, bitrate, fps, 44100, 1)
+                rtmpStreamer!!.setMetadata(fboCanvasWidth, fboCanvasHeight, bitrate, fps, audioEncoder?.getSampleRate() ?: 44100, 1)
             }
 
             // 7. 初始化 FBO 和 GlRenderer
@@ -606,7 +612,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             kotlinx.coroutines.withContext(Dispatchers.Main) {
                 try {
                     val oldEncoder = videoEncoder
-                    videoEncoder = VideoEncoder()
+                    videoEncoder = VideoEncoder(videoCodec)
                     val bitrate = bitrateController!!.getCurrentBitrate()
                     val surface = videoEncoder!!.initialize(w, h, bitrate, 30)
                     if (surface == null) {
@@ -651,7 +657,8 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             "fps" to (call.argument<Int>("fps") ?: 30),
             "enableAudio" to false,  // 预览时不需要音频
             "isPortrait" to (call.argument<Boolean>("isPortrait") ?: false),
-            "initialCameraFacing" to (call.argument<String>("initialCameraFacing") ?: "front")
+            "initialCameraFacing" to (call.argument<String>("initialCameraFacing") ?: "front"),
+            "videoCodec" to (call.argument<String>("videoCodec") ?: "h264")
         )
         val previewCall = MethodCall("initializePreview", previewArgs)
         
@@ -670,6 +677,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
             val newRtmpUrl = call.argument<String>("rtmpUrl")
             val newBitrate = call.argument<Int>("bitrate") ?: 2000000
             val enableAudio = call.argument<Boolean>("enableAudio") ?: true
+            call.argument<String>("audioCodec")?.let { audioCodec = AudioCodec.resolve(it) }
             
             // 更新 RTMP URL
             if (newRtmpUrl != null && newRtmpUrl.isNotEmpty()) {
@@ -695,7 +703,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                     if (rtmpStreamer == null) {
                         // 初始化音频编码器（如果需要）
                         if (enableAudio && audioEncoder == null) {
-                            audioEncoder = AudioEncoder()
+                            audioEncoder = AudioEncoder(audioCodec)
                             audioEncoder!!.initialize()
                         }
                         
@@ -713,7 +721,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                         }
                         
                         // 设置 RTMP 元数据
-                        rtmpStreamer!!.setMetadata(glFboCanvasWidth, glFboCanvasHeight, newBitrate, 30, 44100, 1)
+                        rtmpStreamer!!.setMetadata(glFboCanvasWidth, glFboCanvasHeight, newBitrate, 30, audioEncoder?.getSampleRate() ?: 44100, 1)
                         
                         // 初始化码率控制器（ABR 一步到位切分辨率时热切换编码器）
                         bitrateController = BitrateController(videoEncoder!!, rtmpStreamer!!, cameraController!!)
@@ -949,7 +957,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                     imageReader = null
 
                     val bitrate = bitrateController?.getCurrentBitrate() ?: 2000000
-                    videoEncoder = VideoEncoder()
+                    videoEncoder = VideoEncoder(videoCodec)
                     val encoderSurface = videoEncoder!!.initialize(fboCanvasWidth, fboCanvasHeight, bitrate, 30)
                     if (encoderSurface == null) {
                         result.error("ENCODER_INIT_FAILED", "视频编码器初始化失败", null)
@@ -957,7 +965,7 @@ class BbRtmpPlugin : FlutterPlugin, MethodCallHandler, io.flutter.embedding.engi
                     }
 
                     audioEncoder?.let {
-                        val audio = AudioEncoder()
+                        val audio = AudioEncoder(audioCodec)
                         if (audio.initialize()) {
                             audioEncoder = audio
                         }
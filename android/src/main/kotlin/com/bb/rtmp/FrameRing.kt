@@ -0,0 +1,133 @@
+package com.bb.rtmp
+
+import java.nio.ByteBuffer
+
+/**
+ * native 单生产者/单消费者帧环的 Kotlin 封装。
+ *
+ * 数据区是 native 预分配的直接内存，帧数据只拷贝一次（编码器缓冲区 -> 帧环），
+ * 发送线程在 native 中原地发送，不再为每帧分配 ByteArray。
+ * 编码回调与心跳定时器都会写入视频帧环，写入过程用 producerLock 串行化，对 native 而言仍是单生产者。
+ */
+class FrameRing(media: Int, capacityBytes: Long, maxFrames: Int) {
+    @Volatile
+    private var ring: Long = RtmpNative.ringCreate(media, capacityBytes, maxFrames)
+    private val buffer: ByteBuffer? = if (ring != 0L) RtmpNative.ringBuffer(ring) else null
+    private val producerLock = Any()
+
+    val isValid: Boolean get() = ring != 0L && buffer != null
+
+    /**
+     * 写入一帧（从 src 的当前 position 起 size 字节，src 的 position 不变）
+     * @return 为该关键帧清空的积压帧数，帧环已满（帧被丢弃）返回 -1
+     */
+    fun push(src: ByteBuffer, size: Int, timestamp: Long, isKeyFrame: Boolean): Int {
+        val dst = buffer ?: return -1
+        synchronized(producerLock) {
+            // 发送线程退出时已释放帧环
+            val r = ring
+            if (r == 0L) return -1
+            val offset = RtmpNative.ringReserve(r, size, isKeyFrame)
+            if (offset < 0) return -1
+            val start = src.position()
+            val limit = src.limit()
+            src.limit(start + size)
+            dst.clear()
+            dst.position(offset.toInt())
+            dst.put(src)
+            src.limit(limit)
+            src.position(start)
+            return RtmpNative.ringCommit(r, timestamp)
+        }
+    }
+
+    /**
+     * 写入一帧（ByteArray 版本，用于心跳帧）
+     */
+    fun push(src: ByteArray, size: Int, timestamp: Long, isKeyFrame: Boolean): Int {
+        val dst = buffer ?: return -1
+        synchronized(producerLock) {
+            // 发送线程退出时已释放帧环
+            val r = ring
+            if (r == 0L) return -1
+            val offset = RtmpNative.ringReserve(r, size, isKeyFrame)
+            if (offset < 0) return -1
+            dst.clear()
+            dst.position(offset.toInt())
+            dst.put(src, 0, size)
+            return RtmpNative.ringCommit(r, timestamp)
+        }
+    }
+
+    /**
+     * 丢弃已写入但尚未发送的帧
+     */
+    fun flush() {
+        synchronized(producerLock) {
+            val r = ring
+            if (r != 0L) RtmpNative.ringFlush(r)
+        }
+    }
+
+    /**
+     * 发送线程：等待并发送一帧，返回值见 RtmpNative.ringSend
+     */
+    fun send(handle: Long, spool: Long, timeoutMs: Int): Int {
+        return if (ring != 0L) RtmpNative.ringSend(ring, handle, spool, timeoutMs) else 0
+    }
+
+    /**
+     * 唤醒阻塞在 send 中的发送线程
+     */
+    fun wakeup() {
+        if (ring != 0L) RtmpNative.ringWakeup(ring)
+    }
+
+    /**
+     * 占用统计，字段顺序见 RtmpNative.ringGetStats
+     */
+    fun stats(): FrameRingStats? {
+        if (ring == 0L) return null
+        val values = RtmpNative.ringGetStats(ring) ?: return null
+        if (values.size < 9) return null
+        return FrameRingStats(
+            capacityBytes = values[0],
+            usedBytes = values[1],
+            maxUsedBytes = values[2],
+            queuedFrames = values[3],
+            maxQueuedFrames = values[4],
+            pushedFrames = values[5],
+            droppedFrames = values[6],
+            flushedFrames = values[7],
+            wakeups = values[8]
+        )
+    }
+
+    /**
+     * 释放帧环。由发送线程在退出前调用，或在发送线程已退出后调用：native 每帧调用不持有帧环的引用
+     */
+    fun release() {
+        val r = ring
+        ring = 0
+        if (r != 0L) {
+            synchronized(producerLock) {
+                RtmpNative.ringDestroy(r)
+            }
+        }
+    }
+}
+
+/**
+ * 帧环占用统计
+ */
+data class FrameRingStats(
+    val capacityBytes: Long,
+    val usedBytes: Long,
+    val maxUsedBytes: Long,
+    val queuedFrames: Long,
+    val maxQueuedFrames: Long,
+    val pushedFrames: Long,
+    val droppedFrames: Long,
+    val flushedFrames: Long,
+    val wakeups: Long
+)
@@ -0,0 +1,153 @@
+package com.bb.rtmp
+
+/**
+ * native 事件驱动推流引擎的 Kotlin 封装。
+ *
+ * 少量 epoll 线程驱动大量推流会话（转推、多路录制等场景），不需要 RtmpStreamer 那样每路一个发送线程：
+ * 握手、命令、发送队列、ping 与断线重连都在引擎线程上完成，send* 只复制数据并入队。
+ * 只支持明文 rtmp://、H.264 + AAC。各参数为 0 时取 native 默认值，见 RtmpNative.engineCreate。
+ */
+class PublishEngine(
+    threads: Int = 1,
+    chunkSize: Int = 0,
+    maxQueueBytes: Int = 0,
+    connectTimeoutMs: Int = 0,
+    pingIntervalMs: Int = 0,
+    pingTimeoutMs: Int = 0,
+    reconnectMinMs: Int = 0,
+    reconnectMaxMs: Int = 0,
+    maxReconnects: Int = 0
+) {
+    @Volatile
+    private var engine: Long = RtmpNative.engineCreate(
+        threads, chunkSize, maxQueueBytes, connectTimeoutMs, pingIntervalMs, pingTimeoutMs,
+        reconnectMinMs, reconnectMaxMs, maxReconnects
+    )
+
+    val isValid: Boolean get() = engine != 0L
+
+    /**
+     * 打开推流会话，立即返回；地址无效、解析失败或引擎已释放返回 null
+     */
+    fun open(url: String): PublishSession? {
+        val e = engine
+        if (e == 0L) return null
+        val session = RtmpNative.engineOpen(e, url)
+        return if (session != 0L) PublishSession(session) else null
+    }
+
+    /**
+     * 引擎统计，字段顺序见 RtmpNative.engineGetStats
+     */
+    fun stats(): PublishEngineStats? {
+        val e = engine
+        if (e == 0L) return null
+        val values = RtmpNative.engineGetStats(e) ?: return null
+        if (values.size < 7) return null
+        return PublishEngineStats(
+            threads = values[0].toInt(),
+            sessions = values[1].toInt(),
+            publishing = values[2].toInt(),
+            wakeups = values[3],
+            writes = values[4],
+            bytesSent = values[5],
+            cpuUs = values[6]
+        )
+    }
+
+    /**
+     * 关闭全部会话并停止 epoll 线程，之后各 PublishSession 的调用返回失败
+     */
+    fun release() {
+        val e = engine
+        engine = 0
+        if (e != 0L) RtmpNative.engineDestroy(e)
+    }
+}
+
+/**
+ * 推流引擎中的一路会话
+ */
+class PublishSession internal constructor(handle: Long) {
+    @Volatile
+    private var session: Long = handle
+
+    fun setMetadata(width: Int, height: Int, videoBitrate: Int, fps: Int, sampleRate: Int, channels: Int): Int {
+        val s = session
+        return if (s != 0L) RtmpNative.engineSetMetadata(s, width, height, videoBitrate, fps, sampleRate, channels) else -1
+    }
+
+    /**
+     * 送入一帧 Annex-B 视频，返回 0、RtmpNative.ENGINE_DROPPED 或 -1
+     */
+    fun sendVideo(data: ByteArray, size: Int, timestamp: Long, isKeyFrame: Boolean): Int {
+        val s = session
+        return if (s != 0L) RtmpNative.engineSendVideo(s, data, size, timestamp, isKeyFrame) else -1
+    }
+
+    /**
+     * 送入一帧 AAC 音频，返回 0、RtmpNative.ENGINE_DROPPED 或 -1
+     */
+    fun sendAudio(data: ByteArray, size: Int, timestamp: Long): Int {
+        val s = session
+        return if (s != 0L) RtmpNative.engineSendAudio(s, data, size, timestamp) else -1
+    }
+
+    /**
+     * 会话统计，字段顺序见 RtmpNative.engineGetSessionStats
+     */
+    fun stats(): PublishSessionStats? {
+        val s = session
+        if (s == 0L) return null
+        val values = RtmpNative.engineGetSessionStats(s) ?: return null
+        if (values.size < 9) return null
+        return PublishSessionStats(
+            state = values[0].toInt(),
+            reconnects = values[1].toInt(),
+            bytesSent = values[2],
+            videoFrames = values[3],
+            audioFrames = values[4],
+            droppedFrames = values[5],
+            queuedBytes = values[6],
+            rttUs = values[7],
+            connectUs = values[8]
+        )
+    }
+
+    /**
+     * 写完已入队的帧后关闭会话，最多等待 timeoutMs
+     */
+    fun close(timeoutMs: Int = 1000) {
+        val s = session
+        session = 0
+        if (s != 0L) RtmpNative.engineClose(s, timeoutMs)
+    }
+}
+
+/**
+ * 推流引擎统计
+ */
+data class PublishEngineStats(
+    val threads: Int,
+    val sessions: Int,
+    val publishing: Int,
+    val wakeups: Long,
+    val writes: Long,
+    val bytesSent: Long,
+    val cpuUs: Long
+)
+
+/**
+ * 推流会话统计，state 为 RtmpNative.ENGINE_*，rttUs 尚无测量为 -1
+ */
+data class PublishSessionStats(
+    val state: Int,
+    val reconnects: Int,
+    val bytesSent: Long,
+    val videoFrames: Long,
+    val audioFrames: Long,
+    val droppedFrames: Long,
+    val queuedBytes: Long,
+    val rttUs: Long,
+    val connectUs: Long
+)
@@ -0,0 +1,77 @@
+package com.bb.rtmp
+
+import java.nio.ByteBuffer
+
+/**
+ * native 拉流读取的 Kotlin 封装：从 rtmp:// 地址读出 FLV 字节流（首次读取以 FLV 文件头开始）。
+ *
+ * 接收路径在环形缓冲区中原地解析 chunk 头，大消息直接读入消息缓冲区，消息体只拷贝一次，写进调用方的直接缓冲区。
+ * read 与 close 可在不同线程调用；close 等待正在进行的 read 返回。
+ */
+class RtmpPlayer private constructor(handle: Long) {
+    @Volatile
+    private var player: Long = handle
+
+    companion object {
+        /**
+         * 连接并开始拉流，返回时已收到 NetStream.Play.Start；失败（含 RTMPT 地址）返回 null
+         */
+        fun open(url: String, bufferMs: Int = 0): RtmpPlayer? {
+            val handle = RtmpNative.playOpen(url, bufferMs)
+            return if (handle != 0L) RtmpPlayer(handle) else null
+        }
+    }
+
+    /**
+     * 读取 FLV 字节写进 buffer 的 [position, limit)，成功时前移 position。
+     * 返回写入的字节数；流已结束返回 0；超时返回 RtmpNative.PLAY_READ_TIMEOUT；出错返回 -1
+     */
+    fun read(buffer: ByteBuffer, timeoutMs: Int): Int {
+        val p = player
+        if (p == 0L || !buffer.isDirect || !buffer.hasRemaining()) return -1
+        val n = RtmpNative.playRead(p, buffer, buffer.position(), buffer.remaining(), timeoutMs)
+        if (n > 0) buffer.position(buffer.position() + n)
+        return n
+    }
+
+    /**
+     * 拉流统计，字段顺序见 RtmpNative.getPlayStats
+     */
+    fun stats(): RtmpPlayStats? {
+        val p = player
+        if (p == 0L) return null
+        val values = RtmpNative.getPlayStats(p) ?: return null
+        if (values.size < 8) return null
+        return RtmpPlayStats(
+            messages = values[0],
+            tags = values[1],
+            flvBytes = values[2],
+            bytesIn = values[3],
+            recvCalls = values[4],
+            zeroCopyMessages = values[5],
+            copiedBytes = values[6],
+            directBytes = values[7]
+        )
+    }
+
+    fun close() {
+        val p = player
+        player = 0
+        if (p != 0L) RtmpNative.playClose(p)
+    }
+}
+
+/**
+ * 拉流统计：zeroCopyMessages 为消息体直接取自接收缓冲区的消息数，copiedBytes/directBytes 为拷贝进消息缓冲区与
+ * 直接读入消息缓冲区的负载字节数
+ */
+data class RtmpPlayStats(
+    val messages: Long,
+    val tags: Long,
+    val flvBytes: Long,
+    val bytesIn: Long,
+    val recvCalls: Long,
+    val zeroCopyMessages: Long,
+    val copiedBytes: Long,
+    val directBytes: Long
+)
@@ -6,11 +6,22 @@ import java.nio.ByteBuffer
 import java.nio.ByteOrder
 import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicLong
-import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.ConcurrentHashMap
 import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
 
 class RtmpStreamer {
     private val TAG = "RtmpStreamer"
+    // 关键帧请求最小间隔，避免拥塞时频繁 IDR 进一步加剧拥塞
+    private val KEYFRAME_REQUEST_MIN_INTERVAL_MS = 1000
+    // 发送帧环容量：视频按排队帧数限制积压，字节容量需容纳数个高码率关键帧
+    private val VIDEO_RING_BYTES = 4L * 1024 * 1024
+    private val VIDEO_RING_MAX_FRAMES = 5
+    private val AUDIO_RING_BYTES = 256L * 1024
+    private val AUDIO_RING_MAX_FRAMES = 60
+    // 从零拷贝路径切到帧环时等待异步队列发完的上限，超时则丢弃当前帧而不是乱序发送
+    private val ASYNC_DRAIN_TIMEOUT_MS = 500L
     private var rtmpHandle: Long = 0
     private var rtmpUrl: String = ""
     private val isStreaming = AtomicBoolean(false)
@@ -27,25 +38,30 @@ class RtmpStreamer {
         statusCallback = callback
     }
     
-    // 异步发送队列（避免阻塞编码器回调线程）
-    private data class VideoFrame(
-        val data: ByteArray,
-        val size: Int,
-        val timestamp: Long,
-        val isKeyFrame: Boolean
-    )
-    private val videoSendQueue = LinkedBlockingQueue<VideoFrame>(5) // 限制队列避免弱网下积压导致内存爆炸（与 iOS 一致）
+    // 音视频时钟：按编码器 PTS 计算时间戳（音频按采样数，视频校正到音频时钟），跨重连保持
+    @Volatile private var avClock: AvClock? = null
+
+    // 异步发送帧环（避免阻塞编码器回调线程）：帧数据写入 native 预分配内存，发送线程原地发送
+    @Volatile private var videoRing: FrameRing? = null
     private var videoSendThread: Thread? = null
     private val videoSendThreadRunning = AtomicBoolean(false)
-    private val videoQueueSize = AtomicInteger(0) // 缓存队列大小，避免频繁调用 size()
     
-    // 音频发送队列
-    private data class AudioFrame(
-        val data: ByteArray,
-        val size: Int,
-        val timestamp: Long
+    // 零拷贝发送中的编码器输出缓冲区：释放令牌 -> 所属编码器与缓冲区索引，native 发送完成后归还
+    private data class HeldBuffer(
+        val encoder: VideoEncoder,
+        val index: Int
     )
-    private val audioSendQueue = LinkedBlockingQueue<AudioFrame>(60) // 最多缓存 60 帧（约 2 秒）
+    private val heldBuffers = ConcurrentHashMap<Long, HeldBuffer>()
+    private val nextBufferToken = AtomicLong(1)
+
+    // 视频发送路径：零拷贝异步队列与帧环（拷贝路径、心跳）各自按序发送，切换前须等另一条路径排空，
+    // 否则帧乱序、DTS 回退。videoAsyncActive 只在 videoPathLock 内修改
+    private val videoPathLock = ReentrantLock()
+    private val asyncDrained = videoPathLock.newCondition()
+    @Volatile private var videoAsyncActive = false
+    
+    // 音频发送帧环
+    @Volatile private var audioRing: FrameRing? = null
     private var audioSendThread: Thread? = null
     private val audioSendThreadRunning = AtomicBoolean(false)
     
@@ -53,9 +69,6 @@ class RtmpStreamer {
     private val droppedFrames = AtomicInteger(0)
     private val sentFrames = AtomicInteger(0)
     private val sendErrorCount = AtomicInteger(0)
-
-    // 分辨率切换后仅发关键帧直至首帧关键帧发送，便于播放端恢复
-    private val resolutionChangePending = AtomicBoolean(false)
     
     // 静态计数器用于日志（避免日志过多）
     private var staticVideoFrameCount = 0
@@ -69,6 +82,13 @@ class RtmpStreamer {
     private var lastVideoInfo: MediaCodec.BufferInfo? = null
     private val heartbeatLock = Any()
     private var heartbeatTimer: java.util.Timer? = null
+    @Volatile
+    private var nativeHeartbeat = false
+    private var transport = RtmpNative.TRANSPORT_SOCKET
+    private var zeroCopyThreshold = 0
+    private var zeroCopyChunkSize = 0
+    private var sendDeadlineMs = 0
+    private var rtmptBatchMs = -1
 
     /**
      * 初始化 RTMP 推流器
@@ -84,9 +104,21 @@ class RtmpStreamer {
                 Log.e(TAG, "RTMP 初始化失败")
                 return false
             }
+            RtmpNative.setVideoCodec(rtmpHandle, videoEncoder.codec.nativeId)
+            audioEncoder?.let { RtmpNative.setAudioCodec(rtmpHandle, it.codec.nativeId, it.getBitrate()) }
+            applyTransport(rtmpHandle)
+            applyZeroCopy(rtmpHandle)
+            applySendDeadline(rtmpHandle)
+            applyRtmptBatch(rtmpHandle)
+            registerKeyFrameRequestListener(rtmpHandle)
+            registerBufferReleaseListener(rtmpHandle)
 
             // 设置编码器回调
             videoEncoder.setCallback(object : VideoEncoder.EncoderCallback {
+                override fun onEncodedBuffer(index: Int, data: ByteBuffer, info: MediaCodec.BufferInfo): Boolean {
+                    return isStreaming.get() && sendVideoBuffer(videoEncoder, index, data, info)
+                }
+
                 override fun onEncodedData(data: ByteBuffer, info: MediaCodec.BufferInfo) {
                     if (isStreaming.get()) {
                         sendVideoData(data, info)
@@ -143,7 +175,11 @@ class RtmpStreamer {
         videoEncoder = newEncoder
         savedSps = null
         savedPps = null
+        if (rtmpHandle != 0L) RtmpNative.setVideoCodec(rtmpHandle, newEncoder.codec.nativeId)
         newEncoder.setCallback(object : VideoEncoder.EncoderCallback {
+            override fun onEncodedBuffer(index: Int, data: ByteBuffer, info: MediaCodec.BufferInfo): Boolean {
+                return isStreaming.get() && sendVideoBuffer(newEncoder, index, data, info)
+            }
             override fun onEncodedData(data: ByteBuffer, info: MediaCodec.BufferInfo) {
                 if (isStreaming.get()) {
                     sendVideoData(data, info)
@@ -179,6 +215,7 @@ class RtmpStreamer {
         }
 
         startTime.set(System.currentTimeMillis()) // milliseconds
+        avClock = AvClock(audioEncoder?.getSampleRate() ?: 44100)
         isStreaming.set(true)
         
         // 重置统计
@@ -205,18 +242,30 @@ class RtmpStreamer {
     private fun startSendThreads() {
         // 启动视频发送线程
         if (!videoSendThreadRunning.get()) {
+            // 限制排队帧数避免弱网下积压（与 iOS 一致）
+            val ring = FrameRing(RtmpNative.RING_VIDEO, VIDEO_RING_BYTES, VIDEO_RING_MAX_FRAMES)
+            if (!ring.isValid) {
+                Log.e(TAG, "创建视频帧环失败")
+            }
+            videoRing = ring
             videoSendThreadRunning.set(true)
             videoSendThread = Thread {
-                videoSendLoop()
+                videoSendLoop(ring)
             }
             videoSendThread!!.start()
         }
         
         // 启动音频发送线程
         if (!audioSendThreadRunning.get()) {
+            // 最多缓存 60 帧（约 2 秒）
+            val ring = FrameRing(RtmpNative.RING_AUDIO, AUDIO_RING_BYTES, AUDIO_RING_MAX_FRAMES)
+            if (!ring.isValid) {
+                Log.e(TAG, "创建音频帧环失败")
+            }
+            audioRing = ring
             audioSendThreadRunning.set(true)
             audioSendThread = Thread {
-                audioSendLoop()
+                audioSendLoop(ring)
             }
             audioSendThread!!.start()
         }
@@ -230,9 +279,10 @@ class RtmpStreamer {
         audioSendThreadRunning.set(false)
         
         // 唤醒等待的线程
-        videoSendQueue.clear()
-        videoQueueSize.set(0) // 重置队列大小计数
-        audioSendQueue.clear()
+        val vRing = videoRing
+        val aRing = audioRing
+        vRing?.wakeup()
+        aRing?.wakeup()
         
         // 等待线程结束
         videoSendThread?.join(1000)
@@ -240,50 +290,51 @@ class RtmpStreamer {
         
         videoSendThread = null
         audioSendThread = null
+        
+        // 帧环由发送线程退出时释放（未发送的帧随之丢弃）：join 超时时线程可能仍在 native 发送中
+        videoRing = null
+        audioRing = null
     }
     
     /**
      * 视频发送循环（在独立线程中运行）
      */
-    private fun videoSendLoop() {
+    private fun videoSendLoop(ring: FrameRing) {
         Log.d(TAG, "视频发送线程启动")
         var lastLogTime = System.currentTimeMillis()
         var framesInLastSecond = 0
         
         while (videoSendThreadRunning.get() && isStreaming.get()) {
             try {
-                // 从队列中取出帧（最多等待 100ms）
-                val frame = videoSendQueue.poll(100, java.util.concurrent.TimeUnit.MILLISECONDS)
-                if (frame != null && rtmpHandle != 0L) {
-                    // 更新队列大小计数
-                    videoQueueSize.decrementAndGet()
-                    
-                    val sendStartTime = System.currentTimeMillis()
-                    val result = RtmpNative.sendVideo(rtmpHandle, frame.data, frame.size, frame.timestamp, frame.isKeyFrame)
-                    val sendDuration = System.currentTimeMillis() - sendStartTime
+                // 阻塞等待帧环中的帧（最多等待 100ms），断网期间由 native 写入磁盘缓存，重连后补发
+                val handle = rtmpHandle
+                val sendStartTime = System.currentTimeMillis()
+                val result = ring.send(handle, spoolHandle, 100)
+                val sendDuration = System.currentTimeMillis() - sendStartTime
+                
+                if (result == RtmpNative.SEND_WOULD_BLOCK) {
+                    // 上行停滞：native 已丢弃该帧并等待下一个关键帧，连接保持可用
+                    droppedFrames.incrementAndGet()
+                } else if (result < 0) {
+                    sendErrorCount.incrementAndGet()
+                    Log.w(TAG, "发送视频数据失败: $result, 耗时=${sendDuration}ms")
+                    handleSocketError(result)
+                } else if ((result and RtmpNative.RING_CONSUMED) != 0 &&
+                    (result and RtmpNative.RING_SPOOLED) == 0 && handle != 0L) {
+                    val isKeyFrame = (result and RtmpNative.RING_KEYFRAME) != 0
+                    sentFrames.incrementAndGet()
+                    framesInLastSecond++
                     
-                    if (result != 0) {
-                        sendErrorCount.incrementAndGet()
-                        Log.w(TAG, "发送视频数据失败: $result, 耗时=${sendDuration}ms")
-                        handleSocketError(result)
-                    } else {
-                        if (frame.isKeyFrame) {
-                            resolutionChangePending.set(false)
-                        }
-                        sentFrames.incrementAndGet()
-                        framesInLastSecond++
-                        
-                        // 如果发送耗时过长（>50ms），记录警告
-                        if (sendDuration > 50) {
-                            Log.w(TAG, "视频帧发送耗时过长: ${sendDuration}ms, size=${frame.size}, isKeyFrame=${frame.isKeyFrame}")
-                        }
+                    // 如果发送耗时过长（>50ms），记录警告（含等待帧的时间，仅作参考）
+                    if (sendDuration > 50) {
+                        Log.w(TAG, "视频帧发送耗时过长: ${sendDuration}ms, isKeyFrame=$isKeyFrame")
                     }
                 }
                 
                 // 每秒打印一次统计信息
                 val now = System.currentTimeMillis()
                 if (now - lastLogTime >= 1000) {
-                    val queueSize = videoQueueSize.get() // 使用缓存的大小，避免调用 size()
+                    val queueSize = ring.stats()?.queuedFrames ?: 0
                     val dropped = droppedFrames.get()
                     val sent = sentFrames.get()
                     if (queueSize > 10 || dropped > 0) {
@@ -298,30 +349,25 @@ class RtmpStreamer {
                 Log.e(TAG, "视频发送循环异常", e)
             }
         }
+        ring.release()
         Log.d(TAG, "视频发送线程结束")
     }
     
     /**
      * 音频发送循环（在独立线程中运行）
      */
-    private fun audioSendLoop() {
+    private fun audioSendLoop(ring: FrameRing) {
         Log.d(TAG, "音频发送线程启动")
         while (audioSendThreadRunning.get() && isStreaming.get()) {
             try {
-                // 从队列中取出帧（最多等待 100ms）
-                val frame = audioSendQueue.poll(100, java.util.concurrent.TimeUnit.MILLISECONDS)
-                if (frame != null && rtmpHandle != 0L) {
-                    val sendStartTime = System.currentTimeMillis()
-                    val result = RtmpNative.sendAudio(rtmpHandle, frame.data, frame.size, frame.timestamp)
-                    val sendDuration = System.currentTimeMillis() - sendStartTime
-                    
-                    if (result != 0) {
-                        Log.w(TAG, "发送音频数据失败: $result, 耗时=${sendDuration}ms")
-                        handleSocketError(result)
-                    } else if (sendDuration > 50) {
-                        // 如果发送耗时过长，记录警告
-                        Log.w(TAG, "音频帧发送耗时过长: ${sendDuration}ms, size=${frame.size}")
-                    }
+                // 阻塞等待帧环中的帧（最多等待 100ms），断网期间由 native 写入磁盘缓存
+                val sendStartTime = System.currentTimeMillis()
+                val result = ring.send(rtmpHandle, spoolHandle, 100)
+                val sendDuration = System.currentTimeMillis() - sendStartTime
+                
+                if (result < 0 && result != RtmpNative.SEND_WOULD_BLOCK) {
+                    Log.w(TAG, "发送音频数据失败: $result, 耗时=${sendDuration}ms")
+                    handleSocketError(result)
                 }
             } catch (e: InterruptedException) {
                 break
@@ -329,6 +375,7 @@ class RtmpStreamer {
                 Log.e(TAG, "音频发送循环异常", e)
             }
         }
+        ring.release()
         Log.d(TAG, "音频发送线程结束")
     }
     
@@ -346,7 +393,8 @@ class RtmpStreamer {
         
         Log.d(TAG, "发送 SPS/PPS: SPS size=${sps.size}, PPS size=${pps.size}, ts=$timestamp")
         // 将 SPS/PPS 组合成 Annex-B 格式并发送（同步发送，确保在视频帧之前）
-        val spsPpsData = ByteArray(sps.size + pps.size + 8)
+        // HEVC 的参数集整体放在 sps 中（VPS+SPS+PPS），pps 为空时不再追加起始码
+        val spsPpsData = ByteArray(sps.size + pps.size + if (pps.isEmpty()) 4 else 8)
         var idx = 0
         // SPS start code
         spsPpsData[idx++] = 0x00
@@ -355,12 +403,14 @@ class RtmpStreamer {
         spsPpsData[idx++] = 0x01
         System.arraycopy(sps, 0, spsPpsData, idx, sps.size)
         idx += sps.size
-        // PPS start code
-        spsPpsData[idx++] = 0x00
-        spsPpsData[idx++] = 0x00
-        spsPpsData[idx++] = 0x00
-        spsPpsData[idx++] = 0x01
-        System.arraycopy(pps, 0, spsPpsData, idx, pps.size)
+        if (pps.isNotEmpty()) {
+            // PPS start code
+            spsPpsData[idx++] = 0x00
+            spsPpsData[idx++] = 0x00
+            spsPpsData[idx++] = 0x00
+            spsPpsData[idx++] = 0x01
+            System.arraycopy(pps, 0, spsPpsData, idx, pps.size)
+        }
         
         val result = RtmpNative.sendVideo(rtmpHandle, spsPpsData, spsPpsData.size, timestamp, true)
         if (result != 0) {
@@ -381,6 +431,8 @@ class RtmpStreamer {
         isStreaming.set(false)
         stopHeartbeat()
         stopSendThreads()
+        avClock?.release()
+        avClock = null
         
         // 打印统计信息
         val dropped = droppedFrames.get()
@@ -409,8 +461,13 @@ class RtmpStreamer {
         
         Log.d(TAG, "Refreshing RTMP connection...")
         statusCallback?.onStatus("reconnecting", null)
+        // 断网期间的帧写入磁盘缓存，不再丢弃
+        if (spoolHandle != 0L) {
+            RtmpNative.spoolBegin(spoolHandle)
+        }
         
         Thread {
+            var drainFailed = false
             try {
                 // 1. Close old connection
                 if (rtmpHandle != 0L) {
@@ -424,17 +481,32 @@ class RtmpStreamer {
                 // 3. Re-init
                 rtmpHandle = RtmpNative.init(rtmpUrl)
                 if (rtmpHandle != 0L) {
+                    applyTransport(rtmpHandle)
+                    applyZeroCopy(rtmpHandle)
+                    applySendDeadline(rtmpHandle)
+                    applyRtmptBatch(rtmpHandle)
                     applyCachedMetadata()
                     sendSpsPps()
                     
-                    // 清空发送队列，避免发送旧数据
-                    videoSendQueue.clear()
-                    audioSendQueue.clear()
+                    if (spoolHandle == 0L) {
+                        // 清空发送帧环，避免发送旧数据
+                        videoRing?.flush()
+                        audioRing?.flush()
+                    }
                     
                     Log.d(TAG, "RTMP connection refreshed successfully")
                     statusCallback?.onStatus("connected", null)
-                    // Force a keyframe
-                    videoEncoder?.requestKeyFrame()
+                    // 新连接尚未发过关键帧，注册时 native 会立即请求一次关键帧
+                    registerKeyFrameRequestListener(rtmpHandle)
+                    registerBufferReleaseListener(rtmpHandle)
+                    // 录制随旧连接结束，新连接写入新文件
+                    resumeRecording(rtmpHandle)
+                    // 补发（或丢弃）断网期间的积压数据，完成后发送线程自动切回直播
+                    if (spoolHandle != 0L &&
+                        RtmpNative.spoolDrain(spoolHandle, rtmpHandle, spoolMode, spoolDrainSpeedPercent) != 0) {
+                        Log.e(TAG, "补发积压数据失败，重新连接")
+                        drainFailed = true
+                    }
                 } else {
                     Log.e(TAG, "Failed to refresh RTMP connection")
                     statusCallback?.onStatus("failed", "RTMP 重连失败")
@@ -445,9 +517,388 @@ class RtmpStreamer {
             } finally {
                 isRefreshing = false
             }
+            if (drainFailed) {
+                refreshConnection()
+            }
         }.start()
     }
 
+    /**
+     * 注册 native 关键帧请求：新连接、丢帧切断参考链时由 native 按最小间隔限流回调
+     */
+    private fun registerKeyFrameRequestListener(handle: Long) {
+        RtmpNative.setKeyFrameRequestListener(handle, RtmpNative.KeyFrameRequestListener { reason ->
+            Log.d(TAG, "native 请求关键帧: reason=$reason")
+            videoEncoder?.requestKeyFrame()
+        }, KEYFRAME_REQUEST_MIN_INTERVAL_MS)
+    }
+
+    /**
+     * 注册零拷贝发送的释放监听器：native 发送线程发完（或丢弃）一帧后归还对应的编码器输出缓冲区
+     */
+    private fun registerBufferReleaseListener(handle: Long) {
+        RtmpNative.setBufferReleaseListener(handle, RtmpNative.BufferReleaseListener { token, result ->
+            val held = heldBuffers.remove(token) ?: return@BufferReleaseListener
+            held.encoder.releaseOutputBuffer(held.index)
+            if (heldBuffers.isEmpty()) {
+                videoPathLock.withLock { asyncDrained.signalAll() }
+            }
+            when (result) {
+                0 -> sentFrames.incrementAndGet()
+                RtmpNative.ASYNC_DROPPED, RtmpNative.SEND_WOULD_BLOCK -> droppedFrames.incrementAndGet()
+                else -> {
+                    sendErrorCount.incrementAndGet()
+                    Log.w(TAG, "发送视频数据失败: $result")
+                    handleSocketError(result)
+                }
+            }
+        }, 0)
+    }
+
+    private var spoolHandle: Long = 0
+    private var spoolMode = RtmpNative.SPOOL_MODE_DRAIN
+    private var spoolDrainSpeedPercent = 200
+
+    /**
+     * 启用断网缓存：断网期间的帧写入磁盘环形文件，重连后补发或丢弃
+     * @param capacityBytes 缓存容量，写满后淘汰最旧的帧
+     * @param mode RtmpNative.SPOOL_MODE_DRAIN 或 RtmpNative.SPOOL_MODE_DISCARD
+     * @param drainSpeedPercent 补发速度（相对实时的百分比），<= 0 不限速
+     */
+    fun enableSpool(path: String, capacityBytes: Long, mode: Int = RtmpNative.SPOOL_MODE_DRAIN, drainSpeedPercent: Int = 200): Boolean {
+        disableSpool()
+        val spool = RtmpNative.spoolOpen(path, capacityBytes)
+        if (spool == 0L) {
+            Log.e(TAG, "创建断网缓存失败: $path")
+            return false
+        }
+        spoolMode = mode
+        spoolDrainSpeedPercent = drainSpeedPercent
+        spoolHandle = spool
+        return true
+    }
+
+    /**
+     * 关闭断网缓存并删除缓存文件
+     */
+    fun disableSpool() {
+        val spool = spoolHandle
+        spoolHandle = 0
+        if (spool != 0L) {
+            RtmpNative.spoolClose(spool)
+        }
+    }
+
+    /**
+     * 断网缓存统计 [积压字节数, 积压帧数, 淘汰帧数, 补发速率(B/s), 累计补发字节数]
+     */
+    fun getSpoolStats(): LongArray? {
+        val spool = spoolHandle
+        return if (spool != 0L) RtmpNative.getSpoolStats(spool) else null
+    }
+
+    /**
+     * 发送帧环占用统计 [视频, 音频]，未推流时为 null
+     */
+    fun getRingStats(): Pair<FrameRingStats?, FrameRingStats?> {
+        return Pair(videoRing?.stats(), audioRing?.stats())
+    }
+
+    /**
+     * 开启或关闭 native 异步日志：发送线程只拷贝日志参数，由后台线程格式化写入 logcat
+     */
+    fun setAsyncLogging(enabled: Boolean) {
+        RtmpNative.setAsyncLogging(enabled)
+    }
+
+    /**
+     * 开启或关闭逐帧发送流水线追踪（native 库需以 BB_RTMP_TRACE 编译）
+     */
+    fun setTraceEnabled(enabled: Boolean): Boolean {
+        val ok = RtmpNative.traceEnable(enabled) == 0
+        if (!ok) {
+            Log.w(TAG, "native 库未编译追踪支持（BB_RTMP_TRACE）")
+        }
+        return ok
+    }
+
+    /**
+     * 配置 rtmps:// 推流的证书校验与内核 TLS 选项，对之后建立的连接生效（native 库需以 BB_RTMP_TLS 编译）
+     * @param caFile CA 证书文件（PEM），为 null 时使用系统默认路径
+     * @param flags RtmpNative.TLS_NO_VERIFY / TLS_NO_KTLS / TLS_FULL_OFFLOAD 按位组合
+     */
+    fun configureTls(caFile: String? = null, flags: Int = 0): Boolean {
+        val ok = RtmpNative.tlsConfigure(caFile, flags) == 0
+        if (!ok) {
+            Log.w(TAG, "native 库未编译 RTMPS 支持（BB_RTMP_TLS）")
+        }
+        return ok
+    }
+
+    /**
+     * 当前连接的 RTMPS 传输信息，未连接时为 null
+     */
+    fun getTlsInfo(): TlsInfo? {
+        if (rtmpHandle == 0L) return null
+        val values = RtmpNative.getTlsInfo(rtmpHandle) ?: return null
+        if (values.size < 5) return null
+        return TlsInfo(
+            mode = values[0].toInt(),
+            kernelSend = values[1] != 0L,
+            kernelRecv = values[2] != 0L,
+            relayBytesOut = values[3],
+            relayBytesIn = values[4]
+        )
+    }
+
+    /**
+     * 开启或关闭 TCP Fast Open，对之后建立的连接（含重连）生效：内核缓存了服务端的 cookie 时 C0+C1 随 SYN 发出，
+     * 高 RTT 网络上建连少等一个往返；服务端拒绝时照常握手
+     */
+    fun setFastOpen(enabled: Boolean): Boolean {
+        val ok = RtmpNative.setFastOpen(enabled) == 0
+        if (!ok) {
+            Log.w(TAG, "系统不支持 TCP Fast Open")
+        }
+        return ok
+    }
+
+    /**
+     * 当前连接建立各阶段的耗时与 TCP Fast Open 结果，未连接时为 null
+     */
+    fun getConnectTiming(): ConnectTiming? {
+        if (rtmpHandle == 0L) return null
+        val values = RtmpNative.getConnectTiming(rtmpHandle) ?: return null
+        if (values.size < 9) return null
+        return ConnectTiming(
+            fastOpen = values[0].toInt(),
+            dnsUs = values[1],
+            tcpConnectUs = values[2],
+            tlsUs = values[3],
+            rtmpConnectUs = values[4],
+            connectStreamUs = values[5],
+            totalUs = values[6],
+            rttUs = values[7],
+            savedRttUs = values[8]
+        )
+    }
+
+    /**
+     * 选择发送后端，对当前连接与之后重连建立的连接生效。io_uring 需以 BB_RTMP_URING 编译 native 库且内核支持，
+     * 不可用时返回 false 并保持 socket 后端
+     * @param transport RtmpNative.TRANSPORT_SOCKET / TRANSPORT_URING
+     */
+    fun setTransport(transport: Int): Boolean {
+        this.transport = transport
+        return rtmpHandle == 0L || applyTransport(rtmpHandle)
+    }
+
+    private fun applyTransport(handle: Long): Boolean {
+        val ok = RtmpNative.setTransport(handle, transport) == 0
+        if (!ok) {
+            Log.w(TAG, "io_uring 发送后端不可用（未以 BB_RTMP_URING 编译或内核不支持），使用 socket 发送")
+        }
+        return ok
+    }
+
+    /**
+     * 大视频帧（如 50~300 KB 的关键帧）改以 MSG_ZEROCOPY 发送，对当前连接与之后重连建立的连接生效。
+     * 仅明文 RTMP 的 TCP 连接可用，不可用时返回 false 并保持拷贝发送；效果见 getStatsV2 的 zeroCopy* 字段
+     * @param thresholdBytes body 不小于该字节数的视频帧走零拷贝，<= 0 关闭
+     * @param chunkSize 同时设置的输出 chunk size，<= 0 保持默认的 128（零拷贝按页固定内存，需要大 chunk 才有收益）
+     */
+    fun setZeroCopy(thresholdBytes: Int, chunkSize: Int = 64 * 1024): Boolean {
+        zeroCopyThreshold = thresholdBytes
+        zeroCopyChunkSize = chunkSize
+        return rtmpHandle == 0L || applyZeroCopy(rtmpHandle)
+    }
+
+    private fun applyZeroCopy(handle: Long): Boolean {
+        if (zeroCopyThreshold <= 0) {
+            return RtmpNative.setZeroCopy(handle, 0, 0) == 0
+        }
+        val ok = RtmpNative.setZeroCopy(handle, zeroCopyThreshold, zeroCopyChunkSize) == 0
+        if (!ok) {
+            Log.w(TAG, "MSG_ZEROCOPY 不可用（RTMPS/RTMPT 连接或内核不支持），使用拷贝发送")
+        }
+        return ok
+    }
+
+    /**
+     * 限时非阻塞发送，对当前连接与之后重连建立的连接生效：上行停滞时发送线程最多阻塞 deadlineMs，
+     * 写不完的帧之后从断点续写，仍未写完时后续帧直接丢弃（计入丢帧）而不再断开重连；效果见 getStatsV2 的 wouldBlock* 字段。
+     * 与 io_uring 后端、MSG_ZEROCOPY 互斥
+     * @param deadlineMs 每帧的发送期限（毫秒），<= 0 关闭
+     */
+    fun setSendDeadline(deadlineMs: Int): Boolean {
+        sendDeadlineMs = deadlineMs
+        return rtmpHandle == 0L || applySendDeadline(rtmpHandle)
+    }
+
+    private fun applySendDeadline(handle: Long): Boolean {
+        val ok = RtmpNative.setSendDeadline(handle, sendDeadlineMs) == 0
+        if (!ok) {
+            Log.w(TAG, "限时发送不可用（RTMPT 连接或已开启 io_uring/MSG_ZEROCOPY），使用阻塞发送")
+        }
+        return ok
+    }
+
+    /**
+     * RTMPT（rtmpt:// 地址）批量发送，对当前连接与之后重连建立的连接生效：windowMs 内的消息合并为一个 HTTP 请求，
+     * 请求流水线发出并在后台读取应答；效果见 getRtmptStats。与 io_uring 后端、MSG_ZEROCOPY、限时发送互斥
+     * @param windowMs 合并窗口（毫秒），0 不等待，< 0 关闭
+     */
+    fun setRtmptBatch(windowMs: Int): Boolean {
+        rtmptBatchMs = windowMs
+        return rtmpHandle == 0L || applyRtmptBatch(rtmpHandle)
+    }
+
+    private fun applyRtmptBatch(handle: Long): Boolean {
+        val ok = RtmpNative.setRtmptBatch(handle, rtmptBatchMs) == 0
+        if (!ok) {
+            Log.w(TAG, "RTMPT 批量发送不可用（非 rtmpt:// 连接或已开启其他发送方式），使用逐条 POST")
+        }
+        return ok
+    }
+
+    /**
+     * 批量 RTMPT 发送统计，未开启时返回 null
+     */
+    fun getRtmptStats(): RtmptStats? {
+        if (rtmpHandle == 0L) return null
+        val values = RtmpNative.getRtmptStats(rtmpHandle) ?: return null
+        if (values.size < 9) return null
+        return RtmptStats(
+            posts = values[0],
+            idlePolls = values[1],
+            messages = values[2],
+            bytes = values[3],
+            responses = values[4],
+            receivedBytes = values[5],
+            inflight = values[6].toInt(),
+            maxInflight = values[7].toInt(),
+            maxPostBytes = values[8]
+        )
+    }
+
+    /**
+     * io_uring 发送引擎的累计统计（进程内所有连接），native 库未编译时 available 为 false
+     */
+    fun getUringStats(): UringStats? {
+        val values = RtmpNative.getUringStats() ?: return null
+        if (values.size < 9) return null
+        return UringStats(
+            available = values[0] != 0L,
+            connections = values[1].toInt(),
+            enterCalls = values[2],
+            sqes = values[3],
+            batchedEnters = values[4],
+            messages = values[5],
+            bytes = values[6],
+            resubmits = values[7],
+            timeouts = values[8]
+        )
+    }
+
+    /**
+     * 获取扩展统计信息（按媒体类型的计数、chunk/系统调用数、发送队列深度、延迟直方图与音视频时钟漂移）
+     */
+    fun getStatsV2(): NetworkStatsV2? {
+        if (rtmpHandle == 0L) return null
+        val values = RtmpNative.getStatsV2(rtmpHandle) ?: return null
+        val fields = RtmpNative.STATS_V2_HISTOGRAM_FIELDS
+        if (values.size < RtmpNative.STATS_V2_DEADLINE_OFFSET + RtmpNative.STATS_V2_DEADLINE_FIELDS) {
+            return null
+        }
+        fun histogram(index: Int): LatencyHistogram {
+            val base = RtmpNative.STATS_V2_HISTOGRAM_OFFSET + index * fields
+            return LatencyHistogram(
+                count = values[base],
+                sumUs = values[base + 1],
+                maxUs = values[base + 2],
+                p50Us = values[base + 3],
+                p90Us = values[base + 4],
+                p99Us = values[base + 5],
+                p999Us = values[base + 6],
+                buckets = values.copyOfRange(base + 7, base + fields)
+            )
+        }
+        return NetworkStatsV2(
+            version = values[RtmpNative.STATS_V2_VERSION].toInt(),
+            videoBytes = values[RtmpNative.STATS_V2_VIDEO_BYTES],
+            videoMessages = values[RtmpNative.STATS_V2_VIDEO_MESSAGES],
+            audioBytes = values[RtmpNative.STATS_V2_AUDIO_BYTES],
+            audioMessages = values[RtmpNative.STATS_V2_AUDIO_MESSAGES],
+            dataBytes = values[RtmpNative.STATS_V2_DATA_BYTES],
+            dataMessages = values[RtmpNative.STATS_V2_DATA_MESSAGES],
+            chunks = values[RtmpNative.STATS_V2_CHUNKS],
+            sendSyscalls = values[RtmpNative.STATS_V2_SEND_SYSCALLS],
+            sendFailures = values[RtmpNative.STATS_V2_SEND_FAILURES],
+            droppedVideoFrames = values[RtmpNative.STATS_V2_DROPPED_VIDEO_FRAMES],
+            queueDepthBytes = values[RtmpNative.STATS_V2_QUEUE_DEPTH],
+            maxQueueDepthBytes = values[RtmpNative.STATS_V2_MAX_QUEUE_DEPTH],
+            enqueueToWire = histogram(0),
+            sendDuration = histogram(1),
+            videoFrameGap = histogram(2),
+            zeroCopyMessages = values[RtmpNative.STATS_V2_ZEROCOPY_OFFSET],
+            zeroCopyBytes = values[RtmpNative.STATS_V2_ZEROCOPY_OFFSET + 1],
+            copyAvoidedBytes = values[RtmpNative.STATS_V2_ZEROCOPY_OFFSET + 2],
+            zeroCopyCopiedBytes = values[RtmpNative.STATS_V2_ZEROCOPY_OFFSET + 3],
+            zeroCopyCompletion = histogram(3),
+            wouldBlockFrames = values[RtmpNative.STATS_V2_DEADLINE_OFFSET],
+            partialMessages = values[RtmpNative.STATS_V2_DEADLINE_OFFSET + 1],
+            resumedBytes = values[RtmpNative.STATS_V2_DEADLINE_OFFSET + 2],
+            avClock = avClock?.stats()
+        )
+    }
+
+    /**
+     * 导出最近的追踪事件为 Chrome trace-event JSON，返回事件数，失败返回负数
+     */
+    fun dumpTrace(path: String): Int = RtmpNative.traceDump(path)
+
+    private var recordingPath: String? = null
+    private var recordingMaxSegmentBytes = 0L
+    private var recordingMaxSegmentDurationMs = 0
+
+    /**
+     * 开始本地 FLV 录制（与推流共享 native 缓冲区，不额外编码）
+     * @param maxSegmentBytes 单个文件最大字节数，<= 0 不按大小切分
+     * @param maxSegmentDurationMs 单个文件最大时长（毫秒），<= 0 不按时长切分
+     */
+    fun startRecording(path: String, maxSegmentBytes: Long = 0, maxSegmentDurationMs: Int = 0): Boolean {
+        if (rtmpHandle == 0L) return false
+        val result = RtmpNative.startRecording(rtmpHandle, path, maxSegmentBytes, maxSegmentDurationMs)
+        if (result != 0) {
+            Log.e(TAG, "开始录制失败: $path")
+            return false
+        }
+        recordingPath = path
+        recordingMaxSegmentBytes = maxSegmentBytes
+        recordingMaxSegmentDurationMs = maxSegmentDurationMs
+        return true
+    }
+
+    /**
+     * 停止本地 FLV 录制
+     */
+    fun stopRecording() {
+        recordingPath = null
+        if (rtmpHandle != 0L) {
+            RtmpNative.stopRecording(rtmpHandle)
+        }
+    }
+
+    private fun resumeRecording(handle: Long) {
+        val path = recordingPath ?: return
+        // 重连后使用带时间戳的新文件名，避免覆盖断线前的录制
+        val base = if (path.endsWith(".flv")) path.substring(0, path.length - 4) else path
+        val resumedPath = "${base}_${System.currentTimeMillis()}.flv"
+        if (RtmpNative.startRecording(handle, resumedPath, recordingMaxSegmentBytes, recordingMaxSegmentDurationMs) != 0) {
+            Log.e(TAG, "重连后恢复录制失败: $resumedPath")
+        }
+    }
+
     private var cachedWidth = 0
     private var cachedHeight = 0
     private var cachedVideoBitrate = 0
@@ -485,8 +936,37 @@ class RtmpStreamer {
         return System.currentTimeMillis() - startTime.get()
     }
 
-    fun startHeartbeat() {
-        if (!isStreaming.get() || heartbeatTimer != null) return
+    /**
+     * 视频帧时间戳：由 native 时钟把编码器 PTS 映射到音频采样时间线，时钟不可用时退回墙钟
+     */
+    private fun videoTimestamp(ptsUs: Long): Long {
+        val ts = avClock?.video(ptsUs) ?: -1L
+        return if (ts >= 0) ts else getStreamTimestamp()
+    }
+
+    /**
+     * 音频帧时间戳：按累计采样数推算（AAC 每帧 1024 个采样，Opus 20ms 为 960 个）
+     */
+    private fun audioTimestamp(ptsUs: Long): Long {
+        val samples = if (audioEncoder?.codec == AudioCodec.OPUS) 960 else 1024
+        val ts = avClock?.audio(ptsUs, samples) ?: -1L
+        return if (ts >= 0) ts else getStreamTimestamp()
+    }
+
+    /**
+     * 后台心跳：优先由 native 定时器发送合成的 P_Skip 帧（每帧仅几个字节，定期重发关键帧，音频断流时补静音），
+     * HEVC、断网缓存启用等 native 不支持的情况回退为每秒重发缓存的关键帧
+     */
+    fun startHeartbeat(fps: Int = 5, keyframeIntervalMs: Int = 2000) {
+        if (!isStreaming.get() || heartbeatTimer != null || nativeHeartbeat) return
+        val handle = rtmpHandle
+        val keyframe = synchronized(heartbeatLock) { lastVideoDataBytes }
+        if (handle != 0L && spoolHandle == 0L && keyframe != null &&
+            RtmpNative.heartbeatStart(handle, keyframe, keyframe.size, videoTimestamp(System.nanoTime() / 1000), fps, keyframeIntervalMs) == 0) {
+            nativeHeartbeat = true
+            Log.d(TAG, "Starting native background heartbeat: fps=$fps")
+            return
+        }
         Log.d(TAG, "Starting background video heartbeat")
         heartbeatTimer = java.util.Timer()
         heartbeatTimer?.scheduleAtFixedRate(object : java.util.TimerTask() {
@@ -497,6 +977,11 @@ class RtmpStreamer {
     }
 
     fun stopHeartbeat() {
+        if (nativeHeartbeat) {
+            nativeHeartbeat = false
+            val handle = rtmpHandle
+            if (handle != 0L) RtmpNative.heartbeatStop(handle)
+        }
         heartbeatTimer?.cancel()
         heartbeatTimer = null
         Log.d(TAG, "Stopped background video heartbeat")
@@ -506,21 +991,115 @@ class RtmpStreamer {
         val bytes = synchronized(heartbeatLock) { lastVideoDataBytes } ?: return
         val info = synchronized(heartbeatLock) { lastVideoInfo } ?: return
         
-        val timestamp = getStreamTimestamp()
+        val timestamp = videoTimestamp(System.nanoTime() / 1000)
         val isKeyFrame = (info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0
         
-        // 将心跳帧加入发送队列（使用异步发送）
-        val frame = VideoFrame(bytes, bytes.size, timestamp, isKeyFrame)
-        if (!videoSendQueue.offer(frame)) {
-            // 队列满，尝试清空队列并加入心跳帧
-            videoSendQueue.clear()
-            videoSendQueue.offer(frame)
-            Log.w(TAG, "心跳帧：队列满，清空队列")
+        // 将心跳帧写入发送帧环（使用异步发送）；心跳只缓存关键帧，帧环满时 native 会清空积压后写入
+        val ring = videoRing ?: return
+        videoPathLock.withLock {
+            if (!leaveAsyncPath()) {
+                Log.w(TAG, "心跳帧：零拷贝队列未发完，跳过")
+                return
+            }
+            val flushed = ring.push(bytes, bytes.size, timestamp, isKeyFrame)
+            if (flushed < 0) {
+                Log.w(TAG, "心跳帧：帧环空间不足，跳过")
+            } else if (flushed > 0) {
+                droppedFrames.addAndGet(flushed)
+                Log.w(TAG, "心跳帧：队列满，清空了 $flushed 帧")
+            }
+        }
+    }
+
+    /**
+     * 切到帧环路径（videoPathLock 内调用）：等待零拷贝队列中的帧发完，或随连接关闭以丢弃释放
+     * @return 超时返回 false，调用方应丢弃当前帧
+     */
+    private fun leaveAsyncPath(): Boolean {
+        if (!videoAsyncActive) return true
+        var remainingNs = ASYNC_DRAIN_TIMEOUT_MS * 1_000_000
+        while (heldBuffers.isNotEmpty()) {
+            if (remainingNs <= 0) return false
+            remainingNs = asyncDrained.awaitNanos(remainingNs)
+        }
+        videoAsyncActive = false
+        return true
+    }
+
+    /**
+     * 切到零拷贝路径（videoPathLock 内调用）：帧环中仍有未发完的视频帧时返回 false，继续走帧环
+     */
+    private fun enterAsyncPath(): Boolean {
+        if (videoAsyncActive) return true
+        // 帧在发送完成后才出队，排队数为 0 即帧环中的帧都已写出
+        val queued = videoRing?.stats()?.queuedFrames ?: 0
+        if (queued > 0) return false
+        videoAsyncActive = true
+        return true
+    }
+
+    /**
+     * 零拷贝发送视频数据：编码器输出缓冲区直接交给 native 发送线程，发送完成后由释放监听器归还。
+     * 断网缓存启用或重连中返回 false，由 sendVideoData 走拷贝路径；两条路径切换时先等对方排空
+     */
+    private fun sendVideoBuffer(encoder: VideoEncoder, index: Int, data: ByteBuffer, info: MediaCodec.BufferInfo): Boolean {
+        val handle = rtmpHandle
+        val isKeyFrame = (info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0
+        videoPathLock.withLock {
+            val asyncUsable = handle != 0L && spoolHandle == 0L && !isRefreshing && data.isDirect
+            if (asyncUsable && enterAsyncPath() && submitVideoBuffer(handle, encoder, index, data, info, isKeyFrame)) {
+                return true
+            }
+            // 改走拷贝路径（帧环）
+            if (leaveAsyncPath()) return false
+            // 零拷贝队列迟迟发不完（上行停滞）：丢弃本帧，native 丢弃后续非关键帧并请求关键帧
+            encoder.releaseOutputBuffer(index)
+            droppedFrames.incrementAndGet()
+            if (handle != 0L) RtmpNative.notifyVideoDropped(handle)
+            return true
+        }
+    }
+
+    /**
+     * 提交到 native 零拷贝队列，返回 false 表示未接管缓冲区
+     */
+    private fun submitVideoBuffer(handle: Long, encoder: VideoEncoder, index: Int, data: ByteBuffer,
+                                  info: MediaCodec.BufferInfo, isKeyFrame: Boolean): Boolean {
+        // 心跳只缓存关键帧：重发关键帧可独立解码，且每个 GOP 只拷贝一次
+        if (isKeyFrame) {
+            val bytes = ByteArray(info.size)
+            val start = data.position()
+            data.get(bytes, 0, info.size)
+            data.position(start)
+            synchronized(heartbeatLock) {
+                lastVideoDataBytes = bytes
+                val infoCopy = MediaCodec.BufferInfo()
+                infoCopy.set(0, info.size, info.presentationTimeUs, info.flags)
+                lastVideoInfo = infoCopy
+            }
+        }
+
+        val token = nextBufferToken.getAndIncrement()
+        heldBuffers[token] = HeldBuffer(encoder, index)
+        val result = RtmpNative.sendVideoAsync(handle, data, data.position(), info.size, videoTimestamp(info.presentationTimeUs), isKeyFrame, token)
+        if (result == 0) {
+            return true
+        }
+        heldBuffers.remove(token)
+        if (result == RtmpNative.ASYNC_QUEUE_FULL) {
+            // native 已丢弃该非关键帧并请求关键帧，缓冲区直接归还
+            encoder.releaseOutputBuffer(index)
+            val dropped = droppedFrames.incrementAndGet()
+            if (dropped % 30 == 0) {
+                Log.w(TAG, "零拷贝发送队列满，丢弃非关键帧 (已丢弃 $dropped 帧)")
+            }
+            return true
         }
+        return false
     }
 
     /**
-     * 发送视频数据
+     * 发送视频数据（拷贝路径）
      */
     private fun sendVideoData(data: ByteBuffer, info: MediaCodec.BufferInfo) {
         if (rtmpHandle == 0L) {
@@ -534,70 +1113,45 @@ class RtmpStreamer {
         }
 
         try {
-            val timestamp = getStreamTimestamp()
+            val timestamp = videoTimestamp(info.presentationTimeUs)
             val isKeyFrame = (info.flags and MediaCodec.BUFFER_FLAG_KEY_FRAME) != 0
-            
-            // 复制数据（用于异步发送和心跳）
-            val bytes = ByteArray(info.size)
             data.position(info.offset)
-            data.get(bytes)
-            data.position(info.offset) // Restore position
             
-            // Cache for heartbeat
-            synchronized(heartbeatLock) {
-                lastVideoDataBytes = bytes
-                val infoCopy = MediaCodec.BufferInfo()
-                infoCopy.set(0, info.size, info.presentationTimeUs, info.flags)
-                lastVideoInfo = infoCopy
+            // 心跳只缓存关键帧：重发关键帧可独立解码，且每个 GOP 只拷贝一次
+            if (isKeyFrame) {
+                val bytes = ByteArray(info.size)
+                data.get(bytes)
+                data.position(info.offset) // Restore position
+                synchronized(heartbeatLock) {
+                    lastVideoDataBytes = bytes
+                    val infoCopy = MediaCodec.BufferInfo()
+                    infoCopy.set(0, info.size, info.presentationTimeUs, info.flags)
+                    lastVideoInfo = infoCopy
+                }
             }
             
             // 每 30 帧打印一次日志（用于调试）
             staticVideoFrameCount++
-            val currentQueueSize = videoQueueSize.get()
             if (isKeyFrame || staticVideoFrameCount % 30 == 0) {
-                Log.d(TAG, "收到视频数据: size=${info.size}, pts=${info.presentationTimeUs}, isKeyFrame=$isKeyFrame (总帧数=$staticVideoFrameCount, 队列大小=$currentQueueSize)")
-            }
-
-            // 分辨率切换后仅发关键帧直至首帧关键帧发送，便于播放端恢复
-            if (resolutionChangePending.get() && !isKeyFrame) {
-                return
+                Log.d(TAG, "收到视频数据: size=${info.size}, pts=${info.presentationTimeUs}, isKeyFrame=$isKeyFrame (总帧数=$staticVideoFrameCount)")
             }
 
-            // 将帧加入发送队列（异步发送，避免阻塞编码器回调线程）
-            val frame = VideoFrame(bytes, info.size, timestamp, isKeyFrame)
-            
-            // 如果队列满了，根据策略处理：
-            // 1. 如果是关键帧，清空队列并加入关键帧（确保关键帧能发送）
-            // 2. 如果是非关键帧，尝试丢弃最旧的帧（FIFO策略）
-            if (!videoSendQueue.offer(frame)) {
-                // 队列满了
-                if (isKeyFrame) {
-                    // 关键帧：清空队列并加入关键帧（确保关键帧能发送）
-                    // 注意：清空队列是 O(n) 操作，但只在队列满且是关键帧时执行，频率很低
-                    val queueSize = currentQueueSize
-                    videoSendQueue.clear()
-                    videoQueueSize.set(0)
-                    videoSendQueue.offer(frame)
-                    videoQueueSize.incrementAndGet()
-                    droppedFrames.addAndGet(queueSize)
-                    Log.w(TAG, "队列满，清空队列以插入关键帧 (清空了 $queueSize 帧)")
-                } else {
-                    // 非关键帧：尝试丢弃最旧的帧（FIFO策略），为新帧腾出空间
-                    // 注意：LinkedBlockingQueue 不支持直接移除最旧的元素，所以只能丢弃当前帧
-                    // 但我们可以通过检查队列大小来优化：如果队列接近满，丢弃当前帧
-                    droppedFrames.incrementAndGet()
-                    val dropped = droppedFrames.get()
-                    if (dropped % 30 == 0) {
-                        Log.w(TAG, "队列满，丢弃非关键帧 (已丢弃 $dropped 帧, 队列大小=$currentQueueSize)")
-                    }
-                }
-            } else {
-                // 成功加入队列，更新大小计数
-                videoQueueSize.incrementAndGet()
-                
-                // 如果队列大小超过阈值，记录警告（用于监控网络状况）
-                if (currentQueueSize > 20) {
-                    Log.w(TAG, "视频发送队列积压严重: $currentQueueSize 帧，可能存在网络问题")
+            // 将帧直接写入发送帧环（异步发送，避免阻塞编码器回调线程）。
+            // 排队帧数已满时 native 的策略：
+            // 1. 关键帧：清空积压后写入（确保关键帧能发送），返回清空的帧数
+            // 2. 非关键帧：丢弃当前帧，返回 -1
+            val ring = videoRing ?: return
+            val flushed = ring.push(data, info.size, timestamp, isKeyFrame)
+            if (flushed > 0) {
+                droppedFrames.addAndGet(flushed)
+                Log.w(TAG, "队列满，清空队列以插入关键帧 (清空了 $flushed 帧)")
+            } else if (flushed < 0) {
+                droppedFrames.incrementAndGet()
+                // 丢弃帧会切断参考链，native 将丢弃后续非关键帧并请求关键帧
+                RtmpNative.notifyVideoDropped(rtmpHandle)
+                val dropped = droppedFrames.get()
+                if (isKeyFrame || dropped % 30 == 0) {
+                    Log.w(TAG, "帧环满，丢弃${if (isKeyFrame) "关键帧" else "非关键帧"} (已丢弃 $dropped 帧)")
                 }
             }
         } catch (e: Exception) {
@@ -615,21 +1169,13 @@ class RtmpStreamer {
         }
 
         try {
-            val timestamp = getStreamTimestamp()
+            val timestamp = audioTimestamp(info.presentationTimeUs)
             
-            // 复制数据（用于异步发送）
-            val bytes = ByteArray(info.size)
+            // 直接写入发送帧环（异步发送，避免阻塞编码器回调线程）
+            // 如果帧环满了，直接丢弃（音频可以容忍丢帧，不记录日志，避免日志过多）
+            val ring = audioRing ?: return
             data.position(info.offset)
-            data.get(bytes)
-            data.position(info.offset) // Restore position
-
-            // 将帧加入发送队列（异步发送，避免阻塞编码器回调线程）
-            val frame = AudioFrame(bytes, info.size, timestamp)
-            
-            // 如果队列满了，直接丢弃（音频可以容忍丢帧）
-            if (!audioSendQueue.offer(frame)) {
-                // 队列满，丢弃（不记录日志，避免日志过多）
-            }
+            ring.push(data, info.size, timestamp, false)
         } catch (e: Exception) {
             Log.e(TAG, "处理音频数据异常", e)
         }
@@ -680,6 +1226,8 @@ class RtmpStreamer {
         
         // 确保发送线程已停止
         stopSendThreads()
+        stopRecording()
+        disableSpool()
         
         if (rtmpHandle != 0L) {
             RtmpNative.close(rtmpHandle)
@@ -703,19 +1251,11 @@ class RtmpStreamer {
     }
 
     /**
-     * 分辨率切换后设为 true，发送首帧关键帧后自动清除
-     */
-    fun setResolutionChangePending(pending: Boolean) {
-        resolutionChangePending.set(pending)
-    }
-
-    /**
-     * 分辨率切换完成后调用：更新元数据、发送 SPS/PPS（用当前流时间戳与关键帧对齐）、标记仅发关键帧直至首帧
+     * 分辨率切换完成后调用：更新码率等元数据。新 SPS/PPS 由 native 按内容检测，在新编码器的首个 IDR 处
+     * 连同序列头与 onMetaData（宽高取自 SPS）一起切换，旧编码器在途的帧照常发送
      */
     fun onResolutionChangeComplete(width: Int, height: Int, videoBitrate: Int, fps: Int, audioSampleRate: Int, audioChannels: Int) {
         setMetadata(width, height, videoBitrate, fps, audioSampleRate, audioChannels)
-        sendSpsPps(getStreamTimestamp())
-        setResolutionChangePending(true)
     }
 }
 
@@ -728,3 +1268,106 @@ data class NetworkStats(
     val packetLossPercent: Int
 )
 
+/**
+ * RTMPS 传输信息：mode 为 RtmpNative.TLS_MODE_*，用户态模式下中继转发的明文字节数
+ */
+data class TlsInfo(
+    val mode: Int,
+    val kernelSend: Boolean,
+    val kernelRecv: Boolean,
+    val relayBytesOut: Long,
+    val relayBytesIn: Long
+)
+
+/**
+ * 连接建立各阶段耗时（微秒）：fastOpen 为 RtmpNative.FAST_OPEN_*，savedRttUs 为 TCP Fast Open 节省的往返
+ */
+data class ConnectTiming(
+    val fastOpen: Int,
+    val dnsUs: Long,
+    val tcpConnectUs: Long,
+    val tlsUs: Long,
+    val rtmpConnectUs: Long,
+    val connectStreamUs: Long,
+    val totalUs: Long,
+    val rttUs: Long,
+    val savedRttUs: Long
+)
+
+/**
+ * io_uring 发送引擎统计：batchedEnters 为一次提交中包含多个连接的 io_uring_enter 次数
+ */
+data class UringStats(
+    val available: Boolean,
+    val connections: Int,
+    val enterCalls: Long,
+    val sqes: Long,
+    val batchedEnters: Long,
+    val messages: Long,
+    val bytes: Long,
+    val resubmits: Long,
+    val timeouts: Long
+)
+
+/**
+ * 批量 RTMPT 统计：messages / posts 为平均每个 HTTP 请求合并的消息数
+ */
+data class RtmptStats(
+    val posts: Long,
+    val idlePolls: Long,
+    val messages: Long,
+    val bytes: Long,
+    val responses: Long,
+    val receivedBytes: Long,
+    val inflight: Int,
+    val maxInflight: Int,
+    val maxPostBytes: Long
+)
+
+/**
+ * 延迟直方图（单位：微秒），分位数为所在桶上界
+ */
+data class LatencyHistogram(
+    val count: Long,
+    val sumUs: Long,
+    val maxUs: Long,
+    val p50Us: Long,
+    val p90Us: Long,
+    val p99Us: Long,
+    val p999Us: Long,
+    val buckets: LongArray
+) {
+    val meanUs: Long get() = if (count > 0) sumUs / count else 0
+}
+
+/**
+ * 扩展网络统计（rtmp_stats_v2）
+ */
+data class NetworkStatsV2(
+    val version: Int,
+    val videoBytes: Long,
+    val videoMessages: Long,
+    val audioBytes: Long,
+    val audioMessages: Long,
+    val dataBytes: Long,
+    val dataMessages: Long,
+    val chunks: Long,
+    val sendSyscalls: Long,
+    val sendFailures: Long,
+    val droppedVideoFrames: Long,
+    val queueDepthBytes: Long,
+    val maxQueueDepthBytes: Long,
+    val enqueueToWire: LatencyHistogram,
+    val sendDuration: LatencyHistogram,
+    val videoFrameGap: LatencyHistogram,
+    val zeroCopyMessages: Long,
+    val zeroCopyBytes: Long,
+    val copyAvoidedBytes: Long,      // 完成通知确认未经内核拷贝的字节数
+    val zeroCopyCopiedBytes: Long,   // 内核回退为拷贝的字节数（回环、网卡不支持 scatter-gather 等）
+    val zeroCopyCompletion: LatencyHistogram,  // sendmsg 返回到完成通知的耗时（缓冲区被固定的时长）
+    val wouldBlockFrames: Long,      // 上一帧未能在期限内写完、未发送即丢弃的帧数（限时发送）
+    val partialMessages: Long,       // 写到期限时留待续写的消息数
+    val resumedBytes: Long,          // 之后续写出的字节数
+    val avClock: AvClockStats? = null  // 音视频时钟漂移（推流未开始时为 null）
+)
+
@@ -2,13 +2,38 @@ package com.bb.rtmp
 
 import android.media.MediaCodec
 import android.media.MediaCodecInfo
+import android.media.MediaCodecList
 import android.media.MediaFormat
 import android.util.Log
 import android.view.Surface
 import java.nio.ByteBuffer
 import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
 
-class VideoEncoder {
+/**
+ * 推流视频编码，nativeId 与 native 层 rtmp_video_codec 一致
+ */
+enum class VideoCodec(val mimeType: String, val nativeId: Int) {
+    H264(MediaFormat.MIMETYPE_VIDEO_AVC, RtmpNative.VIDEO_CODEC_H264),
+    HEVC(MediaFormat.MIMETYPE_VIDEO_HEVC, RtmpNative.VIDEO_CODEC_HEVC);
+
+    companion object {
+        /**
+         * 解析上层传入的编码名（"h264" / "hevc"），设备没有 HEVC 编码器时回退到 H.264
+         */
+        fun resolve(name: String?): VideoCodec {
+            val wantsHevc = name.equals("hevc", ignoreCase = true) || name.equals("h265", ignoreCase = true)
+            if (!wantsHevc) return H264
+            val hasEncoder = MediaCodecList(MediaCodecList.REGULAR_CODECS).codecInfos.any { info ->
+                info.isEncoder && info.supportedTypes.any { it.equals(HEVC.mimeType, ignoreCase = true) }
+            }
+            if (!hasEncoder) Log.w("VideoEncoder", "设备不支持 HEVC 编码，回退到 H.264")
+            return if (hasEncoder) HEVC else H264
+        }
+    }
+}
+
+class VideoEncoder(val codec: VideoCodec = VideoCodec.H264) {
     private val TAG = "VideoEncoder"
     private var mediaCodec: MediaCodec? = null
     private var width = 0
@@ -19,6 +44,9 @@ class VideoEncoder {
     private val isEncoding = AtomicBoolean(false)
     private var encoderCallback: EncoderCallback? = null
     private var encodeThread: Thread? = null
+
+    // 回调保留、尚未归还的输出缓冲区数；释放编码器前需等待归零，否则 native 可能读到已释放的内存
+    private val heldOutputBuffers = AtomicInteger(0)
     
     // 保存 SPS/PPS，以便在设置回调时立即通知
     private var savedSps: ByteArray? = null
@@ -69,6 +97,11 @@ class VideoEncoder {
     }
 
     interface EncoderCallback {
+        /**
+         * 零拷贝输出：返回 true 表示回调接管该输出缓冲区，之后必须调用 releaseOutputBuffer(index) 归还；
+         * 返回 false 时继续回调 onEncodedData 并由编码器立即释放
+         */
+        fun onEncodedBuffer(index: Int, data: ByteBuffer, info: MediaCodec.BufferInfo): Boolean = false
         fun onEncodedData(data: ByteBuffer, info: MediaCodec.BufferInfo)
         fun onCodecConfig(sps: ByteArray, pps: ByteArray) {}
         fun onError(error: String)
@@ -96,7 +129,7 @@ class VideoEncoder {
         this.fps = fps
 
         try {
-            val format = MediaFormat.createVideoFormat(MediaFormat.MIMETYPE_VIDEO_AVC, width, height)
+            val format = MediaFormat.createVideoFormat(codec.mimeType, width, height)
             format.setInteger(MediaFormat.KEY_COLOR_FORMAT, MediaCodecInfo.CodecCapabilities.COLOR_FormatSurface)
             format.setInteger(MediaFormat.KEY_BIT_RATE, bitrate)
             format.setInteger(MediaFormat.KEY_FRAME_RATE, fps)
@@ -104,7 +137,7 @@ class VideoEncoder {
             format.setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, if (height == 480) 1 else 2)
             format.setInteger(MediaFormat.KEY_BITRATE_MODE, MediaCodecInfo.EncoderCapabilities.BITRATE_MODE_VBR)
 
-            val encoder = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_VIDEO_AVC)
+            val encoder = MediaCodec.createEncoderByType(codec.mimeType)
             encoder.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE)
             surface = encoder.createInputSurface()
             
@@ -126,7 +159,7 @@ class VideoEncoder {
             }
             encodeThread!!.start()
 
-            Log.d(TAG, "视频编码器初始化成功: ${width}x${height}, bitrate=$bitrate, fps=$fps")
+            Log.d(TAG, "视频编码器初始化成功: ${width}x${height}, codec=$codec, bitrate=$bitrate, fps=$fps")
             return surface
         } catch (e: Exception) {
             Log.e(TAG, "初始化视频编码器失败", e)
@@ -157,8 +190,9 @@ class VideoEncoder {
                         Log.d(TAG, "MediaFormat toString: $newFormat")
                         
                         // 从 MediaFormat 中提取 SPS/PPS（CSD-0 和 CSD-1）
+                        // HEVC 的 csd-0 为 Annex-B 格式的 VPS+SPS+PPS，没有 csd-1：整体作为 "SPS" 传递，PPS 为空
                         val csd0 = newFormat.getByteBuffer("csd-0") // SPS
-                        val csd1 = newFormat.getByteBuffer("csd-1") // PPS
+                        val csd1 = if (this.codec == VideoCodec.HEVC) ByteBuffer.allocate(0) else newFormat.getByteBuffer("csd-1") // PPS
                         
                         Log.d(TAG, "csd-0: ${if (csd0 != null) "found, size=${csd0.remaining()}" else "null"}")
                         Log.d(TAG, "csd-1: ${if (csd1 != null) "found, size=${csd1.remaining()}" else "null"}")
@@ -213,6 +247,7 @@ class VideoEncoder {
                         }
                     }
                     outputBufferId >= 0 -> {
+                        var retained = false
                         val outputBuffer = codec.getOutputBuffer(outputBufferId)
                         if (outputBuffer != null && bufferInfo.size > 0) {
                             // 记录帧统计
@@ -262,7 +297,13 @@ class VideoEncoder {
                             val callback = encoderCallback
                             if (callback != null) {
                                 try {
-                                    callback.onEncodedData(data, bufferInfo)
+                                    // 先计数再交出：native 可能在回调返回前就已发送完并归还
+                                    heldOutputBuffers.incrementAndGet()
+                                    retained = callback.onEncodedBuffer(outputBufferId, data, bufferInfo)
+                                    if (!retained) {
+                                        heldOutputBuffers.decrementAndGet()
+                                        callback.onEncodedData(data, bufferInfo)
+                                    }
                                 } catch (e: Exception) {
                                     Log.e(TAG, "编码数据回调异常（可能已释放）", e)
                                 }
@@ -276,7 +317,9 @@ class VideoEncoder {
                                 }
                             }
                         }
-                        codec.releaseOutputBuffer(outputBufferId, false)
+                        if (!retained) {
+                            codec.releaseOutputBuffer(outputBufferId, false)
+                        }
                     }
                 }
             } catch (e: Exception) {
@@ -289,6 +332,19 @@ class VideoEncoder {
         }
     }
 
+    /**
+     * 归还 onEncodedBuffer 接管的输出缓冲区（可在任意线程调用）
+     */
+    fun releaseOutputBuffer(index: Int) {
+        try {
+            mediaCodec?.releaseOutputBuffer(index, false)
+        } catch (e: IllegalStateException) {
+            Log.w(TAG, "归还输出缓冲区失败（编码器已停止）: index=$index")
+        } finally {
+            heldOutputBuffers.decrementAndGet()
+        }
+    }
+
     /**
      * 更新码率
      */
@@ -334,6 +390,15 @@ class VideoEncoder {
         // 3. 等待编码线程结束
         encodeThread?.join(1000) // 最多等待 1 秒
         encodeThread = null
+
+        // 等待零拷贝发送中的输出缓冲区归还（native 发送完成或连接关闭时归还）
+        val deadline = System.currentTimeMillis() + 1000
+        while (heldOutputBuffers.get() > 0 && System.currentTimeMillis() < deadline) {
+            Thread.sleep(5)
+        }
+        if (heldOutputBuffers.get() > 0) {
+            Log.e(TAG, "仍有 ${heldOutputBuffers.get()} 个输出缓冲区未归还，强制释放编码器")
+        }
         
         // 4. 释放 MediaCodec 和 Surface
         try {
@@ -0,0 +1,450 @@
+/*
+ * native 热点路径基准（主机构建）：NAL 转换、AMF 编码、RTMP 分块发送、io_uring 发送后端、MSG_ZEROCOPY 大帧发送、
+ * 断网缓存读写、逐帧追踪打点、发送统计更新、日志调用。
+ * 配合 perf 使用：perf record -g ./native_core_bench [过滤关键字]
+ */
+#include "bb_log.h"
+#include "flv_mux.h"
+#include "flv_spool.h"
+#include "frame_trace.h"
+#include "send_stats.h"
+#include "uring_transport.h"
+#include "zerocopy_sender.h"
+#include "librtmp/rtmp.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* 运行 fn 至少 min_ms 毫秒，输出每次耗时与吞吐（bytes_per_op 为 0 时不输出吞吐） */
+static void run_bench(const char *name, size_t bytes_per_op, int min_ms, const std::function<void()> &fn) {
+    fn();  // 预热
+    long iterations = 0;
+    int64_t start = now_ns();
+    int64_t elapsed = 0;
+    long batch = 1;
+    while (elapsed < (int64_t) min_ms * 1000000) {
+        for (long i = 0; i < batch; ++i) fn();
+        iterations += batch;
+        elapsed = now_ns() - start;
+        if (batch < (1 << 16)) batch *= 2;
+    }
+    double ns_per_op = (double) elapsed / iterations;
+    if (bytes_per_op > 0) {
+        double mb_per_s = bytes_per_op * 1e9 / ns_per_op / (1024 * 1024);
+        printf("%-32s %12.1f ns/op %10.1f MB/s %10ld iters\n", name, ns_per_op, mb_per_s, iterations);
+    } else {
+        printf("%-32s %12.1f ns/op %21s %10ld iters\n", name, ns_per_op, "", iterations);
+    }
+}
+
+/* 合成 Annex-B 帧：可选 SPS/PPS + 若干 slice，负载避开起始码 */
+static std::vector<uint8_t> make_annexb_frame(size_t payload_size, int slices, bool key) {
+    std::vector<uint8_t> frame;
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    if (key) {
+        const uint8_t sps[] = {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40};
+        const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), sps, sps + sizeof(sps));
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), pps, pps + sizeof(pps));
+    }
+    uint32_t seed = 12345;
+    for (int s = 0; s < slices; ++s) {
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.push_back(key ? 0x65 : 0x41);
+        for (size_t i = 0; i < payload_size / slices; ++i) {
+            seed = seed * 1103515245 + 12345;
+            frame.push_back((uint8_t) ((seed >> 16) | 0x01));
+        }
+    }
+    return frame;
+}
+
+static void bench_nal(int min_ms) {
+    std::vector<uint8_t> body;
+    body.reserve(256 * 1024);
+    std::vector<uint8_t> idr = make_annexb_frame(120 * 1024, 4, true);
+    std::vector<uint8_t> p_frame = make_annexb_frame(8 * 1024, 1, false);
+    run_bench("annexb_to_avc_body/idr_120k", idr.size(), min_ms, [&] {
+        annexb_to_avc_body(idr.data(), (int) idr.size(), true, body);
+    });
+    run_bench("annexb_to_avc_body/p_8k", p_frame.size(), min_ms, [&] {
+        annexb_to_avc_body(p_frame.data(), (int) p_frame.size(), false, body);
+    });
+    std::vector<uint8_t> sps, pps;
+    run_bench("parse_sps_pps/idr_120k", idr.size(), min_ms, [&] {
+        parse_sps_pps(idr.data(), (int) idr.size(), sps, pps);
+    });
+}
+
+static void bench_amf(int min_ms) {
+    char body[1024];
+    run_bench("build_on_metadata_body", 0, min_ms, [&] {
+        build_on_metadata_body(body, sizeof(body), 1280, 720, 2000000, 30, 44100, 2);
+    });
+}
+
+/* RTMP_SendPacket 分块：写入 socketpair，另一线程持续读空，测量分块 + 系统调用开销 */
+static void bench_chunking(int min_ms) {
+    const int chunk_sizes[] = {128, 4096};
+    const size_t body_size = 32 * 1024;
+    for (int chunk_size : chunk_sizes) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            perror("socketpair");
+            return;
+        }
+        std::thread reader([&] {
+            char buf[64 * 1024];
+            while (read(fds[1], buf, sizeof(buf)) > 0) {
+            }
+        });
+
+        RTMP *rtmp = RTMP_Alloc();
+        RTMP_Init(rtmp);
+        rtmp->m_sb.sb_socket = fds[0];
+        rtmp->m_outChunkSize = chunk_size;
+
+        RTMPPacket packet;
+        RTMPPacket_Alloc(&packet, body_size);
+        RTMPPacket_Reset(&packet);
+        memset(packet.m_body, 0x5A, body_size);
+        packet.m_nBodySize = body_size;
+        packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+        packet.m_nChannel = 0x04;
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+        packet.m_hasAbsTimestamp = 1;
+        uint32_t ts = 0;
+
+        char name[64];
+        snprintf(name, sizeof(name), "RTMP_SendPacket/32k_chunk%d", chunk_size);
+        run_bench(name, body_size, min_ms, [&] {
+            packet.m_nTimeStamp = ts += 33;
+            RTMP_SendPacket(rtmp, &packet, FALSE);
+        });
+
+        RTMPPacket_Free(&packet);
+        rtmp->m_sb.sb_socket = -1;
+        RTMP_Free(rtmp);
+        shutdown(fds[0], SHUT_RDWR);
+        close(fds[0]);
+        reader.join();
+        close(fds[1]);
+    }
+}
+
+/*
+ * 多路发送：每次操作向 N 个 socketpair 各发送一条 32 KB 视频消息（chunk 128）。
+ * socket 为 RTMP_SendPacket 逐 chunk send 依次发送（与 wrapper 在全局锁内发送相同）；
+ * uring 为各连接提交到 io_uring 写端后等待全部写完，同一批次在一次 io_uring_enter 中提交
+ */
+static void bench_uring(int min_ms) {
+    const size_t body_size = 32 * 1024;
+    const int chunk_size = 128;
+    const int stream_counts[] = {1, 32};
+    for (int streams : stream_counts) {
+        std::vector<int> fds(streams * 2);
+        std::vector<std::thread> readers;
+        bool ok = true;
+        for (int i = 0; i < streams && ok; ++i) {
+            ok = socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[i * 2]) == 0;
+            if (ok) {
+                int fd = fds[i * 2 + 1];
+                readers.emplace_back([fd] {
+                    char buf[64 * 1024];
+                    while (read(fd, buf, sizeof(buf)) > 0) {
+                    }
+                });
+            }
+        }
+        if (!ok) {
+            perror("socketpair");
+            return;
+        }
+
+        RTMPPacket packet;
+        RTMPPacket_Alloc(&packet, body_size);
+        RTMPPacket_Reset(&packet);
+        memset(packet.m_body, 0x5A, body_size);
+        packet.m_nBodySize = body_size;
+        packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+        packet.m_nChannel = 0x04;
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+        uint32_t ts = 0;
+        char name[64];
+
+        std::vector<RTMP *> rtmps;
+        for (int i = 0; i < streams; ++i) {
+            RTMP *rtmp = RTMP_Alloc();
+            RTMP_Init(rtmp);
+            rtmp->m_sb.sb_socket = fds[i * 2];
+            rtmp->m_outChunkSize = chunk_size;
+            rtmps.push_back(rtmp);
+        }
+        snprintf(name, sizeof(name), "socket/%dstreams_32k", streams);
+        run_bench(name, body_size * streams, min_ms, [&] {
+            packet.m_nTimeStamp = ts += 33;
+            for (RTMP *rtmp : rtmps) RTMP_SendPacket(rtmp, &packet, FALSE);
+        });
+        for (RTMP *rtmp : rtmps) {
+            rtmp->m_sb.sb_socket = -1;
+            RTMP_Free(rtmp);
+        }
+
+        std::vector<std::shared_ptr<UringWriter>> writers;
+        for (int i = 0; i < streams; ++i) {
+            std::shared_ptr<UringWriter> writer = uring_writer_create(fds[i * 2], nullptr);
+            if (!writer) break;
+            writers.push_back(writer);
+        }
+        snprintf(name, sizeof(name), "uring/%dstreams_32k", streams);
+        if ((int) writers.size() == streams) {
+            rtmp_uring_stats before, after;
+            uring_engine_stats(&before);
+            run_bench(name, body_size * streams, min_ms, [&] {
+                packet.m_nTimeStamp = ts += 33;
+                for (auto &writer : writers) writer->submit(&packet, chunk_size, SEND_STATS_VIDEO, 0);
+                for (auto &writer : writers) writer->drain();
+            });
+            uring_engine_stats(&after);
+            uint64_t enters = after.enter_calls - before.enter_calls;
+            printf("%-32s %12.1f msgs/enter %8.1f sqes/enter\n", "", enters > 0 ?
+                   (double) (after.messages - before.messages) / enters : 0.0,
+                   enters > 0 ? (double) (after.sqes - before.sqes) / enters : 0.0);
+        } else {
+            printf("%-32s 不可用（未以 BB_RTMP_URING 编译或内核不支持）\n", name);
+        }
+        writers.clear();
+
+        RTMPPacket_Free(&packet);
+        for (int i = 0; i < streams; ++i) {
+            shutdown(fds[i * 2], SHUT_RDWR);
+            close(fds[i * 2]);
+        }
+        for (auto &reader : readers) reader.join();
+        for (int i = 0; i < streams; ++i) close(fds[i * 2 + 1]);
+    }
+}
+
+static int64_t process_cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+static bool tcp_loopback_pair(int fds[2]) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bool ok = listener >= 0 && bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+              listen(listener, 1) == 0 && getsockname(listener, (struct sockaddr *) &addr, &len) == 0;
+    fds[0] = ok ? socket(AF_INET, SOCK_STREAM, 0) : -1;
+    ok = ok && fds[0] >= 0 && connect(fds[0], (struct sockaddr *) &addr, sizeof(addr)) == 0;
+    fds[1] = ok ? accept(listener, nullptr, nullptr) : -1;
+    if (listener >= 0) close(listener);
+    return ok && fds[1] >= 0;
+}
+
+/*
+ * 256 KB 关键帧经回环 TCP 发送：librtmp 逐 chunk send（chunk 128 / 64 KB）对比 MSG_ZEROCOPY（chunk 64 KB）。
+ * 回环上内核在接收端把固定的页拷贝一次（completion 带 COPIED 标志），该项测得的是通知与页固定的额外开销；
+ * 真实网卡上拷贝被省去，看 copied/avoided 一行确认实际路径
+ */
+static void bench_zerocopy(int min_ms) {
+    const uint32_t body_size = 256 * 1024;
+    const int chunk_sizes[] = {128, 64 * 1024};
+    for (int mode = 0; mode < 3; ++mode) {
+        int fds[2];
+        if (!tcp_loopback_pair(fds)) {
+            perror("tcp loopback");
+            return;
+        }
+        std::thread reader([&] {
+            char buf[256 * 1024];
+            while (read(fds[1], buf, sizeof(buf)) > 0) {
+            }
+        });
+        int chunk_size = chunk_sizes[mode == 0 ? 0 : 1];
+        std::shared_ptr<SendStats> stats = std::make_shared<SendStats>();
+        std::shared_ptr<ZeroCopySender> sender;
+        if (mode == 2) sender = zerocopy_sender_create(fds[0], 1, stats);
+
+        RTMP *rtmp = RTMP_Alloc();
+        RTMP_Init(rtmp);
+        rtmp->m_sb.sb_socket = fds[0];
+        rtmp->m_outChunkSize = chunk_size;
+        uint32_t ts = 0;
+        char name[64];
+        snprintf(name, sizeof(name), "%s/256k_chunk%d", mode == 2 ? "zerocopy" : "socket", chunk_size);
+        int64_t cpu_start = process_cpu_us();
+        int64_t wall_start = now_ns();
+        long ops = 0;
+        if (mode == 2 && !sender) {
+            printf("%-32s 不可用（内核不支持 MSG_ZEROCOPY）\n", name);
+        } else {
+            run_bench(name, body_size, min_ms, [&] {
+                // 每次发送新构建 packet：零拷贝模式下 body 取自缓冲池并在完成通知后归还，与 wrapper 的用法相同
+                RTMPPacket packet;
+                if (sender) {
+                    sender->alloc_body(&packet, body_size);
+                } else {
+                    RTMPPacket_Alloc(&packet, body_size);
+                }
+                RTMPPacket_Reset(&packet);
+                memset(packet.m_body, 0x5A, 64);
+                packet.m_nBodySize = body_size;
+                packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+                packet.m_nChannel = 0x04;
+                packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+                packet.m_nTimeStamp = ts += 33;
+                if (sender) {
+                    int syscalls = 0;
+                    sender->send(&packet, chunk_size, &syscalls);
+                    FlvTagRef tag = std::make_shared<FlvTag>(&packet);
+                    sender->pin(tag);
+                } else {
+                    RTMP_SendPacket(rtmp, &packet, FALSE);
+                    RTMPPacket_Free(&packet);
+                }
+                ++ops;
+            });
+            double mb = (double) ops * body_size / (1024 * 1024);
+            printf("%-32s %12.2f cpu-ms/MB (wall %.0f ms)\n", "", mb > 0 ? (process_cpu_us() - cpu_start) / 1000.0 / mb : 0.0,
+                   (now_ns() - wall_start) / 1e6);
+        }
+        sender.reset();
+        if (mode == 2) {
+            rtmp_stats_v2 out;
+            out.struct_size = sizeof(out);
+            stats->snapshot(&out);
+            printf("%-32s avoided %.1f MB, copied %.1f MB, completion p50 %llu us p99 %llu us\n", "",
+                   out.copy_avoided_bytes / (1024.0 * 1024.0), out.zerocopy_copied_bytes / (1024.0 * 1024.0),
+                   (unsigned long long) rtmp_histogram_percentile(&out.zerocopy_completion_us, 50),
+                   (unsigned long long) rtmp_histogram_percentile(&out.zerocopy_completion_us, 99));
+        }
+        rtmp->m_sb.sb_socket = -1;
+        RTMP_Free(rtmp);
+        shutdown(fds[0], SHUT_RDWR);
+        close(fds[0]);
+        reader.join();
+        close(fds[1]);
+    }
+}
+
+static void bench_spool(int min_ms) {
+    char tmpl[] = "/tmp/bb_rtmp_bench_XXXXXX";
+    char *dir = mkdtemp(tmpl);
+    if (dir == nullptr) return;
+    std::string path = std::string(dir) + "/spool.bin";
+    {
+        FlvSpool spool(path, 64 * 1024 * 1024);
+        if (!spool.open()) return;
+        std::vector<uint8_t> frame(16 * 1024, 0x5A);
+        std::vector<uint8_t> payload;
+        int64_t ts = 0;
+        run_bench("FlvSpool/append_read_16k", frame.size(), min_ms, [&] {
+            spool.append(RTMP_PACKET_TYPE_VIDEO, false, ts++, frame.data(), (uint32_t) frame.size());
+            if (spool.backlog_records() > 1024) {
+                FlvSpool::Record record;
+                spool.read_front(record, payload);
+                spool.pop_front();
+            }
+        });
+    }
+    rmdir(dir);
+}
+
+/* 逐帧追踪打点开销：开启与关闭两种状态 */
+static void bench_trace(int min_ms) {
+    uint32_t ts = 0;
+    frame_trace_set_enabled(false);
+    run_bench("FRAME_TRACE/disabled", 0, min_ms, [&] {
+        FRAME_TRACE(FRAME_TRACE_PACKET_BUILT, FRAME_TRACE_VIDEO, ts++, 1024);
+    });
+    if (!frame_trace_set_enabled(true)) return;
+    run_bench("FRAME_TRACE/enabled", 0, min_ms, [&] {
+        FRAME_TRACE(FRAME_TRACE_PACKET_BUILT, FRAME_TRACE_VIDEO, ts++, 1024);
+    });
+    frame_trace_set_enabled(false);
+}
+
+/* 每发送一条消息的统计更新开销（三个直方图之一 + 计数器） */
+static void bench_stats(int min_ms) {
+    SendStats stats;
+    int64_t t = 0;
+    run_bench("SendStats/on_packet_sent", 0, min_ms, [&] {
+        t += 1000;
+        stats.on_packet_sent(SEND_STATS_VIDEO, 20000, 4096, true, t - 900, t - 300, t);
+    });
+    rtmp_stats_v2 out;
+    run_bench("SendStats/snapshot", 0, min_ms, [&] {
+        out.struct_size = sizeof(out);
+        stats.snapshot(&out);
+    });
+}
+
+static void discard_log(int, const char *, const char *) {}
+
+/* 同一条发送日志：同步格式化（不含 logd 写入）与异步环形缓冲区只拷贝参数的开销 */
+static void bench_log(int min_ms) {
+    uint32_t ts = 0;
+    char line[1024];
+    run_bench("log/snprintf", 0, min_ms, [&] {
+        snprintf(line, sizeof(line), "发送视频帧: timestamp=%u, isKey=%d, nalu_count=%d, body_size=%zu",
+                 ts++, 1, 3, (size_t) 20480);
+    });
+    bb_log_set_sink(discard_log);
+    bb_log_set_async(true);
+    run_bench("log/async_capture", 0, min_ms, [&] {
+        bb_log_write(ANDROID_LOG_DEBUG, "Bench", "发送视频帧: timestamp=%u, isKey=%d, nalu_count=%d, body_size=%zu",
+                     ts++, 1, 3, (size_t) 20480);
+    });
+    bb_log_set_async(false);
+    bb_log_set_sink(nullptr);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    const char *env_ms = getenv("BENCH_MIN_MS");
+    int min_ms = env_ms != nullptr ? atoi(env_ms) : 500;
+
+    struct {
+        const char *name;
+        void (*fn)(int);
+    } groups[] = {
+            {"nal", bench_nal},
+            {"amf", bench_amf},
+            {"chunking", bench_chunking},
+            {"uring", bench_uring},
+            {"zerocopy", bench_zerocopy},
+            {"spool", bench_spool},
+            {"trace", bench_trace},
+            {"stats", bench_stats},
+            {"log", bench_log},
+    };
+    for (auto &group : groups) {
+        if (filter != nullptr && strstr(group.name, filter) == nullptr) continue;
+        group.fn(min_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * 多路推流基准（主机构建）：同样 N 路 30 fps 视频 + AAC 音频按实时节奏推到本机 IngestServer，对比
+ *   - engine：事件驱动推流引擎（BENCH_ENGINE_THREADS 个 epoll 线程，默认 1）+ 一个送帧线程
+ *   - threads：每路一个线程经 rtmp_wrapper 阻塞发送（现有模型）
+ * IngestServer 运行在 fork 出的子进程中，输出只统计推流进程：总 CPU 占用（单核百分比）、每路 CPU、
+ * 按此估算的单核可承载会话数、每秒上下文切换次数；engine 一行另给出 epoll 线程自身的 CPU 与每秒 sendmsg 次数。
+ * 用法：publish_engine_bench [engine|threads]，BENCH_STREAMS 为逗号分隔的路数（默认 50,200），
+ * BENCH_MIN_MS 控制每项测量时长（默认 5000），BENCH_BITRATE 为每路视频码率（默认 2000000）
+ */
+#include "ingest_server.h"
+#include "rtmp_wrapper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const int kFps = 30;
+static const int kGop = 60;
+static const int kAudioFrameSize = 256;
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Usage {
+    int64_t cpu_us;
+    long context_switches;
+};
+
+static Usage process_usage() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    Usage u;
+    u.cpu_us = (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+               usage.ru_stime.tv_usec;
+    u.context_switches = usage.ru_nvcsw + usage.ru_nivcsw;
+    return u;
+}
+
+/* 合成 Annex-B 帧：关键帧带 SPS/PPS，负载避开起始码 */
+static std::vector<uint8_t> make_frame(size_t payload_size, bool key) {
+    std::vector<uint8_t> frame;
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    if (key) {
+        const uint8_t sps[] = {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40};
+        const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), sps, sps + sizeof(sps));
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), pps, pps + sizeof(pps));
+    }
+    frame.insert(frame.end(), start_code, start_code + 4);
+    frame.push_back(key ? 0x65 : 0x41);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < payload_size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        frame.push_back((uint8_t) ((seed >> 16) | 0x01));
+    }
+    return frame;
+}
+
+// 按实时节奏生成的媒体：第 i 个视频帧在 i * 1000 / kFps 毫秒，第 j 个 AAC 帧在 j * 1024 * 1000 / 44100 毫秒
+struct Media {
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> delta;
+    std::vector<uint8_t> aac;
+
+    explicit Media(int bitrate) : aac(kAudioFrameSize, 0x21) {
+        size_t frame_bytes = (size_t) bitrate / 8 / kFps;
+        key = make_frame(frame_bytes * 4, true);
+        delta = make_frame(frame_bytes * (kGop - 4) / (kGop - 1), false);
+    }
+    static long video_ts(long i) { return i * 1000 / kFps; }
+    static long audio_ts(long j) { return j * 1024 * 1000 / 44100; }
+};
+
+struct Result {
+    int streams = 0;
+    int64_t wall_us = 0;
+    Usage usage = {0, 0};
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    int failed = 0;
+    int64_t engine_cpu_us = -1;
+    uint64_t writes = 0;
+};
+
+static void report(const char *name, const Result &r) {
+    double seconds = r.wall_us / 1e6;
+    double cpu_percent = r.wall_us > 0 ? r.usage.cpu_us * 100.0 / r.wall_us : 0.0;
+    double per_stream = r.streams > 0 ? cpu_percent / r.streams : 0.0;
+    printf("%-10s %6d 路 %8.1f%% CPU %8.3f%%/路 %8.0f 路/核 %10.0f 切换/s %8.1f Mbps %6llu 丢帧 %3d 失败",
+           name, r.streams, cpu_percent, per_stream, per_stream > 0 ? 100.0 / per_stream : 0.0,
+           seconds > 0 ? r.usage.context_switches / seconds : 0.0, seconds > 0 ? r.bytes * 8 / seconds / 1e6 : 0.0,
+           (unsigned long long) r.dropped, r.failed);
+    if (r.engine_cpu_us >= 0) {
+        printf("  epoll 线程 %.1f%% CPU %.0f sendmsg/s", r.engine_cpu_us * 100.0 / r.wall_us,
+               seconds > 0 ? r.writes / seconds : 0.0);
+    }
+    printf("\n");
+}
+
+/* 一个送帧线程按节奏把同一帧送入全部会话，连接建立后测量 min_ms */
+static Result bench_engine(const std::string &base_url, int streams, int engine_threads, int min_ms,
+                           const Media &media) {
+    Result r;
+    r.streams = streams;
+    rtmp_engine_config config;
+    memset(&config, 0, sizeof(config));
+    config.threads = engine_threads;
+    rtmp_engine_t engine = rtmp_engine_create(&config);
+    if (engine == 0) return r;
+    std::vector<rtmp_session_t> sessions;
+    for (int i = 0; i < streams; ++i) {
+        rtmp_session_t session = rtmp_engine_open(engine, (base_url + "engine" + std::to_string(i)).c_str());
+        if (session == 0) {
+            r.failed++;
+            continue;
+        }
+        rtmp_engine_set_metadata(session, 1280, 720, 2000000, kFps, 44100, 2);
+        sessions.push_back(session);
+    }
+    rtmp_engine_stats stats;
+    int64_t deadline = now_us() + 30000000;
+    while (rtmp_engine_get_stats(engine, &stats) == 0 && stats.publishing < (int) sessions.size() &&
+           now_us() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    rtmp_engine_stats before;
+    rtmp_engine_get_stats(engine, &before);
+    Usage usage_before = process_usage();
+    int64_t start = now_us();
+    long video = 0, audio = 0;
+    while (true) {
+        int64_t elapsed_ms = (now_us() - start) / 1000;
+        if (elapsed_ms >= min_ms) break;
+        while (Media::video_ts(video) <= elapsed_ms) {
+            bool key = video % kGop == 0;
+            const std::vector<uint8_t> &frame = key ? media.key : media.delta;
+            for (rtmp_session_t session : sessions) {
+                rtmp_engine_send_video(session, frame.data(), (int) frame.size(), Media::video_ts(video), key);
+            }
+            video++;
+        }
+        while (Media::audio_ts(audio) <= elapsed_ms) {
+            for (rtmp_session_t session : sessions) {
+                rtmp_engine_send_audio(session, media.aac.data(), (int) media.aac.size(), Media::audio_ts(audio));
+            }
+            audio++;
+        }
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+                std::chrono::microseconds(start + std::min(Media::video_ts(video), Media::audio_ts(audio)) * 1000)));
+    }
+    r.wall_us = now_us() - start;
+    Usage usage_after = process_usage();
+    rtmp_engine_get_stats(engine, &stats);
+    r.usage.cpu_us = usage_after.cpu_us - usage_before.cpu_us;
+    r.usage.context_switches = usage_after.context_switches - usage_before.context_switches;
+    r.bytes = stats.bytes_sent - before.bytes_sent;
+    r.engine_cpu_us = stats.cpu_us - before.cpu_us;
+    r.writes = stats.writes - before.writes;
+    for (rtmp_session_t session : sessions) {
+        rtmp_engine_session_stats s;
+        if (rtmp_engine_get_session_stats(session, &s) != 0) continue;
+        r.dropped += s.dropped_frames;
+        if (s.state != RTMP_ENGINE_PUBLISHING) r.failed++;
+    }
+    rtmp_engine_destroy(engine);
+    return r;
+}
+
+/* 每路一个线程：各自按节奏调用 rtmp_send_video/rtmp_send_audio */
+static Result bench_threads(const std::string &base_url, int streams, int min_ms, const Media &media) {
+    Result r;
+    r.streams = streams;
+    std::vector<rtmp_handle_t> handles;
+    for (int i = 0; i < streams; ++i) {
+        rtmp_handle_t handle = rtmp_init((base_url + "threads" + std::to_string(i)).c_str());
+        if (handle == 0) {
+            r.failed++;
+            continue;
+        }
+        rtmp_set_metadata(handle, 1280, 720, 2000000, kFps, 44100, 2);
+        handles.push_back(handle);
+    }
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int> failed{0};
+    Usage usage_before = process_usage();
+    int64_t start = now_us();
+    std::vector<std::thread> threads;
+    for (rtmp_handle_t handle : handles) {
+        threads.emplace_back([&, handle] {
+            std::vector<uint8_t> key = media.key, delta = media.delta, aac = media.aac;
+            long video = 0, audio = 0;
+            uint64_t sent = 0;
+            while (true) {
+                int64_t elapsed_ms = (now_us() - start) / 1000;
+                if (elapsed_ms >= min_ms) break;
+                bool ok = true;
+                while (ok && Media::video_ts(video) <= elapsed_ms) {
+                    bool is_key = video % kGop == 0;
+                    std::vector<uint8_t> &frame = is_key ? key : delta;
+                    ok = rtmp_send_video(handle, frame.data(), (int) frame.size(), Media::video_ts(video), is_key) == 0;
+                    sent += frame.size();
+                    video++;
+                }
+                while (ok && Media::audio_ts(audio) <= elapsed_ms) {
+                    ok = rtmp_send_audio(handle, aac.data(), (int) aac.size(), Media::audio_ts(audio)) == 0;
+                    sent += aac.size();
+                    audio++;
+                }
+                if (!ok) {
+                    failed++;
+                    break;
+                }
+                std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(
+                        start + std::min(Media::video_ts(video), Media::audio_ts(audio)) * 1000)));
+            }
+            bytes += sent;
+        });
+    }
+    for (std::thread &t : threads) t.join();
+    r.wall_us = now_us() - start;
+    Usage usage_after = process_usage();
+    r.usage.cpu_us = usage_after.cpu_us - usage_before.cpu_us;
+    r.usage.context_switches = usage_after.context_switches - usage_before.context_switches;
+    r.bytes = bytes.load();  // FLV 负载字节，不含 chunk 头
+    r.failed += failed.load();
+    for (rtmp_handle_t handle : handles) rtmp_close(handle);
+    return r;
+}
+
+/* 子进程运行 IngestServer，经管道回报端口；父进程关闭 control_fd 后子进程退出 */
+static pid_t start_server(int *port, int *control_fd) {
+    int to_parent[2], to_child[2];
+    if (pipe(to_parent) != 0) return -1;
+    if (pipe(to_child) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(to_parent[0]);
+        close(to_child[1]);
+        IngestServer server;
+        int p = server.start(0) ? server.port() : 0;
+        if (write(to_parent[1], &p, sizeof(p)) != (ssize_t) sizeof(p)) _exit(1);
+        char c;
+        while (read(to_child[0], &c, 1) > 0) {
+        }
+        server.stop();
+        _exit(0);
+    }
+    close(to_parent[1]);
+    close(to_child[0]);
+    *control_fd = to_child[1];
+    if (read(to_parent[0], port, sizeof(*port)) != (ssize_t) sizeof(*port)) *port = 0;
+    close(to_parent[0]);
+    return pid;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    const char *env_ms = getenv("BENCH_MIN_MS");
+    int min_ms = env_ms != nullptr ? atoi(env_ms) : 5000;
+    const char *env_streams = getenv("BENCH_STREAMS");
+    std::string stream_list = env_streams != nullptr ? env_streams : "50,200";
+    const char *env_bitrate = getenv("BENCH_BITRATE");
+    int bitrate = env_bitrate != nullptr ? atoi(env_bitrate) : 2000000;
+    const char *env_threads = getenv("BENCH_ENGINE_THREADS");
+    int engine_threads = env_threads != nullptr ? atoi(env_threads) : 1;
+    signal(SIGPIPE, SIG_IGN);
+
+    // 先 fork 再创建任何线程
+    int port = 0;
+    int control_fd = -1;
+    pid_t server = start_server(&port, &control_fd);
+    if (server < 0 || port == 0) {
+        fprintf(stderr, "IngestServer 启动失败\n");
+        return 1;
+    }
+    std::string base_url = "rtmp://127.0.0.1:" + std::to_string(port) + "/live/";
+    Media media(bitrate);
+    printf("%d 个 CPU，每路视频 %d bps @ %d fps + AAC，测量 %d ms\n", (int) std::thread::hardware_concurrency(), bitrate,
+           kFps, min_ms);
+
+    size_t pos = 0;
+    while (pos < stream_list.size()) {
+        size_t comma = stream_list.find(',', pos);
+        if (comma == std::string::npos) comma = stream_list.size();
+        int streams = atoi(stream_list.substr(pos, comma - pos).c_str());
+        pos = comma + 1;
+        if (streams <= 0) continue;
+        if (filter == nullptr || strstr("engine", filter) != nullptr) {
+            report("engine", bench_engine(base_url, streams, engine_threads, min_ms, media));
+        }
+        if (filter == nullptr || strstr("threads", filter) != nullptr) {
+            report("threads", bench_threads(base_url, streams, min_ms, media));
+        }
+    }
+
+    close(control_fd);
+    waitpid(server, nullptr, 0);
+    return 0;
+}
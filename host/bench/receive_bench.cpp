@@ -0,0 +1,318 @@
+/*
+ * 拉流接收吞吐基准（主机构建）：IngestServer 以 chunk size 128 与 4096 回放同一个 FLV（视频 + AAC），对比
+ *   - readpacket：librtmp 的 RTMP_ReadPacket 逐条读取消息（RTMP_ClientPacket 处理控制消息）
+ *   - receiver：RTMP_ConnectStream 之后由 RtmpReceiver 接手读取消息
+ *   - rtmp_read：librtmp 的 RTMP_Read 输出 FLV
+ *   - play：rtmp_play_read 输出 FLV
+ * IngestServer 运行在 fork 出的子进程中，输出只统计拉流进程：负载吞吐（MB/s，音视频消息体字节）、消息/s、
+ * 每 MB 的 CPU 毫秒；receiver 与 play 另输出 recvmsg 次数与零拷贝消息比例。
+ * 用法：receive_bench [readpacket|receiver|rtmp_read|play]，BENCH_MESSAGES 为视频帧数（默认 5000，音频帧按
+ * 44.1 kHz 节奏穿插），BENCH_FRAME_BYTES 为视频帧大小（默认 4000，关键帧 4 倍）
+ */
+#include "ingest_server.h"
+#include "rtmp_receiver.h"
+#include "rtmp_wrapper.h"
+#include "librtmp/rtmp.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const int kFps = 30;
+static const int kGop = 60;
+static const int kAudioFrameSize = 256;
+static const int kReadBufferSize = 64 * 1024;
+static const int kChunkSizes[2] = {128, 4096};
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t process_cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+struct Source {
+    std::vector<uint8_t> flv;
+    uint64_t messages = 0;       // 音视频 tag 数
+    uint64_t payload_bytes = 0;  // 音视频 tag 数据字节
+};
+
+static void append_tag(Source &source, uint8_t type, uint32_t timestamp, const std::vector<uint8_t> &body) {
+    uint32_t size = (uint32_t) body.size();
+    uint8_t header[11] = {type, (uint8_t) (size >> 16), (uint8_t) (size >> 8), (uint8_t) size,
+                          (uint8_t) (timestamp >> 16), (uint8_t) (timestamp >> 8), (uint8_t) timestamp,
+                          (uint8_t) (timestamp >> 24), 0, 0, 0};
+    source.flv.insert(source.flv.end(), header, header + sizeof(header));
+    source.flv.insert(source.flv.end(), body.begin(), body.end());
+    uint32_t previous = size + 11;
+    uint8_t trailer[4] = {(uint8_t) (previous >> 24), (uint8_t) (previous >> 16), (uint8_t) (previous >> 8),
+                          (uint8_t) previous};
+    source.flv.insert(source.flv.end(), trailer, trailer + sizeof(trailer));
+    source.messages++;
+    source.payload_bytes += size;
+}
+
+/* AVC 视频 tag（关键帧 4 倍大小）与 AAC 音频 tag 按 30 fps / 44.1 kHz 交错 */
+static Source make_source(int frames, size_t frame_bytes) {
+    Source source;
+    const uint8_t header[13] = {'F', 'L', 'V', 0x01, 0x05, 0, 0, 0, 9, 0, 0, 0, 0};
+    source.flv.assign(header, header + sizeof(header));
+    std::vector<uint8_t> key(frame_bytes * 4 + 5), delta(frame_bytes + 5), aac(kAudioFrameSize + 2, 0x21);
+    uint32_t seed = 12345;
+    for (size_t i = 5; i < key.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        key[i] = (uint8_t) (seed >> 16);
+        if (i < delta.size()) delta[i] = key[i];
+    }
+    const uint8_t key_header[5] = {0x17, 0x01, 0, 0, 0};
+    const uint8_t delta_header[5] = {0x27, 0x01, 0, 0, 0};
+    memcpy(key.data(), key_header, 5);
+    memcpy(delta.data(), delta_header, 5);
+    aac[0] = 0xAF;
+    aac[1] = 0x01;
+    long audio = 0;
+    for (int i = 0; i < frames; ++i) {
+        uint32_t ts = (uint32_t) ((long) i * 1000 / kFps);
+        append_tag(source, RTMP_PACKET_TYPE_VIDEO, ts, i % kGop == 0 ? key : delta);
+        while (audio * 1024 * 1000 / 44100 <= ts) {
+            append_tag(source, RTMP_PACKET_TYPE_AUDIO, (uint32_t) (audio * 1024 * 1000 / 44100), aac);
+            audio++;
+        }
+    }
+    return source;
+}
+
+struct Result {
+    bool ok = false;
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;
+    uint64_t messages = 0;
+    uint64_t recv_calls = 0;          // receiver / play
+    uint64_t zero_copy_messages = 0;  // receiver / play
+    uint64_t all_messages = 0;        // receiver / play：含控制消息
+};
+
+static void report(const char *name, int chunk_size, const Source &source, const Result &r) {
+    if (!r.ok) {
+        printf("%-10s %5d 失败\n", name, chunk_size);
+        return;
+    }
+    double seconds = r.wall_us / 1e6;
+    double mb = source.payload_bytes / 1e6;
+    printf("%-10s %5d %8.1f MB/s %10.0f 消息/s %8.1f CPU ms/MB", name, chunk_size,
+           seconds > 0 ? mb / seconds : 0.0, seconds > 0 ? r.messages / seconds : 0.0,
+           mb > 0 ? r.cpu_us / 1000.0 / mb : 0.0);
+    if (r.recv_calls > 0) {
+        printf(" %8llu recvmsg %5.1f%% 零拷贝", (unsigned long long) r.recv_calls,
+               r.all_messages > 0 ? 100.0 * r.zero_copy_messages / r.all_messages : 0.0);
+    }
+    printf("\n");
+}
+
+/* librtmp 建立拉流连接，RTMP_ConnectStream 返回时已收到 NetStream.Play.Start */
+static RTMP *connect_play(std::vector<char> &url) {
+    RTMP *r = RTMP_Alloc();
+    RTMP_Init(r);
+    if (!RTMP_SetupURL(r, url.data())) {
+        RTMP_Free(r);
+        return nullptr;
+    }
+    RTMP_SetBufferMS(r, 1000);
+    if (!RTMP_Connect(r, nullptr) || !RTMP_ConnectStream(r, 0)) {
+        RTMP_Close(r);
+        RTMP_Free(r);
+        return nullptr;
+    }
+    return r;
+}
+
+static Result run_readpacket(const std::string &url, const Source &source) {
+    Result result;
+    std::vector<char> url_copy(url.begin(), url.end());
+    url_copy.push_back('\0');
+    int64_t cpu_before = process_cpu_us();
+    int64_t start = now_us();
+    RTMP *r = connect_play(url_copy);
+    if (r == nullptr) return result;
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    while (result.messages < source.messages && RTMP_IsConnected(r) && RTMP_ReadPacket(r, &packet)) {
+        if (!RTMPPacket_IsReady(&packet)) continue;
+        if (packet.m_packetType == RTMP_PACKET_TYPE_AUDIO || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) {
+            result.messages++;
+        } else {
+            RTMP_ClientPacket(r, &packet);
+        }
+        RTMPPacket_Free(&packet);
+    }
+    result.wall_us = now_us() - start;
+    result.cpu_us = process_cpu_us() - cpu_before;
+    result.ok = result.messages == source.messages;
+    RTMP_Close(r);
+    RTMP_Free(r);
+    return result;
+}
+
+static Result run_receiver(const std::string &url, const Source &source) {
+    Result result;
+    std::vector<char> url_copy(url.begin(), url.end());
+    url_copy.push_back('\0');
+    int64_t cpu_before = process_cpu_us();
+    int64_t start = now_us();
+    RTMP *r = connect_play(url_copy);
+    if (r == nullptr) return result;
+    RtmpReceiver receiver(RTMP_Socket(r));
+    if (receiver.adopt(r)) {
+        RtmpMessage message;
+        while (result.messages < source.messages && receiver.read(&message, 10000) > 0) {
+            if (message.type == RTMP_PACKET_TYPE_AUDIO || message.type == RTMP_PACKET_TYPE_VIDEO) {
+                result.messages++;
+            } else if (message.type == RTMP_PACKET_TYPE_CHUNK_SIZE && message.size >= 4) {
+                const uint8_t *p = message.body;
+                receiver.set_chunk_size(((uint32_t) (p[0] & 0x7f) << 24) | ((uint32_t) p[1] << 16) |
+                                        ((uint32_t) p[2] << 8) | p[3]);
+            }
+        }
+    }
+    result.wall_us = now_us() - start;
+    result.cpu_us = process_cpu_us() - cpu_before;
+    result.ok = result.messages == source.messages;
+    result.recv_calls = receiver.stats().recv_calls;
+    result.zero_copy_messages = receiver.stats().zero_copy_messages;
+    result.all_messages = receiver.stats().messages;
+    RTMP_Close(r);
+    RTMP_Free(r);
+    return result;
+}
+
+static Result run_rtmp_read(const std::string &url, const Source &source) {
+    Result result;
+    std::vector<char> url_copy(url.begin(), url.end());
+    url_copy.push_back('\0');
+    std::vector<char> buf(kReadBufferSize);
+    int64_t cpu_before = process_cpu_us();
+    int64_t start = now_us();
+    RTMP *r = connect_play(url_copy);
+    if (r == nullptr) return result;
+    uint64_t total = 0;
+    int n;
+    while ((n = RTMP_Read(r, buf.data(), (int) buf.size())) > 0) total += (uint64_t) n;
+    result.wall_us = now_us() - start;
+    result.cpu_us = process_cpu_us() - cpu_before;
+    result.ok = total == source.flv.size();
+    result.messages = source.messages;
+    if (!result.ok) fprintf(stderr, "rtmp_read: 读到 %llu 字节，期望 %zu\n", (unsigned long long) total, source.flv.size());
+    RTMP_Close(r);
+    RTMP_Free(r);
+    return result;
+}
+
+static Result run_play(const std::string &url, const Source &source) {
+    Result result;
+    std::vector<uint8_t> buf(kReadBufferSize);
+    int64_t cpu_before = process_cpu_us();
+    int64_t start = now_us();
+    rtmp_play_t player = rtmp_play_open(url.c_str(), 1000);
+    if (player == 0) return result;
+    uint64_t total = 0;
+    int n;
+    while ((n = rtmp_play_read(player, buf.data(), (int) buf.size(), 10000)) > 0) total += (uint64_t) n;
+    result.wall_us = now_us() - start;
+    result.cpu_us = process_cpu_us() - cpu_before;
+    rtmp_play_stats stats;
+    if (rtmp_get_play_stats(player, &stats) == 0) {
+        result.recv_calls = stats.recv_calls;
+        result.zero_copy_messages = stats.zero_copy_messages;
+        result.all_messages = stats.messages;
+    }
+    result.ok = n == 0 && total == source.flv.size();
+    result.messages = source.messages;
+    if (!result.ok) fprintf(stderr, "play: 读到 %llu 字节，期望 %zu\n", (unsigned long long) total, source.flv.size());
+    rtmp_play_close(player);
+    return result;
+}
+
+/* 子进程运行两个 IngestServer（chunk size 128 / 4096），经管道回报端口；父进程关闭 control_fd 后子进程退出 */
+static pid_t start_servers(const Source &source, int ports[2], int *control_fd) {
+    int to_parent[2], to_child[2];
+    if (pipe(to_parent) != 0) return -1;
+    if (pipe(to_child) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(to_parent[0]);
+        close(to_child[1]);
+        IngestServer servers[2];
+        int p[2] = {0, 0};
+        for (int i = 0; i < 2; ++i) {
+            servers[i].set_chunk_size(kChunkSizes[i]);
+            servers[i].set_play_source(source.flv);
+            if (servers[i].start(0)) p[i] = servers[i].port();
+        }
+        if (write(to_parent[1], p, sizeof(p)) != (ssize_t) sizeof(p)) _exit(1);
+        char c;
+        while (read(to_child[0], &c, 1) > 0) {
+        }
+        for (auto &server : servers) server.stop();
+        _exit(0);
+    }
+    close(to_parent[1]);
+    close(to_child[0]);
+    *control_fd = to_child[1];
+    if (read(to_parent[0], ports, 2 * sizeof(int)) != (ssize_t) (2 * sizeof(int))) ports[0] = ports[1] = 0;
+    close(to_parent[0]);
+    return pid;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    const char *env_messages = getenv("BENCH_MESSAGES");
+    int frames = env_messages != nullptr ? atoi(env_messages) : 5000;
+    const char *env_frame = getenv("BENCH_FRAME_BYTES");
+    size_t frame_bytes = env_frame != nullptr ? (size_t) atoi(env_frame) : 4000;
+    signal(SIGPIPE, SIG_IGN);
+
+    Source source = make_source(frames, frame_bytes);
+    // 先 fork 再创建任何线程
+    int ports[2] = {0, 0};
+    int control_fd = -1;
+    pid_t servers = start_servers(source, ports, &control_fd);
+    if (servers < 0 || ports[0] == 0 || ports[1] == 0) {
+        fprintf(stderr, "IngestServer 启动失败\n");
+        return 1;
+    }
+    printf("%d 视频帧 x %zu 字节 + AAC：%llu 条消息，%.1f MB 负载\n", frames, frame_bytes,
+           (unsigned long long) source.messages, source.payload_bytes / 1e6);
+
+    int failures = 0;
+    struct Mode {
+        const char *name;
+        Result (*run)(const std::string &url, const Source &source);
+    };
+    const Mode modes[] = {{"readpacket", run_readpacket}, {"receiver", run_receiver},
+                          {"rtmp_read", run_rtmp_read}, {"play", run_play}};
+    for (int i = 0; i < 2; ++i) {
+        for (const Mode &mode : modes) {
+            if (filter != nullptr && strcmp(filter, mode.name) != 0) continue;
+            std::string url = "rtmp://127.0.0.1:" + std::to_string(ports[i]) + "/live/" + mode.name;
+            Result r = mode.run(url, source);
+            report(mode.name, kChunkSizes[i], source, r);
+            if (!r.ok) failures++;
+        }
+    }
+
+    close(control_fd);
+    waitpid(servers, nullptr, 0);
+    return failures == 0 ? 0 : 1;
+}
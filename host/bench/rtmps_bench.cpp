@@ -0,0 +1,197 @@
+/*
+ * RTMPS 传输基准（主机构建，需以 BB_RTMP_TLS 编译）：经本机 TLS 终结代理对比
+ *   - 推流：明文 RTMP / 用户态 TLS / 内核 TLS（rtmp_send_video 到 IngestServer 的吞吐）
+ *   - 文件：录制的 FLV 经 TlsSession::send_file 发送（内核模式 SSL_sendfile，用户态模式经中继加密）
+ * 输出吞吐与本进程 CPU 时间（含终结代理的解密，各模式相同，可用于横向比较）。
+ * 内核不支持 kTLS 时内核模式一行显示为不可用。
+ * 用法：rtmps_bench [过滤关键字]，BENCH_MIN_MS 控制每项运行时长（默认 2000）
+ */
+#include "ingest_server.h"
+#include "rtmp_wrapper.h"
+#include "tls_session.h"
+#include "tls_terminator.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t process_cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+static void report(const char *name, uint64_t bytes, int64_t wall_us, int64_t cpu_us) {
+    double mb = bytes / (1024.0 * 1024.0);
+    printf("%-32s %10.1f MB/s %10.2f cpu-ms/MB %10.1f MB\n", name, wall_us > 0 ? mb * 1e6 / wall_us : 0.0,
+           mb > 0 ? cpu_us / 1000.0 / mb : 0.0, mb);
+}
+
+/* 合成 Annex-B 帧：关键帧带 SPS/PPS，负载避开起始码 */
+static std::vector<uint8_t> make_frame(size_t payload_size, bool key) {
+    std::vector<uint8_t> frame;
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    if (key) {
+        const uint8_t sps[] = {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40};
+        const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), sps, sps + sizeof(sps));
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), pps, pps + sizeof(pps));
+    }
+    frame.insert(frame.end(), start_code, start_code + 4);
+    frame.push_back(key ? 0x65 : 0x41);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < payload_size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        frame.push_back((uint8_t) ((seed >> 16) | 0x01));
+    }
+    return frame;
+}
+
+/* 以 64 KB 帧连续推流 min_ms 毫秒；tls_flags < 0 表示明文 RTMP */
+static void bench_publish(const char *name, int tls_flags, int min_ms) {
+    IngestServer server;
+    TlsTerminator terminator;
+    if (!server.start(0)) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/bench";
+    if (tls_flags >= 0) {
+        TlsTerminatorOptions options;
+        options.backend_port = server.port();
+        if (!terminator.start(0, options)) return;
+        rtmp_tls_configure(nullptr, tls_flags | RTMP_TLS_NO_VERIFY);
+        url = "rtmps://127.0.0.1:" + std::to_string(terminator.port()) + "/live/bench";
+    }
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    if (handle == 0) {
+        printf("%-32s 连接失败\n", name);
+        return;
+    }
+    rtmp_tls_info info;
+    rtmp_get_tls_info(handle, &info);
+    if (tls_flags >= 0 && (tls_flags & RTMP_TLS_FULL_OFFLOAD) && info.mode != RTMP_TLS_MODE_KERNEL) {
+        printf("%-32s 不可用（内核 TLS 未启用：ktls_send=%d, ktls_recv=%d）\n", name, info.ktls_send, info.ktls_recv);
+        rtmp_close(handle);
+        return;
+    }
+    rtmp_set_metadata(handle, 1280, 720, 4000000, 30, 44100, 2);
+    std::vector<uint8_t> key = make_frame(64 * 1024, true);
+    std::vector<uint8_t> delta = make_frame(64 * 1024, false);
+    uint64_t bytes = 0;
+    long ts = 0;
+    int64_t start = now_us();
+    int64_t cpu_start = process_cpu_us();
+    for (int i = 0; now_us() - start < (int64_t) min_ms * 1000; ++i, ts += 33) {
+        const std::vector<uint8_t> &frame = i % 60 == 0 ? key : delta;
+        if (rtmp_send_video(handle, const_cast<uint8_t *>(frame.data()), (int) frame.size(), ts, i % 60 == 0) != 0) {
+            printf("%-32s 发送失败\n", name);
+            break;
+        }
+        bytes += frame.size();
+    }
+    rtmp_close(handle);
+    server.wait_closed(1, 10000);
+    report(name, bytes, now_us() - start, process_cpu_us() - cpu_start);
+}
+
+/* 录制的 FLV 经 TLS 连接原样发送（终结代理丢弃数据），等待对端全部解密后计时结束 */
+static void bench_send_file(const char *name, bool allow_ktls, int min_ms) {
+    char path[] = "/tmp/bb_rtmp_bench_flv_XXXXXX";
+    int file_fd = mkstemp(path);
+    if (file_fd < 0) return;
+    unlink(path);
+    const size_t kFileSize = 8 * 1024 * 1024;
+    std::vector<uint8_t> chunk = make_frame(1024 * 1024 - 5, false);
+    for (size_t written = 0; written < kFileSize; written += chunk.size()) {
+        if (write(file_fd, chunk.data(), chunk.size()) != (ssize_t) chunk.size()) break;
+    }
+
+    TlsTerminator terminator;
+    TlsTerminatorOptions options;
+    options.max_tls12 = true;
+    if (!terminator.start(0, options)) {
+        close(file_fd);
+        return;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) terminator.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TlsSession *tls = nullptr;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+        TlsConfig config;
+        config.verify = false;
+        config.allow_ktls = allow_ktls;
+        config.full_offload = true;
+        tls = TlsSession::connect(&fd, "127.0.0.1", config);
+    }
+    if (tls == nullptr) {
+        printf("%-32s 握手失败\n", name);
+    } else if (allow_ktls && tls->mode() != TLS_MODE_KERNEL) {
+        printf("%-32s 不可用（内核 TLS 未启用）\n", name);
+    } else {
+        uint64_t bytes = 0;
+        int64_t start = now_us();
+        int64_t cpu_start = process_cpu_us();
+        while (now_us() - start < (int64_t) min_ms * 1000) {
+            long n = tls->send_file(file_fd, 0, kFileSize);
+            if (n <= 0) break;
+            bytes += (uint64_t) n;
+        }
+        int64_t deadline = now_us() + 10000000;
+        while (terminator.bytes_in() < bytes && now_us() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        report(name, bytes, now_us() - start, process_cpu_us() - cpu_start);
+    }
+    close(fd);
+    delete tls;
+    terminator.stop();
+    close(file_fd);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    const char *env_ms = getenv("BENCH_MIN_MS");
+    int min_ms = env_ms != nullptr ? atoi(env_ms) : 2000;
+    signal(SIGPIPE, SIG_IGN);
+
+    struct {
+        const char *name;
+        int tls_flags;
+    } publish[] = {
+            {"publish/plain", -1},
+            {"publish/tls_userspace", RTMP_TLS_NO_KTLS},
+            {"publish/tls_auto", 0},
+            {"publish/ktls_full_offload", RTMP_TLS_FULL_OFFLOAD},
+    };
+    for (auto &item : publish) {
+        if (filter != nullptr && strstr(item.name, filter) == nullptr) continue;
+        bench_publish(item.name, item.tls_flags, min_ms);
+    }
+    if (filter == nullptr || strstr("sendfile/tls_userspace", filter) != nullptr) {
+        bench_send_file("sendfile/tls_userspace", false, min_ms);
+    }
+    if (filter == nullptr || strstr("sendfile/ktls", filter) != nullptr) {
+        bench_send_file("sendfile/ktls", true, min_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * RTMPT 吞吐基准（主机构建）：同样的视频 + AAC 消息序列尽快推到本机 RTMPT 网关（后端为 IngestServer），对比
+ *   - librtmp：librtmp 原生 RTMPT，每条消息一个 POST /send
+ *   - batch0：rtmp_set_rtmpt_batch(0)，不等待，只合并上一个 POST 写出期间积累的消息
+ *   - batch5：rtmp_set_rtmpt_batch(5)，5 ms 合并窗口
+ *   - rtmp：明文 rtmp:// 直连 IngestServer（参照）
+ * 网关与 IngestServer 运行在 fork 出的子进程中，输出只统计推流进程：吞吐（MB/s、消息/s）、POST 数、每 MB 的 CPU 毫秒。
+ * librtmp 推流时从不读取应答，应答堆积在接收缓冲区，缓冲区写满后网关阻塞、推流随之停滞：因此以固定消息数而非
+ * 时长测量，默认消息数下应答总量远小于回环 socket 的缓冲区。
+ * 用法：rtmpt_bench [librtmp|batch0|batch5|rtmp]，BENCH_MESSAGES 为每项的视频帧数（默认 5000，音频帧按 44.1 kHz
+ * 节奏穿插），BENCH_FRAME_BYTES 为视频帧大小（默认 4000）
+ */
+#include "ingest_server.h"
+#include "rtmp_wrapper.h"
+#include "rtmpt_gateway.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const int kFps = 30;
+static const int kGop = 60;
+static const int kAudioFrameSize = 256;
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t process_cpu_us() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+           usage.ru_stime.tv_usec;
+}
+
+/* 合成 Annex-B 帧：关键帧带 SPS/PPS，负载避开起始码 */
+static std::vector<uint8_t> make_frame(size_t payload_size, bool key) {
+    std::vector<uint8_t> frame;
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    if (key) {
+        const uint8_t sps[] = {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40};
+        const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), sps, sps + sizeof(sps));
+        frame.insert(frame.end(), start_code, start_code + 4);
+        frame.insert(frame.end(), pps, pps + sizeof(pps));
+    }
+    frame.insert(frame.end(), start_code, start_code + 4);
+    frame.push_back(key ? 0x65 : 0x41);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < payload_size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        frame.push_back((uint8_t) ((seed >> 16) | 0x01));
+    }
+    return frame;
+}
+
+struct Result {
+    bool ok = false;
+    int64_t wall_us = 0;
+    int64_t cpu_us = 0;
+    uint64_t bytes = 0;     // FLV 负载字节
+    uint64_t messages = 0;
+    uint64_t posts = 0;     // POST /send 数；rtmp 为 0
+};
+
+static void report(const char *name, const Result &r) {
+    if (!r.ok) {
+        printf("%-8s 失败\n", name);
+        return;
+    }
+    double seconds = r.wall_us / 1e6;
+    double mb = r.bytes / 1e6;
+    printf("%-8s %8.1f MB/s %10.0f 消息/s %8llu POST %6.2f 消息/POST %8.1f CPU ms/MB\n", name,
+           seconds > 0 ? mb / seconds : 0.0, seconds > 0 ? r.messages / seconds : 0.0, (unsigned long long) r.posts,
+           r.posts > 0 ? (double) r.messages / r.posts : 0.0, mb > 0 ? r.cpu_us / 1000.0 / mb : 0.0);
+}
+
+/* window_ms < 0 不开启批量发送 */
+static Result run(const std::string &url, int window_ms, bool rtmpt, int frames, size_t frame_bytes) {
+    Result r;
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    if (handle == 0) return r;
+    rtmp_set_metadata(handle, 1280, 720, (int) (frame_bytes * 8 * kFps), kFps, 44100, 2);
+    if (window_ms >= 0 && rtmp_set_rtmpt_batch(handle, window_ms) != 0) {
+        rtmp_close(handle);
+        return r;
+    }
+    std::vector<uint8_t> key = make_frame(frame_bytes * 4, true);
+    std::vector<uint8_t> delta = make_frame(frame_bytes, false);
+    std::vector<uint8_t> aac(kAudioFrameSize, 0x21);
+
+    int64_t cpu_before = process_cpu_us();
+    int64_t start = now_us();
+    bool ok = true;
+    long audio = 0;
+    for (int i = 0; ok && i < frames; ++i) {
+        long ts = (long) i * 1000 / kFps;
+        bool is_key = i % kGop == 0;
+        std::vector<uint8_t> &frame = is_key ? key : delta;
+        ok = rtmp_send_video(handle, frame.data(), (int) frame.size(), ts, is_key) == 0;
+        while (ok && audio * 1024 * 1000 / 44100 <= ts) {
+            ok = rtmp_send_audio(handle, aac.data(), (int) aac.size(), audio * 1024 * 1000 / 44100) == 0;
+            audio++;
+        }
+    }
+    if (ok && window_ms >= 0) ok = rtmp_flush(handle, 10000) == 0;
+    r.wall_us = now_us() - start;
+    r.cpu_us = process_cpu_us() - cpu_before;
+
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    if (rtmp_get_stats_v2(handle, &stats) == 0) {
+        r.bytes = stats.video.bytes + stats.audio.bytes;
+        r.messages = stats.video.messages + stats.audio.messages + stats.data.messages;
+        if (rtmpt) r.posts = r.messages;  // librtmp 每条消息一个 POST
+    }
+    rtmp_rtmpt_stats rtmpt_stats;
+    if (window_ms >= 0 && rtmp_get_rtmpt_stats(handle, &rtmpt_stats) == 0) r.posts = rtmpt_stats.posts;
+    r.ok = ok;
+    rtmp_close(handle);
+    return r;
+}
+
+/* 子进程运行 IngestServer 与 RTMPT 网关，经管道回报两个端口；父进程关闭 control_fd 后子进程退出 */
+static pid_t start_servers(int ports[2], int *control_fd) {
+    int to_parent[2], to_child[2];
+    if (pipe(to_parent) != 0) return -1;
+    if (pipe(to_child) != 0) return -1;
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(to_parent[0]);
+        close(to_child[1]);
+        IngestServer server;
+        RtmptGateway gateway;
+        int p[2] = {0, 0};
+        if (server.start(0) && gateway.start(0, server.port())) {
+            p[0] = server.port();
+            p[1] = gateway.port();
+        }
+        if (write(to_parent[1], p, sizeof(p)) != (ssize_t) sizeof(p)) _exit(1);
+        char c;
+        while (read(to_child[0], &c, 1) > 0) {
+        }
+        gateway.stop();
+        server.stop();
+        _exit(0);
+    }
+    close(to_parent[1]);
+    close(to_child[0]);
+    *control_fd = to_child[1];
+    if (read(to_parent[0], ports, 2 * sizeof(int)) != (ssize_t) (2 * sizeof(int))) ports[0] = ports[1] = 0;
+    close(to_parent[0]);
+    return pid;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    const char *env_messages = getenv("BENCH_MESSAGES");
+    int frames = env_messages != nullptr ? atoi(env_messages) : 5000;
+    const char *env_frame = getenv("BENCH_FRAME_BYTES");
+    size_t frame_bytes = env_frame != nullptr ? (size_t) atoi(env_frame) : 4000;
+    signal(SIGPIPE, SIG_IGN);
+
+    // 先 fork 再创建任何线程
+    int ports[2] = {0, 0};
+    int control_fd = -1;
+    pid_t servers = start_servers(ports, &control_fd);
+    if (servers < 0 || ports[0] == 0 || ports[1] == 0) {
+        fprintf(stderr, "IngestServer / RTMPT 网关启动失败\n");
+        return 1;
+    }
+    std::string rtmp_url = "rtmp://127.0.0.1:" + std::to_string(ports[0]) + "/live/";
+    std::string rtmpt_url = "rtmpt://127.0.0.1:" + std::to_string(ports[1]) + "/live/";
+    printf("%d 视频帧 x %zu 字节 + AAC\n", frames, frame_bytes);
+
+    int failures = 0;
+    struct Mode {
+        const char *name;
+        int window_ms;
+        bool rtmpt;
+    };
+    const Mode modes[] = {{"librtmp", -1, true}, {"batch0", 0, true}, {"batch5", 5, true}, {"rtmp", -1, false}};
+    for (const Mode &mode : modes) {
+        if (filter != nullptr && strcmp(filter, mode.name) != 0) continue;
+        std::string url = (mode.rtmpt ? rtmpt_url : rtmp_url) + mode.name;
+        Result r = run(url, mode.window_ms, mode.rtmpt, frames, frame_bytes);
+        report(mode.name, r);
+        if (!r.ok) failures++;
+    }
+
+    close(control_fd);
+    waitpid(servers, nullptr, 0);
+    return failures == 0 ? 0 : 1;
+}
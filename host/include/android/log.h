@@ -0,0 +1,35 @@
+#ifndef BB_RTMP_HOST_ANDROID_LOG_H
+#define BB_RTMP_HOST_ANDROID_LOG_H
+
+/*
+ * 主机构建用的 <android/log.h> 替身：仅提供 native 代码用到的接口，
+ * 日志输出到 stderr，级别由环境变量 BB_RTMP_LOG_LEVEL 控制（默认只输出 WARN 及以上）
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+#include <stdarg.h>
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+int __android_log_vprint(int prio, const char *tag, const char *fmt, va_list ap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BB_RTMP_HOST_ANDROID_LOG_H
@@ -0,0 +1,32 @@
+#include <android/log.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+static int log_threshold() {
+    static int threshold = -1;
+    if (threshold < 0) {
+        const char *env = getenv("BB_RTMP_LOG_LEVEL");
+        threshold = env != nullptr ? atoi(env) : ANDROID_LOG_WARN;
+    }
+    return threshold;
+}
+
+int __android_log_vprint(int prio, const char *tag, const char *fmt, va_list ap) {
+    if (prio < log_threshold()) return 0;
+
+    static const char kLevels[] = "??VDIWEFS";
+    char level = prio >= 0 && prio <= ANDROID_LOG_SILENT ? kLevels[prio] : '?';
+
+    char line[1024];
+    vsnprintf(line, sizeof(line), fmt, ap);
+    return fprintf(stderr, "%c/%s: %s\n", level, tag, line);
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int result = __android_log_vprint(prio, tag, fmt, args);
+    va_end(args);
+    return result;
+}
@@ -0,0 +1,170 @@
+/*
+ * 网络损伤模型单元测试：带宽、时延、停顿、脚本循环与 Mahimahi trace（虚拟时钟驱动）
+ */
+#include "impair_link.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond); \
+            g_failures++; \
+        } \
+    } while (0)
+
+static std::string write_temp(const std::string &content) {
+    char path[] = "/tmp/bb_rtmp_impair_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return "";
+    ssize_t written = write(fd, content.data(), content.size());
+    close(fd);
+    return written == (ssize_t) content.size() ? std::string(path) : std::string();
+}
+
+/* 以 1ms 步长推进虚拟时钟直到队列排空，返回排空时刻（微秒） */
+static int64_t drain(ImpairLink &link, int64_t start_us, int64_t limit_us, int64_t *first_byte_us = nullptr) {
+    for (int64_t now = start_us; now <= limit_us; now += 1000) {
+        const uint8_t *data;
+        size_t n;
+        while ((n = link.sendable(now, &data)) > 0) {
+            if (first_byte_us != nullptr && *first_byte_us < 0) *first_byte_us = now;
+            link.consume(n);
+        }
+        if (link.empty()) return now;
+    }
+    return -1;
+}
+
+static void test_bandwidth_cap() {
+    ImpairSchedule schedule;
+    ImpairState base;
+    base.bw_kbps = 800;  // 100 KB/s
+    schedule.set_base(base);
+    ImpairLink link(schedule, true, 1 << 20, 1);
+    std::vector<uint8_t> data(100 * 1000, 0x5A);
+    link.push(0, data.data(), data.size());
+    int64_t done = drain(link, 0, 5000000);
+    CHECK(done > 950000 && done < 1050000);
+    CHECK(link.forwarded_bytes() == (int64_t) data.size());
+}
+
+static void test_delay_and_order() {
+    ImpairSchedule schedule;
+    ImpairState base;
+    base.delay_ms = 40;
+    base.jitter_ms = 20;
+    schedule.set_base(base);
+    ImpairLink link(schedule, true, 1 << 20, 7);
+    std::vector<uint8_t> expected;
+    for (int i = 0; i < 50; ++i) {
+        std::vector<uint8_t> chunk(100, (uint8_t) i);
+        link.push(i * 1000, chunk.data(), chunk.size());
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+    std::vector<uint8_t> received;
+    int64_t first_byte = -1;
+    for (int64_t now = 0; now <= 200000 && !link.empty(); now += 1000) {
+        const uint8_t *data;
+        size_t n;
+        while ((n = link.sendable(now, &data)) > 0) {
+            if (first_byte < 0) first_byte = now;
+            received.insert(received.end(), data, data + n);
+            link.consume(n);
+        }
+    }
+    CHECK(first_byte >= 40000 && first_byte <= 61000);
+    CHECK(received == expected);  // 抖动不乱序
+}
+
+static void test_queue_limit() {
+    ImpairSchedule schedule;
+    ImpairLink link(schedule, true, 4096, 1);
+    std::vector<uint8_t> data(3000, 1);
+    CHECK(link.writable() == 4096);
+    link.push(0, data.data(), data.size());
+    CHECK(link.writable() == 1096);
+    link.push(0, data.data(), data.size());
+    CHECK(link.writable() == 0);
+}
+
+static void test_script_stall_and_loop() {
+    std::string path = write_temp(
+            "# 测试脚本\n"
+            "0    bw 8000\n"
+            "100  stall 200   # 停顿\n"
+            "500  bw 800\n"
+            "600  outage 50\n"
+            "1000 loop\n");
+    CHECK(!path.empty());
+    ImpairSchedule schedule;
+    std::string error;
+    CHECK(schedule.load_script(path, error));
+    unlink(path.c_str());
+
+    CHECK(schedule.state_at(50).bw_kbps == 8000);
+    CHECK(!schedule.state_at(50).stalled);
+    CHECK(schedule.state_at(150).stalled);
+    CHECK(!schedule.state_at(300).stalled);
+    CHECK(schedule.state_at(550).bw_kbps == 800);
+    CHECK(schedule.state_at(620).outage);
+    CHECK(!schedule.state_at(650).outage);
+    CHECK(schedule.state_at(1050).bw_kbps == 8000);  // 循环后回到开头
+    CHECK(schedule.state_at(1150).stalled);
+
+    // 停顿期间不转发
+    ImpairLink link(schedule, true, 1 << 20, 1);
+    std::vector<uint8_t> data(10000, 1);
+    link.push(100000, data.data(), data.size());
+    int64_t first_byte = -1;
+    drain(link, 100000, 1000000, &first_byte);
+    CHECK(first_byte >= 300000);
+
+    ImpairSchedule bad;
+    std::string bad_path = write_temp("0 warp 10\n");
+    CHECK(!bad.load_script(bad_path, error));
+    unlink(bad_path.c_str());
+}
+
+static void test_mahimahi_trace() {
+    // 每毫秒一次发送机会 = 1500 B/ms，周期 10ms
+    std::string content;
+    for (int t = 1; t <= 10; ++t) content += std::to_string(t) + "\n";
+    std::string path = write_temp(content);
+    ImpairSchedule schedule;
+    std::string error;
+    CHECK(schedule.load_mahimahi(path, error));
+    unlink(path.c_str());
+    CHECK(schedule.opportunities_until(10) == 10);
+    CHECK(schedule.opportunities_until(25) == 25);
+
+    ImpairLink link(schedule, true, 1 << 20, 1);
+    std::vector<uint8_t> data(150000, 1);
+    link.push(0, data.data(), data.size());
+    int64_t done = drain(link, 0, 1000000);
+    CHECK(done >= 99000 && done <= 102000);
+}
+
+int main() {
+    struct {
+        const char *name;
+        void (*fn)();
+    } tests[] = {
+            {"bandwidth_cap", test_bandwidth_cap},
+            {"delay_and_order", test_delay_and_order},
+            {"queue_limit", test_queue_limit},
+            {"script_stall_and_loop", test_script_stall_and_loop},
+            {"mahimahi_trace", test_mahimahi_trace},
+    };
+    for (auto &test : tests) {
+        int before = g_failures;
+        test.fn();
+        printf("[%s] %s\n", g_failures == before ? " OK " : "FAIL", test.name);
+    }
+    return g_failures == 0 ? 0 : 1;
+}
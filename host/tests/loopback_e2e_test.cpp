@@ -0,0 +1,1416 @@
+/*
+ * 端到端回环测试：rtmp_wrapper 推流到进程内 IngestServer，校验握手、序列头、tag 与时延探针
+ */
+#include "bitstream.h"
+#include "ingest_server.h"
+#include "latency_probe.h"
+#include "rtmp_wrapper.h"
+#include "rtmpt_gateway.h"
+#ifdef BB_RTMP_TLS
+#include "tls_terminator.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond); \
+            g_failures++; \
+        } \
+    } while (0)
+
+static void append_nal(std::vector<uint8_t> &out, const std::vector<uint8_t> &nal) {
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    out.insert(out.end(), start_code, start_code + 4);
+    out.insert(out.end(), nal.begin(), nal.end());
+}
+
+static std::vector<uint8_t> make_frame(bool key, int64_t send_time_us) {
+    std::vector<uint8_t> frame;
+    if (key) {
+        append_nal(frame, {0x67, 0x42, 0x00, 0x1F, 0x95, 0xA8, 0x14, 0x01, 0x6E, 0x40});
+        append_nal(frame, {0x68, 0xCE, 0x3C, 0x80});
+    }
+    latency_probe_append_sei(frame, send_time_us);
+    std::vector<uint8_t> slice(key ? 6000 : 800, 0x5A);
+    slice[0] = key ? 0x65 : 0x41;
+    append_nal(frame, slice);
+    return frame;
+}
+
+static void test_publish_roundtrip() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/e2e";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    const int kVideoFrames = 60;
+    const int kAudioFrames = 80;
+    std::vector<uint8_t> aac(200, 0x21);
+    int audio_sent = 0;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        long ts = i * 33;
+        std::vector<uint8_t> frame = make_frame(i % 30 == 0, latency_probe_now_us());
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), ts, i % 30 == 0) == 0);
+        while (audio_sent < kAudioFrames && audio_sent * 1024 * 1000 / 44100 <= ts) {
+            CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), audio_sent * 1024 * 1000 / 44100) == 0);
+            audio_sent++;
+        }
+    }
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.version == RTMP_STATS_VERSION);
+    CHECK(stats.video.messages == (uint64_t) kVideoFrames + 1);  // 含 AVC 序列头
+    CHECK(stats.audio.messages == (uint64_t) audio_sent + 1);    // 含 AAC 序列头
+    CHECK(stats.data.messages == 1);                             // onMetaData
+    CHECK(stats.send_failures == 0);
+    CHECK(stats.chunks >= stats.video.messages + stats.audio.messages + stats.data.messages);
+    CHECK(stats.send_duration_us.count == stats.video.messages + stats.audio.messages + stats.data.messages);
+    CHECK(stats.enqueue_to_wire_us.count == stats.send_duration_us.count);
+    CHECK(stats.video_frame_gap_us.count == (uint64_t) kVideoFrames - 1);
+    CHECK(stats.queue_depth_bytes >= 0);
+    rtmp_close(handle);
+    CHECK(rtmp_get_stats_v2(handle, &stats) != 0);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.app == "live");
+    CHECK(s.stream_name == "e2e");
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.avc_config_valid);
+    CHECK(s.aac_config_valid);
+    CHECK(s.video_frames == kVideoFrames);
+    CHECK(s.video_keyframes == 2);
+    CHECK(s.audio_frames == audio_sent);
+    CHECK(s.delay_us.size() == (size_t) kVideoFrames);
+    for (int64_t d : s.delay_us) {
+        CHECK(d >= 0 && d < 5 * 1000000);
+    }
+}
+
+static std::vector<uint8_t> make_hevc_frame(bool key) {
+    std::vector<uint8_t> frame;
+    if (key) {
+        append_nal(frame, {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+                           0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0x95, 0x98, 0x09});
+        append_nal(frame, {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00,
+                           0x00, 0x03, 0x00, 0x78, 0xA0, 0x03, 0xC0, 0x80, 0x10, 0xE5, 0x96, 0x56, 0x69, 0x24,
+                           0xCA, 0xE0, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x01, 0xE0, 0x80});
+        append_nal(frame, {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40});
+    }
+    std::vector<uint8_t> slice(key ? 6000 : 800, 0x5A);
+    slice[0] = key ? 0x26 : 0x02;  // IDR_W_RADL(19) / TRAIL_R(1)
+    slice[1] = 0x01;
+    append_nal(frame, slice);
+    return frame;
+}
+
+/* HEVC 以 Enhanced RTMP 'hvc1' 发送：序列头与帧都应通过 ingest 校验，onMetaData 照常发送 */
+static void test_publish_hevc() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/hevc";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_video_codec(handle, 99) != 0);
+    CHECK(rtmp_set_video_codec(handle, RTMP_VIDEO_CODEC_HEVC) == 0);
+    CHECK(rtmp_set_metadata(handle, 1920, 1080, 3000000, 30, 44100, 2) == 0);
+
+    const int kVideoFrames = 45;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        std::vector<uint8_t> frame = make_hevc_frame(i % 30 == 0);
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, i % 30 == 0) == 0);
+    }
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.hevc_config_valid);
+    CHECK(!s.avc_config_valid);
+    CHECK(s.video_frames == kVideoFrames);
+    CHECK(s.video_keyframes == 2);
+}
+
+/* Opus 以 Enhanced RTMP 'Opus' 发送：OpusHead 序列头与帧都应通过 ingest 校验 */
+static void test_publish_opus() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/opus";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_audio_codec(handle, 99, 0) != 0);
+    CHECK(rtmp_set_audio_codec(handle, RTMP_AUDIO_CODEC_OPUS, 24000) == 0);
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 48000, 1) == 0);
+
+    const int kAudioFrames = 50;  // 20ms 一包
+    std::vector<uint8_t> packet(60, 0x3C);
+    std::vector<uint8_t> adts_like(60, 0xFF);  // Opus 包不应被当作 ADTS 剥掉 7 字节
+    for (int i = 0; i < kAudioFrames; ++i) {
+        std::vector<uint8_t> &payload = i % 2 == 0 ? packet : adts_like;
+        CHECK(rtmp_send_audio(handle, payload.data(), (int) payload.size(), i * 20) == 0);
+    }
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.audio.messages == (uint64_t) kAudioFrames + 1);
+    CHECK(stats.audio.bytes == (uint64_t) (5 + 19) + (uint64_t) kAudioFrames * (5 + 60));
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.opus_config_valid);
+    CHECK(!s.aac_config_valid);
+    CHECK(s.audio_frames == kAudioFrames);
+}
+
+/* 零拷贝异步发送：native 发送线程直接读调用方缓冲区，每个令牌发送完成后恰好释放一次 */
+struct ReleaseLog {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::map<long, std::vector<int>> results;
+};
+
+static void on_buffer_released(rtmp_handle_t handle, long token, int result, void *user_data) {
+    (void) handle;
+    ReleaseLog *log = static_cast<ReleaseLog *>(user_data);
+    std::lock_guard<std::mutex> lock(log->mutex);
+    log->results[token].push_back(result);
+    log->cond.notify_all();
+}
+
+static void test_publish_async_buffers() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/async";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    const int kVideoFrames = 60;
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < kVideoFrames; ++i) frames.push_back(make_frame(i % 30 == 0, latency_probe_now_us()));
+    CHECK(rtmp_send_video_async(handle, frames[0].data(), (int) frames[0].size(), 0, 1, 0) != 0);  // 未注册回调
+
+    ReleaseLog log;
+    CHECK(rtmp_set_buffer_release_callback(handle, on_buffer_released, &log, kVideoFrames) == 0);
+    for (int i = 0; i < kVideoFrames; ++i) {
+        CHECK(rtmp_send_video_async(handle, frames[i].data(), (int) frames[i].size(), i * 33, i % 30 == 0, 100 + i) == 0);
+    }
+    {
+        std::unique_lock<std::mutex> lock(log.mutex);
+        CHECK(log.cond.wait_for(lock, std::chrono::seconds(5),
+                                [&] { return log.results.size() == (size_t) kVideoFrames; }));
+        for (int i = 0; i < kVideoFrames; ++i) {
+            CHECK(log.results[100 + i] == std::vector<int>{0});
+        }
+    }
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.video.messages == (uint64_t) kVideoFrames + 1);
+    CHECK(stats.dropped_video_frames == 0);
+    rtmp_close(handle);
+    CHECK(rtmp_send_video_async(handle, frames[0].data(), (int) frames[0].size(), 0, 1, 1) != 0);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.avc_config_valid);
+    CHECK(s.video_frames == kVideoFrames);
+    CHECK(s.video_keyframes == 2);
+}
+
+/* 帧环：编码线程写入 native 帧环，发送线程经 rtmp_ring_send 原地发送 */
+static void test_publish_frame_ring() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/ring";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    const int kVideoFrames = 60;
+    rtmp_ring_t ring = rtmp_ring_create(RTMP_RING_VIDEO, 256 * 1024, kVideoFrames);
+    CHECK(ring != 0);
+    if (ring == 0) return;
+    long capacity = 0;
+    uint8_t *data = rtmp_ring_data(ring, &capacity);
+    CHECK(data != nullptr && capacity == 256 * 1024);
+
+    std::thread producer([&] {
+        for (int i = 0; i < kVideoFrames; ++i) {
+            std::vector<uint8_t> frame = make_frame(i % 30 == 0, latency_probe_now_us());
+            long offset = rtmp_ring_reserve(ring, (int) frame.size(), i % 30 == 0);
+            CHECK(offset >= 0);
+            if (offset < 0) continue;
+            memcpy(data + offset, frame.data(), frame.size());
+            CHECK(rtmp_ring_commit(ring, i * 33) == 0);
+            if (i % 10 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    int sent = 0, keyframes = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (sent < kVideoFrames && std::chrono::steady_clock::now() < deadline) {
+        int result = rtmp_ring_send(ring, handle, 0, 100);
+        CHECK(result >= 0);
+        if (result < 0) break;
+        if (result & RTMP_RING_CONSUMED) sent++;
+        if (result & RTMP_RING_KEYFRAME) keyframes++;
+    }
+    producer.join();
+    CHECK(sent == kVideoFrames);
+    CHECK(keyframes == 2);
+    CHECK(rtmp_ring_send(ring, handle, 0, 0) == 0);  // 已空
+
+    rtmp_ring_stats stats;
+    CHECK(rtmp_ring_get_stats(ring, &stats) == 0);
+    CHECK(stats.pushed_frames == kVideoFrames);
+    CHECK(stats.queued_frames == 0 && stats.used_bytes == 0);
+    CHECK(stats.dropped_frames == 0 && stats.flushed_frames == 0);
+    rtmp_ring_destroy(ring);
+    CHECK(rtmp_ring_reserve(ring, 16, 1) < 0);
+    // 新帧环复用同一槽位，旧句柄仍然无效
+    rtmp_ring_t reused = rtmp_ring_create(RTMP_RING_AUDIO, 4096, 0);
+    CHECK(reused != 0 && reused != ring);
+    CHECK(rtmp_ring_reserve(ring, 16, 1) < 0);
+    CHECK(rtmp_ring_reserve(reused, 16, 1) >= 0);
+    rtmp_ring_destroy(reused);
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.avc_config_valid);
+    CHECK(s.video_frames == kVideoFrames);
+    CHECK(s.video_keyframes == 2);
+}
+
+static void append_rbsp_nal(std::vector<uint8_t> &out, uint8_t header, const BitWriter &rbsp) {
+    std::vector<uint8_t> nal(1, header);
+    rbsp_to_nal(rbsp.data().data(), rbsp.data().size(), nal);
+    append_nal(out, nal);
+}
+
+/* 语法完整的 Baseline SPS + PPS（Annex-B），crop_bottom 以 2 行为单位（4:2:0） */
+static std::vector<uint8_t> make_parameter_sets(int width_mbs, int height_mbs, int crop_bottom) {
+    BitWriter sps;
+    sps.bits(8, 66);
+    sps.bits(8, 0);
+    sps.bits(8, 30);
+    sps.ue(0);
+    sps.ue(0);  // log2_max_frame_num_minus4
+    sps.ue(0);  // pic_order_cnt_type
+    sps.ue(2);
+    sps.ue(1);  // max_num_ref_frames
+    sps.bit(0);
+    sps.ue((uint32_t) width_mbs - 1);
+    sps.ue((uint32_t) height_mbs - 1);
+    sps.bit(1);  // frame_mbs_only_flag
+    sps.bit(1);
+    sps.bit(crop_bottom > 0 ? 1 : 0);  // frame_cropping_flag
+    if (crop_bottom > 0) {
+        sps.ue(0);
+        sps.ue(0);
+        sps.ue(0);
+        sps.ue((uint32_t) crop_bottom);
+    }
+    sps.bit(0);
+    sps.trailing_bits();
+    BitWriter pps;
+    pps.ue(0);
+    pps.ue(0);
+    pps.bit(0);  // CAVLC
+    pps.bit(0);
+    pps.ue(0);
+    pps.ue(0);
+    pps.ue(0);
+    pps.bit(0);
+    pps.bits(2, 0);
+    pps.se(0);
+    pps.se(0);
+    pps.se(0);
+    pps.bit(1);
+    pps.bit(0);
+    pps.bit(0);
+    pps.trailing_bits();
+
+    std::vector<uint8_t> frame;
+    append_rbsp_nal(frame, 0x67, sps);
+    append_rbsp_nal(frame, 0x68, pps);
+    return frame;
+}
+
+/* 只含 slice 头的 IDR（Annex-B），slice 数据不参与解析 */
+static std::vector<uint8_t> make_idr_slice() {
+    BitWriter idr;
+    idr.ue(0);
+    idr.ue(7);  // I slice
+    idr.ue(0);
+    idr.bits(4, 0);
+    idr.ue(0);
+    idr.bits(6, 0);
+    idr.bits(32, 0x12345678);
+    idr.trailing_bits();
+    std::vector<uint8_t> frame;
+    append_rbsp_nal(frame, 0x65, idr);
+    return frame;
+}
+
+/* 320x240 关键帧（SPS + PPS + IDR），心跳据此合成 P_Skip 帧 */
+static std::vector<uint8_t> make_heartbeat_keyframe() {
+    std::vector<uint8_t> frame = make_parameter_sets(20, 15, 0);
+    std::vector<uint8_t> idr = make_idr_slice();
+    frame.insert(frame.end(), idr.begin(), idr.end());
+    return frame;
+}
+
+/* 后台心跳：停推期间持续输出 P_Skip 帧、定期重发关键帧，并在音频断流时补静音 */
+static void test_publish_heartbeat() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/heartbeat";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 320, 240, 300000, 30, 44100, 2) == 0);
+
+    std::vector<uint8_t> key = make_heartbeat_keyframe();
+    std::vector<uint8_t> aac(200, 0x21);
+    CHECK(rtmp_heartbeat_stop(handle) != 0);  // 未启动
+    CHECK(rtmp_send_video(handle, key.data(), (int) key.size(), 0, 1) == 0);
+    CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), 0) == 0);
+    CHECK(rtmp_heartbeat_start(handle, key.data(), (int) key.size(), 33, 20, 100) == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    CHECK(rtmp_heartbeat_stop(handle) == 0);
+
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.send_failures == 0);
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.avc_config_valid);
+    // 约 350ms / 50ms 个心跳帧，其中每 100ms 一个关键帧
+    CHECK(s.video_frames >= 5);
+    CHECK(s.video_keyframes >= 3 && s.video_keyframes < s.video_frames);
+    CHECK(s.audio_frames > 5);
+}
+
+/* 分辨率切换：新参数集在第一个使用它的 IDR 处生效，序列头与 onMetaData 紧贴该 IDR，且不丢帧 */
+static void test_resolution_switch() {
+    IngestServer server;
+    std::mutex tags_mutex;
+    std::vector<IngestTag> tags;
+    server.set_tag_callback([&](const IngestStreamStats &, const IngestTag &tag) {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        tags.push_back(tag);
+    });
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/switch";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 1280, 720, 800000, 30, 44100, 2) == 0);  // 以 SPS 为准
+
+    std::vector<uint8_t> slice = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x02, 0x03, 0x04};
+    std::vector<uint8_t> key = make_heartbeat_keyframe();
+    std::vector<uint8_t> config_b = make_parameter_sets(40, 23, 4);  // 640x368 裁剪为 640x360
+    std::vector<uint8_t> idr_b = make_idr_slice();
+    long ts = 0;
+    CHECK(rtmp_send_video(handle, key.data(), (int) key.size(), ts, 1) == 0);
+    for (int i = 0; i < 3; ++i) CHECK(rtmp_send_video(handle, slice.data(), (int) slice.size(), ts += 33, 0) == 0);
+    // 新编码器先单独输出参数集，旧编码器的帧仍在途
+    CHECK(rtmp_send_video(handle, config_b.data(), (int) config_b.size(), ts, 1) == 0);
+    for (int i = 0; i < 2; ++i) CHECK(rtmp_send_video(handle, slice.data(), (int) slice.size(), ts += 33, 0) == 0);
+    CHECK(rtmp_send_video(handle, idr_b.data(), (int) idr_b.size(), ts += 33, 1) == 0);
+    for (int i = 0; i < 2; ++i) CHECK(rtmp_send_video(handle, slice.data(), (int) slice.size(), ts += 33, 0) == 0);
+    // 相同内容的参数集不触发重发
+    CHECK(rtmp_send_video(handle, config_b.data(), (int) config_b.size(), ts, 1) == 0);
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.avc_config_valid);
+    CHECK(s.video_frames == 9);
+    CHECK(s.video_keyframes == 2);
+
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    int configs = 0, scripts = 0;
+    size_t second_config = 0;
+    for (size_t i = 0; i < tags.size(); ++i) {
+        if (tags[i].type == 9 && tags[i].config && ++configs == 2) second_config = i;
+        if (tags[i].type == 18) scripts++;
+    }
+    CHECK(configs == 2);
+    CHECK(scripts == 2);
+    CHECK(second_config > 0 && second_config + 2 < tags.size());
+    if (second_config == 0 || second_config + 2 >= tags.size()) return;
+    // 第二个序列头之前是 1 个关键帧 + 5 个旧序列的非关键帧
+    CHECK(tags[second_config - 1].type == 9 && !tags[second_config - 1].keyframe);
+    CHECK(tags[second_config + 1].type == 18);
+    CHECK(tags[second_config + 2].type == 9 && tags[second_config + 2].keyframe);
+    CHECK(tags[second_config + 2].timestamp_ms == (uint32_t) (6 * 33));
+}
+
+/* 时间戳回退应被计为错误，且只推音频时不应出现视频帧 */
+static void test_rejects_timestamp_regression() {
+    IngestServer server;
+    CHECK(server.start(0));
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/bad";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    // 没有 SPS/PPS：wrapper 不会发送视频帧，只有音频（序列头由 wrapper 自动补发）
+    std::vector<uint8_t> aac(100, 0x21);
+    CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), 100) == 0);
+    CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), 50) == 0);  // 时间戳回退
+    rtmp_close(handle);
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    CHECK(streams[0].audio_frames == 2);
+    CHECK(streams[0].video_frames == 0);
+    CHECK(streams[0].errors == 1);
+}
+
+/*
+ * io_uring 发送后端：关键帧大于一个注册缓冲区（64 KB）与超出单连接额度（回退 librtmp）的帧都应完整到达，
+ * 切回 socket 后端时等待队列写完；内核不支持时 rtmp_set_transport 返回负数，跳过
+ */
+static void test_publish_uring() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/uring";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    if (rtmp_set_transport(handle, RTMP_TRANSPORT_URING) != 0) {
+        printf("  io_uring 不可用，跳过\n");
+        rtmp_close(handle);
+        return;
+    }
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    const int kVideoFrames = 40;
+    std::vector<uint8_t> aac(200, 0x21);
+    int audio_sent = 0;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        long ts = i * 33;
+        std::vector<uint8_t> frame = make_frame(i % 10 == 0, latency_probe_now_us());
+        if (i == 10) frame.insert(frame.end(), 200 * 1024, 0x5A);   // 跨多个注册缓冲区
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), ts, i % 10 == 0) == 0);
+        while (audio_sent * 1024 * 1000 / 44100 <= ts) {
+            CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), audio_sent * 1024 * 1000 / 44100) == 0);
+            audio_sent++;
+        }
+    }
+    CHECK(rtmp_set_transport(handle, RTMP_TRANSPORT_SOCKET) == 0);
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.video.messages == (uint64_t) kVideoFrames + 1);
+    CHECK(stats.audio.messages == (uint64_t) audio_sent + 1);
+    CHECK(stats.send_failures == 0);
+    CHECK(stats.send_duration_us.count == stats.video.messages + stats.audio.messages + stats.data.messages);
+    // 除 onMetaData 外每条消息一次 io_uring_enter，远少于 librtmp 的逐 chunk send
+    CHECK(stats.send_syscalls * 10 < stats.chunks);
+    rtmp_uring_stats uring;
+    CHECK(rtmp_get_uring_stats(&uring) == 0);
+    CHECK(uring.available == 1);
+    CHECK(uring.messages >= (uint64_t) kVideoFrames + audio_sent);
+    CHECK(uring.timeouts == 0);
+
+    // 重新切到 io_uring：超出单连接额度的帧先等待队列写完再经 librtmp 发送，前后的帧保持顺序
+    CHECK(rtmp_set_transport(handle, RTMP_TRANSPORT_URING) == 0);
+    for (int i = kVideoFrames; i < kVideoFrames + 3; ++i) {
+        std::vector<uint8_t> frame = make_frame(false, latency_probe_now_us());
+        if (i == kVideoFrames + 1) frame.insert(frame.end(), 1200 * 1024, 0x5A);
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, 0) == 0);
+    }
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.avc_config_valid);
+    CHECK(s.aac_config_valid);
+    CHECK(s.video_frames == kVideoFrames + 3);
+    CHECK(s.video_keyframes == 4);
+    CHECK(s.audio_frames == audio_sent);
+}
+
+/*
+ * 大视频帧以 MSG_ZEROCOPY 发出（回环上内核回退为拷贝，仍会发出完成通知）：服务端收到的视频字节与发送统计一致，
+ * 后半段开启录制，body 同时被录制线程与零拷贝发送端持有
+ */
+static void test_publish_zerocopy() {
+    IngestServer server;
+    std::mutex tags_mutex;
+    uint64_t video_tag_bytes = 0;
+    server.set_tag_callback([&](const IngestStreamStats &, const IngestTag &tag) {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        if (tag.type == 9) video_tag_bytes += tag.size;
+    });
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/zerocopy";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_zerocopy(handle, 64 * 1024, 100) != 0);  // chunk size 过小
+    if (rtmp_set_zerocopy(handle, 64 * 1024, 64 * 1024) != 0) {
+        printf("  MSG_ZEROCOPY 不可用，跳过\n");
+        rtmp_close(handle);
+        return;
+    }
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    char record_path[] = "/tmp/bb_rtmp_zerocopy_XXXXXX.flv";
+    int record_fd = mkstemps(record_path, 4);
+    CHECK(record_fd >= 0);
+    if (record_fd >= 0) close(record_fd);
+    const int kVideoFrames = 30;
+    int large_frames = 0;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        if (i == 20) CHECK(rtmp_start_recording(handle, record_path, 0, 0) == 0);
+        bool key = i % 10 == 0;
+        std::vector<uint8_t> frame = make_frame(key, latency_probe_now_us());
+        if (key || i % 3 == 0) {
+            frame.insert(frame.end(), (key ? 200 : 100) * 1024, 0x5A);
+            large_frames++;
+        }
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, key) == 0);
+    }
+    CHECK(rtmp_stop_recording(handle) == 0);
+
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    for (int i = 0; i < 200; ++i) {
+        CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+        if (stats.zerocopy_completion_us.count >= stats.zerocopy_messages) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(stats.version == RTMP_STATS_VERSION);
+    CHECK(stats.send_failures == 0);
+    CHECK(stats.zerocopy_messages == (uint64_t) large_frames);
+    CHECK(stats.zerocopy_completion_us.count == stats.zerocopy_messages);
+    CHECK(stats.copy_avoided_bytes + stats.zerocopy_copied_bytes == stats.zerocopy_bytes);
+    // 64 KB chunk 下 100~200 KB 的帧每条只需一两次 sendmsg
+    CHECK(stats.send_syscalls < stats.video.messages * 4);
+    uint64_t sent_video_bytes = stats.video.bytes;
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (!streams.empty()) {
+        const IngestStreamStats &s = streams[0];
+        for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+        CHECK(s.errors == 0);
+        CHECK(s.avc_config_valid);
+        CHECK(s.video_frames == kVideoFrames);
+        CHECK(s.video_keyframes == 3);
+    }
+    {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        CHECK(video_tag_bytes == sent_video_bytes);
+    }
+    FILE *record = fopen(record_path, "rb");
+    CHECK(record != nullptr);
+    if (record != nullptr) {
+        fseek(record, 0, SEEK_END);
+        CHECK(ftell(record) > 200 * 1024);
+        fclose(record);
+    }
+    unlink(record_path);
+}
+
+/*
+ * rtmpt:// 经回环网关推流：批量发送把多条消息合并进一个 POST，停用后交还 librtmp 逐条发送，
+ * 服务端收到的 chunk 流（请求序号、头压缩）前后衔接正确
+ */
+static void test_publish_rtmpt_batched() {
+    IngestServer server;
+    std::atomic<int> video_tags{0};
+    server.set_tag_callback([&](const IngestStreamStats &, const IngestTag &tag) {
+        if (tag.type == 9 && !tag.config) video_tags++;
+    });
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    RtmptGateway gateway;
+    CHECK(gateway.start(0, server.port()));
+    if (gateway.port() == 0) return;
+
+    std::string url = "rtmpt://127.0.0.1:" + std::to_string(gateway.port()) + "/live/rtmpt";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_send_deadline(handle, 100) != 0);  // RTMPT 不支持限时发送
+    rtmp_rtmpt_stats rtmpt;
+    CHECK(rtmp_get_rtmpt_stats(handle, &rtmpt) != 0);  // 尚未开启
+    CHECK(rtmp_set_rtmpt_batch(handle, 20) == 0);
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    const int kBatchedFrames = 60;
+    const int kTailFrames = 5;
+    std::vector<uint8_t> aac(200, 0x21);
+    int audio_sent = 0;
+    for (int i = 0; i < kBatchedFrames + kTailFrames; ++i) {
+        long ts = i * 33;
+        if (i == kBatchedFrames) {
+            CHECK(rtmp_flush(handle, 1000) == 0);
+            CHECK(rtmp_get_rtmpt_stats(handle, &rtmpt) == 0);
+            CHECK(rtmp_set_rtmpt_batch(handle, -1) == 0);
+        }
+        std::vector<uint8_t> frame = make_frame(i % 30 == 0, latency_probe_now_us());
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), ts, i % 30 == 0) == 0);
+        while (audio_sent * 1024 * 1000 / 44100 <= ts) {
+            CHECK(rtmp_send_audio(handle, aac.data(), (int) aac.size(), audio_sent * 1024 * 1000 / 44100) == 0);
+            audio_sent++;
+        }
+        if (i < kBatchedFrames) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    // 序列头、onMetaData 与 60 帧视频、约 90 帧音频合并进远少于消息数的 POST
+    CHECK(rtmpt.messages >= (uint64_t) kBatchedFrames + 3);
+    CHECK(rtmpt.posts > 0);
+    CHECK(rtmpt.posts * 2 < rtmpt.messages);
+    CHECK(rtmpt.bytes > (uint64_t) kBatchedFrames * 100);
+    CHECK(rtmpt.max_post_bytes > 0 && (uint64_t) rtmpt.max_post_bytes <= rtmpt.bytes);
+    CHECK(rtmpt.responses <= rtmpt.posts + rtmpt.idle_polls);
+    CHECK(rtmp_get_rtmpt_stats(handle, &rtmpt) != 0);  // 已停用
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.send_failures == 0);
+    CHECK(stats.video.messages == (uint64_t) kBatchedFrames + kTailFrames + 1);
+    // librtmp 从不读取应答：带着未读应答关闭 socket 会发出 RST，网关可能丢弃尚未读取的请求，先等服务端收齐
+    for (int i = 0; i < 500 && video_tags < kBatchedFrames + kTailFrames; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    gateway.stop();
+    server.stop();
+    CHECK(gateway.sessions() == 1);
+    CHECK(gateway.sends() < (uint64_t) (kBatchedFrames + kTailFrames + audio_sent));
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.stream_name == "rtmpt");
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.avc_config_valid);
+    CHECK(s.aac_config_valid);
+    CHECK(s.video_frames == kBatchedFrames + kTailFrames);
+    CHECK(s.audio_frames == audio_sent);
+}
+
+/* 服务端停止读取（tag 回调阻塞）时限时发送在期限内返回 RTMP_SEND_WOULD_BLOCK，恢复后续写完，服务端收到的字节完整 */
+static void test_publish_send_deadline() {
+    IngestServer server;
+    std::mutex stall_mutex;
+    std::condition_variable stall_cv;
+    bool stalled = false;
+    uint64_t video_tag_bytes = 0;
+    server.set_tag_callback([&](const IngestStreamStats &, const IngestTag &tag) {
+        std::unique_lock<std::mutex> lock(stall_mutex);
+        if (tag.type == 9) video_tag_bytes += tag.size;
+        stall_cv.wait(lock, [&] { return !stalled; });
+    });
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/deadline";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_send_deadline(handle, 50) == 0);
+    CHECK(rtmp_set_transport(handle, RTMP_TRANSPORT_URING) != 0);  // 互斥
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    long timestamp = 0;
+    for (int i = 0; i < 10; ++i, timestamp += 33) {
+        std::vector<uint8_t> frame = make_frame(i == 0, latency_probe_now_us());
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), timestamp, i == 0) == 0);
+    }
+    {
+        std::lock_guard<std::mutex> lock(stall_mutex);
+        stalled = true;
+    }
+    // 服务端不再读取：发送缓冲区写满后每次调用最多阻塞到期限
+    int would_block = 0;
+    int64_t max_call_us = 0;
+    for (int i = 0; i < 400 && would_block < 3; ++i, timestamp += 33) {
+        std::vector<uint8_t> frame = make_frame(true, latency_probe_now_us());
+        frame.insert(frame.end(), 256 * 1024, 0x5A);
+        int64_t start_us = latency_probe_now_us();
+        int result = rtmp_send_video(handle, frame.data(), (int) frame.size(), timestamp, 1);
+        max_call_us = std::max(max_call_us, latency_probe_now_us() - start_us);
+        CHECK(result == 0 || result == RTMP_SEND_WOULD_BLOCK);
+        if (result == RTMP_SEND_WOULD_BLOCK) would_block++;
+    }
+    CHECK(would_block == 3);
+    CHECK(max_call_us < 1000000);
+    // 只尝试一次：窗口内在途数据被确认时剩余部分可能恰好写完
+    int flushed = rtmp_flush(handle, 0);
+    CHECK(flushed == 0 || flushed == RTMP_SEND_WOULD_BLOCK);
+    {
+        std::lock_guard<std::mutex> lock(stall_mutex);
+        stalled = false;
+    }
+    stall_cv.notify_all();
+    CHECK(rtmp_flush(handle, 5000) == 0);
+    for (int i = 0; i < 10; ++i, timestamp += 33) {
+        std::vector<uint8_t> frame = make_frame(i == 0, latency_probe_now_us());
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), timestamp, i == 0) == 0);
+    }
+
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    CHECK(rtmp_get_stats_v2(handle, &stats) == 0);
+    CHECK(stats.send_failures == 0);
+    CHECK(stats.would_block_frames == 3);
+    CHECK(stats.partial_messages >= 1);
+    CHECK(stats.resumed_bytes > 0);
+    uint64_t sent_video_bytes = stats.video.bytes;
+    CHECK(rtmp_set_send_deadline(handle, 0) == 0);
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (!streams.empty()) {
+        for (const std::string &message : streams[0].error_messages) {
+            fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+        }
+        CHECK(streams[0].errors == 0);
+        CHECK(streams[0].avc_config_valid);
+    }
+    std::lock_guard<std::mutex> lock(stall_mutex);
+    CHECK(video_tag_bytes == sent_video_bytes);
+}
+
+// net.ipv4.tcp_fastopen：位 1 客户端，位 2 服务端
+static int sysctl_fast_open() {
+    FILE *f = fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+    if (f == nullptr) return 0;
+    int value = 0;
+    if (fscanf(f, "%d", &value) != 1) value = 0;
+    fclose(f);
+    return value;
+}
+
+/*
+ * TCP Fast Open：第一次连接没有 cookie，照常握手并请求 cookie；服务端开启 TFO 时之后的连接 C0+C1 随 SYN 发出。
+ * 服务端未开启（sysctl 不含服务端位）时 SYN 数据被拒绝、由内核重传，推流结果与普通连接相同
+ */
+static void test_publish_fast_open() {
+    if (rtmp_set_fast_open(1) != 0) {
+        printf("  不支持 TCP_FASTOPEN_CONNECT，跳过\n");
+        return;
+    }
+    IngestServer server;
+    server.set_fast_open(16);
+    CHECK(server.start(0));
+    if (server.port() == 0) {
+        rtmp_set_fast_open(0);
+        return;
+    }
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/tfo";
+
+    const int kRounds = 3;
+    const int kVideoFrames = 10;
+    std::vector<rtmp_connect_timing> timings;
+    for (int round = 0; round <= kRounds; ++round) {
+        // 最后一轮关闭 TFO 作对照
+        if (round == kRounds) CHECK(rtmp_set_fast_open(0) == 0);
+        rtmp_handle_t handle = rtmp_init(url.c_str());
+        CHECK(handle != 0);
+        if (handle == 0) continue;
+        rtmp_connect_timing timing;
+        CHECK(rtmp_get_connect_timing(handle, &timing) == 0);
+        timings.push_back(timing);
+        for (int i = 0; i < kVideoFrames; ++i) {
+            std::vector<uint8_t> frame = make_frame(i == 0, latency_probe_now_us());
+            CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, i == 0) == 0);
+        }
+        rtmp_close(handle);
+        CHECK(rtmp_get_connect_timing(handle, &timing) != 0);
+    }
+    CHECK(server.wait_closed(kRounds + 1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(timings.size() == (size_t) kRounds + 1);
+    if (timings.size() != (size_t) kRounds + 1) return;
+
+    int sysctl = sysctl_fast_open();
+    for (int round = 0; round <= kRounds; ++round) {
+        const rtmp_connect_timing &t = timings[round];
+        CHECK(t.dns_us >= 0 && t.tcp_connect_us >= 0 && t.rtmp_connect_us > 0 && t.connect_stream_us > 0);
+        CHECK(t.total_us >= t.dns_us + t.tcp_connect_us + t.rtmp_connect_us + t.connect_stream_us);
+        CHECK(t.tls_us == 0);
+        CHECK(t.rtt_us > 0);
+        if (round == kRounds) {
+            CHECK(t.fast_open == RTMP_FAST_OPEN_OFF);
+        } else {
+            // cookie 按目的地址缓存在内核中，之前的运行可能已经取得
+            CHECK(t.fast_open == RTMP_FAST_OPEN_NO_COOKIE || t.fast_open == RTMP_FAST_OPEN_USED ||
+                  t.fast_open == RTMP_FAST_OPEN_REFUSED);
+        }
+        CHECK((t.saved_rtt_us > 0) == (t.fast_open == RTMP_FAST_OPEN_USED));
+    }
+    if ((sysctl & 3) == 3) {
+        // 第一次连接已取得 cookie
+        CHECK(timings[kRounds - 1].fast_open == RTMP_FAST_OPEN_USED);
+        CHECK(timings[kRounds - 1].saved_rtt_us == timings[kRounds - 1].rtt_us);
+    } else {
+        printf("  net.ipv4.tcp_fastopen=%d 未同时开启客户端与服务端，只验证回退\n", sysctl);
+        for (const rtmp_connect_timing &t : timings) CHECK(t.fast_open != RTMP_FAST_OPEN_USED);
+    }
+
+    CHECK(streams.size() == (size_t) kRounds + 1);
+    for (const IngestStreamStats &s : streams) {
+        for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+        CHECK(s.errors == 0);
+        CHECK(s.avc_config_valid);
+        CHECK(s.video_frames == kVideoFrames);
+    }
+}
+
+// 轮询会话统计直到 pred 成立或超时，返回最后一次的统计
+template <typename Pred>
+static rtmp_engine_session_stats wait_engine_session(rtmp_session_t session, int timeout_ms, Pred pred) {
+    rtmp_engine_session_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (rtmp_engine_get_session_stats(session, &stats) == 0 && !pred(stats) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return stats;
+}
+
+/* 两个 epoll 线程驱动 8 路会话：publish 成功前送入的帧排队，之后连同 onMetaData 与序列头完整到达服务端 */
+static void test_engine_publish() {
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    rtmp_engine_config config;
+    memset(&config, 0, sizeof(config));
+    config.threads = 2;
+    rtmp_engine_t engine = rtmp_engine_create(&config);
+    CHECK(engine != 0);
+    if (engine == 0) return;
+    CHECK(rtmp_engine_open(engine, "rtmps://127.0.0.1/live/x") == 0);  // 只支持明文 RTMP
+
+    const int kSessions = 8;
+    const int kVideoFrames = 60;
+    std::vector<rtmp_session_t> sessions;
+    for (int i = 0; i < kSessions; ++i) {
+        std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/engine" + std::to_string(i);
+        rtmp_session_t session = rtmp_engine_open(engine, url.c_str());
+        CHECK(session != 0);
+        if (session == 0) continue;
+        CHECK(rtmp_engine_set_metadata(session, 640, 360, 800000, 30, 44100, 2) == 0);
+        sessions.push_back(session);
+    }
+    std::vector<uint8_t> aac(200, 0x21);
+    int audio_sent = 0;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        long ts = i * 33;
+        std::vector<uint8_t> frame = make_frame(i % 30 == 0, latency_probe_now_us());
+        for (rtmp_session_t session : sessions) {
+            CHECK(rtmp_engine_send_video(session, frame.data(), (int) frame.size(), ts, i % 30 == 0) == 0);
+        }
+        while (audio_sent * 1024 * 1000 / 44100 <= ts) {
+            for (rtmp_session_t session : sessions) {
+                CHECK(rtmp_engine_send_audio(session, aac.data(), (int) aac.size(), audio_sent * 1024 * 1000 / 44100) == 0);
+            }
+            audio_sent++;
+        }
+    }
+    for (rtmp_session_t session : sessions) {
+        rtmp_engine_session_stats stats = wait_engine_session(session, 5000, [&](const rtmp_engine_session_stats &s) {
+            return s.video_frames == (uint64_t) kVideoFrames && s.audio_frames == (uint64_t) audio_sent;
+        });
+        CHECK(stats.state == RTMP_ENGINE_PUBLISHING);
+        CHECK(stats.video_frames == (uint64_t) kVideoFrames);
+        CHECK(stats.audio_frames == (uint64_t) audio_sent);
+        CHECK(stats.dropped_frames == 0);
+        CHECK(stats.reconnects == 0);
+        CHECK(stats.connect_us > 0);
+        CHECK(stats.bytes_sent > 0);
+    }
+    rtmp_engine_stats engine_stats;
+    CHECK(rtmp_engine_get_stats(engine, &engine_stats) == 0);
+    CHECK(engine_stats.threads == 2);
+    CHECK(engine_stats.sessions == (int) sessions.size());
+    CHECK(engine_stats.publishing == (int) sessions.size());
+    CHECK(engine_stats.writes > 0 && engine_stats.wakeups > 0);
+    // 多条消息合并写出：sendmsg 次数少于消息数
+    CHECK(engine_stats.writes < (uint64_t) sessions.size() * (kVideoFrames + audio_sent));
+
+    for (rtmp_session_t session : sessions) rtmp_engine_close(session, 2000);
+    rtmp_engine_session_stats closed;
+    CHECK(rtmp_engine_get_session_stats(sessions[0], &closed) != 0);
+    CHECK(rtmp_engine_get_stats(engine, &engine_stats) == 0);
+    CHECK(engine_stats.sessions == 0);
+    rtmp_engine_destroy(engine);
+    CHECK(rtmp_engine_get_stats(engine, &engine_stats) != 0);
+
+    CHECK(server.wait_closed(kSessions, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == (size_t) kSessions);
+    for (const IngestStreamStats &s : streams) {
+        for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+        CHECK(s.app == "live");
+        CHECK(s.errors == 0);
+        CHECK(s.metadata_received);
+        CHECK(s.avc_config_valid);
+        CHECK(s.aac_config_valid);
+        CHECK(s.video_frames == kVideoFrames);
+        CHECK(s.video_keyframes == 2);
+        CHECK(s.audio_frames == audio_sent);
+    }
+}
+
+/* 服务端重启后会话按退避重连，等待关键帧并重发序列头；ping 应答给出 RTT */
+static void test_engine_reconnect() {
+    std::unique_ptr<IngestServer> server(new IngestServer());
+    CHECK(server->start(0));
+    int port = server->port();
+    if (port == 0) return;
+    rtmp_engine_config config;
+    memset(&config, 0, sizeof(config));
+    config.ping_interval_ms = 50;
+    config.reconnect_min_ms = 50;
+    config.reconnect_max_ms = 200;
+    rtmp_engine_t engine = rtmp_engine_create(&config);
+    CHECK(engine != 0);
+    if (engine == 0) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(port) + "/live/reconnect";
+    rtmp_session_t session = rtmp_engine_open(engine, url.c_str());
+    CHECK(session != 0);
+    if (session == 0) {
+        rtmp_engine_destroy(engine);
+        return;
+    }
+    CHECK(rtmp_engine_set_metadata(session, 640, 360, 800000, 30, 44100, 2) == 0);
+
+    long ts = 0;
+    auto send_frames = [&](int count) {
+        for (int i = 0; i < count; ++i, ts += 33) {
+            std::vector<uint8_t> frame = make_frame(i == 0, latency_probe_now_us());
+            CHECK(rtmp_engine_send_video(session, frame.data(), (int) frame.size(), ts, i == 0) == 0);
+        }
+    };
+    send_frames(10);
+    rtmp_engine_session_stats stats = wait_engine_session(session, 5000, [](const rtmp_engine_session_stats &s) {
+        return s.video_frames == 10 && s.rtt_us >= 0;
+    });
+    CHECK(stats.video_frames == 10);
+    CHECK(stats.rtt_us >= 0 && stats.rtt_us < 1000000);
+
+    server->stop();
+    stats = wait_engine_session(session, 5000, [](const rtmp_engine_session_stats &s) {
+        return s.state != RTMP_ENGINE_PUBLISHING;
+    });
+    CHECK(stats.state != RTMP_ENGINE_PUBLISHING);
+    // 断线期间的非关键帧被丢弃，直到下一个关键帧
+    std::vector<uint8_t> delta = make_frame(false, latency_probe_now_us());
+    CHECK(rtmp_engine_send_video(session, delta.data(), (int) delta.size(), ts, 0) == RTMP_ENGINE_DROPPED);
+    ts += 33;
+
+    server.reset(new IngestServer());
+    CHECK(server->start(port));
+    stats = wait_engine_session(session, 5000, [](const rtmp_engine_session_stats &s) {
+        return s.state == RTMP_ENGINE_PUBLISHING;
+    });
+    CHECK(stats.state == RTMP_ENGINE_PUBLISHING);
+    CHECK(stats.reconnects == 1);
+    send_frames(10);
+    stats = wait_engine_session(session, 5000, [](const rtmp_engine_session_stats &s) {
+        return s.video_frames == 20;
+    });
+    CHECK(stats.video_frames == 20);
+    CHECK(stats.dropped_frames >= 1);
+
+    rtmp_engine_close(session, 2000);
+    rtmp_engine_destroy(engine);
+    CHECK(server->wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server->streams();
+    server->stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.stream_name == "reconnect");
+    CHECK(s.errors == 0);
+    CHECK(s.metadata_received);
+    CHECK(s.avc_config_valid);
+    CHECK(s.video_frames == 10);
+}
+
+/* FLV tag：11 字节头 + 数据 + PreviousTagSize */
+static void append_flv_tag(std::vector<uint8_t> &flv, uint8_t type, uint32_t timestamp, uint32_t size, uint8_t seed) {
+    uint8_t header[11] = {type, (uint8_t) (size >> 16), (uint8_t) (size >> 8), (uint8_t) size,
+                          (uint8_t) (timestamp >> 16), (uint8_t) (timestamp >> 8), (uint8_t) timestamp,
+                          (uint8_t) (timestamp >> 24), 0, 0, 0};
+    flv.insert(flv.end(), header, header + sizeof(header));
+    for (uint32_t i = 0; i < size; ++i) flv.push_back((uint8_t) (i * 7 + seed));
+    uint32_t previous = size + 11;
+    uint8_t trailer[4] = {(uint8_t) (previous >> 24), (uint8_t) (previous >> 16), (uint8_t) (previous >> 8),
+                          (uint8_t) previous};
+    flv.insert(flv.end(), trailer, trailer + sizeof(trailer));
+}
+
+/* 拉流：IngestServer 回放 FLV，rtmp_play_read 以小缓冲区读出的字节流应与源文件逐字节相同，流结束后返回 0 */
+static void test_play() {
+    std::vector<uint8_t> flv = {'F', 'L', 'V', 0x01, 0x05, 0, 0, 0, 9, 0, 0, 0, 0};
+    append_flv_tag(flv, 18, 0, 120, 1);
+    append_flv_tag(flv, 9, 0, 300000, 2);  // 超过接收缓冲区，负载直接读入消息缓冲区
+    long tags = 2;
+    for (uint32_t i = 0; i < 100; ++i, ++tags) {
+        append_flv_tag(flv, 8, i * 23, 700, (uint8_t) i);
+        if (i % 10 == 0) {
+            append_flv_tag(flv, 9, i * 23 + 5, 2000 + i, (uint8_t) (i + 100));
+            tags++;
+        }
+    }
+    append_flv_tag(flv, 9, 0x1000000, 500, 3);  // 扩展时间戳
+    tags++;
+
+    IngestServer server;
+    server.set_chunk_size(65536);
+    server.set_play_source(flv);
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/play";
+    rtmp_play_t player = rtmp_play_open(url.c_str(), 1000);
+    CHECK(player != 0);
+    if (player == 0) return;
+    std::vector<uint8_t> out;
+    uint8_t buf[1000];
+    int n;
+    while ((n = rtmp_play_read(player, buf, sizeof(buf), 5000)) > 0) out.insert(out.end(), buf, buf + n);
+    CHECK(n == 0);
+    CHECK(out == flv);
+    CHECK(rtmp_play_read(player, buf, sizeof(buf), 0) == 0);
+
+    rtmp_play_stats stats;
+    CHECK(rtmp_get_play_stats(player, &stats) == 0);
+    CHECK(stats.tags == (uint64_t) tags);
+    CHECK(stats.flv_bytes == flv.size());
+    CHECK(stats.messages > stats.tags);  // 含 onStatus 与用户控制消息
+    CHECK(stats.zero_copy_messages > 0);
+    CHECK(stats.direct_bytes > 0);
+    CHECK(stats.bytes_in > stats.flv_bytes - 13 - 15 * (uint64_t) tags);
+    rtmp_play_close(player);
+    CHECK(rtmp_get_play_stats(player, &stats) != 0);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    for (const std::string &message : s.error_messages) fprintf(stderr, "  ingest 错误: %s\n", message.c_str());
+    CHECK(s.stream_name == "play");
+    CHECK(s.errors == 0);
+    CHECK(s.played_tags == tags);
+}
+
+#ifdef BB_RTMP_TLS
+/* rtmps:// 经 TLS 终结代理推流到 IngestServer；本机内核不支持 kTLS 时应回退到用户态 TLS */
+static void publish_rtmps(int flags, bool max_tls12) {
+    IngestServer server;
+    CHECK(server.start(0));
+    TlsTerminator terminator;
+    TlsTerminatorOptions options;
+    options.backend_port = server.port();
+    options.max_tls12 = max_tls12;
+    CHECK(terminator.start(0, options));
+    char cert_path[] = "/tmp/bb_rtmp_tls_XXXXXX";
+    int cert_fd = mkstemp(cert_path);
+    CHECK(cert_fd >= 0);
+    if (cert_fd < 0) return;
+    close(cert_fd);
+    CHECK(terminator.write_certificate(cert_path));
+    CHECK(rtmp_tls_configure(cert_path, flags) == 0);
+
+    std::string url = "rtmps://127.0.0.1:" + std::to_string(terminator.port()) + "/live/tls";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle != 0) {
+        rtmp_tls_info info;
+        CHECK(rtmp_get_tls_info(handle, &info) == 0);
+        CHECK(info.mode == RTMP_TLS_MODE_KERNEL || info.mode == RTMP_TLS_MODE_USERSPACE);
+        if (flags & RTMP_TLS_NO_KTLS) CHECK(info.mode == RTMP_TLS_MODE_USERSPACE && !info.ktls_send);
+        CHECK(strcmp(info.version, max_tls12 ? "TLSv1.2" : "TLSv1.3") == 0);
+        CHECK(info.cipher[0] != '\0');
+
+        CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+        const int kVideoFrames = 45;
+        for (int i = 0; i < kVideoFrames; ++i) {
+            std::vector<uint8_t> frame = make_frame(i % 15 == 0, latency_probe_now_us());
+            CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, i % 15 == 0) == 0);
+        }
+        CHECK(rtmp_get_tls_info(handle, &info) == 0);
+        if (info.mode == RTMP_TLS_MODE_USERSPACE) CHECK(info.relay_bytes_out > 0 && info.relay_bytes_in > 0);
+        rtmp_close(handle);
+        CHECK(server.wait_closed(1, 5000));
+        std::vector<IngestStreamStats> streams = server.streams();
+        CHECK(streams.size() == 1);
+        if (!streams.empty()) {
+            CHECK(streams[0].stream_name == "tls");
+            CHECK(streams[0].avc_config_valid);
+            CHECK(streams[0].video_frames == kVideoFrames);
+            CHECK(streams[0].video_keyframes == 3);
+            CHECK(streams[0].errors == 0);
+        }
+    }
+    terminator.stop();
+    server.stop();
+    CHECK(terminator.handshake_failures() == 0);
+    unlink(cert_path);
+}
+
+static void test_publish_rtmps() {
+    publish_rtmps(0, false);
+    publish_rtmps(RTMP_TLS_NO_KTLS, false);
+    publish_rtmps(RTMP_TLS_FULL_OFFLOAD, true);
+    CHECK(rtmp_tls_configure(nullptr, 0) == 0);
+}
+
+/* 证书不受信任时握手失败，rtmp_init 返回 0 */
+static void test_rtmps_rejects_untrusted() {
+    TlsTerminator terminator;
+    TlsTerminatorOptions options;
+    CHECK(terminator.start(0, options));
+    CHECK(rtmp_tls_configure(nullptr, 0) == 0);
+    std::string url = "rtmps://127.0.0.1:" + std::to_string(terminator.port()) + "/live/untrusted";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle == 0);
+    if (handle != 0) rtmp_close(handle);
+    terminator.stop();
+    CHECK(terminator.handshake_failures() == 1);
+}
+#endif
+
+/* 补发失败的记录留在缓存中：先向无效句柄排空（失败），积压帧数不变，重连后全部按序补发 */
+static void test_spool_drain_retry() {
+    char spool_path[] = "/tmp/bb_rtmp_spool_XXXXXX";
+    int spool_fd = mkstemp(spool_path);
+    CHECK(spool_fd >= 0);
+    if (spool_fd < 0) return;
+    close(spool_fd);
+    rtmp_spool_t spool = rtmp_spool_open(spool_path, 4 * 1024 * 1024);
+    CHECK(spool != 0);
+    if (spool == 0) {
+        unlink(spool_path);
+        return;
+    }
+    CHECK(rtmp_spool_begin(spool) == 0);
+    const int kVideoFrames = 10;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        std::vector<uint8_t> frame = make_frame(i == 0, latency_probe_now_us());
+        CHECK(rtmp_spool_video(spool, frame.data(), (int) frame.size(), i * 33, i == 0) == 0);
+    }
+    rtmp_spool_stats spool_stats;
+    CHECK(rtmp_spool_drain(spool, 999999, RTMP_SPOOL_MODE_DRAIN, 0) != 0);
+    CHECK(rtmp_spool_get_stats(spool, &spool_stats) == 0);
+    CHECK(spool_stats.backlog_frames == kVideoFrames);
+    CHECK(spool_stats.drained_bytes == 0);
+
+    IngestServer server;
+    CHECK(server.start(0));
+    if (server.port() != 0) {
+        std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/spool";
+        rtmp_handle_t handle = rtmp_init(url.c_str());
+        CHECK(handle != 0);
+        if (handle != 0) {
+            CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+            CHECK(rtmp_spool_drain(spool, handle, RTMP_SPOOL_MODE_DRAIN, 0) == 0);
+            CHECK(rtmp_spool_get_stats(spool, &spool_stats) == 0);
+            CHECK(spool_stats.backlog_frames == 0);
+            rtmp_close(handle);
+            CHECK(server.wait_closed(1, 5000));
+            std::vector<IngestStreamStats> streams = server.streams();
+            CHECK(streams.size() == 1);
+            if (!streams.empty()) {
+                CHECK(streams[0].errors == 0);
+                CHECK(streams[0].video_frames == kVideoFrames);
+            }
+        }
+        server.stop();
+    }
+    rtmp_spool_close(spool);
+    unlink(spool_path);
+}
+
+/* 服务端通告很小的 Window Acknowledgement Size 并频繁 ping：推流端应答 ping，并按窗口一半发送 Acknowledgement */
+static void test_publish_window_ack() {
+    IngestServer server;
+    server.set_window_ack_size(256);
+    server.set_ping_every_tags(1);
+    CHECK(server.start(0));
+    if (server.port() == 0) return;
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(server.port()) + "/live/ack";
+    rtmp_handle_t handle = rtmp_init(url.c_str());
+    CHECK(handle != 0);
+    if (handle == 0) return;
+    CHECK(rtmp_set_metadata(handle, 640, 360, 800000, 30, 44100, 2) == 0);
+    const int kVideoFrames = 40;
+    for (int i = 0; i < kVideoFrames; ++i) {
+        std::vector<uint8_t> frame = make_frame(i % 30 == 0, latency_probe_now_us());
+        CHECK(rtmp_send_video(handle, frame.data(), (int) frame.size(), i * 33, i % 30 == 0) == 0);
+        // 服务端消息每 100 ms 最多读取一次
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    }
+    rtmp_close(handle);
+
+    CHECK(server.wait_closed(1, 5000));
+    std::vector<IngestStreamStats> streams = server.streams();
+    server.stop();
+    CHECK(streams.size() == 1);
+    if (streams.empty()) return;
+    const IngestStreamStats &s = streams[0];
+    CHECK(s.errors == 0);
+    CHECK(s.video_frames == kVideoFrames);
+    CHECK(s.ping_replies > 0);
+    // 每个 ping 约 18 字节，40 个 ping 越过 128 字节的确认间隔多次
+    CHECK(s.acks_received >= 2);
+    CHECK(s.last_ack_bytes >= 256);
+}
+
+int main() {
+    struct {
+        const char *name;
+        void (*fn)();
+    } tests[] = {
+            {"publish_roundtrip", test_publish_roundtrip},
+            {"spool_drain_retry", test_spool_drain_retry},
+            {"publish_hevc", test_publish_hevc},
+            {"publish_opus", test_publish_opus},
+            {"publish_async_buffers", test_publish_async_buffers},
+            {"publish_frame_ring", test_publish_frame_ring},
+            {"publish_heartbeat", test_publish_heartbeat},
+            {"resolution_switch", test_resolution_switch},
+            {"rejects_timestamp_regression", test_rejects_timestamp_regression},
+            {"publish_uring", test_publish_uring},
+            {"publish_zerocopy", test_publish_zerocopy},
+            {"publish_send_deadline", test_publish_send_deadline},
+            {"publish_rtmpt_batched", test_publish_rtmpt_batched},
+            {"publish_fast_open", test_publish_fast_open},
+            {"publish_window_ack", test_publish_window_ack},
+            {"engine_publish", test_engine_publish},
+            {"engine_reconnect", test_engine_reconnect},
+            {"play", test_play},
+#ifdef BB_RTMP_TLS
+            {"publish_rtmps", test_publish_rtmps},
+            {"rtmps_rejects_untrusted", test_rtmps_rejects_untrusted},
+#endif
+    };
+    for (auto &test : tests) {
+        int before = g_failures;
+        test.fn();
+        printf("[%s] %s\n", g_failures == before ? " OK " : "FAIL", test.name);
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1731 @@
+/*
+ * native 核心单元测试（主机构建，ctest 运行）
+ */
+#include "async_sender.h"
+#include "av_clock.h"
+#include "bitstream.h"
+#include "filler_frames.h"
+#include "flv_mux.h"
+#include "flv_recorder.h"
+#include "flv_spool.h"
+#include "bb_log.h"
+#include "frame_ring.h"
+#include "frame_trace.h"
+#include "h264_params.h"
+#include "partial_writer.h"
+#include "rtmp_chunk.h"
+#include "rtmp_receiver.h"
+#include "send_stats.h"
+#include "zerocopy_sender.h"
+#include "librtmp/amf.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <netinet/in.h>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond); \
+            g_failures++; \
+        } \
+    } while (0)
+
+static std::string make_temp_dir() {
+    char tmpl[] = "/tmp/bb_rtmp_test_XXXXXX";
+    char *dir = mkdtemp(tmpl);
+    return dir != nullptr ? std::string(dir) : std::string("/tmp");
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &out) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(fp);
+    return true;
+}
+
+static uint32_t read_be(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+static double metadata_number(const uint8_t *body, int size, const char *name) {
+    AMFObject obj;
+    if (AMF_Decode(&obj, reinterpret_cast<const char *>(body), size, FALSE) < 0) return -1;
+    double value = -1;
+    // AMFProp_GetObject 只接受 AMF_OBJECT，ECMA Array 直接取 p_object
+    AMFObjectProperty *array = AMF_GetProp(&obj, nullptr, 2);
+    if (array->p_type == AMF_ECMA_ARRAY) {
+        AVal key = {const_cast<char *>(name), (int) strlen(name)};
+        AMFObjectProperty *prop = AMF_GetProp(&array->p_vu.p_object, &key, -1);
+        if (prop->p_type == AMF_NUMBER) value = AMFProp_GetNumber(prop);
+    }
+    AMF_Reset(&obj);
+    return value;
+}
+
+static FlvTagRef make_tag(uint8_t type, uint32_t timestamp, const std::vector<uint8_t> &body) {
+    RTMPPacket packet;
+    RTMPPacket_Alloc(&packet, (uint32_t) body.size());
+    RTMPPacket_Reset(&packet);
+    memcpy(packet.m_body, body.data(), body.size());
+    packet.m_nBodySize = (uint32_t) body.size();
+    packet.m_packetType = type;
+    packet.m_nTimeStamp = timestamp;
+    FlvTagRef tag = std::make_shared<FlvTag>(&packet);
+    RTMPPacket_Free(&packet);
+    return tag;
+}
+
+static FlvTagRef make_metadata_tag() {
+    char body[1024];
+    int size = build_on_metadata_body(body, sizeof(body), 1280, 720, 2000000, 30, 44100, 2);
+    return make_tag(RTMP_PACKET_TYPE_INFO, 0, std::vector<uint8_t>(body, body + size));
+}
+
+static FlvTagRef make_video_tag(uint32_t timestamp, bool key, size_t size = 64) {
+    std::vector<uint8_t> body(size, 0x5A);
+    body[0] = key ? 0x17 : 0x27;
+    body[1] = 0x01;
+    return make_tag(RTMP_PACKET_TYPE_VIDEO, timestamp, body);
+}
+
+static FlvTagRef make_audio_tag(uint32_t timestamp) {
+    std::vector<uint8_t> body(32, 0x21);
+    body[0] = 0xAF;
+    body[1] = 0x01;
+    return make_tag(RTMP_PACKET_TYPE_AUDIO, timestamp, body);
+}
+
+struct ParsedTag {
+    uint8_t type;
+    uint32_t timestamp;
+    std::vector<uint8_t> body;
+};
+
+static bool parse_flv(const std::string &path, uint8_t &flags, std::vector<ParsedTag> &tags) {
+    std::vector<uint8_t> file;
+    if (!read_file(path, file) || file.size() < 13 || memcmp(file.data(), "FLV", 3) != 0) return false;
+    flags = file[4];
+    size_t pos = 13;
+    while (pos + 11 <= file.size()) {
+        const uint8_t *tag = file.data() + pos;
+        uint32_t size = read_be(tag + 1, 3);
+        if (pos + 11 + size + 4 > file.size()) return false;
+        if (read_be(tag + 11 + size, 4) != 11 + size) return false;
+        ParsedTag parsed;
+        parsed.type = tag[0];
+        parsed.timestamp = read_be(tag + 4, 3) | ((uint32_t) tag[7] << 24);
+        parsed.body.assign(tag + 11, tag + 11 + size);
+        tags.push_back(parsed);
+        pos += 11 + size + 4;
+    }
+    return pos == file.size();
+}
+
+static void test_annexb_to_avc_body() {
+    const uint8_t frame[] = {
+            0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F,  // SPS（跳过）
+            0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C,              // PPS（跳过，3 字节起始码）
+            0x00, 0x00, 0x00, 0x01, 0x06, 0x05, 0x01,        // SEI
+            0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x21, 0xA0,  // IDR
+    };
+    std::vector<uint8_t> body;
+    int count = annexb_to_avc_body(frame, sizeof(frame), true, body);
+    CHECK(count == 2);
+    const uint8_t expected[] = {
+            0x17, 0x01, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x03, 0x06, 0x05, 0x01,
+            0x00, 0x00, 0x00, 0x05, 0x65, 0x88, 0x84, 0x21, 0xA0,
+    };
+    CHECK(body.size() == sizeof(expected));
+    CHECK(body.size() == sizeof(expected) && memcmp(body.data(), expected, sizeof(expected)) == 0);
+
+    const uint8_t p_frame[] = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x02};
+    count = annexb_to_avc_body(p_frame, sizeof(p_frame), false, body);
+    CHECK(count == 1);
+    CHECK(body.size() == 5 + 4 + 3 && body[0] == 0x27);
+}
+
+static void test_parse_sps_pps() {
+    const uint8_t frame[] = {
+            0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F,
+            0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C,
+            0x00, 0x00, 0x00, 0x01, 0x65, 0x88,
+    };
+    std::vector<uint8_t> sps, pps;
+    parse_sps_pps(frame, sizeof(frame), sps, pps);
+    CHECK(sps.size() == 4 && sps[0] == 0x67 && sps[3] == 0x1F);
+    CHECK(pps.size() == 3 && pps[0] == 0x68 && pps[2] == 0x3C);
+}
+
+static const uint8_t kHevcVps[] = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+                                   0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0x95, 0x98, 0x09};
+// Main profile，level 4，1920x1080，4:2:0，8 bit（带防竞争字节）
+static const uint8_t kHevcSps[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+                                   0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xA0, 0x03, 0xC0, 0x80, 0x10, 0xE5,
+                                   0x96, 0x56, 0x69, 0x24, 0xCA, 0xE0, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10,
+                                   0x00, 0x00, 0x03, 0x01, 0xE0, 0x80};
+static const uint8_t kHevcPps[] = {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40};
+
+static std::vector<uint8_t> hevc_annexb(bool with_parameter_sets, const std::vector<uint8_t> &slice) {
+    std::vector<uint8_t> out;
+    const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    if (with_parameter_sets) {
+        out.insert(out.end(), start_code, start_code + 4);
+        out.insert(out.end(), kHevcVps, kHevcVps + sizeof(kHevcVps));
+        out.insert(out.end(), start_code + 1, start_code + 4);  // 3 字节起始码
+        out.insert(out.end(), kHevcSps, kHevcSps + sizeof(kHevcSps));
+        out.insert(out.end(), start_code, start_code + 4);
+        out.insert(out.end(), kHevcPps, kHevcPps + sizeof(kHevcPps));
+    }
+    out.insert(out.end(), start_code, start_code + 4);
+    out.insert(out.end(), slice.begin(), slice.end());
+    return out;
+}
+
+static void test_hevc_parameter_sets_and_frames() {
+    std::vector<uint8_t> idr = hevc_annexb(true, {0x26, 0x01, 0xAF, 0x1D, 0x80});
+    std::vector<uint8_t> vps, sps, pps;
+    parse_parameter_sets(idr.data(), (int) idr.size(), RTMP_VIDEO_CODEC_HEVC, vps, sps, pps);
+    CHECK(vps.size() == sizeof(kHevcVps) && memcmp(vps.data(), kHevcVps, sizeof(kHevcVps)) == 0);
+    CHECK(sps.size() == sizeof(kHevcSps) && memcmp(sps.data(), kHevcSps, sizeof(kHevcSps)) == 0);
+    CHECK(pps.size() == sizeof(kHevcPps) && memcmp(pps.data(), kHevcPps, sizeof(kHevcPps)) == 0);
+
+    // 按 H.264 解析 HEVC 码流不应把 HEVC 参数集误认为 SPS/PPS
+    std::vector<uint8_t> avc_sps, avc_pps;
+    parse_sps_pps(idr.data(), (int) idr.size(), avc_sps, avc_pps);
+    CHECK(avc_pps.empty());
+
+    std::vector<uint8_t> body;
+    CHECK(annexb_to_video_body(idr.data(), (int) idr.size(), true, RTMP_VIDEO_CODEC_HEVC, body) == 1);
+    const uint8_t expected[] = {0x93, 'h', 'v', 'c', '1', 0x00, 0x00, 0x00, 0x05, 0x26, 0x01, 0xAF, 0x1D, 0x80};
+    CHECK(body.size() == sizeof(expected) && memcmp(body.data(), expected, sizeof(expected)) == 0);
+
+    std::vector<uint8_t> p_frame = hevc_annexb(false, {0x02, 0x01, 0xD0});
+    CHECK(annexb_to_video_body(p_frame.data(), (int) p_frame.size(), false, RTMP_VIDEO_CODEC_HEVC, body) == 1);
+    CHECK(body.size() == 5 + 4 + 3 && body[0] == 0xA3 && read_be(body.data() + 1, 4) == FLV_FOURCC_HVC1);
+}
+
+static void test_video_sequence_header() {
+    std::vector<uint8_t> vps(kHevcVps, kHevcVps + sizeof(kHevcVps));
+    std::vector<uint8_t> sps(kHevcSps, kHevcSps + sizeof(kHevcSps));
+    std::vector<uint8_t> pps(kHevcPps, kHevcPps + sizeof(kHevcPps));
+    std::vector<uint8_t> body;
+    int size = build_video_sequence_header(RTMP_VIDEO_CODEC_HEVC, vps, sps, pps, body);
+    CHECK(size == (int) body.size());
+    CHECK(size == 5 + 23 + 3 * 5 + (int) (vps.size() + sps.size() + pps.size()));
+    if (size < 5 + 23) return;
+    CHECK(body[0] == 0x90 && read_be(body.data() + 1, 4) == FLV_FOURCC_HVC1);
+    const uint8_t *record = body.data() + 5;
+    CHECK(record[0] == 0x01);
+    // general_profile_idc=1（Main）、兼容标志、约束标志与 level 取自去掉防竞争字节后的 SPS
+    const uint8_t profile_tier_level[] = {0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78};
+    CHECK(memcmp(record + 1, profile_tier_level, sizeof(profile_tier_level)) == 0);
+    CHECK(record[13] == 0xF0 && record[14] == 0x00 && record[15] == 0xFC);
+    CHECK(record[16] == 0xFD);                         // chroma_format_idc=1
+    CHECK(record[17] == 0xF8 && record[18] == 0xF8);   // 8 bit
+    CHECK(record[21] == ((1 << 3) | (1 << 2) | 0x03)); // 1 个时域层、temporalIdNested、4 字节长度
+    CHECK(record[22] == 3);
+    const uint8_t *array = record + 23;
+    CHECK(array[0] == (0x80 | 32) && read_be(array + 1, 2) == 1 && read_be(array + 3, 2) == vps.size());
+
+    std::vector<uint8_t> empty;
+    CHECK(build_video_sequence_header(RTMP_VIDEO_CODEC_HEVC, empty, sps, pps, body) < 0);
+    std::vector<uint8_t> truncated(sps.begin(), sps.begin() + 20);
+    CHECK(build_video_sequence_header(RTMP_VIDEO_CODEC_HEVC, vps, truncated, pps, body) < 0);
+
+    std::vector<uint8_t> avc_sps = {0x67, 0x42, 0x00, 0x1F};
+    std::vector<uint8_t> avc_pps = {0x68, 0xCE, 0x3C};
+    size = build_video_sequence_header(RTMP_VIDEO_CODEC_H264, empty, avc_sps, avc_pps, body);
+    const uint8_t avc_expected[] = {0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x42, 0x00, 0x1F, 0xFF, 0xE1, 0x00, 0x04,
+                                    0x67, 0x42, 0x00, 0x1F, 0x01, 0x00, 0x03, 0x68, 0xCE, 0x3C};
+    CHECK(size == (int) sizeof(avc_expected) && memcmp(body.data(), avc_expected, sizeof(avc_expected)) == 0);
+}
+
+static void test_audio_tags() {
+    uint8_t body[64];
+    // AAC-LC 44.1kHz 双声道：与改为按编码构建之前的字节一致
+    CHECK(build_audio_sequence_header(RTMP_AUDIO_CODEC_AAC, 44100, 2, body, sizeof(body)) == 4);
+    const uint8_t aac_config[] = {0xAF, 0x00, 0x12, 0x10};
+    CHECK(memcmp(body, aac_config, sizeof(aac_config)) == 0);
+    uint8_t header[FLV_AUDIO_HEADER_MAX];
+    CHECK(build_audio_frame_header(RTMP_AUDIO_CODEC_AAC, 44100, 1, header) == 2);
+    CHECK(header[0] == 0xAE && header[1] == 0x01);
+
+    int size = build_audio_sequence_header(RTMP_AUDIO_CODEC_OPUS, 48000, 2, body, sizeof(body));
+    CHECK(size == 5 + 19);
+    const uint8_t opus_config[] = {0x90, 'O', 'p', 'u', 's', 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd',
+                                   0x01, 0x02, 0x38, 0x01, 0x80, 0xBB, 0x00, 0x00, 0x00, 0x00, 0x00};
+    CHECK(size == (int) sizeof(opus_config) && memcmp(body, opus_config, sizeof(opus_config)) == 0);
+    CHECK(build_audio_sequence_header(RTMP_AUDIO_CODEC_OPUS, 48000, 2, body, 8) < 0);
+    CHECK(build_audio_frame_header(RTMP_AUDIO_CODEC_OPUS, 48000, 1, header) == 5);
+    CHECK(header[0] == 0x91 && read_be(header + 1, 4) == FLV_FOURCC_OPUS);
+}
+
+/* 零拷贝发送队列：每个入队的令牌恰好释放一次；队列满时关键帧清空积压、非关键帧被拒绝；停止时归还未发送的缓冲区 */
+static void test_async_video_sender() {
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool gate_open = false;
+    long in_send = 0;
+    std::map<long, std::vector<int>> released;
+
+    AsyncVideoSender sender(
+            2,
+            [&](const AsyncVideoSender::Job &job) {
+                std::unique_lock<std::mutex> lock(mutex);
+                in_send = job.token;
+                cond.notify_all();
+                cond.wait(lock, [&] { return gate_open; });
+                return job.data[0] == 0xEE ? -1 : 0;
+            },
+            [&](long token, int result) {
+                std::lock_guard<std::mutex> lock(mutex);
+                released[token].push_back(result);
+                cond.notify_all();
+            });
+    uint8_t frame[4] = {0x00, 0x00, 0x01, 0x65};
+    uint8_t bad[4] = {0xEE, 0x00, 0x01, 0x65};
+    auto job = [&](long token, bool key, const uint8_t *data) {
+        AsyncVideoSender::Job j = {data, 4, token * 33, key, token, 0};
+        return j;
+    };
+    auto wait_for = [&](std::function<bool()> pred) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, std::chrono::seconds(5), pred);
+    };
+
+    int evicted = -1;
+    CHECK(sender.submit(job(1, true, frame), &evicted) == AsyncVideoSender::SUBMIT_STOPPED);
+    sender.start();
+    CHECK(sender.submit(job(1, true, frame), &evicted) == AsyncVideoSender::SUBMIT_QUEUED);
+    CHECK(evicted == 0);
+    CHECK(wait_for([&] { return in_send == 1; }));  // 发送线程阻塞在令牌 1 上
+
+    CHECK(sender.submit(job(2, false, frame), nullptr) == AsyncVideoSender::SUBMIT_QUEUED);
+    CHECK(sender.submit(job(3, false, frame), nullptr) == AsyncVideoSender::SUBMIT_QUEUED);
+    CHECK(sender.submit(job(4, false, frame), nullptr) == AsyncVideoSender::SUBMIT_QUEUE_FULL);
+    CHECK(sender.submit(job(5, true, bad), &evicted) == AsyncVideoSender::SUBMIT_QUEUED);
+    CHECK(evicted == 2);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(released.size() == 2);
+        CHECK(released[2] == std::vector<int>{RTMP_ASYNC_DROPPED});
+        CHECK(released[3] == std::vector<int>{RTMP_ASYNC_DROPPED});
+        CHECK(released.count(4) == 0);  // 被拒绝的缓冲区仍归调用方，不回调
+        gate_open = true;
+    }
+    cond.notify_all();
+    CHECK(wait_for([&] { return released.count(1) && released.count(5); }));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(released[1] == std::vector<int>{0});
+        CHECK(released[5] == std::vector<int>{-1});  // 发送失败的结果原样传回
+        gate_open = false;
+    }
+
+    // 停止：正在发送的帧发完后释放，排队中的以 RTMP_ASYNC_DROPPED 归还
+    CHECK(sender.submit(job(6, true, frame), nullptr) == AsyncVideoSender::SUBMIT_QUEUED);
+    CHECK(wait_for([&] { return in_send == 6; }));
+    CHECK(sender.submit(job(7, false, frame), nullptr) == AsyncVideoSender::SUBMIT_QUEUED);
+    std::thread opener([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::lock_guard<std::mutex> lock(mutex);
+        gate_open = true;
+        cond.notify_all();
+    });
+    sender.stop();
+    opener.join();
+    CHECK(sender.submit(job(8, true, frame), nullptr) == AsyncVideoSender::SUBMIT_STOPPED);
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(released[6] == std::vector<int>{0});
+    CHECK(released[7] == std::vector<int>{RTMP_ASYNC_DROPPED});
+    CHECK(released.size() == 6);  // 令牌 4 被拒绝、8 在停止后提交，均不回调
+}
+
+static bool ring_push(FrameRing &ring, const std::vector<uint8_t> &frame, int64_t ts, bool key, int *flushed) {
+    long offset = ring.reserve((uint32_t) frame.size(), key);
+    if (offset < 0) return false;
+    memcpy(ring.data() + offset, frame.data(), frame.size());
+    int n = ring.commit(ts);
+    if (flushed != nullptr) *flushed = n;
+    return true;
+}
+
+/* 采集时钟比音频采样时钟快 0.1%：视频逐步校正到采样时间线，两条轨道都严格递增 */
+static void test_av_clock() {
+    AvClock clock(44100);
+    const int64_t base_us = 5000000000LL;
+    auto capture = [&](int64_t true_us) { return base_us + true_us + true_us / 1000; };
+
+    CHECK(clock.audio(capture(0), 1024) == 0);
+    int64_t last_audio = 0, last_video = -1;
+    int video_frames = 0;
+    for (int k = 1; k < 44100 * 60 / 1024; ++k) {
+        int64_t true_us = (int64_t) k * 1024 * 1000000 / 44100;
+        int64_t jitter_us = (k * 7919) % 3000;  // 读取 PCM 的调度抖动
+        int64_t ts = clock.audio(capture(true_us) + jitter_us, 1024);
+        CHECK(ts > last_audio);
+        CHECK(ts == true_us / 1000);  // 由采样数推算，与抖动无关
+        last_audio = ts;
+        while ((int64_t) video_frames * 33333 <= true_us) {
+            int64_t video = clock.video(capture((int64_t) video_frames * 33333));
+            CHECK(video > last_video);
+            last_video = video;
+            video_frames++;
+        }
+    }
+    rtmp_clock_stats stats;
+    clock.snapshot(&stats);
+    CHECK(stats.drift_us > 58000 && stats.drift_us < 63500);  // 0.1% × 60s，加上平均 1.5ms 的抖动
+    CHECK(stats.correction_us == stats.drift_us || stats.correction_us > stats.drift_us - 3000);
+    CHECK(stats.audio_resyncs == 0 && stats.audio_clamped == 0 && stats.video_clamped == 0);
+    CHECK(stats.audio_samples == (uint64_t) (44100 * 60 / 1024) * 1024);
+    // 与音频同一时刻采集的视频帧映射到同一时间戳附近
+    int64_t true_us = (int64_t) (44100 * 60 / 1024) * 1024 * 1000000 / 44100;
+    int64_t audio = clock.audio(capture(true_us), 1024);
+    int64_t video = clock.video(capture(true_us));
+    CHECK(video - audio >= -4 && video - audio <= 4);
+
+    // 采集时间回退时仍严格递增
+    int64_t before = clock.video(capture(true_us + 40000));
+    CHECK(clock.video(capture(true_us + 10000)) == before + 1);
+    clock.snapshot(&stats);
+    CHECK(stats.video_clamped == 1);
+
+    // 音频中断 2 秒：重新锚定采样时间线，时间戳随采集时间跳过中断
+    int64_t resumed = clock.audio(capture(true_us + 2000000), 1024);
+    clock.snapshot(&stats);
+    CHECK(stats.audio_resyncs == 1);
+    CHECK(resumed - audio >= 1990 && resumed - audio <= 2010);
+    CHECK(stats.last_audio_ms == resumed);
+
+    // 句柄接口
+    rtmp_clock_t handle = rtmp_clock_create(48000);
+    CHECK(handle != 0);
+    CHECK(rtmp_clock_video(handle, 1000000) == 0);  // 第一帧为零点
+    CHECK(rtmp_clock_audio(handle, 1020000, 960) == 20);
+    CHECK(rtmp_clock_audio(handle, 1040000, 960) == 40);
+    CHECK(rtmp_clock_get_stats(handle, &stats) == 0 && stats.audio_samples == 1920);
+    rtmp_clock_destroy(handle);
+    CHECK(rtmp_clock_video(handle, 1100000) < 0);
+    CHECK(rtmp_clock_create(0) == 0);
+}
+
+static void test_frame_ring() {
+    FrameRing ring(256, 3);
+    CHECK(ring.valid());
+    CHECK(ring.capacity() == 256);
+    FrameRing::Frame frame;
+    CHECK(!ring.peek(&frame));
+    CHECK(!ring.wait(0));
+
+    // 每帧记录占 16 字节头 + 数据（对齐到 16）：50 字节 -> 80 字节记录
+    std::vector<uint8_t> a(50, 0xA1), b(50, 0xB2), c(50, 0xC3);
+    int flushed = -1;
+    CHECK(ring_push(ring, a, 1, true, &flushed));
+    CHECK(flushed == 0);
+    CHECK(ring_push(ring, b, 2, false, nullptr));
+    CHECK(ring_push(ring, c, 3, false, nullptr));
+    CHECK(!ring_push(ring, b, 4, false, nullptr));  // 排队帧数已满，非关键帧被拒绝
+
+    CHECK(ring.wait(0));
+    CHECK(ring.peek(&frame));
+    CHECK(frame.size == 50 && frame.timestamp == 1 && frame.is_key);
+    CHECK(memcmp(frame.data, a.data(), a.size()) == 0);
+    ring.pop();
+    CHECK(ring.peek(&frame) && frame.timestamp == 2 && !frame.is_key);
+    ring.pop();
+
+    // 尾部剩余 16 字节放不下下一条记录：写回绕标记后从头写入
+    std::vector<uint8_t> d(60, 0xD4);
+    CHECK(ring_push(ring, d, 5, false, nullptr));
+    CHECK(ring.peek(&frame) && frame.timestamp == 3);
+    CHECK(memcmp(frame.data, c.data(), c.size()) == 0);
+    ring.pop();
+    CHECK(ring.peek(&frame) && frame.timestamp == 5 && frame.size == 60);
+    CHECK(frame.data == ring.data() + 16);
+    CHECK(memcmp(frame.data, d.data(), d.size()) == 0);
+    ring.pop();
+    CHECK(!ring.peek(&frame));
+
+    // 超过容量的帧直接拒绝；flush 丢弃全部已发布的帧
+    CHECK(!ring_push(ring, std::vector<uint8_t>(300, 0), 11, true, nullptr));
+    CHECK(ring_push(ring, b, 12, false, nullptr));
+    ring.flush();
+    CHECK(ring.wait(0));
+    CHECK(!ring.peek(&frame));
+
+    rtmp_ring_stats stats;
+    ring.snapshot(&stats);
+    CHECK(stats.capacity_bytes == 256);
+    CHECK(stats.used_bytes == 0);
+    CHECK(stats.queued_frames == 0);
+    CHECK(stats.max_queued_frames == 3);
+    CHECK(stats.pushed_frames == 5);
+    CHECK(stats.dropped_frames == 2);
+    CHECK(stats.flushed_frames == 1);
+    CHECK(stats.max_used_bytes == 240);
+
+    // 排队帧数满时关键帧清空积压后入队，消费者读到的第一帧即为该关键帧
+    // （被清空的帧在消费者跳过之前仍占用字节空间，因此该场景需要容量足够）
+    FrameRing backlog(1024, 3);
+    CHECK(ring_push(backlog, b, 6, false, nullptr));
+    CHECK(ring_push(backlog, b, 7, false, nullptr));
+    CHECK(ring_push(backlog, b, 8, false, nullptr));
+    CHECK(ring_push(backlog, a, 9, true, &flushed));
+    CHECK(flushed == 3);
+    CHECK(ring_push(backlog, b, 10, false, nullptr));  // 积压已清空，排队帧数从关键帧重新计
+    CHECK(backlog.peek(&frame) && frame.timestamp == 9 && frame.is_key);
+    backlog.pop();
+    CHECK(backlog.peek(&frame) && frame.timestamp == 10);
+    backlog.pop();
+
+    backlog.snapshot(&stats);
+    CHECK(stats.flushed_frames == 3);
+    CHECK(stats.max_queued_frames == 3);
+
+    // 消费者阻塞在 eventfd 上，由生产者提交唤醒
+    std::thread producer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ring_push(ring, c, 13, false, nullptr);
+    });
+    auto begin = std::chrono::steady_clock::now();
+    CHECK(ring.wait(5000));
+    CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(4));
+    producer.join();
+    CHECK(ring.peek(&frame) && frame.timestamp == 13);
+    ring.pop();
+    ring.snapshot(&stats);
+    CHECK(stats.wakeups == 1);
+
+    // wakeup 让空帧环上的等待提前返回
+    std::thread waker([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ring.wakeup();
+    });
+    begin = std::chrono::steady_clock::now();
+    CHECK(!ring.wait(5000));
+    CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(4));
+    waker.join();
+}
+
+static std::vector<uint8_t> make_nal(uint8_t header, const BitWriter &rbsp) {
+    std::vector<uint8_t> nal(1, header);
+    rbsp_to_nal(rbsp.data().data(), rbsp.data().size(), nal);
+    return nal;
+}
+
+/* 320x240、单参考帧的 SPS：high 为 true 时使用 High profile（带色度格式等字段） */
+static std::vector<uint8_t> make_test_sps(bool high, int poc_type) {
+    BitWriter w;
+    w.bits(8, high ? 100 : 66);
+    w.bits(8, 0);
+    w.bits(8, 30);
+    w.ue(0);  // sps_id
+    if (high) {
+        w.ue(1);  // chroma_format_idc
+        w.ue(0);
+        w.ue(0);
+        w.bit(0);
+        w.bit(0);  // seq_scaling_matrix_present_flag
+    }
+    w.ue(0);  // log2_max_frame_num_minus4
+    w.ue((uint32_t) poc_type);
+    if (poc_type == 0) w.ue(2);  // log2_max_pic_order_cnt_lsb_minus4
+    w.ue(1);  // max_num_ref_frames
+    w.bit(0);
+    w.ue(19);
+    w.ue(14);
+    w.bit(1);  // frame_mbs_only_flag
+    w.bit(1);  // direct_8x8_inference_flag
+    w.bit(0);
+    w.bit(0);
+    w.trailing_bits();
+    return make_nal(0x67, w);
+}
+
+static std::vector<uint8_t> make_test_pps(bool cabac, int init_qp, bool weighted) {
+    BitWriter w;
+    w.ue(0);
+    w.ue(0);
+    w.bit(cabac ? 1 : 0);
+    w.bit(0);
+    w.ue(0);  // num_slice_groups_minus1
+    w.ue(2);  // num_ref_idx_l0_default_active_minus1
+    w.ue(0);
+    w.bit(weighted ? 1 : 0);
+    w.bits(2, 0);
+    w.se(init_qp - 26);
+    w.se(0);
+    w.se(0);
+    w.bit(1);  // deblocking_filter_control_present_flag
+    w.bit(0);
+    w.bit(0);
+    w.trailing_bits();
+    return make_nal(0x68, w);
+}
+
+/* Annex-B IDR：slice 头之后的数据不参与解析 */
+static std::vector<uint8_t> make_test_idr(int poc_lsb) {
+    BitWriter w;
+    w.ue(0);
+    w.ue(7);  // slice_type: I
+    w.ue(0);
+    w.bits(4, 0);  // frame_num
+    w.ue(0);  // idr_pic_id
+    w.bits(6, (uint32_t) poc_lsb);
+    w.bits(32, 0x12345678);
+    w.trailing_bits();
+    std::vector<uint8_t> frame = {0x00, 0x00, 0x00, 0x01};
+    std::vector<uint8_t> nal = make_nal(0x65, w);
+    frame.insert(frame.end(), nal.begin(), nal.end());
+    return frame;
+}
+
+/* 按 H.264 9.3.3.2 独立实现的 CABAC 解码引擎，用于校验编码器输出 */
+class TestCabacDecoder {
+public:
+    TestCabacDecoder(BitReader &reader, int qp) : reader_(reader) {
+        int pre = ((23 * (qp < 0 ? 0 : qp > 51 ? 51 : qp)) >> 4) + 33;
+        pre = pre < 1 ? 1 : pre > 126 ? 126 : pre;
+        state_ = pre <= 63 ? 63 - pre : pre - 64;
+        mps_ = pre <= 63 ? 0 : 1;
+        offset_ = reader_.bits(9);
+    }
+
+    int decision() {
+        static const uint8_t kLps[64][4] = {
+                {128, 176, 208, 240}, {128, 167, 197, 227}, {128, 158, 187, 216}, {123, 150, 178, 205},
+                {116, 142, 169, 195}, {111, 135, 160, 185}, {105, 128, 152, 175}, {100, 122, 144, 166},
+                {95, 116, 137, 158}, {90, 110, 130, 150}, {85, 104, 123, 142}, {81, 99, 117, 135},
+                {77, 94, 111, 128}, {73, 89, 105, 122}, {69, 85, 100, 116}, {66, 80, 95, 110},
+                {62, 76, 90, 104}, {59, 72, 86, 99}, {56, 69, 81, 94}, {53, 65, 77, 89},
+                {51, 62, 73, 85}, {48, 59, 69, 80}, {46, 56, 66, 76}, {43, 53, 63, 72},
+                {41, 50, 59, 69}, {39, 48, 56, 65}, {37, 45, 54, 62}, {35, 43, 51, 59},
+                {33, 41, 48, 56}, {32, 39, 46, 53}, {30, 37, 43, 50}, {29, 35, 41, 48},
+                {27, 33, 39, 45}, {26, 31, 37, 43}, {24, 30, 35, 41}, {23, 28, 33, 39},
+                {22, 27, 32, 37}, {21, 26, 30, 35}, {20, 24, 29, 33}, {19, 23, 27, 31},
+                {18, 22, 26, 30}, {17, 21, 25, 28}, {16, 20, 23, 27}, {15, 19, 22, 25},
+                {14, 18, 21, 24}, {14, 17, 20, 23}, {13, 16, 19, 22}, {12, 15, 18, 21},
+                {12, 14, 17, 20}, {11, 14, 16, 19}, {11, 13, 15, 18}, {10, 12, 15, 17},
+                {10, 12, 14, 16}, {9, 11, 13, 15}, {9, 11, 12, 14}, {8, 10, 12, 14},
+                {8, 9, 11, 13}, {7, 9, 11, 12}, {7, 9, 10, 12}, {7, 8, 10, 11},
+                {6, 8, 9, 11}, {6, 7, 9, 10}, {6, 7, 8, 9}, {2, 2, 2, 2},
+        };
+        static const uint8_t kTransLps[64] = {
+                0, 0, 1, 2, 2, 4, 4, 5, 6, 7, 8, 9, 9, 11, 11, 12,
+                13, 13, 15, 15, 16, 16, 18, 18, 19, 19, 21, 21, 22, 22, 23, 24,
+                24, 25, 26, 26, 27, 27, 28, 29, 29, 30, 30, 30, 31, 32, 32, 33,
+                33, 33, 34, 34, 35, 35, 35, 36, 36, 36, 37, 37, 37, 38, 38, 63,
+        };
+        uint32_t lps = kLps[state_][(range_ >> 6) & 3];
+        range_ -= lps;
+        int bin;
+        if (offset_ >= range_) {
+            bin = 1 - mps_;
+            offset_ -= range_;
+            range_ = lps;
+            if (state_ == 0) mps_ = 1 - mps_;
+            state_ = kTransLps[state_];
+        } else {
+            bin = mps_;
+            if (state_ < 62) ++state_;
+        }
+        renorm();
+        return bin;
+    }
+
+    int terminate() {
+        range_ -= 2;
+        if (offset_ >= range_) return 1;
+        renorm();
+        return 0;
+    }
+
+private:
+    void renorm() {
+        while (range_ < 256) {
+            range_ <<= 1;
+            offset_ = (offset_ << 1) | reader_.bits(1);
+        }
+    }
+
+    BitReader &reader_;
+    uint32_t range_ = 510;
+    uint32_t offset_ = 0;
+    int state_ = 0;
+    int mps_ = 0;
+};
+
+/* 解析生成的 P_Skip 帧并逐个宏块解码，返回跳过宏块数（出错返回 -1） */
+static int decode_skip_frame(const std::vector<uint8_t> &frame, const H264Sps &sps, const H264Pps &pps,
+                             int expect_frame_num, int expect_poc_lsb) {
+    if (frame.size() < 6 || memcmp(frame.data(), "\x00\x00\x00\x01", 4) != 0) return -1;
+    if ((frame[4] & 0x1F) != 1 || (frame[4] & 0x60) == 0) return -1;  // 非 IDR 参考 slice
+    H264SliceHeader header;
+    if (!h264_parse_slice_header(frame.data() + 4, frame.size() - 4, sps, header)) return -1;
+    if (header.slice_type != 5 || header.frame_num != expect_frame_num ||
+        header.pic_order_cnt_lsb != expect_poc_lsb) {
+        return -1;
+    }
+
+    std::vector<uint8_t> rbsp;
+    nal_to_rbsp(frame.data() + 5, frame.size() - 5, rbsp);
+    BitReader r(rbsp.data(), rbsp.size());
+    r.ue();
+    r.ue();
+    r.ue();
+    r.bits(sps.log2_max_frame_num);
+    if (sps.pic_order_cnt_type == 0) r.bits(sps.log2_max_pic_order_cnt_lsb);
+    if (r.bits(1) != 1 || r.ue() != 0) return -1;  // 单参考帧
+    if (r.bits(1) != 0) return -1;  // ref_pic_list_modification_flag_l0
+    if (pps.weighted_pred && (r.ue() != 0 || r.ue() != 0 || r.bits(1) != 0 || r.bits(1) != 0)) return -1;
+    if (r.bits(1) != 0) return -1;  // adaptive_ref_pic_marking_mode_flag
+    if (pps.entropy_coding_mode && r.ue() != 0) return -1;  // cabac_init_idc
+    if (r.se() != 0 || r.ue() != 1) return -1;  // slice_qp_delta / disable_deblocking_filter_idc
+
+    int mbs = sps.pic_size_in_mbs();
+    size_t payload_bits = rbsp.size() * 8;  // 到 rbsp_stop_one_bit（含）为止
+    while (payload_bits > 0 && ((rbsp[(payload_bits - 1) >> 3] >> (7 - ((payload_bits - 1) & 7))) & 1) == 0) {
+        --payload_bits;
+    }
+    if (!pps.entropy_coding_mode) {
+        int run = (int) r.ue();
+        // mb_skip_run 之后紧接 rbsp_stop_one_bit
+        return r.ok() && r.bits(1) == 1 && (r.byte_offset() == rbsp.size() || r.bits(8) == 0) ? run : -1;
+    }
+    while (r.bit_offset() % 8 != 0) {
+        if (r.bits(1) != 1) return -1;  // cabac_alignment_one_bit
+    }
+    TestCabacDecoder cabac(r, pps.pic_init_qp);
+    for (int i = 0; i < mbs; ++i) {
+        if (cabac.decision() != 1) return -1;  // mb_skip_flag
+        if (cabac.terminate() != (i == mbs - 1 ? 1 : 0)) return -1;  // end_of_slice_flag
+    }
+    // 解码引擎已读到的位不能超出 rbsp_stop_one_bit
+    return r.ok() && r.bit_offset() <= payload_bits ? mbs : -1;
+}
+
+/* SPS 裁剪后的宽高与 VUI 帧率；VUI 截断时仍返回前面的字段 */
+static void test_h264_sps_fields() {
+    for (int truncated = 0; truncated < 2; ++truncated) {
+        BitWriter w;
+        w.bits(8, 100);
+        w.bits(8, 0);
+        w.bits(8, 40);
+        w.ue(0);
+        w.ue(1);  // chroma_format_idc 4:2:0
+        w.ue(0);
+        w.ue(0);
+        w.bit(0);
+        w.bit(0);
+        w.ue(0);
+        w.ue(0);
+        w.ue(4);
+        w.ue(3);
+        w.bit(0);
+        w.ue(119);  // 1920
+        w.ue(67);   // 1088
+        w.bit(1);
+        w.bit(1);
+        w.bit(1);  // frame_cropping_flag
+        w.ue(0);
+        w.ue(0);
+        w.ue(0);
+        w.ue(4);  // 裁掉 8 行
+        w.bit(1);  // vui_parameters_present_flag
+        w.bit(1);
+        w.bits(8, 255);  // Extended_SAR
+        w.bits(16, 1);
+        w.bits(16, 1);
+        w.bit(0);
+        w.bit(1);  // video_signal_type_present_flag
+        w.bits(4, 0x0A);
+        w.bit(1);
+        w.bits(24, 0x010101);
+        w.bit(0);
+        if (truncated == 0) {
+            w.bit(1);  // timing_info_present_flag
+            w.bits(32, 1001);
+            w.bits(32, 60000);
+            w.bit(1);
+        }
+        w.trailing_bits();
+        std::vector<uint8_t> nal = make_nal(0x67, w);
+        H264Sps sps;
+        CHECK(h264_parse_sps(nal.data(), nal.size(), sps));
+        CHECK(sps.profile_idc == 100 && sps.level_idc == 40);
+        CHECK(sps.width() == 1920 && sps.height() == 1080);
+        CHECK(sps.frame_rate() == (truncated ? 0 : 30));  // 60000 / 1001 / 2 = 29.97
+    }
+
+    H264Sps sps;
+    std::vector<uint8_t> baseline = make_test_sps(false, 0);
+    CHECK(h264_parse_sps(baseline.data(), baseline.size(), sps));
+    CHECK(sps.width() == 320 && sps.height() == 240 && sps.frame_rate() == 0);
+    baseline.resize(6);  // 截断在宽高之前
+    CHECK(!h264_parse_sps(baseline.data(), baseline.size(), sps));
+}
+
+static void test_h264_skip_frames() {
+    struct {
+        bool high;
+        bool cabac;
+        int init_qp;
+        bool weighted;
+        int poc_type;
+    } cases[] = {
+            {false, false, 26, false, 0},
+            {true, true, 26, false, 0},   // mb_skip_flag 初始 MPS 为 1
+            {true, true, 0, true, 0},     // 初始 MPS 为 0：前若干个宏块走 LPS 路径
+            {true, true, 40, false, 2},
+    };
+    for (const auto &c : cases) {
+        std::vector<uint8_t> sps_nal = make_test_sps(c.high, c.poc_type);
+        std::vector<uint8_t> pps_nal = make_test_pps(c.cabac, c.init_qp, c.weighted);
+        H264Sps sps;
+        H264Pps pps;
+        CHECK(h264_parse_sps(sps_nal.data(), sps_nal.size(), sps));
+        CHECK(h264_parse_pps(pps_nal.data(), pps_nal.size(), pps));
+        CHECK(sps.pic_size_in_mbs() == 300);
+        CHECK(pps.entropy_coding_mode == c.cabac && pps.pic_init_qp == c.init_qp);
+
+        std::vector<uint8_t> idr = make_test_idr(60);
+        H264SkipFrameGenerator generator;
+        CHECK(generator.reset(sps_nal, pps_nal, idr.data(), (int) idr.size()));
+        std::vector<uint8_t> frame;
+        for (int i = 1; i <= 40; ++i) {
+            CHECK(generator.next(frame));
+            // frame_num 与 POC 从 IDR（frame_num 0、POC lsb 60）起递增并回绕
+            int poc_lsb = c.poc_type == 0 ? (60 + 2 * i) % 64 : 0;
+            CHECK(decode_skip_frame(frame, sps, pps, i % 16, poc_lsb) == 300);
+            CHECK(frame.size() < (c.cabac ? 64u : 16u));
+        }
+    }
+
+    // 没有 IDR slice、场编码或不支持的参数集时拒绝
+    std::vector<uint8_t> sps_nal = make_test_sps(false, 0);
+    std::vector<uint8_t> pps_nal = make_test_pps(false, 26, false);
+    std::vector<uint8_t> not_idr = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x00, 0x10};
+    H264SkipFrameGenerator generator;
+    std::vector<uint8_t> frame;
+    CHECK(!generator.reset(sps_nal, pps_nal, not_idr.data(), (int) not_idr.size()));
+    CHECK(!generator.next(frame));
+    std::vector<uint8_t> idr = make_test_idr(0);
+    CHECK(!generator.reset(std::vector<uint8_t>(), pps_nal, idr.data(), (int) idr.size()));
+    CHECK(!generator.reset(pps_nal, sps_nal, idr.data(), (int) idr.size()));
+
+    uint8_t silence[16];
+    CHECK(build_silent_audio_frame(RTMP_AUDIO_CODEC_AAC, 1, silence, sizeof(silence)) == 6);
+    CHECK(build_silent_audio_frame(RTMP_AUDIO_CODEC_AAC, 2, silence, sizeof(silence)) == 9);
+    CHECK(silence[0] == 0x21);  // CPE
+    CHECK(build_silent_audio_frame(RTMP_AUDIO_CODEC_OPUS, 2, silence, sizeof(silence)) == 3);
+    CHECK(silence[0] == 0xFC);
+    CHECK(build_silent_audio_frame(RTMP_AUDIO_CODEC_AAC, 6, silence, sizeof(silence)) < 0);
+    CHECK(build_silent_audio_frame(RTMP_AUDIO_CODEC_AAC, 2, silence, 4) < 0);
+    CHECK(audio_frame_duration_us(RTMP_AUDIO_CODEC_AAC, 48000) == 21333);
+    CHECK(audio_frame_duration_us(RTMP_AUDIO_CODEC_OPUS, 48000) == 20000);
+}
+
+static void test_build_on_metadata_body() {
+    char body[1024];
+    int size = build_on_metadata_body(body, sizeof(body), 720, 1280, 1500000, 25, 48000, 2);
+    CHECK(size > 0);
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(body);
+    CHECK(metadata_number(p, size, "width") == 720);
+    CHECK(metadata_number(p, size, "height") == 1280);
+    CHECK(metadata_number(p, size, "videodatarate") == 1500);
+    CHECK(metadata_number(p, size, "framerate") == 25);
+    CHECK(metadata_number(p, size, "audiosamplerate") == 48000);
+
+    CHECK(metadata_number(p, size, "videocodecid") == 7);
+
+    size = build_on_metadata_body(body, sizeof(body), 1920, 1080, 3000000, 30, 48000, 2, RTMP_VIDEO_CODEC_HEVC);
+    CHECK(size > 0);
+    CHECK(metadata_number(p, size, "videocodecid") == (double) FLV_FOURCC_HVC1);
+    CHECK(metadata_number(p, size, "audiocodecid") == 10);
+
+    size = build_on_metadata_body(body, sizeof(body), 1280, 720, 2000000, 30, 48000, 1, RTMP_VIDEO_CODEC_H264,
+                                  RTMP_AUDIO_CODEC_OPUS, 32000);
+    CHECK(size > 0);
+    CHECK(metadata_number(p, size, "audiocodecid") == (double) FLV_FOURCC_OPUS);
+    CHECK(metadata_number(p, size, "audiodatarate") == 32);
+    CHECK(metadata_number(p, size, "audiosamplerate") == 48000);
+
+    char small[16];
+    CHECK(build_on_metadata_body(small, sizeof(small), 720, 1280, 1500000, 25, 48000, 2) < 0);
+}
+
+static void test_spool_fifo_and_eviction() {
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/spool.bin";
+    {
+        FlvSpool spool(path, 1024 * 1024);
+        CHECK(spool.open());
+
+        std::mt19937 rng(1);
+        std::deque<std::pair<int64_t, std::vector<uint8_t>>> expected;
+        bool ok = true;
+        for (int i = 0; i < 20000 && ok; ++i) {
+            std::vector<uint8_t> data(1 + rng() % 30000);
+            for (auto &b : data) b = (uint8_t) rng();
+            if (spool.append(RTMP_PACKET_TYPE_VIDEO, i % 30 == 0, i, data.data(), (uint32_t) data.size())) {
+                expected.push_back(std::make_pair((int64_t) i, data));
+            }
+            // 写满时从队首淘汰
+            while ((long) expected.size() > spool.backlog_records()) expected.pop_front();
+            int reads = rng() % 3 == 0 ? (int) (rng() % 5) : 0;
+            for (int k = 0; k < reads && !spool.empty() && ok; ++k) {
+                FlvSpool::Record record;
+                std::vector<uint8_t> payload;
+                ok = spool.read_front(record, payload) && record.timestamp == expected.front().first &&
+                     payload == expected.front().second;
+                spool.pop_front();
+                expected.pop_front();
+            }
+        }
+        CHECK(ok);
+        CHECK(spool.evicted_records() > 0);
+
+        long bytes = 0;
+        for (const auto &e : expected) bytes += (long) e.second.size();
+        CHECK(spool.backlog_bytes() == bytes);
+
+        spool.clear();
+        CHECK(spool.empty() && spool.backlog_bytes() == 0);
+    }
+    // 关闭时删除缓存文件
+    struct stat st;
+    CHECK(stat(path.c_str(), &st) != 0);
+    rmdir(dir.c_str());
+}
+
+static void test_recorder_single_file() {
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/record.flv";
+    {
+        FlvRecorder recorder(path, 0, 0);
+        CHECK(recorder.start());
+        recorder.submit(make_metadata_tag());
+        recorder.submit(make_tag(RTMP_PACKET_TYPE_VIDEO, 1000, {0x17, 0x00, 0x00, 0x00, 0x00, 0x01}));
+        recorder.submit(make_tag(RTMP_PACKET_TYPE_AUDIO, 0, {0xAF, 0x00, 0x12, 0x10}));
+        recorder.submit(make_video_tag(990, false));  // 首个关键帧之前的 P 帧不录
+        recorder.submit(make_video_tag(1000, true));
+        recorder.submit(make_audio_tag(1010));
+        recorder.submit(make_video_tag(1033, false));
+        recorder.submit(make_video_tag(2000, true));
+        recorder.stop();
+        CHECK(recorder.segment_count() == 1);
+    }
+
+    uint8_t flags = 0;
+    std::vector<ParsedTag> tags;
+    CHECK(parse_flv(path, flags, tags));
+    CHECK(flags == 0x05);
+    CHECK(tags.size() == 7);
+    if (tags.size() == 7) {
+        CHECK(tags[0].type == RTMP_PACKET_TYPE_INFO);
+        CHECK(tags[1].type == RTMP_PACKET_TYPE_VIDEO && tags[1].body[1] == 0x00);
+        CHECK(tags[2].type == RTMP_PACKET_TYPE_AUDIO && tags[2].body[1] == 0x00);
+        CHECK(tags[3].type == RTMP_PACKET_TYPE_VIDEO && tags[3].timestamp == 0);
+        CHECK(tags[4].type == RTMP_PACKET_TYPE_AUDIO && tags[4].timestamp == 10);
+        CHECK(tags[5].timestamp == 33);
+        CHECK(tags[6].timestamp == 1000);
+        // 关闭时回填 duration（秒）与 filesize
+        CHECK(metadata_number(tags[0].body.data(), (int) tags[0].body.size(), "duration") == 1.0);
+        std::vector<uint8_t> file;
+        read_file(path, file);
+        CHECK(metadata_number(tags[0].body.data(), (int) tags[0].body.size(), "filesize") == (double) file.size());
+    }
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+}
+
+/* 大量大小不一的 tag 跨多个批次写出：块对齐写入留下的零头在后续批次中续写，文件逐 tag 完整 */
+static void test_recorder_aligned_batches() {
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/aligned.flv";
+    const int kFrames = 600;
+    long written = 0;
+    {
+        FlvRecorder recorder(path, 0, 0);
+        CHECK(recorder.start());
+        recorder.submit(make_metadata_tag());
+        recorder.submit(make_tag(RTMP_PACKET_TYPE_VIDEO, 0, {0x17, 0x00, 0x00, 0x00, 0x00, 0x01}));
+        for (int i = 0; i < kFrames; ++i) {
+            // 小于 / 跨越 / 远大于一个块的帧交替出现
+            size_t size = i % 30 == 0 ? 20000 + i : (size_t) (17 + (i * 977) % 3000);
+            recorder.submit(make_video_tag((uint32_t) i * 33, i % 30 == 0, size));
+            if (i % 100 == 99) std::this_thread::sleep_for(std::chrono::milliseconds(250));  // 让定时批次先写出
+        }
+        recorder.stop();
+        CHECK(!recorder.failed());
+        written = recorder.written_bytes();
+    }
+    uint8_t flags = 0;
+    std::vector<ParsedTag> tags;
+    CHECK(parse_flv(path, flags, tags));
+    CHECK(tags.size() == (size_t) kFrames + 2);
+    bool ok = tags.size() == (size_t) kFrames + 2;
+    for (int i = 0; ok && i < kFrames; ++i) {
+        size_t size = i % 30 == 0 ? 20000 + i : (size_t) (17 + (i * 977) % 3000);
+        ok = tags[i + 2].body.size() == size && tags[i + 2].timestamp == (uint32_t) i * 33;
+    }
+    CHECK(ok);
+    std::vector<uint8_t> file;
+    read_file(path, file);
+    CHECK((long) file.size() == written);
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+}
+
+static void test_recorder_rotation() {
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/rotate.flv";
+    {
+        FlvRecorder recorder(path, 0, 500);
+        CHECK(recorder.start());
+        recorder.submit(make_metadata_tag());
+        recorder.submit(make_tag(RTMP_PACKET_TYPE_VIDEO, 0, {0x17, 0x00, 0x00, 0x00, 0x00, 0x01}));
+        for (uint32_t ts = 0; ts < 1500; ts += 100) {
+            recorder.submit(make_video_tag(ts, ts % 600 == 0));
+        }
+        recorder.stop();
+        CHECK(recorder.segment_count() == 3);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        char name[64];
+        snprintf(name, sizeof(name), "/rotate_%04d.flv", i);
+        std::string segment = dir + name;
+        uint8_t flags = 0;
+        std::vector<ParsedTag> tags;
+        CHECK(parse_flv(segment, flags, tags));
+        // 每个文件都以 onMetaData + 序列头 + 关键帧开始，时间戳从 0 开始
+        CHECK(tags.size() >= 3);
+        if (tags.size() >= 3) {
+            CHECK(tags[0].type == RTMP_PACKET_TYPE_INFO);
+            CHECK(tags[1].body[0] == 0x17 && tags[1].body[1] == 0x00);
+            CHECK(tags[2].body[0] == 0x17 && tags[2].body[1] == 0x01 && tags[2].timestamp == 0);
+        }
+        unlink(segment.c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+static size_t count_occurrences(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) count++;
+    return count;
+}
+
+static void test_frame_trace_chrome_json() {
+#ifdef BB_RTMP_TRACE
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/trace.json";
+    CHECK(frame_trace_set_enabled(true));
+    // 两个线程并发写入，每帧一组完整事件
+    auto producer = [](FrameTraceTrack track, int frames) {
+        for (int i = 0; i < frames; ++i) {
+            uint32_t ts = (uint32_t) i * 33;
+            FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, track, ts, 1000);
+            FRAME_TRACE(FRAME_TRACE_LOCK_ACQUIRED, track, ts, 1000);
+            FRAME_TRACE(FRAME_TRACE_PACKET_BUILT, track, ts, 1005);
+            FRAME_TRACE(FRAME_TRACE_FIRST_CHUNK, track, ts, 1005);
+            FRAME_TRACE(FRAME_TRACE_LAST_CHUNK, track, ts, 1);
+            FRAME_TRACE(FRAME_TRACE_SOCKET_QUEUE, track, ts, 4096);
+        }
+    };
+    std::thread video(producer, FRAME_TRACE_VIDEO, 100);
+    std::thread audio(producer, FRAME_TRACE_AUDIO, 100);
+    video.join();
+    audio.join();
+    frame_trace_set_enabled(false);
+    FRAME_TRACE(FRAME_TRACE_JNI_ENTRY, FRAME_TRACE_VIDEO, 0, 0);  // 关闭后不记录
+
+    int count = frame_trace_dump_chrome_json(path.c_str());
+    std::vector<uint8_t> data;
+    CHECK(read_file(path, data));
+    std::string json(data.begin(), data.end());
+    // 环形缓冲区可能残留其他测试的事件，按本测试的特征计数
+    CHECK(count >= 1200);
+    CHECK(json.compare(0, 15, "{\"displayTimeUn") == 0);
+    CHECK(json.find("]}") != std::string::npos);
+    CHECK(count_occurrences(json, "\"name\":\"video jni_entry\"") >= 100);
+    CHECK(count_occurrences(json, "\"name\":\"send audio\",\"cat\":\"audio\",\"ph\":\"B\"") == 100);
+    CHECK(count_occurrences(json, "\"name\":\"send audio\",\"cat\":\"audio\",\"ph\":\"E\"") == 100);
+    CHECK(count_occurrences(json, "\"bytes\":4096") == 200);
+
+    // 写满后只保留最近 kRingSize 个事件
+    frame_trace_set_enabled(true);
+    for (uint32_t i = 0; i < frame_trace::kRingSize + 100; ++i) {
+        FRAME_TRACE(FRAME_TRACE_NAL_PARSED, FRAME_TRACE_VIDEO, i, 1);
+    }
+    frame_trace_set_enabled(false);
+    CHECK(frame_trace_dump_chrome_json(path.c_str()) == (int) frame_trace::kRingSize);
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+#else
+    CHECK(!frame_trace_set_enabled(true));
+    CHECK(frame_trace_dump_chrome_json("/dev/null") < 0);
+#endif
+}
+
+static void test_latency_histogram() {
+    // 桶边界连续且单调，相对误差不超过 25%
+    for (uint64_t v = 0; v < 100000; ++v) {
+        int index = LatencyHistogram::bucket_index(v);
+        CHECK(LatencyHistogram::bucket_upper(index) >= v);
+        CHECK(index == 0 || LatencyHistogram::bucket_upper(index - 1) < v);
+        if (v >= 4) CHECK(LatencyHistogram::bucket_upper(index) - v <= v / 4);
+    }
+    CHECK(LatencyHistogram::bucket_index(~0ull) == RTMP_HISTOGRAM_BUCKETS - 1);
+
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; ++i) histogram.record(i);
+    histogram.record(-5);  // 时钟回拨计为 0
+    rtmp_histogram snapshot;
+    histogram.snapshot(&snapshot);
+    CHECK(snapshot.count == 1001);
+    CHECK(snapshot.sum_us == 500500);
+    CHECK(snapshot.max_us == 1000);
+    uint64_t p50 = rtmp_histogram_percentile(&snapshot, 50);
+    uint64_t p99 = rtmp_histogram_percentile(&snapshot, 99);
+    CHECK(p50 >= 500 && p50 <= 625);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK(rtmp_histogram_percentile(&snapshot, 100) == 1000);
+
+    rtmp_histogram empty;
+    memset(&empty, 0, sizeof(empty));
+    CHECK(rtmp_histogram_percentile(&empty, 99) == 0);
+}
+
+static void test_send_stats_snapshot() {
+    SendStats stats;
+    stats.on_packet_sent(SEND_STATS_VIDEO, 10000, 4096, true, 100, 150, 400);
+    stats.on_packet_sent(SEND_STATS_AUDIO, 200, 4096, true, 0, 500, 510);
+    stats.on_packet_sent(SEND_STATS_VIDEO, 10000, 4096, false, 600, 600, 900);
+    stats.on_video_entry(1000);
+    stats.on_video_entry(34000);
+
+    rtmp_stats_v2 out;
+    memset(&out, 0xFF, sizeof(out));
+    out.struct_size = sizeof(out);
+    CHECK(stats.snapshot(&out) == 0);
+    CHECK(out.version == RTMP_STATS_VERSION);
+    CHECK(out.struct_size == sizeof(out));
+    CHECK(out.video.bytes == 10000 && out.video.messages == 1);
+    CHECK(out.audio.bytes == 200 && out.audio.messages == 1);
+    CHECK(out.data.messages == 0);
+    CHECK(out.chunks == 4);  // 3 + 1
+    CHECK(out.send_failures == 1);
+    CHECK(out.queue_depth_bytes == -1);
+    CHECK(out.send_duration_us.count == 3);
+    CHECK(out.enqueue_to_wire_us.count == 1);
+    CHECK(out.enqueue_to_wire_us.max_us == 300);
+    CHECK(out.video_frame_gap_us.count == 1);
+    CHECK(out.video_frame_gap_us.max_us == 33000);
+
+    // 旧版调用方只认识前面的字段：只填充其结构体大小，不越界
+    uint8_t small[offsetof(rtmp_stats_v2, chunks) + 8];
+    memset(small, 0xAB, sizeof(small));
+    rtmp_stats_v2 *partial = reinterpret_cast<rtmp_stats_v2 *>(small);
+    partial->struct_size = offsetof(rtmp_stats_v2, chunks);
+    CHECK(stats.snapshot(partial) == 0);
+    CHECK(partial->struct_size == offsetof(rtmp_stats_v2, chunks));
+    CHECK(partial->audio.bytes == 200);
+    CHECK(small[sizeof(small) - 1] == 0xAB);
+    partial->struct_size = 4;
+    CHECK(stats.snapshot(partial) != 0);
+
+    // io_uring 后端按实际的 io_uring_enter 次数计，不再按 chunk 数估算
+    SendStats uring;
+    uring.on_packet_sent(SEND_STATS_VIDEO, 10000, 128, true, 0, 0, 10, 1);
+    CHECK(uring.snapshot(&out) == 0);
+    CHECK(out.chunks == 79);
+    CHECK(out.send_syscalls == 1);
+}
+
+/* chunk 序列化与 librtmp 的 RTMP_SendPacket 经 socket 写出的字节逐一比较：多 chunk、扩展时间戳、2/3 字节基本头 */
+static void test_rtmp_chunk_matches_librtmp() {
+    struct {
+        int channel;
+        uint32_t timestamp;
+        uint32_t body_size;
+        int chunk_size;
+    } cases[] = {
+            {4, 1000, 100, 128},
+            {4, 1000, 128, 128},
+            {4, 33, 5000, 128},
+            {4, 0xffffff, 300, 128},
+            {4, 0x12345678, 5000, 4096},
+            {70, 40, 1000, 128},
+            {400, 0x01000000, 1000, 256},
+            {3, 0, 0, 128},
+    };
+    for (auto &c : cases) {
+        int fds[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        RTMP *rtmp = RTMP_Alloc();
+        RTMP_Init(rtmp);
+        rtmp->m_sb.sb_socket = fds[0];
+        rtmp->m_outChunkSize = c.chunk_size;
+
+        RTMPPacket packet;
+        RTMPPacket_Reset(&packet);
+        CHECK(RTMPPacket_Alloc(&packet, c.body_size));
+        packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+        packet.m_nChannel = c.channel;
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+        packet.m_nTimeStamp = c.timestamp;
+        packet.m_nInfoField2 = 1;
+        packet.m_nBodySize = c.body_size;
+        for (uint32_t i = 0; i < c.body_size; ++i) packet.m_body[i] = (char) (i * 7 + 1);
+
+        // RTMP_SendPacket 会把后续 chunk 头写进 body，先序列化
+        std::vector<uint8_t> expected;
+        rtmp_write_chunks(&packet, c.chunk_size, [&](const uint8_t *data, size_t len) {
+            expected.insert(expected.end(), data, data + len);
+        });
+        CHECK(expected.size() == rtmp_chunked_size(&packet, c.chunk_size));
+        CHECK(RTMP_SendPacket(rtmp, &packet, 0));
+
+        std::vector<uint8_t> actual(expected.size() + 64);
+        size_t got = 0;
+        while (got < expected.size()) {
+            ssize_t n = recv(fds[1], actual.data() + got, actual.size() - got, 0);
+            if (n <= 0) break;
+            got += (size_t) n;
+        }
+        actual.resize(got);
+        CHECK(actual == expected);
+
+        RTMPPacket_Free(&packet);
+        RTMP_Close(rtmp);
+        RTMP_Free(rtmp);
+        close(fds[1]);
+    }
+}
+
+/* 增量 chunk 解析：librtmp 以 fmt0/1/2 头压缩、扩展时间戳、2/3 字节基本头与中途 Set Chunk Size 写出的字节流，
+ * 逐字节喂入与按不规则长度分片喂入都应还原出相同的消息 */
+static void test_rtmp_chunk_reader() {
+    struct Msg {
+        uint8_t type;
+        int channel;
+        uint32_t timestamp;
+        uint32_t size;
+        int header;
+    } msgs[] = {
+            {RTMP_PACKET_TYPE_INFO, 3, 0, 200, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1000, 300, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1033, 150, RTMP_PACKET_SIZE_MEDIUM},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1066, 150, RTMP_PACKET_SIZE_MEDIUM},  // 大小与类型相同，librtmp 压缩为 fmt2
+            {RTMP_PACKET_TYPE_AUDIO, 4, 1070, 10, RTMP_PACKET_SIZE_MEDIUM},
+            {RTMP_PACKET_TYPE_CHUNK_SIZE, 2, 0, 4, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 0x1000000, 5000, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 70, 5, 10, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_INFO, 400, 7, 300, RTMP_PACKET_SIZE_LARGE},
+    };
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    int buffer = 1 << 20;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    RTMP *rtmp = RTMP_Alloc();
+    RTMP_Init(rtmp);
+    rtmp->m_sb.sb_socket = fds[0];
+    for (size_t m = 0; m < sizeof(msgs) / sizeof(msgs[0]); ++m) {
+        RTMPPacket packet;
+        RTMPPacket_Reset(&packet);
+        CHECK(RTMPPacket_Alloc(&packet, msgs[m].size));
+        packet.m_packetType = msgs[m].type;
+        packet.m_nChannel = msgs[m].channel;
+        packet.m_headerType = msgs[m].header;
+        packet.m_nTimeStamp = msgs[m].timestamp;
+        packet.m_nInfoField2 = msgs[m].channel == 2 ? 0 : 1;
+        packet.m_nBodySize = msgs[m].size;
+        for (uint32_t i = 0; i < msgs[m].size; ++i) packet.m_body[i] = (char) (i * 13 + m);
+        if (msgs[m].type == RTMP_PACKET_TYPE_CHUNK_SIZE) {
+            const char size[4] = {0, 0, 0x10, 0};  // 4096
+            memcpy(packet.m_body, size, 4);
+        }
+        CHECK(RTMP_SendPacket(rtmp, &packet, 0));
+        if (msgs[m].type == RTMP_PACKET_TYPE_CHUNK_SIZE) rtmp->m_outChunkSize = 4096;
+        RTMPPacket_Free(&packet);
+    }
+    shutdown(fds[0], SHUT_WR);
+    std::vector<uint8_t> wire;
+    uint8_t buf[4096];
+    ssize_t n;
+    while ((n = recv(fds[1], buf, sizeof(buf), 0)) > 0) wire.insert(wire.end(), buf, buf + n);
+    RTMP_Close(rtmp);
+    RTMP_Free(rtmp);
+    close(fds[1]);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t index = 0;
+        bool ok = true;
+        RtmpChunkReader *reader_ptr = nullptr;
+        RtmpChunkReader reader([&](const RtmpMessage &message) {
+            if (index >= sizeof(msgs) / sizeof(msgs[0])) {
+                ok = false;
+                return;
+            }
+            const Msg &expect = msgs[index];
+            ok = ok && message.type == expect.type && message.channel == expect.channel &&
+                 message.timestamp == expect.timestamp && message.size == expect.size &&
+                 message.stream_id == (expect.channel == 2 ? 0u : 1u);
+            if (message.type == RTMP_PACKET_TYPE_CHUNK_SIZE) {
+                reader_ptr->set_chunk_size(4096);
+            } else {
+                for (uint32_t i = 0; i < message.size && ok; ++i) ok = message.body[i] == (uint8_t) (i * 13 + index);
+            }
+            index++;
+        });
+        reader_ptr = &reader;
+        uint32_t seed = 12345;
+        size_t pos = 0;
+        while (pos < wire.size()) {
+            seed = seed * 1103515245 + 12345;
+            size_t len = pass == 0 ? 1 : 1 + (seed >> 16) % 700;
+            len = std::min(len, wire.size() - pos);
+            CHECK(reader.feed(wire.data() + pos, len));
+            pos += len;
+        }
+        CHECK(ok);
+        CHECK(index == sizeof(msgs) / sizeof(msgs[0]));
+    }
+
+    // 未以 fmt0 开始的通道视为协议错误
+    RtmpChunkReader reader([](const RtmpMessage &) {});
+    const uint8_t bad[] = {0x44, 0, 0, 1, 0, 0, 1, 9};
+    CHECK(!reader.feed(bad, sizeof(bad)));
+}
+
+/* 环形缓冲区接收：librtmp 读取前两条消息后由 RtmpReceiver 接手（sb_buf 中的剩余字节与通道头状态），之后覆盖头压缩、
+ * 扩展时间戳、2/3 字节基本头、中途 Set Chunk Size、大消息直接读入与缓冲区回绕 */
+static void test_rtmp_receiver() {
+    struct Msg {
+        uint8_t type;
+        int channel;
+        uint32_t timestamp;
+        uint32_t size;
+        int header;
+    };
+    std::vector<Msg> msgs = {
+            {RTMP_PACKET_TYPE_INFO, 3, 0, 200, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1000, 300, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1033, 150, RTMP_PACKET_SIZE_MEDIUM},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 1066, 150, RTMP_PACKET_SIZE_MEDIUM},
+            {RTMP_PACKET_TYPE_AUDIO, 4, 1070, 10, RTMP_PACKET_SIZE_MEDIUM},
+            {RTMP_PACKET_TYPE_VIDEO, 4, 0x1000000, 5000, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_VIDEO, 70, 5, 10, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_INFO, 400, 7, 300, RTMP_PACKET_SIZE_LARGE},
+            {RTMP_PACKET_TYPE_CHUNK_SIZE, 2, 0, 4, RTMP_PACKET_SIZE_LARGE},
+    };
+    for (uint32_t i = 0; i < 4; ++i) {
+        msgs.push_back({RTMP_PACKET_TYPE_VIDEO, 6, 2000 + i * 40, 200000,
+                        i == 0 ? RTMP_PACKET_SIZE_LARGE : RTMP_PACKET_SIZE_MEDIUM});
+    }
+    // 大小、类型与时间戳增量都不变：librtmp 压缩为 fmt3 开始的新消息
+    for (uint32_t i = 0; i < 200; ++i) {
+        msgs.push_back({RTMP_PACKET_TYPE_AUDIO, 5, 3000 + i * 23, 700,
+                        i == 0 ? RTMP_PACKET_SIZE_LARGE : RTMP_PACKET_SIZE_MEDIUM});
+    }
+    const uint32_t kChunkSize = 65536;
+
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    // 前 9 条消息写完后才开始读，保证 librtmp 的 sb_buf 中留有未解析的字节
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool prefix_written = false;
+    std::thread writer([&] {
+        RTMP *rtmp = RTMP_Alloc();
+        RTMP_Init(rtmp);
+        rtmp->m_sb.sb_socket = fds[0];
+        for (size_t m = 0; m < msgs.size(); ++m) {
+            RTMPPacket packet;
+            RTMPPacket_Reset(&packet);
+            RTMPPacket_Alloc(&packet, msgs[m].size);
+            packet.m_packetType = msgs[m].type;
+            packet.m_nChannel = msgs[m].channel;
+            packet.m_headerType = msgs[m].header;
+            packet.m_nTimeStamp = msgs[m].timestamp;
+            packet.m_nInfoField2 = msgs[m].channel == 2 ? 0 : 1;
+            packet.m_nBodySize = msgs[m].size;
+            for (uint32_t i = 0; i < msgs[m].size; ++i) packet.m_body[i] = (char) (i * 13 + m);
+            if (msgs[m].type == RTMP_PACKET_TYPE_CHUNK_SIZE) AMF_EncodeInt32(packet.m_body, packet.m_body + 4, kChunkSize);
+            RTMP_SendPacket(rtmp, &packet, 0);
+            if (msgs[m].type == RTMP_PACKET_TYPE_CHUNK_SIZE) {
+                rtmp->m_outChunkSize = (int) kChunkSize;
+                std::lock_guard<std::mutex> lock(mutex);
+                prefix_written = true;
+                cv.notify_all();
+            }
+            RTMPPacket_Free(&packet);
+        }
+        shutdown(fds[0], SHUT_WR);
+        RTMP_Close(rtmp);
+        RTMP_Free(rtmp);
+    });
+
+    auto matches = [&](size_t m, uint8_t type, int channel, uint32_t stream_id, uint32_t timestamp,
+                       const uint8_t *body, uint32_t size) {
+        const Msg &expect = msgs[m];
+        bool ok = type == expect.type && channel == expect.channel && timestamp == expect.timestamp &&
+                  size == expect.size && stream_id == (expect.channel == 2 ? 0u : 1u);
+        if (type == RTMP_PACKET_TYPE_CHUNK_SIZE) return ok;
+        for (uint32_t i = 0; i < size && ok; ++i) ok = body[i] == (uint8_t) (i * 13 + m);
+        return ok;
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return prefix_written; });
+    }
+    RTMP *rtmp = RTMP_Alloc();
+    RTMP_Init(rtmp);
+    rtmp->m_sb.sb_socket = fds[1];
+    size_t index = 0;
+    bool ok = true;
+    RTMPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    while (index < 2 && RTMP_ReadPacket(rtmp, &packet)) {
+        if (!RTMPPacket_IsReady(&packet)) continue;
+        ok = ok && matches(index, packet.m_packetType, packet.m_nChannel, (uint32_t) packet.m_nInfoField2,
+                           packet.m_nTimeStamp, reinterpret_cast<const uint8_t *>(packet.m_body), packet.m_nBodySize);
+        RTMPPacket_Free(&packet);
+        index++;
+    }
+    CHECK(index == 2);
+
+    RtmpReceiver receiver(fds[1]);
+    CHECK(receiver.adopt(rtmp));
+    CHECK(receiver.stats().bytes_in > 0);  // librtmp 已读入 sb_buf 的字节
+    RtmpMessage message;
+    int result;
+    while ((result = receiver.read(&message, 5000)) > 0) {
+        if (index >= msgs.size()) {
+            ok = false;
+            break;
+        }
+        ok = ok && matches(index, message.type, message.channel, message.stream_id, message.timestamp,
+                           message.body, message.size);
+        if (message.type == RTMP_PACKET_TYPE_CHUNK_SIZE) receiver.set_chunk_size(kChunkSize);
+        index++;
+    }
+    writer.join();
+    CHECK(ok);
+    CHECK(index == msgs.size());
+    CHECK(result < 0 && receiver.closed() && receiver.error() == nullptr);
+    const RtmpReceiverStats &stats = receiver.stats();
+    CHECK(stats.messages == msgs.size() - 2);
+    CHECK(stats.zero_copy_messages > 0);
+    CHECK(stats.direct_bytes > 0);
+    CHECK(stats.copied_bytes > 0);
+    CHECK(stats.recv_calls < stats.messages);
+    RTMP_Close(rtmp);
+    RTMP_Free(rtmp);
+    close(fds[0]);
+
+    // 未以 fmt0 开始的通道视为协议错误
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const uint8_t bad[] = {0x44, 0, 0, 1, 0, 0, 1, 9};
+    CHECK(write(fds[0], bad, sizeof(bad)) == (ssize_t) sizeof(bad));
+    RtmpReceiver bad_receiver(fds[1]);
+    CHECK(bad_receiver.read(&message, 1000) < 0);
+    CHECK(bad_receiver.error() != nullptr);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 回环 TCP 连接（AF_UNIX 不支持 SO_ZEROCOPY）
+static bool tcp_loopback_pair(int fds[2]) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bool ok = listener >= 0 && bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+              listen(listener, 1) == 0 && getsockname(listener, (struct sockaddr *) &addr, &len) == 0;
+    fds[0] = ok ? socket(AF_INET, SOCK_STREAM, 0) : -1;
+    ok = ok && fds[0] >= 0 && connect(fds[0], (struct sockaddr *) &addr, sizeof(addr)) == 0;
+    fds[1] = ok ? accept(listener, nullptr, nullptr) : -1;
+    if (listener >= 0) close(listener);
+    return ok && fds[1] >= 0;
+}
+
+static bool wait_zerocopy_completions(const SendStats &stats, uint64_t count) {
+    for (int i = 0; i < 200; ++i) {
+        rtmp_stats_v2 out;
+        out.struct_size = sizeof(out);
+        stats.snapshot(&out);
+        if (out.zerocopy_completion_us.count >= count) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+static void test_zerocopy_sender() {
+    int fds[2];
+    CHECK(tcp_loopback_pair(fds));
+    std::shared_ptr<SendStats> stats = std::make_shared<SendStats>();
+    std::shared_ptr<ZeroCopySender> sender = zerocopy_sender_create(fds[0], 1024, stats);
+    if (!sender) {
+        printf("  MSG_ZEROCOPY 不可用，跳过\n");
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    int pair[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    CHECK(!zerocopy_sender_create(pair[0], 1024, nullptr));
+    close(pair[0]);
+    close(pair[1]);
+
+    std::vector<uint8_t> received;
+    std::thread reader([&] {
+        uint8_t buf[64 * 1024];
+        ssize_t n;
+        while ((n = recv(fds[1], buf, sizeof(buf), 0)) > 0) received.insert(received.end(), buf, buf + n);
+    });
+
+    const int kChunkSize = 64 * 1024;
+    const uint32_t kBodySize = 200 * 1024;
+    std::vector<uint8_t> expected;
+    char *bodies[3];
+    FlvTagRef recording;
+    for (int i = 0; i < 3; ++i) {
+        RTMPPacket packet;
+        RTMPPacket_Reset(&packet);
+        CHECK(sender->alloc_body(&packet, kBodySize));
+        bodies[i] = packet.m_body;
+        packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+        packet.m_nChannel = 0x04;
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+        packet.m_nTimeStamp = 33 * i;
+        packet.m_nInfoField2 = 1;
+        packet.m_nBodySize = kBodySize;
+        for (uint32_t k = 0; k < kBodySize; ++k) packet.m_body[k] = (char) (k * 13 + i);
+        rtmp_write_chunks(&packet, kChunkSize, [&](const uint8_t *data, size_t len) {
+            expected.insert(expected.end(), data, data + len);
+        });
+
+        int syscalls = 0;
+        CHECK(sender->send(&packet, kChunkSize, &syscalls));
+        CHECK(syscalls >= 1);
+        CHECK(sender->awaiting_body());
+        FlvTagRef tag = std::make_shared<FlvTag>(&packet);
+        sender->pin(tag);
+        CHECK(!sender->awaiting_body());
+        // 第二条消息的 body 另有持有者（相当于录制中），完成后不应归还缓冲池
+        if (i == 1) recording = tag;
+        tag.reset();
+        CHECK(wait_zerocopy_completions(*stats, (uint64_t) i + 1));
+    }
+
+    // 第一条消息的 body 完成后被第二条复用；第二条被“录制”持有，第三条只能新分配
+    CHECK(bodies[1] == bodies[0]);
+    CHECK(bodies[2] != bodies[1]);
+    RTMPPacket packet;
+    RTMPPacket_Reset(&packet);
+    CHECK(sender->alloc_body(&packet, kBodySize));
+    CHECK(packet.m_body == bodies[2]);
+    RTMPPacket_Free(&packet);
+
+    rtmp_stats_v2 out;
+    out.struct_size = sizeof(out);
+    stats->snapshot(&out);
+    CHECK(out.zerocopy_messages == 3);
+    CHECK(out.zerocopy_bytes == expected.size());
+    CHECK(out.copy_avoided_bytes + out.zerocopy_copied_bytes == out.zerocopy_bytes);
+    CHECK(out.zerocopy_completion_us.count == 3);
+
+    sender.reset();
+    shutdown(fds[0], SHUT_WR);
+    reader.join();
+    CHECK(received == expected);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static RTMPPacket make_video_packet(uint32_t timestamp, uint32_t body_size) {
+    RTMPPacket packet;
+    RTMPPacket_Reset(&packet);
+    RTMPPacket_Alloc(&packet, body_size);
+    packet.m_packetType = RTMP_PACKET_TYPE_VIDEO;
+    packet.m_nChannel = 0x04;
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_nTimeStamp = timestamp;
+    packet.m_nInfoField2 = 1;
+    packet.m_nBodySize = body_size;
+    for (uint32_t k = 0; k < body_size; ++k) packet.m_body[k] = (char) (k * 31 + timestamp);
+    return packet;
+}
+
+/* 对端不读时写到期限返回 PENDING（packet 随即释放），之后 flush 从断点续写，对端收到的字节与阻塞发送一致 */
+static void test_partial_writer() {
+    int fds[2];
+    CHECK(tcp_loopback_pair(fds));
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    PartialWriter writer(fds[0]);
+    const int kChunkSize = 4096;
+    std::vector<uint8_t> expected;
+
+    RTMPPacket first = make_video_packet(0, 2 * 1024 * 1024);
+    rtmp_write_chunks(&first, kChunkSize, [&](const uint8_t *data, size_t len) {
+        expected.insert(expected.end(), data, data + len);
+    });
+    int syscalls = 0;
+    int64_t start_us = send_stats_now_us();
+    CHECK(writer.write(&first, kChunkSize, start_us + 50000, &syscalls) == PARTIAL_WRITE_PENDING);
+    int64_t elapsed_us = send_stats_now_us() - start_us;
+    CHECK(elapsed_us >= 50000 && elapsed_us < 2000000);
+    CHECK(syscalls >= 1);
+    size_t pending = writer.pending_bytes();
+    CHECK(pending > 0 && pending < expected.size());
+    RTMPPacket_Free(&first);
+
+    // 期限已过：只尝试一次，仍写不出
+    CHECK(writer.flush(send_stats_now_us(), &syscalls) == PARTIAL_WRITE_PENDING);
+    CHECK(writer.pending_bytes() <= pending);
+
+    std::vector<uint8_t> received;
+    std::thread reader([&] {
+        uint8_t buf[64 * 1024];
+        ssize_t n;
+        while ((n = recv(fds[1], buf, sizeof(buf), 0)) > 0) received.insert(received.end(), buf, buf + n);
+    });
+    CHECK(writer.flush(send_stats_now_us() + 5000000, &syscalls) == PARTIAL_WRITE_DONE);
+    CHECK(writer.pending_bytes() == 0);
+
+    RTMPPacket second = make_video_packet(33, 10000);
+    rtmp_write_chunks(&second, kChunkSize, [&](const uint8_t *data, size_t len) {
+        expected.insert(expected.end(), data, data + len);
+    });
+    CHECK(writer.write(&second, kChunkSize, send_stats_now_us() + 5000000, &syscalls) == PARTIAL_WRITE_DONE);
+    RTMPPacket_Free(&second);
+
+    shutdown(fds[0], SHUT_WR);
+    reader.join();
+    CHECK(received == expected);
+
+    // 对端关闭后写失败
+    close(fds[1]);
+    RTMPPacket third = make_video_packet(66, 100000);
+    PartialWriteResult result = PARTIAL_WRITE_DONE;
+    for (int i = 0; i < 10 && result == PARTIAL_WRITE_DONE; ++i) {
+        result = writer.write(&third, kChunkSize, send_stats_now_us() + 100000, &syscalls);
+    }
+    CHECK(result == PARTIAL_WRITE_FAILED);
+    RTMPPacket_Free(&third);
+    close(fds[0]);
+}
+
+static std::mutex g_log_mutex;
+static std::vector<std::string> g_log_lines;
+
+static void capture_log(int prio, const char *tag, const char *line) {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    g_log_lines.push_back(std::to_string(prio) + "/" + tag + ": " + line);
+}
+
+static void test_async_log_ring() {
+    bb_log_set_sink(capture_log);
+    bb_log_set_async(true);
+    CHECK(bb_log_async_enabled());
+
+    char expected[3][512];
+    char scratch[64];
+    snprintf(scratch, sizeof(scratch), "临时缓冲区");
+    const char host[] = "example.com/live";  // %.*s 不要求以 0 结尾
+    BB_LOG(ANDROID_LOG_ERROR, "T", "a=%d b=%5.2f s=%s h=%.*s x=%08llx c=%c %% z=%zu n=%ld p=%-4sEND",
+           -42, 3.14159, scratch, 11, host, 0xBEEFull, 'Q', (size_t) 7, -9L, "ab");
+    snprintf(expected[0], sizeof(expected[0]), "6/T: a=%d b=%5.2f s=%s h=%.*s x=%08llx c=%c %% z=%zu n=%ld p=%-4sEND",
+             -42, 3.14159, "临时缓冲区", 11, host, 0xBEEFull, 'Q', (size_t) 7, -9L, "ab");
+    // 调用返回后修改字符串缓冲区，输出仍应是调用时的内容
+    snprintf(scratch, sizeof(scratch), "已修改");
+    BB_LOG(ANDROID_LOG_WARN, "T", "hh=%hhd h=%hu w=%*d u=%u e=%.3e", 300, 70000, 6, 12, 4000000000u, 12345.678);
+    snprintf(expected[1], sizeof(expected[1]), "5/T: hh=%hhd h=%hu w=%*d u=%u e=%.3e",
+             (signed char) 300, (unsigned short) 70000, 6, 12, 4000000000u, 12345.678);
+    std::string long_text(400, 'x');
+    BB_LOG(ANDROID_LOG_INFO, "T", "long=%s tail=%d", long_text.c_str(), 1);
+
+    bb_log_flush();
+    bb_log_set_async(false);
+    bb_log_set_sink(nullptr);
+    CHECK(!bb_log_async_enabled());
+
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    CHECK(g_log_lines.size() == 3);
+    if (g_log_lines.size() != 3) return;
+    CHECK(g_log_lines[0] == expected[0]);
+    CHECK(g_log_lines[1] == expected[1]);
+    // 参数区放不下时截断并以省略号结尾，不越界
+    CHECK(g_log_lines[2].compare(0, 11, "4/T: long=x") == 0);
+    CHECK(g_log_lines[2].size() < 300);
+    CHECK(g_log_lines[2].find("tail=1") == std::string::npos);
+    CHECK(g_log_lines[2].compare(g_log_lines[2].size() - strlen("…"), std::string::npos, "…") == 0);
+}
+
+int main() {
+    struct {
+        const char *name;
+        std::function<void()> fn;
+    } tests[] = {
+            {"annexb_to_avc_body", test_annexb_to_avc_body},
+            {"parse_sps_pps", test_parse_sps_pps},
+            {"hevc_parameter_sets_and_frames", test_hevc_parameter_sets_and_frames},
+            {"video_sequence_header", test_video_sequence_header},
+            {"audio_tags", test_audio_tags},
+            {"build_on_metadata_body", test_build_on_metadata_body},
+            {"async_video_sender", test_async_video_sender},
+            {"h264_sps_fields", test_h264_sps_fields},
+            {"h264_skip_frames", test_h264_skip_frames},
+            {"av_clock", test_av_clock},
+            {"frame_ring", test_frame_ring},
+            {"spool_fifo_and_eviction", test_spool_fifo_and_eviction},
+            {"recorder_single_file", test_recorder_single_file},
+            {"recorder_rotation", test_recorder_rotation},
+            {"recorder_aligned_batches", test_recorder_aligned_batches},
+            {"frame_trace_chrome_json", test_frame_trace_chrome_json},
+            {"latency_histogram", test_latency_histogram},
+            {"send_stats_snapshot", test_send_stats_snapshot},
+            {"rtmp_chunk_matches_librtmp", test_rtmp_chunk_matches_librtmp},
+            {"rtmp_chunk_reader", test_rtmp_chunk_reader},
+            {"rtmp_receiver", test_rtmp_receiver},
+            {"zerocopy_sender", test_zerocopy_sender},
+            {"partial_writer", test_partial_writer},
+            {"async_log_ring", test_async_log_ring},
+    };
+    for (auto &test : tests) {
+        int before = g_failures;
+        test.fn();
+        printf("[%s] %s\n", g_failures == before ? "PASS" : "FAIL", test.name);
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include "impair_link.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const double kMahimahiPacketBytes = 1500;
+const double kUnlimitedCredit = 1e18;
+
+bool read_text(const std::string &path, std::string &text, std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "无法打开 " + path;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    text = ss.str();
+    return true;
+}
+
+}  // namespace
+
+bool ImpairSchedule::load_script(const std::string &path, std::string &error) {
+    std::string text;
+    return read_text(path, text, error) && parse_script(text, error);
+}
+
+bool ImpairSchedule::parse_script(const std::string &text, std::string &error) {
+    std::istringstream lines(text);
+    std::string line;
+    int line_no = 0;
+    while (std::getline(lines, line)) {
+        line_no++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream tokens(line);
+        int64_t time_ms;
+        std::string command;
+        if (!(tokens >> time_ms)) continue;  // 空行
+        if (!(tokens >> command) || time_ms < 0) {
+            error = "第 " + std::to_string(line_no) + " 行格式错误";
+            return false;
+        }
+        if (command == "loop") {
+            loop_ms_ = time_ms;
+            continue;
+        }
+        int64_t value;
+        if (!(tokens >> value) || value < 0) {
+            error = "第 " + std::to_string(line_no) + " 行缺少数值";
+            return false;
+        }
+        Event event = {time_ms, BW, value};
+        if (command == "bw") event.kind = BW;
+        else if (command == "delay") event.kind = DELAY;
+        else if (command == "jitter") event.kind = JITTER;
+        else if (command == "stall") event.kind = STALL;
+        else if (command == "outage") event.kind = OUTAGE;
+        else {
+            error = "第 " + std::to_string(line_no) + " 行未知命令: " + command;
+            return false;
+        }
+        events_.push_back(event);
+    }
+    std::stable_sort(events_.begin(), events_.end(), [](const Event &a, const Event &b) {
+        return a.time_ms < b.time_ms;
+    });
+    return true;
+}
+
+bool ImpairSchedule::load_mahimahi(const std::string &path, std::string &error) {
+    std::string text;
+    if (!read_text(path, text, error)) return false;
+    std::istringstream in(text);
+    int64_t t;
+    while (in >> t) {
+        if (t < 0 || (!opportunities_.empty() && t < opportunities_.back())) {
+            error = "Mahimahi trace 时间戳必须非负且递增: " + path;
+            return false;
+        }
+        opportunities_.push_back(t);
+    }
+    if (opportunities_.empty() || opportunities_.back() <= 0) {
+        error = "Mahimahi trace 为空: " + path;
+        opportunities_.clear();
+        return false;
+    }
+    // Mahimahi 约定：trace 以最后一个时间戳为周期循环
+    mahimahi_period_ms_ = opportunities_.back();
+    return true;
+}
+
+ImpairState ImpairSchedule::state_at(int64_t t_ms) const {
+    if (loop_ms_ > 0) t_ms %= loop_ms_;
+    ImpairState state = base_;
+    for (const Event &event : events_) {
+        if (event.time_ms > t_ms) break;
+        switch (event.kind) {
+            case BW:
+                state.bw_kbps = event.value;
+                break;
+            case DELAY:
+                state.delay_ms = (int) event.value;
+                break;
+            case JITTER:
+                state.jitter_ms = (int) event.value;
+                break;
+            case STALL:
+                if (t_ms < event.time_ms + event.value) state.stalled = true;
+                break;
+            case OUTAGE:
+                if (t_ms < event.time_ms + event.value) state.outage = true;
+                break;
+        }
+    }
+    return state;
+}
+
+int64_t ImpairSchedule::opportunities_until(int64_t t_ms) const {
+    if (opportunities_.empty() || t_ms < 0) return 0;
+    int64_t cycles = t_ms / mahimahi_period_ms_;
+    int64_t rem = t_ms % mahimahi_period_ms_;
+    int64_t in_cycle = std::upper_bound(opportunities_.begin(), opportunities_.end(), rem) - opportunities_.begin();
+    return cycles * (int64_t) opportunities_.size() + in_cycle;
+}
+
+ImpairLink::ImpairLink(const ImpairSchedule &schedule, bool shaped, size_t queue_limit, uint32_t seed)
+        : schedule_(schedule), shaped_(shaped), queue_limit_(queue_limit), rng_(seed) {
+}
+
+void ImpairLink::push(int64_t now_us, const uint8_t *data, size_t size) {
+    if (size == 0) return;
+    ImpairState state = schedule_.state_at(now_us / 1000);
+    int64_t delay_us = (int64_t) state.delay_ms * 1000;
+    if (state.jitter_ms > 0) {
+        delay_us += (int64_t) (rng_() % ((uint32_t) state.jitter_ms * 1000 + 1));
+    }
+    // TCP 字节流不能乱序：释放时刻不早于前一块
+    int64_t release_us = std::max(now_us + delay_us, last_release_us_);
+    last_release_us_ = release_us;
+    Chunk chunk = {release_us, std::vector<uint8_t>(data, data + size), 0};
+    chunks_.push_back(std::move(chunk));
+    queued_ += size;
+}
+
+void ImpairLink::refill(int64_t now_us, const ImpairState &state, bool has_ready) {
+    int64_t opportunities = schedule_.has_mahimahi() ? schedule_.opportunities_until(now_us / 1000) : 0;
+    if (state.stalled) {
+        credit_ = 0;
+    } else if (schedule_.has_mahimahi()) {
+        // 没有待发数据时发送机会作废（与 Mahimahi 一致）
+        credit_ = has_ready ? credit_ + (opportunities - credit_opportunities_) * kMahimahiPacketBytes : 0;
+    } else if (state.bw_kbps > 0) {
+        double bytes_per_us = state.bw_kbps * 1000.0 / 8 / 1000000;
+        double burst = std::max(2 * kMahimahiPacketBytes, bytes_per_us * 5000);  // 5ms 突发
+        credit_ = std::min(credit_ + bytes_per_us * (now_us - credit_time_us_), burst);
+    } else {
+        credit_ = kUnlimitedCredit;
+    }
+    credit_time_us_ = now_us;
+    credit_opportunities_ = opportunities;
+}
+
+size_t ImpairLink::sendable(int64_t now_us, const uint8_t **data) {
+    ImpairState state = schedule_.state_at(now_us / 1000);
+    size_t ready = 0;
+    if (!chunks_.empty() && chunks_.front().release_us <= now_us) {
+        const Chunk &front = chunks_.front();
+        ready = front.data.size() - front.offset;
+        *data = front.data.data() + front.offset;
+    }
+    if (state.stalled) {
+        refill(now_us, state, ready > 0);
+        return 0;
+    }
+    if (!shaped_) return ready;
+    refill(now_us, state, ready > 0);
+    return credit_ >= 1 ? (size_t) std::min(credit_, (double) ready) : 0;
+}
+
+void ImpairLink::consume(size_t size) {
+    if (shaped_) credit_ = std::max(0.0, credit_ - (double) size);
+    queued_ -= size;
+    forwarded_bytes_ += (int64_t) size;
+    while (size > 0 && !chunks_.empty()) {
+        Chunk &front = chunks_.front();
+        size_t n = std::min(size, front.data.size() - front.offset);
+        front.offset += n;
+        size -= n;
+        if (front.offset == front.data.size()) chunks_.pop_front();
+    }
+}
+
+int64_t ImpairLink::next_wakeup_us(int64_t now_us) const {
+    if (chunks_.empty()) return -1;
+    if (chunks_.front().release_us > now_us) return chunks_.front().release_us;
+    return now_us + 1000;  // 受带宽或停顿限制，1ms 后再检查
+}
@@ -0,0 +1,104 @@
+#ifndef BB_RTMP_IMPAIR_LINK_H
+#define BB_RTMP_IMPAIR_LINK_H
+
+/*
+ * 用户态网络损伤模型：由脚本驱动带宽上限、附加时延、抖动、停顿与周期性断网，
+ * 也可读取 Mahimahi 格式的链路 trace（每行一个毫秒时间戳，表示一次 1500 字节的发送机会）。
+ *
+ * 脚本格式（# 开头为注释，时间为相对开始的毫秒）：
+ *   0      bw 4000        带宽上限 kbps，0 表示不限
+ *   0      delay 40       单向附加时延 ms
+ *   0      jitter 10      附加 0~jitter ms 的随机时延（不乱序）
+ *   12000  stall 2000     2 秒内不转发任何数据（连接保持）
+ *   20000  outage 3000    重置现有连接，3 秒内拒绝新连接
+ *   30000  loop           从头循环
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+struct ImpairState {
+    int64_t bw_kbps = 0;
+    int delay_ms = 0;
+    int jitter_ms = 0;
+    bool stalled = false;
+    bool outage = false;
+};
+
+class ImpairSchedule {
+public:
+    bool load_script(const std::string &path, std::string &error);
+    bool load_mahimahi(const std::string &path, std::string &error);
+    // 命令行给出的初始值，脚本中的同名事件会覆盖
+    void set_base(const ImpairState &base) { base_ = base; }
+
+    ImpairState state_at(int64_t t_ms) const;
+    bool has_mahimahi() const { return !opportunities_.empty(); }
+    // Mahimahi trace 在 (0, t_ms] 内的累计发送机会数（按 trace 周期循环）
+    int64_t opportunities_until(int64_t t_ms) const;
+
+private:
+    enum Kind { BW, DELAY, JITTER, STALL, OUTAGE };
+    struct Event {
+        int64_t time_ms;
+        Kind kind;
+        int64_t value;  // STALL/OUTAGE 为持续时间
+    };
+
+    bool parse_script(const std::string &text, std::string &error);
+
+    ImpairState base_;
+    std::vector<Event> events_;     // 按时间排序
+    int64_t loop_ms_ = 0;           // 0 表示不循环
+    std::vector<int64_t> opportunities_;
+    int64_t mahimahi_period_ms_ = 0;
+};
+
+/*
+ * 单方向链路：先按时延/抖动排队，到期后受带宽（或 Mahimahi 发送机会）与停顿限制转发。
+ * 队列有上限，满时调用方应停止读取发送端 socket，使背压传回推流端。
+ */
+class ImpairLink {
+public:
+    ImpairLink(const ImpairSchedule &schedule, bool shaped, size_t queue_limit, uint32_t seed);
+
+    size_t writable() const { return queued_ < queue_limit_ ? queue_limit_ - queued_ : 0; }
+    size_t queued() const { return queued_; }
+    bool empty() const { return queued_ == 0; }
+
+    void push(int64_t now_us, const uint8_t *data, size_t size);
+    // 当前可转发的连续字节（指向队首），返回长度
+    size_t sendable(int64_t now_us, const uint8_t **data);
+    void consume(size_t size);
+    // 下一次可能有数据可转发的时刻；队列为空返回 -1
+    int64_t next_wakeup_us(int64_t now_us) const;
+
+    int64_t forwarded_bytes() const { return forwarded_bytes_; }
+
+private:
+    struct Chunk {
+        int64_t release_us;
+        std::vector<uint8_t> data;
+        size_t offset;
+    };
+
+    void refill(int64_t now_us, const ImpairState &state, bool has_ready);
+
+    const ImpairSchedule &schedule_;
+    bool shaped_;
+    size_t queue_limit_;
+    std::mt19937 rng_;
+    std::deque<Chunk> chunks_;
+    size_t queued_ = 0;
+    int64_t last_release_us_ = 0;
+    double credit_ = 0;
+    int64_t credit_time_us_ = 0;
+    int64_t credit_opportunities_ = 0;
+    int64_t forwarded_bytes_ = 0;
+};
+
+#endif // BB_RTMP_IMPAIR_LINK_H
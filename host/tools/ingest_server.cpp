@@ -0,0 +1,726 @@
+#include "ingest_server.h"
+#include "latency_probe.h"
+#include "librtmp/amf.h"
+#include "librtmp/rtmp.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int kWindowAckSize = 2500000;
+const size_t kMaxErrorMessages = 16;
+
+// Enhanced RTMP 视频扩展头
+const uint32_t kFourCcHvc1 = 0x68766331;  // 'hvc1'
+const uint32_t kFourCcOpus = 0x4F707573;  // 'Opus'
+const int kSoundFormatExHeader = 9;
+const int kPacketTypeSequenceStart = 0;
+const int kPacketTypeCodedFrames = 1;
+const int kPacketTypeCodedFramesX = 3;
+
+#define SAVC(x) static const AVal av_##x = {(char *) #x, sizeof(#x) - 1}
+SAVC(connect);
+SAVC(createStream);
+SAVC(publish);
+SAVC(play);
+SAVC(deleteStream);
+SAVC(FCUnpublish);
+SAVC(app);
+SAVC(_result);
+SAVC(onStatus);
+SAVC(fmsVer);
+SAVC(capabilities);
+SAVC(level);
+SAVC(code);
+SAVC(description);
+SAVC(objectEncoding);
+SAVC(status);
+SAVC(onMetaData);
+#undef SAVC
+static const AVal av_setDataFrame = {(char *) "@setDataFrame", sizeof("@setDataFrame") - 1};
+
+AVal make_aval(const char *s) {
+    AVal v = {const_cast<char *>(s), (int) strlen(s)};
+    return v;
+}
+
+uint32_t read_be(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+/* 携带编码帧（而非序列头/序列结束）的视频 tag */
+bool is_coded_video_frame(const uint8_t *body, uint32_t size) {
+    if (size < 5) return false;
+    if (body[0] & 0x80) {
+        int packet_type = body[0] & 0x0F;
+        return packet_type == kPacketTypeCodedFrames || packet_type == kPacketTypeCodedFramesX;
+    }
+    return body[1] == 0x01;
+}
+
+bool send_message(RTMP *r, uint8_t type, int channel, uint32_t stream_id, const char *body, int size) {
+    RTMPPacket packet;
+    if (!RTMPPacket_Alloc(&packet, size)) return false;
+    RTMPPacket_Reset(&packet);
+    memcpy(packet.m_body, body, size);
+    packet.m_nBodySize = size;
+    packet.m_packetType = type;
+    packet.m_nChannel = channel;
+    packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    packet.m_nInfoField2 = stream_id;
+    int ok = RTMP_SendPacket(r, &packet, FALSE);
+    RTMPPacket_Free(&packet);
+    return ok != 0;
+}
+
+/* connect 应答：窗口确认大小、对端带宽、分块大小，最后是 _result */
+bool reply_connect(RTMP *r, double txn, int chunk_size, uint32_t window_ack_size) {
+    char buf[512];
+    char *pend = buf + sizeof(buf);
+
+    AMF_EncodeInt32(buf, pend, window_ack_size);
+    if (!send_message(r, RTMP_PACKET_TYPE_SERVER_BW, 0x02, 0, buf, 4)) return false;
+    AMF_EncodeInt32(buf, pend, kWindowAckSize);
+    buf[4] = 2;  // dynamic
+    if (!send_message(r, RTMP_PACKET_TYPE_CLIENT_BW, 0x02, 0, buf, 5)) return false;
+    AMF_EncodeInt32(buf, pend, chunk_size);
+    if (!send_message(r, RTMP_PACKET_TYPE_CHUNK_SIZE, 0x02, 0, buf, 4)) return false;
+    r->m_outChunkSize = chunk_size;
+
+    char *p = buf;
+    p = AMF_EncodeString(p, pend, &av__result);
+    p = AMF_EncodeNumber(p, pend, txn);
+    *p++ = AMF_OBJECT;
+    AVal fms_ver = make_aval("FMS/3,5,7,7009");
+    p = AMF_EncodeNamedString(p, pend, &av_fmsVer, &fms_ver);
+    p = AMF_EncodeNamedNumber(p, pend, &av_capabilities, 31.0);
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    *p++ = AMF_OBJECT;
+    AVal status = make_aval("status");
+    AVal code = make_aval("NetConnection.Connect.Success");
+    AVal description = make_aval("Connection succeeded.");
+    p = AMF_EncodeNamedString(p, pend, &av_level, &status);
+    p = AMF_EncodeNamedString(p, pend, &av_code, &code);
+    p = AMF_EncodeNamedString(p, pend, &av_description, &description);
+    p = AMF_EncodeNamedNumber(p, pend, &av_objectEncoding, 0.0);
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    return send_message(r, RTMP_PACKET_TYPE_INVOKE, 0x03, 0, buf, (int) (p - buf));
+}
+
+bool reply_create_stream(RTMP *r, double txn, uint32_t stream_id) {
+    char buf[64];
+    char *pend = buf + sizeof(buf);
+    char *p = buf;
+    p = AMF_EncodeString(p, pend, &av__result);
+    p = AMF_EncodeNumber(p, pend, txn);
+    *p++ = AMF_NULL;
+    p = AMF_EncodeNumber(p, pend, stream_id);
+    return send_message(r, RTMP_PACKET_TYPE_INVOKE, 0x03, 0, buf, (int) (p - buf));
+}
+
+bool send_status(RTMP *r, uint32_t stream_id, const char *code_str, const char *description_str) {
+    char buf[256];
+    char *pend = buf + sizeof(buf);
+    char *p = buf;
+    p = AMF_EncodeString(p, pend, &av_onStatus);
+    p = AMF_EncodeNumber(p, pend, 0);
+    *p++ = AMF_NULL;
+    *p++ = AMF_OBJECT;
+    AVal code = make_aval(code_str);
+    AVal description = make_aval(description_str);
+    p = AMF_EncodeNamedString(p, pend, &av_level, &av_status);
+    p = AMF_EncodeNamedString(p, pend, &av_code, &code);
+    p = AMF_EncodeNamedString(p, pend, &av_description, &description);
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = AMF_OBJECT_END;
+    return send_message(r, RTMP_PACKET_TYPE_INVOKE, 0x05, stream_id, buf, (int) (p - buf));
+}
+
+/* 用户控制消息：事件类型 + 流 id（StreamBegin 0、StreamEOF 1） */
+bool send_stream_event(RTMP *r, int event, uint32_t stream_id) {
+    char buf[6] = {0, (char) event};
+    AMF_EncodeInt32(buf + 2, buf + sizeof(buf), stream_id);
+    return send_message(r, RTMP_PACKET_TYPE_CONTROL, 0x02, 0, buf, sizeof(buf));
+}
+
+/*
+ * 回放 FLV：文件头之后的 tag 依次作为 RTMP 消息发出。音视频各用一个通道，首条消息用完整头，之后用 MEDIUM 头，
+ * 由 librtmp 按上一条消息压缩成 fmt1~3（大小与类型不变时省略长度，时间戳增量不变时省略时间戳）。
+ * buf 在调用之间复用，RTMP_SendPacket 会在消息体之前写 chunk 头。返回发出的 tag 数，发送失败返回 -1
+ */
+long send_flv_tags(RTMP *r, uint32_t stream_id, const std::vector<uint8_t> &flv, std::vector<char> &buf) {
+    const uint8_t *p = flv.data();
+    const uint8_t *end = p + flv.size();
+    if (end - p < 13 || memcmp(p, "FLV", 3) != 0) return 0;
+    p += read_be(p + 5, 4) + 4;  // 文件头与 PreviousTagSize0
+    bool audio_started = false;
+    bool video_started = false;
+    long tags = 0;
+    while (end - p >= 11) {
+        uint8_t type = p[0] & 0x1f;
+        uint32_t size = read_be(p + 1, 3);
+        uint32_t timestamp = read_be(p + 4, 3) | ((uint32_t) p[7] << 24);
+        if ((size_t) (end - p) < 11 + (size_t) size) break;
+        if (buf.size() < RTMP_MAX_HEADER_SIZE + (size_t) size) buf.resize(RTMP_MAX_HEADER_SIZE + (size_t) size);
+        RTMPPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.m_body = buf.data() + RTMP_MAX_HEADER_SIZE;
+        memcpy(packet.m_body, p + 11, size);
+        packet.m_nBodySize = size;
+        packet.m_packetType = type;
+        packet.m_nTimeStamp = timestamp;
+        packet.m_nInfoField2 = (int32_t) stream_id;
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+        if (type == RTMP_PACKET_TYPE_AUDIO) {
+            packet.m_nChannel = 0x04;
+            if (audio_started) packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+            audio_started = true;
+        } else if (type == RTMP_PACKET_TYPE_VIDEO) {
+            packet.m_nChannel = 0x06;
+            if (video_started) packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+            video_started = true;
+        } else {
+            packet.m_nChannel = 0x05;
+        }
+        if (!RTMP_SendPacket(r, &packet, FALSE)) return -1;
+        tags++;
+        p += 11 + size;
+        if (end - p < 4) break;
+        p += 4;
+    }
+    return tags;
+}
+
+}  // namespace
+
+struct IngestServer::Session {
+    int fd = -1;
+    std::mutex mutex;  // 保护 stats；连接线程写，streams() 读
+    IngestStreamStats stats;
+    int nal_length_size = 4;
+    bool seen_video_frame = false;
+    bool have_video_ts = false;
+    bool have_audio_ts = false;
+    uint32_t last_video_ts = 0;
+    uint32_t last_audio_ts = 0;
+    long media_tags = 0;
+
+    void add_error(const std::string &message) {
+        stats.errors++;
+        if (stats.error_messages.size() < kMaxErrorMessages) stats.error_messages.push_back(message);
+    }
+
+    /* AVCDecoderConfigurationRecord：版本、NALU 长度字段、SPS/PPS 个数与长度必须自洽 */
+    bool check_avc_config(const uint8_t *p, size_t size) {
+        const uint8_t *end = p + size;
+        if (size < 7 || p[0] != 1) return false;
+        if ((p[4] & 0x03) == 2) return false;  // lengthSizeMinusOne 只能为 0、1、3
+        nal_length_size = (p[4] & 0x03) + 1;
+        int sps_count = p[5] & 0x1F;
+        p += 6;
+        for (int pass = 0; pass < 2; ++pass) {
+            int count;
+            if (pass == 0) {
+                count = sps_count;
+            } else {
+                if (p >= end) return false;
+                count = *p++;
+            }
+            if (count == 0) return false;
+            for (int i = 0; i < count; ++i) {
+                if (p + 2 > end) return false;
+                uint32_t len = read_be(p, 2);
+                p += 2;
+                if (len == 0 || p + len > end) return false;
+                if ((p[0] & 0x1F) != (pass == 0 ? 7 : 8)) return false;
+                p += len;
+            }
+        }
+        return true;
+    }
+
+    /* HEVCDecoderConfigurationRecord：版本、NALU 长度字段与 VPS/SPS/PPS 数组必须自洽 */
+    bool check_hevc_config(const uint8_t *p, size_t size) {
+        const uint8_t *end = p + size;
+        if (size < 23 || p[0] != 1) return false;
+        if ((p[21] & 0x03) == 2) return false;
+        nal_length_size = (p[21] & 0x03) + 1;
+        int arrays = p[22];
+        p += 23;
+        bool seen[3] = {false, false, false};
+        for (int a = 0; a < arrays; ++a) {
+            if (p + 3 > end) return false;
+            int type = p[0] & 0x3F;
+            uint32_t count = read_be(p + 1, 2);
+            p += 3;
+            for (uint32_t i = 0; i < count; ++i) {
+                if (p + 2 > end) return false;
+                uint32_t len = read_be(p, 2);
+                p += 2;
+                if (len < 2 || p + len > end) return false;
+                if (((p[0] >> 1) & 0x3F) != type) return false;
+                p += len;
+            }
+            if (type >= 32 && type <= 34 && count > 0) seen[type - 32] = true;
+        }
+        return p == end && seen[0] && seen[1] && seen[2];
+    }
+
+    /* 校验视频 tag，返回 false 时已记录错误 */
+    bool check_video(const uint8_t *body, uint32_t size, IngestTag &tag) {
+        if (size < 5) {
+            add_error("视频 tag 过短");
+            return false;
+        }
+        if (body[0] & 0x80) return check_ex_video(body, size, tag);
+        int frame_type = body[0] >> 4;
+        if ((body[0] & 0x0F) != 7) {
+            add_error("不支持的视频编码 id=" + std::to_string(body[0] & 0x0F));
+            return false;
+        }
+        tag.keyframe = frame_type == 1;
+        if (body[1] == 0x00) {
+            tag.config = true;
+            stats.avc_config_valid = check_avc_config(body + 5, size - 5);
+            if (!stats.avc_config_valid) add_error("AVC 序列头无效");
+            return stats.avc_config_valid;
+        }
+        if (body[1] != 0x01) return true;  // end of sequence
+        if (!stats.avc_config_valid) {
+            add_error("视频帧早于有效的 AVC 序列头");
+            return false;
+        }
+        return check_nalus(body + 5, body + size, false, tag);
+    }
+
+    /* Enhanced RTMP 扩展视频头：IsExHeader | FrameType(3) | PacketType(4) + FourCC */
+    bool check_ex_video(const uint8_t *body, uint32_t size, IngestTag &tag) {
+        int frame_type = (body[0] >> 4) & 0x07;
+        int packet_type = body[0] & 0x0F;
+        if (read_be(body + 1, 4) != kFourCcHvc1) {
+            add_error("不支持的视频 FourCC");
+            return false;
+        }
+        tag.keyframe = frame_type == 1;
+        if (packet_type == kPacketTypeSequenceStart) {
+            tag.config = true;
+            stats.hevc_config_valid = check_hevc_config(body + 5, size - 5);
+            if (!stats.hevc_config_valid) add_error("HEVC 序列头无效");
+            return stats.hevc_config_valid;
+        }
+        size_t header = packet_type == kPacketTypeCodedFrames ? 8 : 5;  // CodedFrames 带 3 字节 composition time
+        if (packet_type != kPacketTypeCodedFrames && packet_type != kPacketTypeCodedFramesX) return true;
+        if (size < header) {
+            add_error("视频 tag 过短");
+            return false;
+        }
+        if (!stats.hevc_config_valid) {
+            add_error("视频帧早于有效的 HEVC 序列头");
+            return false;
+        }
+        return check_nalus(body + header, body + size, true, tag);
+    }
+
+    bool check_nalus(const uint8_t *p, const uint8_t *end, bool hevc, IngestTag &tag) {
+        if (!seen_video_frame && !tag.keyframe) add_error("第一帧视频不是关键帧");
+        seen_video_frame = true;
+
+        bool has_idr = false;
+        while (p < end) {
+            if (p + nal_length_size > end) {
+                add_error("NALU 长度字段越界");
+                return false;
+            }
+            uint32_t len = read_be(p, nal_length_size);
+            p += nal_length_size;
+            if (len == 0 || len > (uint32_t) (end - p)) {
+                add_error("NALU 长度与 tag 大小不一致");
+                return false;
+            }
+            if (p[0] & 0x80) add_error("NALU forbidden_zero_bit 非零");
+            if (hevc) {
+                int nal_type = (p[0] >> 1) & 0x3F;
+                if (nal_type >= 16 && nal_type <= 23) has_idr = true;  // IRAP
+            } else {
+                int nal_type = p[0] & 0x1F;
+                if (nal_type == 5) has_idr = true;
+            }
+            int64_t send_time_us;
+            if (!hevc && tag.delay_us < 0 && latency_probe_parse_nal(p, len, send_time_us)) {
+                tag.delay_us = tag.arrival_us - send_time_us;
+            }
+            p += len;
+        }
+        if (tag.keyframe && !has_idr) add_error("关键帧中没有 IDR NALU");
+        return true;
+    }
+
+    /* Enhanced RTMP 扩展音频头：SoundFormat=ExHeader | AudioPacketType + FourCC，序列头为 OpusHead */
+    bool check_ex_audio(const uint8_t *body, uint32_t size, IngestTag &tag) {
+        int packet_type = body[0] & 0x0F;
+        if (size < 5 || read_be(body + 1, 4) != kFourCcOpus) {
+            add_error("不支持的音频 FourCC");
+            return false;
+        }
+        if (packet_type == kPacketTypeSequenceStart) {
+            tag.config = true;
+            const uint8_t *head = body + 5;
+            bool ok = size >= 5 + 19 && memcmp(head, "OpusHead", 8) == 0 && head[8] == 1 && head[9] > 0 &&
+                      (head[18] != 0 || head[9] <= 2);
+            stats.opus_config_valid = ok;
+            if (!ok) add_error("OpusHead 无效");
+            return ok;
+        }
+        if (packet_type != kPacketTypeCodedFrames) return true;
+        if (!stats.opus_config_valid) {
+            add_error("音频帧早于有效的 Opus 序列头");
+            return false;
+        }
+        if (size <= 5) {
+            add_error("空的 Opus 帧");
+            return false;
+        }
+        return true;
+    }
+
+    bool check_audio(const uint8_t *body, uint32_t size, IngestTag &tag) {
+        if (size >= 1 && (body[0] >> 4) == kSoundFormatExHeader) return check_ex_audio(body, size, tag);
+        if (size < 2 || (body[0] >> 4) != 10) {
+            add_error("音频 tag 不是 AAC");
+            return false;
+        }
+        if (body[1] == 0x00) {
+            tag.config = true;
+            bool ok = size >= 4;
+            if (ok) {
+                int object_type = body[2] >> 3;
+                int sample_index = ((body[2] & 0x07) << 1) | (body[3] >> 7);
+                int channels = (body[3] >> 3) & 0x0F;
+                ok = object_type > 0 && sample_index < 13 && channels > 0 && channels <= 7;
+            }
+            stats.aac_config_valid = ok;
+            if (!ok) add_error("AAC AudioSpecificConfig 无效");
+            return ok;
+        }
+        if (!stats.aac_config_valid) {
+            add_error("音频帧早于有效的 AAC 序列头");
+            return false;
+        }
+        if (size <= 2) {
+            add_error("空的 AAC 帧");
+            return false;
+        }
+        return true;
+    }
+
+    bool check_metadata(const uint8_t *body, uint32_t size) {
+        AMFObject obj;
+        if (AMF_Decode(&obj, reinterpret_cast<const char *>(body), (int) size, FALSE) < 0) {
+            add_error("onMetaData 解码失败");
+            return false;
+        }
+        AVal name;
+        int index = 0;
+        AMFProp_GetString(AMF_GetProp(&obj, nullptr, index), &name);
+        if (AVMATCH(&name, &av_setDataFrame)) {
+            AMFProp_GetString(AMF_GetProp(&obj, nullptr, ++index), &name);
+        }
+        AMFObjectProperty *data = AMF_GetProp(&obj, nullptr, index + 1);
+        bool ok = AVMATCH(&name, &av_onMetaData) &&
+                  (data->p_type == AMF_ECMA_ARRAY || data->p_type == AMF_OBJECT);
+        AMF_Reset(&obj);
+        if (!ok) {
+            add_error("脚本数据不是 onMetaData");
+            return false;
+        }
+        stats.metadata_received = true;
+        return true;
+    }
+
+    void check_timestamp(IngestTag &tag) {
+        if (tag.config || tag.type == RTMP_PACKET_TYPE_INFO) return;
+        bool video = tag.type == RTMP_PACKET_TYPE_VIDEO;
+        bool &have = video ? have_video_ts : have_audio_ts;
+        uint32_t &last = video ? last_video_ts : last_audio_ts;
+        if (have && tag.timestamp_ms < last) {
+            add_error(std::string(video ? "视频" : "音频") + "时间戳回退: " + std::to_string(last) +
+                      " -> " + std::to_string(tag.timestamp_ms));
+        }
+        have = true;
+        last = tag.timestamp_ms;
+    }
+};
+
+IngestServer::IngestServer() = default;
+
+IngestServer::~IngestServer() {
+    stop();
+}
+
+bool IngestServer::start(int port, const std::string &bind_address) {
+    if (running_) return false;
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (fast_open_queue_ > 0 &&
+        setsockopt(listen_fd_, IPPROTO_TCP, TCP_FASTOPEN, &fast_open_queue_, sizeof(fast_open_queue_)) != 0) {
+        fprintf(stderr, "ingest: 开启 TCP Fast Open 失败: %s\n", strerror(errno));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    if (inet_pton(AF_INET, bind_address.c_str(), &addr.sin_addr) != 1 ||
+        bind(listen_fd_, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listen_fd_, 64) != 0) {
+        fprintf(stderr, "ingest: 监听 %s:%d 失败: %s\n", bind_address.c_str(), port, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, (struct sockaddr *) &addr, &len);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    accept_thread_ = std::thread(&IngestServer::accept_loop, this);
+    return true;
+}
+
+void IngestServer::stop() {
+    if (!running_.exchange(false)) return;
+    // 关闭监听 socket 唤醒 accept
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &session : sessions_) {
+            std::lock_guard<std::mutex> session_lock(session->mutex);
+            if (!session->stats.closed) shutdown(session->fd, SHUT_RDWR);
+        }
+        threads.swap(session_threads_);
+    }
+    for (auto &t : threads) t.join();
+}
+
+void IngestServer::accept_loop() {
+    while (running_) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::shared_ptr<Session> session = std::make_shared<Session>();
+        session->fd = fd;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            close(fd);
+            break;
+        }
+        session->stats.id = next_id_++;
+        sessions_.push_back(session);
+        session_threads_.emplace_back(&IngestServer::serve, this, session);
+    }
+}
+
+void IngestServer::serve(std::shared_ptr<Session> session) {
+    RTMP *r = RTMP_Alloc();
+    RTMP_Init(r);
+    r->m_sb.sb_socket = session->fd;
+
+    if (!RTMP_Serve(r)) {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->add_error("RTMP 握手失败");
+    } else {
+        const uint32_t stream_id = 1;
+        std::vector<char> play_buf;
+        RTMPPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        while (RTMP_IsConnected(r) && RTMP_ReadPacket(r, &packet)) {
+            if (!RTMPPacket_IsReady(&packet)) continue;
+            const uint8_t *body = reinterpret_cast<const uint8_t *>(packet.m_body);
+            uint32_t size = packet.m_nBodySize;
+            IngestTag tag = {packet.m_packetType, packet.m_nTimeStamp, size, false, false,
+                             latency_probe_now_us(), -1};
+            bool media = false;
+            bool play = false;
+
+            std::unique_lock<std::mutex> lock(session->mutex);
+            IngestStreamStats &stats = session->stats;
+            switch (packet.m_packetType) {
+                case RTMP_PACKET_TYPE_CHUNK_SIZE:
+                    if (size >= 4) r->m_inChunkSize = (int) read_be(body, 4);
+                    break;
+                case RTMP_PACKET_TYPE_CONTROL:
+                    // ping 请求（事件 6）：以 ping 响应（事件 7）回显时间戳
+                    if (size >= 6 && read_be(body, 2) == 6) {
+                        char reply[6] = {0, 7, (char) body[2], (char) body[3], (char) body[4], (char) body[5]};
+                        if (!send_message(r, RTMP_PACKET_TYPE_CONTROL, 0x02, 0, reply, sizeof(reply))) {
+                            session->add_error("发送 ping 响应失败");
+                        }
+                    } else if (size >= 6 && read_be(body, 2) == 7) {
+                        stats.ping_replies++;
+                    }
+                    break;
+                case RTMP_PACKET_TYPE_BYTES_READ_REPORT:
+                    if (size >= 4) {
+                        stats.acks_received++;
+                        stats.last_ack_bytes = read_be(body, 4);
+                    }
+                    break;
+                case RTMP_PACKET_TYPE_INVOKE: {
+                    AMFObject obj;
+                    if (AMF_Decode(&obj, packet.m_body, (int) size, FALSE) < 0) {
+                        session->add_error("命令消息解码失败");
+                        break;
+                    }
+                    AVal method;
+                    AMFProp_GetString(AMF_GetProp(&obj, nullptr, 0), &method);
+                    double txn = AMFProp_GetNumber(AMF_GetProp(&obj, nullptr, 1));
+                    bool ok = true;
+                    if (AVMATCH(&method, &av_connect)) {
+                        AMFObject cmd;
+                        AVal app = {nullptr, 0};
+                        AMFProp_GetObject(AMF_GetProp(&obj, nullptr, 2), &cmd);
+                        AMFProp_GetString(AMF_GetProp(&cmd, &av_app, -1), &app);
+                        stats.app.assign(app.av_val != nullptr ? app.av_val : "", app.av_len);
+                        ok = reply_connect(r, txn, chunk_size_, window_ack_size_);
+                    } else if (AVMATCH(&method, &av_createStream)) {
+                        ok = reply_create_stream(r, txn, stream_id);
+                    } else if (AVMATCH(&method, &av_publish)) {
+                        AVal name = {nullptr, 0};
+                        AMFProp_GetString(AMF_GetProp(&obj, nullptr, 3), &name);
+                        stats.stream_name.assign(name.av_val != nullptr ? name.av_val : "", name.av_len);
+                        stats.publishing = true;
+                        ok = send_status(r, stream_id, "NetStream.Publish.Start", "Start publishing");
+                    } else if (AVMATCH(&method, &av_play)) {
+                        AVal name = {nullptr, 0};
+                        AMFProp_GetString(AMF_GetProp(&obj, nullptr, 3), &name);
+                        stats.stream_name.assign(name.av_val != nullptr ? name.av_val : "", name.av_len);
+                        stats.playing = true;
+                        play = true;
+                        ok = send_stream_event(r, 0, stream_id) &&
+                             send_status(r, stream_id, "NetStream.Play.Start", "Started playing");
+                    } else if (AVMATCH(&method, &av_deleteStream) || AVMATCH(&method, &av_FCUnpublish)) {
+                        stats.publishing = false;
+                    }
+                    AMF_Reset(&obj);
+                    if (!ok) session->add_error("发送命令应答失败");
+                    break;
+                }
+                case RTMP_PACKET_TYPE_VIDEO:
+                    media = true;
+                    session->check_video(body, size, tag);
+                    break;
+                case RTMP_PACKET_TYPE_AUDIO:
+                    media = true;
+                    session->check_audio(body, size, tag);
+                    break;
+                case RTMP_PACKET_TYPE_INFO:
+                    media = true;
+                    session->check_metadata(body, size);
+                    break;
+                default:
+                    break;
+            }
+            if (media) {
+                if (!stats.publishing) session->add_error("publish 之前收到媒体数据");
+                session->check_timestamp(tag);
+                stats.bytes += size;
+                if (stats.first_arrival_us == 0) stats.first_arrival_us = tag.arrival_us;
+                stats.last_arrival_us = tag.arrival_us;
+                if (!tag.config && size > 2) {
+                    if (tag.type == RTMP_PACKET_TYPE_VIDEO && is_coded_video_frame(body, size)) {
+                        stats.video_frames++;
+                        if (tag.keyframe) stats.video_keyframes++;
+                    } else if (tag.type == RTMP_PACKET_TYPE_AUDIO) {
+                        stats.audio_frames++;
+                    }
+                }
+                if (tag.delay_us >= 0) stats.delay_us.push_back(tag.delay_us);
+                if (ping_every_tags_ > 0 && ++session->media_tags % ping_every_tags_ == 0) {
+                    char ping[6] = {0, 6};
+                    AMF_EncodeInt32(ping + 2, ping + sizeof(ping), tag.timestamp_ms);
+                    if (!send_message(r, RTMP_PACKET_TYPE_CONTROL, 0x02, 0, ping, sizeof(ping))) {
+                        session->add_error("发送 ping 请求失败");
+                    }
+                }
+            }
+            RTMPPacket_Free(&packet);
+            if (media && tag_callback_) {
+                // 只带会话标识，避免每个 tag 复制时延数组
+                IngestStreamStats stream;
+                stream.id = stats.id;
+                stream.app = stats.app;
+                stream.stream_name = stats.stream_name;
+                lock.unlock();
+                tag_callback_(stream, tag);
+            }
+            if (play) {
+                // 回放期间不持有会话锁，streams() 不被阻塞
+                lock.unlock();
+                long tags = send_flv_tags(r, stream_id, play_source_, play_buf);
+                bool ok = tags >= 0 && send_stream_event(r, 1, stream_id) &&
+                          send_status(r, stream_id, "NetStream.Play.Stop", "Stopped playing");
+                lock.lock();
+                stats.playing = false;
+                if (tags > 0) stats.played_tags += tags;
+                if (!ok) session->add_error("回放发送失败");
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> session_lock(session->mutex);
+        session->stats.closed = true;
+        session->stats.publishing = false;
+        session->stats.playing = false;
+    }
+    cv_.notify_all();
+    RTMP_Close(r);
+    RTMP_Free(r);
+}
+
+std::vector<IngestStreamStats> IngestServer::streams() {
+    std::vector<IngestStreamStats> result;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &session : sessions_) {
+        std::lock_guard<std::mutex> session_lock(session->mutex);
+        result.push_back(session->stats);
+    }
+    return result;
+}
+
+bool IngestServer::wait_closed(int count, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+        int closed = 0;
+        for (auto &session : sessions_) {
+            std::lock_guard<std::mutex> session_lock(session->mutex);
+            if (session->stats.closed) closed++;
+        }
+        return closed >= count;
+    });
+}
@@ -0,0 +1,114 @@
+#ifndef BB_RTMP_INGEST_SERVER_H
+#define BB_RTMP_INGEST_SERVER_H
+
+/*
+ * 回环 RTMP 接入服务（主机构建）：基于 librtmp 自带的服务端握手（RTMP_Serve）与
+ * RTMP_ReadPacket 接收推流，校验 AVC/HEVC（Enhanced RTMP 'hvc1'）/AAC/Opus（Enhanced RTMP 'Opus'）序列头与 FLV tag，记录每个 tag 的到达时间，
+ * 并根据推流端插入的发送时间戳 SEI（见 latency_probe.h）计算每帧单向时延。
+ * 也可响应 play 请求回放预置的 FLV 文件，用于拉流读取的测试与测量。
+ * 仅用于测试与本机测量，不追求完整的 RTMP 服务端语义。
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct IngestTag {
+    uint8_t type;            // 8 音频，9 视频，18 脚本数据
+    uint32_t timestamp_ms;   // RTMP 消息时间戳
+    uint32_t size;           // 消息体大小
+    bool keyframe;
+    bool config;             // 视频/音频序列头
+    int64_t arrival_us;      // 到达时刻（CLOCK_REALTIME 微秒）
+    int64_t delay_us;        // 单向时延，无发送时间戳时为 -1
+};
+
+struct IngestStreamStats {
+    int id = 0;
+    std::string app;
+    std::string stream_name;
+    bool publishing = false;
+    bool playing = false;
+    bool closed = false;
+    bool metadata_received = false;
+    bool avc_config_valid = false;
+    bool hevc_config_valid = false;
+    bool aac_config_valid = false;
+    bool opus_config_valid = false;
+    long video_frames = 0;
+    long video_keyframes = 0;
+    long audio_frames = 0;
+    long bytes = 0;
+    long played_tags = 0;             // 回放（play）发出的 tag 数
+    long acks_received = 0;           // 收到的 Acknowledgement 数
+    uint32_t last_ack_bytes = 0;      // 最近一次 Acknowledgement 确认的字节数
+    long ping_replies = 0;            // 收到的 ping 响应（事件 7）数
+    long errors = 0;                  // 校验失败的 tag 数
+    std::vector<std::string> error_messages;  // 最多保留前 16 条
+    std::vector<int64_t> delay_us;    // 每个携带发送时间戳的视频帧的单向时延
+    int64_t first_arrival_us = 0;
+    int64_t last_arrival_us = 0;
+};
+
+class IngestServer {
+public:
+    // 每个媒体 tag 到达时回调（在连接线程中调用，需自行保证线程安全；stream 只填充 id/app/stream_name）
+    typedef std::function<void(const IngestStreamStats &stream, const IngestTag &tag)> TagCallback;
+
+    IngestServer();
+    ~IngestServer();
+
+    // port 为 0 时由系统分配端口，可通过 port() 获取
+    bool start(int port, const std::string &bind_address = "127.0.0.1");
+    void stop();
+    int port() const { return port_; }
+
+    void set_tag_callback(TagCallback cb) { tag_callback_ = cb; }
+    // 在 start 之前调用：监听 socket 开启 TCP Fast Open（还需 net.ipv4.tcp_fastopen 含服务端位 2），0 关闭
+    void set_fast_open(int queue_len) { fast_open_queue_ = queue_len; }
+    // 在 start 之前调用：connect 应答中通告的发送 chunk size（默认 4096）
+    void set_chunk_size(int chunk_size) { chunk_size_ = chunk_size; }
+    // 在 start 之前调用：connect 应答中通告的 Window Acknowledgement Size（默认 2500000）
+    void set_window_ack_size(uint32_t size) { window_ack_size_ = size; }
+    // 在 start 之前调用：推流期间每收到 every 个媒体 tag 向推流端发一次 ping 请求，0 关闭
+    void set_ping_every_tags(int every) { ping_every_tags_ = every; }
+    // 在 start 之前调用：play 请求回放的 FLV 文件（文件头之后的 tag 依次作为 RTMP 消息发出，最后发送
+    // NetStream.Play.Stop）；为空时 play 立即结束
+    void set_play_source(std::vector<uint8_t> flv) { play_source_.swap(flv); }
+
+    // 所有推流会话的快照（含已结束的）
+    std::vector<IngestStreamStats> streams();
+    // 等待已结束的推流会话数达到 count，超时返回 false
+    bool wait_closed(int count, int timeout_ms);
+
+private:
+    struct Session;
+
+    void accept_loop();
+    void serve(std::shared_ptr<Session> session);
+
+    int listen_fd_ = -1;
+    int port_ = 0;
+    int fast_open_queue_ = 0;
+    int chunk_size_ = 4096;
+    uint32_t window_ack_size_ = 2500000;
+    int ping_every_tags_ = 0;
+    std::vector<uint8_t> play_source_;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+    TagCallback tag_callback_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;  // 会话结束时通知 wait_closed
+    std::vector<std::shared_ptr<Session>> sessions_;
+    std::vector<std::thread> session_threads_;
+    int next_id_ = 0;
+};
+
+#endif // BB_RTMP_INGEST_SERVER_H
@@ -0,0 +1,59 @@
+#ifndef BB_RTMP_LATENCY_PROBE_H
+#define BB_RTMP_LATENCY_PROBE_H
+
+/*
+ * 发送时间戳探针：推流端在视频帧前插入一个 SEI（user_data_unregistered），
+ * 负载为固定 UUID + 16 位十六进制的发送时刻（CLOCK_REALTIME 微秒），接收端据此计算单向时延。
+ * 负载全部为非零字节，不需要防竞争字节（emulation prevention）。
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+static const uint8_t kLatencyProbeUuid[16] = {
+        0x62, 0x62, 0x72, 0x74, 0x6D, 0x70, 0x2D, 0x73,  // "bbrtmp-s"
+        0x65, 0x6E, 0x64, 0x2D, 0x74, 0x69, 0x6D, 0x65,  // "end-time"
+};
+static const size_t kLatencyProbePayloadSize = 16 + 16;
+
+inline int64_t latency_probe_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* 以 Annex-B 格式追加携带 send_time_us 的 SEI NALU */
+inline void latency_probe_append_sei(std::vector<uint8_t> &out, int64_t send_time_us) {
+    static const char kHex[] = "0123456789abcdef";
+    const uint8_t prefix[] = {0x00, 0x00, 0x00, 0x01, 0x06, 0x05, (uint8_t) kLatencyProbePayloadSize};
+    out.insert(out.end(), prefix, prefix + sizeof(prefix));
+    out.insert(out.end(), kLatencyProbeUuid, kLatencyProbeUuid + sizeof(kLatencyProbeUuid));
+    uint64_t value = (uint64_t) send_time_us;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        out.push_back((uint8_t) kHex[(value >> shift) & 0x0F]);
+    }
+    out.push_back(0x80);  // rbsp_trailing_bits
+}
+
+/* 在单个 NALU 中查找探针 SEI */
+inline bool latency_probe_parse_nal(const uint8_t *nal, size_t size, int64_t &send_time_us) {
+    if (size < 3 + kLatencyProbePayloadSize || (nal[0] & 0x1F) != 6 || nal[1] != 0x05 ||
+        nal[2] != kLatencyProbePayloadSize || memcmp(nal + 3, kLatencyProbeUuid, sizeof(kLatencyProbeUuid)) != 0) {
+        return false;
+    }
+    uint64_t value = 0;
+    const uint8_t *hex = nal + 3 + sizeof(kLatencyProbeUuid);
+    for (int i = 0; i < 16; ++i) {
+        uint8_t c = hex[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1);
+        if (digit < 0) return false;
+        value = (value << 4) | (uint64_t) digit;
+    }
+    send_time_us = (int64_t) value;
+    return true;
+}
+
+#endif // BB_RTMP_LATENCY_PROBE_H
@@ -0,0 +1,374 @@
+/*
+ * rtmp_impair_proxy：位于推流端与本地 RTMP 服务之间的用户态 TCP 代理，
+ * 按脚本或 Mahimahi trace 施加带宽上限、附加时延、抖动、停顿与周期性断网，
+ * 用于在相同网络条件下复现并对比丢帧策略、发送节奏与码率自适应。
+ *
+ * 上行（推流端 -> 服务端）受带宽与队列限制；下行只施加时延。队列满时停止读取推流端，
+ * 加上较小的接收缓冲区，背压会传回推流端的 send()，与真实瓶颈链路一致。
+ *
+ * 用法：
+ *   rtmp_impair_proxy [选项]
+ *     -l [addr:]port     监听地址（默认 127.0.0.1:1936）
+ *     -u host:port       上游 RTMP 服务（默认 127.0.0.1:1935）
+ *     -t <script>        损伤脚本（格式见 impair_link.h）
+ *     -m <trace>         Mahimahi 上行链路 trace，替代脚本中的 bw
+ *     -b <kbps>          初始带宽上限（默认不限）
+ *     -d <ms>            初始单向时延
+ *     -j <ms>            初始抖动
+ *     -q <bytes>         上行瓶颈队列大小（默认 256KB）
+ *     -r <bytes>         面向推流端的 socket 接收缓冲区（默认 64KB）
+ *     -s <seed>          抖动随机种子（默认 1，保证可复现）
+ *     -i <ms>            统计输出间隔（默认 1000，0 关闭）
+ */
+#include "impair_link.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+volatile sig_atomic_t g_interrupted = 0;
+
+void on_signal(int) {
+    g_interrupted = 1;
+}
+
+struct Options {
+    std::string listen_host = "127.0.0.1";
+    int listen_port = 1936;
+    std::string upstream_host = "127.0.0.1";
+    int upstream_port = 1935;
+    std::string script_path;
+    std::string mahimahi_path;
+    ImpairState base;
+    size_t queue_bytes = 256 * 1024;
+    int rcvbuf = 64 * 1024;
+    uint32_t seed = 1;
+    int stats_interval_ms = 1000;
+};
+
+struct Conn {
+    int id;
+    int client_fd;
+    int server_fd;
+    ImpairLink up;    // 推流端 -> 服务端
+    ImpairLink down;  // 服务端 -> 推流端
+    bool client_eof = false;
+    bool server_eof = false;
+    bool up_shut = false;
+    bool down_shut = false;
+    bool dead = false;
+
+    Conn(int id, int client_fd, int server_fd, const ImpairSchedule &schedule, const Options &options)
+            : id(id), client_fd(client_fd), server_fd(server_fd),
+              up(schedule, true, options.queue_bytes, options.seed + id * 2),
+              down(schedule, false, options.queue_bytes, options.seed + id * 2 + 1) {
+    }
+};
+
+int64_t monotonic_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool parse_host_port(const std::string &value, std::string &host, int &port) {
+    size_t colon = value.rfind(':');
+    if (colon == std::string::npos) {
+        port = atoi(value.c_str());
+    } else {
+        host = value.substr(0, colon);
+        port = atoi(value.c_str() + colon + 1);
+    }
+    return port > 0 && port < 65536;
+}
+
+void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/* 以 RST 关闭连接，模拟断网时连接被中间设备重置 */
+void reset_close(int fd) {
+    struct linger lg = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(fd);
+}
+
+int connect_upstream(const Options &options) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = nullptr;
+    std::string port = std::to_string(options.upstream_port);
+    if (getaddrinfo(options.upstream_host.c_str(), port.c_str(), &hints, &res) != 0 || res == nullptr) return -1;
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int open_listener(const Options &options) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // 在监听 socket 上设置，accept 出的连接继承（窗口缩放在握手时协商）
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.rcvbuf, sizeof(options.rcvbuf));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) options.listen_port);
+    if (inet_pton(AF_INET, options.listen_host.c_str(), &addr.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        close(fd);
+        return -1;
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+/* 读取 fd 并放入链路队列，返回 false 表示连接出错 */
+bool pump_in(int fd, ImpairLink &link, bool &eof, int64_t now) {
+    uint8_t buf[64 * 1024];
+    size_t want = std::min(sizeof(buf), link.writable());
+    if (want == 0) return true;
+    ssize_t n = recv(fd, buf, want, 0);
+    if (n > 0) {
+        link.push(now, buf, (size_t) n);
+    } else if (n == 0) {
+        eof = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return false;
+    }
+    return true;
+}
+
+bool pump_out(int fd, ImpairLink &link, int64_t now) {
+    const uint8_t *data = nullptr;
+    size_t size;
+    while ((size = link.sendable(now, &data)) > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        link.consume((size_t) n);
+        if ((size_t) n < size) break;
+    }
+    return true;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr,
+            "用法: %s [-l [addr:]port] [-u host:port] [-t script] [-m mahimahi.trace] [-b kbps] [-d ms]\n"
+            "          [-j ms] [-q queue_bytes] [-r rcvbuf] [-s seed] [-i stats_ms]\n", prog);
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if (arg == "-l") {
+            if (!parse_host_port(value, options.listen_host, options.listen_port)) return false;
+        } else if (arg == "-u") {
+            if (!parse_host_port(value, options.upstream_host, options.upstream_port)) return false;
+        } else if (arg == "-t") options.script_path = value;
+        else if (arg == "-m") options.mahimahi_path = value;
+        else if (arg == "-b") options.base.bw_kbps = atol(value);
+        else if (arg == "-d") options.base.delay_ms = atoi(value);
+        else if (arg == "-j") options.base.jitter_ms = atoi(value);
+        else if (arg == "-q") options.queue_bytes = (size_t) atol(value);
+        else if (arg == "-r") options.rcvbuf = atoi(value);
+        else if (arg == "-s") options.seed = (uint32_t) strtoul(value, nullptr, 10);
+        else if (arg == "-i") options.stats_interval_ms = atoi(value);
+        else return false;
+    }
+    return options.queue_bytes > 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    ImpairSchedule schedule;
+    schedule.set_base(options.base);
+    std::string error;
+    if ((!options.script_path.empty() && !schedule.load_script(options.script_path, error)) ||
+        (!options.mahimahi_path.empty() && !schedule.load_mahimahi(options.mahimahi_path, error))) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    int listen_fd = open_listener(options);
+    if (listen_fd < 0) {
+        fprintf(stderr, "监听 %s:%d 失败: %s\n", options.listen_host.c_str(), options.listen_port, strerror(errno));
+        return 1;
+    }
+    fprintf(stderr, "代理 %s:%d -> %s:%d\n", options.listen_host.c_str(), options.listen_port,
+            options.upstream_host.c_str(), options.upstream_port);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    const int64_t start_us = monotonic_us();
+    std::vector<std::unique_ptr<Conn>> conns;
+    int next_id = 0;
+    int64_t next_stats_us = options.stats_interval_ms > 0 ? (int64_t) options.stats_interval_ms * 1000 : INT64_MAX;
+    int64_t stats_up_bytes = 0;
+    int64_t stats_down_bytes = 0;
+    int64_t total_up_bytes = 0;
+    int resets = 0;
+
+    while (!g_interrupted) {
+        int64_t now = monotonic_us() - start_us;
+        ImpairState state = schedule.state_at(now / 1000);
+
+        if (state.outage) {
+            for (auto &conn : conns) {
+                if (!conn->dead) {
+                    reset_close(conn->client_fd);
+                    reset_close(conn->server_fd);
+                    conn->dead = true;
+                    resets++;
+                }
+            }
+        }
+
+        // 构造 poll 集合：poll 超时取各链路下一次可发送时刻，最长 10ms（检查断网与统计）
+        std::vector<struct pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+        int64_t wakeup = now + 10000;
+        for (auto &conn : conns) {
+            if (conn->dead) continue;
+            const uint8_t *unused;
+            short client_events = 0;
+            short server_events = 0;
+            if (!conn->client_eof && conn->up.writable() > 0) client_events |= POLLIN;
+            if (!conn->server_eof && conn->down.writable() > 0) server_events |= POLLIN;
+            if (conn->up.sendable(now, &unused) > 0) server_events |= POLLOUT;
+            if (conn->down.sendable(now, &unused) > 0) client_events |= POLLOUT;
+            int64_t up_wakeup = conn->up.next_wakeup_us(now);
+            int64_t down_wakeup = conn->down.next_wakeup_us(now);
+            if (up_wakeup >= 0) wakeup = std::min(wakeup, up_wakeup);
+            if (down_wakeup >= 0) wakeup = std::min(wakeup, down_wakeup);
+            fds.push_back({conn->client_fd, client_events, 0});
+            fds.push_back({conn->server_fd, server_events, 0});
+        }
+        int timeout_ms = (int) std::max<int64_t>(0, (wakeup - now + 999) / 1000);
+        if (poll(fds.data(), fds.size(), timeout_ms) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        now = monotonic_us() - start_us;
+
+        if (fds[0].revents & POLLIN) {
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd >= 0) {
+                if (schedule.state_at(now / 1000).outage) {
+                    reset_close(client_fd);
+                } else {
+                    int server_fd = connect_upstream(options);
+                    if (server_fd < 0) {
+                        fprintf(stderr, "连接上游 %s:%d 失败\n", options.upstream_host.c_str(), options.upstream_port);
+                        reset_close(client_fd);
+                    } else {
+                        int on = 1;
+                        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                        setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                        set_nonblocking(client_fd);
+                        set_nonblocking(server_fd);
+                        conns.emplace_back(new Conn(next_id++, client_fd, server_fd, schedule, options));
+                        fprintf(stderr, "[%8.3fs] 连接 #%d 建立\n", now / 1e6, conns.back()->id);
+                    }
+                }
+            }
+        }
+
+        size_t idx = 1;
+        for (auto &conn : conns) {
+            if (conn->dead) continue;
+            short client_revents = fds[idx++].revents;
+            short server_revents = fds[idx++].revents;
+            int64_t up_before = conn->up.forwarded_bytes();
+            int64_t down_before = conn->down.forwarded_bytes();
+            bool ok = true;
+            if (client_revents & (POLLIN | POLLHUP | POLLERR)) ok = ok && pump_in(conn->client_fd, conn->up, conn->client_eof, now);
+            if (server_revents & (POLLIN | POLLHUP | POLLERR)) ok = ok && pump_in(conn->server_fd, conn->down, conn->server_eof, now);
+            ok = ok && pump_out(conn->server_fd, conn->up, now);
+            ok = ok && pump_out(conn->client_fd, conn->down, now);
+            stats_up_bytes += conn->up.forwarded_bytes() - up_before;
+            stats_down_bytes += conn->down.forwarded_bytes() - down_before;
+            total_up_bytes += conn->up.forwarded_bytes() - up_before;
+
+            // 一端关闭写入后，待队列排空再把 FIN 转给另一端
+            if (conn->client_eof && conn->up.empty() && !conn->up_shut) {
+                shutdown(conn->server_fd, SHUT_WR);
+                conn->up_shut = true;
+            }
+            if (conn->server_eof && conn->down.empty() && !conn->down_shut) {
+                shutdown(conn->client_fd, SHUT_WR);
+                conn->down_shut = true;
+            }
+            if (!ok || (conn->up_shut && conn->down_shut)) {
+                if (ok) {
+                    close(conn->client_fd);
+                    close(conn->server_fd);
+                } else {
+                    reset_close(conn->client_fd);
+                    reset_close(conn->server_fd);
+                }
+                conn->dead = true;
+                fprintf(stderr, "[%8.3fs] 连接 #%d 关闭，上行 %lld 字节\n", now / 1e6, conn->id,
+                        (long long) conn->up.forwarded_bytes());
+            }
+        }
+        for (size_t i = 0; i < conns.size();) {
+            if (conns[i]->dead) conns.erase(conns.begin() + i);
+            else ++i;
+        }
+
+        if (now >= next_stats_us) {
+            size_t queued = 0;
+            for (auto &conn : conns) queued += conn->up.queued();
+            double interval_s = options.stats_interval_ms / 1000.0;
+            ImpairState s = schedule.state_at(now / 1000);
+            fprintf(stderr, "[%8.3fs] bw=%lldkbps delay=%dms jitter=%dms%s%s | 连接 %zu | 上行 %.0f kbps 排队 %zu KB | 下行 %.0f kbps\n",
+                    now / 1e6, (long long) s.bw_kbps, s.delay_ms, s.jitter_ms, s.stalled ? " 停顿" : "",
+                    s.outage ? " 断网" : "", conns.size(), stats_up_bytes * 8 / 1000.0 / interval_s, queued / 1024,
+                    stats_down_bytes * 8 / 1000.0 / interval_s);
+            stats_up_bytes = 0;
+            stats_down_bytes = 0;
+            next_stats_us += (int64_t) options.stats_interval_ms * 1000;
+        }
+    }
+
+    for (auto &conn : conns) {
+        close(conn->client_fd);
+        close(conn->server_fd);
+    }
+    close(listen_fd);
+    int64_t elapsed_us = monotonic_us() - start_us;
+    fprintf(stderr, "运行 %.1fs，上行共转发 %lld 字节（平均 %.0f kbps），断网重置 %d 个连接\n", elapsed_us / 1e6,
+            (long long) total_up_bytes, elapsed_us > 0 ? total_up_bytes * 8 * 1000.0 / elapsed_us : 0.0, resets);
+    return 0;
+}
@@ -0,0 +1,494 @@
+/*
+ * rtmp_loadgen：用与移动端完全相同的发送路径（rtmp_wrapper）压测 RTMP 接入服务。
+ *
+ * 输入文件只读入内存一次，所有推流线程共享；每路按媒体时间戳实时节流推送，
+ * 循环播放时时间戳顺延，结束后输出每路吞吐、发送耗时分位数与建连耗时。
+ *
+ * 用法：
+ *   rtmp_loadgen [选项] <url> [url...]
+ *     -i <file.flv>      FLV 输入（H.264 + AAC）
+ *     -v <file.h264>     Annex-B H.264 输入（与 -a 搭配，替代 -i）
+ *     -a <file.aac>      ADTS AAC 输入
+ *     -f <fps>           Annex-B 输入的帧率（默认 30）
+ *     -n <count>         推流路数；url 中的 %d 替换为路序号，否则所有路推同一组 url 轮转
+ *     -t <seconds>       每路推流时长（默认按 -l 循环次数）
+ *     -l <loops>         循环次数（默认 1，0 表示直到 -t 结束）
+ *     -j <ms>            每路启动的随机延迟上限（默认 0）
+ *     -e                 每个视频帧前插入发送时间戳 SEI，配合 rtmp_ingest_server 测量单向时延
+ *     -F                 以 TCP Fast Open 建连（rtmp_set_fast_open），结束后输出使用 TFO 的路数与节省的往返
+ */
+#include "latency_probe.h"
+#include "rtmp_wrapper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum FrameType { FRAME_VIDEO, FRAME_AUDIO };
+
+struct Frame {
+    FrameType type;
+    int64_t timestamp_ms;
+    bool keyframe;
+    size_t offset;  // 在 Media::data 中的偏移（视频为 Annex-B，音频为 raw AAC 或 ADTS）
+    size_t size;
+};
+
+// 只读共享的媒体数据
+struct Media {
+    std::vector<uint8_t> data;
+    std::vector<Frame> frames;  // 按时间戳排序
+    std::vector<uint8_t> sps_pps;  // Annex-B 格式的 SPS + PPS，推流开始时单独发送（与移动端一致）
+    int64_t loop_duration_ms = 0;
+    int width = 0;
+    int height = 0;
+    int video_bitrate = 0;
+    int fps = 30;
+    int sample_rate = 44100;
+    int channels = 1;
+};
+
+struct Options {
+    std::string flv_path;
+    std::string h264_path;
+    std::string aac_path;
+    int fps = 30;
+    int streams = 1;
+    int duration_s = 0;
+    int loops = 1;
+    int jitter_ms = 0;
+    bool embed_send_time = false;
+    bool fast_open = false;
+    std::vector<std::string> urls;
+};
+
+struct StreamResult {
+    std::string url;
+    bool connected = false;
+    int64_t connect_ms = 0;
+    rtmp_connect_timing timing = {};
+    int64_t elapsed_ms = 0;
+    long frames = 0;
+    long bytes = 0;
+    long errors = 0;
+    std::vector<uint32_t> send_us;  // 每次 rtmp_send_* 调用耗时
+};
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool read_file(const std::string &path, std::vector<uint8_t> &out) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        fprintf(stderr, "无法打开文件: %s\n", path.c_str());
+        return false;
+    }
+    uint8_t buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(fp);
+    return true;
+}
+
+uint32_t read_be(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+void append_start_code(std::vector<uint8_t> &out) {
+    static const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+    out.insert(out.end(), kStartCode, kStartCode + 4);
+}
+
+// 在 onMetaData 中查找数字属性
+bool find_amf_number(const uint8_t *body, size_t size, const char *name, double &value) {
+    size_t name_len = strlen(name);
+    for (size_t i = 0; i + 2 + name_len + 9 <= size; ++i) {
+        if (read_be(body + i, 2) == name_len && memcmp(body + i + 2, name, name_len) == 0 &&
+            body[i + 2 + name_len] == 0x00) {
+            uint64_t bits = 0;
+            for (int k = 0; k < 8; ++k) bits = (bits << 8) | body[i + 3 + name_len + k];
+            memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+    }
+    return false;
+}
+
+int aac_sample_rate(int index) {
+    static const int kRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+                                 16000, 12000, 11025, 8000, 7350};
+    return index >= 0 && index < 13 ? kRates[index] : 44100;
+}
+
+/* FLV：AVCC 视频转换为 Annex-B（rtmp_send_video 的输入格式），AAC 取 raw 数据 */
+bool load_flv(const std::string &path, Media &media) {
+    std::vector<uint8_t> file;
+    if (!read_file(path, file)) return false;
+    if (file.size() < 13 || memcmp(file.data(), "FLV", 3) != 0) {
+        fprintf(stderr, "不是 FLV 文件: %s\n", path.c_str());
+        return false;
+    }
+
+    int nal_length_size = 4;
+    int64_t last_ts = 0;
+    size_t pos = read_be(file.data() + 5, 4) + 4;
+    while (pos + 11 <= file.size()) {
+        const uint8_t *tag = file.data() + pos;
+        uint8_t type = tag[0] & 0x1F;
+        uint32_t size = read_be(tag + 1, 3);
+        int64_t ts = read_be(tag + 4, 3) | ((uint32_t) tag[7] << 24);
+        if (pos + 11 + size + 4 > file.size()) break;
+        const uint8_t *body = tag + 11;
+        pos += 11 + size + 4;
+
+        if (type == 18) {
+            double v;
+            if (find_amf_number(body, size, "width", v)) media.width = (int) v;
+            if (find_amf_number(body, size, "height", v)) media.height = (int) v;
+            if (find_amf_number(body, size, "framerate", v) && v > 0) media.fps = (int) v;
+            if (find_amf_number(body, size, "videodatarate", v)) media.video_bitrate = (int) (v * 1000);
+        } else if (type == 9 && size > 5 && (body[0] & 0x0F) == 7) {
+            bool key = (body[0] >> 4) == 1;
+            if (body[1] == 0x00) {
+                // AVCDecoderConfigurationRecord
+                if (size < 11 || !media.sps_pps.empty()) continue;
+                const uint8_t *p = body + 5;
+                const uint8_t *end = body + size;
+                nal_length_size = (p[4] & 0x03) + 1;
+                int sps_count = p[5] & 0x1F;
+                p += 6;
+                for (int pass = 0; pass < 2; ++pass) {
+                    int count = pass == 0 ? sps_count : (p < end ? *p++ : 0);
+                    for (int i = 0; i < count && p + 2 <= end; ++i) {
+                        uint32_t len = read_be(p, 2);
+                        p += 2;
+                        if (p + len > end) break;
+                        append_start_code(media.sps_pps);
+                        media.sps_pps.insert(media.sps_pps.end(), p, p + len);
+                        p += len;
+                    }
+                }
+            } else if (body[1] == 0x01) {
+                Frame frame = {FRAME_VIDEO, ts, key, media.data.size(), 0};
+                const uint8_t *p = body + 5;
+                const uint8_t *end = body + size;
+                while (p + nal_length_size <= end) {
+                    uint32_t len = read_be(p, nal_length_size);
+                    p += nal_length_size;
+                    if (p + len > end) break;
+                    append_start_code(media.data);
+                    media.data.insert(media.data.end(), p, p + len);
+                    p += len;
+                }
+                frame.size = media.data.size() - frame.offset;
+                if (frame.size > 0) media.frames.push_back(frame);
+                last_ts = std::max(last_ts, ts);
+            }
+        } else if (type == 8 && size > 2 && (body[0] >> 4) == 10) {
+            if (body[1] == 0x00) {
+                if (size < 4) continue;
+                int index = ((body[2] & 0x07) << 1) | (body[3] >> 7);
+                media.sample_rate = aac_sample_rate(index);
+                media.channels = (body[3] >> 3) & 0x0F;
+            } else {
+                Frame frame = {FRAME_AUDIO, ts, false, media.data.size(), size - 2};
+                media.data.insert(media.data.end(), body + 2, body + size);
+                media.frames.push_back(frame);
+                last_ts = std::max(last_ts, ts);
+            }
+        }
+    }
+    media.loop_duration_ms = last_ts + 1000 / std::max(media.fps, 1);
+    return !media.frames.empty();
+}
+
+/* Annex-B：以 VCL NALU 的 first_mb_in_slice == 0 划分访问单元，非 VCL NALU 归入下一帧 */
+bool load_annexb(const std::string &path, int fps, Media &media) {
+    std::vector<uint8_t> file;
+    if (!read_file(path, file)) return false;
+    media.fps = fps;
+
+    // 先找出所有 NALU 的起始位置（含起始码）
+    std::vector<std::pair<size_t, size_t>> nals;  // [起始码位置, 负载位置)
+    for (size_t i = 0; i + 3 < file.size(); ++i) {
+        if (file[i] == 0 && file[i + 1] == 0 && file[i + 2] == 1) {
+            size_t start = (i > 0 && file[i - 1] == 0) ? i - 1 : i;
+            nals.push_back(std::make_pair(start, i + 3));
+            i += 2;
+        }
+    }
+
+    std::vector<uint8_t> sps, pps;
+    long index = 0;
+    size_t au_start = nals.empty() ? 0 : nals[0].first;
+    bool au_has_vcl = false;
+    bool au_key = false;
+    for (size_t n = 0; n <= nals.size(); ++n) {
+        bool last = n == nals.size();
+        uint8_t nal_type = last ? 0 : file[nals[n].second] & 0x1F;
+        bool vcl = nal_type == 1 || nal_type == 5;
+        bool first_slice = vcl && nals[n].second + 1 < file.size() && (file[nals[n].second + 1] & 0x80);
+        bool begins_au = !last && au_has_vcl && (!vcl || first_slice);
+        if (last || begins_au) {
+            if (au_has_vcl) {
+                size_t end = last ? file.size() : nals[n].first;
+                Frame frame = {FRAME_VIDEO, index * 1000 / fps, au_key, media.data.size(), end - au_start};
+                media.data.insert(media.data.end(), file.begin() + au_start, file.begin() + end);
+                media.frames.push_back(frame);
+                index++;
+            }
+            if (last) break;
+            au_start = nals[n].first;
+            au_has_vcl = false;
+            au_key = false;
+        }
+        if (vcl) au_has_vcl = true;
+        if (nal_type == 5) au_key = true;
+        if ((nal_type == 7 && sps.empty()) || (nal_type == 8 && pps.empty())) {
+            size_t end = n + 1 < nals.size() ? nals[n + 1].first : file.size();
+            (nal_type == 7 ? sps : pps).assign(file.begin() + nals[n].second, file.begin() + end);
+        }
+    }
+    if (!sps.empty() && !pps.empty()) {
+        append_start_code(media.sps_pps);
+        media.sps_pps.insert(media.sps_pps.end(), sps.begin(), sps.end());
+        append_start_code(media.sps_pps);
+        media.sps_pps.insert(media.sps_pps.end(), pps.begin(), pps.end());
+    }
+    media.loop_duration_ms = index * 1000 / fps;
+    return !media.frames.empty();
+}
+
+/* ADTS：每帧 1024 个采样，保留 ADTS 头（wrapper 会自动剥离） */
+bool load_adts(const std::string &path, Media &media) {
+    std::vector<uint8_t> file;
+    if (!read_file(path, file)) return false;
+
+    long index = 0;
+    size_t pos = 0;
+    while (pos + 7 <= file.size()) {
+        const uint8_t *p = file.data() + pos;
+        if (p[0] != 0xFF || (p[1] & 0xF0) != 0xF0) {
+            pos++;
+            continue;
+        }
+        size_t len = ((p[3] & 0x03) << 11) | (p[4] << 3) | (p[5] >> 5);
+        if (len < 7 || pos + len > file.size()) break;
+        if (index == 0) {
+            media.sample_rate = aac_sample_rate((p[2] >> 2) & 0x0F);
+            media.channels = ((p[2] & 0x01) << 2) | (p[3] >> 6);
+        }
+        Frame frame = {FRAME_AUDIO, index * 1024 * 1000 / media.sample_rate, false, media.data.size(), len};
+        media.data.insert(media.data.end(), p, p + len);
+        media.frames.push_back(frame);
+        index++;
+        pos += len;
+    }
+    media.loop_duration_ms = std::max(media.loop_duration_ms, index * 1024 * 1000 / media.sample_rate);
+    return index > 0;
+}
+
+void run_stream(const Media &media, const Options &options, int jitter_ms, StreamResult &result) {
+    if (jitter_ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(jitter_ms));
+    }
+
+    int64_t connect_start = now_us();
+    rtmp_handle_t handle = rtmp_init(result.url.c_str());
+    result.connect_ms = (now_us() - connect_start) / 1000;
+    if (handle == 0) {
+        fprintf(stderr, "连接失败: %s\n", result.url.c_str());
+        return;
+    }
+    result.connected = true;
+    rtmp_get_connect_timing(handle, &result.timing);
+    rtmp_set_metadata(handle, media.width, media.height, media.video_bitrate, media.fps,
+                      media.sample_rate, media.channels);
+
+    int64_t start_us = now_us();
+    int64_t deadline_us = options.duration_s > 0 ? start_us + (int64_t) options.duration_s * 1000000 : INT64_MAX;
+    // 与移动端一致：推流开始时单独发送 SPS/PPS
+    if (!media.sps_pps.empty()) {
+        rtmp_send_video(handle, const_cast<uint8_t *>(media.sps_pps.data()), (int) media.sps_pps.size(), 0, 1);
+    }
+
+    std::vector<uint8_t> probed;  // -e：SEI + 原始帧
+    bool stop = false;
+    for (int loop = 0; !stop && (options.loops == 0 || loop < options.loops); ++loop) {
+        int64_t loop_offset_ms = loop * media.loop_duration_ms;
+        for (size_t i = 0; i < media.frames.size(); ++i) {
+            const Frame &frame = media.frames[i];
+            int64_t ts = frame.timestamp_ms + loop_offset_ms;
+            int64_t due_us = start_us + ts * 1000;
+            if (due_us >= deadline_us) {
+                stop = true;
+                break;
+            }
+            int64_t wait_us = due_us - now_us();
+            if (wait_us > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+            }
+
+            unsigned char *data = const_cast<uint8_t *>(media.data.data() + frame.offset);
+            int size = (int) frame.size;
+            if (options.embed_send_time && frame.type == FRAME_VIDEO) {
+                probed.clear();
+                latency_probe_append_sei(probed, latency_probe_now_us());
+                probed.insert(probed.end(), data, data + frame.size);
+                data = probed.data();
+                size = (int) probed.size();
+            }
+            int64_t send_start = now_us();
+            int ret = frame.type == FRAME_VIDEO
+                      ? rtmp_send_video(handle, data, size, (long) ts, frame.keyframe)
+                      : rtmp_send_audio(handle, data, size, (long) ts);
+            result.send_us.push_back((uint32_t) (now_us() - send_start));
+            if (ret != 0) {
+                result.errors++;
+                fprintf(stderr, "发送失败，停止该路: %s\n", result.url.c_str());
+                stop = true;
+                break;
+            }
+            result.frames++;
+            result.bytes += (long) frame.size;
+        }
+    }
+    result.elapsed_ms = (now_us() - start_us) / 1000;
+    rtmp_close(handle);
+}
+
+uint32_t percentile(std::vector<uint32_t> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr,
+            "用法: %s [-i file.flv | -v file.h264 [-a file.aac] [-f fps]] [-n streams] [-t seconds]\n"
+            "          [-l loops] [-j jitter_ms] [-e] [-F] <url> [url...]\n", prog);
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-i" && has_value) options.flv_path = argv[++i];
+        else if (arg == "-v" && has_value) options.h264_path = argv[++i];
+        else if (arg == "-a" && has_value) options.aac_path = argv[++i];
+        else if (arg == "-f" && has_value) options.fps = atoi(argv[++i]);
+        else if (arg == "-n" && has_value) options.streams = atoi(argv[++i]);
+        else if (arg == "-t" && has_value) options.duration_s = atoi(argv[++i]);
+        else if (arg == "-l" && has_value) options.loops = atoi(argv[++i]);
+        else if (arg == "-j" && has_value) options.jitter_ms = atoi(argv[++i]);
+        else if (arg == "-e") options.embed_send_time = true;
+        else if (arg == "-F") options.fast_open = true;
+        else if (!arg.empty() && arg[0] == '-') return false;
+        else options.urls.push_back(arg);
+    }
+    if (options.urls.empty() || options.streams <= 0 || options.fps <= 0) return false;
+    if (options.flv_path.empty() == (options.h264_path.empty() && options.aac_path.empty())) return false;
+    if (options.loops == 0 && options.duration_s <= 0) return false;
+    return true;
+}
+
+std::string stream_url(const Options &options, int index) {
+    const std::string &base = options.urls[index % options.urls.size()];
+    size_t pos = base.find("%d");
+    if (pos == std::string::npos) return base;
+    return base.substr(0, pos) + std::to_string(index) + base.substr(pos + 2);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    Media media;
+    bool loaded;
+    if (!options.flv_path.empty()) {
+        loaded = load_flv(options.flv_path, media);
+    } else {
+        loaded = (options.h264_path.empty() || load_annexb(options.h264_path, options.fps, media)) &&
+                 (options.aac_path.empty() || load_adts(options.aac_path, media));
+        std::stable_sort(media.frames.begin(), media.frames.end(), [](const Frame &a, const Frame &b) {
+            return a.timestamp_ms < b.timestamp_ms;
+        });
+    }
+    if (!loaded || media.frames.empty()) {
+        fprintf(stderr, "输入文件中没有可推送的音视频帧\n");
+        return 1;
+    }
+    fprintf(stderr, "已加载 %zu 帧, %zu 字节, 时长 %lld ms, %dx%d@%d, audio=%dHz/%dch\n",
+            media.frames.size(), media.data.size(), (long long) media.loop_duration_ms,
+            media.width, media.height, media.fps, media.sample_rate, media.channels);
+
+    if (options.fast_open && rtmp_set_fast_open(1) != 0) {
+        fprintf(stderr, "系统不支持 TCP Fast Open\n");
+        return 1;
+    }
+
+    std::vector<StreamResult> results(options.streams);
+    std::vector<std::thread> threads;
+    std::mt19937 rng((unsigned) now_us());
+    for (int i = 0; i < options.streams; ++i) {
+        results[i].url = stream_url(options, i);
+        int jitter = options.jitter_ms > 0 ? (int) (rng() % (unsigned) (options.jitter_ms + 1)) : 0;
+        threads.emplace_back(run_stream, std::cref(media), std::cref(options), jitter, std::ref(results[i]));
+    }
+    for (auto &t : threads) t.join();
+
+    printf("%-4s %-8s %-10s %-10s %-10s %-8s %-8s %-8s %-8s %s\n",
+           "#", "connect", "frames", "kbps", "errors", "p50(us)", "p90(us)", "p99(us)", "max(us)", "url");
+    int failed = 0;
+    long total_bytes = 0;
+    int64_t max_elapsed = 0;
+    std::vector<uint32_t> all_send_us;
+    for (int i = 0; i < options.streams; ++i) {
+        StreamResult &r = results[i];
+        if (!r.connected || r.errors > 0) failed++;
+        std::sort(r.send_us.begin(), r.send_us.end());
+        long kbps = r.elapsed_ms > 0 ? (long) (r.bytes * 8 / r.elapsed_ms) : 0;
+        printf("%-4d %-8lld %-10ld %-10ld %-10ld %-8u %-8u %-8u %-8u %s\n",
+               i, (long long) r.connect_ms, r.frames, kbps, r.errors,
+               percentile(r.send_us, 0.50), percentile(r.send_us, 0.90), percentile(r.send_us, 0.99),
+               r.send_us.empty() ? 0 : r.send_us.back(), r.url.c_str());
+        total_bytes += r.bytes;
+        max_elapsed = std::max(max_elapsed, r.elapsed_ms);
+        all_send_us.insert(all_send_us.end(), r.send_us.begin(), r.send_us.end());
+    }
+    std::sort(all_send_us.begin(), all_send_us.end());
+    if (options.fast_open) {
+        int used = 0;
+        int64_t saved_us = 0;
+        for (const StreamResult &r : results) {
+            if (r.timing.fast_open != RTMP_FAST_OPEN_USED) continue;
+            used++;
+            saved_us += r.timing.saved_rtt_us;
+        }
+        printf("TCP Fast Open: %d/%d 路 SYN 携带 C0+C1, 平均节省 %lld us\n", used, options.streams,
+               used > 0 ? (long long) (saved_us / used) : 0LL);
+    }
+    printf("总计: %d 路, 失败 %d 路, 总吞吐 %ld kbps, 发送耗时 p50=%uus p90=%uus p99=%uus\n",
+           options.streams, failed, max_elapsed > 0 ? (long) (total_bytes * 8 / max_elapsed) : 0L,
+           percentile(all_send_us, 0.50), percentile(all_send_us, 0.90), percentile(all_send_us, 0.99));
+    return failed == 0 ? 0 : 1;
+}
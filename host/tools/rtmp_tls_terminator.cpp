@@ -0,0 +1,70 @@
+/*
+ * rtmp_tls_terminator：本机回环 TLS 终结代理，把 rtmps:// 推流解密后转发给明文 RTMP 接入服务。
+ *
+ * 与 rtmp_ingest_server 配合做 RTMPS 端到端测试；推流端用 rtmp_tls_configure 指定 -c 导出的证书。
+ *
+ * 用法：
+ *   rtmp_tls_terminator [-p port] [-B backend_port] [-c cert.pem] [-2] [-k]
+ *     -p <port>          监听端口（默认 1936，0 表示随机端口）
+ *     -B <port>          明文后端端口（默认 1935，0 表示丢弃解密后的数据）
+ *     -c <cert.pem>      导出自签名证书（推流端的 CA 文件）
+ *     -2                 只协商 TLS 1.2（客户端收发两个方向均可装入内核）
+ *     -k                 服务端不使用内核 TLS
+ */
+#include "tls_terminator.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+volatile sig_atomic_t g_interrupted = 0;
+
+void on_signal(int) {
+    g_interrupted = 1;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "用法: %s [-p port] [-B backend_port] [-c cert.pem] [-2] [-k]\n", prog);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int port = 1936;
+    std::string cert_path;
+    TlsTerminatorOptions options;
+    options.backend_port = 1935;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-p" && has_value) port = atoi(argv[++i]);
+        else if (arg == "-B" && has_value) options.backend_port = atoi(argv[++i]);
+        else if (arg == "-c" && has_value) cert_path = argv[++i];
+        else if (arg == "-2") options.max_tls12 = true;
+        else if (arg == "-k") options.enable_ktls = false;
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    TlsTerminator terminator;
+    if (!terminator.start(port, options)) return 1;
+    if (!cert_path.empty() && !terminator.write_certificate(cert_path)) {
+        fprintf(stderr, "无法写入 %s\n", cert_path.c_str());
+        return 1;
+    }
+    fprintf(stderr, "TLS 终结代理监听 127.0.0.1:%d -> 127.0.0.1:%d\n", terminator.port(), options.backend_port);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    while (!g_interrupted) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    terminator.stop();
+    fprintf(stderr, "连接 %d，握手失败 %d，解密 %llu 字节\n", terminator.accepted(), terminator.handshake_failures(),
+            (unsigned long long) terminator.bytes_in());
+    return 0;
+}
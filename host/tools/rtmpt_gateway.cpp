@@ -0,0 +1,326 @@
+#include "rtmpt_gateway.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kMaxResponseData = 64 * 1024;  // 单个应答携带的后端数据上限
+const size_t kMaxHeaderBytes = 8 * 1024;
+const int kIdleWaitMs = 10;
+const char kPollingByte = 0x01;             // 建议的轮询间隔（librtmp 忽略）
+
+int connect_backend(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+bool send_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+void append_response(std::string &out, const char *body, size_t size) {
+    char header[160];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: application/x-fcs\r\n"
+                     "Connection: Keep-Alive\r\n"
+                     "Content-Length: %zu\r\n\r\n", size);
+    out.append(header, (size_t) n);
+    out.append(body, size);
+}
+
+void append_not_found(std::string &out) {
+    out += "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+}
+
+// 请求头中的 Content-Length（大小写不敏感），缺失视为 0
+bool content_length(const char *header, size_t len, size_t *out) {
+    *out = 0;
+    const char *p = header;
+    const char *end = header + len;
+    while (p < end) {
+        const char *line_end = static_cast<const char *>(memchr(p, '\n', (size_t) (end - p)));
+        if (line_end == nullptr) line_end = end;
+        if (line_end - p > 15 && strncasecmp(p, "content-length:", 15) == 0) {
+            char *stop = nullptr;
+            long value = strtol(p + 15, &stop, 10);
+            if (stop == p + 15 || value < 0) return false;
+            *out = (size_t) value;
+            return true;
+        }
+        p = line_end + 1;
+    }
+    return true;
+}
+
+}  // namespace
+
+RtmptGateway::~RtmptGateway() {
+    stop();
+}
+
+bool RtmptGateway::start(int port, int backend_port) {
+    if (running_) return false;
+    backend_port_ = backend_port;
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd_, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listen_fd_, 64) != 0) {
+        fprintf(stderr, "rtmpt: 监听 127.0.0.1:%d 失败: %s\n", port, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, (struct sockaddr *) &addr, &len);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    accept_thread_ = std::thread(&RtmptGateway::accept_loop, this);
+    return true;
+}
+
+void RtmptGateway::stop() {
+    if (!running_.exchange(false)) return;
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : client_fds_) shutdown(fd, SHUT_RDWR);
+        for (auto &entry : backends_) shutdown(entry.second, SHUT_RDWR);
+        threads.swap(threads_);
+    }
+    for (auto &t : threads) t.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : backends_) close(entry.second);
+    backends_.clear();
+}
+
+void RtmptGateway::accept_loop() {
+    while (running_) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            close(fd);
+            break;
+        }
+        client_fds_.push_back(fd);
+        threads_.emplace_back(&RtmptGateway::serve, this, fd);
+    }
+}
+
+int RtmptGateway::session_fd(const std::string &id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = backends_.find(id);
+    return it != backends_.end() ? it->second : -1;
+}
+
+void RtmptGateway::close_session(const std::string &id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = backends_.find(id);
+    if (it == backends_.end()) return;
+    close(it->second);
+    backends_.erase(it);
+}
+
+bool RtmptGateway::handle(const std::string &command, const std::string &id, const char *body, size_t size,
+                          std::string &out) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (command == "open") {
+        int backend = connect_backend(backend_port_);
+        if (backend < 0) {
+            append_not_found(out);
+            return false;
+        }
+        std::string session;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session = std::to_string(next_session_++);
+            backends_[session] = backend;
+        }
+        sessions_.fetch_add(1, std::memory_order_relaxed);
+        session += "\n";
+        append_response(out, session.data(), session.size());
+        return true;
+    }
+    int backend = session_fd(id);
+    if (backend < 0) {
+        append_not_found(out);
+        return false;
+    }
+    if (command == "close") {
+        close_session(id);
+        append_response(out, &kPollingByte, 1);
+        return true;
+    }
+    bool idle = command == "idle";
+    if (command == "send") {
+        sends_.fetch_add(1, std::memory_order_relaxed);
+        bytes_in_.fetch_add(size, std::memory_order_relaxed);
+        if (!send_all(backend, body, size)) {
+            close_session(id);
+            append_not_found(out);
+            return false;
+        }
+    } else if (idle) {
+        idles_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        append_not_found(out);
+        return false;
+    }
+
+    // 应答携带后端已到达的数据；/idle 没有数据时稍等，避免客户端空转轮询
+    std::string data(1, kPollingByte);
+    bool backend_closed = false;
+    while (data.size() < kMaxResponseData + 1) {
+        char buf[16384];
+        size_t want = std::min(sizeof(buf), kMaxResponseData + 1 - data.size());
+        ssize_t n = recv(backend, buf, want, MSG_DONTWAIT);
+        if (n > 0) {
+            data.append(buf, (size_t) n);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            backend_closed = true;
+            break;
+        }
+        if (!idle || data.size() > 1) break;
+        struct pollfd pfd;
+        pfd.fd = backend;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, kIdleWaitMs) <= 0) break;
+        idle = false;  // 只等待一次
+    }
+    if (backend_closed && data.size() == 1) {
+        close_session(id);
+        append_not_found(out);
+        return false;
+    }
+    append_response(out, data.data(), data.size());
+    return true;
+}
+
+void RtmptGateway::serve(int fd) {
+    std::vector<char> in;
+    std::string out;
+    char buf[65536];
+    bool open = true;
+    while (open && running_) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        in.insert(in.end(), buf, buf + n);
+
+        // 先数出已完整到达的请求，再逐个处理
+        size_t pos = 0;
+        int complete = 0;
+        struct Request {
+            std::string command;
+            std::string id;
+            size_t body;
+            size_t size;
+        };
+        std::vector<Request> requests;
+        while (true) {
+            static const char kEnd[] = "\r\n\r\n";
+            auto begin = in.begin() + (std::ptrdiff_t) pos;
+            auto end = std::search(begin, in.end(), kEnd, kEnd + 4);
+            if (end == in.end()) {
+                if (in.size() - pos > kMaxHeaderBytes) open = false;
+                break;
+            }
+            size_t header_len = (size_t) (end - begin) + 4;
+            size_t body_len = 0;
+            if (!content_length(&in[pos], header_len, &body_len)) {
+                open = false;
+                break;
+            }
+            if (in.size() - pos < header_len + body_len) break;
+
+            // 请求行：POST /<command>[/<id>]/<seq> HTTP/1.1
+            std::string line(&in[pos], std::find(begin, end, '\r') - begin);
+            Request request;
+            if (line.compare(0, 6, "POST /") != 0) {
+                open = false;
+                break;
+            }
+            size_t path_end = line.find(' ', 5);
+            std::string path = line.substr(6, path_end == std::string::npos ? std::string::npos : path_end - 6);
+            size_t slash = path.find('/');
+            request.command = path.substr(0, slash);
+            size_t last = path.rfind('/');
+            if (slash != std::string::npos && last > slash) request.id = path.substr(slash + 1, last - slash - 1);
+            request.body = pos + header_len;
+            request.size = body_len;
+            requests.push_back(request);
+            pos += header_len + body_len;
+            complete++;
+        }
+        int peak = max_pipelined_.load(std::memory_order_relaxed);
+        while (complete > peak && !max_pipelined_.compare_exchange_weak(peak, complete)) {
+        }
+        for (const Request &request : requests) {
+            if (!handle(request.command, request.id, in.data() + request.body, request.size, out)) open = false;
+            if (!open) break;
+        }
+        in.erase(in.begin(), in.begin() + (std::ptrdiff_t) pos);
+        if (!out.empty() && !send_all(fd, out.data(), out.size())) break;
+        out.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < client_fds_.size(); ++i) {
+        if (client_fds_[i] == fd) {
+            client_fds_.erase(client_fds_.begin() + i);
+            break;
+        }
+    }
+    close(fd);
+}
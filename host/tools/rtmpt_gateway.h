@@ -0,0 +1,75 @@
+#ifndef BB_RTMP_RTMPT_GATEWAY_H
+#define BB_RTMP_RTMPT_GATEWAY_H
+
+/*
+ * 回环 RTMPT 网关（主机构建）：在本机端口上接受 rtmpt:// 的 HTTP 隧道请求，把 /send 的负载转发给明文
+ * RTMP 后端（如 IngestServer），后端下发的数据随之后的应答返回，用于 RTMPT 端到端测试与基准。
+ *
+ * 协议与 Red5/Wowza 的隧道实现一致：
+ *   POST /open/1            应答会话 id（以 '\n' 结尾）
+ *   POST /send/<id>/<seq>   负载写给后端，应答为 1 字节轮询间隔 + 后端已到达的数据
+ *   POST /idle/<id>/<seq>   最多等待 10 ms 后端数据，应答格式同 /send
+ *   POST /close/<id>/<seq>  关闭后端连接
+ * 每个 HTTP 连接一个线程，请求按到达顺序处理并应答（支持流水线）；后端断开后该会话的请求应答 404。
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RtmptGateway {
+public:
+    RtmptGateway() = default;
+    ~RtmptGateway();
+
+    // port 为 0 时由系统分配端口，可通过 port() 获取
+    bool start(int port, int backend_port);
+    void stop();
+    int port() const { return port_; }
+
+    uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+    uint64_t sends() const { return sends_.load(std::memory_order_relaxed); }
+    uint64_t idles() const { return idles_.load(std::memory_order_relaxed); }
+    // /send 负载字节数（转发给后端的 RTMP 字节）
+    uint64_t bytes_in() const { return bytes_in_.load(std::memory_order_relaxed); }
+    // 一次读取中已完整到达、等待处理的请求数峰值（> 1 说明客户端流水线发送）
+    int max_pipelined() const { return max_pipelined_.load(std::memory_order_relaxed); }
+    int sessions() const { return sessions_.load(std::memory_order_relaxed); }
+
+    RtmptGateway(const RtmptGateway &) = delete;
+    RtmptGateway &operator=(const RtmptGateway &) = delete;
+
+private:
+    void accept_loop();
+    void serve(int fd);
+    // 处理一个请求，把应答追加到 out；返回 false 表示关闭 HTTP 连接
+    bool handle(const std::string &command, const std::string &id, const char *body, size_t size,
+                std::string &out);
+    int session_fd(const std::string &id);
+    void close_session(const std::string &id);
+
+    int backend_port_ = 0;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> sends_{0};
+    std::atomic<uint64_t> idles_{0};
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<int> max_pipelined_{0};
+    std::atomic<int> sessions_{0};
+
+    std::mutex mutex_;
+    std::map<std::string, int> backends_;  // 会话 id -> 后端连接
+    int next_session_ = 1;
+    std::vector<int> client_fds_;
+    std::vector<std::thread> threads_;
+};
+
+#endif // BB_RTMP_RTMPT_GATEWAY_H
@@ -0,0 +1,274 @@
+#include "tls_terminator.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kRelayChunk = 16384;
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+bool add_extension(X509 *cert, int nid, const char *value) {
+    X509V3_CTX ctx;
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION *ext = X509V3_EXT_conf_nid(nullptr, &ctx, nid, value);
+    if (ext == nullptr) return false;
+    bool ok = X509_add_ext(cert, ext, -1) == 1;
+    X509_EXTENSION_free(ext);
+    return ok;
+}
+
+// 自签名证书：同时作为 CA（客户端以此 PEM 校验）
+bool make_self_signed(SSL_CTX *ctx, std::string &pem) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *cert = X509_new();
+    bool ok = key != nullptr && cert != nullptr;
+    if (ok) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 86400L * 365);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *) "bb-rtmp-test", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        ok = add_extension(cert, NID_basic_constraints, "critical,CA:TRUE") &&
+             add_extension(cert, NID_subject_alt_name, "IP:127.0.0.1,DNS:localhost") &&
+             X509_sign(cert, key, EVP_sha256()) > 0 &&
+             SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    }
+    if (ok) {
+        BIO *bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_X509(bio, cert);
+        char *data = nullptr;
+        long len = BIO_get_mem_data(bio, &data);
+        pem.assign(data, (size_t) len);
+        BIO_free(bio);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+int connect_backend(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+}  // namespace
+
+TlsTerminator::TlsTerminator() = default;
+
+TlsTerminator::~TlsTerminator() {
+    stop();
+    if (ctx_ != nullptr) SSL_CTX_free(ctx_);
+}
+
+bool TlsTerminator::start(int port, const TlsTerminatorOptions &options) {
+    if (running_) return false;
+    options_ = options;
+    if (ctx_ == nullptr) {
+        ctx_ = SSL_CTX_new(TLS_server_method());
+        if (ctx_ == nullptr || !make_self_signed(ctx_, cert_pem_)) {
+            fprintf(stderr, "tls: 生成自签名证书失败\n");
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+        SSL_CTX_set_mode(ctx_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    }
+    SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ctx_, options.max_tls12 ? TLS1_2_VERSION : 0);
+    if (options.enable_ktls) SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+    else SSL_CTX_clear_options(ctx_, SSL_OP_ENABLE_KTLS);
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd_, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listen_fd_, 64) != 0) {
+        fprintf(stderr, "tls: 监听 127.0.0.1:%d 失败: %s\n", port, strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, (struct sockaddr *) &addr, &len);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    accept_thread_ = std::thread(&TlsTerminator::accept_loop, this);
+    return true;
+}
+
+void TlsTerminator::stop() {
+    if (!running_.exchange(false)) return;
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : client_fds_) shutdown(fd, SHUT_RDWR);
+        threads.swap(threads_);
+    }
+    for (auto &t : threads) t.join();
+}
+
+bool TlsTerminator::write_certificate(const std::string &path) const {
+    FILE *f = fopen(path.c_str(), "w");
+    if (f == nullptr) return false;
+    bool ok = fwrite(cert_pem_.data(), 1, cert_pem_.size(), f) == cert_pem_.size();
+    return fclose(f) == 0 && ok;
+}
+
+void TlsTerminator::accept_loop() {
+    while (running_) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            close(fd);
+            break;
+        }
+        accepted_++;
+        client_fds_.push_back(fd);
+        threads_.emplace_back(&TlsTerminator::serve, this, fd);
+    }
+}
+
+/* TLS 握手（阻塞）后切换为非阻塞，单线程在 TLS 连接与后端明文连接之间双向转发 */
+void TlsTerminator::serve(int fd) {
+    SSL *ssl = SSL_new(ctx_);
+    SSL_set_fd(ssl, fd);
+    int backend = -1;
+    if (SSL_accept(ssl) != 1) {
+        handshake_failures_++;
+    } else if (options_.backend_port == 0 || (backend = connect_backend(options_.backend_port)) >= 0) {
+        set_nonblocking(fd);
+        if (backend >= 0) set_nonblocking(backend);
+        std::vector<char> up(kRelayChunk);    // 客户端 -> 后端
+        std::vector<char> down(kRelayChunk);  // 后端 -> 客户端
+        size_t up_off = 0, up_len = 0, down_off = 0, down_len = 0;
+        bool client_eof = false, backend_eof = backend < 0;
+        while (true) {
+            bool progress = false;
+            bool want_write = false;
+            if (up_off == up_len && !client_eof) {
+                int n = SSL_read(ssl, up.data(), (int) up.size());
+                if (n > 0) {
+                    bytes_in_.fetch_add(n, std::memory_order_relaxed);
+                    up_off = 0;
+                    up_len = backend >= 0 ? (size_t) n : 0;
+                    progress = true;
+                } else {
+                    int err = SSL_get_error(ssl, n);
+                    if (err == SSL_ERROR_WANT_WRITE) want_write = true;
+                    else if (err != SSL_ERROR_WANT_READ) client_eof = true;
+                }
+            }
+            while (up_off < up_len) {
+                ssize_t n = send(backend, up.data() + up_off, up_len - up_off, MSG_NOSIGNAL);
+                if (n > 0) {
+                    up_off += n;
+                    progress = true;
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+                up_off = up_len;
+                backend_eof = client_eof = true;
+            }
+            if (down_off == down_len && !backend_eof) {
+                ssize_t n = recv(backend, down.data(), down.size(), 0);
+                if (n > 0) {
+                    down_off = 0;
+                    down_len = (size_t) n;
+                    progress = true;
+                } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    backend_eof = true;
+                }
+            }
+            while (down_off < down_len) {
+                int n = SSL_write(ssl, down.data() + down_off, (int) (down_len - down_off));
+                if (n > 0) {
+                    down_off += n;
+                    progress = true;
+                    continue;
+                }
+                int err = SSL_get_error(ssl, n);
+                if (err == SSL_ERROR_WANT_WRITE) want_write = true;
+                else if (err != SSL_ERROR_WANT_READ) {
+                    down_off = down_len;
+                    client_eof = true;
+                }
+                break;
+            }
+            // 任一端关闭且反方向没有待发数据时结束
+            if (client_eof && up_off == up_len) break;
+            if (backend_eof && down_off == down_len && backend >= 0) break;
+            if (progress) continue;
+            if (up_off == up_len && !client_eof && SSL_has_pending(ssl)) continue;
+
+            struct pollfd fds[2];
+            fds[0].fd = fd;
+            fds[0].events = (short) ((!client_eof ? POLLIN : 0) | (want_write ? POLLOUT : 0));
+            fds[1].fd = backend;
+            fds[1].events = (short) ((!backend_eof && down_off == down_len ? POLLIN : 0) |
+                                     (up_off < up_len ? POLLOUT : 0));
+            fds[0].revents = fds[1].revents = 0;
+            if (poll(fds, backend >= 0 ? 2 : 1, 1000) < 0 && errno != EINTR) break;
+            if (!running_) break;
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    if (backend >= 0) close(backend);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < client_fds_.size(); ++i) {
+        if (client_fds_[i] == fd) {
+            client_fds_.erase(client_fds_.begin() + i);
+            break;
+        }
+    }
+    close(fd);
+}
@@ -0,0 +1,65 @@
+#ifndef BB_RTMP_TLS_TERMINATOR_H
+#define BB_RTMP_TLS_TERMINATOR_H
+
+/*
+ * 回环 TLS 终结代理（主机构建，依赖 OpenSSL）：在本机端口上接受 TLS 连接，解密后以明文转发给
+ * 后端（如 IngestServer），用于 RTMPS 端到端测试与内核 TLS / 用户态 TLS 的吞吐对比。
+ * 启动时生成自签名 EC 证书（SAN 为 127.0.0.1 与 localhost），可导出为 PEM 供客户端校验。
+ * 后端端口为 0 时丢弃解密后的数据，只计数（基准测试的接收端）。
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ssl_ctx_st;
+
+struct TlsTerminatorOptions {
+    int backend_port = 0;       // 0 表示丢弃数据
+    bool max_tls12 = false;     // 只协商 TLS 1.2
+    bool enable_ktls = true;    // 服务端也尝试内核 TLS
+};
+
+class TlsTerminator {
+public:
+    TlsTerminator();
+    ~TlsTerminator();
+
+    // port 为 0 时由系统分配端口，可通过 port() 获取
+    bool start(int port, const TlsTerminatorOptions &options);
+    void stop();
+    int port() const { return port_; }
+
+    // 导出自签名证书（PEM），作为客户端的 CA 文件
+    bool write_certificate(const std::string &path) const;
+
+    // 已解密的明文字节数（所有连接累计）
+    uint64_t bytes_in() const { return bytes_in_.load(std::memory_order_relaxed); }
+    int accepted() const { return accepted_.load(std::memory_order_relaxed); }
+    int handshake_failures() const { return handshake_failures_.load(std::memory_order_relaxed); }
+
+private:
+    void accept_loop();
+    void serve(int fd);
+
+    ssl_ctx_st *ctx_ = nullptr;
+    std::string cert_pem_;
+    TlsTerminatorOptions options_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<int> accepted_{0};
+    std::atomic<int> handshake_failures_{0};
+
+    std::mutex mutex_;
+    std::vector<int> client_fds_;
+    std::vector<std::thread> threads_;
+};
+
+#endif // BB_RTMP_TLS_TERMINATOR_H
@@ -131,6 +131,7 @@ class RtmpStreamer {
         
         guard result == 0 else { return false }
         self.rtmpWrapper = wrapper
+        registerKeyFrameRequestHandler(wrapper)
         
         for (index, enc) in videoEncoders.enumerated() {
             enc.setCallback(MultiVideoEncoderCallbackImpl(streamer: self, encoderIndex: index))
@@ -144,6 +145,15 @@ class RtmpStreamer {
         return initialize(url: url, videoEncoders: [videoEncoder], activeEncoderIndex: 0, audioEncoder: audioEncoder)
     }
     
+    /// native 在新连接、丢帧切断参考链时请求关键帧（native 已按最小间隔限流，避免拥塞时 IDR 风暴）
+    private func registerKeyFrameRequestHandler(_ wrapper: RtmpWrapper) {
+        _ = wrapper.setKeyFrameRequestHandler({ [weak self] reason in
+            guard let self = self else { return }
+            print("[\(self.tag)] Native keyframe request, reason=\(reason)")
+            self.getActiveVideoEncoder()?.requestKeyFrame()
+        }, minIntervalMs: keyFrameRequestMinIntervalMs)
+    }
+    
     func setMetadata(width: Int, height: Int, videoBitrate: Int, fps: Int, audioSampleRate: Int, audioChannels: Int) {
         self.metaWidth = width
         self.metaHeight = height
@@ -225,6 +235,9 @@ class RtmpStreamer {
     // Hard bound: at most 5 blocks enqueued (each holds a frame copy) → prevents memory explosion
     private let enqueuePermit = DispatchSemaphore(value: 5)
     
+    // Minimum interval between native keyframe requests
+    private let keyFrameRequestMinIntervalMs: Int32 = 1000
+    
     // Track if we're currently handling errors to prevent concurrent error handling
     private var isHandlingError = false
     private let errorHandlingLock = NSLock()
@@ -279,6 +292,7 @@ class RtmpStreamer {
             if totalDropped % 60 == 0 {
                 print("[\(tag)] Send queue full, dropping frame (total dropped: \(totalDropped))")
             }
+            _ = wrapper?.notifyVideoDropped()
             return
         }
         
@@ -287,6 +301,7 @@ class RtmpStreamer {
             droppedFrames += 1
             droppedFramesLock.unlock()
             enqueuePermit.signal()
+            _ = wrapper?.notifyVideoDropped()
             return
         }
         
@@ -348,6 +363,7 @@ class RtmpStreamer {
                     if totalDropped % 30 == 0 {
                         print("[\(self.tag)] Queue full, dropping non-key frame (total dropped: \(totalDropped))")
                     }
+                    _ = currentWrapper?.notifyVideoDropped()
                     // CRITICAL: Release data immediately to prevent memory buildup
                     return
                 }
@@ -754,10 +770,8 @@ class RtmpStreamer {
                 print("[\(self.tag)] RTMP connection refreshed successfully, protection period started")
                 self.statusCallback?("connected", nil)
                 
-                // Request keyframe from active encoder after a delay (to ensure connection is stable)
-                DispatchQueue.main.asyncAfter(deadline: .now() + 1.0) {
-                    self.getActiveVideoEncoder()?.requestKeyFrame()
-                }
+                // New connection has not sent a keyframe yet: registering requests one immediately
+                self.registerKeyFrameRequestHandler(nw)
             } else {
                 self.stateLock.lock()
                 self.isRefreshing = false
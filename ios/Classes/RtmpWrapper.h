@@ -2,6 +2,12 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// Keyframe request reason (matches rtmp_keyframe_reason)
+typedef NS_ENUM(int, RtmpKeyFrameRequestReason) {
+    RtmpKeyFrameRequestReasonNewStream = 1,
+    RtmpKeyFrameRequestReasonFrameDropped = 2,
+};
+
 @interface RtmpWrapper : NSObject
 
 - (instancetype)init;
@@ -38,12 +44,36 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (int)sendAudio:(NSData *)data timestamp:(long)timestamp;
 
+/**
+ * Register keyframe request handler, invoked on the sending thread (rate limited natively).
+ * Fires immediately if the connection has not sent a keyframe yet (new connection / reconnect).
+ * @param handler Handler, nil to unregister
+ * @param minIntervalMs Minimum interval between requests, <= 0 for default (1000ms)
+ */
+- (int)setKeyFrameRequestHandler:(void (^ _Nullable)(int reason))handler
+                   minIntervalMs:(int)minIntervalMs NS_SWIFT_NAME(setKeyFrameRequestHandler(_:minIntervalMs:));
+
+/**
+ * Notify that a video frame was dropped upstream (reference chain cut).
+ * Non-key frames are dropped natively until the next keyframe.
+ */
+- (int)notifyVideoDropped;
+
 /**
  * Get network stats
  * @return Dictionary with keys: bytesSent, delayMs, packetLossPercent
  */
 - (NSDictionary<NSString *, NSNumber *> * _Nullable)getStats;
 
+/**
+ * Get extended stats (rtmp_stats_v2) in one call without blocking the sender
+ * @return Dictionary with per-media counters (videoBytes, videoMessages, audioBytes, audioMessages,
+ *         dataBytes, dataMessages), chunks, sendSyscalls, sendFailures, droppedVideoFrames,
+ *         queueDepthBytes, maxQueueDepthBytes and histograms enqueueToWire, sendDuration, videoFrameGap
+ *         (each a dictionary with count, sumUs, maxUs, p50Us, p90Us, p99Us, p999Us, buckets)
+ */
+- (NSDictionary<NSString *, id> * _Nullable)getStatsV2;
+
 /**
  * Close connection
  */
@@ -1,6 +1,28 @@
 #import "RtmpWrapper.h"
 #include "rtmp_wrapper.h"
 
+// Keyframe request handlers keyed by handle; looked up on callback so a closed wrapper is never touched
+static NSMutableDictionary<NSNumber *, id> *g_keyFrameHandlers;
+
+static NSMutableDictionary<NSNumber *, id> *keyFrameHandlers(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        g_keyFrameHandlers = [NSMutableDictionary dictionary];
+    });
+    return g_keyFrameHandlers;
+}
+
+static void onKeyFrameRequest(rtmp_handle_t handle, int reason, void *userData) {
+    void (^handler)(int) = nil;
+    NSMutableDictionary *handlers = keyFrameHandlers();
+    @synchronized (handlers) {
+        handler = handlers[@(handle)];
+    }
+    if (handler) {
+        handler(reason);
+    }
+}
+
 @implementation RtmpWrapper {
     rtmp_handle_t _handle;
 }
@@ -47,6 +69,30 @@
     return rtmp_send_audio(_handle, (unsigned char *)[data bytes], (int)[data length], timestamp);
 }
 
+- (int)setKeyFrameRequestHandler:(void (^)(int))handler minIntervalMs:(int)minIntervalMs {
+    if (_handle == 0) return -1;
+    
+    NSMutableDictionary *handlers = keyFrameHandlers();
+    if (handler == nil) {
+        int result = rtmp_set_keyframe_request_callback(_handle, NULL, NULL, minIntervalMs);
+        @synchronized (handlers) {
+            [handlers removeObjectForKey:@(_handle)];
+        }
+        return result;
+    }
+    
+    @synchronized (handlers) {
+        handlers[@(_handle)] = [handler copy];
+    }
+    return rtmp_set_keyframe_request_callback(_handle, onKeyFrameRequest, NULL, minIntervalMs);
+}
+
+- (int)notifyVideoDropped {
+    if (_handle == 0) return -1;
+    
+    return rtmp_notify_video_dropped(_handle);
+}
+
 - (NSDictionary<NSString *, NSNumber *> *)getStats {
     if (_handle == 0) return nil;
     
@@ -62,9 +108,57 @@
     return nil;
 }
 
+static NSDictionary<NSString *, id> *histogramDictionary(const rtmp_histogram &histogram) {
+    NSMutableArray<NSNumber *> *buckets = [NSMutableArray arrayWithCapacity:RTMP_HISTOGRAM_BUCKETS];
+    for (int i = 0; i < RTMP_HISTOGRAM_BUCKETS; ++i) {
+        [buckets addObject:@(histogram.buckets[i])];
+    }
+    return @{
+        @"count": @(histogram.count),
+        @"sumUs": @(histogram.sum_us),
+        @"maxUs": @(histogram.max_us),
+        @"p50Us": @(rtmp_histogram_percentile(&histogram, 50)),
+        @"p90Us": @(rtmp_histogram_percentile(&histogram, 90)),
+        @"p99Us": @(rtmp_histogram_percentile(&histogram, 99)),
+        @"p999Us": @(rtmp_histogram_percentile(&histogram, 99.9)),
+        @"buckets": buckets
+    };
+}
+
+- (NSDictionary<NSString *, id> *)getStatsV2 {
+    if (_handle == 0) return nil;
+
+    rtmp_stats_v2 stats;
+    stats.struct_size = sizeof(stats);
+    if (rtmp_get_stats_v2(_handle, &stats) != 0) return nil;
+
+    return @{
+        @"version": @(stats.version),
+        @"videoBytes": @(stats.video.bytes),
+        @"videoMessages": @(stats.video.messages),
+        @"audioBytes": @(stats.audio.bytes),
+        @"audioMessages": @(stats.audio.messages),
+        @"dataBytes": @(stats.data.bytes),
+        @"dataMessages": @(stats.data.messages),
+        @"chunks": @(stats.chunks),
+        @"sendSyscalls": @(stats.send_syscalls),
+        @"sendFailures": @(stats.send_failures),
+        @"droppedVideoFrames": @(stats.dropped_video_frames),
+        @"queueDepthBytes": @(stats.queue_depth_bytes),
+        @"maxQueueDepthBytes": @(stats.max_queue_depth_bytes),
+        @"enqueueToWire": histogramDictionary(stats.enqueue_to_wire_us),
+        @"sendDuration": histogramDictionary(stats.send_duration_us),
+        @"videoFrameGap": histogramDictionary(stats.video_frame_gap_us)
+    };
+}
+
 - (void)close {
     if (_handle != 0) {
         rtmp_close(_handle);
+        NSMutableDictionary *handlers = keyFrameHandlers();
+        @synchronized (handlers) {
+            [handlers removeObjectForKey:@(_handle)];
+        }
         _handle = 0;
     }
 }
@@ -89,7 +89,7 @@ RTMP_LogLevel RTMP_LogGetLevel()
 	return RTMP_debuglevel;
 }
 
-void RTMP_Log(int level, const char *format, ...)
+void (RTMP_Log)(int level, const char *format, ...)
 {
 	va_list args;
 
@@ -103,7 +103,7 @@ void RTMP_Log(int level, const char *format, ...)
 
 static const char hexdig[] = "0123456789abcdef";
 
-void RTMP_LogHex(int level, const uint8_t *data, unsigned long len)
+void (RTMP_LogHex)(int level, const uint8_t *data, unsigned long len)
 {
 	unsigned long i;
 	char line[50], *ptr;
@@ -130,7 +130,7 @@ void RTMP_LogHex(int level, const uint8_t *data, unsigned long len)
 	}
 }
 
-void RTMP_LogHexString(int level, const uint8_t *data, unsigned long len)
+void (RTMP_LogHexString)(int level, const uint8_t *data, unsigned long len)
 {
 #define BP_OFFSET 9
 #define BP_GRAPH 60
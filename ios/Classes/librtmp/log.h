@@ -62,6 +62,28 @@ void RTMP_LogHexString(int level, const uint8_t *data, unsigned long len);
 void RTMP_LogSetLevel(RTMP_LogLevel lvl);
 RTMP_LogLevel RTMP_LogGetLevel(void);
 
+/* Compile-time level: calls above RTMP_LOG_COMPILE_LEVEL are removed by the
+ * compiler and their arguments are never evaluated; calls at or below it are
+ * still filtered by RTMP_debuglevel before entering the logger. Release
+ * (NDEBUG) builds keep warnings and errors only. */
+#ifndef RTMP_LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define RTMP_LOG_COMPILE_LEVEL RTMP_LOGWARNING
+#else
+#define RTMP_LOG_COMPILE_LEVEL RTMP_LOGALL
+#endif
+#endif
+
+#define RTMP_LOG_ENABLED(level) \
+  ((level) <= RTMP_LOG_COMPILE_LEVEL && (level) <= RTMP_debuglevel)
+
+#define RTMP_Log(level, ...) \
+  do { if (RTMP_LOG_ENABLED(level)) (RTMP_Log)(level, __VA_ARGS__); } while (0)
+#define RTMP_LogHex(level, data, len) \
+  do { if (RTMP_LOG_ENABLED(level)) (RTMP_LogHex)(level, data, len); } while (0)
+#define RTMP_LogHexString(level, data, len) \
+  do { if (RTMP_LOG_ENABLED(level)) (RTMP_LogHexString)(level, data, len); } while (0)
+
 #ifdef __cplusplus
 }
 #endif
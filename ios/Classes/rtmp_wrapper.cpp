@@ -1,4 +1,5 @@
 #include "rtmp_wrapper.h"
+#include "send_stats.h"
 #include <rtmp.h>
 #include <log.h>
 #include <string.h>
@@ -6,6 +7,8 @@
 #include <vector>
 #include <map>
 #include <mutex>
+#include <memory>
+#include <chrono>
 #include <stdio.h>
 #include <signal.h>
 
@@ -36,11 +39,30 @@ struct Connection {
     int video_bitrate = 0;
     int fps = 30;
     char *url_copy = nullptr;
+    // 关键帧请求：参考链断开（新连接或丢帧）后丢弃非关键帧直至下一个 IDR
+    bool waiting_keyframe = true;
+    int keyframe_reason = RTMP_KEYFRAME_REASON_NEW_STREAM;
+    rtmp_keyframe_request_cb keyframe_cb = nullptr;
+    void *keyframe_cb_user_data = nullptr;
+    int keyframe_min_interval_ms = 1000;
+    int64_t last_keyframe_request_ms = 0;
+    // 发送统计：独立于 g_mutex 登记在 g_stats 中，快照不阻塞发送线程
+    std::shared_ptr<SendStats> stats;
+    int64_t enqueue_us = 0;  // 当前帧进入发送接口的时刻（等锁之前）
+};
+
+// 在锁外触发的关键帧请求（避免回调中再次调用 wrapper 时死锁）
+struct KeyFrameRequest {
+    rtmp_keyframe_request_cb cb = nullptr;
+    void *user_data = nullptr;
+    int reason = 0;
 };
 
 static std::map<long, Connection> g_connections;
 static long g_next_handle = 1;
 static std::mutex g_mutex;
+static std::map<long, std::shared_ptr<SendStats>> g_stats;
+static std::mutex g_stats_mutex;
 
 static void free_connection(Connection &conn) {
     if (conn.rtmp) {
@@ -55,9 +77,39 @@ static void free_connection(Connection &conn) {
     conn.connected = false;
 }
 
+static int64_t monotonic_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void cut_reference_chain(Connection &conn, int reason) {
+    if (!conn.waiting_keyframe) { conn.waiting_keyframe = true; conn.keyframe_reason = reason; }
+}
+
+/* 等待关键帧期间按最小间隔限流，拥塞时不会触发 IDR 风暴 */
+static void poll_keyframe_request(Connection &conn, KeyFrameRequest &req) {
+    if (!conn.waiting_keyframe || conn.keyframe_cb == nullptr) return;
+    int64_t now = monotonic_ms();
+    if (conn.last_keyframe_request_ms != 0 && now - conn.last_keyframe_request_ms < conn.keyframe_min_interval_ms) return;
+    conn.last_keyframe_request_ms = now;
+    req.cb = conn.keyframe_cb; req.user_data = conn.keyframe_cb_user_data; req.reason = conn.keyframe_reason;
+}
+
+static void fire_keyframe_request(rtmp_handle_t handle, const KeyFrameRequest &req) {
+    if (req.cb) req.cb(handle, req.reason, req.user_data);
+}
+
 static bool send_packet(Connection &conn, RTMPPacket *packet) {
     if (!conn.connected || conn.rtmp == nullptr) return false;
+    int64_t start_us = send_stats_now_us();
     int ret = RTMP_SendPacket(conn.rtmp, packet, 0);
+    if (conn.stats) {
+        SendStatsMedia media = packet->m_packetType == RTMP_PACKET_TYPE_VIDEO ? SEND_STATS_VIDEO
+                               : packet->m_packetType == RTMP_PACKET_TYPE_AUDIO ? SEND_STATS_AUDIO : SEND_STATS_DATA;
+        conn.stats->on_packet_sent(media, packet->m_nBodySize, conn.rtmp->m_outChunkSize, ret != 0,
+                                   conn.enqueue_us, start_us, send_stats_now_us());
+        conn.stats->sample_queue_depth(RTMP_Socket(conn.rtmp));
+    }
     if (ret) {
         conn.bytes_sent += packet->m_nBodySize;
         return true;
@@ -210,7 +262,11 @@ static bool send_avc_sequence_header(Connection &conn, uint32_t timestamp_ms) {
 }
 
 static bool send_video_frame(Connection &conn, const uint8_t *data, int size, uint32_t timestamp_ms, bool is_key) {
-    if (!conn.sent_video_config) return true;
+    if (!conn.sent_video_config) { cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED); return true; }
+    if (conn.waiting_keyframe && !is_key) { // 参考链已断开，丢弃直至下一个关键帧
+        if (conn.stats) conn.stats->on_video_dropped();
+        return true;
+    }
     std::vector<uint8_t> body;
     body.reserve(size + 9);
     body.push_back(is_key ? 0x17 : 0x27);
@@ -257,6 +313,8 @@ static bool send_video_frame(Connection &conn, const uint8_t *data, int size, ui
     packet.m_hasAbsTimestamp = 1;
     bool ok = send_packet(conn, &packet);
     RTMPPacket_Free(&packet);
+    if (!ok) cut_reference_chain(conn, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
+    else if (is_key) conn.waiting_keyframe = false;
     return ok;
 }
 
@@ -335,12 +393,16 @@ rtmp_handle_t rtmp_init(const char *url) {
     long handle = g_next_handle++;
     Connection conn;
     conn.rtmp = rtmp; conn.connected = true; conn.url_copy = url_copy;
+    conn.stats = std::make_shared<SendStats>();
     g_connections[handle] = conn;
+    {
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        g_stats[handle] = conn.stats;
+    }
     return handle;
 }
 
-int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame) {
-    std::lock_guard<std::mutex> lock(g_mutex);
+static int send_video_locked(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame, KeyFrameRequest &keyframe_req) {
     auto it = g_connections.find(handle);
     if (it == g_connections.end() || !it->second.connected) return -1;
     Connection &conn = it->second;
@@ -353,15 +415,36 @@ int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long ti
     if (!conn.sent_metadata && conn.width > 0 && conn.height > 0 && conn.sent_video_config) {
         send_on_metadata(conn);
     }
-    return send_video_frame(conn, data, size, (uint32_t)timestamp, isKeyFrame != 0) ? 0 : -1;
+    bool ok = send_video_frame(conn, data, size, (uint32_t)timestamp, isKeyFrame != 0);
+    poll_keyframe_request(conn, keyframe_req);
+    return ok ? 0 : -1;
+}
+
+int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long timestamp, int isKeyFrame) {
+    KeyFrameRequest keyframe_req;
+    int result;
+    int64_t entry_us = send_stats_now_us();
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it != g_connections.end() && it->second.stats) {
+            it->second.enqueue_us = entry_us;
+            it->second.stats->on_video_entry(entry_us);
+        }
+        result = send_video_locked(handle, data, size, timestamp, isKeyFrame, keyframe_req);
+    }
+    fire_keyframe_request(handle, keyframe_req);
+    return result;
 }
 
 int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long timestamp) {
+    int64_t entry_us = send_stats_now_us();
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_connections.find(handle);
     if (it == g_connections.end() || !it->second.connected) return -1;
     Connection &conn = it->second;
     if (data == nullptr || size <= 0) return 0;
+    conn.enqueue_us = entry_us;
     if (!conn.sent_audio_config) send_aac_sequence_header(conn);
     if (!conn.sent_metadata && conn.width > 0 && conn.sample_rate > 0) send_on_metadata(conn);
     return send_aac_frame(conn, data, size, (uint32_t)timestamp) ? 0 : -1;
@@ -387,6 +470,36 @@ int rtmp_set_metadata(rtmp_handle_t handle, int width, int height, int video_bit
     return 0;
 }
 
+int rtmp_set_keyframe_request_callback(rtmp_handle_t handle, rtmp_keyframe_request_cb cb, void *user_data, int min_interval_ms) {
+    KeyFrameRequest keyframe_req;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) return -1;
+        Connection &conn = it->second;
+        conn.keyframe_cb = cb;
+        conn.keyframe_cb_user_data = user_data;
+        conn.keyframe_min_interval_ms = min_interval_ms > 0 ? min_interval_ms : 1000;
+        /* 新连接（重连/新推流目标）尚未发过关键帧，立即请求 */
+        poll_keyframe_request(conn, keyframe_req);
+    }
+    fire_keyframe_request(handle, keyframe_req);
+    return 0;
+}
+
+int rtmp_notify_video_dropped(rtmp_handle_t handle) {
+    KeyFrameRequest keyframe_req;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_connections.find(handle);
+        if (it == g_connections.end() || !it->second.connected) return -1;
+        cut_reference_chain(it->second, RTMP_KEYFRAME_REASON_FRAME_DROPPED);
+        poll_keyframe_request(it->second, keyframe_req);
+    }
+    fire_keyframe_request(handle, keyframe_req);
+    return 0;
+}
+
 int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats) {
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_connections.find(handle);
@@ -395,7 +508,23 @@ int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats) {
     return 0;
 }
 
+int rtmp_get_stats_v2(rtmp_handle_t handle, rtmp_stats_v2 *stats) {
+    if (stats == nullptr) return -1;
+    std::shared_ptr<SendStats> send_stats;
+    {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        auto it = g_stats.find(handle);
+        if (it != g_stats.end()) send_stats = it->second;
+    }
+    if (!send_stats) return -1;
+    return send_stats->snapshot(stats);
+}
+
 void rtmp_close(rtmp_handle_t handle) {
+    {
+        std::lock_guard<std::mutex> stats_lock(g_stats_mutex);
+        g_stats.erase(handle);
+    }
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_connections.find(handle);
     if (it != g_connections.end()) {
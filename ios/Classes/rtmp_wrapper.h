@@ -1,6 +1,8 @@
 #ifndef RTMP_WRAPPER_H
 #define RTMP_WRAPPER_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,6 +17,58 @@ typedef struct {
     long packet_loss_percent;     // 丢包率（百分比）
 } rtmp_stats;
 
+// 扩展统计信息版本号；新增字段只追加在结构体末尾，旧调用方按 struct_size 取其认识的部分
+#define RTMP_STATS_VERSION 2
+
+// 直方图桶数：0~3 微秒各占一个桶，之后每个 2 的幂区间再等分 4 个子桶（相对误差 ≤ 25%），覆盖到约 33 秒
+#define RTMP_HISTOGRAM_BUCKETS 96
+
+// 对数分桶延迟直方图（单位：微秒），由 rtmp_histogram_percentile 计算分位数
+typedef struct {
+    uint64_t count;                             // 样本数
+    uint64_t sum_us;                            // 样本总和
+    uint64_t max_us;                            // 最大值
+    uint64_t buckets[RTMP_HISTOGRAM_BUCKETS];   // 各桶样本数
+} rtmp_histogram;
+
+// 按媒体类型的发送计数
+typedef struct {
+    uint64_t bytes;               // 已发送的消息 body 字节数
+    uint64_t messages;            // 已发送的 RTMP 消息数
+} rtmp_media_counters;
+
+// 扩展统计信息（每个连接一份，发送路径以 relaxed 原子量更新，读取不阻塞发送线程）
+typedef struct {
+    uint32_t version;             // 输出：实现的版本号（RTMP_STATS_VERSION）
+    uint32_t struct_size;         // 输入：调用方结构体大小；输出：实际填充的字节数
+    rtmp_media_counters video;
+    rtmp_media_counters audio;
+    rtmp_media_counters data;     // onMetaData 等脚本数据
+    uint64_t chunks;              // 按当前 chunk size 切分出的 chunk 数
+    uint64_t send_syscalls;       // 估算的 send() 调用数（librtmp 每个 chunk 写一次 socket）
+    uint64_t send_failures;       // RTMP_SendPacket 失败次数
+    uint64_t dropped_video_frames;// 等待关键帧期间丢弃的视频帧数
+    int64_t queue_depth_bytes;    // 最近一次发送后内核发送队列中的字节数，无法获取时为 -1
+    int64_t max_queue_depth_bytes;// 内核发送队列峰值
+    rtmp_histogram enqueue_to_wire_us;  // 调用发送接口到最后一个 chunk 写入 socket 的耗时（含等锁）
+    rtmp_histogram send_duration_us;    // 单次 RTMP_SendPacket 耗时
+    rtmp_histogram video_frame_gap_us;  // 相邻两次视频帧调用之间的间隔
+} rtmp_stats_v2;
+
+// 关键帧请求原因
+typedef enum {
+    RTMP_KEYFRAME_REASON_NEW_STREAM = 1,    // 新连接/重连/新推流目标，尚未发送过关键帧
+    RTMP_KEYFRAME_REASON_FRAME_DROPPED = 2  // 丢帧切断了参考链，需等待下一个 IDR
+} rtmp_keyframe_reason;
+
+/**
+ * 关键帧请求回调（在调用 rtmp_send_video 等接口的线程上触发，不持有内部锁）
+ * @param handle 连接句柄
+ * @param reason 请求原因，见 rtmp_keyframe_reason
+ * @param user_data 注册时传入的用户数据
+ */
+typedef void (*rtmp_keyframe_request_cb)(rtmp_handle_t handle, int reason, void *user_data);
+
 /**
  * 初始化 RTMP 连接
  * @param url RTMP 推流地址
@@ -56,6 +110,24 @@ int rtmp_send_video(rtmp_handle_t handle, unsigned char *data, int size, long ti
  */
 int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long timestamp);
 
+/**
+ * 注册关键帧请求回调。注册时若连接尚未发送过关键帧（新连接/重连），会立即请求一次
+ * @param handle 连接句柄
+ * @param cb 回调，传 NULL 取消注册
+ * @param user_data 回调用户数据
+ * @param min_interval_ms 两次请求的最小间隔（毫秒），<= 0 使用默认值 1000，防止拥塞时 IDR 风暴
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_set_keyframe_request_callback(rtmp_handle_t handle, rtmp_keyframe_request_cb cb, void *user_data, int min_interval_ms);
+
+/**
+ * 通知上层丢弃了视频帧（如发送队列满）。丢帧后参考链断开，
+ * 后续非关键帧将被丢弃直至下一个关键帧，并通过回调请求关键帧
+ * @param handle 连接句柄
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_notify_video_dropped(rtmp_handle_t handle);
+
 /**
  * 获取网络统计信息
  * @param handle 连接句柄
@@ -64,6 +136,23 @@ int rtmp_send_audio(rtmp_handle_t handle, unsigned char *data, int size, long ti
  */
 int rtmp_get_stats(rtmp_handle_t handle, rtmp_stats *stats);
 
+/**
+ * 获取扩展统计信息快照：不获取发送锁，计数器逐个以 relaxed 方式读取，
+ * 同一快照内的各字段之间可能相差正在发送的一两条消息
+ * @param handle 连接句柄
+ * @param stats 输出统计信息；调用前需将 struct_size 设为 sizeof(rtmp_stats_v2)
+ * @return 成功返回 0，失败返回负数
+ */
+int rtmp_get_stats_v2(rtmp_handle_t handle, rtmp_stats_v2 *stats);
+
+/**
+ * 按直方图估算分位数
+ * @param histogram 直方图
+ * @param percentile 分位（0~100，如 99 表示 p99）
+ * @return 所在桶的上界（微秒，不超过 max_us），无样本时返回 0
+ */
+uint64_t rtmp_histogram_percentile(const rtmp_histogram *histogram, double percentile);
+
 /**
  * 关闭 RTMP 连接
  * @param handle 连接句柄
@@ -0,0 +1,160 @@
+#include "send_stats.h"
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#if defined(__linux__)
+#include <linux/sockios.h>
+#endif
+
+int64_t send_stats_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 单写者：读改写拆成 relaxed load + store，避免带 lock 前缀的原子指令
+static inline void add_relaxed(std::atomic<uint64_t> &target, uint64_t delta) {
+    target.store(target.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+static inline void store_max(std::atomic<uint64_t> &target, uint64_t value) {
+    if (value > target.load(std::memory_order_relaxed)) target.store(value, std::memory_order_relaxed);
+}
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+    for (auto &bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucket_index(uint64_t value_us) {
+    const uint64_t sub_buckets = 1u << kSubBucketBits;
+    if (value_us < sub_buckets) return (int) value_us;
+    int exponent = 63 - __builtin_clzll(value_us);
+    int sub = (int) ((value_us >> (exponent - kSubBucketBits)) & (sub_buckets - 1));
+    int index = (exponent - kSubBucketBits + 1) * (int) sub_buckets + sub;
+    return index < kBuckets ? index : kBuckets - 1;
+}
+
+uint64_t LatencyHistogram::bucket_upper(int index) {
+    const int sub_buckets = 1 << kSubBucketBits;
+    if (index < sub_buckets) return (uint64_t) index;
+    int exponent = index / sub_buckets + kSubBucketBits - 1;
+    uint64_t width = 1ull << (exponent - kSubBucketBits);
+    uint64_t lower = (uint64_t) (sub_buckets + index % sub_buckets) << (exponent - kSubBucketBits);
+    return lower + width - 1;
+}
+
+void LatencyHistogram::record(int64_t value_us) {
+    uint64_t value = value_us > 0 ? (uint64_t) value_us : 0;
+    add_relaxed(buckets_[bucket_index(value)], 1);
+    add_relaxed(count_, 1);
+    add_relaxed(sum_, value);
+    store_max(max_, value);
+}
+
+void LatencyHistogram::snapshot(rtmp_histogram *out) const {
+    out->count = count_.load(std::memory_order_relaxed);
+    out->sum_us = sum_.load(std::memory_order_relaxed);
+    out->max_us = max_.load(std::memory_order_relaxed);
+    for (int i = 0; i < kBuckets; ++i) {
+        out->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+SendStats::SendStats() {
+    for (int i = 0; i < 3; ++i) {
+        bytes[i].store(0, std::memory_order_relaxed);
+        messages[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void SendStats::on_packet_sent(SendStatsMedia media, uint32_t body_size, int chunk_size, bool ok,
+                               int64_t enqueue_us, int64_t start_us, int64_t end_us) {
+    send_duration.record(end_us - start_us);
+    if (!ok) {
+        add_relaxed(send_failures, 1);
+        return;
+    }
+    uint64_t packet_chunks = chunk_size > 0 && body_size > 0 ? (body_size + chunk_size - 1) / chunk_size : 1;
+    add_relaxed(bytes[media], body_size);
+    add_relaxed(messages[media], 1);
+    add_relaxed(chunks, packet_chunks);
+    add_relaxed(send_syscalls, packet_chunks);
+    if (enqueue_us > 0) enqueue_to_wire.record(end_us - enqueue_us);
+}
+
+void SendStats::on_video_entry(int64_t now_us) {
+    int64_t previous = last_video_entry_us.load(std::memory_order_relaxed);
+    last_video_entry_us.store(now_us, std::memory_order_relaxed);
+    if (previous > 0) video_frame_gap.record(now_us - previous);
+}
+
+void SendStats::on_video_dropped() {
+    add_relaxed(dropped_video_frames, 1);
+}
+
+void SendStats::sample_queue_depth(int fd) {
+    int queued = -1;
+    if (fd < 0) return;
+#if defined(SIOCOUTQ)
+    if (ioctl(fd, SIOCOUTQ, &queued) != 0) return;
+#elif defined(SO_NWRITE)
+    socklen_t len = sizeof(queued);
+    if (getsockopt(fd, SOL_SOCKET, SO_NWRITE, &queued, &len) != 0) return;
+#else
+    return;
+#endif
+    queue_depth.store(queued, std::memory_order_relaxed);
+    if (queued > max_queue_depth.load(std::memory_order_relaxed)) {
+        max_queue_depth.store(queued, std::memory_order_relaxed);
+    }
+}
+
+int SendStats::snapshot(rtmp_stats_v2 *out) const {
+    size_t wanted = out->struct_size;
+    if (wanted < offsetof(rtmp_stats_v2, video)) return -1;
+
+    rtmp_stats_v2 full;
+    memset(&full, 0, sizeof(full));
+    rtmp_media_counters *media[3] = {&full.video, &full.audio, &full.data};
+    for (int i = 0; i < 3; ++i) {
+        media[i]->bytes = bytes[i].load(std::memory_order_relaxed);
+        media[i]->messages = messages[i].load(std::memory_order_relaxed);
+    }
+    full.chunks = chunks.load(std::memory_order_relaxed);
+    full.send_syscalls = send_syscalls.load(std::memory_order_relaxed);
+    full.send_failures = send_failures.load(std::memory_order_relaxed);
+    full.dropped_video_frames = dropped_video_frames.load(std::memory_order_relaxed);
+    full.queue_depth_bytes = queue_depth.load(std::memory_order_relaxed);
+    full.max_queue_depth_bytes = max_queue_depth.load(std::memory_order_relaxed);
+    enqueue_to_wire.snapshot(&full.enqueue_to_wire_us);
+    send_duration.snapshot(&full.send_duration_us);
+    video_frame_gap.snapshot(&full.video_frame_gap_us);
+
+    size_t filled = wanted < sizeof(full) ? wanted : sizeof(full);
+    full.version = RTMP_STATS_VERSION;
+    full.struct_size = (uint32_t) filled;
+    memcpy(out, &full, filled);
+    return 0;
+}
+
+uint64_t rtmp_histogram_percentile(const rtmp_histogram *histogram, double percentile) {
+    if (histogram == nullptr) return 0;
+    uint64_t total = 0;
+    for (int i = 0; i < RTMP_HISTOGRAM_BUCKETS; ++i) total += histogram->buckets[i];
+    if (total == 0) return 0;
+    if (percentile < 0) percentile = 0;
+    if (percentile > 100) percentile = 100;
+    uint64_t rank = (uint64_t) std::ceil(percentile / 100.0 * (double) total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < RTMP_HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = LatencyHistogram::bucket_upper(i);
+            return histogram->max_us > 0 && upper > histogram->max_us ? histogram->max_us : upper;
+        }
+    }
+    return histogram->max_us;
+}
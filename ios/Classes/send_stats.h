@@ -0,0 +1,75 @@
+#ifndef BB_RTMP_SEND_STATS_H
+#define BB_RTMP_SEND_STATS_H
+
+/*
+ * 每个连接的发送统计：只由持有 wrapper 锁的发送线程写入（单写者，更新为 relaxed load + store），
+ * 读取方通过 shared_ptr 持有对象，无需获取 wrapper 锁即可随时快照。
+ */
+
+#include "rtmp_wrapper.h"
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+    static const int kBuckets = RTMP_HISTOGRAM_BUCKETS;
+    static const int kSubBucketBits = 2;
+
+    LatencyHistogram();
+
+    // 值（微秒）所在的桶：0~3 直接映射，之后每个 2 的幂区间分 4 个子桶
+    static int bucket_index(uint64_t value_us);
+    // 桶覆盖的最大值（含）
+    static uint64_t bucket_upper(int index);
+
+    void record(int64_t value_us);
+    void snapshot(rtmp_histogram *out) const;
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+enum SendStatsMedia {
+    SEND_STATS_VIDEO = 0,
+    SEND_STATS_AUDIO = 1,
+    SEND_STATS_DATA = 2,
+};
+
+struct SendStats {
+    std::atomic<uint64_t> bytes[3];
+    std::atomic<uint64_t> messages[3];
+    std::atomic<uint64_t> chunks{0};
+    std::atomic<uint64_t> send_syscalls{0};
+    std::atomic<uint64_t> send_failures{0};
+    std::atomic<uint64_t> dropped_video_frames{0};
+    std::atomic<int64_t> queue_depth{-1};
+    std::atomic<int64_t> max_queue_depth{0};
+    std::atomic<int64_t> last_video_entry_us{0};
+
+    LatencyHistogram enqueue_to_wire;
+    LatencyHistogram send_duration;
+    LatencyHistogram video_frame_gap;
+
+    SendStats();
+
+    // 一次 RTMP_SendPacket 完成后调用
+    void on_packet_sent(SendStatsMedia media, uint32_t body_size, int chunk_size, bool ok,
+                        int64_t enqueue_us, int64_t start_us, int64_t end_us);
+    // 视频帧进入发送接口时调用，记录帧间隔
+    void on_video_entry(int64_t now_us);
+    // 等待关键帧期间丢弃一个视频帧
+    void on_video_dropped();
+    // 采样内核发送队列深度（Linux/Android 为 SIOCOUTQ，Apple 平台为 SO_NWRITE）
+    void sample_queue_depth(int fd);
+
+    // 按调用方的 struct_size 填充，返回 0；struct_size 小于 v2 首个版本的头部时返回 -1
+    int snapshot(rtmp_stats_v2 *out) const;
+};
+
+// 单调时钟（微秒）
+int64_t send_stats_now_us();
+
+#endif // BB_RTMP_SEND_STATS_H
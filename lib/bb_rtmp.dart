@@ -29,6 +29,8 @@ class BbRtmp {
   /// [fps] 帧率
   /// [isPortrait] 是否竖屏模式（true=竖屏，false=横屏）
   /// [initialCameraFacing] 初始摄像头方向 ('front' 或 'back')
+  /// [videoCodec] 视频编码 ('h264' 或 'hevc')；HEVC 以 Enhanced RTMP 发送，服务端需支持。
+  /// 设备不支持 HEVC 编码时回退到 H.264；目前仅 Android 生效
   ///
   /// 返回预览纹理 ID，用于在 Flutter UI 中显示摄像头预览
   static Future<int?> initializePreview({
@@ -37,6 +39,7 @@ class BbRtmp {
     int fps = 30,
     bool isPortrait = true,
     String initialCameraFacing = 'front',
+    String videoCodec = 'h264',
   }) async {
     try {
       final result = await _channel.invokeMethod('initializePreview', {
@@ -45,6 +48,7 @@ class BbRtmp {
         'fps': fps,
         'isPortrait': isPortrait,
         'initialCameraFacing': initialCameraFacing,
+        'videoCodec': videoCodec,
       });
       return result as int?;
     } on PlatformException catch (e) {
@@ -74,6 +78,10 @@ class BbRtmp {
   /// [enableAudio] 是否启用音频
   /// [isPortrait] 是否竖屏模式（true=竖屏，false=横屏）
   /// [initialCameraFacing] 初始摄像头方向 ('front' 或 'back')
+  /// [videoCodec] 视频编码 ('h264' 或 'hevc')；HEVC 以 Enhanced RTMP 发送，服务端需支持。
+  /// 设备不支持 HEVC 编码时回退到 H.264；目前仅 Android 生效
+  /// [audioCodec] 音频编码 ('aac' 或 'opus')；Opus（48kHz/32kbps）以 Enhanced RTMP 发送，服务端需支持，
+  /// 默认 AAC。设备不支持 Opus 编码时回退到 AAC；目前仅 Android 生效
   ///
   /// 返回预览纹理 ID，用于在 Flutter UI 中显示摄像头预览
   static Future<int?> initialize({
@@ -85,6 +93,8 @@ class BbRtmp {
     bool enableAudio = true,
     bool isPortrait = true,
     String initialCameraFacing = 'front',
+    String videoCodec = 'h264',
+    String audioCodec = 'aac',
   }) async {
     try {
       final result = await _channel.invokeMethod('initialize', {
@@ -96,6 +106,8 @@ class BbRtmp {
         'enableAudio': enableAudio,
         'isPortrait': isPortrait,
         'initialCameraFacing': initialCameraFacing,
+        'videoCodec': videoCodec,
+        'audioCodec': audioCodec,
       });
       return result as int?;
     } on PlatformException catch (e) {
@@ -108,6 +120,7 @@ class BbRtmp {
   /// [rtmpUrl] RTMP 推流地址（如果之前未设置）
   /// [bitrate] 码率（bps）
   /// [enableAudio] 是否启用音频
+  /// [audioCodec] 音频编码 ('aac' 或 'opus')，仅在此时创建音频编码器（如先调用 initializePreview）时生效
   ///
   /// 注意：此方法立即返回，不会等待连接完成。
   /// 连接状态会通过 [listenToStreamingStatus] 回调通知。
@@ -116,12 +129,14 @@ class BbRtmp {
     String? rtmpUrl,
     int bitrate = 2000000,
     bool enableAudio = true,
+    String? audioCodec,
   }) async {
     try {
       await _channel.invokeMethod('startStreaming', {
         if (rtmpUrl != null) 'rtmpUrl': rtmpUrl,
         'bitrate': bitrate,
         'enableAudio': enableAudio,
+        if (audioCodec != null) 'audioCodec': audioCodec,
       });
     } on PlatformException catch (e) {
       throw Exception('开始推流失败: ${e.message}');